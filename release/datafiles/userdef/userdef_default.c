@@ -234,6 +234,12 @@ const UserDef U_default = {
     .sequencer_disk_cache_size_limit = 100,
     .sequencer_disk_cache_flag = 0,
     .sequencer_proxy_setup = USER_SEQ_PROXY_SETUP_AUTOMATIC,
+    .sequencer_prefetch_workers = 0,
+    .sequencer_prefetch_memory_limit = 0,
+
+    .geometry_nodes_disk_cache_dir = "",
+    .geometry_nodes_disk_cache_size_limit = 100,
+    .geometry_nodes_disk_cache_flag = 0,
 
     .collection_instance_empty_size = 1.0f,
 
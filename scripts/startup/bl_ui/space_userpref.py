@@ -788,6 +788,7 @@ class USERPREF_PT_system_memory(SystemPanel, CenterAlignMixIn, Panel):
         col = layout.column()
         col.prop(edit, "undo_steps", text="Undo Steps")
         col.prop(edit, "undo_memory_limit", text="Undo Memory Limit")
+        col.prop(edit, "undo_compress_steps", text="Compress After")
         col.prop(edit, "use_global_undo")
 
         layout.separator()
@@ -825,6 +826,12 @@ class USERPREF_PT_system_video_sequencer(SystemPanel, CenterAlignMixIn, Panel):
 
         layout.separator()
 
+        col = layout.column()
+        col.prop(system, "sequencer_prefetch_workers", text="Prefetch Workers")
+        col.prop(system, "sequencer_prefetch_memory_limit", text="Memory Limit")
+
+        layout.separator()
+
         layout.prop(system, "use_sequencer_disk_cache", text="Disk Cache")
         col = layout.column()
         col.active = system.use_sequencer_disk_cache
@@ -837,6 +844,20 @@ class USERPREF_PT_system_video_sequencer(SystemPanel, CenterAlignMixIn, Panel):
         layout.prop(system, "sequencer_proxy_setup")
 
 
+class USERPREF_PT_system_geometry_nodes(SystemPanel, CenterAlignMixIn, Panel):
+    bl_label = "Geometry Nodes"
+
+    def draw_centered(self, context, layout):
+        prefs = context.preferences
+        system = prefs.system
+
+        layout.prop(system, "use_geometry_nodes_disk_cache", text="Disk Cache")
+        col = layout.column()
+        col.active = system.use_geometry_nodes_disk_cache
+        col.prop(system, "geometry_nodes_disk_cache_dir", text="Directory")
+        col.prop(system, "geometry_nodes_disk_cache_size_limit", text="Cache Limit")
+
+
 # -----------------------------------------------------------------------------
 # Viewport Panels
 
@@ -2860,6 +2881,13 @@ class USERPREF_PT_experimental_new_features(ExperimentalPanel, Panel):
                 ({"property": "use_new_volume_nodes"}, ("blender/blender/issues/103248", "#103248")),
                 ({"property": "use_shader_node_previews"}, ("blender/blender/issues/110353", "#110353")),
                 ({"property": "use_bundle_and_closure_nodes"}, ("blender/blender/issues/134029", "#134029")),
+                ({"property": "use_autosave_background"}, None),
+                ({"property": "use_depsgraph_relations_cache"}, None),
+                ({"property": "use_depsgraph_priority_scheduling"}, None),
+                ({"property": "use_depsgraph_partial_copy"}, None),
+                ({"property": "use_depsgraph_multi_frame"}, None),
+                ({"property": "use_geometry_nodes_work_stealing"}, None),
+                ({"property": "use_geometry_nodes_memoization"}, None),
             ),
         )
 
@@ -2971,6 +2999,7 @@ classes = (
     USERPREF_PT_system_network,
     USERPREF_PT_system_memory,
     USERPREF_PT_system_video_sequencer,
+    USERPREF_PT_system_geometry_nodes,
     USERPREF_PT_system_sound,
 
     USERPREF_MT_interface_theme_presets,
@@ -0,0 +1,96 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bke
+ *
+ * Content addressed cache for evaluated geometry that is stored in a directory on disk. Contrary
+ * to bakes, the cache is not managed by the user. Every entry is identified by a hash of
+ * everything that went into the evaluation, so the same directory can be shared by many Blender
+ * instances, e.g. all jobs of a render farm.
+ *
+ * Every entry is stored in a single file that contains the data written by #serialize_bake. A new
+ * entry is written to a temporary file first and then renamed, so other processes never see
+ * partially written entries. The modification time of an entry is updated when it is read, which
+ * is used to remove the least recently used entries when the size limit is exceeded. To avoid
+ * scanning the directory after every write, the cache may exceed the limit by a small fraction
+ * for every process that writes to it.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include "BLI_string_ref.hh"
+#include "BLI_utility_mixins.hh"
+
+#include "BKE_bake_items.hh"
+
+namespace blender::bke::bake::disk_cache {
+
+/** Identifies a cache entry. */
+struct CacheKey {
+  uint64_t low = 0;
+  uint64_t high = 0;
+
+  /** Hexadecimal representation that is used as file name. */
+  std::string to_string() const;
+};
+
+/**
+ * Accumulates all the data that an evaluation depends on into a #CacheKey.
+ */
+class CacheKeyBuilder : NonCopyable, NonMovable {
+ private:
+  /** Opaque hash state, to avoid exposing the hash library in the header. */
+  void *state_;
+
+ public:
+  CacheKeyBuilder();
+  ~CacheKeyBuilder();
+
+  void add_bytes(const void *data, int64_t size);
+  void add_string(StringRef str);
+
+  template<typename T> void add_value(const T &value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    this->add_bytes(&value, sizeof(T));
+  }
+
+  /**
+   * Adds the content of the geometry, using the same data that would be written to the cache.
+   * Data that is not serialized, like anonymous attributes, is ignored.
+   */
+  void add_geometry(const GeometrySet &geometry);
+
+  CacheKey finish() const;
+};
+
+/**
+ * Returns false if the geometry contains data that would be lost when it is written to the cache,
+ * e.g. instances of objects or collections.
+ */
+bool geometry_supports_disk_cache(const GeometrySet &geometry);
+
+/**
+ * Load a cache entry.
+ * \return Nothing if there is no valid entry for the key.
+ */
+std::optional<BakeState> read(StringRefNull cache_dir, const CacheKey &key);
+
+/**
+ * Store a cache entry. Geometries in the state are expected to be prepared with
+ * #GeometryBakeItem::prepare_geometry_for_bake. Afterwards, the least recently used entries are
+ * removed until the cache is smaller than the size limit. That only happens once a fraction of the
+ * size limit was written since the entries were removed the last time.
+ */
+void write(StringRefNull cache_dir,
+           const CacheKey &key,
+           const BakeState &state,
+           int64_t size_limit);
+
+}  // namespace blender::bke::bake::disk_cache
@@ -308,6 +308,20 @@ enum {
    */
   G_LIBOVERRIDE_NO_AUTO_RESYNC = 1 << 3,
 
+  /**
+   * Read uncompressed blend-files through a copy-on-write memory mapping, and reference large
+   * plain data arrays (attributes, offsets, packed files) directly in the mapping instead of
+   * copying them. Typically set by the `--enable-blend-file-mmap-sharing` command-line argument.
+   */
+  G_FILE_MMAP_DATA_SHARING = 1 << 4,
+
+  /**
+   * When saving again to the file the current #Main was last saved to, only append the IDs that
+   * changed since then instead of rewriting the whole file. Typically set by the
+   * `--enable-blend-file-incremental-save` command-line argument.
+   */
+  G_FILE_INCREMENTAL_SAVE = 1 << 5,
+
   // G_FILE_DEPRECATED_9 = (1 << 9),
   G_FILE_NO_UI = (1 << 10),
 
@@ -346,8 +360,8 @@ enum {
  * This means we can change the values without worrying about do-versions.
  */
 #define G_FILE_FLAG_ALL_RUNTIME \
-  (G_BACKGROUND_NO_DEPSGRAPH | G_LIBOVERRIDE_NO_AUTO_RESYNC | G_FILE_NO_UI | \
-   G_FILE_RECOVER_READ | G_FILE_RECOVER_WRITE)
+  (G_BACKGROUND_NO_DEPSGRAPH | G_LIBOVERRIDE_NO_AUTO_RESYNC | G_FILE_MMAP_DATA_SHARING | \
+   G_FILE_INCREMENTAL_SAVE | G_FILE_NO_UI | G_FILE_RECOVER_READ | G_FILE_RECOVER_WRITE)
 
 /** #Global.moving, signals drawing in (3d) window to denote transform */
 enum {
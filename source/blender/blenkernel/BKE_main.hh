@@ -123,6 +123,18 @@ enum {
   MAINIDRELATIONS_INCLUDE_UI = 1 << 0,
 };
 
+/**
+ * Data kept by the blend-file writer between two saves of the same #Main, to only append the
+ * changed IDs on the next save (see #G_FILE_INCREMENTAL_SAVE). Its content is private to the
+ * writer.
+ *
+ * \note It is not kept when the #Main is replaced, as done by loading a file and by memfile
+ * undo steps. The next save after an undo then writes the whole file again.
+ */
+struct MainIncrementalSaveState {
+  virtual ~MainIncrementalSaveState() = default;
+};
+
 struct Main {
   Main *next, *prev;
   /**
@@ -289,6 +301,9 @@ struct Main {
    */
   UniqueName_Map *name_map_global;
 
+  /** Owned by the Main, freed together with its IDs. */
+  MainIncrementalSaveState *incremental_save_state;
+
   MainLock *lock;
 };
 
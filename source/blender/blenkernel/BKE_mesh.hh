@@ -106,6 +106,19 @@ void normals_calc_verts(Span<float3> vert_positions,
                         Span<float3> face_normals,
                         MutableSpan<float3> vert_normals);
 
+/**
+ * Calculate vertex normals like #normals_calc_verts, but accumulate the weighted face normals of
+ * the corners around each vertex, with weights computed once per corner in a pass over the faces.
+ * This avoids searching every face of a vertex for its neighbors.
+ */
+void normals_calc_verts_from_corners(Span<float3> vert_positions,
+                                     OffsetIndices<int> faces,
+                                     Span<int> corner_verts,
+                                     GroupedSpan<int> vert_to_corner_map,
+                                     Span<int> corner_to_face_map,
+                                     Span<float3> face_normals,
+                                     MutableSpan<float3> vert_normals);
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
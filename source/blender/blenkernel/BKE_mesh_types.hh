@@ -122,6 +122,24 @@ struct TrianglesCache {
   void tag_dirty();
 };
 
+/**
+ * Trees from the BVH caches that depend only on the topology and not on the positions of the
+ * mesh. When only positions change, a tree for the new positions is created by copying one of
+ * these trees and updating its bounds, which is much faster than building a new tree. A new tree
+ * is only built when the bounds overlap too much after the update.
+ */
+struct BVHRefitCache {
+  struct Item {
+    std::shared_ptr<BVHTree> tree;
+    /** #BLI_bvhtree_get_sah_cost of the tree right after it was built. */
+    float built_cost = 0.0f;
+  };
+  std::mutex mutex;
+  Item verts;
+  Item edges;
+  Item corner_tris;
+};
+
 struct MeshRuntime {
   /**
    * "Evaluated" mesh owned by this mesh. Used for objects which don't have effective modifiers, so
@@ -173,15 +191,21 @@ struct MeshRuntime {
   /** Cache for triangle to original face index map, accessed with #Mesh::corner_tri_faces(). */
   SharedCache<Array<int>> corner_tri_faces_cache;
 
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_verts;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_edges;
+  /** Trees for all elements, which are also referenced by #bvh_refit_cache. */
+  SharedCache<std::shared_ptr<BVHTree>> bvh_cache_verts;
+  SharedCache<std::shared_ptr<BVHTree>> bvh_cache_edges;
   SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_faces;
-  SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_corner_tris;
+  SharedCache<std::shared_ptr<BVHTree>> bvh_cache_corner_tris;
   SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_corner_tris_no_hidden;
   SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_verts;
   SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_verts_no_hidden;
   SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_edges;
   SharedCache<std::unique_ptr<BVHTree, BVHTreeDeleter>> bvh_cache_loose_edges_no_hidden;
+  /**
+   * Shared between meshes with the same topology, even when their positions are different. Only
+   * replaced when the topology changes.
+   */
+  std::shared_ptr<BVHRefitCache> bvh_refit_cache = std::make_shared<BVHRefitCache>();
 
   SharedCache<std::optional<int>> max_material_index;
 
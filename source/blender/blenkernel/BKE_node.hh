@@ -339,6 +339,11 @@ struct bNodeType {
 
   /* Execute a geometry node. */
   NodeGeometryExecFunction geometry_node_execute = nullptr;
+  /**
+   * True when the outputs of #geometry_node_execute only depend on the node inputs and computing
+   * them is expensive enough that reusing outputs from previous evaluations is worth it.
+   */
+  bool geometry_node_supports_memoization = false;
 
   /**
    * Declares which sockets and panels the node has. It has to be able to generate a declaration
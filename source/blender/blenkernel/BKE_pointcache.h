@@ -30,6 +30,8 @@
 
 /* Add the blend-file name after `blendcache_`. */
 #define PTCACHE_EXT ".bphys"
+/** Extension of caches storing all frames in a single file, see #PTCACHE_COMPRESS_ZSTD. */
+#define PTCACHE_PACKED_EXT ".bphyspack"
 #define PTCACHE_PATH "blendcache_"
 
 /* File open options, for BKE_ptcache_file_open */
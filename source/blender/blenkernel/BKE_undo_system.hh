@@ -15,6 +15,7 @@
 #include "DNA_userdef_types.h"
 
 struct Main;
+struct TaskPool;
 struct UndoStep;
 struct UndoType;
 struct bContext;
@@ -69,6 +70,9 @@ struct UndoStack {
    * within which all but the last undo-step is marked for skipping.
    */
   int group_level;
+
+  /** Background tasks compressing steps far from the active one, created on demand. */
+  TaskPool *compress_task_pool;
 };
 
 struct UndoStep {
@@ -139,6 +143,20 @@ struct UndoType {
                               UndoTypeForEachIDRefFn foreach_ID_ref_fn,
                               void *user_data);
 
+  /**
+   * Optional, reduce the memory used by a step which is not expected to be decoded soon, by
+   * pushing compression tasks to the given pool. Decoding the step must still be possible at any
+   * time, decompressing the data on demand.
+   */
+  void (*step_compress)(UndoStep *us, TaskPool *task_pool);
+
+  /**
+   * Optional, the memory currently used by the step, counted against the undo memory limit.
+   * Needed when this changes after encoding (e.g. once compressed), otherwise
+   * #UndoStep.data_size is used.
+   */
+  size_t (*step_memory_size)(const UndoStep *us);
+
   /** Information for the generic undo system to refine handling of this specific undo type. */
   uint flags;
 
@@ -199,6 +217,13 @@ UndoStep *BKE_undosys_stack_init_or_active_with_type(UndoStack *ustack, const Un
 void BKE_undosys_stack_limit_steps_and_memory(UndoStack *ustack, int steps, size_t memory_limit);
 #define BKE_undosys_stack_limit_steps_and_memory_defaults(ustack) \
   BKE_undosys_stack_limit_steps_and_memory(ustack, U.undosteps, (size_t)U.undomemory * 1024 * 1024)
+/**
+ * Compress steps which are further than \a steps_uncompressed steps from the active one in
+ * background tasks, for undo types supporting it.
+ *
+ * \param steps_uncompressed: When zero or negative, nothing is compressed.
+ */
+void BKE_undosys_stack_compress_steps(UndoStack *ustack, int steps_uncompressed);
 
 void BKE_undosys_stack_group_begin(UndoStack *ustack);
 void BKE_undosys_stack_group_end(UndoStack *ustack);
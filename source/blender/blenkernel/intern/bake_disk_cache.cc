@@ -0,0 +1,451 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+/* For S_ISDIR() on Windows. */
+#ifdef WIN32
+#  include "BLI_winstuff.h"
+#endif
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_path_utils.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_bake_disk_cache.hh"
+#include "BKE_bake_items_serialize.hh"
+#include "BKE_instances.hh"
+
+#include <fmt/format.h>
+#include <xxhash.h>
+
+namespace blender::bke::bake::disk_cache {
+
+/**
+ * Layout of an entry file:
+ * - #entry_magic and #entry_format_version.
+ * - The meta data written by #serialize_bake.
+ * - The number of blobs, followed by the name and data of every blob.
+ * - A hash of everything above, to detect truncated or otherwise corrupted files.
+ *
+ * Strings are stored with their size in front. All numbers are stored in native byte order, the
+ * bake meta data contains the byte order of the blobs already.
+ */
+static constexpr char entry_magic[8] = {'B', 'G', 'N', 'C', 'A', 'C', 'H', 'E'};
+static constexpr uint32_t entry_format_version = 1;
+static constexpr const char *entry_extension = ".bgnc";
+static constexpr const char *temp_extension = ".tmp";
+/** Temporary files older than this were left behind by processes that did not finish writing. */
+static constexpr int64_t stale_temp_file_age_in_seconds = 60 * 60;
+/**
+ * Scanning the cache directory is expensive when it contains many entries, so the least recently
+ * used entries are only removed after every process wrote this fraction of the size limit.
+ */
+static constexpr int64_t size_limit_fraction_between_scans = 64;
+
+std::string CacheKey::to_string() const
+{
+  return fmt::format("{:016x}{:016x}", this->high, this->low);
+}
+
+CacheKeyBuilder::CacheKeyBuilder() : state_(XXH3_createState())
+{
+  XXH3_128bits_reset(static_cast<XXH3_state_t *>(state_));
+}
+
+CacheKeyBuilder::~CacheKeyBuilder()
+{
+  XXH3_freeState(static_cast<XXH3_state_t *>(state_));
+}
+
+void CacheKeyBuilder::add_bytes(const void *data, const int64_t size)
+{
+  XXH3_128bits_update(static_cast<XXH3_state_t *>(state_), data, size_t(size));
+}
+
+void CacheKeyBuilder::add_string(const StringRef str)
+{
+  this->add_value<int64_t>(str.size());
+  this->add_bytes(str.data(), str.size());
+}
+
+/**
+ * Feeds all data into the key instead of storing it. The returned slices are still unique, so
+ * the meta data is the same as when the data is written to the cache.
+ */
+class HashBlobWriter : public BlobWriter {
+ private:
+  CacheKeyBuilder &builder_;
+
+ public:
+  HashBlobWriter(CacheKeyBuilder &builder) : builder_(builder) {}
+
+  BlobSlice write(const void *data, const int64_t size) override
+  {
+    builder_.add_bytes(data, size);
+    const int64_t old_offset = total_written_size_;
+    total_written_size_ += size;
+    return {"hash", {old_offset, size}};
+  }
+};
+
+void CacheKeyBuilder::add_geometry(const GeometrySet &geometry)
+{
+  GeometrySet geometry_copy = geometry;
+  GeometryBakeItem::prepare_geometry_for_bake(geometry_copy, nullptr);
+  BakeState state;
+  state.items_by_id.add_new(0, std::make_unique<GeometryBakeItem>(std::move(geometry_copy)));
+
+  HashBlobWriter blob_writer{*this};
+  BlobWriteSharing blob_sharing;
+  std::ostringstream meta_stream{std::ios::binary};
+  serialize_bake(state, blob_writer, blob_sharing, meta_stream);
+  this->add_string(meta_stream.str());
+}
+
+CacheKey CacheKeyBuilder::finish() const
+{
+  const XXH128_hash_t hash = XXH3_128bits_digest(static_cast<XXH3_state_t *>(state_));
+  return {hash.low64, hash.high64};
+}
+
+bool geometry_supports_disk_cache(const GeometrySet &geometry)
+{
+  if (geometry.has(GeometryComponent::Type::Edit)) {
+    /* Edit hints are not serialized, but are required for e.g. sculpting on the result. */
+    return false;
+  }
+  if (const Instances *instances = geometry.get_instances()) {
+    for (const InstanceReference &reference : instances->references()) {
+      switch (reference.type()) {
+        case InstanceReference::Type::None:
+          break;
+        case InstanceReference::Type::GeometrySet:
+          if (!geometry_supports_disk_cache(reference.geometry_set())) {
+            return false;
+          }
+          break;
+        case InstanceReference::Type::Object:
+        case InstanceReference::Type::Collection:
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+static std::string entry_path(const StringRefNull cache_dir, const CacheKey &key)
+{
+  const std::string file_name = key.to_string() + entry_extension;
+  char path[FILE_MAX];
+  BLI_path_join(path, sizeof(path), cache_dir.c_str(), file_name.c_str());
+  return path;
+}
+
+/** Writes to a stream and hashes everything that is written. */
+class EntryWriter {
+ private:
+  std::ostream &stream_;
+  XXH3_state_t *state_;
+
+ public:
+  EntryWriter(std::ostream &stream) : stream_(stream), state_(XXH3_createState())
+  {
+    XXH3_64bits_reset(state_);
+  }
+
+  ~EntryWriter()
+  {
+    XXH3_freeState(state_);
+  }
+
+  void write_bytes(const void *data, const int64_t size)
+  {
+    stream_.write(static_cast<const char *>(data), size);
+    XXH3_64bits_update(state_, data, size_t(size));
+  }
+
+  template<typename T> void write_value(const T &value)
+  {
+    this->write_bytes(&value, sizeof(T));
+  }
+
+  void write_string(const StringRef str)
+  {
+    this->write_value<int64_t>(str.size());
+    this->write_bytes(str.data(), str.size());
+  }
+
+  void write_hash()
+  {
+    const uint64_t hash = XXH3_64bits_digest(state_);
+    stream_.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+  }
+};
+
+/** Reads from the buffer that contains the whole entry file. */
+class EntryReader {
+ private:
+  Span<std::byte> buffer_;
+  int64_t offset_ = 0;
+
+ public:
+  EntryReader(const Span<std::byte> buffer) : buffer_(buffer) {}
+
+  std::optional<Span<std::byte>> read_bytes(const int64_t size)
+  {
+    if (size < 0 || size > buffer_.size() - offset_) {
+      return std::nullopt;
+    }
+    const Span<std::byte> data = buffer_.slice(offset_, size);
+    offset_ += size;
+    return data;
+  }
+
+  template<typename T> std::optional<T> read_value()
+  {
+    const std::optional<Span<std::byte>> data = this->read_bytes(sizeof(T));
+    if (!data) {
+      return std::nullopt;
+    }
+    T value;
+    memcpy(&value, data->data(), sizeof(T));
+    return value;
+  }
+
+  std::optional<Span<std::byte>> read_string()
+  {
+    const std::optional<int64_t> size = this->read_value<int64_t>();
+    if (!size) {
+      return std::nullopt;
+    }
+    return this->read_bytes(*size);
+  }
+};
+
+static StringRef as_string(const Span<std::byte> data)
+{
+  return StringRef(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+static std::optional<BakeState> read_entry(const Span<std::byte> buffer)
+{
+  if (buffer.size() < int64_t(sizeof(entry_magic) + sizeof(uint64_t))) {
+    return std::nullopt;
+  }
+  const Span<std::byte> content = buffer.drop_back(sizeof(uint64_t));
+  uint64_t stored_hash;
+  memcpy(&stored_hash, buffer.take_back(sizeof(uint64_t)).data(), sizeof(uint64_t));
+  if (XXH3_64bits(content.data(), size_t(content.size())) != stored_hash) {
+    return std::nullopt;
+  }
+
+  EntryReader reader{content};
+  const std::optional<Span<std::byte>> magic = reader.read_bytes(sizeof(entry_magic));
+  if (memcmp(magic->data(), entry_magic, sizeof(entry_magic)) != 0) {
+    return std::nullopt;
+  }
+  if (reader.read_value<uint32_t>() != entry_format_version) {
+    return std::nullopt;
+  }
+  const std::optional<Span<std::byte>> meta = reader.read_string();
+  const std::optional<int64_t> blobs_num = reader.read_value<int64_t>();
+  if (!meta || !blobs_num) {
+    return std::nullopt;
+  }
+  MemoryBlobReader blob_reader;
+  for ([[maybe_unused]] const int64_t i : IndexRange(*blobs_num)) {
+    const std::optional<Span<std::byte>> name = reader.read_string();
+    const std::optional<Span<std::byte>> data = reader.read_string();
+    if (!name || !data) {
+      return std::nullopt;
+    }
+    blob_reader.add(as_string(*name), *data);
+  }
+
+  BlobReadSharing blob_sharing;
+  std::istringstream meta_stream{std::string(as_string(*meta)), std::ios::binary};
+  return deserialize_bake(meta_stream, blob_reader, blob_sharing);
+}
+
+/**
+ * Only changes the modification time, which is used to find the least recently used entries. The
+ * entry is not created again if another process removed it in the meantime.
+ */
+static void update_modification_time(const StringRefNull path)
+{
+  const std::filesystem::path fs_path(
+      std::u8string_view(reinterpret_cast<const char8_t *>(path.data()), path.size()));
+  std::error_code error;
+  std::filesystem::last_write_time(fs_path, std::filesystem::file_time_type::clock::now(), error);
+}
+
+std::optional<BakeState> read(const StringRefNull cache_dir, const CacheKey &key)
+{
+  const std::string path = entry_path(cache_dir, key);
+  /* The entry may be removed by another process at any time, so failing to read is expected. */
+  std::ifstream stream{path, std::ios::in | std::ios::binary | std::ios::ate};
+  if (!stream.is_open()) {
+    return std::nullopt;
+  }
+  const int64_t size = stream.tellg();
+  if (size <= 0) {
+    return std::nullopt;
+  }
+  Array<std::byte> buffer(size, NoInitialization());
+  stream.seekg(0);
+  stream.read(reinterpret_cast<char *>(buffer.data()), size);
+  if (stream.gcount() != size) {
+    return std::nullopt;
+  }
+  stream.close();
+
+  std::optional<BakeState> state = read_entry(buffer);
+  if (state) {
+    /* Mark the entry as recently used. */
+    update_modification_time(path);
+  }
+  return state;
+}
+
+static void remove_least_recently_used_entries(const StringRefNull cache_dir,
+                                               const int64_t size_limit)
+{
+  struct Entry {
+    std::string path;
+    int64_t size;
+    int64_t modification_time;
+  };
+  Vector<Entry> entries;
+  int64_t total_size = 0;
+  const int64_t current_time = int64_t(time(nullptr));
+
+  direntry *filelist;
+  const uint filelist_num = BLI_filelist_dir_contents(cache_dir.c_str(), &filelist);
+  for (const direntry &dir_entry : Span(filelist, filelist_num)) {
+    if (S_ISDIR(dir_entry.s.st_mode)) {
+      continue;
+    }
+    const StringRefNull name = dir_entry.relname;
+    if (name.endswith(temp_extension)) {
+      if (current_time - int64_t(dir_entry.s.st_mtime) > stale_temp_file_age_in_seconds) {
+        BLI_delete(dir_entry.path, false, false);
+      }
+      continue;
+    }
+    if (!name.endswith(entry_extension)) {
+      continue;
+    }
+    entries.append({dir_entry.path, int64_t(dir_entry.s.st_size), int64_t(dir_entry.s.st_mtime)});
+    total_size += int64_t(dir_entry.s.st_size);
+  }
+  BLI_filelist_free(filelist, filelist_num);
+
+  if (total_size <= size_limit) {
+    return;
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+    return a.modification_time < b.modification_time;
+  });
+  for (const Entry &entry : entries) {
+    if (total_size <= size_limit) {
+      break;
+    }
+    /* Other processes may remove the same entries at the same time, which is harmless. */
+    BLI_delete(entry.path.c_str(), false, false);
+    total_size -= entry.size;
+  }
+}
+
+/**
+ * Check whether the entries written since the last scan could have exceeded the size limit by a
+ * relevant amount. The first write of every process scans the directory, so that a lowered size
+ * limit and stale temporary files are handled.
+ */
+static bool remove_entries_is_due(const int64_t written_size, const int64_t size_limit)
+{
+  static std::mutex mutex;
+  static bool scanned = false;
+  static int64_t written_size_since_scan = 0;
+
+  std::scoped_lock lock(mutex);
+  written_size_since_scan += written_size;
+  const int64_t size_between_scans = std::max<int64_t>(
+      size_limit / size_limit_fraction_between_scans, 1);
+  if (scanned && written_size_since_scan < size_between_scans) {
+    return false;
+  }
+  scanned = true;
+  written_size_since_scan = 0;
+  return true;
+}
+
+void write(const StringRefNull cache_dir,
+           const CacheKey &key,
+           const BakeState &state,
+           const int64_t size_limit)
+{
+  if (!BLI_dir_create_recursive(cache_dir.c_str())) {
+    return;
+  }
+
+  MemoryBlobWriter blob_writer{"blob"};
+  BlobWriteSharing blob_sharing;
+  std::ostringstream meta_stream{std::ios::binary};
+  serialize_bake(state, blob_writer, blob_sharing, meta_stream);
+
+  const std::string path = entry_path(cache_dir, key);
+  /* Many processes may write the same entry at the same time, the temporary file has to be unique
+   * across all of them. */
+  std::random_device random_device;
+  const std::string temp_path = fmt::format(
+      "{}.{:08x}{:08x}{}", path, random_device(), random_device(), temp_extension);
+  int64_t written_size;
+  {
+    std::ofstream stream{temp_path, std::ios::out | std::ios::binary};
+    if (!stream.is_open()) {
+      return;
+    }
+    EntryWriter writer{stream};
+    writer.write_bytes(entry_magic, sizeof(entry_magic));
+    writer.write_value<uint32_t>(entry_format_version);
+    writer.write_string(meta_stream.str());
+    const Map<std::string, MemoryBlobWriter::OutputStream> &blob_streams =
+        blob_writer.get_stream_by_name();
+    writer.write_value<int64_t>(blob_streams.size());
+    for (const auto item : blob_streams.items()) {
+      writer.write_string(item.key);
+      writer.write_string(item.value.stream->str());
+    }
+    writer.write_hash();
+    written_size = int64_t(stream.tellp());
+    if (!stream.good()) {
+      stream.close();
+      BLI_delete(temp_path.c_str(), false, false);
+      return;
+    }
+  }
+  if (BLI_rename_overwrite(temp_path.c_str(), path.c_str()) != 0) {
+    BLI_delete(temp_path.c_str(), false, false);
+    return;
+  }
+
+  if (remove_entries_is_due(written_size, size_limit)) {
+    remove_least_recently_used_entries(cache_dir, size_limit);
+  }
+}
+
+}  // namespace blender::bke::bake::disk_cache
@@ -0,0 +1,166 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "BLI_fileops.h"
+#include "BLI_path_utils.hh"
+#include "BLI_tempfile.h"
+
+#include "BKE_bake_disk_cache.hh"
+
+namespace blender::bke::bake::disk_cache::tests {
+
+class BakeDiskCacheTest : public testing::Test {
+ public:
+  std::string cache_dir;
+
+  void SetUp() override
+  {
+    char temp_dir[FILE_MAX];
+    BLI_temp_directory_path_get(temp_dir, sizeof(temp_dir));
+    cache_dir = std::string(temp_dir) + SEP_STR + "blender_bake_disk_cache_test";
+    if (BLI_exists(cache_dir.c_str())) {
+      BLI_delete(cache_dir.c_str(), true, true);
+    }
+  }
+
+  void TearDown() override
+  {
+    if (BLI_exists(cache_dir.c_str())) {
+      BLI_delete(cache_dir.c_str(), true, true);
+    }
+  }
+
+  std::string entry_path(const CacheKey &key) const
+  {
+    return cache_dir + SEP_STR + key.to_string() + ".bgnc";
+  }
+
+  /** Make the entry look like it was last used the given number of hours ago. */
+  void set_entry_age(const CacheKey &key, const int hours) const
+  {
+    std::filesystem::last_write_time(entry_path(key),
+                                     std::filesystem::file_time_type::clock::now() -
+                                         std::chrono::hours(hours));
+  }
+};
+
+static CacheKey test_key(const uint64_t value)
+{
+  CacheKeyBuilder builder;
+  builder.add_value(value);
+  return builder.finish();
+}
+
+static BakeState test_state(const int value, const std::string &str)
+{
+  BakeState state;
+  state.items_by_id.add_new(0, std::make_unique<PrimitiveBakeItem>(CPPType::get<int>(), &value));
+  state.items_by_id.add_new(1, std::make_unique<StringBakeItem>(str));
+  return state;
+}
+
+static void expect_state(const std::optional<BakeState> &state,
+                         const int value,
+                         const std::string &str)
+{
+  ASSERT_TRUE(state.has_value());
+  const auto *primitive = dynamic_cast<const PrimitiveBakeItem *>(
+      state->items_by_id.lookup(0).get());
+  const auto *string = dynamic_cast<const StringBakeItem *>(state->items_by_id.lookup(1).get());
+  ASSERT_NE(primitive, nullptr);
+  ASSERT_NE(string, nullptr);
+  EXPECT_EQ(*static_cast<const int *>(primitive->value()), value);
+  EXPECT_EQ(string->value(), str);
+}
+
+TEST_F(BakeDiskCacheTest, KeyBuilder)
+{
+  EXPECT_EQ(test_key(1).to_string(), test_key(1).to_string());
+  EXPECT_NE(test_key(1).to_string(), test_key(2).to_string());
+  EXPECT_EQ(test_key(1).to_string().size(), 32);
+}
+
+TEST_F(BakeDiskCacheTest, WriteRead)
+{
+  const CacheKey key = test_key(1);
+  EXPECT_FALSE(read(cache_dir, key).has_value());
+
+  write(cache_dir, key, test_state(42, "cached"), int64_t(1) << 30);
+  expect_state(read(cache_dir, key), 42, "cached");
+
+  /* Writing the same key again replaces the entry. */
+  write(cache_dir, key, test_state(7, "replaced"), int64_t(1) << 30);
+  expect_state(read(cache_dir, key), 7, "replaced");
+}
+
+TEST_F(BakeDiskCacheTest, ReadMissingEntry)
+{
+  const CacheKey key = test_key(1);
+  write(cache_dir, key, test_state(42, "cached"), int64_t(1) << 30);
+  const CacheKey missing_key = test_key(2);
+  EXPECT_FALSE(read(cache_dir, missing_key).has_value());
+  /* Reading must not create an entry that does not exist. */
+  EXPECT_FALSE(BLI_exists(entry_path(missing_key).c_str()));
+}
+
+TEST_F(BakeDiskCacheTest, CorruptEntry)
+{
+  const CacheKey key = test_key(1);
+  write(cache_dir, key, test_state(42, "cached"), int64_t(1) << 30);
+  const std::string path = entry_path(key);
+  const int64_t size = BLI_file_size(path.c_str());
+  ASSERT_GT(size, 0);
+
+  {
+    /* Change a byte in the middle of the entry. */
+    std::fstream stream{path, std::ios::in | std::ios::out | std::ios::binary};
+    stream.seekg(size / 2);
+    const char c = char(stream.get());
+    stream.seekp(size / 2);
+    stream.put(char(~c));
+  }
+  EXPECT_FALSE(read(cache_dir, key).has_value());
+
+  write(cache_dir, key, test_state(42, "cached"), int64_t(1) << 30);
+  std::filesystem::resize_file(path, size - 1);
+  EXPECT_FALSE(read(cache_dir, key).has_value());
+
+  std::filesystem::resize_file(path, 0);
+  EXPECT_FALSE(read(cache_dir, key).has_value());
+}
+
+TEST_F(BakeDiskCacheTest, RemoveLeastRecentlyUsed)
+{
+  const std::string str(1000, 'x');
+  const CacheKey key_a = test_key(1);
+  const CacheKey key_b = test_key(2);
+  const CacheKey key_c = test_key(3);
+  const CacheKey key_d = test_key(4);
+
+  write(cache_dir, key_a, test_state(1, str), 1 << 20);
+  const int64_t entry_size = BLI_file_size(entry_path(key_a).c_str());
+  /* Three entries fit into the cache. */
+  const int64_t size_limit = entry_size * 7 / 2;
+  write(cache_dir, key_b, test_state(2, str), size_limit);
+  write(cache_dir, key_c, test_state(3, str), size_limit);
+  set_entry_age(key_a, 3);
+  set_entry_age(key_b, 2);
+  set_entry_age(key_c, 1);
+
+  /* Reading the oldest entry marks it as recently used. */
+  expect_state(read(cache_dir, key_a), 1, str);
+  write(cache_dir, key_d, test_state(4, str), size_limit);
+
+  EXPECT_TRUE(BLI_exists(entry_path(key_a).c_str()));
+  EXPECT_FALSE(BLI_exists(entry_path(key_b).c_str()));
+  EXPECT_TRUE(BLI_exists(entry_path(key_c).c_str()));
+  EXPECT_TRUE(BLI_exists(entry_path(key_d).c_str()));
+}
+
+}  // namespace blender::bke::bake::disk_cache::tests
@@ -38,8 +38,12 @@
 #include "BLO_undofile.hh"
 #include "BLO_writefile.hh"
 
+#include "CLG_log.h"
+
 #include "DEG_depsgraph.hh"
 
+static CLG_LogRef LOG = {"bke.undosys.memfile"};
+
 /* -------------------------------------------------------------------- */
 /** \name Global Undo
  * \{ */
@@ -131,6 +135,31 @@ MemFileUndoData *BKE_memfile_undo_encode(Main *bmain, MemFileUndoData *mfu_prev)
     }
     /* success = */ /* UNUSED */ BLO_write_file_mem(bmain, prevfile, &mfu->memfile, fileflags);
     mfu->undo_size = mfu->memfile.size;
+
+    if (CLOG_CHECK(&LOG, 1)) {
+      const MemFile &memfile = mfu->memfile;
+      const MemFileChunkStoreStats stats = BLO_memfile_chunk_store_stats();
+      CLOG_INFO(&LOG,
+                1,
+                "step size=%zu, stored=%zu, deduplicated=%zu; "
+                "history referenced=%zu, stored=%zu (ratio %.2f, saved %zu)",
+                memfile.size_total,
+                memfile.size,
+                memfile.size_deduplicated,
+                stats.size_referenced,
+                stats.size_stored,
+                stats.size_stored ? double(stats.size_referenced) / double(stats.size_stored) :
+                                    1.0,
+                stats.size_referenced - stats.size_stored);
+      CLOG_INFO(&LOG,
+                1,
+                "history compressed=%zu to %zu bytes, compress time=%.3fs (background), "
+                "decompress time=%.3fs (on demand)",
+                stats.size_stored_compressed,
+                stats.size_compressed,
+                stats.time_compress,
+                stats.time_decompress);
+    }
   }
 
   bmain->is_memfile_undo_written = true;
@@ -10,6 +10,7 @@
 #include "DNA_pointcloud_types.h"
 
 #include "BLI_math_geom.h"
+#include "BLI_task.hh"
 
 #include "BKE_attribute.hh"
 #include "BKE_bvhutils.hh"
@@ -637,6 +638,55 @@ static BitVector<> loose_edges_no_hidden_mask_get(const Mesh &mesh)
   return edge_mask;
 }
 
+/**
+ * How much the cost of a tree may increase when its bounds are updated for new positions, compared
+ * to the cost right after it was built. Above that, the queries become slow enough that building a
+ * new tree is worth it.
+ */
+static constexpr float max_refit_cost_factor = 1.5f;
+
+/**
+ * Create a tree for the current positions by copying the tree from the refit cache and updating
+ * the bounds of all leafs, or build a new tree if that isn't possible or the resulting tree would
+ * be too slow. Only used for the trees of all elements, where the leaf index is the element index.
+ */
+template<typename BuildFn, typename UpdateLeafFn>
+static std::shared_ptr<BVHTree> refit_or_build_tree(BVHRefitCache &refit_cache,
+                                                    BVHRefitCache::Item &item,
+                                                    const int leaf_num,
+                                                    const BuildFn &build_fn,
+                                                    const UpdateLeafFn &update_leaf_fn)
+{
+  std::shared_ptr<BVHTree> src_tree;
+  float built_cost;
+  {
+    std::lock_guard lock(refit_cache.mutex);
+    src_tree = item.tree;
+    built_cost = item.built_cost;
+  }
+  if (src_tree && BLI_bvhtree_get_len(src_tree.get()) == leaf_num) {
+    std::shared_ptr<BVHTree> tree(BLI_bvhtree_copy(src_tree.get()), BVHTreeDeleter());
+    threading::parallel_for(IndexRange(leaf_num), 2048, [&](const IndexRange range) {
+      for (const int i : range) {
+        update_leaf_fn(*tree, i);
+      }
+    });
+    BLI_bvhtree_update_tree(tree.get());
+    if (BLI_bvhtree_get_sah_cost(tree.get()) <= built_cost * max_refit_cost_factor) {
+      return tree;
+    }
+  }
+
+  std::shared_ptr<BVHTree> tree = build_fn();
+  if (tree) {
+    const float cost = BLI_bvhtree_get_sah_cost(tree.get());
+    std::lock_guard lock(refit_cache.mutex);
+    item.tree = tree;
+    item.built_cost = cost;
+  }
+  return tree;
+}
+
 }  // namespace blender::bke
 
 blender::bke::BVHTreeFromMesh Mesh::bvh_loose_verts() const
@@ -673,8 +723,18 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_verts() const
   using namespace blender;
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
-  this->runtime->bvh_cache_verts.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_verts(positions, positions.index_range());
+  this->runtime->bvh_cache_verts.ensure([&](std::shared_ptr<BVHTree> &data) {
+    BVHRefitCache &refit_cache = *this->runtime->bvh_refit_cache;
+    data = refit_or_build_tree(
+        refit_cache,
+        refit_cache.verts,
+        positions.size(),
+        [&]() -> std::shared_ptr<BVHTree> {
+          return create_tree_from_verts(positions, positions.index_range());
+        },
+        [&](BVHTree &tree, const int vert) {
+          BLI_bvhtree_update_node(&tree, vert, positions[vert], nullptr, 1);
+        });
   });
   return create_verts_tree_data(this->runtime->bvh_cache_verts.data().get(), positions);
 }
@@ -717,8 +777,22 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_edges() const
   using namespace blender::bke;
   const Span<float3> positions = this->vert_positions();
   const Span<int2> edges = this->edges();
-  this->runtime->bvh_cache_edges.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_edges(positions, edges, edges.index_range());
+  this->runtime->bvh_cache_edges.ensure([&](std::shared_ptr<BVHTree> &data) {
+    BVHRefitCache &refit_cache = *this->runtime->bvh_refit_cache;
+    data = refit_or_build_tree(
+        refit_cache,
+        refit_cache.edges,
+        edges.size(),
+        [&]() -> std::shared_ptr<BVHTree> {
+          return create_tree_from_edges(positions, edges, edges.index_range());
+        },
+        [&](BVHTree &tree, const int edge_i) {
+          const int2 &edge = edges[edge_i];
+          float co[2][3];
+          copy_v3_v3(co[0], positions[edge[0]]);
+          copy_v3_v3(co[1], positions[edge[1]]);
+          BLI_bvhtree_update_node(&tree, edge_i, co[0], nullptr, 2);
+        });
   });
   return create_edges_tree_data(this->runtime->bvh_cache_edges.data().get(), positions, edges);
 }
@@ -772,8 +846,22 @@ blender::bke::BVHTreeFromMesh Mesh::bvh_corner_tris() const
   const Span<float3> positions = this->vert_positions();
   const Span<int> corner_verts = this->corner_verts();
   const Span<int3> corner_tris = this->corner_tris();
-  this->runtime->bvh_cache_corner_tris.ensure([&](std::unique_ptr<BVHTree, BVHTreeDeleter> &data) {
-    data = create_tree_from_tris(positions, corner_verts, corner_tris);
+  this->runtime->bvh_cache_corner_tris.ensure([&](std::shared_ptr<BVHTree> &data) {
+    BVHRefitCache &refit_cache = *this->runtime->bvh_refit_cache;
+    data = refit_or_build_tree(
+        refit_cache,
+        refit_cache.corner_tris,
+        corner_tris.size(),
+        [&]() -> std::shared_ptr<BVHTree> {
+          return create_tree_from_tris(positions, corner_verts, corner_tris);
+        },
+        [&](BVHTree &tree, const int tri) {
+          float co[3][3];
+          copy_v3_v3(co[0], positions[corner_verts[corner_tris[tri][0]]]);
+          copy_v3_v3(co[1], positions[corner_verts[corner_tris[tri][1]]]);
+          copy_v3_v3(co[2], positions[corner_verts[corner_tris[tri][2]]]);
+          BLI_bvhtree_update_node(&tree, tri, co[0], nullptr, 3);
+        });
   });
   return create_tris_tree_data(
       this->runtime->bvh_cache_corner_tris.data().get(), positions, corner_verts, corner_tris);
@@ -1845,8 +1845,12 @@ void CurvesGeometry::blend_read(BlendDataReader &reader)
   CustomData_blend_read(&reader, &this->curve_data, this->curve_num);
 
   if (this->curve_offsets) {
-    this->runtime->curve_offsets_sharing_info = BLO_read_shared(
-        &reader, &this->curve_offsets, [&]() {
+    this->runtime->curve_offsets_sharing_info = BLO_read_shared_mapped(
+        &reader,
+        &this->curve_offsets,
+        sizeof(int) * (this->curve_num + 1),
+        alignof(int),
+        [&]() {
           BLO_read_int32_array(&reader, this->curve_num + 1, &this->curve_offsets);
           return implicit_sharing::info_for_mem_free(this->curve_offsets);
         });
@@ -1855,8 +1859,12 @@ void CurvesGeometry::blend_read(BlendDataReader &reader)
   BLO_read_struct_list(&reader, bDeformGroup, &this->vertex_group_names);
 
   if (this->custom_knot_num) {
-    this->runtime->custom_knots_sharing_info = BLO_read_shared(
-        &reader, &this->custom_knots, [&]() {
+    this->runtime->custom_knots_sharing_info = BLO_read_shared_mapped(
+        &reader,
+        &this->custom_knots,
+        sizeof(float) * this->custom_knot_num,
+        alignof(float),
+        [&]() {
           BLO_read_float_array(&reader, this->custom_knot_num, &this->custom_knots);
           return implicit_sharing::info_for_mem_free(this->custom_knots);
         });
@@ -5300,6 +5300,15 @@ static void blend_read_paint_mask(BlendDataReader *reader,
   }
 }
 
+/**
+ * Whether layers of this type are plain arrays that are stored in files as they are in memory,
+ * without pointers or versioning applied when reading.
+ */
+static bool layer_type_is_plain_data(const LayerTypeInfo &type_info)
+{
+  return type_info.copy == nullptr && type_info.free == nullptr && type_info.construct == nullptr;
+}
+
 static void blend_read_layer_data(BlendDataReader *reader, CustomDataLayer &layer, const int count)
 {
   switch (layer.type) {
@@ -5373,15 +5382,26 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, const int
     layer->sharing_info = nullptr;
 
     if (CustomData_verify_versions(data, i)) {
-      layer->sharing_info = BLO_read_shared(
-          reader, &layer->data, [&]() -> const ImplicitSharingInfo * {
-            blend_read_layer_data(reader, *layer, count);
-            if (layer->data == nullptr) {
-              return nullptr;
-            }
-            return make_implicit_sharing_info_for_layer(
-                eCustomDataType(layer->type), layer->data, count);
-          });
+      const auto read_fn = [&]() -> const ImplicitSharingInfo * {
+        blend_read_layer_data(reader, *layer, count);
+        if (layer->data == nullptr) {
+          return nullptr;
+        }
+        return make_implicit_sharing_info_for_layer(
+            eCustomDataType(layer->type), layer->data, count);
+      };
+      const LayerTypeInfo *typeInfo = layerType_getInfo(eCustomDataType(layer->type));
+      if (layer_type_is_plain_data(*typeInfo)) {
+        /* Trivial layers can be used from a memory mapped file directly. */
+        layer->sharing_info = BLO_read_shared_mapped(reader,
+                                                     &layer->data,
+                                                     int64_t(typeInfo->size) * count,
+                                                     typeInfo->alignment,
+                                                     read_fn);
+      }
+      else {
+        layer->sharing_info = BLO_read_shared(reader, &layer->data, read_fn);
+      }
       i++;
     }
   }
@@ -160,6 +160,9 @@ void BKE_main_clear(Main &bmain)
   /* NOTE: `name_map` in libraries are freed together with the library IDs above. */
   BKE_main_namemap_destroy(&bmain.name_map);
   BKE_main_namemap_destroy(&bmain.name_map_global);
+
+  MEM_delete(bmain.incremental_save_state);
+  bmain.incremental_save_state = nullptr;
 }
 
 void BKE_main_destroy(Main &bmain)
@@ -166,6 +166,7 @@ static void mesh_copy_data(Main *bmain,
   mesh_dst->runtime->bvh_cache_loose_edges = mesh_src->runtime->bvh_cache_loose_edges;
   mesh_dst->runtime->bvh_cache_loose_edges_no_hidden =
       mesh_src->runtime->bvh_cache_loose_edges_no_hidden;
+  mesh_dst->runtime->bvh_refit_cache = mesh_src->runtime->bvh_refit_cache;
   mesh_dst->runtime->max_material_index = mesh_src->runtime->max_material_index;
   if (mesh_src->runtime->bake_materials) {
     mesh_dst->runtime->bake_materials = std::make_unique<blender::bke::bake::BakeMaterialsList>(
@@ -434,8 +435,12 @@ static void mesh_blend_read_data(BlendDataReader *reader, ID *id)
   mesh->runtime = new blender::bke::MeshRuntime();
 
   if (mesh->face_offset_indices) {
-    mesh->runtime->face_offsets_sharing_info = BLO_read_shared(
-        reader, &mesh->face_offset_indices, [&]() {
+    mesh->runtime->face_offsets_sharing_info = BLO_read_shared_mapped(
+        reader,
+        &mesh->face_offset_indices,
+        sizeof(int) * (mesh->faces_num + 1),
+        alignof(int),
+        [&]() {
           BLO_read_int32_array(reader, mesh->faces_num + 1, &mesh->face_offset_indices);
           return blender::implicit_sharing::info_for_mem_free(mesh->face_offset_indices);
         });
@@ -10,6 +10,7 @@
  * \see `bmesh_mesh_normals.cc` for the equivalent #BMesh functionality.
  */
 
+#include <array>
 #include <climits>
 
 #include "MEM_guardedalloc.h"
@@ -17,6 +18,7 @@
 #include "BLI_math_geom.h"
 #include "BLI_math_vector.h"
 
+#include "BLI_array.hh"
 #include "BLI_array_utils.hh"
 #include "BLI_bit_vector.hh"
 #include "BLI_linklist.h"
@@ -181,6 +183,115 @@ float3 face_normal_calc(const Span<float3> vert_positions, const Span<int> face_
  * meshes can slow down high-poly meshes. For details on performance, see D11993.
  * \{ */
 
+/** Number of faces whose normals are computed together by the batched kernels. */
+static constexpr int face_batch_size = 16;
+
+/**
+ * Newell's method for a batch of faces with the same number of corners, with the same operations
+ * as #normal_calc_ngon. The positions are gathered into an array per corner and component first,
+ * so that the computation can be vectorized across the faces of the batch.
+ */
+template<int CornersNum>
+static void normals_calc_faces_batch(const Span<float3> positions,
+                                     const Span<int> corner_verts,
+                                     const std::array<int, face_batch_size> &face_starts,
+                                     std::array<float3, face_batch_size> &r_normals)
+{
+  float x[CornersNum][face_batch_size];
+  float y[CornersNum][face_batch_size];
+  float z[CornersNum][face_batch_size];
+  for (int i = 0; i < face_batch_size; i++) {
+    for (int corner = 0; corner < CornersNum; corner++) {
+      const float3 &position = positions[corner_verts[face_starts[i] + corner]];
+      x[corner][i] = position.x;
+      y[corner][i] = position.y;
+      z[corner][i] = position.z;
+    }
+  }
+
+  float nx[face_batch_size] = {};
+  float ny[face_batch_size] = {};
+  float nz[face_batch_size] = {};
+  for (int corner = 0; corner < CornersNum; corner++) {
+    const int prev = (corner + CornersNum - 1) % CornersNum;
+    for (int i = 0; i < face_batch_size; i++) {
+      nx[i] += (y[prev][i] - y[corner][i]) * (z[prev][i] + z[corner][i]);
+      ny[i] += (z[prev][i] - z[corner][i]) * (x[prev][i] + x[corner][i]);
+      nz[i] += (x[prev][i] - x[corner][i]) * (y[prev][i] + y[corner][i]);
+    }
+  }
+
+  for (int i = 0; i < face_batch_size; i++) {
+    const float length_squared = nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i];
+    /* Same threshold as #normalize_v3, degenerate faces get the Z axis as normal. */
+    const bool is_valid = length_squared > 1.0e-35f;
+    const float scale = is_valid ? 1.0f / std::sqrt(length_squared) : 0.0f;
+    r_normals[i] = float3(nx[i] * scale, ny[i] * scale, is_valid ? nz[i] * scale : 1.0f);
+  }
+}
+
+template<int CornersNum>
+static void normals_calc_faces_uniform(const Span<float3> positions,
+                                       const OffsetIndices<int> faces,
+                                       const Span<int> corner_verts,
+                                       const IndexRange range,
+                                       MutableSpan<float3> face_normals)
+{
+  std::array<int, face_batch_size> face_starts;
+  std::array<float3, face_batch_size> normals;
+  int face = range.start();
+  for (; face + face_batch_size <= range.one_after_last(); face += face_batch_size) {
+    const int first_corner = faces[face].start();
+    for (int i = 0; i < face_batch_size; i++) {
+      face_starts[i] = first_corner + i * CornersNum;
+    }
+    normals_calc_faces_batch<CornersNum>(positions, corner_verts, face_starts, normals);
+    face_normals.slice(face, face_batch_size).copy_from(normals);
+  }
+  for (; face < range.one_after_last(); face++) {
+    face_normals[face] = normal_calc_ngon(positions, corner_verts.slice(faces[face]));
+  }
+}
+
+/**
+ * Split the range into runs of faces with the same size, to use the batched computation for runs
+ * of triangles and quads. Meshes often consist of triangles or quads only, then the whole range
+ * is a single run.
+ */
+static void normals_calc_faces_runs(const Span<float3> positions,
+                                     const OffsetIndices<int> faces,
+                                     const Span<int> corner_verts,
+                                     const IndexRange range,
+                                     MutableSpan<float3> face_normals)
+{
+  const Span<int> offsets = faces.data();
+  int run_start = range.start();
+  while (run_start < range.one_after_last()) {
+    const int face_size = offsets[run_start + 1] - offsets[run_start];
+    int run_end = run_start + 1;
+    while (run_end < range.one_after_last() &&
+           offsets[run_end + 1] - offsets[run_end] == face_size)
+    {
+      run_end++;
+    }
+    const IndexRange run = IndexRange::from_begin_end(run_start, run_end);
+    switch (face_size) {
+      case 3:
+        normals_calc_faces_uniform<3>(positions, faces, corner_verts, run, face_normals);
+        break;
+      case 4:
+        normals_calc_faces_uniform<4>(positions, faces, corner_verts, run, face_normals);
+        break;
+      default:
+        for (const int face : run) {
+          face_normals[face] = normal_calc_ngon(positions, corner_verts.slice(faces[face]));
+        }
+        break;
+    }
+    run_start = run_end;
+  }
+}
+
 void normals_calc_faces(const Span<float3> positions,
                         const OffsetIndices<int> faces,
                         const Span<int> corner_verts,
@@ -188,9 +299,7 @@ void normals_calc_faces(const Span<float3> positions,
 {
   BLI_assert(faces.size() == face_normals.size());
   threading::parallel_for(faces.index_range(), 1024, [&](const IndexRange range) {
-    for (const int i : range) {
-      face_normals[i] = normal_calc_ngon(positions, corner_verts.slice(faces[i]));
-    }
+    normals_calc_faces_runs(positions, faces, corner_verts, range, face_normals);
   });
 }
 
@@ -225,6 +334,63 @@ void normals_calc_verts(const Span<float3> vert_positions,
   });
 }
 
+/**
+ * The angle between the two edges of every face corner, used to weight the face normals when
+ * computing vertex normals. Each edge direction is computed once per face and shared by the two
+ * corners using it.
+ */
+static void corner_angles_calc(const Span<float3> positions,
+                               const OffsetIndices<int> faces,
+                               const Span<int> corner_verts,
+                               MutableSpan<float> corner_angles)
+{
+  threading::parallel_for(faces.index_range(), 1024, [&](const IndexRange range) {
+    for (const int face_index : range) {
+      const IndexRange face = faces[face_index];
+      float3 dir_prev = math::normalize(positions[corner_verts[face.first()]] -
+                                        positions[corner_verts[face.last()]]);
+      for (const int corner : face) {
+        const int corner_next = face_corner_next(face, corner);
+        const float3 dir_next = math::normalize(positions[corner_verts[corner_next]] -
+                                                positions[corner_verts[corner]]);
+        /* The direction to the previous vertex is the negated direction of the previous edge. */
+        corner_angles[corner] = math::safe_acos_approx(-math::dot(dir_prev, dir_next));
+        dir_prev = dir_next;
+      }
+    }
+  });
+}
+
+void normals_calc_verts_from_corners(const Span<float3> vert_positions,
+                                     const OffsetIndices<int> faces,
+                                     const Span<int> corner_verts,
+                                     const GroupedSpan<int> vert_to_corner_map,
+                                     const Span<int> corner_to_face_map,
+                                     const Span<float3> face_normals,
+                                     MutableSpan<float3> vert_normals)
+{
+  const Span<float3> positions = vert_positions;
+  Array<float> corner_angles(corner_verts.size());
+  corner_angles_calc(positions, faces, corner_verts, corner_angles);
+
+  threading::parallel_for(positions.index_range(), 1024, [&](const IndexRange range) {
+    for (const int vert : range) {
+      const Span<int> vert_corners = vert_to_corner_map[vert];
+      if (vert_corners.is_empty()) {
+        vert_normals[vert] = math::normalize(positions[vert]);
+        continue;
+      }
+
+      float3 vert_normal(0);
+      for (const int corner : vert_corners) {
+        vert_normal += face_normals[corner_to_face_map[corner]] * corner_angles[corner];
+      }
+
+      vert_normals[vert] = math::normalize(vert_normal);
+    }
+  });
+}
+
 /** \} */
 
 static void mix_normals_corner_to_vert(const Span<float3> vert_positions,
@@ -394,12 +560,13 @@ blender::Span<blender::float3> Mesh::vert_normals_true() const
   using namespace blender::bke;
   this->runtime->vert_normals_true_cache.ensure([&](Vector<float3> &r_data) {
     r_data.reinitialize(this->verts_num);
-    mesh::normals_calc_verts(this->vert_positions(),
-                             this->faces(),
-                             this->corner_verts(),
-                             this->vert_to_face_map(),
-                             this->face_normals(),
-                             r_data);
+    mesh::normals_calc_verts_from_corners(this->vert_positions(),
+                                          this->faces(),
+                                          this->corner_verts(),
+                                          this->vert_to_corner_map(),
+                                          this->corner_to_face_map(),
+                                          this->face_normals(),
+                                          r_data);
   });
   return this->runtime->vert_normals_true_cache.data();
 }
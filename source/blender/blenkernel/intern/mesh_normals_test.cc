@@ -0,0 +1,233 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <iostream>
+
+#include "BLI_array.hh"
+#include "BLI_math_vector.hh"
+#include "BLI_offset_indices.hh"
+#include "BLI_rand.hh"
+#include "BLI_timeit.hh"
+
+#include "BKE_mesh.hh"
+#include "BKE_mesh_mapping.hh"
+
+#define DO_PERF_TESTS 0
+
+namespace blender::bke::tests {
+
+struct TestMesh {
+  Array<float3> positions;
+  Array<int> face_offsets;
+  Array<int> corner_verts;
+
+  OffsetIndices<int> faces() const
+  {
+    return face_offsets.as_span();
+  }
+};
+
+/**
+ * A grid of faces with randomly displaced vertices. Every quad of the grid is split into two
+ * triangles when \a triangulate is true, and every \a ngon_interval quad is merged with its
+ * neighbor into a hexagon otherwise.
+ */
+static TestMesh test_mesh_grid_create(const int size,
+                                      const bool triangulate,
+                                      const int ngon_interval = 0)
+{
+  RandomNumberGenerator rng(0);
+  TestMesh mesh;
+  mesh.positions.reinitialize(size * size);
+  for (const int y : IndexRange(size)) {
+    for (const int x : IndexRange(size)) {
+      mesh.positions[y * size + x] = float3(x, y, rng.get_float() - 0.5f);
+    }
+  }
+
+  Vector<int> offsets = {0};
+  Vector<int> corner_verts;
+  for (const int y : IndexRange(size - 1)) {
+    for (int x = 0; x < size - 1; x++) {
+      const int v0 = y * size + x;
+      const int v1 = v0 + 1;
+      const int v2 = v1 + size;
+      const int v3 = v0 + size;
+      if (triangulate) {
+        corner_verts.extend({v0, v1, v2});
+        offsets.append(corner_verts.size());
+        corner_verts.extend({v0, v2, v3});
+      }
+      else if (ngon_interval > 0 && x % ngon_interval == 0 && x + 2 < size) {
+        corner_verts.extend({v0, v1, v1 + 1, v2 + 1, v2, v3});
+        x++;
+      }
+      else {
+        corner_verts.extend({v0, v1, v2, v3});
+      }
+      offsets.append(corner_verts.size());
+    }
+  }
+  mesh.face_offsets = offsets.as_span();
+  mesh.corner_verts = corner_verts.as_span();
+  return mesh;
+}
+
+static void test_face_normals_match_generic(const TestMesh &mesh)
+{
+  const OffsetIndices<int> faces = mesh.faces();
+  Array<float3> face_normals(faces.size());
+  mesh::normals_calc_faces(mesh.positions, faces, mesh.corner_verts, face_normals);
+  for (const int face : faces.index_range()) {
+    const float3 expected = mesh::face_normal_calc(mesh.positions,
+                                                   mesh.corner_verts.as_span().slice(faces[face]));
+    EXPECT_V3_NEAR(face_normals[face], expected, 1e-5f);
+  }
+}
+
+TEST(mesh_normals, FacesQuads)
+{
+  test_face_normals_match_generic(test_mesh_grid_create(40, false));
+}
+
+TEST(mesh_normals, FacesTriangles)
+{
+  test_face_normals_match_generic(test_mesh_grid_create(40, true));
+}
+
+TEST(mesh_normals, FacesMixed)
+{
+  test_face_normals_match_generic(test_mesh_grid_create(40, false, 7));
+}
+
+TEST(mesh_normals, FacesDegenerate)
+{
+  /* Enough faces to use the batched kernel. */
+  TestMesh mesh;
+  mesh.positions = {float3(0, 0, 0), float3(1, 0, 0), float3(2, 0, 0), float3(3, 0, 0)};
+  mesh.face_offsets.reinitialize(33);
+  offset_indices::fill_constant_group_size(4, 0, mesh.face_offsets);
+  mesh.corner_verts.reinitialize(32 * 4);
+  for (const int face : IndexRange(32)) {
+    mesh.corner_verts.as_mutable_span().slice(face * 4, 4).copy_from({0, 1, 2, 3});
+  }
+
+  Array<float3> face_normals(32);
+  mesh::normals_calc_faces(mesh.positions, mesh.faces(), mesh.corner_verts, face_normals);
+  for (const float3 &normal : face_normals) {
+    EXPECT_EQ(normal, float3(0, 0, 1));
+  }
+}
+
+TEST(mesh_normals, VertsFromCorners)
+{
+  const TestMesh mesh = test_mesh_grid_create(30, false, 5);
+  const OffsetIndices<int> faces = mesh.faces();
+  const int verts_num = mesh.positions.size();
+
+  Array<float3> face_normals(faces.size());
+  mesh::normals_calc_faces(mesh.positions, faces, mesh.corner_verts, face_normals);
+
+  Array<int> vert_to_face_offsets;
+  Array<int> vert_to_face_indices;
+  const GroupedSpan<int> vert_to_face_map = mesh::build_vert_to_face_map(
+      faces, mesh.corner_verts, verts_num, vert_to_face_offsets, vert_to_face_indices);
+  Array<float3> expected(verts_num);
+  mesh::normals_calc_verts(
+      mesh.positions, faces, mesh.corner_verts, vert_to_face_map, face_normals, expected);
+
+  Array<int> vert_to_corner_offsets;
+  Array<int> vert_to_corner_indices;
+  const GroupedSpan<int> vert_to_corner_map = mesh::build_vert_to_corner_map(
+      mesh.corner_verts, verts_num, vert_to_corner_offsets, vert_to_corner_indices);
+  const Array<int> corner_to_face_map = mesh::build_corner_to_face_map(faces);
+  Array<float3> vert_normals(verts_num);
+  mesh::normals_calc_verts_from_corners(mesh.positions,
+                                        faces,
+                                        mesh.corner_verts,
+                                        vert_to_corner_map,
+                                        corner_to_face_map,
+                                        face_normals,
+                                        vert_normals);
+
+  for (const int vert : IndexRange(verts_num)) {
+    EXPECT_V3_NEAR(vert_normals[vert], expected[vert], 1e-6f);
+  }
+}
+
+#if DO_PERF_TESTS
+
+static void test_normals_performance(const char *name, const TestMesh &mesh)
+{
+  const OffsetIndices<int> faces = mesh.faces();
+  const int verts_num = mesh.positions.size();
+  const double millions_of_faces = double(faces.size()) / 1e6;
+  constexpr int iterations = 10;
+
+  Array<int> vert_to_face_offsets;
+  Array<int> vert_to_face_indices;
+  const GroupedSpan<int> vert_to_face_map = mesh::build_vert_to_face_map(
+      faces, mesh.corner_verts, verts_num, vert_to_face_offsets, vert_to_face_indices);
+  Array<int> vert_to_corner_offsets;
+  Array<int> vert_to_corner_indices;
+  const GroupedSpan<int> vert_to_corner_map = mesh::build_vert_to_corner_map(
+      mesh.corner_verts, verts_num, vert_to_corner_offsets, vert_to_corner_indices);
+  const Array<int> corner_to_face_map = mesh::build_corner_to_face_map(faces);
+
+  Array<float3> face_normals(faces.size());
+  Array<float3> vert_normals(verts_num);
+
+  const auto report = [&](const char *kernel, const timeit::TimePoint start) {
+    const timeit::Nanoseconds duration = (timeit::Clock::now() - start) / iterations;
+    const double ms = double(duration.count()) / 1e6;
+    std::cout << name << " " << kernel << ": " << ms / millions_of_faces
+              << " ms per million faces\n";
+  };
+
+  timeit::TimePoint start = timeit::Clock::now();
+  for ([[maybe_unused]] const int i : IndexRange(iterations)) {
+    mesh::normals_calc_faces(mesh.positions, faces, mesh.corner_verts, face_normals);
+  }
+  report("faces", start);
+
+  start = timeit::Clock::now();
+  for ([[maybe_unused]] const int i : IndexRange(iterations)) {
+    mesh::normals_calc_verts(
+        mesh.positions, faces, mesh.corner_verts, vert_to_face_map, face_normals, vert_normals);
+  }
+  report("verts (vert to face map)", start);
+
+  start = timeit::Clock::now();
+  for ([[maybe_unused]] const int i : IndexRange(iterations)) {
+    mesh::normals_calc_verts_from_corners(mesh.positions,
+                                          faces,
+                                          mesh.corner_verts,
+                                          vert_to_corner_map,
+                                          corner_to_face_map,
+                                          face_normals,
+                                          vert_normals);
+  }
+  report("verts (vert to corner map)", start);
+}
+
+TEST(mesh_normals, performance_quads_4000000)
+{
+  test_normals_performance("quads", test_mesh_grid_create(2001, false));
+}
+
+TEST(mesh_normals, performance_triangles_8000000)
+{
+  test_normals_performance("triangles", test_mesh_grid_create(2001, true));
+}
+
+TEST(mesh_normals, performance_mixed_4000000)
+{
+  test_normals_performance("mixed", test_mesh_grid_create(2001, false, 9));
+}
+
+#endif
+
+}  // namespace blender::bke::tests
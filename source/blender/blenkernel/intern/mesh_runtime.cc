@@ -314,6 +314,7 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
 {
   /* Tagging shared caches dirty will free the allocated data if there is only one user. */
   free_bvh_caches(*mesh->runtime);
+  mesh->runtime->bvh_refit_cache = std::make_shared<blender::bke::BVHRefitCache>();
   mesh->runtime->subdiv_ccg.reset();
   mesh->runtime->bounds_cache.tag_dirty();
   mesh->runtime->vert_to_face_offset_cache.tag_dirty();
@@ -341,6 +342,7 @@ void Mesh::tag_edges_split()
 {
   /* Triangulation didn't change because vertex positions and loop vertex indices didn't change. */
   free_bvh_caches(*this->runtime);
+  this->runtime->bvh_refit_cache = std::make_shared<blender::bke::BVHRefitCache>();
   this->runtime->vert_normals_cache.tag_dirty();
   this->runtime->corner_normals_cache.tag_dirty();
   this->runtime->subdiv_ccg.reset();
@@ -68,6 +68,7 @@
 /* end */
 
 #include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_debug.hh"
 #include "DEG_depsgraph_query.hh"
 
 #include "MOD_modifiertypes.hh"
@@ -899,6 +900,7 @@ static void ensure_non_lazy_normals(Mesh *mesh)
 Mesh *BKE_modifier_modify_mesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *mesh)
 {
   const ModifierTypeInfo *mti = BKE_modifier_get_info(ModifierType(md->type));
+  blender::deg::TraceScope trace_scope("modifier", mti->name, md->name);
 
   if (mesh->runtime->wrapper_type == ME_WRAPPER_TYPE_BMESH) {
     if ((mti->flags & eModifierTypeFlag_AcceptsBMesh) == 0) {
@@ -916,6 +918,7 @@ bool BKE_modifier_deform_verts(ModifierData *md,
 {
   using namespace blender::bke;
   const ModifierTypeInfo *mti = BKE_modifier_get_info(ModifierType(md->type));
+  blender::deg::TraceScope trace_scope("modifier", mti->name, md->name);
 
   if (mti->deform_verts) {
     mti->deform_verts(md, ctx, mesh, positions);
@@ -965,6 +968,7 @@ void BKE_modifier_deform_vertsEM(ModifierData *md,
                                  blender::MutableSpan<blender::float3> positions)
 {
   const ModifierTypeInfo *mti = BKE_modifier_get_info(ModifierType(md->type));
+  blender::deg::TraceScope trace_scope("modifier", mti->name, md->name);
   if (mesh && mti->depends_on_normals && mti->depends_on_normals(md)) {
     ensure_non_lazy_normals(mesh);
   }
@@ -988,7 +988,7 @@ void BKE_packedfile_blend_read(BlendDataReader *reader, PackedFile **pf_p, Strin
     return;
   }
   /* NOTE: there is no way to handle endianness switch here. */
-  pf->sharing_info = BLO_read_shared(reader, &pf->data, [&]() {
+  pf->sharing_info = BLO_read_shared_mapped(reader, &pf->data, pf->size, 1, [&]() {
     BLO_read_data_address(reader, &pf->data);
     /* Do not create an implicit sharing if read data pointer is `nullptr`. */
     return pf->data ? blender::implicit_sharing::info_for_mem_free(const_cast<void *>(pf->data)) :
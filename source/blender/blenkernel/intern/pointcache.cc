@@ -7,17 +7,27 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <zstd.h>
+
 /* needed for directory lookup */
 #ifndef WIN32
 #  include <dirent.h>
+#  include <unistd.h>
 #else
 #  include "BLI_winstuff.h"
+#  include <io.h>
 #endif
 
 #include "CLG_log.h"
@@ -35,14 +45,20 @@
 #include "DNA_scene_types.h"
 #include "DNA_space_types.h"
 
+#include "BLI_array.hh"
 #include "BLI_fileops.h"
+#include "BLI_function_ref.hh"
 #include "BLI_listbase.h"
 #include "BLI_math_rotation.h"
 #include "BLI_math_vector.h"
+#include "BLI_mmap.h"
 #include "BLI_path_utils.hh"
+#include "BLI_set.hh"
 #include "BLI_string.h"
+#include "BLI_task.hh"
 #include "BLI_time.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "BLT_translation.hh"
 
@@ -1271,12 +1287,23 @@ bool BKE_ptcache_object_has(Scene *scene, Object *ob, int duplis)
 
 /* File handling */
 
+/**
+ * Whether all frames are stored in a single file, only supported by caches using the generic
+ * point data (not the streams used by smoke and dynamic paint).
+ */
+static bool ptcache_use_packed(const PTCacheID *pid)
+{
+  return pid->cache->compression == PTCACHE_COMPRESS_ZSTD &&
+         pid->file_type == PTCACHE_FILE_PTCACHE && pid->write_stream == nullptr &&
+         (pid->cache->flag & PTCACHE_EXTERNAL) == 0;
+}
+
 static const char *ptcache_file_extension(const PTCacheID *pid)
 {
   switch (pid->file_type) {
     default:
     case PTCACHE_FILE_PTCACHE:
-      return PTCACHE_EXT;
+      return ptcache_use_packed(pid) ? PTCACHE_PACKED_EXT : PTCACHE_EXT;
   }
 }
 
@@ -1933,8 +1960,851 @@ static void ptcache_find_frames_around(PTCacheID *pid, uint frame, int *r_fra1,
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Packed Disk Cache
+ *
+ * Used with #PTCACHE_COMPRESS_ZSTD, instead of one file per frame all frames of a cache are
+ * stored in a single file:
+ *
+ * - A #PackedFileHeader at the start of the file, pointing to the last #PackedRecord.
+ * - For every frame, each point data type and extra data is a separate stream of independently
+ *   compressed Zstd frames (blocks), so reading can skip streams and blocks are (de)compressed in
+ *   parallel. The blocks are followed by the #PackedFrameHeader, its #PackedStream and
+ *   #PackedBlock tables and a #PackedRecord.
+ * - Removing frames appends a #PackedRecord for each of them.
+ *
+ * The records are linked from the last one to the first one, the latest record of a frame decides
+ * whether the frame exists. Changes are only appended after the data referenced by the header,
+ * which is written last. So writing a frame costs the same for every frame, and a file that was
+ * not written completely still contains its previous state. Once most of the file is taken by
+ * removed or replaced frames, the remaining frames are copied to a new file that replaces it.
+ *
+ * Reading memory maps the file and decompresses only the requested frame. The frame index built
+ * from the records and the mapping are kept in #PointCache.packed_file until the file changes or
+ * the cache is freed.
+ * \{ */
+
+static const char ptcache_packed_magic[8] = {'B', 'P', 'H', 'Y', 'S', 'P', 'A', 'K'};
+#define PTCACHE_PACKED_VERSION 2
+/** Uncompressed size of the blocks streams are split into. */
+#define PTCACHE_PACKED_BLOCK_SIZE (1 << 20)
+#define PTCACHE_PACKED_COMPRESSION_LEVEL 3
+
+struct PackedFileHeader {
+  char magic[8];
+  uint32_t version;
+  /** #PTCACHE_TYPE_SOFTBODY etc. */
+  uint32_t type;
+  /** End of the data in use, new records are appended there. */
+  uint64_t data_end;
+  /** File offset of the last #PackedRecord, zero when there is none. */
+  uint64_t last_record;
+  /** Size of the frames that are neither removed nor replaced by a newer version. */
+  uint64_t live_size;
+};
+
+enum PackedRecordKind : uint32_t {
+  PTCACHE_PACKED_RECORD_FRAME = 0,
+  PTCACHE_PACKED_RECORD_REMOVE = 1,
+};
+
+struct PackedRecord {
+  /** #PackedRecordKind. */
+  uint32_t kind;
+  int32_t frame;
+  /** Size of the #PackedFrameHeader and its tables. */
+  uint32_t table_size;
+  uint32_t _pad;
+  /** File offset of the first block of the frame. */
+  uint64_t data_offset;
+  /** File offset of the #PackedFrameHeader. */
+  uint64_t table_offset;
+  /** File offset of the previous record, zero for the first one. */
+  uint64_t prev_record;
+};
+
+/** Frame index entry, built from the records when reading the file. */
+struct PackedIndexEntry {
+  int32_t frame;
+  /** Size of the #PackedFrameHeader and its tables. */
+  uint32_t table_size;
+  /** File offset of the #PackedFrameHeader. */
+  uint64_t offset;
+  /** Size of all data of the frame, including its record. */
+  uint64_t size;
+};
+
+struct PackedFrameHeader {
+  int32_t frame;
+  uint32_t totpoint;
+  uint32_t data_types;
+  uint32_t streams_num;
+  uint32_t blocks_num;
+  uint32_t _pad;
+};
+
+enum PackedStreamKind : uint32_t {
+  PTCACHE_PACKED_STREAM_DATA = 0,
+  PTCACHE_PACKED_STREAM_EXTRA = 1,
+};
+
+struct PackedStream {
+  /** #PackedStreamKind. */
+  uint32_t kind;
+  /** #BPHYS_DATA_INDEX etc. for point data, the #PTCacheExtra type for extra data. */
+  uint32_t type;
+  /** Number of elements. */
+  uint32_t totdata;
+  uint32_t blocks_start;
+  uint32_t blocks_num;
+  uint32_t _pad;
+};
+
+struct PackedBlock {
+  uint64_t offset;
+  uint64_t size_compressed;
+  uint64_t size;
+};
+
+static size_t ptcache_packed_stream_elem_size(const PackedStream &stream)
+{
+  if (stream.kind == PTCACHE_PACKED_STREAM_DATA) {
+    return stream.type < BPHYS_TOT_DATA ? ptcache_data_size[stream.type] : 0;
+  }
+  return stream.type < ARRAY_SIZE(ptcache_extra_datasize) ? ptcache_extra_datasize[stream.type] :
+                                                            0;
+}
+
+static int ptcache_packed_filepath(PTCacheID *pid, char filepath[MAX_PTCACHE_FILE])
+{
+  const int len = ptcache_filepath(pid, filepath, 0, true, false);
+  if (len == 0) {
+    return 0;
+  }
+  return int(ptcache_filepath_ext_append(pid, filepath, size_t(len), false, 0));
+}
+
+static bool ptcache_packed_header_is_valid(const PackedFileHeader &header, const PTCacheID *pid)
+{
+  return memcmp(header.magic, ptcache_packed_magic, sizeof(header.magic)) == 0 &&
+         header.version == PTCACHE_PACKED_VERSION && header.type == pid->type &&
+         header.data_end >= sizeof(PackedFileHeader);
+}
+
+static void ptcache_packed_header_init(PackedFileHeader &header, const PTCacheID *pid)
+{
+  header = {};
+  memcpy(header.magic, ptcache_packed_magic, sizeof(header.magic));
+  header.version = PTCACHE_PACKED_VERSION;
+  header.type = pid->type;
+  header.data_end = sizeof(PackedFileHeader);
+}
+
+/**
+ * Read the header of a packed cache file.
+ * \return False when the file isn't a valid packed cache of this type.
+ */
+static bool ptcache_packed_header_read(FILE *fp, const PTCacheID *pid, PackedFileHeader &r_header)
+{
+  return BLI_fseek(fp, 0, SEEK_SET) == 0 && fread(&r_header, sizeof(r_header), 1, fp) == 1 &&
+         ptcache_packed_header_is_valid(r_header, pid);
+}
+
+/**
+ * Switch the file to the new state by overwriting the header, once everything it references is
+ * written.
+ */
+static bool ptcache_packed_header_write(FILE *fp, const PackedFileHeader &header)
+{
+  return fflush(fp) == 0 && BLI_fseek(fp, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, fp) == 1 && fflush(fp) == 0;
+}
+
+/** Append a record at the end of the data in use and link it to the previous one. */
+static bool ptcache_packed_record_append(FILE *fp, PackedFileHeader &header, PackedRecord record)
+{
+  record.prev_record = header.last_record;
+  if (BLI_fseek(fp, int64_t(header.data_end), SEEK_SET) != 0 ||
+      fwrite(&record, sizeof(record), 1, fp) != 1)
+  {
+    return false;
+  }
+  header.last_record = header.data_end;
+  header.data_end += sizeof(record);
+  return true;
+}
+
+static int64_t ptcache_packed_index_find(const blender::Span<PackedIndexEntry> index,
+                                         const int frame)
+{
+  const PackedIndexEntry *entry = std::lower_bound(
+      index.begin(), index.end(), frame, [](const PackedIndexEntry &entry, const int frame) {
+        return entry.frame < frame;
+      });
+  if (entry == index.end() || entry->frame != frame) {
+    return -1;
+  }
+  return entry - index.begin();
+}
+
+/** Add the entry to the sorted index, replacing a previous version of the frame. */
+static void ptcache_packed_index_add(blender::Vector<PackedIndexEntry> &index,
+                                     const PackedIndexEntry &entry)
+{
+  const int64_t i = std::lower_bound(index.begin(),
+                                     index.end(),
+                                     entry,
+                                     [](const PackedIndexEntry &a, const PackedIndexEntry &b) {
+                                       return a.frame < b.frame;
+                                     }) -
+                    index.begin();
+  if (i < index.size() && index[i].frame == entry.frame) {
+    index[i] = entry;
+  }
+  else {
+    index.insert(i, entry);
+  }
+}
+
+/**
+ * Build the frame index from the records, of which the latest one of every frame is used.
+ * \return False when the records are invalid.
+ */
+static bool ptcache_packed_index_build(BLI_mmap_file *mmap_file,
+                                       const PackedFileHeader &header,
+                                       blender::Vector<PackedIndexEntry> &r_index)
+{
+  blender::Set<int> visited_frames;
+  uint64_t record_offset = header.last_record;
+  /* Every record is before the next one, which also ends the loop for invalid files. */
+  uint64_t records_end = header.data_end;
+  while (record_offset != 0) {
+    PackedRecord record;
+    if (record_offset < sizeof(PackedFileHeader) || record_offset > records_end ||
+        records_end - record_offset < sizeof(PackedRecord) ||
+        !BLI_mmap_read(mmap_file, &record, record_offset, sizeof(record)))
+    {
+      return false;
+    }
+    if (record.kind == PTCACHE_PACKED_RECORD_FRAME) {
+      if (record.data_offset > record.table_offset || record.table_offset > record_offset ||
+          record_offset - record.table_offset != record.table_size)
+      {
+        return false;
+      }
+      if (visited_frames.add(record.frame)) {
+        r_index.append({record.frame,
+                        record.table_size,
+                        record.table_offset,
+                        record_offset + sizeof(PackedRecord) - record.data_offset});
+      }
+    }
+    else {
+      visited_frames.add(record.frame);
+    }
+    records_end = record_offset;
+    record_offset = record.prev_record;
+  }
+  std::sort(
+      r_index.begin(), r_index.end(), [](const PackedIndexEntry &a, const PackedIndexEntry &b) {
+        return a.frame < b.frame;
+      });
+  return true;
+}
+
+/**
+ * Read the frame header and tables of a frame from the mapped file.
+ * \return False when they are invalid.
+ */
+static bool ptcache_packed_frame_tables_read(BLI_mmap_file *mmap_file,
+                                             const PackedIndexEntry &entry,
+                                             PackedFrameHeader &r_frame_header,
+                                             blender::Array<PackedStream> &r_streams,
+                                             blender::Array<PackedBlock> &r_blocks)
+{
+  if (!BLI_mmap_read(mmap_file, &r_frame_header, entry.offset, sizeof(r_frame_header)) ||
+      entry.table_size != sizeof(PackedFrameHeader) +
+                              sizeof(PackedStream) * uint64_t(r_frame_header.streams_num) +
+                              sizeof(PackedBlock) * uint64_t(r_frame_header.blocks_num))
+  {
+    return false;
+  }
+  r_streams.reinitialize(r_frame_header.streams_num);
+  r_blocks.reinitialize(r_frame_header.blocks_num);
+  const uint64_t streams_offset = entry.offset + sizeof(PackedFrameHeader);
+  const uint64_t blocks_offset = streams_offset + r_streams.as_span().size_in_bytes();
+  return BLI_mmap_read(
+             mmap_file, r_streams.data(), streams_offset, r_streams.as_span().size_in_bytes()) &&
+         BLI_mmap_read(
+             mmap_file, r_blocks.data(), blocks_offset, r_blocks.as_span().size_in_bytes());
+}
+
+/**
+ * The frame index and memory mapping of a packed cache file. It is not changed after it was read,
+ * so that it can still be used by readers while the #PointCache switches to a newer version.
+ */
+struct PackedFileData {
+  std::string filepath;
+  /** Generation of the file when it was read, see #ptcache_packed_generations. */
+  uint64_t generation = 0;
+  /** Empty when there is no valid file. */
+  blender::Array<PackedIndexEntry> index;
+  BLI_mmap_file *mmap_file = nullptr;
+
+  ~PackedFileData()
+  {
+    if (mmap_file) {
+      BLI_mmap_free(mmap_file);
+    }
+  }
+};
+
+struct PointCachePackedFile {
+  std::shared_ptr<const PackedFileData> data;
+};
+
+/**
+ * Incremented whenever a packed cache file is written, by file path. The same file is used by the
+ * copies of a #PointCache, e.g. the original and the evaluated one, which read the file again when
+ * they see a newer generation. Caches using other files are not affected.
+ */
+static std::unordered_map<std::string, uint64_t> ptcache_packed_generations;
+/** Protects #PointCache.packed_file and #ptcache_packed_generations. */
+static std::mutex ptcache_packed_mutex;
+
+static BLI_mmap_file *ptcache_packed_mmap_open(const char *filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    return nullptr;
+  }
+  BLI_mmap_file *mmap_file = BLI_mmap_open(file);
+  close(file);
+  return mmap_file;
+}
+
+static std::shared_ptr<const PackedFileData> ptcache_packed_file_read(const PTCacheID *pid,
+                                                                      const char *filepath,
+                                                                      const uint64_t generation)
+{
+  auto data = std::make_shared<PackedFileData>();
+  data->filepath = filepath;
+  data->generation = generation;
+
+  BLI_mmap_file *mmap_file = ptcache_packed_mmap_open(filepath);
+  if (mmap_file == nullptr) {
+    return data;
+  }
+  PackedFileHeader header;
+  blender::Vector<PackedIndexEntry> index;
+  if (!BLI_mmap_read(mmap_file, &header, 0, sizeof(header)) ||
+      !ptcache_packed_header_is_valid(header, pid) ||
+      header.data_end > BLI_mmap_get_length(mmap_file) ||
+      !ptcache_packed_index_build(mmap_file, header, index))
+  {
+    BLI_mmap_free(mmap_file);
+    return data;
+  }
+  data->index = index.as_span();
+  data->mmap_file = mmap_file;
+  return data;
+}
+
+static PointCachePackedFile &ptcache_packed_file_ensure(PointCache &cache)
+{
+  if (cache.packed_file == nullptr) {
+    cache.packed_file = MEM_new<PointCachePackedFile>(__func__);
+  }
+  return *cache.packed_file;
+}
+
+/**
+ * The frame index and mapping of the cache file. It's only read again when the file path changed
+ * or the file was written since, so that looking up many frames stays cheap.
+ */
+static std::shared_ptr<const PackedFileData> ptcache_packed_file_get(PTCacheID *pid)
+{
+  char filepath[MAX_PTCACHE_FILE];
+  if (ptcache_packed_filepath(pid, filepath) == 0) {
+    return std::make_shared<PackedFileData>();
+  }
+
+  std::scoped_lock lock(ptcache_packed_mutex);
+  const uint64_t generation = ptcache_packed_generations[filepath];
+  std::shared_ptr<const PackedFileData> &data = ptcache_packed_file_ensure(*pid->cache).data;
+  if (!data || data->generation != generation || data->filepath != filepath) {
+    data = ptcache_packed_file_read(pid, filepath, generation);
+  }
+  return data;
+}
+
+/**
+ * Called before and after the packed cache file is changed. Releases the mapping of the file, so
+ * that it does not prevent changing it on some platforms, and makes all copies of the cache read
+ * the file again.
+ */
+static void ptcache_packed_file_changed(PTCacheID *pid, const char *filepath)
+{
+  std::scoped_lock lock(ptcache_packed_mutex);
+  ptcache_packed_generations[filepath]++;
+  if (pid->cache->packed_file) {
+    pid->cache->packed_file->data.reset();
+  }
+}
+
+static void ptcache_packed_file_changed(PTCacheID *pid)
+{
+  char filepath[MAX_PTCACHE_FILE];
+  if (ptcache_packed_filepath(pid, filepath) != 0) {
+    ptcache_packed_file_changed(pid, filepath);
+  }
+  else if (pid->cache->packed_file) {
+    std::scoped_lock lock(ptcache_packed_mutex);
+    pid->cache->packed_file->data.reset();
+  }
+}
+
+/**
+ * Like #ptcache_packed_file_changed after the file was changed, but keeps the index of the new
+ * state instead of building it from the records again.
+ */
+static void ptcache_packed_file_written(PTCacheID *pid,
+                                        const char *filepath,
+                                        const blender::Span<PackedIndexEntry> index)
+{
+  std::scoped_lock lock(ptcache_packed_mutex);
+  uint64_t &generation = ptcache_packed_generations[filepath];
+  generation++;
+  std::shared_ptr<const PackedFileData> &data = ptcache_packed_file_ensure(*pid->cache).data;
+  data.reset();
+  BLI_mmap_file *mmap_file = ptcache_packed_mmap_open(filepath);
+  if (mmap_file == nullptr) {
+    return;
+  }
+  auto new_data = std::make_shared<PackedFileData>();
+  new_data->filepath = filepath;
+  new_data->generation = generation;
+  new_data->index = index;
+  new_data->mmap_file = mmap_file;
+  data = std::move(new_data);
+}
+
+static void ptcache_packed_file_free(PointCache *cache)
+{
+  MEM_delete(cache->packed_file);
+  cache->packed_file = nullptr;
+}
+
+/** Whether most of the file is taken by removed or replaced frames. */
+static bool ptcache_packed_file_needs_compact(const PackedFileHeader &header)
+{
+  return header.data_end - sizeof(PackedFileHeader) > 2 * header.live_size;
+}
+
+/**
+ * Copy the frames in use to a new file, which replaces the cache file when it was written
+ * completely.
+ */
+static void ptcache_packed_file_compact(PTCacheID *pid, const char *filepath)
+{
+  using namespace blender;
+  char filepath_temp[FILE_MAX];
+  SNPRINTF(filepath_temp, "%s@", filepath);
+  FILE *fp = BLI_fopen(filepath_temp, "wb");
+  if (fp == nullptr) {
+    return;
+  }
+
+  PackedFileHeader header;
+  ptcache_packed_header_init(header, pid);
+  Vector<PackedIndexEntry> index;
+  bool ok = BLI_fseek(fp, int64_t(header.data_end), SEEK_SET) == 0;
+  {
+    const std::shared_ptr<const PackedFileData> file_data = ptcache_packed_file_get(pid);
+    ok = ok && file_data->mmap_file != nullptr;
+    const char *memory = ok ? static_cast<const char *>(
+                                  BLI_mmap_get_pointer(file_data->mmap_file)) :
+                              nullptr;
+    const size_t length = ok ? BLI_mmap_get_length(file_data->mmap_file) : 0;
+    for (const PackedIndexEntry &entry : file_data->index) {
+      PackedFrameHeader frame_header;
+      Array<PackedStream> streams;
+      Array<PackedBlock> blocks;
+      ok = ok && ptcache_packed_frame_tables_read(
+                     file_data->mmap_file, entry, frame_header, streams, blocks);
+      if (!ok) {
+        break;
+      }
+      const uint64_t data_offset = header.data_end;
+      uint64_t offset = data_offset;
+      for (PackedBlock &block : blocks) {
+        ok = ok && block.offset <= length && block.size_compressed <= length - block.offset &&
+             fwrite(memory + block.offset, 1, size_t(block.size_compressed), fp) ==
+                 size_t(block.size_compressed);
+        block.offset = offset;
+        offset += block.size_compressed;
+      }
+      ok = ok && fwrite(&frame_header, sizeof(frame_header), 1, fp) == 1 &&
+           fwrite(streams.data(), sizeof(PackedStream), streams.size(), fp) ==
+               size_t(streams.size()) &&
+           fwrite(blocks.data(), sizeof(PackedBlock), blocks.size(), fp) == size_t(blocks.size());
+      header.data_end = offset + entry.table_size;
+
+      PackedRecord record = {};
+      record.kind = PTCACHE_PACKED_RECORD_FRAME;
+      record.frame = entry.frame;
+      record.table_size = entry.table_size;
+      record.data_offset = data_offset;
+      record.table_offset = offset;
+      ok = ok && ptcache_packed_record_append(fp, header, record);
+      index.append({entry.frame, entry.table_size, offset, header.data_end - data_offset});
+      header.live_size += header.data_end - data_offset;
+    }
+  }
+  ok = ok && ptcache_packed_header_write(fp, header);
+  ok = (fclose(fp) == 0) && ok;
+
+  ptcache_packed_file_changed(pid, filepath);
+  if (ok && BLI_rename_overwrite(filepath_temp, filepath) == 0) {
+    ptcache_packed_file_written(pid, filepath, index);
+    return;
+  }
+  BLI_delete(filepath_temp, false, false);
+  ptcache_packed_file_changed(pid, filepath);
+}
+
+static bool ptcache_packed_frame_write(PTCacheID *pid, const PTCacheMem *pm)
+{
+  using namespace blender;
+  char filepath[MAX_PTCACHE_FILE];
+  if (ptcache_packed_filepath(pid, filepath) == 0) {
+    return false;
+  }
+
+  /* Gather the streams and split them into blocks. */
+  struct BlockSource {
+    const char *data;
+    size_t size;
+  };
+  Vector<PackedStream> streams;
+  Vector<PackedBlock> blocks;
+  Vector<BlockSource> block_sources;
+  auto add_stream = [&](const PackedStreamKind kind,
+                        const uint32_t type,
+                        const uint32_t totdata,
+                        const void *data) {
+    PackedStream stream = {};
+    stream.kind = kind;
+    stream.type = type;
+    stream.totdata = totdata;
+    stream.blocks_start = uint32_t(blocks.size());
+    const size_t size = size_t(totdata) * ptcache_packed_stream_elem_size(stream);
+    for (size_t offset = 0; offset < size; offset += PTCACHE_PACKED_BLOCK_SIZE) {
+      const size_t block_size = std::min<size_t>(PTCACHE_PACKED_BLOCK_SIZE, size - offset);
+      blocks.append({0, 0, block_size});
+      block_sources.append({static_cast<const char *>(data) + offset, block_size});
+    }
+    stream.blocks_num = uint32_t(blocks.size()) - stream.blocks_start;
+    streams.append(stream);
+  };
+  for (int i = 0; i < BPHYS_TOT_DATA; i++) {
+    if (pm->data[i]) {
+      add_stream(PTCACHE_PACKED_STREAM_DATA, uint32_t(i), pm->totpoint, pm->data[i]);
+    }
+  }
+  LISTBASE_FOREACH (const PTCacheExtra *, extra, &pm->extradata) {
+    if (extra->data && extra->totdata) {
+      add_stream(PTCACHE_PACKED_STREAM_EXTRA, extra->type, extra->totdata, extra->data);
+    }
+  }
+
+  /* Compress all blocks in parallel. */
+  Array<Vector<char>> compressed(blocks.size());
+  std::atomic<bool> compress_error = false;
+  threading::parallel_for(blocks.index_range(), 1, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const BlockSource &source = block_sources[i];
+      compressed[i].resize(int64_t(ZSTD_compressBound(source.size)));
+      const size_t compressed_size = ZSTD_compress(compressed[i].data(),
+                                                   size_t(compressed[i].size()),
+                                                   source.data,
+                                                   source.size,
+                                                   PTCACHE_PACKED_COMPRESSION_LEVEL);
+      if (ZSTD_isError(compressed_size)) {
+        compress_error = true;
+        continue;
+      }
+      compressed[i].resize(int64_t(compressed_size));
+    }
+  });
+  if (compress_error) {
+    return false;
+  }
+
+  /* The index of the current state is updated, instead of building it from the file again. */
+  Vector<PackedIndexEntry> index;
+  bool file_is_valid = false;
+  {
+    const std::shared_ptr<const PackedFileData> file_data = ptcache_packed_file_get(pid);
+    index.extend(file_data->index.as_span());
+    file_is_valid = file_data->mmap_file != nullptr;
+  }
+
+  /* Open the existing cache, or start a new one. */
+  ptcache_packed_file_changed(pid, filepath);
+  FILE *fp = file_is_valid ? BLI_fopen(filepath, "rb+") : nullptr;
+  PackedFileHeader header;
+  if (fp == nullptr || !ptcache_packed_header_read(fp, pid, header)) {
+    if (fp) {
+      fclose(fp);
+    }
+    BLI_file_ensure_parent_dir_exists(filepath);
+    fp = BLI_fopen(filepath, "wb+");
+    if (fp == nullptr) {
+      return false;
+    }
+    ptcache_packed_header_init(header, pid);
+    index.clear();
+  }
+
+  /* Append the frame after the data in use, which is not changed. */
+  const uint64_t data_offset = header.data_end;
+  bool ok = BLI_fseek(fp, int64_t(data_offset), SEEK_SET) == 0;
+  uint64_t offset = data_offset;
+  for (const int64_t i : blocks.index_range()) {
+    blocks[i].offset = offset;
+    blocks[i].size_compressed = uint64_t(compressed[i].size());
+    ok = ok && fwrite(compressed[i].data(), 1, compressed[i].size(), fp) ==
+                   size_t(compressed[i].size());
+    offset += blocks[i].size_compressed;
+  }
+
+  PackedFrameHeader frame_header = {};
+  frame_header.frame = pm->frame;
+  frame_header.totpoint = pm->totpoint;
+  frame_header.data_types = pm->data_types;
+  frame_header.streams_num = uint32_t(streams.size());
+  frame_header.blocks_num = uint32_t(blocks.size());
+  ok = ok && fwrite(&frame_header, sizeof(frame_header), 1, fp) == 1 &&
+       fwrite(streams.data(), sizeof(PackedStream), streams.size(), fp) ==
+           size_t(streams.size()) &&
+       fwrite(blocks.data(), sizeof(PackedBlock), blocks.size(), fp) == size_t(blocks.size());
+
+  PackedRecord record = {};
+  record.kind = PTCACHE_PACKED_RECORD_FRAME;
+  record.frame = int32_t(pm->frame);
+  record.table_size = uint32_t(sizeof(PackedFrameHeader) + sizeof(PackedStream) * streams.size() +
+                               sizeof(PackedBlock) * blocks.size());
+  record.data_offset = data_offset;
+  record.table_offset = offset;
+  header.data_end = offset + record.table_size;
+  ok = ok && ptcache_packed_record_append(fp, header, record);
+
+  /* A previous version of the frame is replaced. */
+  const PackedIndexEntry entry = {
+      record.frame, record.table_size, offset, header.data_end - data_offset};
+  const int64_t existing = ptcache_packed_index_find(index, record.frame);
+  if (existing != -1) {
+    header.live_size -= std::min(header.live_size, index[existing].size);
+  }
+  header.live_size += entry.size;
+  ptcache_packed_index_add(index, entry);
+
+  ok = ok && ptcache_packed_header_write(fp, header);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok) {
+    ptcache_packed_file_changed(pid, filepath);
+    return false;
+  }
+  ptcache_packed_file_written(pid, filepath, index);
+  if (ptcache_packed_file_needs_compact(header)) {
+    ptcache_packed_file_compact(pid, filepath);
+  }
+  return true;
+}
+
+/** Remove the frames for which the predicate is true. */
+static void ptcache_packed_frames_remove(PTCacheID *pid,
+                                         const blender::FunctionRef<bool(int frame)> predicate)
+{
+  char filepath[MAX_PTCACHE_FILE];
+  if (ptcache_packed_filepath(pid, filepath) == 0) {
+    return;
+  }
+  /* Avoid opening the file when no frame is removed. */
+  blender::Vector<PackedIndexEntry> index;
+  blender::Vector<PackedIndexEntry> removed;
+  {
+    const std::shared_ptr<const PackedFileData> file_data = ptcache_packed_file_get(pid);
+    for (const PackedIndexEntry &entry : file_data->index) {
+      (predicate(entry.frame) ? removed : index).append(entry);
+    }
+  }
+  if (removed.is_empty()) {
+    return;
+  }
+  ptcache_packed_file_changed(pid, filepath);
+  if (index.is_empty()) {
+    BLI_delete(filepath, false, false);
+    ptcache_packed_file_changed(pid, filepath);
+    return;
+  }
+  FILE *fp = BLI_fopen(filepath, "rb+");
+  if (fp == nullptr) {
+    return;
+  }
+  PackedFileHeader header;
+  bool ok = ptcache_packed_header_read(fp, pid, header);
+  for (const PackedIndexEntry &entry : removed) {
+    PackedRecord record = {};
+    record.kind = PTCACHE_PACKED_RECORD_REMOVE;
+    record.frame = entry.frame;
+    ok = ok && ptcache_packed_record_append(fp, header, record);
+    header.live_size -= std::min(header.live_size, entry.size);
+  }
+  ok = ok && ptcache_packed_header_write(fp, header);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok) {
+    ptcache_packed_file_changed(pid, filepath);
+    return;
+  }
+  ptcache_packed_file_written(pid, filepath, index);
+  if (ptcache_packed_file_needs_compact(header)) {
+    ptcache_packed_file_compact(pid, filepath);
+  }
+}
+
+/** Read a frame from the memory mapped cache file. */
+static PTCacheMem *ptcache_packed_frame_to_mem(PTCacheID *pid, const int cfra)
+{
+  using namespace blender;
+  const std::shared_ptr<const PackedFileData> file_data = ptcache_packed_file_get(pid);
+  BLI_mmap_file *mmap_file = file_data->mmap_file;
+  if (mmap_file == nullptr) {
+    return nullptr;
+  }
+  const Span<PackedIndexEntry> index = file_data->index;
+  const char *memory = static_cast<const char *>(BLI_mmap_get_pointer(mmap_file));
+  const size_t length = BLI_mmap_get_length(mmap_file);
+  auto range_is_valid = [&](const uint64_t offset, const uint64_t size) {
+    return offset <= length && size <= length - offset;
+  };
+
+  const int64_t index_i = ptcache_packed_index_find(index, cfra);
+  if (index_i == -1) {
+    return nullptr;
+  }
+
+  PTCacheMem *pm = nullptr;
+  bool error = true;
+
+  PackedFrameHeader frame_header;
+  Array<PackedStream> streams;
+  Array<PackedBlock> blocks;
+  if (range_is_valid(index[index_i].offset, index[index_i].table_size)) {
+    const PackedIndexEntry &entry = index[index_i];
+    if (ptcache_packed_frame_tables_read(mmap_file, entry, frame_header, streams, blocks)) {
+      pm = MEM_callocN<PTCacheMem>("Pointcache mem");
+      pm->totpoint = frame_header.totpoint;
+      pm->data_types = frame_header.data_types;
+      pm->frame = frame_header.frame;
+      ptcache_data_alloc(pm);
+
+      /* Find the destination of every block of the streams that are read. */
+      Array<char *> block_dst(blocks.size(), nullptr);
+      error = false;
+      for (const PackedStream &stream : streams) {
+        const size_t elem_size = ptcache_packed_stream_elem_size(stream);
+        if (elem_size == 0 || uint64_t(stream.blocks_start) + stream.blocks_num >
+                                  uint64_t(blocks.size()))
+        {
+          error = true;
+          break;
+        }
+        char *dst = nullptr;
+        if (stream.kind == PTCACHE_PACKED_STREAM_DATA) {
+          if (stream.totdata != pm->totpoint) {
+            error = true;
+            break;
+          }
+          dst = static_cast<char *>(pm->data[stream.type]);
+        }
+        else {
+          PTCacheExtra *extra = MEM_callocN<PTCacheExtra>("Pointcache extradata");
+          extra->type = stream.type;
+          extra->totdata = stream.totdata;
+          extra->data = MEM_callocN(size_t(stream.totdata) * elem_size,
+                                    "Pointcache extradata->data");
+          BLI_addtail(&pm->extradata, extra);
+          dst = static_cast<char *>(extra->data);
+        }
+        if (dst == nullptr) {
+          continue;
+        }
+        uint64_t stream_offset = 0;
+        for (const int64_t block_i :
+             IndexRange(stream.blocks_start, stream.blocks_num))
+        {
+          const PackedBlock &block = blocks[block_i];
+          if (stream_offset + block.size > uint64_t(stream.totdata) * elem_size ||
+              !range_is_valid(block.offset, block.size_compressed))
+          {
+            error = true;
+            break;
+          }
+          block_dst[block_i] = dst + stream_offset;
+          stream_offset += block.size;
+        }
+      }
+
+      /* Decompress directly from the mapped file, in parallel. */
+      std::atomic<bool> decompress_error = false;
+      if (!error) {
+        threading::parallel_for(blocks.index_range(), 1, [&](const IndexRange range) {
+          for (const int64_t i : range) {
+            if (block_dst[i] == nullptr) {
+              continue;
+            }
+            const size_t size = ZSTD_decompress(block_dst[i],
+                                                blocks[i].size,
+                                                memory + blocks[i].offset,
+                                                blocks[i].size_compressed);
+            if (ZSTD_isError(size) || size != blocks[i].size) {
+              decompress_error = true;
+            }
+          }
+        });
+      }
+      /* Reading again detects IO errors that happened while decompressing. */
+      error = error || decompress_error ||
+              !BLI_mmap_read(mmap_file, &frame_header, entry.offset, sizeof(frame_header));
+    }
+  }
+
+  if (error) {
+    if (pm) {
+      ptcache_mem_clear(pm);
+      MEM_freeN(pm);
+      pm = nullptr;
+    }
+    /* Read the file again next time, it might have been changed by another program. */
+    ptcache_packed_file_changed(pid);
+  }
+  return pm;
+}
+
+/** \} */
+
 static PTCacheMem *ptcache_disk_frame_to_mem(PTCacheID *pid, int cfra)
 {
+  if (ptcache_use_packed(pid)) {
+    PTCacheMem *pm = ptcache_packed_frame_to_mem(pid, cfra);
+    if (pm == nullptr && G.debug & G_DEBUG) {
+      printf("Error reading from disk cache\n");
+    }
+    return pm;
+  }
+
   PTCacheFile *pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
   PTCacheMem *pm = nullptr;
   uint i, error = 0;
@@ -2028,6 +2898,17 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
   PTCacheFile *pf = nullptr;
   uint i, error = 0;
 
+  if (ptcache_use_packed(pid)) {
+    /* Writing replaces an existing version of the frame. */
+    if (!ptcache_packed_frame_write(pid, pm)) {
+      if (G.debug & G_DEBUG) {
+        printf("Error writing to disk cache\n");
+      }
+      return 0;
+    }
+    return 1;
+  }
+
   BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
 
   pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
@@ -2623,6 +3504,28 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, uint cfra)
   }
 #endif
 
+  /* All frames are in a single file, clearing all of them deletes it below. */
+  if (mode != PTCACHE_CLEAR_ALL && (pid->cache->flag & PTCACHE_DISK_CACHE) &&
+      ptcache_use_packed(pid))
+  {
+    ptcache_packed_frames_remove(pid, [&](const int frame) {
+      const bool remove = (mode == PTCACHE_CLEAR_BEFORE && frame < int(cfra)) ||
+                          (mode == PTCACHE_CLEAR_AFTER && frame > int(cfra)) ||
+                          (mode == PTCACHE_CLEAR_FRAME && frame == int(cfra));
+      if (remove && pid->cache->cached_frames && frame >= int(sta) && frame <= int(end)) {
+        pid->cache->cached_frames[frame - sta] = 0;
+      }
+      return remove;
+    });
+    pid->cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
+    return;
+  }
+  const bool clear_packed_file = (pid->cache->flag & PTCACHE_DISK_CACHE) &&
+                                 ptcache_use_packed(pid);
+  if (clear_packed_file) {
+    ptcache_packed_file_changed(pid);
+  }
+
   /* Clear all files in the temp dir with the prefix of the ID and the `.bphys` suffix. */
   switch (mode) {
     case PTCACHE_CLEAR_ALL:
@@ -2648,7 +3551,7 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, uint cfra)
         ptcache_filepath_ext_append(pid, ext, 0, false, 0);
 
         while ((de = readdir(dir)) != nullptr) {
-          if (strstr(de->d_name, ext)) {               /* Do we have the right extension? */
+          if (BLI_str_endswith(de->d_name, ext)) {     /* Do we have the right extension? */
             if (STREQLEN(filepath, de->d_name, len)) { /* Do we have the right prefix. */
               if (mode == PTCACHE_CLEAR_ALL) {
                 pid->cache->last_exact = std::min(pid->cache->startframe, 0);
@@ -2741,6 +3644,9 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, uint cfra)
       break;
   }
 
+  if (clear_packed_file) {
+    ptcache_packed_file_changed(pid);
+  }
   pid->cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
 }
 
@@ -2761,6 +3667,10 @@ bool BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
   if (pid->cache->flag & PTCACHE_DISK_CACHE) {
     char filepath[MAX_PTCACHE_FILE];
 
+    if (ptcache_use_packed(pid)) {
+      return ptcache_packed_index_find(ptcache_packed_file_get(pid)->index, cfra) != -1;
+    }
+
     ptcache_filepath(pid, filepath, cfra, true, true);
 
     return BLI_exists(filepath);
@@ -2826,7 +3736,15 @@ void BKE_ptcache_id_time(
     cache->cached_frames = MEM_calloc_arrayN<char>(size_t(cache->cached_frames_len),
                                                    "cached frames array");
 
-    if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+    if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_packed(pid)) {
+      const std::shared_ptr<const PackedFileData> file_data = ptcache_packed_file_get(pid);
+      for (const PackedIndexEntry &entry : file_data->index) {
+        if (entry.frame >= int(sta) && entry.frame <= int(end)) {
+          cache->cached_frames[entry.frame - sta] = 1;
+        }
+      }
+    }
+    else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
       /* mode is same as fopen's modes */
       DIR *dir;
       dirent *de;
@@ -2847,7 +3765,7 @@ void BKE_ptcache_id_time(
       ptcache_filepath_ext_append(pid, ext, 0, false, 0);
 
       while ((de = readdir(dir)) != nullptr) {
-        if (strstr(de->d_name, ext)) {               /* Do we have the right extension? */
+        if (BLI_str_endswith(de->d_name, ext)) {     /* Do we have the right extension? */
           if (STREQLEN(filepath, de->d_name, len)) { /* Do we have the right prefix. */
             /* read the number of the file */
             const int frame = ptcache_frame_from_filename(de->d_name, ext);
@@ -3053,6 +3971,7 @@ void BKE_ptcache_free(PointCache *cache)
   if (cache->cached_frames) {
     MEM_freeN(cache->cached_frames);
   }
+  ptcache_packed_file_free(cache);
   MEM_freeN(cache);
 }
 void BKE_ptcache_free_list(ListBase *ptcaches)
@@ -3099,6 +4018,7 @@ static PointCache *ptcache_copy(PointCache *cache, const bool copy_data)
 
   /* hmm, should these be copied over instead? */
   ncache->edit = nullptr;
+  ncache->packed_file = nullptr;
 
   return ncache;
 }
@@ -3549,6 +4469,22 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   /* get "from" filename */
   STRNCPY(pid->cache->name, name_src);
 
+  if (ptcache_use_packed(pid)) {
+    /* All frames are in a single file. */
+    if (ptcache_packed_filepath(pid, old_path_full) != 0) {
+      STRNCPY(pid->cache->name, name_dst);
+      if (ptcache_packed_filepath(pid, new_path_full) != 0 && BLI_exists(old_path_full)) {
+        ptcache_packed_file_changed(pid, old_path_full);
+        ptcache_packed_file_changed(pid, new_path_full);
+        BLI_rename_overwrite(old_path_full, new_path_full);
+        ptcache_packed_file_changed(pid, old_path_full);
+        ptcache_packed_file_changed(pid, new_path_full);
+      }
+    }
+    STRNCPY(pid->cache->name, old_name);
+    return;
+  }
+
   len = ptcache_filepath(pid, old_filepath, 0, false, false); /* no path */
 
   ptcache_path(pid, path);
@@ -3564,7 +4500,7 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   STRNCPY(pid->cache->name, name_dst);
 
   while ((de = readdir(dir)) != nullptr) {
-    if (strstr(de->d_name, ext)) {                   /* Do we have the right extension? */
+    if (BLI_str_endswith(de->d_name, ext)) {         /* Do we have the right extension? */
       if (STREQLEN(old_filepath, de->d_name, len)) { /* Do we have the right prefix. */
         /* read the number of the file */
         const int frame = ptcache_frame_from_filename(de->d_name, ext);
@@ -3621,7 +4557,7 @@ void BKE_ptcache_load_external(PTCacheID *pid)
   }
 
   while ((de = readdir(dir)) != nullptr) {
-    if (strstr(de->d_name, ext)) {               /* Do we have the right extension? */
+    if (BLI_str_endswith(de->d_name, ext)) {     /* Do we have the right extension? */
       if (STREQLEN(filepath, de->d_name, len)) { /* Do we have the right prefix. */
         /* read the number of the file */
         const int frame = ptcache_frame_from_filename(de->d_name, ext);
@@ -3736,6 +4672,16 @@ void BKE_ptcache_update_info(PTCacheID *pid)
         SNPRINTF(mem_info, RPT_("%i cells cached"), totpoint);
       }
     }
+    else if (ptcache_use_packed(pid)) {
+      const std::shared_ptr<const PackedFileData> file_data = ptcache_packed_file_get(pid);
+      for (const PackedIndexEntry &entry : file_data->index) {
+        if (entry.frame >= cache->startframe && entry.frame <= cache->endframe) {
+          totframes++;
+        }
+      }
+
+      SNPRINTF(mem_info, RPT_("%i frames on disk"), totframes);
+    }
     else {
       int cfra = cache->startframe;
 
@@ -3893,6 +4839,7 @@ static void direct_link_pointcache(BlendDataReader *reader, PointCache *cache)
   cache->simframe = 0;
   cache->edit = nullptr;
   cache->free_edit = nullptr;
+  cache->packed_file = nullptr;
   cache->cached_frames = nullptr;
   cache->cached_frames_len = 0;
 }
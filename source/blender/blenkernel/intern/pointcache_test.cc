@@ -0,0 +1,183 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <cstdio>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+#include "BLI_path_utils.hh"
+#include "BLI_string.h"
+#include "BLI_tempfile.h"
+
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_global.hh"
+#include "BKE_idtype.hh"
+#include "BKE_main.hh"
+#include "BKE_pointcache.h"
+#include "BKE_softbody.h"
+
+namespace blender::bke::tests {
+
+/**
+ * A soft body with a disk cache using Zstd compression, which stores all frames in a single
+ * packed file next to a blend file in the temporary directory.
+ */
+class PointCachePackedTest : public testing::Test {
+ public:
+  Main *bmain = nullptr;
+  Main *bmain_prev = nullptr;
+  std::string cache_dir;
+  Object object = {};
+  SoftBody softbody = {};
+  SoftBody_Shared shared = {};
+  Array<BodyPoint> points = Array<BodyPoint>(4, BodyPoint{});
+  PTCacheID pid = {};
+
+  void SetUp() override
+  {
+    BKE_idtype_init();
+    bmain = BKE_main_new();
+    char temp_dir[FILE_MAX];
+    BLI_temp_directory_path_get(temp_dir, sizeof(temp_dir));
+    BLI_path_join(bmain->filepath, sizeof(bmain->filepath), temp_dir, "pointcache_test.blend");
+    bmain_prev = G_MAIN;
+    G_MAIN = bmain;
+    cache_dir = std::string(temp_dir) + SEP_STR + "blendcache_pointcache_test";
+
+    STRNCPY(object.id.name, "OBSoftBody");
+    shared.pointcache = BKE_ptcache_add(&shared.ptcaches);
+    shared.pointcache->flag |= PTCACHE_DISK_CACHE;
+    shared.pointcache->compression = PTCACHE_COMPRESS_ZSTD;
+    shared.pointcache->index = 0;
+    softbody.shared = &shared;
+    softbody.totpoint = int(points.size());
+    softbody.bpoint = points.data();
+    object.soft = &softbody;
+    BKE_ptcache_id_from_softbody(&pid, &object, &softbody);
+  }
+
+  void TearDown() override
+  {
+    BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+    BKE_ptcache_free_list(&shared.ptcaches);
+    if (BLI_exists(cache_dir.c_str())) {
+      BLI_delete(cache_dir.c_str(), true, true);
+    }
+    G_MAIN = bmain_prev;
+    BKE_main_free(bmain);
+  }
+
+  std::string packed_filepath() const
+  {
+    return cache_dir + SEP_STR + "536F6674426F6479_00" + PTCACHE_PACKED_EXT;
+  }
+
+  void write_frame(const int frame, const float value)
+  {
+    for (const int i : points.index_range()) {
+      points[i].pos[0] = value + float(i);
+      points[i].vec[1] = -value;
+    }
+    EXPECT_TRUE(BKE_ptcache_write(&pid, uint(frame)));
+  }
+
+  /** Read the frame through another cache using the same file, like the evaluated copy. */
+  void expect_frame(const int frame, const float value)
+  {
+    ListBase other_caches = {};
+    PTCacheID other_pid = pid;
+    other_pid.cache = BKE_ptcache_copy_list(&other_caches, &shared.ptcaches, 0);
+
+    for (PTCacheID *read_pid : {&pid, &other_pid}) {
+      for (BodyPoint &point : points) {
+        point.pos[0] = 0.0f;
+        point.vec[1] = 0.0f;
+      }
+      ASSERT_EQ(BKE_ptcache_read(read_pid, float(frame), false), PTCACHE_READ_EXACT);
+      for (const int i : points.index_range()) {
+        EXPECT_EQ(points[i].pos[0], value + float(i));
+        EXPECT_EQ(points[i].vec[1], -value);
+      }
+    }
+    BKE_ptcache_free_list(&other_caches);
+  }
+};
+
+TEST_F(PointCachePackedTest, RoundTrip)
+{
+  for (const int frame : IndexRange(1, 10)) {
+    write_frame(frame, float(frame) * 10.0f);
+  }
+  EXPECT_TRUE(BLI_exists(packed_filepath().c_str()));
+  for (const int frame : IndexRange(1, 10)) {
+    expect_frame(frame, float(frame) * 10.0f);
+  }
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 11));
+}
+
+TEST_F(PointCachePackedTest, OverwriteFrames)
+{
+  for (const int frame : IndexRange(1, 10)) {
+    write_frame(frame, float(frame));
+  }
+  /* Simulate again from frame 3 with different results. */
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, 3);
+  EXPECT_TRUE(BKE_ptcache_id_exist(&pid, 3));
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 4));
+  for (const int frame : IndexRange(4, 4)) {
+    write_frame(frame, float(frame) * 100.0f);
+  }
+
+  for (const int frame : IndexRange(1, 3)) {
+    expect_frame(frame, float(frame));
+  }
+  for (const int frame : IndexRange(4, 4)) {
+    expect_frame(frame, float(frame) * 100.0f);
+  }
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 8));
+}
+
+TEST_F(PointCachePackedTest, Clear)
+{
+  for (const int frame : IndexRange(1, 5)) {
+    write_frame(frame, float(frame));
+  }
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_FRAME, 5);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 5));
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_BEFORE, 2);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 1));
+  for (const int frame : IndexRange(2, 3)) {
+    expect_frame(frame, float(frame));
+  }
+
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 2));
+  EXPECT_FALSE(BLI_exists(packed_filepath().c_str()));
+}
+
+TEST_F(PointCachePackedTest, IncompleteWrite)
+{
+  for (const int frame : IndexRange(1, 3)) {
+    write_frame(frame, float(frame));
+  }
+  /* Data appended by a write that did not finish is not referenced by the header. */
+  FILE *file = BLI_fopen(packed_filepath().c_str(), "ab");
+  ASSERT_NE(file, nullptr);
+  const char garbage[64] = {1};
+  fwrite(garbage, 1, sizeof(garbage), file);
+  fclose(file);
+
+  write_frame(4, 4.0f);
+  for (const int frame : IndexRange(1, 4)) {
+    expect_frame(frame, float(frame));
+  }
+}
+
+}  // namespace blender::bke::tests
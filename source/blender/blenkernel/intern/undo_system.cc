@@ -16,6 +16,7 @@
 #include "BLI_listbase.h"
 #include "BLI_string.h"
 #include "BLI_sys_types.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.hh"
@@ -276,6 +277,10 @@ UndoStack *BKE_undosys_stack_create()
 void BKE_undosys_stack_destroy(UndoStack *ustack)
 {
   BKE_undosys_stack_clear(ustack);
+  if (ustack->compress_task_pool) {
+    BLI_task_pool_work_and_wait(ustack->compress_task_pool);
+    BLI_task_pool_free(ustack->compress_task_pool);
+  }
   MEM_freeN(ustack);
 }
 
@@ -420,7 +425,8 @@ void BKE_undosys_stack_limit_steps_and_memory(UndoStack *ustack, int steps, size
   size_t us_count = 0;
   for (us = static_cast<UndoStep *>(ustack->steps.last); us && us->prev; us = us->prev) {
     if (memory_limit) {
-      data_size_all += us->data_size;
+      data_size_all += us->type->step_memory_size ? us->type->step_memory_size(us) :
+                                                    us->data_size;
       if (data_size_all > memory_limit) {
         CLOG_INFO(&LOG,
                   1,
@@ -465,6 +471,40 @@ void BKE_undosys_stack_limit_steps_and_memory(UndoStack *ustack, int steps, size
   }
 }
 
+void BKE_undosys_stack_compress_steps(UndoStack *ustack, int steps_uncompressed)
+{
+  UNDO_NESTED_ASSERT(false);
+  if (steps_uncompressed <= 0 || ustack->step_active == nullptr) {
+    return;
+  }
+
+  int compressed_count = 0;
+  /* Steps are compressed in both directions from the active one, redo steps are as unlikely to be
+   * needed as undo steps. */
+  for (const bool use_prev : {true, false}) {
+    int distance = 0;
+    UndoStep *us = use_prev ? ustack->step_active->prev : ustack->step_active->next;
+    for (; us; us = use_prev ? us->prev : us->next) {
+      if (!us->skip) {
+        distance++;
+      }
+      if (distance <= steps_uncompressed || us->type->step_compress == nullptr ||
+          us == ustack->step_active_memfile)
+      {
+        continue;
+      }
+      if (ustack->compress_task_pool == nullptr) {
+        ustack->compress_task_pool = BLI_task_pool_create_background(nullptr, TASK_PRIORITY_LOW);
+      }
+      /* Compressing a step again does nothing, unless it was decompressed in the meantime. */
+      us->type->step_compress(us, ustack->compress_task_pool);
+      compressed_count++;
+    }
+  }
+
+  CLOG_INFO(&LOG, 1, "steps_uncompressed=%d, compressed=%d", steps_uncompressed, compressed_count);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -52,7 +52,7 @@ void BLI_array_store_clear(BArrayStore *bs);
 size_t BLI_array_store_calc_size_expanded_get(const BArrayStore *bs);
 /**
  * \return the amount of memory used by all #BChunk.data
- * (duplicate chunks are only counted once).
+ * (duplicate chunks are only counted once, compressed chunks count their compressed size).
  */
 size_t BLI_array_store_calc_size_compacted_get(const BArrayStore *bs);
 
@@ -61,6 +61,7 @@ size_t BLI_array_store_calc_size_compacted_get(const BArrayStore *bs);
  * \param state_reference: The state to use as a reference when adding the new state,
  * typically this is the previous state,
  * however it can be any previously created state from this \a bs.
+ * A compressed reference is ignored, see #BLI_array_store_state_compress.
  *
  * \return The new state,
  * which is used by the caller as a handle to get back the contents of \a data.
@@ -78,6 +79,22 @@ BArrayState *BLI_array_store_state_add(BArrayStore *bs,
  */
 void BLI_array_store_state_remove(BArrayStore *bs, BArrayState *state);
 
+/**
+ * Mark the state as unlikely to be read soon: chunks which are only used by compressed states are
+ * compressed. The state can still be read, decompressing its chunks on the fly.
+ * Compressing an already compressed state does nothing.
+ */
+void BLI_array_store_state_compress(BArrayStore *bs, BArrayState *state);
+/**
+ * Decompress the chunks of a state compressed by #BLI_array_store_state_compress,
+ * so it can be read without overhead and used as a reference again.
+ */
+void BLI_array_store_state_decompress(BArrayStore *bs, BArrayState *state);
+/**
+ * \return true when the state was compressed with #BLI_array_store_state_compress.
+ */
+bool BLI_array_store_state_is_compressed(const BArrayState *state);
+
 /**
  * \return the expanded size of the array,
  * use this to know how much memory to allocate #BLI_array_store_state_data_get's argument.
@@ -40,6 +40,13 @@ int BLI_exists(const char *path) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
  * \return 0 on success.
  */
 int BLI_copy(const char *path_src, const char *path_dst) ATTR_NONNULL();
+/**
+ * Copy a file by sharing its data with the source, on file systems which support it (Btrfs, XFS
+ * and APFS for example). This takes neither time nor space, until either file is modified.
+ *
+ * \return 0 on success. Nothing is created when the file system does not support cloning.
+ */
+int BLI_file_clone(const char *path_src, const char *path_dst) ATTR_NONNULL();
 /**
  * When `path_src` points to a directory, moves all its contents into `path_dst`,
  * else rename `path_src` itself to `path_dst`.
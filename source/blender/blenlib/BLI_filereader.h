@@ -23,6 +23,7 @@
 typedef int64_t off64_t;
 #endif
 
+struct BLI_mmap_file;
 struct FileReader;
 
 typedef int64_t (*FileReaderReadFn)(struct FileReader *reader, void *buffer, size_t size);
@@ -50,10 +51,23 @@ typedef struct FileReader {
 FileReader *BLI_filereader_new_file(int filedes) ATTR_WARN_UNUSED_RESULT;
 /** Create #FileReader from raw file descriptor using memory-mapped IO. */
 FileReader *BLI_filereader_new_mmap(int filedes) ATTR_WARN_UNUSED_RESULT;
+/**
+ * Create #FileReader from an existing memory-mapped file. The reader does not take ownership,
+ * the mapping has to outlive it. Used when the caller keeps referencing the mapped memory.
+ */
+FileReader *BLI_filereader_new_mmap_unowned(struct BLI_mmap_file *mmap) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL();
 /** Create #FileReader from a region of memory. */
 FileReader *BLI_filereader_new_memory(const void *data, size_t len) ATTR_WARN_UNUSED_RESULT
     ATTR_NONNULL();
 /** Create #FileReader from applying `Zstd` decompression on an underlying file. */
 FileReader *BLI_filereader_new_zstd(FileReader *base) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+/**
+ * Same as #BLI_filereader_new_zstd, but for files with a seek table the frames following the read
+ * position are decompressed ahead of time on the task scheduler. Intended for large sequential
+ * reads, falls back to single threaded decompression when there is no seek table.
+ */
+FileReader *BLI_filereader_new_zstd_threaded(FileReader *base) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL();
 /** Create #FileReader from applying `Gzip` decompression on an underlying file. */
 FileReader *BLI_filereader_new_gzip(FileReader *base) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
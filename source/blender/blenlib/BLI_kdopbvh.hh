@@ -9,7 +9,9 @@
  */
 
 #include "BLI_function_ref.hh"
+#include "BLI_index_mask_fwd.hh"
 #include "BLI_math_vector_types.hh"
+#include "BLI_span.hh"
 #include "BLI_sys_types.h"
 
 struct BVHTree;
@@ -78,6 +80,10 @@ enum {
    * pair once, rather than twice in different order as usual. */
   BVH_OVERLAP_SELF = (1 << 2),
 };
+enum {
+  /** Additionally build the BVH4 tree, see #BLI_bvhtree_ensure_bvh4. */
+  BVH_BALANCE_BUILD_BVH4 = (1 << 0),
+};
 enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_NEAREST_OPTIMAL_ORDER = (1 << 0),
@@ -139,12 +145,28 @@ class BVHTreeDeleter {
  * \note many callers don't check for `NULL` return.
  */
 BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis);
+/**
+ * Create a copy of the tree with the same structure, including the BVH4 tree if it exists.
+ * Useful to update the bounds of a tree without modifying the original.
+ */
+BVHTree *BLI_bvhtree_copy(const BVHTree *tree);
 
 /**
  * Construct: first insert points, then call balance.
  */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag);
+/**
+ * Build a 4-wide tree with the surface area heuristic that is used for ray-casts and nearest point
+ * queries with a callback. It is usually much faster to traverse than the k-DOP tree, at the cost
+ * of more memory and build time, so it's only worth it for callers that run many queries. Only
+ * supported for trees with 6 or 8 axes, other trees are unchanged.
+ *
+ * Does nothing when the BVH4 tree exists already. It is thread-safe, also while other threads
+ * query the tree.
+ */
+void BLI_bvhtree_ensure_bvh4(const BVHTree *tree);
 
 /**
  * Update: first update points/nodes, then call update_tree to refit the bounding volumes.
@@ -210,6 +232,13 @@ float BLI_bvhtree_get_epsilon(const BVHTree *tree);
  * This function returns the bounding box of the BVH tree.
  */
 void BLI_bvhtree_get_bounding_box(const BVHTree *tree, float r_bb_min[3], float r_bb_max[3]);
+/**
+ * Sum of the surface areas of all branches relative to the surface area of the root, which is
+ * proportional to the expected cost of traversing the tree (the surface area heuristic).
+ * The cost increases when the bounds of sibling nodes overlap more, which happens when the tree is
+ * refit with #BLI_bvhtree_update_tree after large changes of the shape.
+ */
+float BLI_bvhtree_get_sah_cost(const BVHTree *tree);
 
 /**
  * Find nearest node to the given coordinates
@@ -310,6 +339,32 @@ extern const float bvhtree_kdop_axes[13][3];
 
 namespace blender {
 
+/**
+ * Cast the rays for all indices in the mask in parallel. Every hit has to be initialized like
+ * for #BLI_bvhtree_ray_cast_ex, the callback has to be thread-safe.
+ */
+void BLI_bvhtree_ray_cast_batch(const BVHTree &tree,
+                                Span<float3> origins,
+                                Span<float3> directions,
+                                float radius,
+                                const IndexMask &mask,
+                                MutableSpan<BVHTreeRayHit> r_hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag = BVH_RAYCAST_DEFAULT);
+
+/**
+ * Find the nearest elements for all positions in the mask in parallel. Every result has to be
+ * initialized like for #BLI_bvhtree_find_nearest_ex, the callback has to be thread-safe.
+ */
+void BLI_bvhtree_find_nearest_batch(const BVHTree &tree,
+                                    Span<float3> positions,
+                                    const IndexMask &mask,
+                                    MutableSpan<BVHTreeNearest> r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag = 0);
+
 using BVHTree_RayCastCallback_CPP =
     FunctionRef<void(int index, const BVHTreeRay &ray, BVHTreeRayHit &hit)>;
 
@@ -0,0 +1,225 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ * \brief A KD-tree for nearest neighbor search in 3D that is built from all points at once.
+ *
+ * Contrary to the trees in `BLI_kdtree.h`, the tree is built in parallel from a span of positions
+ * instead of inserting points one by one. The tree is stored implicitly: the points of every
+ * subtree are stored contiguously, with the point that splits the subtree in the middle. That way
+ * no child pointers are necessary and every node only takes 16 bytes. Small subtrees are not split
+ * further and are searched linearly.
+ *
+ * When multiple points have the same distance to a query position, the one with the smallest
+ * index is found. Therefore results only depend on the positions and not on the tree structure.
+ */
+
+#include <cfloat>
+
+#include "BLI_array.hh"
+#include "BLI_index_mask_fwd.hh"
+#include "BLI_math_vector.hh"
+#include "BLI_math_vector_types.hh"
+#include "BLI_span.hh"
+
+namespace blender::kdtree {
+
+class KDTree {
+ public:
+  struct Node {
+    float3 co;
+    /** The index of the point in the lower bits and the split axis in the two highest bits. */
+    uint32_t index_and_axis;
+
+    int index() const
+    {
+      return int(index_and_axis & index_mask);
+    }
+
+    int axis() const
+    {
+      return int(index_and_axis >> axis_shift);
+    }
+  };
+
+  /** Subtrees with at most this many points are searched linearly. */
+  static constexpr int leaf_size = 8;
+  static constexpr int axis_shift = 30;
+  static constexpr uint32_t index_mask = (1u << axis_shift) - 1;
+
+ private:
+  Array<Node> nodes_;
+
+ public:
+  KDTree() = default;
+  /** Build a tree from all positions. The indices of found points are indices into the span. */
+  explicit KDTree(Span<float3> positions);
+  /** Build a tree from the masked positions. Found indices are still indices into the span. */
+  KDTree(Span<float3> positions, const IndexMask &mask);
+
+  int64_t size() const
+  {
+    return nodes_.size();
+  }
+
+  bool is_empty() const
+  {
+    return nodes_.is_empty();
+  }
+
+  /**
+   * Find the nearest point for which `filter(index)` returns true.
+   * \return The index of the point or -1 if there is none.
+   */
+  template<typename FilterFn>
+  int find_nearest(const float3 &co, float *r_distance_sq, const FilterFn &filter) const;
+  int find_nearest(const float3 &co, float *r_distance_sq = nullptr) const;
+
+  /**
+   * Find the nearest `r_indices.size()` points, sorted by distance.
+   * \return The number of found points, unused indices are set to -1.
+   */
+  int find_nearest_n(const float3 &co,
+                     MutableSpan<int> r_indices,
+                     MutableSpan<float> r_distances_sq = {}) const;
+
+  /**
+   * Call `fn(index, co, distance_sq)` for every point that is at most `radius` away. The points
+   * are not visited in a specific order.
+   */
+  template<typename Fn> void foreach_in_radius(const float3 &co, float radius, const Fn &fn) const;
+
+  /**
+   * Find the nearest point for all masked query positions in parallel. The results are stored at
+   * the index of the query position.
+   */
+  void find_nearest(Span<float3> query_positions,
+                    const IndexMask &mask,
+                    MutableSpan<int> r_indices,
+                    MutableSpan<float> r_distances_sq = {}) const;
+
+  /**
+   * Find the nearest `k` points for all masked query positions in parallel. The results for the
+   * query position `i` are stored at `[i * k, (i + 1) * k)`.
+   */
+  void find_nearest_n(Span<float3> query_positions,
+                      const IndexMask &mask,
+                      int k,
+                      MutableSpan<int> r_indices,
+                      MutableSpan<float> r_distances_sq = {}) const;
+
+ private:
+  void build();
+
+  /**
+   * Call `visit(node)` for all nodes that may be closer than `max_distance_sq`. The visitor may
+   * decrease `max_distance_sq` to skip more of the tree.
+   */
+  template<typename VisitFn>
+  void traverse(const float3 &co, const float &max_distance_sq, const VisitFn &visit) const;
+};
+
+template<typename VisitFn>
+inline void KDTree::traverse(const float3 &co,
+                             const float &max_distance_sq,
+                             const VisitFn &visit) const
+{
+  struct StackItem {
+    int begin;
+    int end;
+    float plane_distance_sq;
+  };
+  /* Every level of the tree adds at most one item, and there are at most 2^30 points. */
+  StackItem stack[32];
+  int stack_size = 0;
+
+  int begin = 0;
+  int end = int(nodes_.size());
+  while (true) {
+    while (end - begin > leaf_size) {
+      const int mid = (begin + end) / 2;
+      const Node &node = nodes_[mid];
+      visit(node);
+      const int axis = node.axis();
+      const float plane_distance = co[axis] - node.co[axis];
+      const float plane_distance_sq = plane_distance * plane_distance;
+      if (plane_distance < 0.0f) {
+        if (plane_distance_sq <= max_distance_sq) {
+          stack[stack_size++] = {mid + 1, end, plane_distance_sq};
+        }
+        end = mid;
+      }
+      else {
+        if (plane_distance_sq <= max_distance_sq) {
+          stack[stack_size++] = {begin, mid, plane_distance_sq};
+        }
+        begin = mid + 1;
+      }
+    }
+    for (const int i : IndexRange::from_begin_end(begin, end)) {
+      visit(nodes_[i]);
+    }
+    while (true) {
+      if (stack_size == 0) {
+        return;
+      }
+      const StackItem &item = stack[--stack_size];
+      if (item.plane_distance_sq <= max_distance_sq) {
+        begin = item.begin;
+        end = item.end;
+        break;
+      }
+    }
+  }
+}
+
+template<typename FilterFn>
+inline int KDTree::find_nearest(const float3 &co,
+                                float *r_distance_sq,
+                                const FilterFn &filter) const
+{
+  int best_index = -1;
+  float best_distance_sq = FLT_MAX;
+  this->traverse(co, best_distance_sq, [&](const Node &node) {
+    const float distance_sq = math::distance_squared(co, node.co);
+    if (distance_sq > best_distance_sq) {
+      return;
+    }
+    const int index = node.index();
+    if (distance_sq == best_distance_sq && (best_index == -1 || index > best_index)) {
+      return;
+    }
+    if (!filter(index)) {
+      return;
+    }
+    best_index = index;
+    best_distance_sq = distance_sq;
+  });
+  if (r_distance_sq) {
+    *r_distance_sq = best_distance_sq;
+  }
+  return best_index;
+}
+
+inline int KDTree::find_nearest(const float3 &co, float *r_distance_sq) const
+{
+  return this->find_nearest(co, r_distance_sq, [](const int /*index*/) { return true; });
+}
+
+template<typename Fn>
+inline void KDTree::foreach_in_radius(const float3 &co, const float radius, const Fn &fn) const
+{
+  const float radius_sq = radius * radius;
+  this->traverse(co, radius_sq, [&](const Node &node) {
+    const float distance_sq = math::distance_squared(co, node.co);
+    if (distance_sq <= radius_sq) {
+      fn(node.index(), node.co, distance_sq);
+    }
+  });
+}
+
+}  // namespace blender::kdtree
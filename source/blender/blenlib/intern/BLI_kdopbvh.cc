@@ -21,20 +21,35 @@
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
  *   #BLI_bvhtree_range_query
+ *
+ * Ray-casts and nearest point queries can optionally use a 4-wide tree built with the surface
+ * area heuristic instead, see #BLI_bvhtree_ensure_bvh4 and #BVH4Tree.
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 
 #include "MEM_guardedalloc.h"
 
 #include "BLI_alloca.h"
+#include "BLI_array.hh"
+#include "BLI_bounds.hh"
 #include "BLI_heap_simple.h"
+#include "BLI_index_mask.hh"
 #include "BLI_kdopbvh.hh"
+#include "BLI_math_bits.h"
 #include "BLI_math_geom.h"
+#include "BLI_math_vector.hh"
 #include "BLI_math_vector_types.hh"
+#include "BLI_simd.hh"
 #include "BLI_stack.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
+
+#include "atomic_ops.h"
 
 #include "BLI_strict_flags.h" /* IWYU pragma: keep. Keep last. */
 
@@ -76,6 +91,8 @@ struct BVHNode {
   char main_axis; /* Axis used to split this node */
 };
 
+struct BVH4Tree;
+
 /* keep under 26 bytes for speed purposes */
 struct BVHTree {
   BVHNode **nodes;
@@ -88,11 +105,13 @@ struct BVHTree {
   axis_t start_axis, stop_axis; /* bvhtree_kdop_axes array indices according to axis */
   axis_t axis;                  /* KDOP type (6 => OBB, 7 => AABB, ...) */
   char tree_type;               /* type of tree (4 => quad-tree). */
+  /* Optional tree for faster queries, see #BVH4Tree. Use #bvh4_get to read it. */
+  BVH4Tree *bvh4;
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -446,6 +465,31 @@ static void node_join(BVHTree *tree, BVHNode *node)
   }
 }
 
+/**
+ * Join the bounds of all branches below `node` bottom-up. The subtrees of the branches close to
+ * the root are independent, so they are handled in parallel.
+ */
+static void node_join_recursive(BVHTree *tree, BVHNode *node, const int depth)
+{
+  if (node->node_num == 0) {
+    return;
+  }
+  const blender::IndexRange children(node->node_num);
+  if (depth < 6 && tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    blender::threading::parallel_for(children, 1, [&](const blender::IndexRange range) {
+      for (const int i : range) {
+        node_join_recursive(tree, node->children[i], depth + 1);
+      }
+    });
+  }
+  else {
+    for (const int i : children) {
+      node_join_recursive(tree, node->children[i], depth + 1);
+    }
+  }
+  node_join(tree, node);
+}
+
 #ifdef USE_PRINT_TREE
 
 /* -------------------------------------------------------------------- */
@@ -846,6 +890,530 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BVH4 Tree
+ *
+ * An optional 4-wide tree that is built from the axis aligned bounds of the leaves, using a binned
+ * surface area heuristic (SAH). The bounds of all children of a node are stored per axis, so that
+ * a ray or a point can be tested against all of them at once with SIMD instructions. The tree
+ * only replaces the k-DOP hierarchy for ray-casts and nearest point queries with a callback, all
+ * other queries still use the k-DOP hierarchy.
+ * \{ */
+
+struct BVH4Node {
+  /** Bounds of the children per axis. */
+  float min[3][4];
+  float max[3][4];
+  /**
+   * Index of a child node if the value is positive, otherwise `-(i + 1)` where `i` is the index
+   * of a leaf in #BVHTree::nodes. Child nodes always have a larger index than their parent.
+   */
+  int children[4];
+  int children_num;
+};
+
+struct BVH4Tree {
+  blender::Array<BVH4Node> nodes;
+};
+
+namespace blender {
+
+/* Number of bins per axis that are used to evaluate the SAH. */
+static constexpr int BVH4_BINS_NUM = 16;
+/* Below this depth, splits that are unbalanced in the number of elements are avoided. */
+static constexpr int BVH4_SAH_DEPTH_MAX = 64;
+/* Sub-trees with more elements are built in parallel. */
+static constexpr int64_t BVH4_PARALLEL_THRESHOLD = 4096;
+
+struct BVH4Builder {
+  /** Bounds and center of every leaf of the k-DOP tree. */
+  Span<Bounds<float3>> leaf_bounds;
+  Span<float3> leaf_centers;
+  MutableSpan<BVH4Node> nodes;
+  std::atomic<int> nodes_num;
+};
+
+struct BVH4Bin {
+  Bounds<float3> bounds{float3(FLT_MAX), float3(-FLT_MAX)};
+  int count = 0;
+};
+using BVH4Bins = std::array<std::array<BVH4Bin, BVH4_BINS_NUM>, 3>;
+
+static Bounds<float3> bvh4_leaf_bounds(const BVHNode &leaf)
+{
+  const float *bv = leaf.bv;
+  return {float3(bv[0], bv[2], bv[4]), float3(bv[1], bv[3], bv[5])};
+}
+
+static float bvh4_half_area(const Bounds<float3> &bounds)
+{
+  const float3 size = bounds.max - bounds.min;
+  return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+template<typename Fn>
+static Bounds<float3> bvh4_reduce_bounds(const Span<int> leafs, const Fn &get_bounds)
+{
+  return threading::parallel_reduce(
+      leafs.index_range(),
+      BVH4_PARALLEL_THRESHOLD,
+      Bounds<float3>(float3(FLT_MAX), float3(-FLT_MAX)),
+      [&](const IndexRange range, Bounds<float3> bounds) {
+        for (const int leaf : leafs.slice(range)) {
+          bounds = bounds::merge(bounds, get_bounds(leaf));
+        }
+        return bounds;
+      },
+      [](const Bounds<float3> &a, const Bounds<float3> &b) { return bounds::merge(a, b); });
+}
+
+/**
+ * Reorder the leafs so that the ones in the first returned number of elements go to one child and
+ * the remaining ones to the other child. Both parts are never empty.
+ */
+static int64_t bvh4_split(const BVH4Builder &builder, MutableSpan<int> leafs, const int depth)
+{
+  BLI_assert(leafs.size() > 1);
+  const Bounds<float3> center_bounds = bvh4_reduce_bounds(
+      leafs, [&](const int leaf) { return Bounds<float3>(builder.leaf_centers[leaf]); });
+  const float3 center_size = center_bounds.max - center_bounds.min;
+
+  if (depth < BVH4_SAH_DEPTH_MAX) {
+    float3 bin_scale;
+    for (const int axis : IndexRange(3)) {
+      /* Scale slightly less, so that the largest center does not end up outside of the bins. */
+      bin_scale[axis] = center_size[axis] > 0.0f ?
+                            BVH4_BINS_NUM * (1.0f - 1e-5f) / center_size[axis] :
+                            0.0f;
+    }
+    const auto bin_index = [&](const int leaf, const int axis) {
+      const float offset = builder.leaf_centers[leaf][axis] - center_bounds.min[axis];
+      return std::clamp(int(offset * bin_scale[axis]), 0, BVH4_BINS_NUM - 1);
+    };
+
+    const BVH4Bins bins = threading::parallel_reduce(
+        leafs.index_range(),
+        BVH4_PARALLEL_THRESHOLD,
+        BVH4Bins(),
+        [&](const IndexRange range, BVH4Bins bins) {
+          for (const int leaf : leafs.slice(range)) {
+            for (const int axis : IndexRange(3)) {
+              BVH4Bin &bin = bins[axis][bin_index(leaf, axis)];
+              bin.bounds = bounds::merge(bin.bounds, builder.leaf_bounds[leaf]);
+              bin.count++;
+            }
+          }
+          return bins;
+        },
+        [](const BVH4Bins &a, const BVH4Bins &b) {
+          BVH4Bins result;
+          for (const int axis : IndexRange(3)) {
+            for (const int i : IndexRange(BVH4_BINS_NUM)) {
+              result[axis][i].bounds = bounds::merge(a[axis][i].bounds, b[axis][i].bounds);
+              result[axis][i].count = a[axis][i].count + b[axis][i].count;
+            }
+          }
+          return result;
+        });
+
+    float best_cost = FLT_MAX;
+    int best_axis = -1;
+    int best_bin = -1;
+    for (const int axis : IndexRange(3)) {
+      if (center_size[axis] <= 0.0f) {
+        continue;
+      }
+      /* Cost of all bins after the split position, from right to left. */
+      std::array<float, BVH4_BINS_NUM> right_costs;
+      Bounds<float3> right_bounds(float3(FLT_MAX), float3(-FLT_MAX));
+      int right_count = 0;
+      for (int i = BVH4_BINS_NUM - 1; i > 0; i--) {
+        right_bounds = bounds::merge(right_bounds, bins[axis][i].bounds);
+        right_count += bins[axis][i].count;
+        right_costs[i] = right_count > 0 ? bvh4_half_area(right_bounds) * float(right_count) :
+                                           FLT_MAX;
+      }
+      Bounds<float3> left_bounds(float3(FLT_MAX), float3(-FLT_MAX));
+      int left_count = 0;
+      for (const int i : IndexRange(BVH4_BINS_NUM - 1)) {
+        left_bounds = bounds::merge(left_bounds, bins[axis][i].bounds);
+        left_count += bins[axis][i].count;
+        if (left_count == 0 || right_costs[i + 1] == FLT_MAX) {
+          continue;
+        }
+        const float cost = bvh4_half_area(left_bounds) * float(left_count) + right_costs[i + 1];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_bin = i;
+        }
+      }
+    }
+
+    if (best_axis != -1) {
+      int *mid = std::partition(leafs.begin(), leafs.end(), [&](const int leaf) {
+        return bin_index(leaf, best_axis) <= best_bin;
+      });
+      const int64_t left_num = mid - leafs.begin();
+      if (left_num > 0 && left_num < leafs.size()) {
+        return left_num;
+      }
+    }
+  }
+
+  /* All centers are in the same place or the tree became too deep, split in the middle. */
+  const int64_t mid = leafs.size() / 2;
+  const int axis = math::dominant_axis(center_size);
+  std::nth_element(leafs.begin(), leafs.begin() + mid, leafs.end(), [&](const int a, const int b) {
+    return builder.leaf_centers[a][axis] < builder.leaf_centers[b][axis];
+  });
+  return mid;
+}
+
+static void bvh4_build_node(BVH4Builder &builder,
+                            const int node_index,
+                            MutableSpan<int> leafs,
+                            const int depth)
+{
+  /* Split the leafs twice to get the leafs of up to four children. */
+  Vector<MutableSpan<int>, 4> groups;
+  if (leafs.size() <= 4) {
+    for (const int64_t i : leafs.index_range()) {
+      groups.append(leafs.slice(i, 1));
+    }
+  }
+  else {
+    const int64_t mid = bvh4_split(builder, leafs, depth);
+    for (MutableSpan<int> half : {leafs.take_front(mid), leafs.drop_front(mid)}) {
+      if (half.size() == 1) {
+        groups.append(half);
+        continue;
+      }
+      const int64_t half_mid = bvh4_split(builder, half, depth + 1);
+      groups.append(half.take_front(half_mid));
+      groups.append(half.drop_front(half_mid));
+    }
+  }
+
+  BVH4Node &node = builder.nodes[node_index];
+  node.children_num = int(groups.size());
+  Vector<std::pair<int, MutableSpan<int>>, 4> child_nodes;
+  for (const int i : IndexRange(4)) {
+    if (i >= groups.size()) {
+      for (const int axis : IndexRange(3)) {
+        node.min[axis][i] = FLT_MAX;
+        node.max[axis][i] = -FLT_MAX;
+      }
+      node.children[i] = -1;
+      continue;
+    }
+    const MutableSpan<int> group = groups[i];
+    Bounds<float3> bounds;
+    if (group.size() == 1) {
+      bounds = builder.leaf_bounds[group[0]];
+      node.children[i] = -(group[0] + 1);
+    }
+    else {
+      bounds = bvh4_reduce_bounds(group,
+                                  [&](const int leaf) { return builder.leaf_bounds[leaf]; });
+      node.children[i] = builder.nodes_num.fetch_add(1);
+      child_nodes.append({node.children[i], group});
+    }
+    for (const int axis : IndexRange(3)) {
+      node.min[axis][i] = bounds.min[axis];
+      node.max[axis][i] = bounds.max[axis];
+    }
+  }
+
+  const auto build_child = [&](const int i) {
+    bvh4_build_node(builder, child_nodes[i].first, child_nodes[i].second, depth + 2);
+  };
+  if (leafs.size() > BVH4_PARALLEL_THRESHOLD) {
+    threading::parallel_for(child_nodes.index_range(), 1, [&](const IndexRange range) {
+      for (const int i : range) {
+        build_child(i);
+      }
+    });
+  }
+  else {
+    for (const int i : child_nodes.index_range()) {
+      build_child(i);
+    }
+  }
+}
+
+static BVH4Tree *bvh4_build(const BVHTree &tree)
+{
+  const int leafs_num = tree.leaf_num;
+  Array<Bounds<float3>> leaf_bounds(leafs_num);
+  Array<float3> leaf_centers(leafs_num);
+  Array<int> leafs(leafs_num);
+  threading::parallel_for(leafs.index_range(), 4096, [&](const IndexRange range) {
+    for (const int i : range) {
+      leaf_bounds[i] = bvh4_leaf_bounds(*tree.nodes[i]);
+      leaf_centers[i] = math::midpoint(leaf_bounds[i].min, leaf_bounds[i].max);
+      leafs[i] = i;
+    }
+  });
+
+  /* Every node except the root is referenced by another node with at least two children, so
+   * there are less nodes than leafs. The actual number is usually about a third of that. */
+  Array<BVH4Node> nodes(std::max(leafs_num - 1, 1), NoInitialization());
+  BVH4Builder builder{leaf_bounds, leaf_centers, nodes, {1}};
+  bvh4_build_node(builder, 0, leafs, 0);
+
+  BVH4Tree *bvh4 = MEM_new<BVH4Tree>(__func__);
+  bvh4->nodes = nodes.as_span().take_front(builder.nodes_num);
+  return bvh4;
+}
+
+/**
+ * Update the bounds of the node and all nodes below it after the k-DOP leafs changed.
+ * \return The bounds of the node.
+ */
+static Bounds<float3> bvh4_refit_node(BVH4Tree &bvh4,
+                                      const BVHTree &tree,
+                                      const int node_index,
+                                      const int depth)
+{
+  BVH4Node &node = bvh4.nodes[node_index];
+  const auto refit_child = [&](const int i) {
+    const int child = node.children[i];
+    const Bounds<float3> bounds = child < 0 ? bvh4_leaf_bounds(*tree.nodes[-child - 1]) :
+                                              bvh4_refit_node(bvh4, tree, child, depth + 1);
+    for (const int axis : IndexRange(3)) {
+      node.min[axis][i] = bounds.min[axis];
+      node.max[axis][i] = bounds.max[axis];
+    }
+  };
+  const IndexRange children(node.children_num);
+  /* Subtrees of different children are independent, so the levels close to the root are refit
+   * in parallel. */
+  if (depth < 3 && tree.leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    threading::parallel_for(children, 1, [&](const IndexRange range) {
+      for (const int i : range) {
+        refit_child(i);
+      }
+    });
+  }
+  else {
+    for (const int i : children) {
+      refit_child(i);
+    }
+  }
+
+  Bounds<float3> bounds{float3(FLT_MAX), float3(-FLT_MAX)};
+  for (const int i : children) {
+    bounds = bounds::merge(bounds,
+                           Bounds<float3>(float3(node.min[0][i], node.min[1][i], node.min[2][i]),
+                                          float3(node.max[0][i], node.max[1][i], node.max[2][i])));
+  }
+  return bounds;
+}
+
+/** Update the bounds of all nodes after the k-DOP leafs changed. */
+/**
+ * The BVH4 tree can be added by #BLI_bvhtree_ensure_bvh4 while other threads already query the
+ * tree.
+ */
+static const BVH4Tree *bvh4_get(const BVHTree &tree)
+{
+  return static_cast<const BVH4Tree *>(atomic_load_ptr((void *const *)&tree.bvh4));
+}
+
+static void bvh4_refit(BVH4Tree &bvh4, const BVHTree &tree)
+{
+  bvh4_refit_node(bvh4, tree, 0, 0);
+}
+
+/**
+ * Intersect the ray with the bounds of all children.
+ * \return A bit for every child that is hit closer than `max_dist`.
+ */
+static int bvh4_ray_test(const BVH4Node &node,
+                         const BVHRayCastData &data,
+                         const float max_dist,
+                         float r_dist[4])
+{
+  const float *origin = data.ray.origin;
+  const float radius = data.ray.radius;
+  /* This is #FLT_MAX for axis aligned rays, which still gives the correct result. */
+  const float *inv_dir = data.idot_axis;
+  int mask = 0;
+#if BLI_HAVE_SSE2
+  __m128 t_near = _mm_setzero_ps();
+  __m128 t_far = _mm_set1_ps(max_dist);
+  const __m128 radius_v = _mm_set1_ps(radius);
+  for (const int axis : IndexRange(3)) {
+    const __m128 origin_v = _mm_set1_ps(origin[axis]);
+    const __m128 inv_dir_v = _mm_set1_ps(inv_dir[axis]);
+    const __m128 t1 = _mm_mul_ps(
+        _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(node.min[axis]), radius_v), origin_v), inv_dir_v);
+    const __m128 t2 = _mm_mul_ps(
+        _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(node.max[axis]), radius_v), origin_v), inv_dir_v);
+    t_near = _mm_max_ps(t_near, _mm_min_ps(t1, t2));
+    t_far = _mm_min_ps(t_far, _mm_max_ps(t1, t2));
+  }
+  _mm_storeu_ps(r_dist, t_near);
+  mask = _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+#else
+  for (const int i : IndexRange(4)) {
+    float t_near = 0.0f;
+    float t_far = max_dist;
+    for (const int axis : IndexRange(3)) {
+      const float t1 = (node.min[axis][i] - radius - origin[axis]) * inv_dir[axis];
+      const float t2 = (node.max[axis][i] + radius - origin[axis]) * inv_dir[axis];
+      t_near = std::max(t_near, std::min(t1, t2));
+      t_far = std::min(t_far, std::max(t1, t2));
+    }
+    r_dist[i] = t_near;
+    if (t_near <= t_far) {
+      mask |= 1 << i;
+    }
+  }
+#endif
+  return mask & ((1 << node.children_num) - 1);
+}
+
+/**
+ * Compute the squared distance from the point to the bounds of all children.
+ * \return A bit for every child that is closer than `max_dist_sq`.
+ */
+static int bvh4_nearest_test(const BVH4Node &node,
+                             const float co[3],
+                             const float max_dist_sq,
+                             float r_dist_sq[4])
+{
+  int mask = 0;
+#if BLI_HAVE_SSE2
+  __m128 dist_sq = _mm_setzero_ps();
+  for (const int axis : IndexRange(3)) {
+    const __m128 co_v = _mm_set1_ps(co[axis]);
+    const __m128 below = _mm_sub_ps(_mm_loadu_ps(node.min[axis]), co_v);
+    const __m128 above = _mm_sub_ps(co_v, _mm_loadu_ps(node.max[axis]));
+    const __m128 dist = _mm_max_ps(_mm_max_ps(below, above), _mm_setzero_ps());
+    dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(dist, dist));
+  }
+  _mm_storeu_ps(r_dist_sq, dist_sq);
+  mask = _mm_movemask_ps(_mm_cmplt_ps(dist_sq, _mm_set1_ps(max_dist_sq)));
+#else
+  for (const int i : IndexRange(4)) {
+    float dist_sq = 0.0f;
+    for (const int axis : IndexRange(3)) {
+      const float dist = std::max(
+          {node.min[axis][i] - co[axis], co[axis] - node.max[axis][i], 0.0f});
+      dist_sq += dist * dist;
+    }
+    r_dist_sq[i] = dist_sq;
+    if (dist_sq < max_dist_sq) {
+      mask |= 1 << i;
+    }
+  }
+#endif
+  return mask & ((1 << node.children_num) - 1);
+}
+
+struct BVH4StackItem {
+  int node;
+  /** Distance to the bounds of the node, for ray-casts it is not squared. */
+  float dist;
+};
+
+/** Sort the children in the mask by their distance, returns the number of children. */
+static int bvh4_sort_children(int mask, const float dist[4], int r_order[4])
+{
+  int num = 0;
+  for (; mask; mask &= mask - 1) {
+    const int child = bitscan_forward_i(mask);
+    int i = num++;
+    for (; i > 0 && dist[r_order[i - 1]] > dist[child]; i--) {
+      r_order[i] = r_order[i - 1];
+    }
+    r_order[i] = child;
+  }
+  return num;
+}
+
+/**
+ * Same as #dfs_raycast and #dfs_raycast_all, but using the BVH4 tree. Children are visited
+ * front to back, so that the hit distance becomes small early.
+ */
+static void bvh4_raycast(const BVH4Tree &bvh4, BVHRayCastData &data, const bool all)
+{
+  const BVHTree &tree = *data.tree;
+  Vector<BVH4StackItem, 64> stack;
+  stack.append({0, 0.0f});
+  while (!stack.is_empty()) {
+    const BVH4StackItem item = stack.pop_last();
+    if (item.dist >= data.hit.dist) {
+      continue;
+    }
+    const BVH4Node &node = bvh4.nodes[item.node];
+    float dist[4];
+    int order[4];
+    const int num = bvh4_sort_children(
+        bvh4_ray_test(node, data, data.hit.dist, dist), dist, order);
+    for (const int i : IndexRange(num)) {
+      const int child = node.children[order[i]];
+      if (child >= 0 || dist[order[i]] >= data.hit.dist) {
+        continue;
+      }
+      const int index = tree.nodes[-child - 1]->index;
+      if (all) {
+        const float hit_dist = data.hit.dist;
+        data.callback(data.userdata, index, &data.ray, &data.hit);
+        data.hit.index = -1;
+        data.hit.dist = hit_dist;
+      }
+      else {
+        data.callback(data.userdata, index, &data.ray, &data.hit);
+      }
+    }
+    for (int i = num - 1; i >= 0; i--) {
+      const int child = node.children[order[i]];
+      if (child >= 0) {
+        stack.append({child, dist[order[i]]});
+      }
+    }
+  }
+}
+
+/** Same as #dfs_find_nearest_begin, but using the BVH4 tree. */
+static void bvh4_find_nearest(const BVH4Tree &bvh4, BVHNearestData &data)
+{
+  const BVHTree &tree = *data.tree;
+  Vector<BVH4StackItem, 64> stack;
+  stack.append({0, 0.0f});
+  while (!stack.is_empty()) {
+    const BVH4StackItem item = stack.pop_last();
+    if (item.dist >= data.nearest.dist_sq) {
+      continue;
+    }
+    const BVH4Node &node = bvh4.nodes[item.node];
+    float dist_sq[4];
+    int order[4];
+    const int num = bvh4_sort_children(
+        bvh4_nearest_test(node, data.co, data.nearest.dist_sq, dist_sq), dist_sq, order);
+    for (const int i : IndexRange(num)) {
+      const int child = node.children[order[i]];
+      if (child >= 0 || dist_sq[order[i]] >= data.nearest.dist_sq) {
+        continue;
+      }
+      data.callback(data.userdata, tree.nodes[-child - 1]->index, data.co, &data.nearest);
+    }
+    for (int i = num - 1; i >= 0; i--) {
+      const int child = node.children[order[i]];
+      if (child >= 0) {
+        stack.append({child, dist_sq[order[i]]});
+      }
+    }
+  }
+}
+
+}  // namespace blender
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -928,10 +1496,47 @@ void BLI_bvhtree_free(BVHTree *tree)
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
     MEM_SAFE_FREE(tree->nodechild);
+    MEM_delete(tree->bvh4);
     MEM_freeN(tree);
   }
 }
 
+BVHTree *BLI_bvhtree_copy(const BVHTree *tree)
+{
+  BVHTree *copy = MEM_dupallocN<BVHTree>(__func__, *tree);
+  copy->nodes = static_cast<BVHNode **>(MEM_dupallocN(tree->nodes));
+  copy->nodearray = static_cast<BVHNode *>(MEM_dupallocN(tree->nodearray));
+  copy->nodechild = static_cast<BVHNode **>(MEM_dupallocN(tree->nodechild));
+  copy->nodebv = static_cast<float *>(MEM_dupallocN(tree->nodebv));
+  copy->bvh4 = tree->bvh4 ? MEM_new<BVH4Tree>(__func__, *tree->bvh4) : nullptr;
+
+  /* All node pointers point into the arrays of the tree, so they are moved to the new arrays. */
+  const auto remap = [&](const BVHNode *node) -> BVHNode * {
+    return node ? copy->nodearray + (node - tree->nodearray) : nullptr;
+  };
+  const int64_t nodes_num = int64_t(MEM_allocN_len(tree->nodearray) / sizeof(BVHNode));
+  blender::threading::parallel_for(
+      blender::IndexRange(nodes_num), 4096, [&](const blender::IndexRange range) {
+        for (const int64_t i : range) {
+          const BVHNode &src = tree->nodearray[i];
+          BVHNode &dst = copy->nodearray[i];
+          dst.bv = copy->nodebv + (src.bv - tree->nodebv);
+          dst.children = copy->nodechild + (src.children - tree->nodechild);
+          dst.parent = remap(src.parent);
+#ifdef USE_SKIP_LINKS
+          dst.skip[0] = remap(src.skip[0]);
+          dst.skip[1] = remap(src.skip[1]);
+#endif
+          copy->nodes[i] = remap(tree->nodes[i]);
+          for (int j = 0; j < tree->tree_type; j++) {
+            copy->nodechild[i * tree->tree_type + j] = remap(
+                tree->nodechild[i * tree->tree_type + j]);
+          }
+        }
+      });
+  return copy;
+}
+
 void BLI_bvhtree_balance(BVHTree *tree)
 {
   BVHNode **leafs_array = tree->nodes;
@@ -964,6 +1569,30 @@ void BLI_bvhtree_balance(BVHTree *tree)
 #endif
 }
 
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int flag)
+{
+  BLI_bvhtree_balance(tree);
+  if (flag & BVH_BALANCE_BUILD_BVH4) {
+    BLI_bvhtree_ensure_bvh4(tree);
+  }
+}
+
+void BLI_bvhtree_ensure_bvh4(const BVHTree *tree)
+{
+  /* The BVH4 tree only uses the first three axes of the bounding volumes. */
+  if (tree->start_axis != 0 || tree->leaf_num == 0 || blender::bvh4_get(*tree)) {
+    return;
+  }
+  BVH4Tree *bvh4 = blender::bvh4_build(*tree);
+  /* The BVH4 tree is only an acceleration structure that does not change the results of queries,
+   * so it can be added to a tree that is shared between threads. */
+  void **bvh4_ptr = reinterpret_cast<void **>(&const_cast<BVHTree *>(tree)->bvh4);
+  if (atomic_cas_ptr(bvh4_ptr, nullptr, bvh4) != nullptr) {
+    /* Another thread built it at the same time. */
+    MEM_delete(bvh4);
+  }
+}
+
 static void bvhtree_node_inflate(const BVHTree *tree, BVHNode *node, const float dist)
 {
   axis_t axis_iter;
@@ -1025,8 +1654,17 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
   BVHNode **root = tree->nodes + tree->leaf_num;
   BVHNode **index = tree->nodes + tree->leaf_num + tree->branch_num - 1;
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+  if (tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD && tree->branch_num > 0) {
+    node_join_recursive(tree, *root, 0);
+  }
+  else {
+    for (; index >= root; index--) {
+      node_join(tree, *index);
+    }
+  }
+
+  if (tree->bvh4) {
+    blender::bvh4_refit(*tree->bvh4, *tree);
   }
 }
 int BLI_bvhtree_get_len(const BVHTree *tree)
@@ -1060,6 +1698,32 @@ void BLI_bvhtree_get_bounding_box(const BVHTree *tree, float r_bb_min[3], float
   }
 }
 
+/** Half of the surface area of the box spanned by the first three axes of the bounding volume. */
+static float node_half_area(const BVHTree *tree, const BVHNode *node)
+{
+  const float *bv = node->bv + 2 * tree->start_axis;
+  const float x = std::max(bv[1] - bv[0], 0.0f);
+  const float y = std::max(bv[3] - bv[2], 0.0f);
+  const float z = std::max(bv[5] - bv[4], 0.0f);
+  return x * y + y * z + z * x;
+}
+
+float BLI_bvhtree_get_sah_cost(const BVHTree *tree)
+{
+  if (tree->branch_num == 0) {
+    return 0.0f;
+  }
+  const float root_area = node_half_area(tree, tree->nodes[tree->leaf_num]);
+  if (root_area <= 0.0f) {
+    return 0.0f;
+  }
+  double area_sum = 0.0;
+  for (int i = 0; i < tree->branch_num; i++) {
+    area_sum += node_half_area(tree, tree->nodes[tree->leaf_num + i]);
+  }
+  return float(area_sum / root_area);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1672,7 +2336,11 @@ int BLI_bvhtree_find_nearest_ex(const BVHTree *tree,
 
   /* dfs search */
   if (root) {
-    if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
+    const BVH4Tree *bvh4 = blender::bvh4_get(*tree);
+    if (bvh4 && callback && !(flag & BVH_NEAREST_OPTIMAL_ORDER)) {
+      blender::bvh4_find_nearest(*bvh4, data);
+    }
+    else if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
       heap_find_nearest_begin(&data, root);
     }
     else {
@@ -1697,6 +2365,23 @@ int BLI_bvhtree_find_nearest(const BVHTree *tree,
   return BLI_bvhtree_find_nearest_ex(tree, co, nearest, callback, userdata, 0);
 }
 
+namespace blender {
+
+void BLI_bvhtree_find_nearest_batch(const BVHTree &tree,
+                                    const Span<float3> positions,
+                                    const IndexMask &mask,
+                                    MutableSpan<BVHTreeNearest> r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    const int flag)
+{
+  mask.foreach_index(GrainSize(256), [&](const int64_t i) {
+    BLI_bvhtree_find_nearest_ex(&tree, positions[i], &r_nearest[i], callback, userdata, flag);
+  });
+}
+
+}  // namespace blender
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1998,8 +2683,14 @@ int BLI_bvhtree_ray_cast_ex(const BVHTree *tree,
   }
 
   if (root) {
-    dfs_raycast(&data, root);
-    //      iterative_raycast(&data, root);
+    const BVH4Tree *bvh4 = blender::bvh4_get(*tree);
+    if (bvh4 && callback) {
+      blender::bvh4_raycast(*bvh4, data, false);
+    }
+    else {
+      dfs_raycast(&data, root);
+      //      iterative_raycast(&data, root);
+    }
   }
 
   if (hit) {
@@ -2078,7 +2769,13 @@ void BLI_bvhtree_ray_cast_all_ex(const BVHTree *tree,
   data.hit.dist = hit_dist;
 
   if (root) {
-    dfs_raycast_all(&data, root);
+    const BVH4Tree *bvh4 = blender::bvh4_get(*tree);
+    if (bvh4) {
+      blender::bvh4_raycast(*bvh4, data, true);
+    }
+    else {
+      dfs_raycast_all(&data, root);
+    }
   }
 }
 
@@ -2094,6 +2791,26 @@ void BLI_bvhtree_ray_cast_all(const BVHTree *tree,
       tree, co, dir, radius, hit_dist, callback, userdata, BVH_RAYCAST_DEFAULT);
 }
 
+namespace blender {
+
+void BLI_bvhtree_ray_cast_batch(const BVHTree &tree,
+                                const Span<float3> origins,
+                                const Span<float3> directions,
+                                const float radius,
+                                const IndexMask &mask,
+                                MutableSpan<BVHTreeRayHit> r_hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                const int flag)
+{
+  mask.foreach_index(GrainSize(256), [&](const int64_t i) {
+    BLI_bvhtree_ray_cast_ex(
+        &tree, origins[i], directions[i], radius, &r_hits[i], callback, userdata, flag);
+  });
+}
+
+}  // namespace blender
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
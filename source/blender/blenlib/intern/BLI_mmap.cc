@@ -130,7 +130,7 @@ static void sigbus_handler_remove(BLI_mmap_file *file)
 }
 #endif
 
-BLI_mmap_file *BLI_mmap_open(int fd)
+static BLI_mmap_file *mmap_open(int fd, const bool copy_on_write)
 {
   void *memory, *handle = nullptr;
   const size_t length = BLI_lseek(fd, 0, SEEK_END);
@@ -144,8 +144,10 @@ BLI_mmap_file *BLI_mmap_open(int fd)
     return nullptr;
   }
 
-  /* Map the given file to memory. */
-  memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* Map the given file to memory. Since the mapping is private, writing to it only modifies
+   * copies of the written pages and never the file itself. */
+  const int prot = copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  memory = mmap(nullptr, length, prot, MAP_PRIVATE, fd, 0);
   if (memory == MAP_FAILED) {
     return nullptr;
   }
@@ -155,11 +157,12 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   /* Memory mapping on Windows is a two-step process - first we create a mapping,
    * then we create a view into that mapping.
    * In our case, one view that spans the entire file is enough. */
-  handle = CreateFileMapping(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  handle = CreateFileMapping(
+      file_handle, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
   if (handle == nullptr) {
     return nullptr;
   }
-  memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  memory = MapViewOfFile(handle, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
   if (memory == nullptr) {
     CloseHandle(handle);
     return nullptr;
@@ -180,6 +183,16 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   return file;
 }
 
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  return mmap_open(fd, false);
+}
+
+BLI_mmap_file *BLI_mmap_open_copy_on_write(int fd)
+{
+  return mmap_open(fd, true);
+}
+
 bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
 {
   /* If a previous read has already failed or we try to read past the end,
@@ -85,6 +85,15 @@
  * Once a match is found, there is a high chance next chunks match too,
  * so this is checked to avoid performing so many hash-lookups.
  * Otherwise new chunks are created.
+ *
+ * Compression
+ * -----------
+ *
+ * States which are not expected to be read soon can be compressed,
+ * chunks are compressed once they are only used by compressed states
+ * (#BChunkList::users_hot & #BChunk::users_hot count the uncompressed users).
+ * Compressed states can still be read but are not used as a reference for de-duplication,
+ * so all chunks of a reference are always uncompressed.
  */
 
 #include <algorithm>
@@ -101,6 +110,8 @@
 #include "BLI_array_store.h" /* Own include. */
 #include "BLI_ghash.h"       /* Only for #BLI_array_store_is_valid. */
 
+#include <zstd.h>
+
 #include "BLI_strict_flags.h" /* IWYU pragma: keep. Keep last. */
 
 struct BChunkList;
@@ -226,6 +237,11 @@ struct BChunkList;
 #  define BCHUNK_SIZE_MAX_MUL 2
 #endif /* USE_MERGE_CHUNKS */
 
+/**
+ * Chunks of compressed states are rarely read and compressed independently, favor speed.
+ */
+#define BCHUNK_COMPRESSION_LEVEL 1
+
 /** Slow (keep disabled), but handy for debugging. */
 // #define USE_VALIDATE_LIST_SIZE
 
@@ -298,6 +314,11 @@ struct BArrayState {
   BArrayState *next, *prev;
   /** Shared chunk list, this reference must hold a #BChunkList::users. */
   BChunkList *chunk_list;
+  /**
+   * Set by #BLI_array_store_state_compress,
+   * otherwise this state holds a #BChunkList::users_hot too.
+   */
+  bool is_compressed;
 };
 
 struct BChunkList {
@@ -310,14 +331,25 @@ struct BChunkList {
 
   /** Number of #BArrayState using this. */
   int users;
+  /** Number of #BArrayState using this which are not compressed. */
+  int users_hot;
 };
 
 /** A chunk of memory in an array (unit of de-duplication). */
 struct BChunk {
+  /** Null while the chunk is compressed. */
   const uchar *data;
   size_t data_len;
   /** number of #BChunkList using this. */
   int users;
+  /**
+   * Number of #BChunkList using this that have #BChunkList::users_hot,
+   * the chunk is compressed when there are none.
+   */
+  int users_hot;
+  /** Zstd compressed #data, only set while the chunk is compressed. */
+  void *data_compressed;
+  size_t data_compressed_len;
 
 #ifdef USE_HASH_TABLE_KEY_CACHE
   hash_key key;
@@ -359,6 +391,9 @@ static BChunk *bchunk_new(BArrayMemory *bs_mem, const uchar *data, const size_t
   chunk->data = data;
   chunk->data_len = data_len;
   chunk->users = 0;
+  chunk->users_hot = 0;
+  chunk->data_compressed = nullptr;
+  chunk->data_compressed_len = 0;
 #ifdef USE_HASH_TABLE_KEY_CACHE
   chunk->key = HASH_TABLE_KEY_UNSET;
 #endif
@@ -372,11 +407,21 @@ static BChunk *bchunk_new_copydata(BArrayMemory *bs_mem, const uchar *data, cons
   return bchunk_new(bs_mem, data_copy, data_len);
 }
 
+static void bchunk_data_free(BChunk *chunk)
+{
+  if (chunk->data) {
+    MEM_freeN((void *)chunk->data);
+  }
+  else {
+    MEM_freeN(chunk->data_compressed);
+  }
+}
+
 static void bchunk_decref(BArrayMemory *bs_mem, BChunk *chunk)
 {
   BLI_assert(chunk->users > 0);
   if (chunk->users == 1) {
-    MEM_freeN((void *)chunk->data);
+    bchunk_data_free(chunk);
     BLI_mempool_free(bs_mem->chunk, chunk);
   }
   else {
@@ -405,6 +450,54 @@ static bool bchunk_data_compare(const BChunk *chunk,
   return false;
 }
 
+/**
+ * Compress the chunk data, keeping it as-is when this doesn't save enough memory.
+ */
+static void bchunk_compress(BChunk *chunk)
+{
+  BLI_assert(chunk->users_hot == 0 && chunk->data != nullptr);
+  const size_t bound = ZSTD_compressBound(chunk->data_len);
+  void *data_compressed = MEM_mallocN(bound, __func__);
+  const size_t data_compressed_len = ZSTD_compress(
+      data_compressed, bound, chunk->data, chunk->data_len, BCHUNK_COMPRESSION_LEVEL);
+  if (ZSTD_isError(data_compressed_len) ||
+      data_compressed_len >= chunk->data_len - chunk->data_len / 8)
+  {
+    MEM_freeN(data_compressed);
+    return;
+  }
+  MEM_freeN((void *)chunk->data);
+  chunk->data = nullptr;
+  chunk->data_compressed = MEM_reallocN(data_compressed, data_compressed_len);
+  chunk->data_compressed_len = data_compressed_len;
+}
+
+/** Write the (possibly compressed) chunk data into `data`. */
+static void bchunk_data_get(const BChunk *chunk, uchar *data)
+{
+  if (chunk->data) {
+    memcpy(data, chunk->data, chunk->data_len);
+    return;
+  }
+  const size_t data_len = ZSTD_decompress(
+      data, chunk->data_len, chunk->data_compressed, chunk->data_compressed_len);
+  BLI_assert(data_len == chunk->data_len);
+  UNUSED_VARS_NDEBUG(data_len);
+}
+
+static void bchunk_decompress(BChunk *chunk)
+{
+  if (chunk->data) {
+    return;
+  }
+  uchar *data = MEM_malloc_arrayN<uchar>(chunk->data_len, __func__);
+  bchunk_data_get(chunk, data);
+  MEM_freeN(chunk->data_compressed);
+  chunk->data_compressed = nullptr;
+  chunk->data_compressed_len = 0;
+  chunk->data = data;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -419,6 +512,7 @@ static BChunkList *bchunk_list_new(BArrayMemory *bs_mem, size_t total_expanded_s
   chunk_list->chunk_refs_len = 0;
   chunk_list->total_expanded_size = total_expanded_size;
   chunk_list->users = 0;
+  chunk_list->users_hot = 0;
   return chunk_list;
 }
 
@@ -442,6 +536,47 @@ static void bchunk_list_decref(BArrayMemory *bs_mem, BChunkList *chunk_list)
   }
 }
 
+/**
+ * Add an uncompressed user, decompressing chunks which were only used by compressed states.
+ */
+static void bchunk_list_hot_incref(BChunkList *chunk_list)
+{
+  chunk_list->users_hot += 1;
+  if (chunk_list->users_hot != 1) {
+    return;
+  }
+  LISTBASE_FOREACH (BChunkRef *, cref, &chunk_list->chunk_refs) {
+    BChunk *chunk = cref->link;
+    chunk->users_hot += 1;
+    if (chunk->users_hot == 1) {
+      bchunk_decompress(chunk);
+    }
+  }
+}
+
+/**
+ * Remove an uncompressed user, compressing chunks which are only used by compressed states.
+ *
+ * \param is_list_freed: The list is about to be freed,
+ * don't compress chunks that are freed along with it.
+ */
+static void bchunk_list_hot_decref(BChunkList *chunk_list, const bool is_list_freed)
+{
+  BLI_assert(chunk_list->users_hot > 0);
+  chunk_list->users_hot -= 1;
+  if (chunk_list->users_hot != 0) {
+    return;
+  }
+  LISTBASE_FOREACH (BChunkRef *, cref, &chunk_list->chunk_refs) {
+    BChunk *chunk = cref->link;
+    BLI_assert(chunk->users_hot > 0);
+    chunk->users_hot -= 1;
+    if (chunk->users_hot == 0 && !(is_list_freed && chunk->users == 1)) {
+      bchunk_compress(chunk);
+    }
+  }
+}
+
 #ifdef USE_VALIDATE_LIST_SIZE
 #  ifndef NDEBUG
 #    define ASSERT_CHUNKLIST_SIZE(chunk_list, n) BLI_assert(bchunk_list_size(chunk_list) == n)
@@ -1554,7 +1689,7 @@ static void array_store_free_data(BArrayStore *bs)
     BLI_mempool_iternew(bs->memory.chunk, &iter);
     while ((chunk = static_cast<BChunk *>(BLI_mempool_iterstep(&iter)))) {
       BLI_assert(chunk->users > 0);
-      MEM_freeN((void *)chunk->data);
+      bchunk_data_free(chunk);
     }
   }
 
@@ -1612,7 +1747,7 @@ size_t BLI_array_store_calc_size_compacted_get(const BArrayStore *bs)
   BLI_mempool_iternew(bs->memory.chunk, &iter);
   while ((chunk = static_cast<BChunk *>(BLI_mempool_iterstep(&iter)))) {
     BLI_assert(chunk->users > 0);
-    size_total += size_t(chunk->data_len);
+    size_total += chunk->data ? chunk->data_len : chunk->data_compressed_len;
   }
   return size_total;
 }
@@ -1637,6 +1772,11 @@ BArrayState *BLI_array_store_state_add(BArrayStore *bs,
   }
 #endif
 
+  /* Chunks of compressed states can't be compared, the state may also be far from the new one. */
+  if (state_reference && state_reference->is_compressed) {
+    state_reference = nullptr;
+  }
+
   BChunkList *chunk_list;
   if (state_reference) {
     chunk_list = bchunk_list_from_data_merge(&bs->info,
@@ -1652,6 +1792,7 @@ BArrayState *BLI_array_store_state_add(BArrayStore *bs,
   }
 
   chunk_list->users += 1;
+  bchunk_list_hot_incref(chunk_list);
 
   BArrayState *state = MEM_callocN<BArrayState>(__func__);
   state->chunk_list = chunk_list;
@@ -1677,12 +1818,50 @@ void BLI_array_store_state_remove(BArrayStore *bs, BArrayState *state)
   BLI_assert(BLI_findindex(&bs->states, state) != -1);
 #endif
 
+  if (!state->is_compressed) {
+    bchunk_list_hot_decref(state->chunk_list, state->chunk_list->users == 1);
+  }
   bchunk_list_decref(&bs->memory, state->chunk_list);
   BLI_remlink(&bs->states, state);
 
   MEM_freeN(state);
 }
 
+void BLI_array_store_state_compress(BArrayStore *bs, BArrayState *state)
+{
+#ifdef USE_PARANOID_CHECKS
+  BLI_assert(BLI_findindex(&bs->states, state) != -1);
+#else
+  UNUSED_VARS(bs);
+#endif
+
+  if (state->is_compressed) {
+    return;
+  }
+  state->is_compressed = true;
+  bchunk_list_hot_decref(state->chunk_list, false);
+}
+
+void BLI_array_store_state_decompress(BArrayStore *bs, BArrayState *state)
+{
+#ifdef USE_PARANOID_CHECKS
+  BLI_assert(BLI_findindex(&bs->states, state) != -1);
+#else
+  UNUSED_VARS(bs);
+#endif
+
+  if (!state->is_compressed) {
+    return;
+  }
+  state->is_compressed = false;
+  bchunk_list_hot_incref(state->chunk_list);
+}
+
+bool BLI_array_store_state_is_compressed(const BArrayState *state)
+{
+  return state->is_compressed;
+}
+
 size_t BLI_array_store_state_size_get(BArrayState *state)
 {
   return state->chunk_list->total_expanded_size;
@@ -1701,7 +1880,7 @@ void BLI_array_store_state_data_get(const BArrayState *state, void *data)
   uchar *data_step = (uchar *)data;
   LISTBASE_FOREACH (BChunkRef *, cref, &state->chunk_list->chunk_refs) {
     BLI_assert(cref->link->users > 0);
-    memcpy(data_step, cref->link->data, cref->link->data_len);
+    bchunk_data_get(cref->link, data_step);
     data_step += cref->link->data_len;
   }
 }
@@ -1764,7 +1943,13 @@ bool BLI_array_store_is_valid(BArrayStore *bs)
     BChunk *chunk;
     BLI_mempool_iternew(bs->memory.chunk, &iter);
     while ((chunk = static_cast<BChunk *>(BLI_mempool_iterstep(&iter)))) {
-      if (!(MEM_allocN_len(chunk->data) >= chunk->data_len)) {
+      if (chunk->data == nullptr) {
+        /* Chunks used by uncompressed states must be uncompressed. */
+        if (chunk->users_hot != 0 || chunk->data_compressed == nullptr) {
+          return false;
+        }
+      }
+      else if (!(MEM_allocN_len(chunk->data) >= chunk->data_len)) {
         return false;
       }
     }
@@ -1809,6 +1994,28 @@ bool BLI_array_store_is_valid(BArrayStore *bs)
       goto user_finally;
     }
 
+    /* Count uncompressed users. */
+    GHASH_ITER (gh_iter, chunk_list_map) {
+      const BChunkList *chunk_list = static_cast<const BChunkList *>(
+          BLI_ghashIterator_getKey(&gh_iter));
+      int users_hot = 0;
+      LISTBASE_FOREACH (const BArrayState *, state, &bs->states) {
+        if (state->chunk_list == chunk_list && !state->is_compressed) {
+          users_hot += 1;
+        }
+      }
+      if (!(chunk_list->users_hot == users_hot)) {
+        ok = false;
+        goto user_finally;
+      }
+      LISTBASE_FOREACH (const BChunkRef *, cref, &chunk_list->chunk_refs) {
+        if (users_hot && !(cref->link->users_hot > 0 && cref->link->data)) {
+          ok = false;
+          goto user_finally;
+        }
+      }
+    }
+
     /* Count chunk's. */
     GHASH_ITER (gh_iter, chunk_list_map) {
       const BChunkList *chunk_list = static_cast<const BChunkList *>(
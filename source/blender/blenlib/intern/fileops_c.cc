@@ -35,6 +35,12 @@
 #    include <objc/message.h>
 #    include <objc/runtime.h>
 #  endif
+#  if defined(__APPLE__)
+#    include <sys/clonefile.h>
+#  elif defined(__linux__)
+#    include <linux/fs.h>
+#    include <sys/ioctl.h>
+#  endif
 #  include <dirent.h>
 #  include <sys/param.h>
 #  include <sys/wait.h>
@@ -845,6 +851,12 @@ int BLI_copy(const char *path_src, const char *path_dst)
   return err;
 }
 
+int BLI_file_clone(const char * /*path_src*/, const char * /*path_dst*/)
+{
+  /* Block cloning is only supported by ReFS volumes. */
+  return -1;
+}
+
 #  if 0
 int BLI_create_symlink(const char *path_src, const char *path_dst)
 {
@@ -1538,6 +1550,37 @@ int BLI_copy(const char *path_src, const char *path_dst)
   return ret;
 }
 
+int BLI_file_clone(const char *path_src, const char *path_dst)
+{
+#  if defined(__APPLE__)
+  /* Fails when the destination exists. */
+  if (BLI_exists(path_dst) && unlink(path_dst) != 0) {
+    return -1;
+  }
+  return clonefile(path_src, path_dst, 0) == 0 ? 0 : -1;
+#  elif defined(FICLONE)
+  const int file_src = BLI_open(path_src, O_RDONLY, 0);
+  if (file_src == -1) {
+    return -1;
+  }
+  const int file_dst = BLI_open(path_dst, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (file_dst == -1) {
+    close(file_src);
+    return -1;
+  }
+  const int ret = ioctl(file_dst, FICLONE, file_src) == -1 ? -1 : 0;
+  close(file_src);
+  close(file_dst);
+  if (ret != 0) {
+    unlink(path_dst);
+  }
+  return ret;
+#  else
+  UNUSED_VARS(path_src, path_dst);
+  return -1;
+#  endif
+}
+
 #  if 0
 int BLI_create_symlink(const char *path_src, const char *path_dst)
 {
@@ -129,3 +129,22 @@ FileReader *BLI_filereader_new_mmap(int filedes)
 
   return (FileReader *)mem;
 }
+
+static void memory_close_mmap_unowned(FileReader *reader)
+{
+  MEM_freeN(reader);
+}
+
+FileReader *BLI_filereader_new_mmap_unowned(BLI_mmap_file *mmap)
+{
+  MemoryReader *mem = MEM_callocN<MemoryReader>(__func__);
+
+  mem->mmap = mmap;
+  mem->length = BLI_mmap_get_length(mmap);
+
+  mem->reader.read = memory_read_mmap;
+  mem->reader.seek = memory_seek;
+  mem->reader.close = memory_close_mmap_unowned;
+
+  return (FileReader *)mem;
+}
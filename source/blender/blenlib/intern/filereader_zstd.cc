@@ -7,11 +7,16 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <zstd.h>
 
+#include "BLI_array.hh"
 #include "BLI_fileops.hh"
 #include "BLI_filereader.h"
+#include "BLI_task.h"
 
 #ifdef __BIG_ENDIAN__
 #  include "BLI_endian_switch.h"
@@ -19,6 +24,58 @@
 
 #include "MEM_guardedalloc.h"
 
+/** Number of frames that are decompressed ahead of the read position, per worker thread. */
+#define ZSTD_READAHEAD_FRAMES_PER_THREAD 2
+/** Upper bound for the read-ahead window, frames are ~1mb each when written by Blender. */
+#define ZSTD_READAHEAD_FRAMES_MAX 64
+
+struct ZstdReader;
+
+enum class ZstdFrameState {
+  /** Slot is not used by any frame in the read-ahead window. */
+  Unused,
+  /** Frame is waiting to be picked up by a worker (or by the reading thread). */
+  Pending,
+  /** Frame is being decompressed. */
+  Running,
+  /** Frame is decompressed, `content` is null when decompression failed. */
+  Done,
+};
+
+/** A frame in the read-ahead window, see #ZstdReadahead. */
+struct ZstdReadaheadSlot {
+  ZstdReader *zstd = nullptr;
+  int frame = -1;
+  std::atomic<ZstdFrameState> state = ZstdFrameState::Unused;
+  char *content = nullptr;
+};
+
+/**
+ * Decompresses the frames following the current read position on the task scheduler, so that
+ * consumers reading the file sequentially (like `readfile.cc` parsing #BHead blocks) only wait
+ * for frames that weren't finished in the background yet.
+ *
+ * The window covers frames `[window_start, window_end)`, frame `i` uses `slots[i % slots.size()]`.
+ * Frames that have not been started by a worker yet are claimed and decompressed by the reading
+ * thread itself, so it never waits on tasks that didn't get scheduled.
+ */
+struct ZstdReadahead {
+  TaskPool *pool = nullptr;
+
+  /** The base #FileReader is shared by all workers, seeking and reading has to be atomic. */
+  std::mutex base_mutex;
+
+  std::mutex state_mutex;
+  std::condition_variable state_cond;
+
+  blender::Array<ZstdReadaheadSlot, 0> slots;
+
+  int window_start = 0;
+  int window_end = 0;
+
+  ZstdReadahead(const int slots_num) : slots(slots_num) {}
+};
+
 struct ZstdReader {
   FileReader reader;
 
@@ -36,6 +93,9 @@ struct ZstdReader {
     char *cached_content;
     int cached_frame;
   } seek;
+
+  /** Only used for seekable files opened with #BLI_filereader_new_zstd_threaded. */
+  ZstdReadahead *readahead;
 };
 
 static bool zstd_read_u32(FileReader *base, uint32_t *val)
@@ -158,39 +218,219 @@ static int zstd_frame_from_pos(ZstdReader *zstd, size_t pos)
   return low;
 }
 
-/* Ensure that the currently loaded frame is the correct one. */
-static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
+/* Read and decompress a single frame, returns null on failure. */
+static char *zstd_decompress_frame(ZstdReader *zstd, ZSTD_DCtx *ctx, int frame)
 {
-  if (zstd->seek.cached_frame == frame) {
-    /* Cached frame matches, so just return it. */
-    return zstd->seek.cached_content;
-  }
-
-  /* Cached frame doesn't match, so discard it and cache the wanted one instead. */
-  MEM_SAFE_FREE(zstd->seek.cached_content);
-
   size_t compressed_size = zstd->seek.compressed_ofs[frame + 1] - zstd->seek.compressed_ofs[frame];
   size_t uncompressed_size = zstd->seek.uncompressed_ofs[frame + 1] -
                              zstd->seek.uncompressed_ofs[frame];
 
   char *uncompressed_data = static_cast<char *>(MEM_mallocN(uncompressed_size, __func__));
   char *compressed_data = static_cast<char *>(MEM_mallocN(compressed_size, __func__));
-  if (zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) < 0 ||
-      zstd->base->read(zstd->base, compressed_data, compressed_size) < compressed_size)
+
+  bool read_ok;
   {
+    std::unique_lock<std::mutex> lock;
+    if (zstd->readahead) {
+      lock = std::unique_lock<std::mutex>(zstd->readahead->base_mutex);
+    }
+    read_ok = zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) >= 0 &&
+              zstd->base->read(zstd->base, compressed_data, compressed_size) >= compressed_size;
+  }
+  if (!read_ok) {
     MEM_freeN(compressed_data);
     MEM_freeN(uncompressed_data);
     return nullptr;
   }
 
   size_t res = ZSTD_decompressDCtx(
-      zstd->ctx, uncompressed_data, uncompressed_size, compressed_data, compressed_size);
+      ctx, uncompressed_data, uncompressed_size, compressed_data, compressed_size);
   MEM_freeN(compressed_data);
   if (ZSTD_isError(res) || res < uncompressed_size) {
     MEM_freeN(uncompressed_data);
     return nullptr;
   }
 
+  return uncompressed_data;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Read-Ahead
+ * \{ */
+
+/* Decompress the frame of a pending slot, unless somebody else already claimed it. */
+static void zstd_readahead_slot_run(ZstdReadaheadSlot *slot, ZSTD_DCtx *ctx)
+{
+  ZstdFrameState expected = ZstdFrameState::Pending;
+  if (!slot->state.compare_exchange_strong(expected, ZstdFrameState::Running)) {
+    return;
+  }
+
+  char *content = zstd_decompress_frame(slot->zstd, ctx, slot->frame);
+
+  ZstdReadahead *readahead = slot->zstd->readahead;
+  {
+    std::lock_guard lock(readahead->state_mutex);
+    slot->content = content;
+    slot->state = ZstdFrameState::Done;
+  }
+  readahead->state_cond.notify_all();
+}
+
+static void zstd_readahead_task(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  ZstdReadaheadSlot *slot = static_cast<ZstdReadaheadSlot *>(taskdata);
+  if (slot->state != ZstdFrameState::Pending) {
+    return;
+  }
+  ZSTD_DCtx *ctx = ZSTD_createDCtx();
+  zstd_readahead_slot_run(slot, ctx);
+  ZSTD_freeDCtx(ctx);
+}
+
+/* Wait until the slot is decompressed, doing the work on this thread if it wasn't started yet. */
+static void zstd_readahead_slot_wait(ZstdReader *zstd, ZstdReadaheadSlot *slot)
+{
+  zstd_readahead_slot_run(slot, zstd->ctx);
+
+  ZstdReadahead *readahead = zstd->readahead;
+  std::unique_lock lock(readahead->state_mutex);
+  readahead->state_cond.wait(lock, [&]() { return slot->state == ZstdFrameState::Done; });
+}
+
+/* Drop a frame from the window without using its content. */
+static void zstd_readahead_slot_discard(ZstdReader *zstd, ZstdReadaheadSlot *slot)
+{
+  ZstdFrameState expected = ZstdFrameState::Pending;
+  if (!slot->state.compare_exchange_strong(expected, ZstdFrameState::Unused)) {
+    ZstdReadahead *readahead = zstd->readahead;
+    std::unique_lock lock(readahead->state_mutex);
+    readahead->state_cond.wait(lock, [&]() { return slot->state == ZstdFrameState::Done; });
+    slot->state = ZstdFrameState::Unused;
+  }
+  MEM_SAFE_FREE(slot->content);
+}
+
+static ZstdReadaheadSlot *zstd_readahead_slot(ZstdReadahead *readahead, int frame)
+{
+  return &readahead->slots[frame % readahead->slots.size()];
+}
+
+/* Schedule frames after the window until it is full or the last frame is reached. */
+static void zstd_readahead_fill(ZstdReader *zstd)
+{
+  ZstdReadahead *readahead = zstd->readahead;
+  while (readahead->window_end < zstd->seek.frames_num &&
+         readahead->window_end - readahead->window_start < readahead->slots.size())
+  {
+    ZstdReadaheadSlot *slot = zstd_readahead_slot(readahead, readahead->window_end);
+    BLI_assert(slot->state == ZstdFrameState::Unused && slot->content == nullptr);
+    slot->frame = readahead->window_end;
+    slot->state = ZstdFrameState::Pending;
+    BLI_task_pool_push(readahead->pool, zstd_readahead_task, slot, false, nullptr);
+    readahead->window_end++;
+  }
+}
+
+/* Discard the whole window and restart it at the given frame, used for backward seeks. */
+static void zstd_readahead_reset(ZstdReader *zstd, int frame)
+{
+  ZstdReadahead *readahead = zstd->readahead;
+
+  /* Tasks can't be removed from a pool, so replace it. Cancel waits for running tasks. */
+  BLI_task_pool_cancel(readahead->pool);
+  BLI_task_pool_free(readahead->pool);
+  readahead->pool = BLI_task_pool_create(nullptr, TASK_PRIORITY_HIGH);
+
+  for (int i = readahead->window_start; i < readahead->window_end; i++) {
+    zstd_readahead_slot_discard(zstd, zstd_readahead_slot(readahead, i));
+  }
+  readahead->window_start = frame;
+  readahead->window_end = frame;
+}
+
+/* Take the decompressed frame out of the window, the caller owns the returned memory. */
+static char *zstd_readahead_take(ZstdReader *zstd, int frame)
+{
+  ZstdReadahead *readahead = zstd->readahead;
+
+  if (frame < readahead->window_start || frame >= readahead->window_end) {
+    zstd_readahead_reset(zstd, frame);
+  }
+  /* Frames that are skipped by seeking forward are not needed anymore. */
+  for (; readahead->window_start < frame; readahead->window_start++) {
+    zstd_readahead_slot_discard(zstd, zstd_readahead_slot(readahead, readahead->window_start));
+  }
+  /* Make sure the requested frame is in the window and the frames after it are scheduled before
+   * waiting, so workers can make progress meanwhile. */
+  zstd_readahead_fill(zstd);
+
+  ZstdReadaheadSlot *slot = zstd_readahead_slot(readahead, frame);
+  zstd_readahead_slot_wait(zstd, slot);
+
+  char *content = slot->content;
+  slot->content = nullptr;
+  slot->state = ZstdFrameState::Unused;
+  readahead->window_start++;
+
+  /* Keep the window full. */
+  zstd_readahead_fill(zstd);
+
+  return content;
+}
+
+static void zstd_readahead_init(ZstdReader *zstd)
+{
+  const int threads_num = BLI_task_scheduler_num_threads();
+  if (threads_num <= 1 || zstd->seek.frames_num <= 1) {
+    return;
+  }
+
+  const int slots_num = std::min({threads_num * ZSTD_READAHEAD_FRAMES_PER_THREAD,
+                                  ZSTD_READAHEAD_FRAMES_MAX,
+                                  zstd->seek.frames_num});
+  ZstdReadahead *readahead = MEM_new<ZstdReadahead>(__func__, slots_num);
+  readahead->pool = BLI_task_pool_create(nullptr, TASK_PRIORITY_HIGH);
+  for (ZstdReadaheadSlot &slot : readahead->slots) {
+    slot.zstd = zstd;
+  }
+  zstd->readahead = readahead;
+}
+
+static void zstd_readahead_free(ZstdReader *zstd)
+{
+  ZstdReadahead *readahead = zstd->readahead;
+
+  BLI_task_pool_cancel(readahead->pool);
+  BLI_task_pool_free(readahead->pool);
+
+  for (int i = readahead->window_start; i < readahead->window_end; i++) {
+    zstd_readahead_slot_discard(zstd, zstd_readahead_slot(readahead, i));
+  }
+  MEM_delete(readahead);
+  zstd->readahead = nullptr;
+}
+
+/** \} */
+
+/* Ensure that the currently loaded frame is the correct one. */
+static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
+{
+  if (zstd->seek.cached_frame == frame) {
+    /* Cached frame matches, so just return it. */
+    return zstd->seek.cached_content;
+  }
+
+  /* Cached frame doesn't match, so discard it and cache the wanted one instead. */
+  MEM_SAFE_FREE(zstd->seek.cached_content);
+  zstd->seek.cached_frame = -1;
+
+  char *uncompressed_data = zstd->readahead ? zstd_readahead_take(zstd, frame) :
+                                              zstd_decompress_frame(zstd, zstd->ctx, frame);
+  if (uncompressed_data == nullptr) {
+    return nullptr;
+  }
+
   zstd->seek.cached_frame = frame;
   zstd->seek.cached_content = uncompressed_data;
   return uncompressed_data;
@@ -282,6 +522,9 @@ static void zstd_close(FileReader *reader)
 {
   ZstdReader *zstd = (ZstdReader *)reader;
 
+  if (zstd->readahead) {
+    zstd_readahead_free(zstd);
+  }
   ZSTD_freeDCtx(zstd->ctx);
   if (zstd->reader.seek) {
     MEM_freeN(zstd->seek.uncompressed_ofs);
@@ -299,7 +542,7 @@ static void zstd_close(FileReader *reader)
   MEM_freeN(zstd);
 }
 
-FileReader *BLI_filereader_new_zstd(FileReader *base)
+static FileReader *zstd_filereader_new(FileReader *base, const bool use_threads)
 {
   ZstdReader *zstd = MEM_callocN<ZstdReader>(__func__);
 
@@ -309,6 +552,9 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
   if (zstd_read_seek_table(zstd)) {
     zstd->reader.read = zstd_read_seekable;
     zstd->reader.seek = zstd_seek;
+    if (use_threads) {
+      zstd_readahead_init(zstd);
+    }
   }
   else {
     zstd->reader.read = zstd_read;
@@ -328,3 +574,13 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
 
   return (FileReader *)zstd;
 }
+
+FileReader *BLI_filereader_new_zstd(FileReader *base)
+{
+  return zstd_filereader_new(base, false);
+}
+
+FileReader *BLI_filereader_new_zstd_threaded(FileReader *base)
+{
+  return zstd_filereader_new(base, true);
+}
@@ -0,0 +1,183 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "BLI_bounds_types.hh"
+#include "BLI_index_mask.hh"
+#include "BLI_kdtree.hh"
+#include "BLI_task.hh"
+
+namespace blender::kdtree {
+
+/** Subtrees with more points are built in parallel. */
+static constexpr int parallel_build_threshold = 4096;
+
+static KDTree::Node make_node(const float3 &position, const int index)
+{
+  BLI_assert(uint32_t(index) <= KDTree::index_mask);
+  KDTree::Node node;
+  /* NaN coordinates would break the ordering that the tree is built with. Such points are moved
+   * far away instead, so they are never found in practice. */
+  for (const int axis : IndexRange(3)) {
+    node.co[axis] = std::isnan(position[axis]) ? FLT_MAX : position[axis];
+  }
+  node.index_and_axis = uint32_t(index);
+  return node;
+}
+
+KDTree::KDTree(const Span<float3> positions) : nodes_(positions.size(), NoInitialization())
+{
+  threading::parallel_for(positions.index_range(), 4096, [&](const IndexRange range) {
+    for (const int i : range) {
+      nodes_[i] = make_node(positions[i], i);
+    }
+  });
+  this->build();
+}
+
+KDTree::KDTree(const Span<float3> positions, const IndexMask &mask)
+    : nodes_(mask.size(), NoInitialization())
+{
+  mask.foreach_index_optimized<int>(GrainSize(4096), [&](const int i, const int pos) {
+    nodes_[pos] = make_node(positions[i], i);
+  });
+  this->build();
+}
+
+static Bounds<float3> nodes_bounds(const Span<KDTree::Node> nodes)
+{
+  const Bounds<float3> init{float3(FLT_MAX), float3(-FLT_MAX)};
+  return threading::parallel_reduce(
+      nodes.index_range(),
+      16384,
+      init,
+      [&](const IndexRange range, Bounds<float3> bounds) {
+        for (const KDTree::Node &node : nodes.slice(range)) {
+          bounds.min = math::min(bounds.min, node.co);
+          bounds.max = math::max(bounds.max, node.co);
+        }
+        return bounds;
+      },
+      [](const Bounds<float3> &a, const Bounds<float3> &b) {
+        return Bounds<float3>{math::min(a.min, b.min), math::max(a.max, b.max)};
+      });
+}
+
+/**
+ * Split the points at the median along the axis with the largest extent, so that the median ends
+ * up in the middle of the span, then build both halves.
+ */
+static void build_subtree(MutableSpan<KDTree::Node> nodes)
+{
+  if (nodes.size() <= KDTree::leaf_size) {
+    return;
+  }
+  const Bounds<float3> bounds = nodes_bounds(nodes);
+  const int axis = math::dominant_axis(bounds.max - bounds.min);
+  const int64_t mid = nodes.size() / 2;
+  std::nth_element(
+      nodes.begin(),
+      nodes.begin() + mid,
+      nodes.end(),
+      [&](const KDTree::Node &a, const KDTree::Node &b) { return a.co[axis] < b.co[axis]; });
+  nodes[mid].index_and_axis |= uint32_t(axis) << KDTree::axis_shift;
+
+  threading::parallel_invoke(
+      nodes.size() > parallel_build_threshold,
+      [&]() { build_subtree(nodes.take_front(mid)); },
+      [&]() { build_subtree(nodes.drop_front(mid + 1)); });
+}
+
+void KDTree::build()
+{
+  BLI_assert(nodes_.size() <= int64_t(index_mask) + 1);
+  build_subtree(nodes_);
+}
+
+int KDTree::find_nearest_n(const float3 &co,
+                           MutableSpan<int> r_indices,
+                           MutableSpan<float> r_distances_sq) const
+{
+  const int k = int(r_indices.size());
+  BLI_assert(r_distances_sq.is_empty() || r_distances_sq.size() == k);
+  r_indices.fill(-1);
+  if (k == 0) {
+    return 0;
+  }
+  /* Sorted by distance and index, so that results don't depend on the tree structure. */
+  Array<float, 16> distances_sq(k, FLT_MAX);
+  int found_num = 0;
+  float max_distance_sq = FLT_MAX;
+
+  this->traverse(co, max_distance_sq, [&](const Node &node) {
+    const float distance_sq = math::distance_squared(co, node.co);
+    const int index = node.index();
+    if (found_num == k) {
+      const float worst_distance_sq = distances_sq[k - 1];
+      if (distance_sq > worst_distance_sq ||
+          (distance_sq == worst_distance_sq && index > r_indices[k - 1]))
+      {
+        return;
+      }
+    }
+    else {
+      found_num++;
+    }
+    int i = found_num - 1;
+    while (i > 0 && (distances_sq[i - 1] > distance_sq ||
+                     (distances_sq[i - 1] == distance_sq && r_indices[i - 1] > index)))
+    {
+      distances_sq[i] = distances_sq[i - 1];
+      r_indices[i] = r_indices[i - 1];
+      i--;
+    }
+    distances_sq[i] = distance_sq;
+    r_indices[i] = index;
+    if (found_num == k) {
+      max_distance_sq = distances_sq[k - 1];
+    }
+  });
+
+  if (!r_distances_sq.is_empty()) {
+    r_distances_sq.copy_from(distances_sq);
+  }
+  return found_num;
+}
+
+void KDTree::find_nearest(const Span<float3> query_positions,
+                          const IndexMask &mask,
+                          MutableSpan<int> r_indices,
+                          MutableSpan<float> r_distances_sq) const
+{
+  mask.foreach_index(GrainSize(512), [&](const int64_t i) {
+    float distance_sq;
+    r_indices[i] = this->find_nearest(query_positions[i], &distance_sq);
+    if (!r_distances_sq.is_empty()) {
+      r_distances_sq[i] = distance_sq;
+    }
+  });
+}
+
+void KDTree::find_nearest_n(const Span<float3> query_positions,
+                            const IndexMask &mask,
+                            const int k,
+                            MutableSpan<int> r_indices,
+                            MutableSpan<float> r_distances_sq) const
+{
+  mask.foreach_index(GrainSize(512), [&](const int64_t i) {
+    const IndexRange range(i * k, k);
+    this->find_nearest_n(query_positions[i],
+                         r_indices.slice(range),
+                         r_distances_sq.is_empty() ? MutableSpan<float>() :
+                                                     r_distances_sq.slice(range));
+  });
+}
+
+}  // namespace blender::kdtree
@@ -789,6 +789,112 @@ TEST(array_store, TestChunk_Rand31_Stride11_Chunk21)
   random_chunk_mutate_helper(31, 100, 11, 21, 7117);
 }
 
+/* -------------------------------------------------------------------- */
+/* Compressed States Test */
+
+/** Text sentences which share most of their content, with every state referencing the last. */
+static void compress_text_populate(BArrayStore *bs, ListBase *lb, const int sentences_len)
+{
+  BLI_listbase_clear(lb);
+  const char *text = words10k;
+  size_t text_len = 0;
+  for (int i = 0; i < sentences_len; i++) {
+    text_len += strcspn(&text[text_len], ".") + 1;
+    testbuffer_list_state_from_data(lb, text, text_len);
+  }
+  testbuffer_list_store_populate(bs, lb);
+}
+
+TEST(array_store, CompressStates)
+{
+  ListBase lb;
+  BArrayStore *bs = BLI_array_store_create(1, 256);
+  compress_text_populate(bs, &lb, 40);
+  const size_t size_uncompressed = BLI_array_store_calc_size_compacted_get(bs);
+
+  /* Chunks shared with the last state must stay uncompressed. */
+  TestBuffer *tb_last = (TestBuffer *)lb.last;
+  LISTBASE_FOREACH (TestBuffer *, tb, &lb) {
+    if (tb != tb_last) {
+      BLI_array_store_state_compress(bs, tb->state);
+      EXPECT_TRUE(BLI_array_store_state_is_compressed(tb->state));
+    }
+  }
+  EXPECT_FALSE(BLI_array_store_state_is_compressed(tb_last->state));
+  EXPECT_TRUE(BLI_array_store_is_valid(bs));
+  EXPECT_TRUE(testbuffer_list_validate(&lb));
+  const size_t size_compressed = BLI_array_store_calc_size_compacted_get(bs);
+  EXPECT_LT(size_compressed, size_uncompressed);
+
+  /* Compressing again does nothing. */
+  BLI_array_store_state_compress(bs, ((TestBuffer *)lb.first)->state);
+  EXPECT_EQ(BLI_array_store_calc_size_compacted_get(bs), size_compressed);
+
+  /* A compressed reference is ignored. */
+  TestBuffer *tb_first = (TestBuffer *)lb.first;
+  TestBuffer *tb_new = testbuffer_list_add_copydata(&lb, tb_first->data, tb_first->data_len);
+  tb_new->state = BLI_array_store_state_add(bs, tb_new->data, tb_new->data_len, tb_first->state);
+  EXPECT_TRUE(BLI_array_store_is_valid(bs));
+  EXPECT_TRUE(testbuffer_list_validate(&lb));
+
+  /* Decompressing restores the original sharing. */
+  BLI_array_store_state_remove(bs, tb_new->state);
+  tb_new->state = nullptr;
+  BLI_remlink(&lb, tb_new);
+  MEM_freeN((void *)tb_new->data);
+  MEM_freeN(tb_new);
+  LISTBASE_FOREACH (TestBuffer *, tb, &lb) {
+    BLI_array_store_state_decompress(bs, tb->state);
+    EXPECT_FALSE(BLI_array_store_state_is_compressed(tb->state));
+  }
+  EXPECT_TRUE(BLI_array_store_is_valid(bs));
+  EXPECT_TRUE(testbuffer_list_validate(&lb));
+  EXPECT_EQ(BLI_array_store_calc_size_compacted_get(bs), size_uncompressed);
+
+  testbuffer_list_store_clear(bs, &lb);
+  testbuffer_list_free(&lb);
+  BLI_array_store_destroy(bs);
+}
+
+TEST(array_store, CompressRemoveStates)
+{
+  ListBase lb;
+  BArrayStore *bs = BLI_array_store_create(1, 256);
+  compress_text_populate(bs, &lb, 40);
+
+  int i = 0;
+  LISTBASE_FOREACH (TestBuffer *, tb, &lb) {
+    if (i++ % 2) {
+      BLI_array_store_state_compress(bs, tb->state);
+    }
+  }
+  EXPECT_TRUE(BLI_array_store_is_valid(bs));
+
+  /* Remove states in a shuffled order, checking the remaining ones. */
+  const int states_len = BLI_listbase_count(&lb);
+  TestBuffer **tb_array = MEM_malloc_arrayN<TestBuffer *>(size_t(states_len), __func__);
+  i = 0;
+  LISTBASE_FOREACH (TestBuffer *, tb, &lb) {
+    tb_array[i++] = tb;
+  }
+  RNG *rng = BLI_rng_new(4181);
+  BLI_rng_shuffle_array(rng, tb_array, sizeof(TestBuffer *), uint(states_len));
+  BLI_rng_free(rng);
+  for (i = 0; i < states_len; i++) {
+    TestBuffer *tb = tb_array[i];
+    BLI_array_store_state_remove(bs, tb->state);
+    BLI_remlink(&lb, tb);
+    MEM_freeN((void *)tb->data);
+    MEM_freeN(tb);
+    EXPECT_TRUE(BLI_array_store_is_valid(bs));
+    EXPECT_TRUE(testbuffer_list_validate(&lb));
+  }
+  MEM_freeN(tb_array);
+  EXPECT_EQ(BLI_array_store_calc_size_compacted_get(bs), 0);
+
+  BLI_array_store_destroy(bs);
+}
+
 #if 0
 /* -------------------------------------------------------------------- */
 
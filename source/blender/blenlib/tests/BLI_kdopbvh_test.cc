@@ -8,10 +8,15 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_compiler_attrs.h"
+#include "BLI_index_mask.hh"
 #include "BLI_kdopbvh.hh"
 #include "BLI_math_vector.h"
+#include "BLI_math_vector.hh"
 #include "BLI_rand.h"
+#include "BLI_rand.hh"
+#include "BLI_task.hh"
 
 /* -------------------------------------------------------------------- */
 /* Helper Functions */
@@ -134,3 +139,251 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* -------------------------------------------------------------------- */
+/* BVH4 Tests */
+
+namespace blender::tests {
+
+static constexpr float BVH4_TEST_RADIUS = 0.05f;
+
+/** Ray-cast against spheres around the points. */
+static void sphere_raycast_callback(void *userdata,
+                                    const int index,
+                                    const BVHTreeRay *ray,
+                                    BVHTreeRayHit *hit)
+{
+  const float3 &center = static_cast<const float3 *>(userdata)[index];
+  const float3 to_center = center - float3(ray->origin);
+  const float center_dist = math::dot(to_center, float3(ray->direction));
+  const float ray_dist_sq = math::length_squared(to_center) - center_dist * center_dist;
+  const float radius_sq = BVH4_TEST_RADIUS * BVH4_TEST_RADIUS;
+  if (ray_dist_sq > radius_sq) {
+    return;
+  }
+  const float dist = center_dist - std::sqrt(radius_sq - ray_dist_sq);
+  if (dist >= 0.0f && dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+static void point_nearest_callback(void *userdata,
+                                   const int index,
+                                   const float co[3],
+                                   BVHTreeNearest *nearest)
+{
+  const float3 &point = static_cast<const float3 *>(userdata)[index];
+  const float dist_sq = math::distance_squared(float3(co), point);
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+  }
+}
+
+static BVHTree *bvh4_test_tree_new(const Span<float3> points, const int flag)
+{
+  BVHTree *tree = BLI_bvhtree_new(int(points.size()), BVH4_TEST_RADIUS, 2, 6);
+  for (const int i : points.index_range()) {
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance_ex(tree, flag);
+  return tree;
+}
+
+static Array<float3> bvh4_random_points(const int points_num, const uint32_t seed)
+{
+  RandomNumberGenerator rng(seed);
+  Array<float3> points(points_num);
+  for (float3 &point : points) {
+    point = float3(rng.get_float(), rng.get_float(), rng.get_float()) * 2.0f - 1.0f;
+  }
+  return points;
+}
+
+static void bvh4_compare_test(const int points_num)
+{
+  const Array<float3> points = bvh4_random_points(points_num, points_num);
+  BVHTree *kdop_tree = bvh4_test_tree_new(points, 0);
+  BVHTree *bvh4_tree = bvh4_test_tree_new(points, BVH_BALANCE_BUILD_BVH4);
+  void *userdata = const_cast<float3 *>(points.data());
+
+  RandomNumberGenerator rng(0);
+  for ([[maybe_unused]] const int i : IndexRange(200)) {
+    const float3 co = float3(rng.get_float(), rng.get_float(), rng.get_float()) * 3.0f - 1.5f;
+    const float3 dir = rng.get_unit_float3();
+
+    BVHTreeRayHit kdop_hit{};
+    kdop_hit.index = -1;
+    kdop_hit.dist = BVH_RAYCAST_DIST_MAX;
+    BVHTreeRayHit bvh4_hit = kdop_hit;
+    BLI_bvhtree_ray_cast(kdop_tree, co, dir, 0.0f, &kdop_hit, sphere_raycast_callback, userdata);
+    BLI_bvhtree_ray_cast(bvh4_tree, co, dir, 0.0f, &bvh4_hit, sphere_raycast_callback, userdata);
+    EXPECT_EQ(kdop_hit.dist, bvh4_hit.dist);
+
+    BVHTreeNearest kdop_nearest{};
+    kdop_nearest.index = -1;
+    kdop_nearest.dist_sq = FLT_MAX;
+    BVHTreeNearest bvh4_nearest = kdop_nearest;
+    BLI_bvhtree_find_nearest(kdop_tree, co, &kdop_nearest, point_nearest_callback, userdata);
+    BLI_bvhtree_find_nearest(bvh4_tree, co, &bvh4_nearest, point_nearest_callback, userdata);
+    EXPECT_EQ(kdop_nearest.dist_sq, bvh4_nearest.dist_sq);
+  }
+
+  BLI_bvhtree_free(kdop_tree);
+  BLI_bvhtree_free(bvh4_tree);
+}
+
+TEST(kdopbvh, BVH4Compare_1)
+{
+  bvh4_compare_test(1);
+}
+TEST(kdopbvh, BVH4Compare_5)
+{
+  bvh4_compare_test(5);
+}
+TEST(kdopbvh, BVH4Compare_5000)
+{
+  bvh4_compare_test(5000);
+}
+
+TEST(kdopbvh, BVH4Batch)
+{
+  const Array<float3> points = bvh4_random_points(1000, 1);
+  BVHTree *tree = bvh4_test_tree_new(points, BVH_BALANCE_BUILD_BVH4);
+  void *userdata = const_cast<float3 *>(points.data());
+
+  /* The batched queries should give the same results as single queries. */
+  const Array<float3> origins = bvh4_random_points(points.size(), 2);
+  Array<float3> directions(points.size(), float3(0.0f, 0.0f, -1.0f));
+  Array<BVHTreeRayHit> hits(points.size());
+  Array<BVHTreeNearest> nearest(points.size());
+  for (const int i : points.index_range()) {
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+  }
+  BLI_bvhtree_ray_cast_batch(*tree,
+                             origins,
+                             directions,
+                             0.0f,
+                             points.index_range(),
+                             hits,
+                             sphere_raycast_callback,
+                             userdata);
+  BLI_bvhtree_find_nearest_batch(
+      *tree, points, points.index_range(), nearest, point_nearest_callback, userdata);
+  for (const int i : points.index_range()) {
+    BVHTreeRayHit hit{};
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(
+        tree, origins[i], directions[i], 0.0f, &hit, sphere_raycast_callback, userdata);
+    EXPECT_EQ(hits[i].index, hit.index);
+    EXPECT_EQ(nearest[i].index, i);
+  }
+
+  BLI_bvhtree_free(tree);
+}
+
+TEST(kdopbvh, BVH4Ensure)
+{
+  const Array<float3> points = bvh4_random_points(5000, 4);
+  BVHTree *tree = bvh4_test_tree_new(points, 0);
+  void *userdata = const_cast<float3 *>(points.data());
+  const Array<float3> origins = bvh4_random_points(1000, 5);
+
+  /* Adding the BVH4 tree while other threads query the tree does not change the results. */
+  Array<int> hit_indices(origins.size());
+  threading::parallel_for(origins.index_range(), 1, [&](const IndexRange range) {
+    for (const int i : range) {
+      if (i % 100 == 0) {
+        BLI_bvhtree_ensure_bvh4(tree);
+      }
+      BVHTreeRayHit hit{};
+      hit.index = -1;
+      hit.dist = BVH_RAYCAST_DIST_MAX;
+      BLI_bvhtree_ray_cast(tree,
+                           origins[i],
+                           float3(0.0f, 0.0f, -1.0f),
+                           0.0f,
+                           &hit,
+                           sphere_raycast_callback,
+                           userdata);
+      hit_indices[i] = hit.index;
+    }
+  });
+
+  BVHTree *kdop_tree = bvh4_test_tree_new(points, 0);
+  for (const int i : origins.index_range()) {
+    BVHTreeRayHit hit{};
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(kdop_tree,
+                         origins[i],
+                         float3(0.0f, 0.0f, -1.0f),
+                         0.0f,
+                         &hit,
+                         sphere_raycast_callback,
+                         userdata);
+    EXPECT_EQ(hit_indices[i], hit.index);
+  }
+
+  BLI_bvhtree_free(kdop_tree);
+  BLI_bvhtree_free(tree);
+}
+
+TEST(kdopbvh, CopyRefit)
+{
+  Array<float3> points = bvh4_random_points(5000, 3);
+  BVHTree *tree = bvh4_test_tree_new(points, BVH_BALANCE_BUILD_BVH4);
+  const float built_cost = BLI_bvhtree_get_sah_cost(tree);
+
+  /* Refitting a copy for moved points should give the same results as building a new tree, and
+   * should not change the original tree. */
+  for (const int i : points.index_range()) {
+    points[i] += float3(0.5f * float(i % 3), 0.0f, -0.25f * float(i % 5));
+  }
+  BVHTree *refit_tree = BLI_bvhtree_copy(tree);
+  for (const int i : points.index_range()) {
+    BLI_bvhtree_update_node(refit_tree, i, points[i], nullptr, 1);
+  }
+  BLI_bvhtree_update_tree(refit_tree);
+  BVHTree *new_tree = bvh4_test_tree_new(points, BVH_BALANCE_BUILD_BVH4);
+
+  /* The moved points are mixed up, so the bounds of the refit tree overlap much more. */
+  EXPECT_GT(BLI_bvhtree_get_sah_cost(refit_tree), BLI_bvhtree_get_sah_cost(new_tree));
+  EXPECT_EQ(BLI_bvhtree_get_sah_cost(tree), built_cost);
+
+  RandomNumberGenerator rng(0);
+  for ([[maybe_unused]] const int i : IndexRange(200)) {
+    const float3 co = float3(rng.get_float(), rng.get_float(), rng.get_float()) * 3.0f - 1.5f;
+    const float3 dir = rng.get_unit_float3();
+
+    BVHTreeRayHit new_hit{};
+    new_hit.index = -1;
+    new_hit.dist = BVH_RAYCAST_DIST_MAX;
+    BVHTreeRayHit refit_hit = new_hit;
+    BLI_bvhtree_ray_cast(
+        new_tree, co, dir, 0.0f, &new_hit, sphere_raycast_callback, points.data());
+    BLI_bvhtree_ray_cast(
+        refit_tree, co, dir, 0.0f, &refit_hit, sphere_raycast_callback, points.data());
+    EXPECT_EQ(new_hit.dist, refit_hit.dist);
+
+    BVHTreeNearest new_nearest{};
+    new_nearest.index = -1;
+    new_nearest.dist_sq = FLT_MAX;
+    BVHTreeNearest refit_nearest = new_nearest;
+    BLI_bvhtree_find_nearest(new_tree, co, &new_nearest, point_nearest_callback, points.data());
+    BLI_bvhtree_find_nearest(
+        refit_tree, co, &refit_nearest, point_nearest_callback, points.data());
+    EXPECT_EQ(new_nearest.dist_sq, refit_nearest.dist_sq);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(refit_tree);
+  BLI_bvhtree_free(new_tree);
+}
+
+}  // namespace blender::tests
@@ -4,8 +4,13 @@
 
 #include "testing/testing.h"
 
+#include "BLI_array.hh"
+#include "BLI_index_mask.hh"
 #include "BLI_kdtree.h"
+#include "BLI_kdtree.hh"
+#include "BLI_rand.hh"
 
+#include <algorithm>
 #include <cmath>
 
 /* -------------------------------------------------------------------- */
@@ -63,3 +68,136 @@ TEST(kdtree, Deduplicate)
 {
   deduplicate_test();
 }
+
+namespace blender::kdtree::tests {
+
+static Array<float3> random_positions(const int size, const uint32_t seed)
+{
+  RandomNumberGenerator rng(seed);
+  Array<float3> positions(size);
+  for (float3 &position : positions) {
+    position = float3(rng.get_float(), rng.get_float(), rng.get_float()) * 2.0f - 1.0f;
+  }
+  return positions;
+}
+
+/** Nearest points sorted by distance and index, the order the tree is expected to return. */
+static Vector<int> find_nearest_brute_force(const Span<float3> positions,
+                                            const float3 &co,
+                                            const int k)
+{
+  Vector<int> indices(positions.index_range().begin(), positions.index_range().end());
+  std::sort(indices.begin(), indices.end(), [&](const int a, const int b) {
+    const float distance_a = math::distance_squared(co, positions[a]);
+    const float distance_b = math::distance_squared(co, positions[b]);
+    return distance_a < distance_b || (distance_a == distance_b && a < b);
+  });
+  indices.resize(std::min<int64_t>(k, indices.size()));
+  return indices;
+}
+
+TEST(kdtree_cpp, Empty)
+{
+  const KDTree tree(Span<float3>{});
+  EXPECT_TRUE(tree.is_empty());
+  EXPECT_EQ(tree.find_nearest(float3(0.0f)), -1);
+  Array<int> indices(2);
+  EXPECT_EQ(tree.find_nearest_n(float3(0.0f), indices), 0);
+  EXPECT_EQ(indices[0], -1);
+}
+
+TEST(kdtree_cpp, FindNearest)
+{
+  for (const int size : {1, 7, 8, 9, 100, 5000}) {
+    const Array<float3> positions = random_positions(size, size);
+    const KDTree tree(positions);
+    EXPECT_EQ(tree.size(), size);
+    const Array<float3> queries = random_positions(200, 0);
+    for (const float3 &co : queries) {
+      float distance_sq;
+      const int index = tree.find_nearest(co, &distance_sq);
+      EXPECT_EQ(index, find_nearest_brute_force(positions, co, 1)[0]);
+      EXPECT_FLOAT_EQ(distance_sq, math::distance_squared(co, positions[index]));
+    }
+  }
+}
+
+TEST(kdtree_cpp, FindNearestDuplicates)
+{
+  /* The smallest index is found for points with the same distance. */
+  Array<float3> positions = random_positions(1000, 1);
+  positions[10] = positions[500];
+  positions[900] = positions[500];
+  const KDTree tree(positions);
+  EXPECT_EQ(tree.find_nearest(positions[500]), 10);
+  EXPECT_EQ(tree.find_nearest(positions[500], nullptr, [](const int i) { return i != 10; }), 500);
+}
+
+TEST(kdtree_cpp, FindNearestN)
+{
+  const Array<float3> positions = random_positions(3000, 2);
+  const KDTree tree(positions);
+  const Array<float3> queries = random_positions(100, 3);
+  for (const float3 &co : queries) {
+    Array<int> indices(10);
+    EXPECT_EQ(tree.find_nearest_n(co, indices), 10);
+    EXPECT_EQ(indices.as_span(), find_nearest_brute_force(positions, co, 10).as_span());
+  }
+}
+
+TEST(kdtree_cpp, ForeachInRadius)
+{
+  const Array<float3> positions = random_positions(3000, 4);
+  const KDTree tree(positions);
+  const Array<float3> queries = random_positions(100, 5);
+  for (const float3 &co : queries) {
+    Vector<int> found;
+    tree.foreach_in_radius(co, 0.25f, [&](const int index, const float3 & /*co*/, float /*d*/) {
+      found.append(index);
+    });
+    std::sort(found.begin(), found.end());
+    Vector<int> expected;
+    for (const int i : positions.index_range()) {
+      if (math::distance_squared(co, positions[i]) <= 0.25f * 0.25f) {
+        expected.append(i);
+      }
+    }
+    EXPECT_EQ(found.as_span(), expected.as_span());
+  }
+}
+
+TEST(kdtree_cpp, Masked)
+{
+  const Array<float3> positions = random_positions(2000, 6);
+  IndexMaskMemory memory;
+  const IndexMask mask = IndexMask::from_predicate(
+      positions.index_range(), GrainSize(512), memory, [](const int i) { return i % 3 == 0; });
+  const KDTree tree(positions, mask);
+  EXPECT_EQ(tree.size(), mask.size());
+  Array<int> indices(positions.size());
+  tree.find_nearest(positions, positions.index_range(), indices);
+  for (const int i : positions.index_range()) {
+    EXPECT_EQ(indices[i] % 3, 0);
+    if (i % 3 == 0) {
+      EXPECT_EQ(indices[i], i);
+    }
+  }
+}
+
+TEST(kdtree_cpp, BatchedFindNearestN)
+{
+  const Array<float3> positions = random_positions(2000, 7);
+  const KDTree tree(positions);
+  const int k = 4;
+  Array<int> indices(positions.size() * k);
+  Array<float> distances_sq(positions.size() * k);
+  tree.find_nearest_n(positions, positions.index_range(), k, indices, distances_sq);
+  for (const int i : positions.index_range()) {
+    const Span<int> result = indices.as_span().slice(i * k, k);
+    EXPECT_EQ(result[0], i);
+    EXPECT_EQ(distances_sq[i * k], 0.0f);
+    EXPECT_EQ(result, find_nearest_brute_force(positions, positions[i], k).as_span());
+  }
+}
+
+}  // namespace blender::kdtree::tests
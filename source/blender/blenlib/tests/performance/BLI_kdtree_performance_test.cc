@@ -0,0 +1,84 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_array.hh"
+#include "BLI_index_mask.hh"
+#include "BLI_kdtree.h"
+#include "BLI_kdtree.hh"
+#include "BLI_rand.hh"
+#include "BLI_task.hh"
+#include "BLI_timeit.hh"
+
+namespace blender::kdtree::tests {
+
+static Array<float3> random_positions(const int size, const uint32_t seed)
+{
+  RandomNumberGenerator rng(seed);
+  Array<float3> positions(size);
+  for (float3 &position : positions) {
+    position = float3(rng.get_float(), rng.get_float(), rng.get_float());
+  }
+  return positions;
+}
+
+/**
+ * Compare building the tree and finding the nearest neighbors of all points with the
+ * incrementally built tree from `BLI_kdtree.h`.
+ */
+static void benchmark_find_nearest(const int size)
+{
+  std::cout << "Points: " << size << "\n";
+  const Array<float3> positions = random_positions(size, 0);
+  const Array<float3> queries = random_positions(size, 1);
+
+  Array<int> old_indices(size);
+  {
+    SCOPED_TIMER("Old tree");
+    KDTree_3d *tree = BLI_kdtree_3d_new(size);
+    {
+      SCOPED_TIMER("  Build");
+      for (const int i : positions.index_range()) {
+        BLI_kdtree_3d_insert(tree, i, positions[i]);
+      }
+      BLI_kdtree_3d_balance(tree);
+    }
+    {
+      SCOPED_TIMER("  Find nearest");
+      threading::parallel_for(queries.index_range(), 512, [&](const IndexRange range) {
+        for (const int i : range) {
+          old_indices[i] = BLI_kdtree_3d_find_nearest(tree, queries[i], nullptr);
+        }
+      });
+    }
+    BLI_kdtree_3d_free(tree);
+  }
+
+  Array<int> new_indices(size);
+  {
+    SCOPED_TIMER("New tree");
+    std::optional<KDTree> tree;
+    {
+      SCOPED_TIMER("  Build");
+      tree.emplace(positions);
+    }
+    {
+      SCOPED_TIMER("  Find nearest");
+      tree->find_nearest(queries, queries.index_range(), new_indices);
+    }
+  }
+
+  /* Ties are resolved differently, but are practically impossible with random positions. */
+  EXPECT_EQ(old_indices.as_span(), new_indices.as_span());
+}
+
+TEST(kdtree_performance, FindNearest)
+{
+  for (const int size : {10'000, 1'000'000}) {
+    benchmark_find_nearest(size);
+  }
+}
+
+}  // namespace blender::kdtree::tests
@@ -56,6 +56,11 @@ enum {
    * Terminate reading (no data).
    */
   BLO_CODE_ENDB = BLEND_MAKE_ID('E', 'N', 'D', 'B'),
+  /**
+   * Superseded block left in place by an incremental save,
+   * ignored on reading together with the #BLO_CODE_DATA blocks following it.
+   */
+  BLO_CODE_SKIP = BLEND_MAKE_ID('S', 'K', 'I', 'P'),
 };
 
 #define BLEN_THUMB_MEMSIZE_FILE(_x, _y) (sizeof(int) * (2 + (size_t)(_x) * (size_t)(_y)))
@@ -352,6 +352,10 @@ blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     BlendDataReader *reader,
     const void **ptr_p,
     blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn);
+const blender::ImplicitSharingInfo *blo_read_shared_mapped_impl(BlendDataReader *reader,
+                                                                const void **ptr_p,
+                                                                int64_t size_in_bytes,
+                                                                int64_t alignment);
 
 /**
  * Check if there is any shared data for the given data pointer. If yes, return the existing
@@ -371,6 +375,30 @@ const blender::ImplicitSharingInfo *BLO_read_shared(
   return shared_data.sharing_info;
 }
 
+/**
+ * Same as #BLO_read_shared, for arrays of plain data that don't need any conversion when read
+ * (no pointers, no DNA structs). When the file is read with #G_FILE_MMAP_DATA_SHARING, the data
+ * may be referenced directly in the memory mapped file instead of being copied. In that case
+ * `read_fn` is not called.
+ */
+template<typename T>
+const blender::ImplicitSharingInfo *BLO_read_shared_mapped(
+    BlendDataReader *reader,
+    T **data_ptr,
+    const int64_t size_in_bytes,
+    const int64_t alignment,
+    blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn)
+{
+  return BLO_read_shared(reader, data_ptr, [&]() -> const blender::ImplicitSharingInfo * {
+    if (const blender::ImplicitSharingInfo *sharing_info = blo_read_shared_mapped_impl(
+            reader, (const void **)data_ptr, size_in_bytes, alignment))
+    {
+      return sharing_info;
+    }
+    return read_fn();
+  });
+}
+
 int BLO_read_fileversion_get(BlendDataReader *reader);
 bool BLO_read_requires_endian_switch(BlendDataReader *reader);
 bool BLO_read_data_is_undo(BlendDataReader *reader);
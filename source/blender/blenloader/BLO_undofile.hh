@@ -18,6 +18,7 @@ class ImplicitSharingInfo;
 }
 struct Main;
 struct Scene;
+struct TaskPool;
 
 struct MemFileSharedStorage {
   /**
@@ -28,12 +29,48 @@ struct MemFileSharedStorage {
   ~MemFileSharedStorage();
 };
 
+/**
+ * Memory of a #MemFileChunk. Buffers are addressed by the hash of their content, so that every
+ * chunk with the same content in the whole undo history shares a single buffer, even when it
+ * is not at the same position as in the previous step (e.g. after data was inserted before it).
+ */
+struct MemFileChunkBuffer {
+  /** Hash of the content, used as key in the history-wide chunk store. */
+  uint64_t hash;
+  /** Size in bytes. */
+  size_t size;
+  /** Number of #MemFileChunk using this buffer, it is freed when the last one is freed. */
+  int users;
+  /**
+   * Number of users in memfiles that are not compressed. The buffer is compressed in the
+   * background once only compressed memfiles use it.
+   */
+  int hot_users;
+  /** False when another buffer with the same hash but different content is already stored. */
+  bool is_indexed;
+  /** A background task is compressing the buffer. */
+  bool is_compressing;
+  /** The uncompressed data, null while the buffer is compressed. */
+  char *data;
+  /** Zstd compressed data, only set while the buffer is compressed. */
+  void *compressed_data;
+  size_t compressed_size;
+};
+
 struct MemFileChunk {
   void *next, *prev;
+  /** The data of #buffer, only valid while the memfile is not compressed. */
   const char *buf;
   /** Size in bytes. */
   size_t size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** The (potentially shared) buffer owning the memory of #buf. */
+  MemFileChunkBuffer *buffer;
+  /** The buffer was created for this chunk, its memory is counted for this memfile. */
+  bool is_buffer_owner;
+  /**
+   * When true, this chunk is identical to the chunk at the same position in the previous step
+   * (used by undo code to detect unchanged IDs). Its buffer is shared with that chunk.
+   */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
@@ -46,7 +83,20 @@ struct MemFileChunk {
 
 struct MemFile {
   ListBase chunks;
+  /** Size of the chunk buffers that were allocated for this memfile. */
   size_t size;
+  /** Size of all chunks, including the ones sharing buffers with other memfiles. */
+  size_t size_total;
+  /**
+   * Size of the chunks that were not identical to the previous step at the same position, but
+   * could still share a buffer with the same content found elsewhere in the undo history.
+   */
+  size_t size_deduplicated;
+  /**
+   * The memfile is not expected to be read soon, its buffers may be compressed. It is
+   * decompressed automatically when it is read or used as reference for writing.
+   */
+  bool is_compressed;
   /**
    * Some data is not serialized into a new buffer because the undo-step can take ownership of it
    * without making a copy. This is faster and requires less memory.
@@ -88,6 +138,11 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
                             MemFile *reference_memfile);
 void BLO_memfile_write_finalize(MemFileWriteData *mem_data);
 
+/**
+ * Add written data to the memfile. Data is split at content-defined boundaries, so that changes
+ * don't shift the chunk boundaries of the data following them, and every chunk shares its buffer
+ * with any chunk of the undo history that has the same content.
+ */
 void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size);
 
 /* exports */
@@ -108,6 +163,39 @@ void BLO_memfile_merge(MemFile *first, MemFile *second);
  */
 void BLO_memfile_clear_future(MemFile *memfile);
 
+/**
+ * Mark the memfile as unlikely to be read soon. Chunk buffers that are not used by other
+ * uncompressed memfiles are compressed by tasks pushed to the given pool.
+ */
+void BLO_memfile_compress(MemFile *memfile, TaskPool *task_pool);
+/**
+ * Decompress the memfile chunk buffers, so that #MemFileChunk.buf is valid again.
+ */
+void BLO_memfile_decompress(MemFile *memfile);
+/**
+ * The memory used by the chunk buffers that were allocated for this memfile, counting the
+ * compressed size of buffers which are currently compressed.
+ */
+size_t BLO_memfile_memory_size(const MemFile *memfile);
+
+/** Memory statistics of the chunk buffers shared by all memfiles of the undo history. */
+struct MemFileChunkStoreStats {
+  /** Number of bytes referenced by the chunks of all memfiles. */
+  size_t size_referenced;
+  /** Number of bytes of data of all chunk buffers, when uncompressed. */
+  size_t size_stored;
+  /** Uncompressed size of the chunk buffers that are currently compressed. */
+  size_t size_stored_compressed;
+  /** Size of the compressed data of these buffers. */
+  size_t size_compressed;
+  /** Total time spent compressing in background tasks, in seconds. */
+  double time_compress;
+  /** Total time spent decompressing on demand, in seconds. */
+  double time_decompress;
+};
+
+MemFileChunkStoreStats BLO_memfile_chunk_store_stats();
+
 /* Utilities. */
 
 Main *BLO_memfile_main_get(MemFile *memfile, Main *bmain, Scene **r_scene);
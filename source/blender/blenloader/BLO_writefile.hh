@@ -11,6 +11,7 @@
 
 #include "BLI_sys_types.h"
 
+struct BlendFileWriteSnapshot;
 struct BlendThumbnail;
 struct Main;
 struct MemFile;
@@ -62,3 +63,28 @@ extern bool BLO_write_file(Main *mainvar,
 extern bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int write_flags);
 
 /** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name BLO Write Snapshot API
+ *
+ * Split file saving in a (fast) serialization of \a mainvar in memory, and writing the file
+ * from it, which can be done on another thread while \a mainvar keeps being edited.
+ * \{ */
+
+/**
+ * Serialize \a mainvar in memory. Implicitly shared data is referenced by the snapshot instead of
+ * being copied.
+ */
+extern BlendFileWriteSnapshot *BLO_write_snapshot_create(Main *mainvar, int write_flags);
+/**
+ * Write the file from a snapshot, can be called from any thread.
+ *
+ * \return Success.
+ */
+extern bool BLO_write_snapshot_file(const BlendFileWriteSnapshot *snapshot,
+                                    const char *filepath,
+                                    int write_flags,
+                                    ReportList *reports);
+extern void BLO_write_snapshot_free(BlendFileWriteSnapshot *snapshot);
+
+/** \} */
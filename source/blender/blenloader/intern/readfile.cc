@@ -50,6 +50,7 @@
 #include "BLI_ghash.h"
 #include "BLI_map.hh"
 #include "BLI_memarena.h"
+#include "BLI_mmap.h"
 #include "BLI_string.h"
 #include "BLI_string_ref.hh"
 #include "BLI_threads.h"
@@ -247,8 +248,17 @@ struct NewAddress {
   int nr;
 };
 
+/** A data block that is only read when its address is looked up, see #BlendFileMapping. */
+struct DeferredDataBlock {
+  BHead *bhead;
+  const char *allocname;
+  int id_type_index;
+};
+
 struct OldNewMap {
   blender::Map<const void *, NewAddress> map;
+  /** Data blocks that are not read into #map yet, only used for the #FileData.datamap. */
+  blender::Map<const void *, DeferredDataBlock> deferred;
 };
 
 static OldNewMap *oldnewmap_new()
@@ -320,6 +330,7 @@ static void oldnewmap_clear(OldNewMap *onm)
     }
   }
   onm->map.clear();
+  onm->deferred.clear();
 }
 
 static void oldnewmap_free(OldNewMap *onm)
@@ -1110,6 +1121,110 @@ static int *read_file_thumbnail(FileData *fd)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Memory Mapped Data Sharing
+ *
+ * With #G_FILE_MMAP_DATA_SHARING, uncompressed files are read from a copy-on-write memory
+ * mapping. Large data blocks are not copied into #FileData.datamap when their ID is read, instead
+ * they are deferred: code reading plain data with #BLO_read_shared_mapped references the block
+ * directly in the mapping, any other lookup reads the block as usual at that point. Parts of the
+ * file that are never accessed are not loaded into memory at all.
+ * \{ */
+
+/** Data blocks smaller than this are always copied, sharing them isn't worth a page. */
+#define MMAP_DATA_SHARING_MIN_SIZE (1 << 16) /* 64kb */
+
+/** Keeps the memory mapping alive as long as any data in it is referenced. */
+struct BlendFileMapping : public blender::ImplicitSharingMixin {
+  BLI_mmap_file *mmap_file;
+
+  BlendFileMapping(BLI_mmap_file *mmap_file) : mmap_file(mmap_file) {}
+
+ private:
+  void delete_self() override
+  {
+    BLI_mmap_free(mmap_file);
+    MEM_delete(this);
+  }
+};
+
+/**
+ * Sharing info for data referenced directly in the mapping. Modifying the data in place is fine
+ * because the mapping is private, the kernel copies the affected pages on the first write.
+ */
+class MappedDataImplicitSharing : public blender::ImplicitSharingInfo {
+ private:
+  const BlendFileMapping *mapping_;
+
+ public:
+  MappedDataImplicitSharing(const BlendFileMapping &mapping) : mapping_(&mapping)
+  {
+    mapping_->add_user();
+  }
+
+ private:
+  void delete_self_with_data() override
+  {
+    this->delete_data_only();
+    MEM_delete(this);
+  }
+
+  void delete_data_only() override
+  {
+    if (mapping_) {
+      mapping_->remove_user_and_delete_if_last();
+      mapping_ = nullptr;
+    }
+  }
+};
+
+static FileReader *blo_filereader_new_shared_mapping(const int filedes,
+                                                      BlendFileMapping **r_mapping)
+{
+  BLI_mmap_file *mmap_file = BLI_mmap_open_copy_on_write(filedes);
+  if (mmap_file == nullptr) {
+    return nullptr;
+  }
+  *r_mapping = MEM_new<BlendFileMapping>(__func__, mmap_file);
+  return BLI_filereader_new_mmap_unowned(mmap_file);
+}
+
+/** Whether the data block can be referenced in the mapping, if the reading code allows it. */
+static bool blo_bhead_use_mapping(const FileData *fd, BHead *bhead)
+{
+  if (fd->mapping == nullptr || bhead->len < MMAP_DATA_SHARING_MIN_SIZE) {
+    return false;
+  }
+  if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+    return false;
+  }
+  if (fd->compflags[bhead->SDNAnr] != SDNA_CMP_EQUAL) {
+    return false;
+  }
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  return BHEADN_FROM_BHEAD(bhead)->has_data == false;
+#else
+  return false;
+#endif
+}
+
+/** Read a deferred data block into the data-map because it is looked up directly. */
+static void *blo_read_deferred_data_block(FileData *fd, const void *adr, const bool increase_users)
+{
+  const std::optional<DeferredDataBlock> block = fd->datamap->deferred.pop_try(adr);
+  if (!block) {
+    return nullptr;
+  }
+  void *data = read_struct(fd, block->bhead, block->allocname, block->id_type_index);
+  if (data == nullptr) {
+    return nullptr;
+  }
+  oldnewmap_insert(fd->datamap, adr, data, increase_users ? 1 : 0);
+  return data;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name File Data API
  * \{ */
@@ -1261,10 +1376,17 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   /* Rewind the file after reading the header. */
   rawfile->seek(rawfile, 0, SEEK_SET);
 
+  BlendFileMapping *mapping = nullptr;
+
   /* Check if we have a regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
     /* Try opening the file with memory-mapped IO. */
-    file = BLI_filereader_new_mmap(filedes);
+    if (G.fileflags & G_FILE_MMAP_DATA_SHARING) {
+      file = blo_filereader_new_shared_mapping(filedes, &mapping);
+    }
+    if (file == nullptr) {
+      file = BLI_filereader_new_mmap(filedes);
+    }
     if (file == nullptr) {
       /* `mmap` failed, so just keep using `rawfile`. */
       file = rawfile;
@@ -1278,7 +1400,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     }
   }
   else if (BLI_file_magic_is_zstd(header)) {
-    file = BLI_filereader_new_zstd(rawfile);
+    file = BLI_filereader_new_zstd_threaded(rawfile);
     if (file != nullptr) {
       rawfile = nullptr; /* The `Zstd` #FileReader takes ownership of `rawfile`. */
     }
@@ -1295,6 +1417,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   FileData *fd = filedata_new(reports);
   fd->file = file;
+  fd->mapping = mapping;
 
   return fd;
 }
@@ -1361,7 +1484,7 @@ FileData *blo_filedata_from_memory(const void *mem,
     file = BLI_filereader_new_gzip(mem_file);
   }
   else if (BLI_file_magic_is_zstd(static_cast<const char *>(mem))) {
-    file = BLI_filereader_new_zstd(mem_file);
+    file = BLI_filereader_new_zstd_threaded(mem_file);
   }
 
   if (file == nullptr) {
@@ -1410,6 +1533,10 @@ void blo_filedata_free(FileData *fd)
   }
 #endif
   fd->file->close(fd->file);
+  if (fd->mapping) {
+    /* Data that is still referenced keeps the mapping alive. */
+    fd->mapping->remove_user_and_delete_if_last();
+  }
 
   if (fd->filesdna) {
     DNA_sdna_free(fd->filesdna);
@@ -1497,13 +1624,19 @@ short BLO_version_from_file(const char *filepath)
 /* Only direct data-blocks. */
 static void *newdataadr(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  if (void *newp = oldnewmap_lookup_and_inc(fd->datamap, adr, true)) {
+    return newp;
+  }
+  return blo_read_deferred_data_block(fd, adr, true);
 }
 
 /* Only direct data-blocks. */
 static void *newdataadr_no_us(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  if (void *newp = oldnewmap_lookup_and_inc(fd->datamap, adr, false)) {
+    return newp;
+  }
+  return blo_read_deferred_data_block(fd, adr, false);
 }
 
 void *blo_read_get_new_globaldata_address(FileData *fd, const void *adr)
@@ -2585,6 +2718,13 @@ static BHead *read_data_into_datamap(FileData *fd,
   bhead = blo_bhead_next(fd, bhead);
 
   while (bhead && bhead->code == BLO_CODE_DATA) {
+    if (blo_bhead_use_mapping(fd, bhead)) {
+      /* Only read when looked up, see #BlendFileMapping. */
+      fd->datamap->deferred.add_overwrite(bhead->old,
+                                          DeferredDataBlock{bhead, allocname, id_type_index});
+      bhead = blo_bhead_next(fd, bhead);
+      continue;
+    }
     void *data = read_struct(fd, bhead, allocname, id_type_index);
     if (data) {
       const bool is_new = oldnewmap_insert(fd->datamap, bhead->old, data, 0);
@@ -3634,6 +3774,26 @@ static void blo_read_file_checks(Main *bmain)
   UNUSED_VARS_NDEBUG(bmain);
 }
 
+static int read_id_name_cmp(const void *a, const void *b)
+{
+  return BLI_strcasecmp(static_cast<const ID *>(a)->name, static_cast<const ID *>(b)->name);
+}
+
+/**
+ * Incremental saves append changed IDs at the end of the file, restore the order of the lists as
+ * if the IDs had been added with #id_sort_by_name.
+ */
+static void read_sort_ids_by_name(Main *bmain)
+{
+  for (ListBase *lb : BKE_main_lists_get(*bmain)) {
+    /* Libraries keep the order in which their mains were added to the main list. */
+    if (lb == &bmain->libraries) {
+      continue;
+    }
+    BLI_listbase_sort(lb, read_id_name_cmp);
+  }
+}
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
   BHead *bhead = blo_bhead_first(fd);
@@ -3698,6 +3858,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     read_undo_reuse_noundo_local_ids(fd);
   }
 
+  bool has_skipped_blocks = false;
   while (bhead) {
     switch (bhead->code) {
       case BLO_CODE_DATA:
@@ -3720,6 +3881,11 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
       case BLO_CODE_ENDB:
         bhead = nullptr;
         break;
+      case BLO_CODE_SKIP:
+        /* Superseded by an incremental save, see #read_sort_ids_by_name. */
+        has_skipped_blocks = true;
+        bhead = blo_bhead_next(fd, bhead);
+        break;
 
       case ID_LINK_PLACEHOLDER:
         if (fd->skip_flags & BLO_READ_SKIP_DATA) {
@@ -3762,6 +3928,10 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  if (has_skipped_blocks && (fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    read_sort_ids_by_name(bfd->main);
+  }
+
   if (is_undo) {
     /* Move the remaining Library IDs and their linked data to the new main.
      *
@@ -3981,14 +4151,29 @@ static int verg_bheadsort(const void *v1, const void *v2)
   return 0;
 }
 
+/**
+ * Blocks superseded by an incremental save may use the same old address as the blocks replacing
+ * them, so they are left out of the map, along with their data blocks.
+ */
+static bool bhead_is_skipped(const BHead *bhead, bool &r_in_skipped_block)
+{
+  if (bhead->code != BLO_CODE_DATA) {
+    r_in_skipped_block = (bhead->code == BLO_CODE_SKIP);
+  }
+  return r_in_skipped_block;
+}
+
 static void sort_bhead_old_map(FileData *fd)
 {
   BHead *bhead;
   BHeadSort *bhs;
   int tot = 0;
+  bool in_skipped_block = false;
 
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
-    tot++;
+    if (!bhead_is_skipped(bhead, in_skipped_block)) {
+      tot++;
+    }
   }
 
   fd->tot_bheadmap = tot;
@@ -3998,9 +4183,14 @@ static void sort_bhead_old_map(FileData *fd)
 
   bhs = fd->bheadmap = MEM_malloc_arrayN<BHeadSort>(tot, "BHeadSort");
 
-  for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead), bhs++) {
+  in_skipped_block = false;
+  for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
+    if (bhead_is_skipped(bhead, in_skipped_block)) {
+      continue;
+    }
     bhs->bhead = bhead;
     bhs->old = bhead->old;
+    bhs++;
   }
 
   qsort(fd->bheadmap, tot, sizeof(BHeadSort), verg_bheadsort);
@@ -5255,6 +5445,37 @@ blender::ImplicitSharingInfoAndData blo_read_shared_impl(
   return shared_data;
 }
 
+const blender::ImplicitSharingInfo *blo_read_shared_mapped_impl(BlendDataReader *reader,
+                                                                const void **ptr_p,
+                                                                const int64_t size_in_bytes,
+                                                                const int64_t alignment)
+{
+  FileData *fd = reader->fd;
+  if (fd->mapping == nullptr) {
+    return nullptr;
+  }
+  const DeferredDataBlock *block = fd->datamap->deferred.lookup_ptr(*ptr_p);
+  if (block == nullptr) {
+    return nullptr;
+  }
+  if (block->bhead->len < size_in_bytes) {
+    /* Corrupt or truncated data, let the regular reading code deal with it. */
+    return nullptr;
+  }
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  const void *data = POINTER_OFFSET(BLI_mmap_get_pointer(fd->mapping->mmap_file),
+                                    BHEADN_FROM_BHEAD(block->bhead)->file_offset);
+  if (uintptr_t(data) % uintptr_t(alignment) != 0) {
+    return nullptr;
+  }
+  *ptr_p = data;
+  return MEM_new<MappedDataImplicitSharing>(__func__, *fd->mapping);
+#else
+  UNUSED_VARS(size_in_bytes, alignment);
+  return nullptr;
+#endif
+}
+
 bool BLO_read_data_is_undo(BlendDataReader *reader)
 {
   return (reader->fd->flags & FD_FLAGS_IS_MEMFILE);
@@ -25,6 +25,7 @@
 #include "BLO_readfile.hh"
 
 struct BlendFileData;
+struct BlendFileMapping;
 struct BlendfileLinkAppendContext;
 struct BlendFileReadParams;
 struct BlendFileReadReport;
@@ -72,6 +73,12 @@ struct FileData {
 
   FileReader *file = nullptr;
 
+  /**
+   * Memory mapping of the file that data blocks may be referenced from directly, see
+   * #G_FILE_MMAP_DATA_SHARING. Only set for uncompressed files, #file then reads from it.
+   */
+  BlendFileMapping *mapping = nullptr;
+
   /**
    * Whether we are undoing (< 0) or redoing (> 0), used to choose which 'unchanged' flag to use
    * to detect unchanged data from memfile.
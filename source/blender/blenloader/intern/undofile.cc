@@ -6,11 +6,13 @@
  * \ingroup blenloader
  */
 
+#include <array>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <mutex>
 
 /* open/close */
 #ifndef _WIN32
@@ -24,6 +26,11 @@
 #include "DNA_listBase.h"
 
 #include "BLI_implicit_sharing.hh"
+#include "BLI_set.hh"
+#include "BLI_task.h"
+#include "BLI_task.hh"
+#include "BLI_time.h"
+#include "BLI_vector_set.hh"
 
 #include "BLO_readfile.hh"
 #include "BLO_undofile.hh"
@@ -32,21 +39,311 @@
 #include "BKE_main.hh"
 #include "BKE_undo_system.hh"
 
+#include "CLG_log.h"
+
+#include <xxhash.h>
+#include <zstd.h>
+
+static CLG_LogRef LOG = {"blo.undofile"};
+
 #include "BLI_strict_flags.h" /* IWYU pragma: keep. Keep last. */
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Store
+ *
+ * Chunk buffers are shared by content across the whole undo history. This avoids storing the same
+ * data multiple times when it is not at the same position as in the previous undo step, e.g. when
+ * an ID was re-ordered, or data was inserted before it in the same ID.
+ *
+ * Buffers only used by compressed memfiles (undo steps far from the active one) are compressed
+ * with Zstd in background tasks, and decompressed again when such a memfile is needed.
+ * \{ */
+
+struct MemFileChunkStore {
+  std::mutex mutex;
+  /** Buffers by the hash of their content. */
+  blender::Map<uint64_t, MemFileChunkBuffer *> buffer_by_hash;
+  MemFileChunkStoreStats stats = {};
+};
+
+static MemFileChunkStore &chunk_store()
+{
+  static MemFileChunkStore store;
+  return store;
+}
+
+static void chunk_buffer_add_user(MemFileChunkBuffer *buffer)
+{
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  buffer->users++;
+  buffer->hot_users++;
+  store.stats.size_referenced += buffer->size;
+}
+
+/** Decompress a buffer, the store must be locked. */
+static void chunk_buffer_decompress_locked(MemFileChunkStore &store, MemFileChunkBuffer *buffer)
+{
+  if (buffer->data != nullptr) {
+    return;
+  }
+  char *data = static_cast<char *>(MEM_mallocN(buffer->size, "Chunk buffer"));
+  const size_t decompressed_size = ZSTD_decompress(
+      data, buffer->size, buffer->compressed_data, buffer->compressed_size);
+  BLI_assert(decompressed_size == buffer->size);
+  UNUSED_VARS_NDEBUG(decompressed_size);
+  store.stats.size_stored_compressed -= buffer->size;
+  store.stats.size_compressed -= buffer->compressed_size;
+  MEM_freeN(buffer->compressed_data);
+  buffer->compressed_data = nullptr;
+  buffer->compressed_size = 0;
+  buffer->data = data;
+}
+
+/**
+ * Find a stored buffer with the given content, or create a new one.
+ * \return The buffer, with a new user added.
+ */
+static MemFileChunkBuffer *chunk_buffer_ensure(const char *buf,
+                                               const size_t size,
+                                               bool *r_is_new)
+{
+  const uint64_t hash = XXH3_64bits(buf, size);
+
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  store.stats.size_referenced += size;
+
+  MemFileChunkBuffer *existing = store.buffer_by_hash.lookup_default(hash, nullptr);
+  if (existing && existing->size == size) {
+    /* The content is used by an uncompressed memfile again. */
+    chunk_buffer_decompress_locked(store, existing);
+    if (memcmp(existing->data, buf, size) == 0) {
+      existing->users++;
+      existing->hot_users++;
+      *r_is_new = false;
+      return existing;
+    }
+  }
+
+  MemFileChunkBuffer *buffer = MEM_callocN<MemFileChunkBuffer>("MemFileChunkBuffer");
+  buffer->hash = hash;
+  buffer->size = size;
+  buffer->users = 1;
+  buffer->hot_users = 1;
+  /* Hash collisions are extremely unlikely, the colliding buffer is simply not shared. */
+  buffer->is_indexed = existing == nullptr;
+  buffer->data = static_cast<char *>(MEM_mallocN(size, "Chunk buffer"));
+  memcpy(buffer->data, buf, size);
+  if (buffer->is_indexed) {
+    store.buffer_by_hash.add_new(hash, buffer);
+  }
+  store.stats.size_stored += size;
+  *r_is_new = true;
+  return buffer;
+}
+
+/** Free the buffer when it has no users anymore, the store must be locked. */
+static void chunk_buffer_free_if_unused_locked(MemFileChunkStore &store, MemFileChunkBuffer *buffer)
+{
+  if (buffer->users > 0) {
+    return;
+  }
+  store.stats.size_stored -= buffer->size;
+  if (buffer->is_indexed) {
+    store.buffer_by_hash.remove(buffer->hash);
+    if (store.buffer_by_hash.is_empty()) {
+      /* Free the hash table memory too once the undo history is gone. */
+      store.buffer_by_hash.clear();
+    }
+  }
+  if (buffer->compressed_data) {
+    store.stats.size_stored_compressed -= buffer->size;
+    store.stats.size_compressed -= buffer->compressed_size;
+    MEM_freeN(buffer->compressed_data);
+  }
+  MEM_SAFE_FREE(buffer->data);
+  MEM_freeN(buffer);
+}
+
+static void chunk_buffer_remove_user(MemFileChunkBuffer *buffer, const bool is_hot_user)
+{
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  store.stats.size_referenced -= buffer->size;
+  buffer->users--;
+  if (is_hot_user) {
+    buffer->hot_users--;
+  }
+  chunk_buffer_free_if_unused_locked(store, buffer);
+}
+
+/** Compression is done on small independent buffers in the background, favor speed. */
+#define MEMFILE_COMPRESSION_LEVEL 1
+
+static void chunk_buffer_compress_task(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  MemFileChunkBuffer *buffer = static_cast<MemFileChunkBuffer *>(taskdata);
+  MemFileChunkStore &store = chunk_store();
+
+  /* The data can't be freed while the task runs: the task is a user of the buffer, and the data is
+   * only replaced when the buffer is compressed, which only this task does. */
+  const double time_start = BLI_time_now_seconds();
+  const size_t bound = ZSTD_compressBound(buffer->size);
+  void *compressed_data = MEM_mallocN(bound, "Chunk buffer compressed");
+  size_t compressed_size = ZSTD_compress(
+      compressed_data, bound, buffer->data, buffer->size, MEMFILE_COMPRESSION_LEVEL);
+  const double time_compress = BLI_time_now_seconds() - time_start;
+
+  std::lock_guard lock{store.mutex};
+  store.stats.time_compress += time_compress;
+  buffer->is_compressing = false;
+  /* Only keep the compressed data when it is still unused by uncompressed memfiles, and when it
+   * actually saves memory. */
+  if (!ZSTD_isError(compressed_size) && compressed_size < buffer->size - buffer->size / 8 &&
+      buffer->hot_users == 0 && buffer->users > 1)
+  {
+    buffer->compressed_data = MEM_reallocN(compressed_data, compressed_size);
+    buffer->compressed_size = compressed_size;
+    MEM_freeN(buffer->data);
+    buffer->data = nullptr;
+    store.stats.size_stored_compressed += buffer->size;
+    store.stats.size_compressed += compressed_size;
+  }
+  else {
+    MEM_freeN(compressed_data);
+  }
+  buffer->users--;
+  chunk_buffer_free_if_unused_locked(store, buffer);
+}
+
+void BLO_memfile_compress(MemFile *memfile, TaskPool *task_pool)
+{
+  if (memfile->is_compressed) {
+    return;
+  }
+  memfile->is_compressed = true;
+
+  blender::Vector<MemFileChunkBuffer *> buffers_to_compress;
+  {
+    MemFileChunkStore &store = chunk_store();
+    std::lock_guard lock{store.mutex};
+    LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+      MemFileChunkBuffer *buffer = chunk->buffer;
+      buffer->hot_users--;
+      if (buffer->hot_users == 0 && buffer->data != nullptr && !buffer->is_compressing) {
+        /* The task keeps the buffer alive, even if the memfile is freed in the meantime. */
+        buffer->is_compressing = true;
+        buffer->users++;
+        buffers_to_compress.append(buffer);
+      }
+    }
+  }
+  for (MemFileChunkBuffer *buffer : buffers_to_compress) {
+    BLI_task_pool_push(task_pool, chunk_buffer_compress_task, buffer, false, nullptr);
+  }
+}
+
+void BLO_memfile_decompress(MemFile *memfile)
+{
+  if (!memfile->is_compressed) {
+    return;
+  }
+  memfile->is_compressed = false;
+
+  const double time_start = BLI_time_now_seconds();
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+
+  blender::VectorSet<MemFileChunkBuffer *> buffers_to_decompress;
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    chunk->buffer->hot_users++;
+    if (chunk->buffer->data == nullptr) {
+      buffers_to_decompress.add(chunk->buffer);
+    }
+  }
+
+  /* Stepping back in the undo history waits for this, so decompress in parallel. Buffers with hot
+   * users are never modified by compression tasks, the isolation makes sure this thread doesn't
+   * run such a task while holding the lock. */
+  blender::threading::isolate_task([&]() {
+    blender::threading::parallel_for(
+        buffers_to_decompress.index_range(), 16, [&](const blender::IndexRange range) {
+          for (const int64_t i : range) {
+            MemFileChunkBuffer *buffer = buffers_to_decompress[i];
+            char *data = static_cast<char *>(MEM_mallocN(buffer->size, "Chunk buffer"));
+            const size_t decompressed_size = ZSTD_decompress(
+                data, buffer->size, buffer->compressed_data, buffer->compressed_size);
+            BLI_assert(decompressed_size == buffer->size);
+            UNUSED_VARS_NDEBUG(decompressed_size);
+            MEM_freeN(buffer->compressed_data);
+            buffer->compressed_data = nullptr;
+            buffer->data = data;
+          }
+        });
+  });
+
+  size_t size_decompressed = 0;
+  for (MemFileChunkBuffer *buffer : buffers_to_decompress) {
+    store.stats.size_stored_compressed -= buffer->size;
+    store.stats.size_compressed -= buffer->compressed_size;
+    buffer->compressed_size = 0;
+    size_decompressed += buffer->size;
+  }
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    chunk->buf = chunk->buffer->data;
+  }
+
+  const double time_decompress = BLI_time_now_seconds() - time_start;
+  store.stats.time_decompress += time_decompress;
+  CLOG_INFO(&LOG,
+            1,
+            "Decompressed %zu bytes in %zu buffers on demand in %.3f ms",
+            size_decompressed,
+            size_t(buffers_to_decompress.size()),
+            time_decompress * 1000.0);
+}
+
+size_t BLO_memfile_memory_size(const MemFile *memfile)
+{
+  if (!memfile->is_compressed) {
+    return memfile->size;
+  }
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  size_t size = 0;
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile->chunks) {
+    if (chunk->is_buffer_owner) {
+      const MemFileChunkBuffer *buffer = chunk->buffer;
+      size += buffer->data ? buffer->size : buffer->compressed_size;
+    }
+  }
+  return size;
+}
+
+MemFileChunkStoreStats BLO_memfile_chunk_store_stats()
+{
+  MemFileChunkStore &store = chunk_store();
+  std::lock_guard lock{store.mutex};
+  return store.stats;
+}
+
+/** \} */
+
 /* **************** support for memory-write, for undo buffers *************** */
 
 void BLO_memfile_free(MemFile *memfile)
 {
   while (MemFileChunk *chunk = static_cast<MemFileChunk *>(BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    chunk_buffer_remove_user(chunk->buffer, !memfile->is_compressed);
     MEM_freeN(chunk);
   }
   MEM_delete(memfile->shared_storage);
   memfile->shared_storage = nullptr;
   memfile->size = 0;
+  memfile->size_total = 0;
+  memfile->size_deduplicated = 0;
+  memfile->is_compressed = false;
 }
 
 MemFileSharedStorage::~MemFileSharedStorage()
@@ -59,29 +356,19 @@ MemFileSharedStorage::~MemFileSharedStorage()
 
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  /* We use this mapping to store the memory buffers from second memfile chunks which are not owned
-   * by it (i.e. shared with some previous memory steps). */
-  blender::Map<const char *, MemFileChunk *> buffer_to_second_memchunk;
-
-  /* First, detect all memchunks in second memfile that are not owned by it. */
-  LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
-    if (sc->is_identical) {
-      buffer_to_second_memchunk.add(sc->buf, sc);
-    }
-  }
-
-  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
-   * it is also used by the second memfile, transfer the ownership. */
+  /* Buffers are reference counted, so they stay alive as long as the second memfile uses them.
+   * However, chunks of the second memfile that were identical to chunks which changed in the first
+   * memfile are not identical to the step before the first one, which becomes their previous step
+   * after merging. */
+  blender::Set<const MemFileChunkBuffer *> first_changed_buffers;
   LISTBASE_FOREACH (MemFileChunk *, fc, &first->chunks) {
     if (!fc->is_identical) {
-      if (MemFileChunk *sc = buffer_to_second_memchunk.lookup_default(fc->buf, nullptr)) {
-        BLI_assert(sc->is_identical);
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-      /* Note that if the second memfile does not use that chunk, we assume that the first one
-       * fully owns it without sharing it with any other memfile, and hence it should be freed with
-       * it. */
+      first_changed_buffers.add(fc->buffer);
+    }
+  }
+  LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
+    if (sc->is_identical && first_changed_buffers.contains(sc->buffer)) {
+      sc->is_identical = false;
     }
   }
 
@@ -99,6 +386,10 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
                             MemFile *written_memfile,
                             MemFile *reference_memfile)
 {
+  if (reference_memfile) {
+    /* Chunks of the reference are compared with the written data. */
+    BLO_memfile_decompress(reference_memfile);
+  }
   mem_data->written_memfile = written_memfile;
   mem_data->reference_memfile = reference_memfile;
   mem_data->reference_current_chunk = reference_memfile ? static_cast<MemFileChunk *>(
@@ -126,7 +417,62 @@ void BLO_memfile_write_finalize(MemFileWriteData *mem_data)
   mem_data->id_session_uid_mapping.clear();
 }
 
-void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size)
+/* -------------------------------------------------------------------- */
+/** \name Content-Defined Chunking
+ *
+ * Written data is split where a rolling hash of the content matches a pattern (a "Gear" hash as
+ * used by FastCDC), so that boundaries only depend on the nearby content. Inserting or removing
+ * bytes then only changes the chunks around the modification, instead of shifting all following
+ * chunks like fixed size splitting does.
+ * \{ */
+
+/** Data smaller than this is never split. */
+static constexpr size_t CHUNK_SIZE_MIN = 4 * 1024;
+/** Boundaries are found every 16 KiB on average. */
+static constexpr uint64_t CHUNK_BOUNDARY_MASK = (uint64_t(1) << 14) - 1;
+static constexpr size_t CHUNK_SIZE_MAX = 128 * 1024;
+
+static const std::array<uint64_t, 256> &chunk_gear_table()
+{
+  static const std::array<uint64_t, 256> table = []() {
+    std::array<uint64_t, 256> values;
+    /* SplitMix64, any fixed set of random values works. */
+    uint64_t state = 0x9E3779B97F4A7C15;
+    for (uint64_t &value : values) {
+      state += 0x9E3779B97F4A7C15;
+      uint64_t z = state;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+      value = z ^ (z >> 31);
+    }
+    return values;
+  }();
+  return table;
+}
+
+/** \return The size of the first chunk of the given data. */
+static size_t chunk_boundary_find(const char *buf, const size_t size)
+{
+  if (size <= CHUNK_SIZE_MIN) {
+    return size;
+  }
+  const std::array<uint64_t, 256> &gear = chunk_gear_table();
+  const size_t end = std::min(size, CHUNK_SIZE_MAX);
+  uint64_t hash = 0;
+  for (size_t i = CHUNK_SIZE_MIN; i < end; i++) {
+    hash = (hash << 1) + gear[uint8_t(buf[i])];
+    /* Test the high bits, which depend on the most recent 64 bytes. */
+    if (((hash >> 40) & CHUNK_BOUNDARY_MASK) == 0) {
+      return i + 1;
+    }
+  }
+  return end;
+}
+
+static void memfile_chunk_add_single(MemFileWriteData *mem_data,
+                                     const char *buf,
+                                     const size_t size,
+                                     const bool is_identical)
 {
   MemFile *memfile = mem_data->written_memfile;
   MemFileChunk **compchunk_step = &mem_data->reference_current_chunk;
@@ -134,6 +480,8 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   MemFileChunk *curchunk = MEM_mallocN<MemFileChunk>("MemFileChunk");
   curchunk->size = size;
   curchunk->buf = nullptr;
+  curchunk->buffer = nullptr;
+  curchunk->is_buffer_owner = false;
   curchunk->is_identical = false;
   /* This is unsafe in the sense that an app handler or other code that does not
    * perform an undo push may make changes after the last undo push that
@@ -141,29 +489,53 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   curchunk->is_identical_future = true;
   curchunk->id_session_uid = mem_data->current_id_session_uid;
   BLI_addtail(&memfile->chunks, curchunk);
+  memfile->size_total += size;
 
-  /* we compare compchunk with buf */
   if (*compchunk_step != nullptr) {
     MemFileChunk *compchunk = *compchunk_step;
-    if (compchunk->size == curchunk->size) {
-      if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
-        curchunk->is_identical = true;
-        compchunk->is_identical_future = true;
-      }
+    if (is_identical) {
+      chunk_buffer_add_user(compchunk->buffer);
+      curchunk->buffer = compchunk->buffer;
+      curchunk->buf = compchunk->buf;
+      curchunk->is_identical = true;
+      compchunk->is_identical_future = true;
     }
     *compchunk_step = static_cast<MemFileChunk *>(compchunk->next);
   }
 
   /* not equal... */
   if (curchunk->buf == nullptr) {
-    char *buf_new = static_cast<char *>(MEM_mallocN(size, "Chunk buffer"));
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+    bool is_new;
+    curchunk->buffer = chunk_buffer_ensure(buf, size, &is_new);
+    curchunk->buf = curchunk->buffer->data;
+    curchunk->is_buffer_owner = is_new;
+    if (is_new) {
+      memfile->size += size;
+    }
+    else {
+      memfile->size_deduplicated += size;
+    }
   }
 }
 
+void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size)
+{
+  while (size > 0) {
+    /* We compare the chunk of the previous step with buf. Unchanged data is cut at the same place
+     * as in the previous step, which avoids scanning the content for boundaries in the common
+     * case. */
+    const MemFileChunk *compchunk = mem_data->reference_current_chunk;
+    const bool is_identical = compchunk != nullptr && compchunk->size <= size &&
+                              memcmp(compchunk->buf, buf, compchunk->size) == 0;
+    const size_t chunk_size = is_identical ? compchunk->size : chunk_boundary_find(buf, size);
+    memfile_chunk_add_single(mem_data, buf, chunk_size, is_identical);
+    buf += chunk_size;
+    size -= chunk_size;
+  }
+}
+
+/** \} */
+
 Main *BLO_memfile_main_get(MemFile *memfile, Main *bmain, Scene **r_scene)
 {
   Main *bmain_undo = nullptr;
@@ -265,6 +637,8 @@ static void undo_close(FileReader *reader)
 
 FileReader *BLO_memfile_new_filereader(MemFile *memfile, int undo_direction)
 {
+  BLO_memfile_decompress(memfile);
+
   UndoReader *undo = MEM_callocN<UndoReader>(__func__);
 
   undo->memfile = memfile;
@@ -89,10 +89,12 @@
 #include "DNA_sdna_types.h"
 #include "DNA_userdef_types.h"
 
+#include "BLI_array.hh"
 #include "BLI_endian_defines.h"
 #include "BLI_endian_switch.h"
 #include "BLI_fileops.hh"
 #include "BLI_implicit_sharing.hh"
+#include "BLI_map.hh"
 #include "BLI_math_base.h"
 #include "BLI_multi_value_map.hh"
 #include "BLI_path_utils.hh"
@@ -132,6 +134,7 @@
 
 #include "readfile.hh"
 
+#include <xxhash.h>
 #include <zstd.h>
 
 /* Make preferences read-only. */
@@ -179,6 +182,13 @@ class WriteWrap {
 
   /** Buffer output (we only want when output isn't already buffered). */
   bool use_buf = true;
+  /**
+   * The temporary file starts as a copy of the existing file and is updated, instead of being
+   * written from scratch. No version backup of the existing file is made.
+   */
+  bool update_copy = false;
+  /** Nothing was written that should replace the existing file, checked after #close. */
+  bool discard = false;
 };
 
 class RawWriteWrap : public WriteWrap {
@@ -402,6 +412,518 @@ bool ZstdWriteWrap::write(const void *buf, const size_t buf_len)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Incremental Saving
+ *
+ * Saving again to the file a #Main was last saved to only appends the IDs whose blocks changed
+ * since then. The blocks of superseded and deleted IDs are patched to #BLO_CODE_SKIP, which
+ * readers ignore along with the data blocks following them, and the leading blocks (file header,
+ * render info, thumbnail and #FileGlobal) are overwritten.
+ *
+ * These updates are done on a clone of the file (see #BLI_file_clone), which shares the unchanged
+ * data with the original. It is synced to disk and renamed over the original like any other save,
+ * so a crash at any point leaves either the previous or the new file, never a partially updated
+ * one. On file systems which do not support cloning, copying the file would cost as much as
+ * writing it, so a full save is done instead.
+ *
+ * The blocks of each ID are hashed while writing and compared to the ones of the previous save,
+ * keyed by #ID.session_uid like the per-ID diffing of undo #MemFile steps, so that no copy of the
+ * file content has to be kept in memory between saves. A full save is done instead when the
+ * leading blocks change size, when the file was modified by something else, or when superseded
+ * blocks use too much of the file (compacting it again). Changes by something else are detected
+ * by the status of the file: saves rename a new file over the previous one, so any other writer
+ * changes its inode or its change time, which unlike the modification time is not restored by
+ * copies and syncing tools.
+ *
+ * Appended IDs are out of order in the file, readers sort them again when the file has skipped
+ * blocks.
+ *
+ * The state is kept in #Main.incremental_save_state, so it is lost when the #Main is replaced,
+ * e.g. by memfile undo. The next save is then a full one.
+ * \{ */
+
+/** Part of the file used by superseded blocks above which the next save rewrites it fully. */
+#define INCREMENTAL_SAVE_MAX_UNUSED_FACTOR 0.5
+/** Changed IDs with more data than this are written to the file while they are being hashed. */
+#define INCREMENTAL_SAVE_SEGMENT_BUFFER_SIZE (1 << 26) /* 64mb */
+
+/** Blocks written for a single ID, or the blocks before or after all IDs. */
+struct IncrementalSaveSegment {
+  /** Position in the file. */
+  int64_t offset = 0;
+  int64_t size = 0;
+  uint64_t hash = 0;
+  /** Positions of the non #BLO_CODE_DATA block headers, relative to #offset. */
+  blender::Vector<int64_t> block_offsets;
+};
+
+struct IncrementalSaveState : public MainIncrementalSaveState {
+  char filepath[FILE_MAX] = "";
+  /** Status of the file, to detect when it was written by anything else than the last save. */
+  int64_t file_size = 0;
+  int64_t file_mtime = 0;
+  int64_t file_ctime = 0;
+  uint64_t file_inode = 0;
+
+  /** File header, render info, thumbnail and #FileGlobal. */
+  IncrementalSaveSegment head;
+  /** DNA and end of file. */
+  IncrementalSaveSegment tail;
+  /** The key is #ID.session_uid. */
+  blender::Map<uint, IncrementalSaveSegment> id_segments;
+
+  /** Size of the superseded blocks still in the file. */
+  int64_t unused_size = 0;
+};
+
+/**
+ * Either writes a new file while recording the position and hash of the blocks of each ID, or
+ * updates a clone of the file described by a previous #IncrementalSaveState.
+ */
+class IncrementalWriteWrap : public WriteWrap {
+ public:
+  enum class SegmentType { Head, ID, Tail };
+
+ private:
+  /** Describes the file to update, null when writing a new file. */
+  const IncrementalSaveState *prev_state_;
+  /** Describes the file being written. */
+  IncrementalSaveState *state_;
+
+  int file_handle_ = -1;
+  /** Number of bytes received from the writer. */
+  int64_t stream_len_ = 0;
+  /** End of the updated file, changed segments are appended there. */
+  int64_t append_offset_ = 0;
+
+  SegmentType segment_type_ = SegmentType::Head;
+  uint segment_id_session_uid_ = 0;
+  /** Value of #stream_len_ when the current segment started. */
+  int64_t segment_stream_offset_ = 0;
+  blender::Vector<int64_t> segment_block_offsets_;
+  XXH3_state_t *segment_hash_state_;
+  blender::Vector<uchar> segment_buffer_;
+  /** The current segment was too big for #segment_buffer_ and is written as it comes. */
+  bool segment_spilled_ = false;
+
+  blender::Vector<uchar> head_buffer_;
+  blender::Vector<uchar> tail_buffer_;
+  blender::Vector<const IncrementalSaveSegment *> superseded_segments_;
+
+  bool needs_full_write_ = false;
+  bool write_error_ = false;
+
+ public:
+  IncrementalWriteWrap(const IncrementalSaveState *prev_state);
+  ~IncrementalWriteWrap();
+
+  bool open(const char *filepath) override;
+  bool close() override;
+  bool write(const void *buf, size_t buf_len) override;
+
+  /**
+   * Start a new segment, all pending data of the writer must have been flushed.
+   */
+  void segment_begin(SegmentType type, uint id_session_uid);
+  /**
+   * Called before writing the header of a block.
+   * \param pending_len: Number of bytes buffered by the writer and not received yet.
+   */
+  void block_begin(int code, size_t pending_len);
+
+  /** The file could not be updated incrementally, the copy must be discarded. */
+  bool needs_full_write() const
+  {
+    return needs_full_write_;
+  }
+  /** Ownership of the state describing the written file, once it has been closed. */
+  IncrementalSaveState *state_release(const char *filepath);
+
+ private:
+  void segment_end();
+  bool write_at(int64_t offset, const void *buf, size_t buf_len);
+  bool update_file();
+};
+
+IncrementalWriteWrap::IncrementalWriteWrap(const IncrementalSaveState *prev_state)
+    : prev_state_(prev_state), state_(MEM_new<IncrementalSaveState>(__func__))
+{
+  update_copy = (prev_state != nullptr);
+  segment_hash_state_ = XXH3_createState();
+  XXH3_64bits_reset(segment_hash_state_);
+}
+
+IncrementalWriteWrap::~IncrementalWriteWrap()
+{
+  XXH3_freeState(segment_hash_state_);
+  MEM_delete(state_);
+}
+
+bool IncrementalWriteWrap::open(const char *filepath)
+{
+  /* The original file is only replaced once the clone is fully updated. */
+  if (update_copy && BLI_file_clone(prev_state_->filepath, filepath) != 0) {
+    /* Write the whole file instead. */
+    update_copy = false;
+  }
+  if (update_copy) {
+    file_handle_ = BLI_open(filepath, O_BINARY + O_RDWR, 0666);
+    append_offset_ = prev_state_->file_size;
+  }
+  else {
+    file_handle_ = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+  }
+  return file_handle_ != -1;
+}
+
+bool IncrementalWriteWrap::close()
+{
+  this->segment_end();
+
+  bool success = !write_error_;
+  if (success && update_copy && !needs_full_write_) {
+    success = this->update_file();
+  }
+  /* Make sure the content is on disk before the file is renamed over the original, so the rename
+   * is the only point where the saved file changes. */
+#ifdef WIN32
+  if (success && !needs_full_write_ && _commit(file_handle_) != 0) {
+    success = false;
+  }
+#else
+  if (success && !needs_full_write_ && fsync(file_handle_) == -1) {
+    success = false;
+  }
+#endif
+  if (::close(file_handle_) == -1) {
+    success = false;
+  }
+  discard = needs_full_write_;
+  return success;
+}
+
+bool IncrementalWriteWrap::write(const void *buf, size_t buf_len)
+{
+  if (needs_full_write_) {
+    /* Nothing is written anymore, the whole file gets saved again afterwards. */
+    return true;
+  }
+
+  const int64_t segment_len = stream_len_ - segment_stream_offset_;
+  stream_len_ += int64_t(buf_len);
+  XXH3_64bits_update(segment_hash_state_, buf, buf_len);
+
+  if (!update_copy) {
+    return ::write(file_handle_, buf, buf_len) == buf_len;
+  }
+  if (segment_spilled_) {
+    return this->write_at(append_offset_ + segment_len, buf, buf_len);
+  }
+
+  segment_buffer_.extend(
+      blender::Span<uchar>(static_cast<const uchar *>(buf), int64_t(buf_len)));
+  if (segment_type_ == SegmentType::ID &&
+      segment_buffer_.size() > INCREMENTAL_SAVE_SEGMENT_BUFFER_SIZE)
+  {
+    /* Bound the memory used for big IDs, at the cost of writing them even when unchanged (the
+     * appended data is then overwritten by the next changed segment or truncated). */
+    segment_spilled_ = true;
+    const bool success = this->write_at(
+        append_offset_, segment_buffer_.data(), size_t(segment_buffer_.size()));
+    segment_buffer_.clear();
+    return success;
+  }
+  return true;
+}
+
+void IncrementalWriteWrap::segment_begin(const SegmentType type, const uint id_session_uid)
+{
+  this->segment_end();
+
+  segment_type_ = type;
+  segment_id_session_uid_ = id_session_uid;
+  segment_stream_offset_ = stream_len_;
+  XXH3_64bits_reset(segment_hash_state_);
+}
+
+void IncrementalWriteWrap::block_begin(const int code, const size_t pending_len)
+{
+  if (code != BLO_CODE_DATA) {
+    segment_block_offsets_.append(stream_len_ + int64_t(pending_len) - segment_stream_offset_);
+  }
+}
+
+void IncrementalWriteWrap::segment_end()
+{
+  if (needs_full_write_) {
+    return;
+  }
+
+  IncrementalSaveSegment segment;
+  segment.offset = segment_stream_offset_;
+  segment.size = stream_len_ - segment_stream_offset_;
+  segment.hash = XXH3_64bits_digest(segment_hash_state_);
+  segment.block_offsets = std::move(segment_block_offsets_);
+  segment_block_offsets_.clear();
+
+  if (update_copy) {
+    switch (segment_type_) {
+      case SegmentType::Head: {
+        if (segment.size != prev_state_->head.size) {
+          needs_full_write_ = true;
+          return;
+        }
+        /* Overwritten once everything else is written. */
+        segment.offset = 0;
+        head_buffer_ = std::move(segment_buffer_);
+        break;
+      }
+      case SegmentType::ID: {
+        const IncrementalSaveSegment *prev_segment = prev_state_->id_segments.lookup_ptr(
+            segment_id_session_uid_);
+        if (prev_segment && prev_segment->size == segment.size &&
+            prev_segment->hash == segment.hash)
+        {
+          /* Unchanged, keep using the blocks already in the file. */
+          segment.offset = prev_segment->offset;
+          break;
+        }
+        if (!segment_spilled_ &&
+            !this->write_at(append_offset_, segment_buffer_.data(), size_t(segment.size)))
+        {
+          write_error_ = true;
+        }
+        segment.offset = append_offset_;
+        append_offset_ += segment.size;
+        if (prev_segment) {
+          superseded_segments_.append(prev_segment);
+        }
+        break;
+      }
+      case SegmentType::Tail: {
+        /* Only written if anything changed, see #update_file. */
+        tail_buffer_ = std::move(segment_buffer_);
+        break;
+      }
+    }
+    segment_buffer_.clear();
+    segment_spilled_ = false;
+  }
+
+  switch (segment_type_) {
+    case SegmentType::Head:
+      state_->head = std::move(segment);
+      break;
+    case SegmentType::ID:
+      state_->id_segments.add_overwrite(segment_id_session_uid_, std::move(segment));
+      break;
+    case SegmentType::Tail:
+      state_->tail = std::move(segment);
+      break;
+  }
+}
+
+bool IncrementalWriteWrap::write_at(const int64_t offset, const void *buf, const size_t buf_len)
+{
+  if (BLI_lseek(file_handle_, offset, SEEK_SET) == -1) {
+    return false;
+  }
+  return ::write(file_handle_, buf, buf_len) == buf_len;
+}
+
+bool IncrementalWriteWrap::update_file()
+{
+  /* IDs that were not written again have been deleted. */
+  for (const auto item : prev_state_->id_segments.items()) {
+    if (!state_->id_segments.contains(item.key)) {
+      superseded_segments_.append(&item.value);
+    }
+  }
+
+  const int code_skip = BLO_CODE_SKIP;
+  auto skip_segment_blocks = [&](const IncrementalSaveSegment &segment) {
+    for (const int64_t block_offset : segment.block_offsets) {
+      if (!this->write_at(segment.offset + block_offset + offsetof(BHead, code),
+                          &code_skip,
+                          sizeof(code_skip)))
+      {
+        return false;
+      }
+    }
+    state_->unused_size += segment.size;
+    return true;
+  };
+
+  state_->unused_size = prev_state_->unused_size;
+  if (superseded_segments_.is_empty() && append_offset_ == prev_state_->file_size &&
+      state_->tail.size == prev_state_->tail.size && state_->tail.hash == prev_state_->tail.hash)
+  {
+    state_->tail.offset = prev_state_->tail.offset;
+  }
+  else {
+    if (!this->write_at(append_offset_, tail_buffer_.data(), size_t(tail_buffer_.size()))) {
+      return false;
+    }
+    state_->tail.offset = append_offset_;
+    append_offset_ += state_->tail.size;
+
+    /* Skipping the previous end of file block makes all appended blocks visible to readers.
+     * Until then the file is still read as it was after the previous save. */
+    if (!skip_segment_blocks(prev_state_->tail)) {
+      return false;
+    }
+  }
+
+  /* Remove data of big unchanged IDs written after the end of the file. */
+#ifdef WIN32
+  if (_chsize_s(file_handle_, append_offset_) != 0) {
+    return false;
+  }
+#else
+  if (ftruncate(file_handle_, append_offset_) == -1) {
+    return false;
+  }
+#endif
+
+  for (const IncrementalSaveSegment *segment : superseded_segments_) {
+    if (!skip_segment_blocks(*segment)) {
+      return false;
+    }
+  }
+
+  return this->write_at(0, head_buffer_.data(), size_t(head_buffer_.size()));
+}
+
+IncrementalSaveState *IncrementalWriteWrap::state_release(const char *filepath)
+{
+  BLI_stat_t status;
+  if (BLI_stat(filepath, &status) == -1) {
+    return nullptr;
+  }
+
+  IncrementalSaveState *state = state_;
+  state_ = nullptr;
+  STRNCPY(state->filepath, filepath);
+  state->file_size = int64_t(status.st_size);
+  state->file_mtime = int64_t(status.st_mtime);
+  state->file_ctime = int64_t(status.st_ctime);
+  state->file_inode = uint64_t(status.st_ino);
+  return state;
+}
+
+/** \return True when the file still is the one described by \a state. */
+static bool incremental_save_state_matches_file(const IncrementalSaveState &state,
+                                                const char *filepath)
+{
+  BLI_stat_t status;
+  if (BLI_stat(filepath, &status) == -1) {
+    return false;
+  }
+  return int64_t(status.st_size) == state.file_size &&
+         int64_t(status.st_mtime) == state.file_mtime &&
+         int64_t(status.st_ctime) == state.file_ctime &&
+         uint64_t(status.st_ino) == state.file_inode;
+}
+
+/**
+ * \return The state of the file written by the last save of \a bmain, if it can be updated
+ * incrementally.
+ */
+static const IncrementalSaveState *incremental_save_state_get(const Main &bmain,
+                                                              const char *filepath)
+{
+  const IncrementalSaveState *state = static_cast<const IncrementalSaveState *>(
+      bmain.incremental_save_state);
+  if (state == nullptr || BLI_path_cmp(state->filepath, filepath) != 0) {
+    return nullptr;
+  }
+
+  if (state->unused_size > int64_t(state->file_size * INCREMENTAL_SAVE_MAX_UNUSED_FACTOR)) {
+    /* Compact the file. */
+    return nullptr;
+  }
+
+  if (!incremental_save_state_matches_file(*state, filepath)) {
+    /* Written or removed by something else. */
+    return nullptr;
+  }
+
+  return state;
+}
+
+static void incremental_save_state_set(Main &bmain, IncrementalSaveState *state)
+{
+  MEM_delete(bmain.incremental_save_state);
+  bmain.incremental_save_state = state;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Snapshot Writing
+ *
+ * Keeps the written data in memory, to write the file later (see #BLO_write_snapshot_create).
+ * \{ */
+
+struct BlendFileWriteSnapshot {
+  struct Piece {
+    const void *data;
+    size_t size;
+    /** Set when the data is referenced instead of owned, the snapshot holds a user of it. */
+    const blender::ImplicitSharingInfo *sharing_info;
+  };
+  blender::Vector<Piece> pieces;
+
+  ~BlendFileWriteSnapshot()
+  {
+    for (const Piece &piece : pieces) {
+      if (piece.sharing_info) {
+        piece.sharing_info->remove_user_and_delete_if_last();
+      }
+      else {
+        MEM_freeN(const_cast<void *>(piece.data));
+      }
+    }
+  }
+};
+
+class SnapshotWriteWrap : public WriteWrap {
+  BlendFileWriteSnapshot &snapshot_;
+
+ public:
+  SnapshotWriteWrap(BlendFileWriteSnapshot &snapshot) : snapshot_(snapshot) {}
+
+  bool open(const char * /*filepath*/) override
+  {
+    return true;
+  }
+  bool close() override
+  {
+    return true;
+  }
+  bool write(const void *buf, const size_t buf_len) override
+  {
+    void *data = MEM_mallocN(buf_len, __func__);
+    memcpy(data, buf, buf_len);
+    snapshot_.pieces.append({data, buf_len, nullptr});
+    return true;
+  }
+
+  /**
+   * Reference implicitly shared data instead of copying it, it cannot be modified as long as the
+   * snapshot is a user of it.
+   */
+  void write_shared(const void *data,
+                    const size_t size,
+                    const blender::ImplicitSharingInfo *sharing_info)
+  {
+    sharing_info->add_user();
+    snapshot_.pieces.append({data, size, sharing_info});
+  }
+};
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Write Data Type & Functions
  * \{ */
@@ -461,6 +983,15 @@ struct WriteData {
    * Will be nullptr for UNDO.
    */
   WriteWrap *ww;
+  /** Set when #WriteData.ww is used for an incremental save, to notify it of ID boundaries. */
+  IncrementalWriteWrap *incremental_ww;
+  /** Set when #WriteData.ww keeps the written data in memory. */
+  SnapshotWriteWrap *snapshot_ww;
+  /** Implicitly shared data written by #BLO_write_shared, referenced by snapshots. */
+  struct {
+    const void *data;
+    const blender::ImplicitSharingInfo *sharing_info;
+  } snapshot_shared_data;
 };
 
 struct BlendWriter {
@@ -474,6 +1005,8 @@ static WriteData *writedata_new(WriteWrap *ww)
   wd->sdna = DNA_sdna_current_get();
 
   wd->ww = ww;
+  wd->incremental_ww = dynamic_cast<IncrementalWriteWrap *>(ww);
+  wd->snapshot_ww = dynamic_cast<SnapshotWriteWrap *>(ww);
 
   if ((ww == nullptr) || (ww->use_buf)) {
     if (ww == nullptr) {
@@ -574,8 +1107,11 @@ static void mywrite(WriteData *wd, const void *adr, size_t len)
         wd->buffer.used_len = 0;
       }
 
+      /* Memfiles split the data at content-defined boundaries themselves, so that insertions
+       * don't shift all following chunks. */
+      const size_t piece_size = wd->use_memfile ? size_t(INT_MAX) : wd->buffer.chunk_size;
       do {
-        const size_t writelen = std::min(len, wd->buffer.chunk_size);
+        const size_t writelen = std::min(len, piece_size);
         writedata_do_write(wd, adr, writelen);
         adr = (const char *)adr + writelen;
         len -= writelen;
@@ -596,6 +1132,22 @@ static void mywrite(WriteData *wd, const void *adr, size_t len)
   }
 }
 
+/**
+ * Write the content of a block, which is only referenced by snapshots when it is the implicitly
+ * shared data being written.
+ */
+static void mywrite_block_data(WriteData *wd, const void *data, const size_t len)
+{
+  if (wd->snapshot_ww && data == wd->snapshot_shared_data.data &&
+      !wd->validation_data.critical_error)
+  {
+    mywrite_flush(wd);
+    wd->snapshot_ww->write_shared(data, len, wd->snapshot_shared_data.sharing_info);
+    return;
+  }
+  mywrite(wd, data, len);
+}
+
 /**
  * BeGiN initializer for mywrite
  * \param ww: File write wrapper.
@@ -641,7 +1193,7 @@ static bool mywrite_end(WriteData *wd)
 /**
  * Start writing of data related to a single ID.
  *
- * Only does something when storing an undo step.
+ * Only does something when storing an undo step or saving incrementally.
  */
 static void mywrite_id_begin(WriteData *wd, ID *id)
 {
@@ -650,6 +1202,13 @@ static void mywrite_id_begin(WriteData *wd, ID *id)
 
   BLI_assert(wd->validation_data.per_id_addresses_set.is_empty());
 
+  if (wd->incremental_ww) {
+    /* Data written since the previous ID (e.g. linked data-blocks placeholders following a
+     * library) remains part of its segment. */
+    mywrite_flush(wd);
+    wd->incremental_ww->segment_begin(IncrementalWriteWrap::SegmentType::ID, id->session_uid);
+  }
+
   if (wd->use_memfile) {
     wd->mem.current_id_session_uid = id->session_uid;
 
@@ -729,6 +1288,9 @@ static bool write_at_address_validate(WriteData *wd, const int filecode, const v
 
 static void write_bhead(WriteData *wd, const BHead &bhead)
 {
+  if (wd->incremental_ww) {
+    wd->incremental_ww->block_begin(bhead.code, wd->buffer.used_len);
+  }
   mywrite(wd, &bhead, sizeof(BHead));
 }
 
@@ -771,7 +1333,7 @@ static void writestruct_at_address_nr(WriteData *wd,
   }
 
   write_bhead(wd, bh);
-  mywrite(wd, data, size_t(bh.len));
+  mywrite_block_data(wd, data, size_t(bh.len));
 }
 
 static void writestruct_nr(
@@ -837,7 +1399,7 @@ static void writedata(WriteData *wd, const int filecode, const size_t len, const
   }
 
   write_bhead(wd, bh);
-  mywrite(wd, adr, len);
+  mywrite_block_data(wd, adr, len);
 }
 
 /**
@@ -1504,6 +2066,10 @@ static bool write_file_handle(Main *mainvar,
   /* So changes above don't cause a 'DNA1' to be detected as changed on undo. */
   mywrite_flush(wd);
 
+  if (wd->incremental_ww) {
+    wd->incremental_ww->segment_begin(IncrementalWriteWrap::SegmentType::Tail, 0);
+  }
+
   if (use_userdef) {
     write_userdef(&writer, &U);
   }
@@ -1742,23 +2308,29 @@ static bool BLO_write_file_impl(Main *mainvar,
   const bool err = write_file_handle(
       mainvar, &ww, nullptr, nullptr, write_flags, use_userdef, thumb, debug_dst);
 
-  ww.close();
+  const bool close_success = ww.close();
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
     BKE_bpath_list_free(path_list_backup);
   }
 
-  if (err) {
+  if (err || (ww.update_copy && !close_success)) {
     BKE_report(reports, RPT_ERROR, strerror(errno));
     remove(tempname);
 
     return false;
   }
+  if (ww.discard) {
+    remove(tempname);
+    return false;
+  }
 
   /* File save to temporary file was successful, now do reverse file history
-   * (move `.blend1` -> `.blend2`, `.blend` -> `.blend1` .. etc). */
-  if (use_save_versions) {
+   * (move `.blend1` -> `.blend2`, `.blend` -> `.blend1` .. etc).
+   * Updated copies are not backed up, the previous save already is a version of the same data.
+   */
+  if (use_save_versions && !ww.update_copy) {
     if (!do_history(filepath, reports)) {
       BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
       return false;
@@ -1778,6 +2350,31 @@ static bool BLO_write_file_impl(Main *mainvar,
   return true;
 }
 
+static bool BLO_write_file_incremental(Main *mainvar,
+                                       const char *filepath,
+                                       const int write_flags,
+                                       const BlendFileWriteParams *params,
+                                       ReportList *reports)
+{
+  if (const IncrementalSaveState *prev_state = incremental_save_state_get(*mainvar, filepath)) {
+    IncrementalWriteWrap copy_wrap(prev_state);
+    const bool success = BLO_write_file_impl(
+        mainvar, filepath, write_flags, params, reports, copy_wrap);
+    if (!copy_wrap.needs_full_write()) {
+      /* After a failure the original file is unchanged, but the next save is a full one to
+       * recover from whatever went wrong. */
+      incremental_save_state_set(*mainvar,
+                                 success ? copy_wrap.state_release(filepath) : nullptr);
+      return success;
+    }
+  }
+
+  IncrementalWriteWrap wrap(nullptr);
+  const bool success = BLO_write_file_impl(mainvar, filepath, write_flags, params, reports, wrap);
+  incremental_save_state_set(*mainvar, success ? wrap.state_release(filepath) : nullptr);
+  return success;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1797,6 +2394,12 @@ bool BLO_write_file(Main *mainvar,
     return BLO_write_file_impl(mainvar, filepath, write_flags, params, reports, zstd_wrap);
   }
 
+  if ((write_flags & G_FILE_INCREMENTAL_SAVE) && !(write_flags & G_FILE_RECOVER_WRITE) &&
+      !params->use_save_as_copy && !params->use_userdef)
+  {
+    return BLO_write_file_incremental(mainvar, filepath, write_flags, params, reports);
+  }
+
   return BLO_write_file_impl(mainvar, filepath, write_flags, params, reports, raw_wrap);
 }
 
@@ -1810,6 +2413,74 @@ bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, const
   return (err == 0);
 }
 
+BlendFileWriteSnapshot *BLO_write_snapshot_create(Main *mainvar, const int write_flags)
+{
+  BlendFileWriteSnapshot *snapshot = MEM_new<BlendFileWriteSnapshot>(__func__);
+  SnapshotWriteWrap ww(*snapshot);
+
+  write_file_main_validate_pre(mainvar, nullptr);
+
+  const bool err = write_file_handle(
+      mainvar, &ww, nullptr, nullptr, write_flags, false, nullptr, nullptr);
+  if (err) {
+    MEM_delete(snapshot);
+    return nullptr;
+  }
+  return snapshot;
+}
+
+bool BLO_write_snapshot_file(const BlendFileWriteSnapshot *snapshot,
+                             const char *filepath,
+                             const int write_flags,
+                             ReportList *reports)
+{
+  char tempname[FILE_MAX + 1];
+  SNPRINTF(tempname, "%s@", filepath);
+
+  RawWriteWrap raw_wrap;
+  ZstdWriteWrap zstd_wrap(raw_wrap);
+  WriteWrap &ww = (write_flags & G_FILE_COMPRESS) ? static_cast<WriteWrap &>(zstd_wrap) :
+                                                    raw_wrap;
+
+  if (ww.open(tempname) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    return false;
+  }
+
+  bool success = true;
+  for (const BlendFileWriteSnapshot::Piece &piece : snapshot->pieces) {
+    /* Split big referenced data, so that it is compressed in multiple frames. */
+    for (size_t offset = 0; success && offset < piece.size; offset += ZSTD_CHUNK_SIZE) {
+      success = ww.write(POINTER_OFFSET(piece.data, offset),
+                         std::min<size_t>(piece.size - offset, ZSTD_CHUNK_SIZE));
+    }
+    if (!success) {
+      break;
+    }
+  }
+  if (!ww.close()) {
+    success = false;
+  }
+
+  if (!success) {
+    BKE_report(reports, RPT_ERROR, strerror(errno));
+    remove(tempname);
+    return false;
+  }
+
+  if (BLI_rename_overwrite(tempname, filepath) != 0) {
+    BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+    return false;
+  }
+  return true;
+}
+
+void BLO_write_snapshot_free(BlendFileWriteSnapshot *snapshot)
+{
+  MEM_delete(snapshot);
+}
+
 /*
  * API to write chunks of data.
  */
@@ -1992,6 +2663,12 @@ void BLO_write_shared(BlendWriter *writer,
       /* Was written already. */
       return;
     }
+    if (writer->wd->snapshot_ww) {
+      writer->wd->snapshot_shared_data = {data, sharing_info};
+      write_fn();
+      writer->wd->snapshot_shared_data = {};
+      return;
+    }
   }
   write_fn();
 }
@@ -0,0 +1,193 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include "BLI_listbase.h"
+#include "BLI_task.h"
+#include "BLI_vector.hh"
+
+#include "BLO_undofile.hh"
+
+#include "CLG_log.h"
+
+namespace blender::blenloader::tests {
+
+class UndoFileTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+  }
+  static void TearDownTestSuite()
+  {
+    CLG_exit();
+  }
+};
+
+static Vector<char> random_data(const int size, uint32_t seed)
+{
+  Vector<char> data(size);
+  for (char &value : data) {
+    seed = seed * 1664525 + 1013904223;
+    value = char(seed >> 24);
+  }
+  return data;
+}
+
+static void memfile_write(MemFile *memfile, MemFile *reference, const Span<char> data)
+{
+  MemFileWriteData mem_data{};
+  BLO_memfile_write_init(&mem_data, memfile, reference);
+  BLO_memfile_chunk_add(&mem_data, data.data(), data.size());
+  BLO_memfile_write_finalize(&mem_data);
+}
+
+static Vector<char> memfile_read(const MemFile &memfile)
+{
+  Vector<char> data;
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile.chunks) {
+    data.extend(Span<char>(chunk->buf, chunk->size));
+  }
+  return data;
+}
+
+TEST_F(UndoFileTest, ChunkContentDefinedBoundaries)
+{
+  const Vector<char> data = random_data(1024 * 1024, 1);
+  /* Insert a few bytes near the start, which shifts all following data. */
+  Vector<char> data_modified;
+  data_modified.extend(data.as_span().take_front(1000));
+  data_modified.extend({'a', 'b', 'c'});
+  data_modified.extend(data.as_span().drop_front(1000));
+
+  MemFile first{};
+  MemFile second{};
+  memfile_write(&first, nullptr, data);
+  memfile_write(&second, &first, data_modified);
+
+  EXPECT_EQ(memfile_read(first).as_span(), data.as_span());
+  EXPECT_EQ(memfile_read(second).as_span(), data_modified.as_span());
+  EXPECT_EQ(first.size, data.size());
+  EXPECT_EQ(second.size_total, data_modified.size());
+  /* Only the chunk containing the insertion needs new memory, chunk boundaries after it are the
+   * same as in the previous step. */
+  EXPECT_LE(second.size, 2 * 128 * 1024);
+
+  BLO_memfile_free(&first);
+  /* Shared buffers must stay valid when the step that created them is freed. */
+  EXPECT_EQ(memfile_read(second).as_span(), data_modified.as_span());
+  BLO_memfile_free(&second);
+
+  const MemFileChunkStoreStats stats = BLO_memfile_chunk_store_stats();
+  EXPECT_EQ(stats.size_referenced, 0);
+  EXPECT_EQ(stats.size_stored, 0);
+}
+
+TEST_F(UndoFileTest, ChunkDeduplicateMovedData)
+{
+  const Vector<char> data_a = random_data(1024 * 1024, 3);
+  const Vector<char> data_b = random_data(1024 * 1024, 4);
+  Vector<char> data_ab;
+  data_ab.extend(data_a);
+  data_ab.extend(data_b);
+  Vector<char> data_ba;
+  data_ba.extend(data_b);
+  data_ba.extend(data_a);
+
+  MemFile first{};
+  MemFile second{};
+  memfile_write(&first, nullptr, data_ab);
+  memfile_write(&second, &first, data_ba);
+
+  EXPECT_EQ(memfile_read(second).as_span(), data_ba.as_span());
+  /* The data is not at the same position anymore, but most of it is shared by content. */
+  EXPECT_LE(second.size, 4 * 128 * 1024);
+  EXPECT_EQ(second.size + second.size_deduplicated, data_ba.size());
+
+  const MemFileChunkStoreStats stats = BLO_memfile_chunk_store_stats();
+  EXPECT_EQ(stats.size_referenced, data_ab.size() + data_ba.size());
+  EXPECT_EQ(stats.size_stored, first.size + second.size);
+
+  BLO_memfile_free(&first);
+  BLO_memfile_free(&second);
+}
+
+TEST_F(UndoFileTest, ChunkIdenticalToPreviousStep)
+{
+  const Vector<char> data = random_data(300 * 1024, 2);
+
+  MemFile first{};
+  MemFile second{};
+  memfile_write(&first, nullptr, data);
+  memfile_write(&second, &first, data);
+
+  EXPECT_EQ(second.size, 0);
+  EXPECT_EQ(second.size_deduplicated, 0);
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &second.chunks) {
+    EXPECT_TRUE(chunk->is_identical);
+  }
+  EXPECT_EQ(BLI_listbase_count(&first.chunks), BLI_listbase_count(&second.chunks));
+
+  BLO_memfile_merge(&first, &second);
+  EXPECT_EQ(memfile_read(second).as_span(), data.as_span());
+  BLO_memfile_free(&second);
+}
+
+TEST_F(UndoFileTest, ChunkCompression)
+{
+  /* Compressible data, with repeated patterns. */
+  Vector<char> data = random_data(512 * 1024, 5);
+  for (const int i : data.index_range()) {
+    data[i] = data[i] & 0x3;
+  }
+  Vector<char> data_modified = data;
+  data_modified.first() = 'a';
+
+  MemFile first{};
+  MemFile second{};
+  memfile_write(&first, nullptr, data);
+  memfile_write(&second, &first, data_modified);
+
+  EXPECT_EQ(BLO_memfile_memory_size(&first), first.size);
+  TaskPool *task_pool = BLI_task_pool_create_background(nullptr, TASK_PRIORITY_LOW);
+  BLO_memfile_compress(&first, task_pool);
+  BLI_task_pool_work_and_wait(task_pool);
+
+  /* Only the buffer which isn't shared with the uncompressed memfile is compressed. */
+  MemFileChunkStoreStats stats = BLO_memfile_chunk_store_stats();
+  const MemFileChunk *first_chunk = static_cast<const MemFileChunk *>(first.chunks.first);
+  EXPECT_EQ(stats.size_stored_compressed, first_chunk->size);
+  EXPECT_LT(stats.size_compressed, stats.size_stored_compressed);
+
+  BLO_memfile_compress(&second, task_pool);
+  BLI_task_pool_work_and_wait(task_pool);
+  stats = BLO_memfile_chunk_store_stats();
+  EXPECT_EQ(stats.size_stored_compressed, stats.size_stored);
+  /* The compressed size counts against the undo memory limit. */
+  EXPECT_LT(BLO_memfile_memory_size(&first), first.size);
+  EXPECT_LT(BLO_memfile_memory_size(&second), second.size);
+
+  BLO_memfile_decompress(&first);
+  EXPECT_EQ(memfile_read(first).as_span(), data.as_span());
+  EXPECT_EQ(BLO_memfile_memory_size(&first), first.size);
+  BLO_memfile_free(&first);
+
+  /* Writing with a compressed reference decompresses it. */
+  MemFile third{};
+  memfile_write(&third, &second, data_modified);
+  EXPECT_FALSE(second.is_compressed);
+  EXPECT_EQ(third.size, 0);
+  EXPECT_EQ(memfile_read(second).as_span(), data_modified.as_span());
+
+  BLI_task_pool_free(task_pool);
+  BLO_memfile_free(&second);
+  BLO_memfile_free(&third);
+
+  stats = BLO_memfile_chunk_store_stats();
+  EXPECT_EQ(stats.size_stored, 0);
+  EXPECT_EQ(stats.size_compressed, 0);
+}
+
+}  // namespace blender::blenloader::tests
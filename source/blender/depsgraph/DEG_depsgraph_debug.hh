@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdio>
 
 #include "BLI_string_ref.hh"
@@ -42,6 +43,12 @@ void DEG_stats_simple(const Depsgraph *graph,
                       size_t *r_operations,
                       size_t *r_relations);
 
+/**
+ * Fraction of the time of all threads which was spent on evaluating operations during the last
+ * evaluation of the graph. Only measured with `--debug-depsgraph-time`.
+ */
+float DEG_stats_thread_utilization(const Depsgraph *graph);
+
 /* ************************************************ */
 /* Diagram-Based Graph Debugging */
 
@@ -52,6 +59,45 @@ void DEG_debug_stats_gnuplot(const Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* ************************************************ */
+/* Evaluation Timeline Trace */
+
+/**
+ * Record a timeline of the evaluation: operations, copy-on-evaluation, modifiers and geometry
+ * nodes. Only the latest events of every thread are kept, so the trace can stay enabled.
+ */
+void DEG_trace_enable(bool enable);
+bool DEG_trace_is_enabled();
+/** Remove all recorded events. */
+void DEG_trace_clear();
+/** Write the recorded events in the Chrome trace event format. */
+bool DEG_trace_export(const char *filepath);
+/** Enable the trace, and write it to the given file when Blender exits. */
+void DEG_trace_export_on_exit(const char *filepath);
+
+namespace blender::deg {
+
+/**
+ * Record a span of the evaluation trace for the lifetime of this object, if the trace is enabled.
+ * The category and label are expected to be static strings, the name is to outlive the scope.
+ */
+class TraceScope {
+  const char *category_;
+  const char *label_;
+  StringRef name_;
+  bool enabled_;
+  uint64_t start_ = 0;
+
+ public:
+  TraceScope(const char *category, const char *label, StringRef name);
+  ~TraceScope();
+
+  TraceScope(const TraceScope &other) = delete;
+  TraceScope &operator=(const TraceScope &other) = delete;
+};
+
+}  // namespace blender::deg
+
 /* ************************************************ */
 
 /** Compare two dependency graphs. */
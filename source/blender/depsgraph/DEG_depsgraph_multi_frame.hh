@@ -0,0 +1,78 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Evaluation of a range of frames for baking and exporting.
+ *
+ * When none of the data-blocks depend on the state of previous frames, every frame can be
+ * evaluated from scratch by its own dependency graph. Several graphs are then evaluated at
+ * different frames concurrently, while the caller receives the evaluated frames in order. The
+ * number of frames evaluated ahead of the caller is bounded by the number of graphs.
+ *
+ * Simulations, point caches and rigid bodies need the previous frame to be evaluated first, with
+ * those the frames are evaluated one after another on the original graph.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "BLI_function_ref.hh"
+#include "BLI_span.hh"
+#include "BLI_vector.hh"
+
+struct Depsgraph;
+
+namespace blender::deg {
+
+class MultiFrameEvaluator {
+ public:
+  /* Build the relations of a newly created graph, the same way the original graph was built. */
+  using BuildFn = std::function<void(::Depsgraph *depsgraph)>;
+  /* Receives a graph evaluated at the given frame. Returning false stops the evaluation. */
+  using FrameFn = FunctionRef<bool(double frame, ::Depsgraph *depsgraph)>;
+
+ private:
+  ::Depsgraph *depsgraph_;
+  /* Additional graphs owned by the evaluator, only created for concurrent evaluation. */
+  Vector<::Depsgraph *> graphs_;
+  bool is_concurrent_ = false;
+
+ public:
+  /**
+   * Create the evaluator for an already built graph. When concurrent evaluation is possible,
+   * `graphs_num - 1` more graphs are created and built with the given function.
+   *
+   * Building graphs can modify original data, so this has to be called from the main thread.
+   */
+  MultiFrameEvaluator(::Depsgraph *depsgraph, const BuildFn &build_fn, int graphs_num);
+  ~MultiFrameEvaluator();
+
+  MultiFrameEvaluator(const MultiFrameEvaluator &other) = delete;
+  MultiFrameEvaluator &operator=(const MultiFrameEvaluator &other) = delete;
+
+  /* Number of graphs to use when the caller has no better estimate, based on the thread count. */
+  static int default_graphs_num();
+
+  /* Whether any data-block in the graph depends on the evaluation of previous frames. */
+  static bool has_frame_dependency(const ::Depsgraph *depsgraph);
+
+  /* Whether frames are evaluated concurrently, otherwise they are evaluated one after another. */
+  bool is_concurrent() const;
+
+  /**
+   * Evaluate the graph at all the given frames and call the function for every one of them in
+   * order, on the calling thread. The graph passed to the function is only valid until it
+   * returns.
+   *
+   * When frames are evaluated one after another the frame of the input scene is changed and
+   * frame change handlers are run, as with #BKE_scene_graph_update_for_newframe. Frames evaluated
+   * concurrently do not modify the input scene and do not run the handlers.
+   */
+  void evaluate(Span<double> frames, FrameFn fn);
+};
+
+}  // namespace blender::deg
@@ -511,6 +511,11 @@ Depsgraph *DepsgraphRelationBuilder::getGraph()
 
 void DepsgraphRelationBuilder::begin_build() {}
 
+void DepsgraphRelationBuilder::tag_id_built(ID *id)
+{
+  built_map_.tagBuild(id);
+}
+
 void DepsgraphRelationBuilder::build_id(ID *id)
 {
   if (id == nullptr) {
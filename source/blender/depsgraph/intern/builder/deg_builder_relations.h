@@ -84,6 +84,10 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   void begin_build();
 
+  /* Skip building the relations of the ID, used when they are restored from the relations cache
+   * instead. */
+  void tag_id_built(ID *id);
+
   template<typename KeyFrom, typename KeyTo>
   Relation *add_relation(const KeyFrom &key_from,
                          const KeyTo &key_to,
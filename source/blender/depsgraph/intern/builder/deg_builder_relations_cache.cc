@@ -0,0 +1,1271 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/builder/deg_builder_relations_cache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_ID.h"
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_collection_types.h"
+#include "DNA_constraint_types.h"
+#include "DNA_curve_types.h"
+#include "DNA_key_types.h"
+#include "DNA_layer_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_node_types.h"
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+#include "DNA_particle_types.h"
+#include "DNA_rigidbody_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_sequence_types.h"
+#include "DNA_shader_fx_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_linear_allocator.hh"
+#include "BLI_listbase.h"
+#include "BLI_map.hh"
+#include "BLI_path_utils.hh"
+#include "BLI_set.hh"
+#include "BLI_string.h"
+#include "BLI_struct_equality_utils.hh"
+#include "BLI_task.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_anim_data.hh"
+#include "BKE_appdir.hh"
+#include "BKE_constraint.h"
+#include "BKE_lib_query.hh"
+#include "BKE_modifier.hh"
+
+#include "DEG_depsgraph_physics.hh"
+
+#include "intern/depsgraph.hh"
+#include "intern/depsgraph_physics.hh"
+#include "intern/depsgraph_relation.hh"
+#include "intern/depsgraph_type.hh"
+#include "intern/node/deg_node.hh"
+#include "intern/node/deg_node_component.hh"
+#include "intern/node/deg_node_id.hh"
+#include "intern/node/deg_node_operation.hh"
+#include "intern/node/deg_node_time.hh"
+
+#include "xxhash.h"
+
+namespace blender::deg {
+
+/* Number of entries kept in memory. */
+static constexpr int RELATIONS_CACHE_MEMORY_ENTRIES = 4;
+/* Number of entries kept on disk, the least recently written ones are removed first. */
+static constexpr int RELATIONS_CACHE_DISK_ENTRIES = 32;
+/* Relations which are built faster than this (in seconds) are not written to disk: reading them
+ * back would not be noticeably faster than building them. */
+static constexpr double RELATIONS_CACHE_DISK_MIN_BUILD_TIME = 0.1;
+
+static constexpr char RELATIONS_CACHE_FILE_MAGIC[8] = {'B', 'D', 'E', 'G', 'R', 'E', 'L', 'S'};
+/* Bump when the file format or the key calculation changes. */
+static constexpr uint32_t RELATIONS_CACHE_FILE_VERSION = 2;
+
+/* Index used for relations coming from the time source node. */
+static constexpr int TIME_SOURCE_INDEX = -1;
+
+struct CachedRelation {
+  /* Indices into Depsgraph::operations, or TIME_SOURCE_INDEX. */
+  int from;
+  int to;
+  int flag;
+  /* Index into RelationsCacheEntry::names, or -1 for relations without name. */
+  int name;
+};
+
+/* State of an ID node which is set by the relations builder. */
+struct CachedIDNodeState {
+  uint32_t eval_flags;
+  DEGCustomDataMeshMasks customdata_masks;
+};
+
+/* Collision and effector relations created by the relations builder. */
+struct CachedPhysicsRelations {
+  int type;
+  /* Index into Depsgraph::id_nodes of the collection, or -1 for the whole scene. */
+  int collection;
+};
+
+/* Identifies an operation across builds of the same view layer in a session. */
+struct CachedOperationIdentity {
+  /* ID::session_uid of the owner ID. */
+  uint id_session_uid;
+  /* Hash of the component and operation names and types. */
+  uint64_t name_hash;
+
+  uint64_t hash() const
+  {
+    return get_default_hash(id_session_uid, name_hash);
+  }
+
+  BLI_STRUCT_EQUALITY_OPERATORS_2(CachedOperationIdentity, id_session_uid, name_hash)
+};
+
+struct RelationsCacheEntry {
+  RelationsCacheKey key;
+  int operations_num = 0;
+  int id_nodes_num = 0;
+  Vector<std::string> names;
+  Vector<CachedRelation> relations;
+  Vector<CachedIDNodeState> id_node_states;
+  Vector<CachedPhysicsRelations> physics_relations;
+
+  /* Data used for partial updates, only set for entries built in this session (session UIDs are
+   * not persistent). */
+  RelationsCacheKey owner_key;
+  Vector<uint> id_session_uids;
+  Vector<RelationsCacheKey> id_keys;
+  Vector<CachedOperationIdentity> operation_identities;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Key
+ * \{ */
+
+namespace {
+
+class KeyHasher {
+ private:
+  XXH3_state_t *state_;
+
+ public:
+  KeyHasher() : state_(XXH3_createState())
+  {
+    XXH3_128bits_reset(state_);
+  }
+
+  ~KeyHasher()
+  {
+    XXH3_freeState(state_);
+  }
+
+  void reset()
+  {
+    XXH3_128bits_reset(state_);
+  }
+
+  template<typename T> void add(const T &value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    XXH3_128bits_update(state_, &value, sizeof(T));
+  }
+
+  void add_string(const StringRef str)
+  {
+    this->add(str.size());
+    XXH3_128bits_update(state_, str.data(), str.size());
+  }
+
+  void add_id(const ID *id)
+  {
+    if (id == nullptr) {
+      this->add(int64_t(-1));
+      return;
+    }
+    this->add_string(id->name);
+    this->add_string(id->lib ? id->lib->filepath : "");
+  }
+
+  RelationsCacheKey digest() const
+  {
+    const XXH128_hash_t hash = XXH3_128bits_digest(state_);
+    return {hash.low64, hash.high64};
+  }
+};
+
+}  // namespace
+
+static void hash_constraints(KeyHasher &hasher, ListBase &constraints)
+{
+  LISTBASE_FOREACH (bConstraint *, con, &constraints) {
+    hasher.add(con->type);
+    hasher.add(con->flag);
+    hasher.add(con->ownspace);
+    hasher.add_string(con->name);
+    hasher.add_string(con->space_subtarget);
+    ListBase targets = {nullptr, nullptr};
+    if (BKE_constraint_targets_get(con, &targets)) {
+      LISTBASE_FOREACH (const bConstraintTarget *, ct, &targets) {
+        hasher.add_string(ct->subtarget);
+        hasher.add(ct->flag);
+        hasher.add(ct->space);
+      }
+      BKE_constraint_targets_flush(con, &targets, true);
+    }
+  }
+}
+
+/* Settings read by the #ModifierTypeInfo::update_depsgraph callbacks, besides ID pointers. */
+static void hash_modifier(KeyHasher &hasher, Scene *scene, ModifierData *md)
+{
+  hasher.add(md->type);
+  hasher.add(md->mode);
+  hasher.add(md->flag);
+  hasher.add_string(md->name);
+  hasher.add(BKE_modifier_depends_ontime(scene, md));
+  switch (ModifierType(md->type)) {
+    case eModifierType_Armature:
+      hasher.add(reinterpret_cast<const ArmatureModifierData *>(md)->deformflag);
+      break;
+    case eModifierType_Hook:
+      hasher.add_string(reinterpret_cast<const HookModifierData *>(md)->subtarget);
+      break;
+    case eModifierType_Shrinkwrap:
+      hasher.add(reinterpret_cast<const ShrinkwrapModifierData *>(md)->shrinkType);
+      break;
+    case eModifierType_DataTransfer: {
+      const DataTransferModifierData *dtmd = reinterpret_cast<const DataTransferModifierData *>(
+          md);
+      hasher.add(dtmd->data_types);
+      hasher.add(dtmd->flags);
+      break;
+    }
+    case eModifierType_Displace:
+    case eModifierType_Wave:
+    case eModifierType_Warp: {
+      const MappingInfoModifierData *mmd = reinterpret_cast<const MappingInfoModifierData *>(md);
+      hasher.add(mmd->texmapping);
+      hasher.add_string(mmd->map_bone);
+      if (md->type == eModifierType_Warp) {
+        const WarpModifierData *wmd = reinterpret_cast<const WarpModifierData *>(md);
+        hasher.add_string(wmd->bone_from);
+        hasher.add_string(wmd->bone_to);
+      }
+      break;
+    }
+    case eModifierType_UVWarp: {
+      const UVWarpModifierData *umd = reinterpret_cast<const UVWarpModifierData *>(md);
+      hasher.add_string(umd->bone_src);
+      hasher.add_string(umd->bone_dst);
+      break;
+    }
+    case eModifierType_WeightVGEdit: {
+      const WeightVGEditModifierData *wmd = reinterpret_cast<const WeightVGEditModifierData *>(
+          md);
+      hasher.add(wmd->mask_tex_mapping);
+      hasher.add_string(wmd->mask_tex_map_bone);
+      break;
+    }
+    case eModifierType_WeightVGMix: {
+      const WeightVGMixModifierData *wmd = reinterpret_cast<const WeightVGMixModifierData *>(md);
+      hasher.add(wmd->mask_tex_mapping);
+      hasher.add_string(wmd->mask_tex_map_bone);
+      break;
+    }
+    case eModifierType_WeightVGProximity: {
+      const WeightVGProximityModifierData *wmd =
+          reinterpret_cast<const WeightVGProximityModifierData *>(md);
+      hasher.add(wmd->mask_tex_mapping);
+      hasher.add_string(wmd->mask_tex_map_bone);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void hash_object(KeyHasher &hasher, Scene *scene, Object *object)
+{
+  hasher.add(object->type);
+  hasher.add(object->partype);
+  hasher.add_string(object->parsubstr);
+  hasher.add(object->transflag);
+  hasher.add(object->totcol);
+  LISTBASE_FOREACH (ModifierData *, md, &object->modifiers) {
+    hash_modifier(hasher, scene, md);
+  }
+  hash_constraints(hasher, object->constraints);
+  LISTBASE_FOREACH (const ShaderFxData *, fx, &object->shader_fx) {
+    hasher.add(fx->type);
+    hasher.add(fx->mode);
+    hasher.add(fx->flag);
+  }
+  LISTBASE_FOREACH (const ParticleSystem *, psys, &object->particlesystem) {
+    hasher.add_string(psys->name);
+    hasher.add(psys->flag);
+  }
+  hasher.add(object->pd != nullptr);
+  if (object->pd != nullptr) {
+    hasher.add(object->pd->flag);
+    hasher.add(object->pd->forcefield);
+    hasher.add(object->pd->shape);
+  }
+  hasher.add(object->rigidbody_object != nullptr);
+  if (object->rigidbody_object != nullptr) {
+    hasher.add(object->rigidbody_object->type);
+    hasher.add(object->rigidbody_object->flag);
+  }
+  hasher.add(object->rigidbody_constraint != nullptr);
+  if (object->rigidbody_constraint != nullptr) {
+    hasher.add(object->rigidbody_constraint->type);
+    hasher.add(object->rigidbody_constraint->flag);
+  }
+  hasher.add(object->pose != nullptr);
+  if (object->pose != nullptr) {
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &object->pose->chanbase) {
+      hasher.add_string(pchan->name);
+      hash_constraints(hasher, pchan->constraints);
+    }
+  }
+}
+
+static void hash_bones(KeyHasher &hasher, const ListBase &bones)
+{
+  hasher.add(BLI_listbase_count(&bones));
+  LISTBASE_FOREACH (const Bone *, bone, &bones) {
+    hasher.add_string(bone->name);
+    hasher.add(bone->flag);
+    hasher.add(bone->segments);
+    hasher.add(bone->bbone_prev_type);
+    hasher.add(bone->bbone_next_type);
+    hasher.add(bone->bbone_flag);
+    hash_bones(hasher, bone->childbase);
+  }
+}
+
+static void hash_strips(KeyHasher &hasher, const ListBase &strips)
+{
+  hasher.add(BLI_listbase_count(&strips));
+  LISTBASE_FOREACH (const Strip *, strip, &strips) {
+    hasher.add_string(strip->name);
+    hasher.add(strip->type);
+    hasher.add(strip->flag);
+    hash_strips(hasher, strip->seqbase);
+  }
+}
+
+static void hash_node_tree(KeyHasher &hasher, const bNodeTree *ntree)
+{
+  hasher.add(ntree->type);
+  for (const bNode *node : ntree->all_nodes()) {
+    hasher.add_string(node->idname);
+    hasher.add_string(node->name);
+    hasher.add(node->flag);
+    hasher.add(node->custom1);
+    hasher.add(node->custom2);
+  }
+  LISTBASE_FOREACH (const bNodeLink *, link, &ntree->links) {
+    hasher.add_string(link->fromnode->name);
+    hasher.add_string(link->fromsock->identifier);
+    hasher.add_string(link->tonode->name);
+    hasher.add_string(link->tosock->identifier);
+    hasher.add(link->flag);
+  }
+}
+
+static void hash_driver(KeyHasher &hasher, const ChannelDriver &driver)
+{
+  hasher.add(driver.type);
+  hasher.add(driver.flag);
+  /* The expression decides whether the driver depends on time. */
+  hasher.add_string(driver.expression);
+  LISTBASE_FOREACH (const DriverVar *, dvar, &driver.variables) {
+    hasher.add_string(dvar->name);
+    hasher.add(dvar->type);
+    hasher.add(dvar->flag);
+    hasher.add(dvar->num_targets);
+    for (const int i : IndexRange(dvar->num_targets)) {
+      const DriverTarget &dtar = dvar->targets[i];
+      hasher.add_id(dtar.id);
+      hasher.add(dtar.idtype);
+      hasher.add(dtar.flag);
+      hasher.add(dtar.transChan);
+      hasher.add(dtar.rotation_mode);
+      hasher.add(dtar.options);
+      hasher.add(dtar.context_property);
+      hasher.add_string(dtar.rna_path ? dtar.rna_path : "");
+      hasher.add_string(dtar.pchan_name);
+    }
+  }
+}
+
+/**
+ * Hash the original data of the ID which the relations are built from, and gather the IDs it
+ * references. Only plain DNA data is read, so that this is thread-safe and has no side effects.
+ * Floating point values are skipped: relations never depend on them, while they are the values
+ * which change the most (on every animated frame for example).
+ */
+static void hash_id_data(KeyHasher &hasher, Scene *scene, ID *id, Vector<ID *> &r_references)
+{
+  hasher.add_id(id);
+
+  BKE_library_foreach_ID_link(
+      nullptr,
+      id,
+      [&](LibraryIDLinkCallbackData *cb_data) {
+        ID *id_reference = *cb_data->id_pointer;
+        hasher.add(cb_data->cb_flag);
+        hasher.add_id(id_reference);
+        if (id_reference != nullptr) {
+          r_references.append(id_reference);
+        }
+        return IDWALK_RET_NOP;
+      },
+      nullptr,
+      IDWALK_READONLY);
+
+  BKE_fcurves_id_cb(id, [&](ID * /*owner_id*/, FCurve *fcurve) {
+    hasher.add_string(fcurve->rna_path ? fcurve->rna_path : "");
+    hasher.add(fcurve->array_index);
+    hasher.add(fcurve->driver != nullptr);
+    if (fcurve->driver != nullptr) {
+      hash_driver(hasher, *fcurve->driver);
+    }
+  });
+
+  switch (GS(id->name)) {
+    case ID_OB:
+      hash_object(hasher, scene, reinterpret_cast<Object *>(id));
+      break;
+    case ID_AR:
+      hash_bones(hasher, reinterpret_cast<const bArmature *>(id)->bonebase);
+      break;
+    case ID_SCE: {
+      const Scene *id_scene = reinterpret_cast<const Scene *>(id);
+      hasher.add(id_scene->rigidbody_world != nullptr);
+      if (id_scene->rigidbody_world != nullptr) {
+        hasher.add(id_scene->rigidbody_world->flag);
+      }
+      hasher.add(id_scene->ed != nullptr);
+      if (id_scene->ed != nullptr) {
+        hash_strips(hasher, id_scene->ed->seqbase);
+      }
+      break;
+    }
+    case ID_NT:
+      hash_node_tree(hasher, reinterpret_cast<const bNodeTree *>(id));
+      break;
+    case ID_PA: {
+      const ParticleSettings *part = reinterpret_cast<const ParticleSettings *>(id);
+      hasher.add(part->type);
+      hasher.add(part->phystype);
+      hasher.add(part->ren_as);
+      hasher.add(part->flag);
+      break;
+    }
+    case ID_CU_LEGACY:
+      hasher.add(reinterpret_cast<const Curve *>(id)->flag);
+      break;
+    case ID_KE:
+      LISTBASE_FOREACH (const KeyBlock *, kb, &reinterpret_cast<const Key *>(id)->block) {
+        hasher.add_string(kb->name);
+        hasher.add_string(kb->vgroup);
+        hasher.add(kb->relative);
+        hasher.add(kb->flag);
+      }
+      break;
+    case ID_GR:
+      hasher.add(reinterpret_cast<const Collection *>(id)->flag);
+      break;
+    default:
+      break;
+  }
+}
+
+/* Identifies the operation across builds of the same view layer. */
+static CachedOperationIdentity operation_identity(KeyHasher &hasher, const OperationNode *op_node)
+{
+  const ComponentNode *comp_node = op_node->owner;
+  hasher.reset();
+  hasher.add(comp_node->type);
+  hasher.add_string(comp_node->name);
+  hasher.add(op_node->opcode);
+  hasher.add_string(op_node->name);
+  hasher.add(op_node->name_tag);
+  return {comp_node->owner->id_orig->session_uid, hasher.digest().low};
+}
+
+RelationsCacheKeys deg_relations_cache_keys(const Depsgraph *graph)
+{
+  const int id_nodes_num = graph->id_nodes.size();
+  RelationsCacheKeys keys;
+  keys.ids.reinitialize(id_nodes_num);
+  keys.id_references.reinitialize(id_nodes_num);
+
+  Map<const IDNode *, int> id_node_indices;
+  id_node_indices.reserve(id_nodes_num);
+  for (const int i : IndexRange(id_nodes_num)) {
+    id_node_indices.add_new(graph->id_nodes[i], i);
+  }
+
+  /* Hash the original data of every ID separately, which is the expensive part. */
+  threading::parallel_for(IndexRange(id_nodes_num), 64, [&](const IndexRange range) {
+    KeyHasher hasher;
+    Vector<ID *> references;
+    for (const int i : range) {
+      const IDNode *id_node = graph->id_nodes[i];
+      hasher.reset();
+      references.clear();
+      hash_id_data(hasher, graph->scene, id_node->id_orig, references);
+      hasher.add(id_node->linked_state);
+      hasher.add(id_node->has_base);
+      hasher.add(id_node->is_visible_on_build);
+      keys.ids[i] = hasher.digest();
+      for (ID *id_reference : references) {
+        if (const IDNode *id_node = graph->find_id_node(id_reference)) {
+          keys.id_references[i].append(id_node_indices.lookup(id_node));
+        }
+      }
+    }
+  });
+
+  KeyHasher hasher;
+  hasher.add(RELATIONS_CACHE_FILE_VERSION);
+  hasher.add(graph->mode);
+  hasher.add(graph->is_active);
+  hasher.add_id(&graph->scene->id);
+  hasher.add_string(graph->view_layer->name);
+  keys.owner = hasher.digest();
+
+  for (const int i : IndexRange(id_nodes_num)) {
+    hasher.add(keys.ids[i]);
+  }
+
+  /* The operations created by the nodes builder, in the order the relations refer to them. */
+  hasher.add(graph->operations.size());
+  for (const OperationNode *op_node : graph->operations) {
+    const ComponentNode *comp_node = op_node->owner;
+    hasher.add(id_node_indices.lookup(comp_node->owner));
+    hasher.add(comp_node->type);
+    hasher.add_string(comp_node->name);
+    hasher.add(op_node->opcode);
+    hasher.add_string(op_node->name);
+    hasher.add(op_node->name_tag);
+    hasher.add(op_node->flag);
+  }
+  hasher.add(graph->time_source != nullptr);
+
+  keys.graph = hasher.digest();
+  return keys;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Storage
+ * \{ */
+
+struct RelationsCacheStorage {
+  std::mutex mutex;
+  /* Most recently used entries last. */
+  Vector<std::shared_ptr<const RelationsCacheEntry>> entries;
+  /* Relation names have to outlive the graphs the relations are restored into. */
+  LinearAllocator<> names_allocator;
+  Set<StringRefNull> names;
+};
+
+static RelationsCacheStorage *relations_cache_storage = nullptr;
+
+static RelationsCacheStorage &relations_cache_storage_ensure()
+{
+  if (relations_cache_storage == nullptr) {
+    relations_cache_storage = MEM_new<RelationsCacheStorage>(__func__);
+  }
+  return *relations_cache_storage;
+}
+
+/* Must be called with the storage mutex locked. */
+static const char *relations_cache_name_intern(RelationsCacheStorage &storage,
+                                               const StringRef name)
+{
+  const StringRefNull *existing = storage.names.lookup_key_ptr_as(name);
+  if (existing != nullptr) {
+    return existing->c_str();
+  }
+  const StringRefNull copy = storage.names_allocator.copy_string(name);
+  storage.names.add_new(copy);
+  return copy.c_str();
+}
+
+bool deg_relations_cache_is_enabled()
+{
+  return USER_EXPERIMENTAL_TEST(&U, use_depsgraph_relations_cache);
+}
+
+void deg_relations_cache_clear()
+{
+  MEM_delete(relations_cache_storage);
+  relations_cache_storage = nullptr;
+}
+
+static bool relations_cache_filepath(const RelationsCacheKey &key, char *r_filepath)
+{
+  if (!BKE_appdir_folder_caches(r_filepath, FILE_MAX)) {
+    return false;
+  }
+  char filename[64];
+  SNPRINTF(filename, "%016" PRIx64 "%016" PRIx64 ".bin", key.high, key.low);
+  BLI_path_append(r_filepath, FILE_MAX, "depsgraph-relations");
+  BLI_path_append(r_filepath, FILE_MAX, filename);
+  return true;
+}
+
+template<typename T> static void write_value(FILE *file, const T &value)
+{
+  fwrite(&value, sizeof(T), 1, file);
+}
+
+template<typename T> static void write_array(FILE *file, const Span<T> values)
+{
+  write_value(file, int64_t(values.size()));
+  fwrite(values.data(), sizeof(T), values.size(), file);
+}
+
+template<typename T> static bool read_value(FILE *file, T &r_value)
+{
+  return fread(&r_value, sizeof(T), 1, file) == 1;
+}
+
+template<typename T> static bool read_array(FILE *file, Vector<T> &r_values)
+{
+  int64_t size;
+  if (!read_value(file, size) || size < 0 || size > INT32_MAX) {
+    return false;
+  }
+  r_values.resize(size);
+  return fread(r_values.data(), sizeof(T), size, file) == size_t(size);
+}
+
+static void relations_cache_disk_prune(const char *dirpath)
+{
+  direntry *entries = nullptr;
+  const uint entries_num = BLI_filelist_dir_contents(dirpath, &entries);
+  Vector<const direntry *> files;
+  for (const direntry &entry : Span(entries, entries_num)) {
+    if (S_ISREG(entry.type) && BLI_str_endswith(entry.relname, ".bin")) {
+      files.append(&entry);
+    }
+  }
+  if (files.size() > RELATIONS_CACHE_DISK_ENTRIES) {
+    std::sort(files.begin(), files.end(), [](const direntry *a, const direntry *b) {
+      return a->s.st_mtime > b->s.st_mtime;
+    });
+    for (const direntry *entry : files.as_span().drop_front(RELATIONS_CACHE_DISK_ENTRIES)) {
+      BLI_delete(entry->path, false, false);
+    }
+  }
+  BLI_filelist_free(entries, entries_num);
+}
+
+static void relations_cache_disk_write(const RelationsCacheEntry &entry)
+{
+  char filepath[FILE_MAX];
+  if (!relations_cache_filepath(entry.key, filepath)) {
+    return;
+  }
+  if (!BLI_file_ensure_parent_dir_exists(filepath)) {
+    return;
+  }
+  /* Write to a temporary file first, so that other instances never read partial files. */
+  char filepath_tmp[FILE_MAX];
+  SNPRINTF(filepath_tmp, "%s@", filepath);
+  FILE *file = BLI_fopen(filepath_tmp, "wb");
+  if (file == nullptr) {
+    return;
+  }
+  fwrite(RELATIONS_CACHE_FILE_MAGIC, sizeof(RELATIONS_CACHE_FILE_MAGIC), 1, file);
+  write_value(file, RELATIONS_CACHE_FILE_VERSION);
+  write_value(file, entry.key);
+  write_value(file, entry.operations_num);
+  write_value(file, entry.id_nodes_num);
+  write_value(file, int64_t(entry.names.size()));
+  for (const std::string &name : entry.names) {
+    write_array(file, Span(name.data(), name.size()));
+  }
+  write_array(file, entry.relations.as_span());
+  write_array(file, entry.id_node_states.as_span());
+  write_array(file, entry.physics_relations.as_span());
+  const bool success = ferror(file) == 0;
+  fclose(file);
+
+  if (!success || BLI_rename_overwrite(filepath_tmp, filepath) != 0) {
+    BLI_delete(filepath_tmp, false, false);
+    return;
+  }
+
+  char dirpath[FILE_MAX];
+  BLI_path_split_dir_part(filepath, dirpath, sizeof(dirpath));
+  relations_cache_disk_prune(dirpath);
+}
+
+static std::shared_ptr<RelationsCacheEntry> relations_cache_disk_read(const RelationsCacheKey &key)
+{
+  char filepath[FILE_MAX];
+  if (!relations_cache_filepath(key, filepath) || !BLI_exists(filepath)) {
+    return nullptr;
+  }
+  FILE *file = BLI_fopen(filepath, "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  std::shared_ptr<RelationsCacheEntry> entry = std::make_shared<RelationsCacheEntry>();
+  char magic[sizeof(RELATIONS_CACHE_FILE_MAGIC)];
+  uint32_t version;
+  int64_t names_num;
+  bool success = fread(magic, sizeof(magic), 1, file) == 1 &&
+                 memcmp(magic, RELATIONS_CACHE_FILE_MAGIC, sizeof(magic)) == 0 &&
+                 read_value(file, version) && version == RELATIONS_CACHE_FILE_VERSION &&
+                 read_value(file, entry->key) && entry->key == key &&
+                 read_value(file, entry->operations_num) &&
+                 read_value(file, entry->id_nodes_num) && read_value(file, names_num) &&
+                 names_num >= 0 && names_num <= INT32_MAX;
+  if (success) {
+    entry->names.reserve(names_num);
+    Vector<char> name;
+    for ([[maybe_unused]] const int64_t i : IndexRange(names_num)) {
+      if (!read_array(file, name)) {
+        success = false;
+        break;
+      }
+      entry->names.append(std::string(name.data(), name.size()));
+    }
+  }
+  success = success && read_array(file, entry->relations) &&
+            read_array(file, entry->id_node_states) && read_array(file, entry->physics_relations);
+  fclose(file);
+
+  if (!success) {
+    BLI_delete(filepath, false, false);
+    return nullptr;
+  }
+  return entry;
+}
+
+static std::shared_ptr<const RelationsCacheEntry> relations_cache_lookup(
+    const RelationsCacheKey &key)
+{
+  RelationsCacheStorage &storage = relations_cache_storage_ensure();
+  {
+    std::lock_guard lock(storage.mutex);
+    for (const int i : storage.entries.index_range()) {
+      if (storage.entries[i]->key == key) {
+        std::shared_ptr<const RelationsCacheEntry> entry = storage.entries[i];
+        storage.entries.remove(i);
+        storage.entries.append(entry);
+        return entry;
+      }
+    }
+  }
+  std::shared_ptr<const RelationsCacheEntry> entry = relations_cache_disk_read(key);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard lock(storage.mutex);
+  if (storage.entries.size() >= RELATIONS_CACHE_MEMORY_ENTRIES) {
+    storage.entries.remove(0);
+  }
+  storage.entries.append(entry);
+  return entry;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Restore and Store
+ * \{ */
+
+static bool relations_cache_entry_is_valid(const RelationsCacheEntry &entry,
+                                           const Depsgraph *graph)
+{
+  const int operations_num = graph->operations.size();
+  const int id_nodes_num = graph->id_nodes.size();
+  if (entry.operations_num != operations_num || entry.id_nodes_num != id_nodes_num ||
+      entry.id_node_states.size() != id_nodes_num)
+  {
+    return false;
+  }
+  const auto is_valid_operation = [&](const int index) {
+    return (index >= 0 && index < operations_num) ||
+           (index == TIME_SOURCE_INDEX && graph->time_source != nullptr);
+  };
+  for (const CachedRelation &relation : entry.relations) {
+    if (!is_valid_operation(relation.from) || relation.to < 0 || relation.to >= operations_num ||
+        relation.name < -1 || relation.name >= entry.names.size())
+    {
+      return false;
+    }
+  }
+  for (const CachedPhysicsRelations &physics : entry.physics_relations) {
+    if (physics.type < 0 || physics.type >= DEG_PHYSICS_RELATIONS_NUM ||
+        physics.collection < -1 || physics.collection >= id_nodes_num)
+    {
+      return false;
+    }
+    if (physics.collection != -1 && graph->id_nodes[physics.collection]->id_type != ID_GR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint physics_relation_modifier_type(const ePhysicsRelationType type)
+{
+  switch (type) {
+    case DEG_PHYSICS_COLLISION:
+      return eModifierType_Collision;
+    case DEG_PHYSICS_SMOKE_COLLISION:
+      return eModifierType_Fluid;
+    case DEG_PHYSICS_DYNAMIC_BRUSH:
+      return eModifierType_DynamicPaint;
+    case DEG_PHYSICS_EFFECTOR:
+    case DEG_PHYSICS_RELATIONS_NUM:
+      break;
+  }
+  BLI_assert_unreachable();
+  return eModifierType_None;
+}
+
+static void restore_physics_relations(Depsgraph *graph,
+                                      Collection *collection,
+                                      const ePhysicsRelationType type)
+{
+  if (type == DEG_PHYSICS_EFFECTOR) {
+    build_effector_relations(graph, collection);
+  }
+  else {
+    build_collision_relations(graph, collection, physics_relation_modifier_type(type));
+  }
+}
+
+bool deg_relations_cache_restore(Depsgraph *graph, const RelationsCacheKey &key)
+{
+  std::shared_ptr<const RelationsCacheEntry> entry = relations_cache_lookup(key);
+  if (entry == nullptr || !relations_cache_entry_is_valid(*entry, graph)) {
+    return false;
+  }
+
+  Array<const char *> names(entry->names.size());
+  {
+    RelationsCacheStorage &storage = relations_cache_storage_ensure();
+    std::lock_guard lock(storage.mutex);
+    for (const int i : names.index_range()) {
+      names[i] = relations_cache_name_intern(storage, entry->names[i]);
+    }
+  }
+
+  for (const CachedRelation &relation : entry->relations) {
+    Node *from = relation.from == TIME_SOURCE_INDEX ?
+                     static_cast<Node *>(graph->time_source) :
+                     static_cast<Node *>(graph->operations[relation.from]);
+    Node *to = graph->operations[relation.to];
+    graph->add_new_relation(from,
+                            to,
+                            relation.name == -1 ? nullptr : names[relation.name],
+                            relation.flag & ~RELATION_CHECK_BEFORE_ADD);
+  }
+
+  for (const int i : graph->id_nodes.index_range()) {
+    IDNode *id_node = graph->id_nodes[i];
+    id_node->eval_flags |= entry->id_node_states[i].eval_flags;
+    id_node->customdata_masks |= entry->id_node_states[i].customdata_masks;
+  }
+
+  for (const CachedPhysicsRelations &physics : entry->physics_relations) {
+    Collection *collection = physics.collection == -1 ?
+                                 nullptr :
+                                 reinterpret_cast<Collection *>(
+                                     graph->id_nodes[physics.collection]->id_orig);
+    restore_physics_relations(graph, collection, ePhysicsRelationType(physics.type));
+  }
+
+  return true;
+}
+
+/* Part of the ID nodes above which all relations are built again instead of partially. */
+static constexpr float RELATIONS_CACHE_UPDATE_MAX_DIRTY_FACTOR = 0.5f;
+
+/* Most recent entry of a previous build of the same view layer. */
+static std::shared_ptr<const RelationsCacheEntry> relations_cache_update_base_find(
+    const RelationsCacheKey &owner_key)
+{
+  RelationsCacheStorage &storage = relations_cache_storage_ensure();
+  std::lock_guard lock(storage.mutex);
+  for (int i = storage.entries.size() - 1; i >= 0; i--) {
+    const RelationsCacheEntry &entry = *storage.entries[i];
+    if (entry.owner_key == owner_key && !entry.operation_identities.is_empty()) {
+      return storage.entries[i];
+    }
+  }
+  return nullptr;
+}
+
+/* Index of the ID node of every operation of the graph. */
+static Array<int> operation_id_node_indices(const Depsgraph *graph)
+{
+  Map<const IDNode *, int> id_node_indices;
+  id_node_indices.reserve(graph->id_nodes.size());
+  for (const int i : graph->id_nodes.index_range()) {
+    id_node_indices.add_new(graph->id_nodes[i], i);
+  }
+  Array<int> indices(graph->operations.size());
+  for (const int i : graph->operations.index_range()) {
+    indices[i] = id_node_indices.lookup(graph->operations[i]->owner->owner);
+  }
+  return indices;
+}
+
+bool deg_relations_cache_update_begin(const Depsgraph *graph,
+                                      const RelationsCacheKeys &keys,
+                                      RelationsCacheUpdate &r_update)
+{
+  std::shared_ptr<const RelationsCacheEntry> base = relations_cache_update_base_find(keys.owner);
+  if (base == nullptr) {
+    return false;
+  }
+  const int id_nodes_num = graph->id_nodes.size();
+
+  Map<uint, int> id_node_indices;
+  id_node_indices.reserve(id_nodes_num);
+  for (const int i : IndexRange(id_nodes_num)) {
+    id_node_indices.add(graph->id_nodes[i]->id_orig->session_uid, i);
+  }
+  Array<int> base_id_node_indices(base->id_nodes_num);
+  for (const int i : base_id_node_indices.index_range()) {
+    base_id_node_indices[i] = id_node_indices.lookup_default(base->id_session_uids[i], -1);
+  }
+
+  /* IDs which are new or changed. */
+  Array<bool> is_dirty(id_nodes_num, true);
+  for (const int i : base_id_node_indices.index_range()) {
+    const int index = base_id_node_indices[i];
+    if (index != -1) {
+      is_dirty[index] = base->id_keys[i] != keys.ids[index];
+    }
+  }
+
+  /* The relations of IDs referencing changed IDs depend on them, directly or through the IDs in
+   * between (the objects of an instanced collection for example). */
+  Array<Vector<int>> referencing_id_nodes(id_nodes_num);
+  for (const int i : IndexRange(id_nodes_num)) {
+    for (const int reference : keys.id_references[i]) {
+      referencing_id_nodes[reference].append(i);
+    }
+  }
+  Vector<int> stack;
+  for (const int i : IndexRange(id_nodes_num)) {
+    if (is_dirty[i]) {
+      stack.append(i);
+    }
+  }
+  while (!stack.is_empty()) {
+    const int index = stack.pop_last();
+    for (const int referencing : referencing_id_nodes[index]) {
+      if (!is_dirty[referencing]) {
+        is_dirty[referencing] = true;
+        stack.append(referencing);
+      }
+    }
+  }
+
+  Map<CachedOperationIdentity, int> operation_indices;
+  operation_indices.reserve(graph->operations.size());
+  KeyHasher hasher;
+  for (const int i : graph->operations.index_range()) {
+    operation_indices.add(operation_identity(hasher, graph->operations[i]), i);
+  }
+  Array<int> base_operation_indices(base->operations_num);
+  for (const int i : base_operation_indices.index_range()) {
+    base_operation_indices[i] = operation_indices.lookup_default(base->operation_identities[i],
+                                                                 -1);
+  }
+
+  /* A relation which can not be restored, or which connects to a changed ID, might have been
+   * added while building either of the IDs it connects, so both are built again. */
+  const Array<int> operation_id_nodes = operation_id_node_indices(graph);
+  Array<bool> is_dirty_neighbor(id_nodes_num, false);
+  for (const CachedRelation &relation : base->relations) {
+    const bool from_time_source = relation.from == TIME_SOURCE_INDEX;
+    const int from = from_time_source ? -1 : base_operation_indices[relation.from];
+    const int to = base_operation_indices[relation.to];
+    const int from_id_node = from != -1 ? operation_id_nodes[from] : -1;
+    const int to_id_node = to != -1 ? operation_id_nodes[to] : -1;
+    const bool from_exists = from_time_source ? graph->time_source != nullptr : from != -1;
+    if (from_exists && to != -1 && (from_id_node == -1 || !is_dirty[from_id_node]) &&
+        !is_dirty[to_id_node])
+    {
+      continue;
+    }
+    if (from_id_node != -1) {
+      is_dirty_neighbor[from_id_node] = true;
+    }
+    if (to_id_node != -1) {
+      is_dirty_neighbor[to_id_node] = true;
+    }
+  }
+  int dirty_num = 0;
+  for (const int i : IndexRange(id_nodes_num)) {
+    is_dirty[i] = is_dirty[i] || is_dirty_neighbor[i];
+    dirty_num += int(is_dirty[i]);
+  }
+  if (dirty_num > int(id_nodes_num * RELATIONS_CACHE_UPDATE_MAX_DIRTY_FACTOR)) {
+    return false;
+  }
+
+  r_update.base = std::move(base);
+  r_update.id_node_is_dirty = std::move(is_dirty);
+  r_update.base_id_node_indices = std::move(base_id_node_indices);
+  r_update.base_operation_indices = std::move(base_operation_indices);
+  return true;
+}
+
+void deg_relations_cache_update_finish(Depsgraph *graph, const RelationsCacheUpdate &update)
+{
+  const RelationsCacheEntry &base = *update.base;
+  const Span<bool> is_dirty = update.id_node_is_dirty;
+
+  Array<const char *> names(base.names.size());
+  {
+    RelationsCacheStorage &storage = relations_cache_storage_ensure();
+    std::lock_guard lock(storage.mutex);
+    for (const int i : names.index_range()) {
+      names[i] = relations_cache_name_intern(storage, base.names[i]);
+    }
+  }
+
+  /* The relations between unchanged IDs. The builder adds some of them again while building the
+   * changed IDs, so existing relations are checked for. */
+  const Array<int> operation_id_nodes = operation_id_node_indices(graph);
+  for (const CachedRelation &relation : base.relations) {
+    const int to = update.base_operation_indices[relation.to];
+    if (to == -1 || is_dirty[operation_id_nodes[to]]) {
+      continue;
+    }
+    Node *from_node = nullptr;
+    if (relation.from == TIME_SOURCE_INDEX) {
+      from_node = graph->time_source;
+    }
+    else {
+      const int from = update.base_operation_indices[relation.from];
+      if (from == -1 || is_dirty[operation_id_nodes[from]]) {
+        continue;
+      }
+      from_node = graph->operations[from];
+    }
+    if (from_node == nullptr) {
+      continue;
+    }
+    graph->add_new_relation(from_node,
+                            graph->operations[to],
+                            relation.name == -1 ? nullptr : names[relation.name],
+                            relation.flag | RELATION_CHECK_BEFORE_ADD);
+  }
+
+  for (const int i : update.base_id_node_indices.index_range()) {
+    const int index = update.base_id_node_indices[i];
+    if (index == -1 || is_dirty[index]) {
+      continue;
+    }
+    IDNode *id_node = graph->id_nodes[index];
+    id_node->eval_flags |= base.id_node_states[i].eval_flags;
+    id_node->customdata_masks |= base.id_node_states[i].customdata_masks;
+  }
+
+  /* These are computed from the current data, so they are all restored. */
+  for (const CachedPhysicsRelations &physics : base.physics_relations) {
+    Collection *collection = nullptr;
+    if (physics.collection != -1) {
+      const int index = update.base_id_node_indices[physics.collection];
+      if (index == -1) {
+        continue;
+      }
+      collection = reinterpret_cast<Collection *>(graph->id_nodes[index]->id_orig);
+    }
+    restore_physics_relations(graph, collection, ePhysicsRelationType(physics.type));
+  }
+}
+
+void deg_relations_cache_store(const Depsgraph *graph,
+                               const RelationsCacheKeys &keys,
+                               const double build_time)
+{
+  const RelationsCacheKey &key = keys.graph;
+  std::shared_ptr<RelationsCacheEntry> entry = std::make_shared<RelationsCacheEntry>();
+  entry->key = key;
+  entry->operations_num = graph->operations.size();
+  entry->id_nodes_num = graph->id_nodes.size();
+
+  Map<const Node *, int> operation_indices;
+  operation_indices.reserve(graph->operations.size() + 1);
+  for (const int i : graph->operations.index_range()) {
+    operation_indices.add_new(graph->operations[i], i);
+  }
+  int64_t outlinks_num = 0;
+  if (graph->time_source != nullptr) {
+    operation_indices.add_new(graph->time_source, TIME_SOURCE_INDEX);
+    outlinks_num += graph->time_source->outlinks.size();
+  }
+
+  Map<StringRef, int> name_indices;
+  for (const int i : graph->operations.index_range()) {
+    const OperationNode *op_node = graph->operations[i];
+    outlinks_num += op_node->outlinks.size();
+    for (const Relation *rel : op_node->inlinks) {
+      const int *from = operation_indices.lookup_ptr(rel->from);
+      if (from == nullptr) {
+        /* Relations between nodes which can not be identified are not supported. */
+        return;
+      }
+      int name = -1;
+      if (rel->name != nullptr) {
+        name = name_indices.lookup_or_add_cb(rel->name, [&]() {
+          entry->names.append(rel->name);
+          return int(entry->names.size() - 1);
+        });
+      }
+      entry->relations.append({*from, i, rel->flag, name});
+    }
+  }
+  if (outlinks_num != entry->relations.size()) {
+    /* Some relations do not end in an operation, so they would be lost. */
+    return;
+  }
+
+  Map<const IDNode *, int> id_node_indices;
+  id_node_indices.reserve(graph->id_nodes.size());
+  for (const int i : graph->id_nodes.index_range()) {
+    const IDNode *id_node = graph->id_nodes[i];
+    id_node_indices.add_new(id_node, i);
+    entry->id_node_states.append({id_node->eval_flags, id_node->customdata_masks});
+  }
+
+  for (const int type : IndexRange(DEG_PHYSICS_RELATIONS_NUM)) {
+    const Map<const ID *, ListBase *> *relations = graph->physics_relations[type];
+    if (relations == nullptr) {
+      continue;
+    }
+    for (const ID *collection : relations->keys()) {
+      int collection_index = -1;
+      if (collection != nullptr) {
+        const IDNode *id_node = graph->find_id_node(collection);
+        if (id_node == nullptr) {
+          return;
+        }
+        collection_index = id_node_indices.lookup(id_node);
+      }
+      entry->physics_relations.append({type, collection_index});
+    }
+  }
+
+  if (build_time >= RELATIONS_CACHE_DISK_MIN_BUILD_TIME) {
+    relations_cache_disk_write(*entry);
+  }
+
+  entry->owner_key = keys.owner;
+  entry->id_keys.extend(keys.ids.as_span());
+  entry->id_session_uids.reserve(graph->id_nodes.size());
+  for (const IDNode *id_node : graph->id_nodes) {
+    entry->id_session_uids.append(id_node->id_orig->session_uid);
+  }
+  entry->operation_identities.reserve(graph->operations.size());
+  KeyHasher hasher;
+  for (const OperationNode *op_node : graph->operations) {
+    entry->operation_identities.append(operation_identity(hasher, op_node));
+  }
+
+  RelationsCacheStorage &storage = relations_cache_storage_ensure();
+  std::lock_guard lock(storage.mutex);
+  storage.entries.remove_if(
+      [&](const std::shared_ptr<const RelationsCacheEntry> &other) { return other->key == key; });
+  if (storage.entries.size() >= RELATIONS_CACHE_MEMORY_ENTRIES) {
+    storage.entries.remove(0);
+  }
+  storage.entries.append(std::move(entry));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Validation
+ * \{ */
+
+static std::string relation_node_describe(const Node *node)
+{
+  if (node->get_class() != NodeClass::OPERATION) {
+    return node->identifier();
+  }
+  const OperationNode *op_node = static_cast<const OperationNode *>(node);
+  const ComponentNode *comp_node = op_node->owner;
+  return comp_node->owner->name + "/" + nodeTypeAsString(comp_node->type) + "(" +
+         comp_node->name + ")/" + op_node->identifier() + "#" + std::to_string(op_node->name_tag);
+}
+
+Vector<std::string> deg_relations_cache_describe(const Depsgraph *graph)
+{
+  Vector<std::string> lines;
+  for (const OperationNode *op_node : graph->operations) {
+    for (const Relation *rel : op_node->inlinks) {
+      lines.append(relation_node_describe(rel->from) + " -> " + relation_node_describe(op_node) +
+                   " (" + (rel->name ? rel->name : "") + ", " +
+                   std::to_string(rel->flag & ~RELATION_CHECK_BEFORE_ADD) + ")");
+    }
+  }
+  for (const IDNode *id_node : graph->id_nodes) {
+    lines.append(id_node->name + ": eval flags " + std::to_string(id_node->eval_flags) +
+                 ", vertex mask " + std::to_string(id_node->customdata_masks.vert_mask) +
+                 ", edge mask " + std::to_string(id_node->customdata_masks.edge_mask) +
+                 ", face mask " + std::to_string(id_node->customdata_masks.face_mask) +
+                 ", loop mask " + std::to_string(id_node->customdata_masks.loop_mask) +
+                 ", poly mask " + std::to_string(id_node->customdata_masks.poly_mask));
+  }
+  for (const int type : IndexRange(DEG_PHYSICS_RELATIONS_NUM)) {
+    const Map<const ID *, ListBase *> *relations = graph->physics_relations[type];
+    if (relations == nullptr) {
+      continue;
+    }
+    for (const ID *collection : relations->keys()) {
+      lines.append("Physics " + std::to_string(type) + ": " +
+                   (collection ? collection->name : "Scene"));
+    }
+  }
+  std::sort(lines.begin(), lines.end());
+  /* Duplicate relations are only added once when relations are restored partially. */
+  lines.resize(std::unique(lines.begin(), lines.end()) - lines.begin());
+  return lines;
+}
+
+void deg_relations_cache_relations_clear(Depsgraph *graph)
+{
+  const auto free_inlinks = [](Node *node) {
+    while (!node->inlinks.is_empty()) {
+      Relation *rel = node->inlinks.last();
+      rel->unlink();
+      delete rel;
+    }
+  };
+  for (OperationNode *op_node : graph->operations) {
+    free_inlinks(op_node);
+  }
+  if (graph->time_source != nullptr) {
+    free_inlinks(graph->time_source);
+  }
+  clear_physics_relations(graph);
+}
+
+/** \} */
+
+}  // namespace blender::deg
@@ -0,0 +1,123 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Cache of built relations, which allows to skip the relations builder when the graph is rebuilt
+ * for the same structure: after a file is re-loaded, or when relations are tagged for update
+ * without actual change to the relations.
+ *
+ * Entries are keyed by a structural hash of the graph nodes and of the original data the
+ * relations are built from: ID references, an explicit list of DNA settings of the data-blocks
+ * and their modifiers, constraints and nodes, and animation and driver RNA paths. Entries are
+ * kept in memory, and the ones which took long to build are also stored on disk in
+ * #BKE_appdir_folder_caches.
+ *
+ * When there is no entry for the graph, the relations of the IDs which did not change since the
+ * last build of the same view layer are restored from its entry, and only the relations of the
+ * changed IDs and of the IDs depending on them are built.
+ *
+ * The list of DNA settings is maintained by hand, so settings read by the relations builder might
+ * be missing from it. With the debug value 798, all relations are built again after they are
+ * restored, and the differences are reported.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "BLI_array.hh"
+#include "BLI_vector.hh"
+
+namespace blender::deg {
+
+struct Depsgraph;
+struct RelationsCacheEntry;
+
+struct RelationsCacheKey {
+  uint64_t low = 0;
+  uint64_t high = 0;
+
+  uint64_t hash() const
+  {
+    return low;
+  }
+
+  friend bool operator==(const RelationsCacheKey &a, const RelationsCacheKey &b)
+  {
+    return a.low == b.low && a.high == b.high;
+  }
+};
+
+struct RelationsCacheKeys {
+  /* Key of the relations of the whole graph. */
+  RelationsCacheKey graph;
+  /* Key of the scene, view layer and mode of the graph, shared by all its builds. */
+  RelationsCacheKey owner;
+  /* Key of the original data of every ID node, in the order of Depsgraph::id_nodes. */
+  Array<RelationsCacheKey> ids;
+  /* Indices of the ID nodes referenced by the original data of every ID node. */
+  Array<Vector<int>> id_references;
+};
+
+/* Relations of a previous build of the same view layer which are reused by a partial build. */
+struct RelationsCacheUpdate {
+  std::shared_ptr<const RelationsCacheEntry> base;
+  /* Whether the relations of every ID node are to be built again. */
+  Array<bool> id_node_is_dirty;
+  /* Index of the ID nodes of the base build in the graph, or -1 for removed ones. */
+  Array<int> base_id_node_indices;
+  /* Index of the operations of the base build in the graph, or -1 for removed ones. */
+  Array<int> base_operation_indices;
+};
+
+/* Whether the relations cache is enabled in the preferences. */
+bool deg_relations_cache_is_enabled();
+
+/* Compute the keys of the relations of the graph. All nodes are to be built at this point. */
+RelationsCacheKeys deg_relations_cache_keys(const Depsgraph *graph);
+
+/* Add the cached relations of the key to the graph, together with the evaluation flags and the
+ * physics relations created by the relations builder.
+ *
+ * Returns false if there is no valid cache entry for the key, in which case the graph is not
+ * modified. */
+bool deg_relations_cache_restore(Depsgraph *graph, const RelationsCacheKey &key);
+
+/* Find which ID nodes need their relations to be built again, compared to the last build of the
+ * same view layer. The relations of all other ID nodes are added by
+ * #deg_relations_cache_update_finish once the relations builder skipped them.
+ *
+ * Returns false if there is no previous build to compare to, or if too many IDs changed for a
+ * partial build to be worth it. */
+bool deg_relations_cache_update_begin(const Depsgraph *graph,
+                                      const RelationsCacheKeys &keys,
+                                      RelationsCacheUpdate &r_update);
+
+/* Add the relations of the ID nodes which were not built again, see
+ * #deg_relations_cache_update_begin. */
+void deg_relations_cache_update_finish(Depsgraph *graph, const RelationsCacheUpdate &update);
+
+/* Store the relations of the graph under the given keys. Is to be called after the relations are
+ * built and before the graph is finalized. The build time is used to decide whether the entry is
+ * worth to be written to disk. */
+void deg_relations_cache_store(const Depsgraph *graph,
+                               const RelationsCacheKeys &keys,
+                               double build_time);
+
+/* Sorted description of the relations of the graph, of the evaluation flags of its ID nodes and
+ * of its physics relations, without duplicates. Operations are identified by their names, so that
+ * graphs built in different ways can be compared. */
+Vector<std::string> deg_relations_cache_describe(const Depsgraph *graph);
+
+/* Remove all relations and physics relations of the graph, so that they can be built again. */
+void deg_relations_cache_relations_clear(Depsgraph *graph);
+
+/* Free all in-memory entries. */
+void deg_relations_cache_clear();
+
+}  // namespace blender::deg
@@ -0,0 +1,163 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/builder/deg_builder_relations_cache.h"
+
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_constraint_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_string.h"
+
+#include "BKE_collection.hh"
+#include "BKE_constraint.h"
+#include "BKE_idtype.hh"
+#include "BKE_layer.hh"
+#include "BKE_main.hh"
+#include "BKE_object.hh"
+#include "BKE_scene.hh"
+
+#include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_build.hh"
+
+#include "intern/depsgraph.hh"
+
+namespace blender::deg::tests {
+
+/**
+ * A scene with a few independent objects. The relations built with the relations cache, either
+ * restored entirely or partially rebuilt after a change, are compared to the ones of a full build.
+ */
+class DepsgraphRelationsCacheTest : public testing::Test {
+ public:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Vector<Object *> objects;
+  char use_relations_cache_prev = 0;
+
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    BKE_idtype_init();
+    DEG_register_node_types();
+  }
+
+  static void TearDownTestSuite()
+  {
+    DEG_free_node_types();
+    CLG_exit();
+  }
+
+  void SetUp() override
+  {
+    use_relations_cache_prev = U.experimental.use_depsgraph_relations_cache;
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    for (const int i : IndexRange(16)) {
+      char name[MAX_ID_NAME];
+      SNPRINTF(name, "Empty%d", i);
+      objects.append(add_object(name));
+    }
+    /* A few relations between the objects. */
+    objects[1]->parent = objects[0];
+    add_track_to_constraint(objects[2], objects[3]);
+  }
+
+  void TearDown() override
+  {
+    BKE_main_free(bmain);
+    deg_relations_cache_clear();
+    U.experimental.use_depsgraph_relations_cache = use_relations_cache_prev;
+  }
+
+  Object *add_object(const char *name)
+  {
+    Object *object = BKE_object_add_only_object(bmain, OB_EMPTY, name);
+    BKE_collection_object_add(bmain, scene->master_collection, object);
+    return object;
+  }
+
+  static void add_track_to_constraint(Object *object, Object *target)
+  {
+    bConstraint *con = BKE_constraint_add_for_object(object, "Track To", CONSTRAINT_TYPE_TRACKTO);
+    static_cast<bTrackToConstraint *>(con->data)->tar = target;
+  }
+
+  /** Description of the relations of a new graph of the scene. */
+  Vector<std::string> build_relations(const bool use_relations_cache)
+  {
+    U.experimental.use_depsgraph_relations_cache = use_relations_cache;
+    ::Depsgraph *depsgraph = DEG_graph_new(
+        bmain, scene, BKE_view_layer_default_view(scene), DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph);
+    Vector<std::string> description = deg_relations_cache_describe(
+        reinterpret_cast<const Depsgraph *>(depsgraph));
+    DEG_graph_free(depsgraph);
+    return description;
+  }
+
+  /**
+   * The relations of a build using the relations cache match the ones of a full build. The
+   * cache is to be filled by a previous build.
+   */
+  void expect_cached_build_matches()
+  {
+    const Vector<std::string> expected = build_relations(false);
+    EXPECT_FALSE(expected.is_empty());
+    EXPECT_EQ(build_relations(true), expected);
+  }
+};
+
+TEST_F(DepsgraphRelationsCacheTest, Restored)
+{
+  const Vector<std::string> expected = build_relations(false);
+  /* The first build stores the entry, the second one restores it. */
+  EXPECT_EQ(build_relations(true), expected);
+  EXPECT_EQ(build_relations(true), expected);
+}
+
+TEST_F(DepsgraphRelationsCacheTest, PartialParentChanged)
+{
+  build_relations(true);
+  objects[5]->parent = objects[4];
+  expect_cached_build_matches();
+  objects[1]->parent = nullptr;
+  expect_cached_build_matches();
+}
+
+TEST_F(DepsgraphRelationsCacheTest, PartialConstraintChanged)
+{
+  build_relations(true);
+  add_track_to_constraint(objects[6], objects[7]);
+  expect_cached_build_matches();
+  /* Relations of the object referencing a changed target are built again. */
+  objects[3]->parent = objects[8];
+  expect_cached_build_matches();
+  bConstraint *con = static_cast<bConstraint *>(objects[2]->constraints.first);
+  con->flag |= CONSTRAINT_OFF;
+  expect_cached_build_matches();
+}
+
+TEST_F(DepsgraphRelationsCacheTest, PartialObjectAddedAndRemoved)
+{
+  build_relations(true);
+  Object *object = add_object("EmptyAdded");
+  object->parent = objects[9];
+  expect_cached_build_matches();
+  BKE_collection_object_remove(bmain, scene->master_collection, objects[1], false);
+  expect_cached_build_matches();
+}
+
+}  // namespace blender::deg::tests
@@ -4,6 +4,8 @@
 
 #include "pipeline.h"
 
+#include <algorithm>
+
 #include "BLI_listbase.h"
 #include "BLI_time.h"
 
@@ -14,10 +16,15 @@
 #include "deg_builder_cycle.h"
 #include "deg_builder_nodes.h"
 #include "deg_builder_relations.h"
+#include "deg_builder_relations_cache.h"
 #include "deg_builder_transitive.h"
 
 namespace blender::deg {
 
+/* Debug value which builds all relations after they are restored from the relations cache, to
+ * report the differences. */
+static constexpr int RELATIONS_CACHE_VALIDATE_DEBUG_VALUE = 798;
+
 AbstractBuilderPipeline::AbstractBuilderPipeline(::Depsgraph *graph)
     : deg_graph_(reinterpret_cast<Depsgraph *>(graph)),
       bmain_(deg_graph_->bmain),
@@ -59,14 +66,97 @@ void AbstractBuilderPipeline::build_step_nodes()
   node_builder->end_build();
 }
 
+bool AbstractBuilderPipeline::use_relations_cache() const
+{
+  return false;
+}
+
 void AbstractBuilderPipeline::build_step_relations()
 {
+  const bool use_cache = use_relations_cache() && deg_relations_cache_is_enabled();
+  RelationsCacheKeys cache_keys;
+  if (use_cache) {
+    cache_keys = deg_relations_cache_keys(deg_graph_);
+    if (deg_relations_cache_restore(deg_graph_, cache_keys.graph)) {
+      if (G.debug & G_DEBUG_DEPSGRAPH_BUILD) {
+        printf("Depsgraph relations restored from cache.\n");
+      }
+      if (G.debug_value == RELATIONS_CACHE_VALIDATE_DEBUG_VALUE) {
+        build_step_relations_validate_cache();
+      }
+      return;
+    }
+  }
+  const double start_time = BLI_time_now_seconds();
+
   /* Hook up relationships between operations - to determine evaluation order. */
   std::unique_ptr<DepsgraphRelationBuilder> relation_builder = construct_relation_builder();
   relation_builder->begin_build();
-  build_relations(*relation_builder);
-  relation_builder->build_copy_on_write_relations();
-  relation_builder->build_driver_relations();
+
+  RelationsCacheUpdate cache_update;
+  if (use_cache && deg_relations_cache_update_begin(deg_graph_, cache_keys, cache_update)) {
+    /* Only build the relations of the changed IDs, the other ones come from the last build. */
+    for (const int i : deg_graph_->id_nodes.index_range()) {
+      if (!cache_update.id_node_is_dirty[i]) {
+        relation_builder->tag_id_built(deg_graph_->id_nodes[i]->id_orig);
+      }
+    }
+    build_relations(*relation_builder);
+    for (const int i : deg_graph_->id_nodes.index_range()) {
+      if (cache_update.id_node_is_dirty[i]) {
+        relation_builder->build_copy_on_write_relations(deg_graph_->id_nodes[i]);
+        relation_builder->build_driver_relations(deg_graph_->id_nodes[i]);
+      }
+    }
+    deg_relations_cache_update_finish(deg_graph_, cache_update);
+    if (G.debug & G_DEBUG_DEPSGRAPH_BUILD) {
+      printf("Depsgraph relations partially restored from cache.\n");
+    }
+    if (G.debug_value == RELATIONS_CACHE_VALIDATE_DEBUG_VALUE) {
+      build_step_relations_validate_cache();
+    }
+  }
+  else {
+    build_step_relations_all(*relation_builder);
+  }
+
+  if (use_cache) {
+    deg_relations_cache_store(deg_graph_, cache_keys, BLI_time_now_seconds() - start_time);
+  }
+}
+
+void AbstractBuilderPipeline::build_step_relations_all(DepsgraphRelationBuilder &relation_builder)
+{
+  build_relations(relation_builder);
+  relation_builder.build_copy_on_write_relations();
+  relation_builder.build_driver_relations();
+}
+
+/* Build all relations again, and report the differences with the ones restored from the relations
+ * cache. These are caused by settings which the relations builder reads but which are missing from
+ * the cache keys. The built relations are kept. */
+void AbstractBuilderPipeline::build_step_relations_validate_cache()
+{
+  const Vector<std::string> restored = deg_relations_cache_describe(deg_graph_);
+  deg_relations_cache_relations_clear(deg_graph_);
+  std::unique_ptr<DepsgraphRelationBuilder> relation_builder = construct_relation_builder();
+  relation_builder->begin_build();
+  build_step_relations_all(*relation_builder);
+  const Vector<std::string> built = deg_relations_cache_describe(deg_graph_);
+  if (restored == built) {
+    return;
+  }
+  printf("Depsgraph relations restored from cache differ from the built ones:\n");
+  for (const std::string &line : restored) {
+    if (!std::binary_search(built.begin(), built.end(), line)) {
+      printf("  - %s\n", line.c_str());
+    }
+  }
+  for (const std::string &line : built) {
+    if (!std::binary_search(restored.begin(), restored.end(), line)) {
+      printf("  + %s\n", line.c_str());
+    }
+  }
 }
 
 void AbstractBuilderPipeline::build_step_finalize()
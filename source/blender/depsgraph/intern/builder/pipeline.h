@@ -46,9 +46,15 @@ class AbstractBuilderPipeline {
   virtual std::unique_ptr<DepsgraphNodeBuilder> construct_node_builder();
   virtual std::unique_ptr<DepsgraphRelationBuilder> construct_relation_builder();
 
+  /* Whether relations can be restored from the relations cache, see
+   * deg_builder_relations_cache.h. */
+  virtual bool use_relations_cache() const;
+
   virtual void build_step_sanity_check();
   void build_step_nodes();
   void build_step_relations();
+  void build_step_relations_all(DepsgraphRelationBuilder &relation_builder);
+  void build_step_relations_validate_cache();
   void build_step_finalize();
 
   virtual void build_nodes(DepsgraphNodeBuilder &node_builder) = 0;
@@ -17,6 +17,7 @@ class ViewLayerBuilderPipeline : public AbstractBuilderPipeline {
   ViewLayerBuilderPipeline(::Depsgraph *graph);
 
  protected:
+  bool use_relations_cache() const override;
   void build_nodes(DepsgraphNodeBuilder &node_builder) override;
   void build_relations(DepsgraphRelationBuilder &relation_builder) override;
 };
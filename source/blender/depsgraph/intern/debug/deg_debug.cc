@@ -11,6 +11,7 @@
 #include "BLI_console.h"
 #include "BLI_hash.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_time.h"
 
 #include "BKE_global.hh"
@@ -43,15 +44,38 @@ void DepsgraphDebug::end_graph_evaluation()
 
   const double graph_eval_end_time = BLI_time_now_seconds();
   const double graph_eval_time = graph_eval_end_time - graph_evaluation_start_time_;
+  graph_evaluation_time_ = graph_eval_time;
 
   if (name.empty()) {
-    printf("Depsgraph updated in %f seconds.\n", graph_eval_time);
+    printf(
+        "Depsgraph updated in %f seconds (%.1f%% thread utilization, %f seconds copying "
+        "data-blocks).\n",
+        graph_eval_time,
+        thread_utilization() * 100.0f,
+        copy_time);
   }
   else {
-    printf("Depsgraph [%s] updated in %f seconds.\n", name.c_str(), graph_eval_time);
+    printf(
+        "Depsgraph [%s] updated in %f seconds (%.1f%% thread utilization, %f seconds copying "
+        "data-blocks).\n",
+        name.c_str(),
+        graph_eval_time,
+        thread_utilization() * 100.0f,
+        copy_time);
   }
 }
 
+float DepsgraphDebug::thread_utilization() const
+{
+  if (graph_evaluation_time_ <= 0.0) {
+    return 0.0f;
+  }
+  const int threads_num = (G.debug & G_DEBUG_DEPSGRAPH_NO_THREADS) ?
+                              1 :
+                              BLI_task_scheduler_num_threads();
+  return float(operations_time / (graph_evaluation_time_ * threads_num));
+}
+
 bool terminal_do_color()
 {
   return (G.debug & G_DEBUG_DEPSGRAPH_PRETTY) != 0;
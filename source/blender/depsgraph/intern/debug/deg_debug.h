@@ -23,6 +23,10 @@ class DepsgraphDebug {
   void begin_graph_evaluation();
   void end_graph_evaluation();
 
+  /* Fraction of the time of all threads during the last graph evaluation which was spent on
+   * evaluating operations. Only measured when time debug is enabled. */
+  float thread_utilization() const;
+
   /* NOTE: Corresponds to G_DEBUG_DEPSGRAPH_* flags. */
   int flags;
 
@@ -30,6 +34,14 @@ class DepsgraphDebug {
    * created for different view layer). */
   std::string name;
 
+  /* Time spent on evaluating operations during the last graph evaluation, summed over all
+   * threads. Is filled in by the evaluation statistics. */
+  double operations_time = 0.0;
+
+  /* Time spent on updating evaluated copies of data-blocks during the last graph evaluation,
+   * summed over all threads. Is filled in by the evaluation statistics. */
+  double copy_time = 0.0;
+
  protected:
   /* Maximum number of counters used to calculate frame rate of depsgraph update. */
   static const constexpr int MAX_FPS_COUNTERS = 64;
@@ -38,6 +50,9 @@ class DepsgraphDebug {
    * Is initialized from begin_graph_evaluation() when time debug is enabled.
    */
   double graph_evaluation_start_time_;
+
+  /* Wall time of the last graph evaluation. */
+  double graph_evaluation_time_ = 0.0;
 };
 
 #define DEG_DEBUG_PRINTF(depsgraph, type, ...) \
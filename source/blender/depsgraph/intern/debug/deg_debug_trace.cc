@@ -0,0 +1,430 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "BLI_map.hh"
+#include "BLI_utildefines.h"
+#include "BLI_vector.hh"
+
+#include "DEG_depsgraph_debug.hh"
+
+namespace blender::deg::trace {
+
+/* -------------------------------------------------------------------- */
+/** \name Recording
+ * \{ */
+
+/* Number of events kept per thread. The oldest events are overwritten once it is reached. */
+static constexpr int64_t EVENTS_PER_THREAD = 1 << 14;
+static constexpr int EVENT_NAME_MAX = 64;
+/* Event identifiers are unique per thread, the thread is stored in the upper bits. */
+static constexpr int EVENT_ID_THREAD_SHIFT = 40;
+
+struct Event {
+  const char *category;
+  const char *label;
+  char name[EVENT_NAME_MAX];
+  uint64_t start;
+  uint64_t end;
+  uint64_t id;
+  uint64_t parent_id;
+};
+
+/**
+ * Storage of an event in a #ThreadBuffer. It may be read while its thread overwrites it, so it's
+ * only accessed through (relaxed) atomic words, torn reads are detected by #snapshot_events.
+ */
+struct EventSlot {
+  static constexpr int WORDS_NUM = sizeof(Event) / sizeof(uint64_t);
+  std::atomic<uint64_t> words[WORDS_NUM];
+};
+static_assert(sizeof(Event) % sizeof(uint64_t) == 0);
+
+static void event_slot_store(EventSlot &slot, const Event &event)
+{
+  uint64_t words[EventSlot::WORDS_NUM];
+  memcpy(words, &event, sizeof(Event));
+  for (int i = 0; i < EventSlot::WORDS_NUM; i++) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+}
+
+static Event event_slot_load(const EventSlot &slot)
+{
+  uint64_t words[EventSlot::WORDS_NUM];
+  for (int i = 0; i < EventSlot::WORDS_NUM; i++) {
+    words[i] = slot.words[i].load(std::memory_order_relaxed);
+  }
+  Event event;
+  memcpy(&event, words, sizeof(Event));
+  return event;
+}
+
+/**
+ * Ring buffer of the events recorded by one thread. The counters are only written by the thread
+ * which owns the buffer, other threads only read them to take a snapshot of the events, see
+ * #snapshot_events.
+ */
+struct ThreadBuffer {
+  int thread_index;
+  std::unique_ptr<EventSlot[]> events;
+  /* Number of events of which recording started. Is incremented before an event overwrites the
+   * oldest one, like the sequence number of a sequence lock. */
+  std::atomic<uint64_t> events_started = 0;
+  /* Total number of events recorded by the thread, only the latest #EVENTS_PER_THREAD of them are
+   * stored. */
+  std::atomic<uint64_t> events_num = 0;
+  /* Events recorded before #clear are not exported. Is written by the clearing thread. */
+  std::atomic<uint64_t> events_cleared = 0;
+  uint64_t last_id = 0;
+};
+
+struct TraceState {
+  std::atomic<bool> enabled = false;
+  std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  std::mutex buffers_mutex;
+  /* Buffers of all threads which ever recorded an event. The buffer of a thread which exited is
+   * kept so that its events are exported, and is reused by the next thread which records. So the
+   * number of buffers is the largest number of threads which recorded at the same time. */
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<ThreadBuffer *> free_buffers;
+  std::string exit_filepath;
+};
+
+static TraceState &get_state()
+{
+  /* Never freed, threads may still exit and return their buffer after static destructors ran. */
+  static TraceState &state = *new TraceState();
+  return state;
+}
+
+/* Returns the buffer of a thread to the free list when the thread exits. */
+struct ThreadBufferUser {
+  ThreadBuffer *buffer = nullptr;
+
+  ~ThreadBufferUser()
+  {
+    if (buffer == nullptr) {
+      return;
+    }
+    TraceState &state = get_state();
+    std::scoped_lock lock(state.buffers_mutex);
+    state.free_buffers.push_back(buffer);
+  }
+};
+
+static ThreadBuffer &thread_buffer_get()
+{
+  thread_local ThreadBufferUser user;
+  if (user.buffer == nullptr) {
+    TraceState &state = get_state();
+    std::scoped_lock lock(state.buffers_mutex);
+    if (!state.free_buffers.empty()) {
+      user.buffer = state.free_buffers.back();
+      state.free_buffers.pop_back();
+    }
+    else {
+      std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+      buffer->thread_index = int(state.buffers.size());
+      buffer->events = std::make_unique<EventSlot[]>(EVENTS_PER_THREAD);
+      user.buffer = buffer.get();
+      state.buffers.push_back(std::move(buffer));
+    }
+  }
+  return *user.buffer;
+}
+
+bool is_enabled()
+{
+  return get_state().enabled.load(std::memory_order_relaxed);
+}
+
+void set_enabled(const bool enabled)
+{
+  get_state().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t now()
+{
+  const std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() -
+                                                       get_state().epoch;
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+uint64_t record(const char *category,
+                const char *label,
+                const StringRef name,
+                const StringRef subname,
+                const uint64_t start,
+                const uint64_t end,
+                const uint64_t parent_id)
+{
+  ThreadBuffer &buffer = thread_buffer_get();
+  const uint64_t events_num = buffer.events_num.load(std::memory_order_relaxed);
+  /* Announce that the oldest event is overwritten before changing it. */
+  buffer.events_started.store(events_num + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  Event event = {};
+  event.category = category;
+  event.label = label;
+  int name_len = std::min<int>(name.size(), EVENT_NAME_MAX - 1);
+  memcpy(event.name, name.data(), name_len);
+  if (!subname.is_empty() && name_len < EVENT_NAME_MAX - 2) {
+    event.name[name_len++] = '/';
+    const int subname_len = std::min<int>(subname.size(), EVENT_NAME_MAX - 1 - name_len);
+    memcpy(event.name + name_len, subname.data(), subname_len);
+    name_len += subname_len;
+  }
+  event.name[name_len] = '\0';
+  event.start = start;
+  event.end = end;
+  event.id = (uint64_t(buffer.thread_index + 1) << EVENT_ID_THREAD_SHIFT) | ++buffer.last_id;
+  event.parent_id = parent_id;
+  event_slot_store(buffer.events[events_num % EVENTS_PER_THREAD], event);
+
+  buffer.events_num.store(events_num + 1, std::memory_order_release);
+  return event.id;
+}
+
+void clear()
+{
+  TraceState &state = get_state();
+  std::scoped_lock lock(state.buffers_mutex);
+  for (std::unique_ptr<ThreadBuffer> &buffer : state.buffers) {
+    buffer->events_cleared.store(buffer->events_num.load(std::memory_order_acquire),
+                                 std::memory_order_relaxed);
+  }
+}
+
+struct EventSnapshot {
+  Event event;
+  int thread_index;
+};
+
+/**
+ * Copy the events of a buffer while its thread may still be recording. Events which were
+ * overwritten during the copy are detected afterwards with #ThreadBuffer::events_started and
+ * skipped, so neither the recording nor the snapshot has to wait.
+ */
+static void snapshot_events(const ThreadBuffer &buffer, Vector<EventSnapshot> &r_events)
+{
+  const uint64_t events_num = buffer.events_num.load(std::memory_order_acquire);
+  const uint64_t events_cleared = buffer.events_cleared.load(std::memory_order_relaxed);
+  const uint64_t first = std::max(
+      events_cleared, events_num > EVENTS_PER_THREAD ? events_num - EVENTS_PER_THREAD : 0);
+  if (first >= events_num) {
+    return;
+  }
+
+  Vector<EventSnapshot> events;
+  events.reserve(events_num - first);
+  for (uint64_t i = first; i < events_num; i++) {
+    events.append({event_slot_load(buffer.events[i % EVENTS_PER_THREAD]), buffer.thread_index});
+  }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t events_started = buffer.events_started.load(std::memory_order_relaxed);
+  const uint64_t valid_first = std::clamp(
+      events_started > EVENTS_PER_THREAD ? events_started - EVENTS_PER_THREAD : 0,
+      first,
+      events_num);
+  r_events.extend(events.as_span().drop_front(int64_t(valid_first - first)));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Chrome Trace Export
+ * \{ */
+
+static std::string json_escape(const StringRefNull str)
+{
+  std::string result;
+  result.reserve(str.size());
+  for (const char c : str) {
+    if (ELEM(c, '"', '\\')) {
+      result += '\\';
+      result += c;
+    }
+    else if (uchar(c) < 0x20) {
+      result += fmt::format("\\u{:04x}", int(c));
+    }
+    else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+static double to_microseconds(const uint64_t nanoseconds)
+{
+  return double(nanoseconds) / 1000.0;
+}
+
+bool export_chrome_trace(const char *filepath)
+{
+  TraceState &state = get_state();
+  std::scoped_lock lock(state.buffers_mutex);
+
+  Vector<EventSnapshot> events;
+  for (const std::unique_ptr<ThreadBuffer> &buffer : state.buffers) {
+    snapshot_events(*buffer, events);
+  }
+  Map<uint64_t, const EventSnapshot *> event_by_id;
+  event_by_id.reserve(events.size());
+  for (const EventSnapshot &snapshot : events) {
+    event_by_id.add(snapshot.event.id, &snapshot);
+  }
+
+  std::ofstream file(filepath, std::ios::out | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  file << R"({"displayTimeUnit":"ms","traceEvents":[)";
+  file << R"({"name":"process_name","ph":"M","pid":1,"args":{"name":"Dependency Graph"}})";
+  for (const std::unique_ptr<ThreadBuffer> &buffer : state.buffers) {
+    file << fmt::format(
+        ",\n"
+        R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"Thread {}"}}}})",
+        buffer->thread_index,
+        buffer->thread_index);
+  }
+
+  for (const EventSnapshot &snapshot : events) {
+    const Event &event = snapshot.event;
+    const std::string name = json_escape(event.name);
+    /* Labels are ID names, which may contain any character. */
+    const std::string full_name = event.label[0] ?
+                                      fmt::format("{}: {}", name, json_escape(event.label)) :
+                                      name;
+    file << fmt::format(
+        ",\n"
+        R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{}}})",
+        full_name,
+        json_escape(event.category),
+        to_microseconds(event.start),
+        to_microseconds(event.end - event.start),
+        snapshot.thread_index);
+
+    /* Dependency arrow from the end of the event this one was waiting for. */
+    const EventSnapshot *parent = event_by_id.lookup_default(event.parent_id, nullptr);
+    if (parent == nullptr) {
+      continue;
+    }
+    file << fmt::format(
+        ",\n"
+        R"({{"name":"dependency","cat":"dependency","ph":"s","id":{},"ts":{:.3f},"pid":1,)"
+        R"("tid":{}}})",
+        event.id,
+        to_microseconds(parent->event.end),
+        parent->thread_index);
+    file << fmt::format(
+        ",\n"
+        R"({{"name":"dependency","cat":"dependency","ph":"f","bp":"e","id":{},"ts":{:.3f},)"
+        R"("pid":1,"tid":{}}})",
+        event.id,
+        to_microseconds(event.start),
+        snapshot.thread_index);
+  }
+
+  file << "\n]}\n";
+  return file.good();
+}
+
+void export_on_exit(const char *filepath)
+{
+  get_state().exit_filepath = filepath;
+  set_enabled(true);
+}
+
+void exit()
+{
+  TraceState &state = get_state();
+  if (state.exit_filepath.empty()) {
+    return;
+  }
+  if (!export_chrome_trace(state.exit_filepath.c_str())) {
+    fprintf(stderr,
+            "Failed to write dependency graph trace to '%s'.\n",
+            state.exit_filepath.c_str());
+  }
+  else {
+    printf("Dependency graph trace written to '%s'.\n", state.exit_filepath.c_str());
+  }
+  state.exit_filepath.clear();
+}
+
+/** \} */
+
+}  // namespace blender::deg::trace
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+namespace deg = blender::deg;
+
+void DEG_trace_enable(const bool enable)
+{
+  deg::trace::set_enabled(enable);
+}
+
+bool DEG_trace_is_enabled()
+{
+  return deg::trace::is_enabled();
+}
+
+void DEG_trace_clear()
+{
+  deg::trace::clear();
+}
+
+bool DEG_trace_export(const char *filepath)
+{
+  return deg::trace::export_chrome_trace(filepath);
+}
+
+void DEG_trace_export_on_exit(const char *filepath)
+{
+  deg::trace::export_on_exit(filepath);
+}
+
+blender::deg::TraceScope::TraceScope(const char *category,
+                                     const char *label,
+                                     const StringRef name)
+    : category_(category), label_(label), name_(name), enabled_(deg::trace::is_enabled())
+{
+  if (enabled_) {
+    start_ = deg::trace::now();
+  }
+}
+
+blender::deg::TraceScope::~TraceScope()
+{
+  if (enabled_) {
+    deg::trace::record(category_, label_, name_, "", start_, deg::trace::now(), 0);
+  }
+}
+
+/** \} */
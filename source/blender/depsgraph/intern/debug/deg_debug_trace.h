@@ -0,0 +1,63 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Timeline trace of the dependency graph evaluation.
+ *
+ * Spans are recorded into per-thread ring buffers, so recording does not lock and the memory
+ * usage is bounded no matter how long the trace stays enabled: only the latest events of every
+ * thread are kept, and the buffers of exited threads are reused by new threads. The trace is
+ * exported in the Chrome trace event format, which can be opened in `chrome://tracing` or
+ * Perfetto.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "BLI_string_ref.hh"
+
+namespace blender::deg::trace {
+
+/* Whether spans are to be recorded. */
+bool is_enabled();
+void set_enabled(bool enabled);
+
+/* Current time in nanoseconds, in the time-line of the trace. */
+uint64_t now();
+
+/**
+ * Record a span on the calling thread.
+ *
+ * The category and label are expected to be static strings, the name is copied (and truncated
+ * if needed). Sub-name is appended to the name when not empty.
+ *
+ * \param parent_id: Identifier of the event which this one was waiting for, 0 if none. Is
+ * exported as a dependency arrow from the end of the parent to the start of this event.
+ * \return Identifier of the recorded event, which is never 0.
+ */
+uint64_t record(const char *category,
+                const char *label,
+                StringRef name,
+                StringRef subname,
+                uint64_t start,
+                uint64_t end,
+                uint64_t parent_id);
+
+/* Remove all recorded events. Events recorded at the same time may or may not be removed. */
+void clear();
+
+/* Write the recorded events in the Chrome trace event format. Events recorded at the same time
+ * may or may not be written. */
+bool export_chrome_trace(const char *filepath);
+
+/* Enable the trace and write it to the given file when Blender exits. */
+void export_on_exit(const char *filepath);
+
+/* Write the trace if it was requested with #export_on_exit. */
+void exit();
+
+}  // namespace blender::deg::trace
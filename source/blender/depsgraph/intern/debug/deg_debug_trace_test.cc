@@ -0,0 +1,61 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include <fstream>
+
+#include "BLI_fileops.h"
+#include "BLI_path_utils.hh"
+#include "BLI_serialize.hh"
+#include "BLI_tempfile.h"
+
+#include "testing/testing.h"
+
+namespace blender::deg::trace::tests {
+
+TEST(deg_debug_trace, ExportEscapesNames)
+{
+  char temp_dir[FILE_MAX];
+  BLI_temp_directory_path_get(temp_dir, sizeof(temp_dir));
+  const std::string filepath = std::string(temp_dir) + SEP_STR + "blender_deg_trace_test.json";
+
+  clear();
+  const uint64_t start = now();
+  const uint64_t parent_id = record("eval", "OBCube \"quoted\"", "a\\b", "", start, start + 10, 0);
+  record("eval", "", "child", "sub", start + 20, start + 30, parent_id);
+  ASSERT_TRUE(export_chrome_trace(filepath.c_str()));
+  clear();
+
+  /* The exported file is valid JSON and contains the names unchanged. */
+  std::ifstream stream(filepath);
+  io::serialize::JsonFormatter json;
+  const std::shared_ptr<io::serialize::Value> value = json.deserialize(stream);
+  BLI_delete(filepath.c_str(), false, false);
+  ASSERT_NE(value, nullptr);
+  const io::serialize::DictionaryValue *root = value->as_dictionary_value();
+  ASSERT_NE(root, nullptr);
+  const std::shared_ptr<io::serialize::Value> *events_value = root->lookup("traceEvents");
+  ASSERT_NE(events_value, nullptr);
+  const io::serialize::ArrayValue *events = (*events_value)->as_array_value();
+  ASSERT_NE(events, nullptr);
+
+  Vector<std::string> names;
+  for (const std::shared_ptr<io::serialize::Value> &event : events->elements()) {
+    const io::serialize::DictionaryValue *dict = event->as_dictionary_value();
+    ASSERT_NE(dict, nullptr);
+    if (dict->lookup_str("ph") == "X") {
+      names.append(*dict->lookup_str("name"));
+    }
+  }
+  EXPECT_EQ(names.size(), 2);
+  EXPECT_TRUE(names.contains("a\\b: OBCube \"quoted\""));
+  EXPECT_TRUE(names.contains("child/sub"));
+}
+
+}  // namespace blender::deg::trace::tests
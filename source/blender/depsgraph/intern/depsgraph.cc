@@ -58,6 +58,7 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
       is_render_pipeline_depsgraph(false),
       use_editors_update(false),
       update_count(0),
+      priority_evaluations_since_timing(0),
       sync_writeback(DEG_EVALUATE_SYNC_WRITEBACK_NO)
 {
   BLI_spin_init(&lock);
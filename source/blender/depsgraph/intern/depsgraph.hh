@@ -178,6 +178,10 @@ struct Depsgraph {
   /* The number of times this graph has been evaluated. */
   uint64_t update_count;
 
+  /* Number of evaluations with priority scheduling since the one which measured the time of all
+   * operations, see deg_eval.cc. */
+  int priority_evaluations_since_timing;
+
   /* If this mode does not allow writing back to original data any callbacks will be discarded. */
   DepsgraphEvaluateSyncWriteback sync_writeback;
   /**
@@ -178,6 +178,12 @@ bool DEG_debug_consistency_check(Depsgraph *graph)
 
 /* ------------------------------------------------ */
 
+float DEG_stats_thread_utilization(const Depsgraph *graph)
+{
+  const deg::Depsgraph *deg_graph = reinterpret_cast<const deg::Depsgraph *>(graph);
+  return deg_graph->debug.thread_utilization();
+}
+
 void DEG_stats_simple(const Depsgraph *graph,
                       size_t *r_outer,
                       size_t *r_operations,
@@ -0,0 +1,230 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Concurrent evaluation of multiple frames, using one graph per frame in flight.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_node_runtime.hh"
+#include "BKE_pointcache.h"
+#include "BKE_scene.hh"
+
+#include "DNA_node_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_multi_frame.hh"
+#include "DEG_depsgraph_query.hh"
+
+#include "intern/node/deg_node_id.hh"
+
+#include "intern/depsgraph.hh"
+
+namespace blender::deg {
+
+/* -------------------------------------------------------------------- */
+/** \name Frame Dependency
+ * \{ */
+
+static bool id_depends_on_previous_frame(Scene *scene, ID *id)
+{
+  switch (GS(id->name)) {
+    case ID_OB: {
+      Object *object = reinterpret_cast<Object *>(id);
+      if (object->rigidbody_object != nullptr || object->rigidbody_constraint != nullptr) {
+        return true;
+      }
+      /* Cloth, soft bodies, particles, dynamic paint and fluids. */
+      return BKE_ptcache_object_has(scene, object, 0);
+    }
+    case ID_SCE: {
+      const Scene *id_scene = reinterpret_cast<const Scene *>(id);
+      return id_scene->rigidbody_world != nullptr;
+    }
+    case ID_NT: {
+      /* Nested node groups have their own ID nodes, so only the tree itself is checked. */
+      const bNodeTree *ntree = reinterpret_cast<const bNodeTree *>(id);
+      return ntree->runtime->runtime_flag & NTREE_RUNTIME_FLAG_HAS_SIMULATION_ZONE;
+    }
+    default:
+      return false;
+  }
+}
+
+bool MultiFrameEvaluator::has_frame_dependency(const ::Depsgraph *depsgraph)
+{
+  const Depsgraph *deg_graph = reinterpret_cast<const Depsgraph *>(depsgraph);
+  for (const IDNode *id_node : deg_graph->id_nodes) {
+    if (id_depends_on_previous_frame(deg_graph->scene, id_node->id_orig)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Evaluation
+ * \{ */
+
+namespace {
+
+struct FrameSlot {
+  ::Depsgraph *depsgraph;
+  /* Index of the frame the graph is evaluated at. */
+  int64_t frame_index = -1;
+  /* Set by the evaluation task once the graph is ready to be passed to the caller. Is protected
+   * by #ConcurrentEvaluation::mutex. */
+  bool is_evaluated = false;
+};
+
+struct ConcurrentEvaluation {
+  Span<double> frames;
+  Vector<FrameSlot> slots;
+  std::mutex mutex;
+  std::condition_variable evaluated_cond;
+  /* Skip the evaluation of frames which were already scheduled when the caller stopped. */
+  std::atomic<bool> stop = false;
+};
+
+}  // namespace
+
+static void evaluate_frame_task(TaskPool *__restrict pool, void *taskdata)
+{
+  ConcurrentEvaluation &evaluation = *static_cast<ConcurrentEvaluation *>(
+      BLI_task_pool_user_data(pool));
+  FrameSlot &slot = evaluation.slots[POINTER_AS_INT(taskdata)];
+
+  if (!evaluation.stop.load(std::memory_order_relaxed)) {
+    /* Writing back to original data is only done by active graphs, and is not needed for the
+     * frames of a bake or export. */
+    DEG_evaluate_on_framechange(slot.depsgraph,
+                                float(evaluation.frames[slot.frame_index]),
+                                DEG_EVALUATE_SYNC_WRITEBACK_NO);
+  }
+
+  {
+    std::scoped_lock lock(evaluation.mutex);
+    slot.is_evaluated = true;
+  }
+  evaluation.evaluated_cond.notify_all();
+}
+
+MultiFrameEvaluator::MultiFrameEvaluator(::Depsgraph *depsgraph,
+                                         const BuildFn &build_fn,
+                                         const int graphs_num)
+    : depsgraph_(depsgraph)
+{
+  if (graphs_num <= 1 || has_frame_dependency(depsgraph)) {
+    return;
+  }
+
+  const Depsgraph *deg_graph = reinterpret_cast<const Depsgraph *>(depsgraph);
+  for (int i = 1; i < graphs_num; i++) {
+    ::Depsgraph *graph = DEG_graph_new(
+        deg_graph->bmain, deg_graph->scene, deg_graph->view_layer, deg_graph->mode);
+    build_fn(graph);
+    graphs_.append(graph);
+  }
+  is_concurrent_ = true;
+}
+
+MultiFrameEvaluator::~MultiFrameEvaluator()
+{
+  for (::Depsgraph *graph : graphs_) {
+    DEG_graph_free(graph);
+  }
+}
+
+int MultiFrameEvaluator::default_graphs_num()
+{
+  /* Every graph is evaluated with multiple threads already, more graphs mostly help rigs which do
+   * not have enough parallelism on their own. Every graph holds a full copy of the evaluated
+   * data, so the number is kept low. */
+  return std::clamp(BLI_task_scheduler_num_threads() / 4, 1, 4);
+}
+
+bool MultiFrameEvaluator::is_concurrent() const
+{
+  return is_concurrent_;
+}
+
+void MultiFrameEvaluator::evaluate(const Span<double> frames, const FrameFn fn)
+{
+  if (!is_concurrent_) {
+    Scene *scene = DEG_get_input_scene(depsgraph_);
+    for (const double frame : frames) {
+      scene->r.cfra = int(frame);
+      scene->r.subframe = float(frame - scene->r.cfra);
+      BKE_scene_graph_update_for_newframe(depsgraph_);
+      if (!fn(frame, depsgraph_)) {
+        break;
+      }
+    }
+    return;
+  }
+
+  ConcurrentEvaluation evaluation;
+  evaluation.frames = frames;
+  evaluation.slots.append({depsgraph_});
+  for (::Depsgraph *graph : graphs_) {
+    evaluation.slots.append({graph});
+  }
+  const int64_t slots_num = evaluation.slots.size();
+
+  TaskPool *task_pool = BLI_task_pool_create(&evaluation, TASK_PRIORITY_HIGH);
+
+  auto schedule_frame = [&](const int slot_index, const int64_t frame_index) {
+    FrameSlot &slot = evaluation.slots[slot_index];
+    slot.frame_index = frame_index;
+    slot.is_evaluated = false;
+    BLI_task_pool_push(
+        task_pool, evaluate_frame_task, POINTER_FROM_INT(slot_index), false, nullptr);
+  };
+
+  for (const int64_t frame_index : frames.index_range().take_front(slots_num)) {
+    schedule_frame(int(frame_index), frame_index);
+  }
+
+  /* Frames are passed to the caller in order. A graph is given the next frame as soon as the
+   * caller is done with it, so at most one frame per graph is evaluated ahead of the caller. */
+  for (const int64_t frame_index : frames.index_range()) {
+    const int slot_index = int(frame_index % slots_num);
+    FrameSlot &slot = evaluation.slots[slot_index];
+    {
+      std::unique_lock lock(evaluation.mutex);
+      evaluation.evaluated_cond.wait(lock, [&]() { return slot.is_evaluated; });
+    }
+
+    const bool keep_going = fn(frames[frame_index], slot.depsgraph);
+    DEG_ids_clear_recalc(slot.depsgraph, false);
+    if (!keep_going) {
+      evaluation.stop.store(true, std::memory_order_relaxed);
+      break;
+    }
+
+    if (frame_index + slots_num < frames.size()) {
+      schedule_frame(slot_index, frame_index + slots_num);
+    }
+  }
+
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+}
+
+/** \} */
+
+}  // namespace blender::deg
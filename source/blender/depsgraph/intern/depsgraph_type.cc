@@ -14,6 +14,8 @@
 
 #include "DEG_depsgraph.hh"
 
+#include "intern/builder/deg_builder_relations_cache.h"
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/depsgraph_type.hh"
 #include "intern/node/deg_node.hh"
 #include "intern/node/deg_node_component.hh"
@@ -29,7 +31,11 @@ void DEG_register_node_types()
   deg::deg_register_operation_depsnodes();
 }
 
-void DEG_free_node_types() {}
+void DEG_free_node_types()
+{
+  deg::deg_relations_cache_clear();
+  deg::trace::exit();
+}
 
 deg::DEGCustomDataMeshMasks::DEGCustomDataMeshMasks(const CustomData_MeshMasks *other)
     : vert_mask(other->vmask),
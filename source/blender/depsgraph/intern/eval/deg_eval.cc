@@ -8,20 +8,26 @@
  * Evaluation engine entry-points for Depsgraph Engine.
  */
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <mutex>
 
 #include "intern/eval/deg_eval.h"
 
+#include "BLI_array.hh"
 #include "BLI_function_ref.hh"
 #include "BLI_gsqueue.h"
+#include "BLI_heap.h"
 #include "BLI_task.h"
 #include "BLI_time.h"
+#include "BLI_vector.hh"
 
 #include "BKE_global.hh"
 
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
 #include "DEG_depsgraph.hh"
 #include "DEG_depsgraph_query.hh"
@@ -32,6 +38,7 @@
 
 #include "atomic_ops.h"
 
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/depsgraph.hh"
 #include "intern/depsgraph_relation.hh"
 #include "intern/depsgraph_tag.hh"
@@ -48,9 +55,14 @@ namespace blender::deg {
 
 namespace {
 
+/* Number of evaluations with priority scheduling between the ones which measure the time of all
+ * operations. */
+constexpr int PRIORITY_TIMING_INTERVAL = 8;
+
 struct DepsgraphEvalState;
 
 void deg_task_run_func(TaskPool *pool, void *taskdata);
+void deg_task_run_prioritized_func(TaskPool *pool, void *taskdata);
 
 void schedule_children(DepsgraphEvalState *state,
                        OperationNode *node,
@@ -76,12 +88,30 @@ enum class EvaluationStage {
   SINGLE_THREADED_WORKAROUND,
 };
 
+/* Operations which are ready to be evaluated with priority scheduling, with the negated critical
+ * path time as value. Aligned to avoid false sharing between the queues of different threads. */
+struct alignas(64) ReadyQueue {
+  std::mutex mutex;
+  Heap *heap = nullptr;
+};
+
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
   EvaluationStage stage;
   bool need_update_pending_parents = true;
   bool need_single_thread_pass = false;
+
+  /* Evaluate operations with the longest critical path first, instead of in the order they
+   * became ready. */
+  bool use_priority_scheduling = false;
+  /* Measure the time of all operations for their priority scheduling cost. Otherwise only the
+   * operations which were never measured are. */
+  bool do_priority_timing = false;
+  /* A queue per thread, so that threads do not contend on a single lock: operations are added to
+   * the queue of the thread which made them ready. Threads take the most critical operation of
+   * their own queue, and the ones of other threads when it is empty. */
+  Array<ReadyQueue> ready_queues;
 };
 
 void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
@@ -90,8 +120,13 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
 
   /* Sanity checks. */
   BLI_assert_msg(!operation_node->is_noop(), "NOOP nodes should not actually be scheduled");
+  const bool do_trace = trace::is_enabled();
+  const uint64_t trace_start = do_trace ? trace::now() : 0;
   /* Perform operation. */
-  if (state->do_stats) {
+  const bool do_timing = state->do_stats || state->do_priority_timing ||
+                         (state->use_priority_scheduling &&
+                          operation_node->stats.average_time == 0.0);
+  if (do_timing) {
     const double start_time = BLI_time_now_seconds();
     operation_node->evaluate(depsgraph);
     operation_node->stats.current_time += BLI_time_now_seconds() - start_time;
@@ -99,6 +134,18 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
   else {
     operation_node->evaluate(depsgraph);
   }
+  if (do_trace) {
+    const ComponentNode *comp_node = operation_node->owner;
+    const bool is_copy_on_eval = comp_node->type == NodeType::COPY_ON_EVAL;
+    operation_node->trace_event_id = trace::record(is_copy_on_eval ? "copy_on_eval" : "operation",
+                                                   operationCodeAsString(operation_node->opcode),
+                                                   comp_node->owner->id_orig->name + 2,
+                                                   comp_node->name,
+                                                   trace_start,
+                                                   trace::now(),
+                                                   operation_node->trace_parent_event_id);
+    operation_node->trace_parent_event_id = 0;
+  }
 
   /* Clear the flag early on, allowing partial updates without re-evaluating the same node multiple
    * times.
@@ -122,6 +169,53 @@ void deg_task_run_func(TaskPool *pool, void *taskdata)
   });
 }
 
+int ready_queue_thread_index(const DepsgraphEvalState *state)
+{
+  return BLI_task_parallel_thread_id(nullptr) % state->ready_queues.size();
+}
+
+void schedule_prioritized(DepsgraphEvalState *state, TaskPool *pool, OperationNode *node)
+{
+  {
+    ReadyQueue &queue = state->ready_queues[ready_queue_thread_index(state)];
+    std::lock_guard lock(queue.mutex);
+    BLI_heap_insert(queue.heap, float(-node->critical_path_time), node);
+  }
+  /* Every task evaluates the most critical operation at the time it runs, which is not
+   * necessarily the operation which caused the task to be pushed. */
+  BLI_task_pool_push(pool, deg_task_run_prioritized_func, nullptr, false, nullptr);
+}
+
+OperationNode *ready_queues_pop(DepsgraphEvalState *state)
+{
+  const int queues_num = state->ready_queues.size();
+  const int thread_index = ready_queue_thread_index(state);
+  /* Tasks are pushed after their operation is added to a queue, so there is an operation for
+   * every task. Another thread might take it from a queue which was already visited though, in
+   * which case the queues are visited again. */
+  while (true) {
+    for (const int i : IndexRange(queues_num)) {
+      ReadyQueue &queue = state->ready_queues[(thread_index + i) % queues_num];
+      std::lock_guard lock(queue.mutex);
+      if (!BLI_heap_is_empty(queue.heap)) {
+        return static_cast<OperationNode *>(BLI_heap_pop_min(queue.heap));
+      }
+    }
+  }
+}
+
+void deg_task_run_prioritized_func(TaskPool *pool, void * /*taskdata*/)
+{
+  DepsgraphEvalState *state = static_cast<DepsgraphEvalState *>(BLI_task_pool_user_data(pool));
+
+  OperationNode *operation_node = ready_queues_pop(state);
+  evaluate_node(state, operation_node);
+
+  schedule_children(state, operation_node, [&](OperationNode *node) {
+    schedule_prioritized(state, pool, node);
+  });
+}
+
 bool check_operation_node_visible(const DepsgraphEvalState *state, OperationNode *op_node)
 {
   const ComponentNode *comp_node = op_node->owner;
@@ -185,10 +279,75 @@ void calculate_pending_parents_if_needed(DepsgraphEvalState *state)
   state->need_update_pending_parents = false;
 }
 
+/* Cost of evaluating the operation in seconds, as measured in previous evaluations. */
+double operation_cost(const OperationNode *node)
+{
+  if (node->is_noop()) {
+    return 0.0;
+  }
+  /* Operations which were not measured yet still add to the cost, so that longer chains of them
+   * are prioritized. */
+  return std::max(node->stats.average_time, 1e-6);
+}
+
+bool is_operation_pending(const DepsgraphEvalState *state, OperationNode *node)
+{
+  return (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) && check_operation_node_visible(state, node);
+}
+
+/* Calculate the critical path time of all operations which are to be evaluated: the cost of the
+ * operation plus the longest critical path time of the operations depending on it. */
+void calculate_critical_paths(DepsgraphEvalState *state)
+{
+  enum {
+    CRITICAL_PATH_UNVISITED = 0,
+    CRITICAL_PATH_IN_PROGRESS = 1,
+    CRITICAL_PATH_DONE = 2,
+  };
+  for (OperationNode *node : state->graph->operations) {
+    node->custom_flags = CRITICAL_PATH_UNVISITED;
+  }
+
+  /* Depth first traversal with an explicit stack, as dependency chains can be very long. */
+  Vector<std::pair<OperationNode *, int>> stack;
+  for (OperationNode *root : state->graph->operations) {
+    if (root->custom_flags != CRITICAL_PATH_UNVISITED || !is_operation_pending(state, root)) {
+      continue;
+    }
+    root->custom_flags = CRITICAL_PATH_IN_PROGRESS;
+    stack.append({root, 0});
+    while (!stack.is_empty()) {
+      auto &[node, next_child] = stack.last();
+      if (next_child < node->outlinks.size()) {
+        const Relation *rel = node->outlinks[next_child++];
+        OperationNode *child = static_cast<OperationNode *>(rel->to);
+        if ((rel->flag & RELATION_FLAG_CYCLIC) == 0 &&
+            child->custom_flags == CRITICAL_PATH_UNVISITED && is_operation_pending(state, child))
+        {
+          child->custom_flags = CRITICAL_PATH_IN_PROGRESS;
+          stack.append({child, 0});
+        }
+        continue;
+      }
+      double children_time = 0.0;
+      for (const Relation *rel : node->outlinks) {
+        const OperationNode *child = static_cast<const OperationNode *>(rel->to);
+        /* Children which are still in progress are part of a dependency cycle. */
+        if (child->custom_flags == CRITICAL_PATH_DONE) {
+          children_time = std::max(children_time, child->critical_path_time);
+        }
+      }
+      node->critical_path_time = operation_cost(node) + children_time;
+      node->custom_flags = CRITICAL_PATH_DONE;
+      stack.remove_last();
+    }
+  }
+}
+
 void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
   /* Clear tags and other things which needs to be clear. */
-  if (state->do_stats) {
+  if (state->do_stats || state->use_priority_scheduling) {
     for (OperationNode *node : graph->operations) {
       node->stats.reset_current();
     }
@@ -237,6 +396,7 @@ bool need_evaluate_operation_at_stage(DepsgraphEvalState *state,
  */
 void schedule_node(DepsgraphEvalState *state,
                    OperationNode *node,
+                   const OperationNode *parent,
                    bool dec_parents,
                    const FunctionRef<void(OperationNode *node)> schedule_fn)
 {
@@ -253,7 +413,10 @@ void schedule_node(DepsgraphEvalState *state,
    * num_links_pending. */
   if (dec_parents) {
     BLI_assert(node->num_links_pending > 0);
-    atomic_sub_and_fetch_uint32(&node->num_links_pending, 1);
+    if (atomic_sub_and_fetch_uint32(&node->num_links_pending, 1) == 0) {
+      /* The parent which is evaluated last is the one the operation was waiting for. */
+      node->trace_parent_event_id = parent->trace_event_id;
+    }
   }
   /* Cal not schedule operation while its dependencies are not yet
    * evaluated. */
@@ -271,6 +434,9 @@ void schedule_node(DepsgraphEvalState *state,
       /* Clear flags to avoid affecting subsequent update propagation.
        * For normal nodes these are cleared when it is evaluated. */
       node->flag &= ~DEPSOP_FLAG_CLEAR_ON_EVAL;
+      /* Let the children of the NOOP node depend on what the NOOP node was waiting for. */
+      node->trace_event_id = node->trace_parent_event_id;
+      node->trace_parent_event_id = 0;
 
       /* skip NOOP node, schedule children right away */
       schedule_children(state, node, schedule_fn);
@@ -286,7 +452,7 @@ void schedule_graph(DepsgraphEvalState *state,
                     const FunctionRef<void(OperationNode *node)> schedule_fn)
 {
   for (OperationNode *node : state->graph->operations) {
-    schedule_node(state, node, false, schedule_fn);
+    schedule_node(state, node, nullptr, false, schedule_fn);
   }
 }
 
@@ -301,7 +467,7 @@ void schedule_children(DepsgraphEvalState *state,
       /* Happens when having cyclic dependencies. */
       continue;
     }
-    schedule_node(state, child, (rel->flag & RELATION_FLAG_CYCLIC) == 0, schedule_fn);
+    schedule_node(state, child, node, (rel->flag & RELATION_FLAG_CYCLIC) == 0, schedule_fn);
   }
 }
 
@@ -316,9 +482,18 @@ void evaluate_graph_threaded_stage(DepsgraphEvalState *state,
 
   calculate_pending_parents_if_needed(state);
 
-  schedule_graph(state, [&](OperationNode *node) {
-    BLI_task_pool_push(task_pool, deg_task_run_func, node, false, nullptr);
-  });
+  /* Only the main evaluation stage is prioritized: the other ones are short, and the costs of
+   * their operations are only a part of the critical paths. */
+  if (state->use_priority_scheduling && stage == EvaluationStage::THREADED_EVALUATION) {
+    calculate_critical_paths(state);
+    schedule_graph(state,
+                   [&](OperationNode *node) { schedule_prioritized(state, task_pool, node); });
+  }
+  else {
+    schedule_graph(state, [&](OperationNode *node) {
+      BLI_task_pool_push(task_pool, deg_task_run_func, node, false, nullptr);
+    });
+  }
   BLI_task_pool_work_and_wait(task_pool);
 }
 
@@ -409,7 +584,19 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   /* Set up evaluation state. */
   DepsgraphEvalState state;
   state.graph = graph;
+  state.use_priority_scheduling = USER_EXPERIMENTAL_TEST(&U, use_depsgraph_priority_scheduling);
   state.do_stats = graph->debug.do_time_debug();
+  if (state.use_priority_scheduling) {
+    /* Priority scheduling uses the operation timings of previous evaluations as costs. They are
+     * only measured again periodically, as measuring them has a cost of its own. */
+    state.do_priority_timing = graph->priority_evaluations_since_timing == 0;
+    graph->priority_evaluations_since_timing = (graph->priority_evaluations_since_timing + 1) %
+                                               PRIORITY_TIMING_INTERVAL;
+    state.ready_queues.reinitialize(std::max(BLI_task_scheduler_num_threads(), 1));
+    for (ReadyQueue &queue : state.ready_queues) {
+      queue.heap = BLI_heap_new();
+    }
+  }
 
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
@@ -455,6 +642,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::THREADED_EVALUATION);
 
   BLI_task_pool_free(task_pool);
+  for (ReadyQueue &queue : state.ready_queues) {
+    BLI_heap_free(queue.heap, nullptr);
+  }
 
   evaluate_graph_single_threaded_if_needed(&state);
 
@@ -464,6 +654,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
   }
+  else if (state.use_priority_scheduling) {
+    deg_eval_stats_update_average_times(graph);
+  }
 
   /* Clear any uncleared tags. */
   deg_graph_clear_tags(graph);
@@ -21,6 +21,7 @@
 #include <cstring>
 
 #include "BLI_listbase.h"
+#include "BLI_time.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_curve.hh"
@@ -31,6 +32,7 @@
 #include "BKE_scene.hh"
 
 #include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_debug.hh"
 #include "DEG_depsgraph_query.hh"
 
 #include "MEM_guardedalloc.h"
@@ -43,6 +45,7 @@
 #include "DNA_object_types.h"
 #include "DNA_particle_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
 #include "DRW_engine.hh"
 
@@ -290,8 +293,11 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
 }
 
 /* Similar to BKE_scene_copy() but does not require main and assumes pointer
- * is already allocated. */
-bool scene_copy_inplace_no_main(const Scene *scene, Scene *new_scene)
+ * is already allocated.
+ *
+ * When copy_sequencer is false the sequencer editing data is not copied, and is left null in the
+ * new scene. */
+bool scene_copy_inplace_no_main(const Scene *scene, Scene *new_scene, const bool copy_sequencer)
 {
 
   if (G.debug & G_DEBUG_DEPSGRAPH_UID) {
@@ -304,6 +310,12 @@ bool scene_copy_inplace_no_main(const Scene *scene, Scene *new_scene)
 #else
   const ID *id_for_copy = &scene->id;
 #endif
+  Scene scene_without_sequencer;
+  if (!copy_sequencer) {
+    scene_without_sequencer = *(const Scene *)id_for_copy;
+    scene_without_sequencer.ed = nullptr;
+    id_for_copy = &scene_without_sequencer.id;
+  }
   bool result = (BKE_id_copy_ex(nullptr,
                                 id_for_copy,
                                 (ID **)&new_scene,
@@ -744,8 +756,13 @@ int foreach_libblock_validate_callback(LibraryIDLinkCallbackData *cb_data)
 /* Actual implementation of logic which "expands" all the data which was not
  * yet copied-on-eval.
  *
+ * When copy_sequencer is false the sequencer editing data of a scene is not copied: the caller
+ * is responsible for attaching the evaluated one kept from the previous copy.
+ *
  * NOTE: Expects that evaluated datablock is empty. */
-ID *deg_expand_eval_copy_datablock(const Depsgraph *depsgraph, const IDNode *id_node)
+ID *deg_expand_eval_copy_datablock(const Depsgraph *depsgraph,
+                                   const IDNode *id_node,
+                                   const bool copy_sequencer = true)
 {
   const ID *id_orig = id_node->id_orig;
   ID *id_cow = id_node->id_cow;
@@ -781,7 +798,7 @@ ID *deg_expand_eval_copy_datablock(const Depsgraph *depsgraph, const IDNode *id_
   const ID_Type id_type = GS(id_orig->name);
   switch (id_type) {
     case ID_SCE: {
-      done = scene_copy_inplace_no_main((Scene *)id_orig, (Scene *)id_cow);
+      done = scene_copy_inplace_no_main((Scene *)id_orig, (Scene *)id_cow, copy_sequencer);
       if (done) {
         /* NOTE: This is important to do before remap, because this
          * function will make it so less IDs are to be remapped. */
@@ -835,6 +852,27 @@ ID *deg_expand_eval_copy_datablock(const Depsgraph *depsgraph, const IDNode *id_
   return id_cow;
 }
 
+/* Check whether the evaluated sequencer data of the scene can be kept over the update of its
+ * evaluated copy, instead of being copied again from the original.
+ *
+ * Changes to the sequencer are tagged with #ID_RECALC_SEQUENCER_STRIPS, so the evaluated strips
+ * are up to date as long as this flag was not set since the previous copy. */
+bool can_keep_eval_sequencer(const IDNode *id_node)
+{
+  if (!USER_EXPERIMENTAL_TEST(&U, use_depsgraph_partial_copy)) {
+    return false;
+  }
+  if (id_node->id_type != ID_SCE || !id_node->has_full_eval_copy) {
+    return false;
+  }
+  const Scene *scene_orig = reinterpret_cast<const Scene *>(id_node->id_orig);
+  const Scene *scene_cow = reinterpret_cast<const Scene *>(id_node->id_cow);
+  if (scene_orig->ed == nullptr || scene_cow->ed == nullptr) {
+    return false;
+  }
+  return (scene_cow->id.recalc & ID_RECALC_SEQUENCER_STRIPS) == 0;
+}
+
 }  // namespace
 
 ID *deg_update_eval_copy_datablock(const Depsgraph *depsgraph, const IDNode *id_node)
@@ -870,11 +908,46 @@ ID *deg_update_eval_copy_datablock(const Depsgraph *depsgraph, const IDNode *id_
     }
   }
 
+  TraceScope trace_scope("copy_on_eval", "COPY", id_orig->name + 2);
+  const bool do_time = depsgraph->debug.do_time_debug();
+  const double start_time = do_time ? BLI_time_now_seconds() : 0.0;
+
   RuntimeBackup backup(depsgraph);
   backup.init_from_id(id_cow);
+
+  /* Detach evaluated data which is not affected by the update, so that it survives the free and
+   * is not copied again. */
+  const bool keep_sequencer = can_keep_eval_sequencer(id_node);
+  Editing *kept_ed = nullptr;
+  if (keep_sequencer) {
+    Scene *scene_cow = reinterpret_cast<Scene *>(id_cow);
+    kept_ed = scene_cow->ed;
+    scene_cow->ed = nullptr;
+  }
+
   deg_free_eval_copy_datablock(id_cow);
-  deg_expand_eval_copy_datablock(depsgraph, id_node);
+  deg_expand_eval_copy_datablock(depsgraph, id_node, !keep_sequencer);
+
+  if (keep_sequencer) {
+    reinterpret_cast<Scene *>(id_cow)->ed = kept_ed;
+  }
+  else {
+    id_node->has_full_eval_copy = true;
+  }
+
   backup.restore_to_id(id_cow);
+
+  if (do_time) {
+    const double copy_time = BLI_time_now_seconds() - start_time;
+    IDNode::CopyStats &copy_stats = id_node->copy_stats;
+    copy_stats.current_time += copy_time;
+    copy_stats.total_time += copy_time;
+    copy_stats.copies_num++;
+    if (keep_sequencer) {
+      copy_stats.partial_copies_num++;
+    }
+  }
+
   return id_cow;
 }
 
@@ -0,0 +1,161 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "DNA_scene_types.h"
+#include "DNA_sequence_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "BKE_idtype.hh"
+#include "BKE_layer.hh"
+#include "BKE_main.hh"
+#include "BKE_scene.hh"
+
+#include "SEQ_sequencer.hh"
+
+#include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_build.hh"
+#include "DEG_depsgraph_query.hh"
+
+namespace blender::deg::tests {
+
+/** A scene with a few sequencer strips, evaluated with partial copy-on-evaluation enabled. */
+class DepsgraphPartialCopyTest : public testing::Test {
+ public:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Depsgraph *depsgraph = nullptr;
+  int user_flag_prev = 0;
+  char use_partial_copy_prev = 0;
+
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    BKE_idtype_init();
+    DEG_register_node_types();
+  }
+
+  static void TearDownTestSuite()
+  {
+    DEG_free_node_types();
+    CLG_exit();
+  }
+
+  void SetUp() override
+  {
+    user_flag_prev = U.flag;
+    use_partial_copy_prev = U.experimental.use_depsgraph_partial_copy;
+    U.flag |= USER_DEVELOPER_UI;
+    U.experimental.use_depsgraph_partial_copy = 1;
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    Editing *ed = seq::editing_ensure(scene);
+    for (const int i : IndexRange(3)) {
+      Strip *strip = seq::sequence_alloc(&ed->seqbase, 1 + i * 10, 1 + i, STRIP_TYPE_COLOR);
+      SNPRINTF(strip->name, "SQColor%d", i);
+      strip->len = 10;
+    }
+
+    depsgraph = DEG_graph_new(
+        bmain, scene, BKE_view_layer_default_view(scene), DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph);
+    DEG_evaluate_on_refresh(depsgraph);
+  }
+
+  void TearDown() override
+  {
+    DEG_graph_free(depsgraph);
+    BKE_main_free(bmain);
+    U.flag = user_flag_prev;
+    U.experimental.use_depsgraph_partial_copy = use_partial_copy_prev;
+  }
+
+  Scene *scene_eval() const
+  {
+    return DEG_get_evaluated_scene(depsgraph);
+  }
+
+  /** The evaluated strips match the original ones. */
+  void expect_strips_match() const
+  {
+    const Editing *ed_eval = scene_eval()->ed;
+    ASSERT_NE(ed_eval, nullptr);
+    ASSERT_EQ(BLI_listbase_count(&ed_eval->seqbase), BLI_listbase_count(&scene->ed->seqbase));
+    const Strip *strip_eval = static_cast<const Strip *>(ed_eval->seqbase.first);
+    LISTBASE_FOREACH (const Strip *, strip, &scene->ed->seqbase) {
+      EXPECT_STREQ(strip_eval->name, strip->name);
+      EXPECT_EQ(strip_eval->start, strip->start);
+      EXPECT_EQ(strip_eval->blend_opacity, strip->blend_opacity);
+      strip_eval = strip_eval->next;
+    }
+  }
+};
+
+TEST_F(DepsgraphPartialCopyTest, StripsKeptForOtherChanges)
+{
+  expect_strips_match();
+  const Strip *strip_eval = static_cast<const Strip *>(scene_eval()->ed->seqbase.first);
+
+  scene->r.xsch = 1234;
+  DEG_id_tag_update(&scene->id, ID_RECALC_SYNC_TO_EVAL);
+  DEG_evaluate_on_refresh(depsgraph);
+
+  EXPECT_EQ(scene_eval()->r.xsch, 1234);
+  /* The evaluated strips were not copied again. */
+  EXPECT_EQ(scene_eval()->ed->seqbase.first, strip_eval);
+  expect_strips_match();
+}
+
+TEST_F(DepsgraphPartialCopyTest, StripsCopiedWhenTagged)
+{
+  Strip *strip = static_cast<Strip *>(scene->ed->seqbase.last);
+  strip->blend_opacity = 25.0f;
+  strip->start = 100;
+  DEG_id_tag_update(&scene->id, ID_RECALC_SEQUENCER_STRIPS);
+  DEG_evaluate_on_refresh(depsgraph);
+  expect_strips_match();
+
+  /* Added and removed strips. */
+  Strip *new_strip = seq::sequence_alloc(&scene->ed->seqbase, 200, 4, STRIP_TYPE_COLOR);
+  STRNCPY(new_strip->name, "SQNewColor");
+  new_strip->len = 10;
+  seq::sequence_free(scene, static_cast<Strip *>(scene->ed->seqbase.first));
+  DEG_id_tag_update(&scene->id, ID_RECALC_SEQUENCER_STRIPS);
+  DEG_evaluate_on_refresh(depsgraph);
+  expect_strips_match();
+
+  /* Both kinds of changes at once. */
+  scene->r.ysch = 4321;
+  strip->blend_opacity = 75.0f;
+  DEG_id_tag_update(&scene->id, ID_RECALC_SYNC_TO_EVAL | ID_RECALC_SEQUENCER_STRIPS);
+  DEG_evaluate_on_refresh(depsgraph);
+  EXPECT_EQ(scene_eval()->r.ysch, 4321);
+  expect_strips_match();
+}
+
+TEST_F(DepsgraphPartialCopyTest, SequencerRemoved)
+{
+  seq::editing_free(scene, true);
+  DEG_id_tag_update(&scene->id, ID_RECALC_SEQUENCER_STRIPS);
+  DEG_evaluate_on_refresh(depsgraph);
+  EXPECT_EQ(scene_eval()->ed, nullptr);
+
+  seq::editing_ensure(scene);
+  DEG_id_tag_update(&scene->id, ID_RECALC_SYNC_TO_EVAL);
+  DEG_evaluate_on_refresh(depsgraph);
+  EXPECT_NE(scene_eval()->ed, nullptr);
+}
+
+}  // namespace blender::deg::tests
@@ -17,23 +17,55 @@
 
 namespace blender::deg {
 
+/* Weight of the latest evaluation in the average operation timing. */
+static constexpr double AVERAGE_TIME_FACTOR = 0.25;
+
+static void update_average_time(Node::Stats &stats)
+{
+  /* Operations which were not evaluated keep their previous average. */
+  if (stats.current_time > 0.0) {
+    stats.average_time = (stats.average_time == 0.0) ?
+                             stats.current_time :
+                             stats.average_time +
+                                 (stats.current_time - stats.average_time) * AVERAGE_TIME_FACTOR;
+  }
+}
+
 void deg_eval_stats_aggregate(Depsgraph *graph)
 {
   /* Reset current evaluation stats for ID and component nodes.
    * Those are not filled in by the evaluation engine. */
+  double copy_time = 0.0;
   for (Node *node : graph->id_nodes) {
     IDNode *id_node = (IDNode *)node;
     for (ComponentNode *comp_node : id_node->components.values()) {
       comp_node->stats.reset_current();
     }
     id_node->stats.reset_current();
+    /* Copy timing is accumulated during evaluation, including the scene copy which happens before
+     * the operations are evaluated. Consume it, so that the next evaluation starts from zero. */
+    copy_time += id_node->copy_stats.current_time;
+    id_node->copy_stats.current_time = 0.0;
   }
+  graph->debug.copy_time = copy_time;
   /* Now accumulate operation timings to components and IDs. */
+  double operations_time = 0.0;
   for (OperationNode *op_node : graph->operations) {
     ComponentNode *comp_node = op_node->owner;
     IDNode *id_node = comp_node->owner;
-    id_node->stats.current_time += op_node->stats.current_time;
-    comp_node->stats.current_time += op_node->stats.current_time;
+    Node::Stats &stats = op_node->stats;
+    id_node->stats.current_time += stats.current_time;
+    comp_node->stats.current_time += stats.current_time;
+    operations_time += stats.current_time;
+    update_average_time(stats);
+  }
+  graph->debug.operations_time = operations_time;
+}
+
+void deg_eval_stats_update_average_times(Depsgraph *graph)
+{
+  for (OperationNode *op_node : graph->operations) {
+    update_average_time(op_node->stats);
   }
 }
 
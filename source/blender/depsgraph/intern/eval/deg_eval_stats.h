@@ -12,7 +12,12 @@ namespace blender::deg {
 
 struct Depsgraph;
 
-/* Aggregate operation timings to overall component and ID nodes timing. */
+/* Aggregate operation timings to overall component and ID nodes timing, and update the average
+ * operation timings which are used as operation costs by the priority scheduling. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Only update the average operation timings, for when the timings are measured for the priority
+ * scheduling but not for the statistics. */
+void deg_eval_stats_update_average_times(Depsgraph *graph);
+
 }  // namespace blender::deg
@@ -0,0 +1,137 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "DNA_constraint_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_math_matrix.hh"
+#include "BLI_string.h"
+
+#include "BKE_collection.hh"
+#include "BKE_constraint.h"
+#include "BKE_idtype.hh"
+#include "BKE_layer.hh"
+#include "BKE_main.hh"
+#include "BKE_object.hh"
+#include "BKE_scene.hh"
+
+#include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_build.hh"
+#include "DEG_depsgraph_query.hh"
+
+namespace blender::deg::tests {
+
+/**
+ * A scene with chains of parented and constrained objects, evaluated by two graphs: one with
+ * priority scheduling and one without.
+ */
+class DepsgraphPriorityScheduleTest : public testing::Test {
+ public:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Vector<Object *> objects;
+  Depsgraph *depsgraph = nullptr;
+  Depsgraph *depsgraph_prioritized = nullptr;
+  char use_priority_scheduling_prev = 0;
+
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    BKE_idtype_init();
+    DEG_register_node_types();
+  }
+
+  static void TearDownTestSuite()
+  {
+    DEG_free_node_types();
+    CLG_exit();
+  }
+
+  void SetUp() override
+  {
+    use_priority_scheduling_prev = U.experimental.use_depsgraph_priority_scheduling;
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    for (const int i : IndexRange(32)) {
+      char name[MAX_ID_NAME];
+      SNPRINTF(name, "Empty%d", i);
+      Object *object = BKE_object_add_only_object(bmain, OB_EMPTY, name);
+      BKE_collection_object_add(bmain, scene->master_collection, object);
+      object->loc[0] = float(i);
+      object->rot[2] = float(i) * 0.1f;
+      /* Chains of four objects, with a constraint to the previous chain. */
+      if (i % 4 != 0) {
+        object->parent = objects.last();
+      }
+      else if (i >= 4) {
+        bConstraint *con = BKE_constraint_add_for_object(
+            object, "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+        static_cast<bLocateLikeConstraint *>(con->data)->tar = objects[i - 1];
+      }
+      objects.append(object);
+    }
+
+    depsgraph = new_depsgraph();
+    depsgraph_prioritized = new_depsgraph();
+  }
+
+  void TearDown() override
+  {
+    DEG_graph_free(depsgraph);
+    DEG_graph_free(depsgraph_prioritized);
+    BKE_main_free(bmain);
+    U.experimental.use_depsgraph_priority_scheduling = use_priority_scheduling_prev;
+  }
+
+  Depsgraph *new_depsgraph()
+  {
+    Depsgraph *graph = DEG_graph_new(
+        bmain, scene, BKE_view_layer_default_view(scene), DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(graph);
+    return graph;
+  }
+
+  /** Evaluate both graphs, and compare the evaluated transforms. */
+  void evaluate_and_compare()
+  {
+    U.experimental.use_depsgraph_priority_scheduling = 0;
+    DEG_evaluate_on_refresh(depsgraph);
+    U.experimental.use_depsgraph_priority_scheduling = 1;
+    DEG_evaluate_on_refresh(depsgraph_prioritized);
+
+    for (Object *object : objects) {
+      const Object *object_eval = DEG_get_evaluated_object(depsgraph, object);
+      const Object *object_eval_prioritized = DEG_get_evaluated_object(depsgraph_prioritized,
+                                                                       object);
+      EXPECT_EQ(object_eval->object_to_world(), object_eval_prioritized->object_to_world())
+          << object->id.name;
+    }
+  }
+};
+
+TEST_F(DepsgraphPriorityScheduleTest, SameTransforms)
+{
+  evaluate_and_compare();
+  /* Several updates, so that evaluations both with and without operation timing happen, and
+   * the priorities come from measured costs. */
+  for (const int i : IndexRange(20)) {
+    Object *object = objects[(i * 5) % objects.size()];
+    object->loc[1] += 1.0f;
+    DEG_id_tag_update_ex(bmain, &object->id, ID_RECALC_TRANSFORM);
+    evaluate_and_compare();
+  }
+}
+
+}  // namespace blender::deg::tests
@@ -170,6 +170,8 @@ struct Node {
     void reset_current();
     /* Time spent on this node during current graph evaluation. */
     double current_time;
+    /* Moving average of the time spent on this node over the evaluations it was part of. */
+    double average_time;
   };
   /* Relationships between nodes
    * The reason why all depsgraph nodes are descended from this type (apart
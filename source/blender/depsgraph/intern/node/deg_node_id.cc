@@ -53,6 +53,8 @@ void IDNode::init(const ID *id, const char * /*subdata*/)
   has_base = false;
   is_user_modified = false;
   id_cow_recalc_backup = 0;
+  has_full_eval_copy = false;
+  copy_stats = CopyStats();
 
   visible_components_mask = 0;
   previously_visible_components_mask = 0;
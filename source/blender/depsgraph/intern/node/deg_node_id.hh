@@ -132,6 +132,24 @@ struct IDNode : public Node {
   /* Accumulate recalc flags from multiple update passes. */
   int id_cow_recalc_backup;
 
+  /* The evaluated copy was fully copied from the original since this node was built.
+   *
+   * Until then the evaluated copy is not partially updated: data kept from an earlier copy might
+   * refer to data-blocks which are no longer in the graph. */
+  mutable bool has_full_eval_copy;
+
+  /* Statistics of updates of the evaluated copy. Only gathered when time debug is enabled. */
+  struct CopyStats {
+    /* Time spent on copying the data-block during the current graph evaluation. */
+    double current_time = 0.0;
+    /* Time spent on copying the data-block since this node was built. */
+    double total_time = 0.0;
+    /* Number of copies since this node was built, and how many of them were partial. */
+    int copies_num = 0;
+    int partial_copies_num = 0;
+  };
+  mutable CopyStats copy_stats;
+
   IDComponentsMask visible_components_mask;
   IDComponentsMask previously_visible_components_mask;
 
@@ -207,7 +207,10 @@ const char *operationCodeAsString(OperationCode opcode)
   return "UNKNOWN";
 }
 
-OperationNode::OperationNode() : name_tag(-1), flag(0) {}
+OperationNode::OperationNode()
+    : critical_path_time(0.0), trace_event_id(0), trace_parent_event_id(0), name_tag(-1), flag(0)
+{
+}
 
 std::string OperationNode::identifier() const
 {
@@ -285,6 +285,16 @@ struct OperationNode : public Node {
   uint32_t num_links_pending;
   bool scheduled;
 
+  /* Estimated time from the start of this operation until all operations depending on it are
+   * evaluated. Used to schedule the longest chains first with priority scheduling. */
+  double critical_path_time;
+
+  /* Identifier of the trace event of the last evaluation of this operation, and of the operation
+   * which was the last one this operation was waiting for. Only used when the evaluation trace is
+   * enabled. */
+  uint64_t trace_event_id;
+  uint64_t trace_parent_event_id;
+
   /* Identifier for the operation being performed. */
   OperationCode opcode;
   int name_tag;
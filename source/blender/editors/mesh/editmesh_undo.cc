@@ -11,6 +11,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "CLG_log.h"
 
 #include "DNA_key_types.h"
@@ -21,6 +23,7 @@
 #include "DNA_scene_types.h"
 
 #include "BLI_array_utils.h"
+#include "BLI_function_ref.hh"
 #include "BLI_implicit_sharing.hh"
 #include "BLI_listbase.h"
 #include "BLI_math_base.h"
@@ -137,6 +140,10 @@ struct UndoMesh {
   } store;
 #endif /* USE_ARRAY_STORE */
 
+  /**
+   * Memory added to the array stores for this undo-mesh, reduced when it's compressed.
+   * Written by the array store thread, use atomic access, see #mesh_undosys_step_memory_size.
+   */
   size_t undo_size;
 };
 
@@ -510,8 +517,23 @@ static void um_arraystore_compact(UndoMesh *um, const UndoMesh *um_ref)
   um_arraystore_compact_ex(um, um_ref, true);
 }
 
+/** The memory used by all array stores, see #BLI_array_store_calc_size_compacted_get. */
+static size_t um_arraystore_calc_size_compacted()
+{
+  size_t size = 0;
+  for (int bs_index = 0; bs_index < ARRAY_STORE_INDEX_NUM; bs_index++) {
+    size_t size_expanded_iter, size_compacted_iter;
+    BLI_array_store_at_size_calc_memory_usage(
+        &um_arraystore.bs_stride[bs_index], &size_expanded_iter, &size_compacted_iter);
+    size += size_compacted_iter;
+  }
+  return size;
+}
+
 static void um_arraystore_compact_with_info(UndoMesh *um, const UndoMesh *um_ref)
 {
+  const size_t size_compacted_init = um_arraystore_calc_size_compacted();
+
 #  ifdef DEBUG_PRINT
   size_t size_expanded_prev = 0, size_compacted_prev = 0;
 
@@ -534,6 +556,9 @@ static void um_arraystore_compact_with_info(UndoMesh *um, const UndoMesh *um_ref
   TIMEIT_END(mesh_undo_compact);
 #  endif
 
+  /* Data shared with the reference (or any other undo-mesh) is only counted once. */
+  atomic_store_z(&um->undo_size, um_arraystore_calc_size_compacted() - size_compacted_init);
+
 #  ifdef DEBUG_PRINT
   {
     size_t size_expanded = 0, size_compacted = 0;
@@ -686,6 +711,94 @@ static void um_arraystore_free(UndoMesh *um)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Array Store Compression
+ *
+ * Undo-meshes of steps far from the active one are compressed by the array store,
+ * only chunks which aren't shared with uncompressed undo-meshes are compressed.
+ * \{ */
+
+/**
+ * Call `fn` for every state of the undo-mesh stored in the array stores.
+ */
+static void um_arraystore_foreach_state(
+    UndoMesh *um, const blender::FunctionRef<void(BArrayStore *bs, BArrayState *state)> fn)
+{
+  using namespace blender;
+  const Mesh *mesh = &um->mesh;
+  const std::pair<const BArrayCustomData *, int> bcd_array[] = {
+      {um->store.vdata, ARRAY_STORE_INDEX_VERT},
+      {um->store.edata, ARRAY_STORE_INDEX_EDGE},
+      {um->store.ldata, ARRAY_STORE_INDEX_LOOP},
+      {um->store.pdata, ARRAY_STORE_INDEX_POLY},
+  };
+  for (const auto &[bcd_first, bs_index] : bcd_array) {
+    for (const BArrayCustomData *bcd = bcd_first; bcd; bcd = bcd->next) {
+      BArrayStore *bs = BLI_array_store_at_size_get(&um_arraystore.bs_stride[bs_index],
+                                                    CustomData_sizeof(bcd->type));
+      for (const auto &state : bcd->states) {
+        if (std::holds_alternative<BArrayState *>(state) && std::get<BArrayState *>(state)) {
+          fn(bs, std::get<BArrayState *>(state));
+        }
+      }
+    }
+  }
+
+  if (um->store.keyblocks) {
+    BArrayStore *bs = BLI_array_store_at_size_get(
+        &um_arraystore.bs_stride[ARRAY_STORE_INDEX_SHAPE], mesh->key->elemsize);
+    for (int i = 0; i < mesh->key->totkey; i++) {
+      fn(bs, um->store.keyblocks[i]);
+    }
+  }
+  if (um->store.face_offset_indices) {
+    BArrayStore *bs = BLI_array_store_at_size_get(
+        &um_arraystore.bs_stride[ARRAY_STORE_INDEX_POLY_OFFSETS],
+        sizeof(*mesh->face_offset_indices));
+    fn(bs, um->store.face_offset_indices);
+  }
+  if (um->store.mselect) {
+    BArrayStore *bs = BLI_array_store_at_size_get(&um_arraystore.bs_stride[ARRAY_STORE_INDEX_MSEL],
+                                                  sizeof(*mesh->mselect));
+    fn(bs, um->store.mselect);
+  }
+}
+
+static void um_arraystore_compress(UndoMesh *um)
+{
+  const size_t size_compacted_prev = um_arraystore_calc_size_compacted();
+  um_arraystore_foreach_state(
+      um, [](BArrayStore *bs, BArrayState *state) { BLI_array_store_state_compress(bs, state); });
+  /* Chunks shared with other compressed undo-meshes may be compressed too,
+   * the memory saved is counted for this one. */
+  const size_t size_saved = size_compacted_prev - um_arraystore_calc_size_compacted();
+  const size_t undo_size = atomic_load_z(&um->undo_size);
+  atomic_store_z(&um->undo_size, undo_size > size_saved ? undo_size - size_saved : 0);
+}
+
+/**
+ * Needed before the undo-mesh is read or used as reference for the next undo-mesh.
+ * \note The array store thread must not be running.
+ */
+static void um_arraystore_decompress(UndoMesh *um)
+{
+  const size_t size_compacted_prev = um_arraystore_calc_size_compacted();
+  um_arraystore_foreach_state(um, [](BArrayStore *bs, BArrayState *state) {
+    BLI_array_store_state_decompress(bs, state);
+  });
+  atomic_add_and_fetch_z(&um->undo_size,
+                         um_arraystore_calc_size_compacted() - size_compacted_prev);
+}
+
+#  ifdef USE_ARRAY_STORE_THREAD
+static void um_arraystore_compress_cb(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  um_arraystore_compress(static_cast<UndoMesh *>(taskdata));
+}
+#  endif
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Array Store Utilities
  * \{ */
@@ -753,6 +866,12 @@ static void *undomesh_from_editmesh(UndoMesh *um, BMEditMesh *em, Key *key, Undo
   if (um_arraystore.task_pool) {
     BLI_task_pool_work_and_wait(um_arraystore.task_pool);
   }
+#endif
+#ifdef USE_ARRAY_STORE
+  /* A compressed reference can't be used for de-duplication. */
+  if (um_ref) {
+    um_arraystore_decompress(um_ref);
+  }
 #endif
   /* make sure shape keys work */
   if (key != nullptr) {
@@ -825,6 +944,8 @@ static void undomesh_to_editmesh(UndoMesh *um, Object *ob, BMEditMesh *em)
   BLI_task_pool_work_and_wait(um_arraystore.task_pool);
 #  endif
 
+  um_arraystore_decompress(um);
+
 #  ifdef DEBUG_TIME
   TIMEIT_START(mesh_undo_expand);
 #  endif
@@ -973,7 +1094,7 @@ static bool mesh_undosys_step_encode(bContext *C, Main *bmain, UndoStep *us_p)
     BMEditMesh *em = mesh->runtime->edit_mesh.get();
     undomesh_from_editmesh(&elem->data, em, mesh->key, um_references ? um_references[i] : nullptr);
     em->needs_flush_to_id = 1;
-    us->step.data_size += elem->data.undo_size;
+    us->step.data_size += atomic_load_z(&elem->data.undo_size);
     elem->data.uv_selectmode = ts->uv_selectmode;
 
 #ifdef USE_ARRAY_STORE
@@ -1049,6 +1170,36 @@ static void mesh_undosys_step_free(UndoStep *us_p)
   MEM_freeN(us->elems);
 }
 
+static void mesh_undosys_step_compress(UndoStep *us_p, TaskPool * /*task_pool*/)
+{
+#ifdef USE_ARRAY_STORE
+  MeshUndoStep *us = (MeshUndoStep *)us_p;
+  for (uint i = 0; i < us->elems_len; i++) {
+    UndoMesh *um = &us->elems[i].data;
+#  ifdef USE_ARRAY_STORE_THREAD
+    /* The array stores are only accessed by their own (serial) task pool or once it finished,
+     * so compress there instead of the undo stack's pool.
+     * Decoding or freeing the step waits for this. */
+    BLI_task_pool_push(um_arraystore.task_pool, um_arraystore_compress_cb, um, false, nullptr);
+#  else
+    um_arraystore_compress(um);
+#  endif
+  }
+#else
+  UNUSED_VARS(us_p);
+#endif
+}
+
+static size_t mesh_undosys_step_memory_size(const UndoStep *us_p)
+{
+  const MeshUndoStep *us = (const MeshUndoStep *)us_p;
+  size_t size = 0;
+  for (uint i = 0; i < us->elems_len; i++) {
+    size += atomic_load_z(&us->elems[i].data.undo_size);
+  }
+  return size;
+}
+
 static void mesh_undosys_foreach_ID_ref(UndoStep *us_p,
                                         UndoTypeForEachIDRefFn foreach_ID_ref_fn,
                                         void *user_data)
@@ -1069,6 +1220,8 @@ void ED_mesh_undosys_type(UndoType *ut)
   ut->step_encode = mesh_undosys_step_encode;
   ut->step_decode = mesh_undosys_step_decode;
   ut->step_free = mesh_undosys_step_free;
+  ut->step_compress = mesh_undosys_step_compress;
+  ut->step_memory_size = mesh_undosys_step_memory_size;
 
   ut->step_foreach_ID_ref = mesh_undosys_foreach_ID_ref;
 
@@ -24,6 +24,8 @@
  */
 #include "sculpt_undo.hh"
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include "CLG_log.h"
@@ -33,6 +35,7 @@
 #include "BLI_listbase.h"
 #include "BLI_map.hh"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_vector.hh"
 
@@ -81,6 +84,8 @@
 #include "sculpt_face_set.hh"
 #include "sculpt_intern.hh"
 
+#include <zstd.h>
+
 static CLG_LogRef LOG = {"ed.sculpt.undo"};
 
 namespace blender::ed::sculpt_paint::undo {
@@ -151,6 +156,14 @@ struct Node {
   Array<int, 0> face_sets;
 
   Vector<int> face_indices;
+
+  /**
+   * Zstd compressed content of the arrays above while the undo step is compressed (they are empty
+   * then), see #node_compress.
+   */
+  Array<std::byte, 0> compressed_arrays;
+  /** The size of the serialized arrays, before compression. */
+  int64_t compressed_arrays_size = 0;
 };
 
 struct SculptAttrRef {
@@ -180,6 +193,22 @@ struct NodeGeometry {
 };
 
 struct Node;
+struct StepData;
+
+/**
+ * Compression of the nodes of an undo step far from the active one, see #step_compress.
+ * Shared with the compression task, since the step may be freed before the task runs.
+ */
+struct StepCompression {
+  std::mutex mutex;
+  /** Null once the step was freed. */
+  StepData *step_data = nullptr;
+  /** A compression task was pushed and didn't run yet, cleared to cancel it. */
+  bool is_pending = false;
+  bool is_compressed = false;
+  /** The memory used by the step, counted against the undo memory limit. */
+  std::atomic<size_t> memory_size = 0;
+};
 
 struct StepData {
   /**
@@ -255,6 +284,9 @@ struct StepData {
   Vector<std::unique_ptr<Node>> nodes;
 
   size_t undo_size;
+
+  /** Created when the step is compressed the first time. */
+  std::shared_ptr<StepCompression> compression;
 };
 
 struct SculptUndoStep {
@@ -1775,6 +1807,7 @@ static size_t node_size_in_bytes(const Node &node)
   size += node.grid_hidden.all_bits().size() / 8;
   size += node.face_sets.as_span().size_in_bytes();
   size += node.face_indices.as_span().size_in_bytes();
+  size += node.compressed_arrays.as_span().size_in_bytes();
   return size;
 }
 
@@ -1888,6 +1921,174 @@ static void set_active_layer(bContext *C, const SculptAttrRef *attr)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Undo Step Compression
+ *
+ * Steps far from the active one are unlikely to be needed soon, their node arrays are compressed
+ * in the background and decompressed again before the step is decoded.
+ * \{ */
+
+/** Nodes are compressed independently in the background, favor speed. */
+static constexpr int NODE_COMPRESSION_LEVEL = 1;
+
+/** Call `fn` for the arrays of the node which are compressed, hidden state bits are small. */
+template<typename Fn> static void node_foreach_compressed_array(Node &node, const Fn &fn)
+{
+  fn(node.position);
+  fn(node.orig_position);
+  fn(node.normal);
+  fn(node.col);
+  fn(node.mask);
+  fn(node.loop_col);
+  fn(node.vert_indices);
+  fn(node.corner_indices);
+  fn(node.grids);
+  fn(node.face_sets);
+  fn(node.face_indices);
+}
+
+/** Serialize the arrays with their sizes and compress them, unless it doesn't save memory. */
+static void node_compress(Node &node)
+{
+  BLI_assert(node.compressed_arrays.is_empty());
+  Vector<std::byte> data;
+  node_foreach_compressed_array(node, [&](const auto &array) {
+    const int64_t array_size = array.size();
+    data.extend(Span<int64_t>(&array_size, 1).cast<std::byte>());
+    data.extend(array.as_span().template cast<std::byte>());
+  });
+
+  const size_t bound = ZSTD_compressBound(size_t(data.size()));
+  Array<std::byte, 0> compressed(int64_t(bound), NoInitialization{});
+  const size_t compressed_size = ZSTD_compress(
+      compressed.data(), bound, data.data(), size_t(data.size()), NODE_COMPRESSION_LEVEL);
+  if (ZSTD_isError(compressed_size) || compressed_size >= size_t(data.size() - data.size() / 8)) {
+    return;
+  }
+  node.compressed_arrays = Array<std::byte, 0>(compressed.as_span().take_front(compressed_size));
+  node.compressed_arrays_size = data.size();
+  node_foreach_compressed_array(node,
+                                [](auto &array) { array = std::decay_t<decltype(array)>(); });
+}
+
+static void node_decompress(Node &node)
+{
+  if (node.compressed_arrays.is_empty()) {
+    return;
+  }
+  Array<std::byte, 0> data(node.compressed_arrays_size, NoInitialization{});
+  const size_t data_size = ZSTD_decompress(data.data(),
+                                           size_t(data.size()),
+                                           node.compressed_arrays.data(),
+                                           size_t(node.compressed_arrays.size()));
+  BLI_assert(data_size == size_t(data.size()));
+  UNUSED_VARS_NDEBUG(data_size);
+
+  int64_t offset = 0;
+  node_foreach_compressed_array(node, [&](auto &array) {
+    using T = typename std::decay_t<decltype(array)>::value_type;
+    int64_t array_size;
+    memcpy(&array_size, &data[offset], sizeof(array_size));
+    offset += sizeof(array_size);
+    if constexpr (requires { array.reinitialize(array_size); }) {
+      array.reinitialize(array_size);
+    }
+    else {
+      array.resize(array_size);
+    }
+    if (array_size > 0) {
+      memcpy(array.data(), &data[offset], sizeof(T) * size_t(array_size));
+    }
+    offset += sizeof(T) * array_size;
+  });
+  BLI_assert(offset == data.size());
+  node.compressed_arrays = {};
+  node.compressed_arrays_size = 0;
+}
+
+static void step_compress_task(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  StepCompression &compression = **static_cast<std::shared_ptr<StepCompression> *>(taskdata);
+  std::scoped_lock lock(compression.mutex);
+  if (!compression.is_pending) {
+    /* The step was decoded or freed in the meantime. */
+    return;
+  }
+  compression.is_pending = false;
+  compression.is_compressed = true;
+
+  StepData &step_data = *compression.step_data;
+  size_t memory_size = 0;
+  for (std::unique_ptr<Node> &unode : step_data.nodes) {
+    node_compress(*unode);
+    memory_size += node_size_in_bytes(*unode);
+  }
+  compression.memory_size = memory_size;
+}
+
+static void step_compress_task_free(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  MEM_delete(static_cast<std::shared_ptr<StepCompression> *>(taskdata));
+}
+
+static void step_compress(UndoStep *us_p, TaskPool *task_pool)
+{
+  SculptUndoStep *us = reinterpret_cast<SculptUndoStep *>(us_p);
+  StepData &step_data = us->data;
+  if (step_data.nodes.is_empty()) {
+    return;
+  }
+  if (!step_data.compression) {
+    step_data.compression = std::make_shared<StepCompression>();
+    step_data.compression->step_data = &step_data;
+    step_data.compression->memory_size = step_data.undo_size;
+  }
+  {
+    std::scoped_lock lock(step_data.compression->mutex);
+    if (step_data.compression->is_pending || step_data.compression->is_compressed) {
+      return;
+    }
+    step_data.compression->is_pending = true;
+  }
+  BLI_task_pool_push(task_pool,
+                     step_compress_task,
+                     MEM_new<std::shared_ptr<StepCompression>>(__func__, step_data.compression),
+                     false,
+                     step_compress_task_free);
+}
+
+/** Cancel or undo the compression of the step, needed before its nodes are accessed. */
+static void step_decompress(StepData &step_data)
+{
+  if (!step_data.compression) {
+    return;
+  }
+  StepCompression &compression = *step_data.compression;
+  std::scoped_lock lock(compression.mutex);
+  compression.is_pending = false;
+  if (!compression.is_compressed) {
+    return;
+  }
+  threading::parallel_for(step_data.nodes.index_range(), 1, [&](const IndexRange range) {
+    for (const int i : range) {
+      node_decompress(*step_data.nodes[i]);
+    }
+  });
+  compression.is_compressed = false;
+  compression.memory_size = step_data.undo_size;
+}
+
+static size_t step_memory_size(const UndoStep *us_p)
+{
+  const SculptUndoStep *us = reinterpret_cast<const SculptUndoStep *>(us_p);
+  if (us->data.compression) {
+    return us->data.compression->memory_size;
+  }
+  return us->step.data_size;
+}
+
+/** \} */
+
 static void step_encode_init(bContext * /*C*/, UndoStep *us_p)
 {
   SculptUndoStep *us = reinterpret_cast<SculptUndoStep *>(us_p);
@@ -1918,6 +2119,7 @@ static void step_decode_undo_impl(bContext *C, Depsgraph *depsgraph, SculptUndoS
 {
   BLI_assert(us->step.is_applied == true);
 
+  step_decompress(us->data);
   restore_list(C, depsgraph, us->data);
   us->step.is_applied = false;
 }
@@ -1926,6 +2128,7 @@ static void step_decode_redo_impl(bContext *C, Depsgraph *depsgraph, SculptUndoS
 {
   BLI_assert(us->step.is_applied == false);
 
+  step_decompress(us->data);
   restore_list(C, depsgraph, us->data);
   us->step.is_applied = true;
 }
@@ -2040,6 +2243,12 @@ static void step_decode(
 static void step_free(UndoStep *us_p)
 {
   SculptUndoStep *us = reinterpret_cast<SculptUndoStep *>(us_p);
+  if (us->data.compression) {
+    /* Cancel a pending compression task, or wait for the running one. */
+    std::scoped_lock lock(us->data.compression->mutex);
+    us->data.compression->step_data = nullptr;
+    us->data.compression->is_pending = false;
+  }
   free_step_data(us->data);
 }
 
@@ -2090,6 +2299,8 @@ void register_type(UndoType *ut)
   ut->step_encode = step_encode;
   ut->step_decode = step_decode;
   ut->step_free = step_free;
+  ut->step_compress = step_compress;
+  ut->step_memory_size = step_memory_size;
 
   ut->flags = UNDOTYPE_FLAG_DECODE_ACTIVE_STEP;
 
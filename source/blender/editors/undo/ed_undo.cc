@@ -140,6 +140,7 @@ void ED_undo_push(bContext *C, const char *str)
     const size_t memory_limit = size_t(U.undomemory) * 1024 * 1024;
     BKE_undosys_stack_limit_steps_and_memory(wm->undo_stack, -1, memory_limit);
   }
+  BKE_undosys_stack_compress_steps(wm->undo_stack, U.undo_compress_steps);
 
   if (CLOG_CHECK(&LOG, 1)) {
     BKE_undosys_print(wm->undo_stack);
@@ -224,6 +225,8 @@ static void ed_undo_step_post(bContext *C,
 
   asset::list::storage_tag_main_data_dirty();
 
+  BKE_undosys_stack_compress_steps(wm->undo_stack, U.undo_compress_steps);
+
   if (CLOG_CHECK(&LOG, 1)) {
     BKE_undosys_print(wm->undo_stack);
   }
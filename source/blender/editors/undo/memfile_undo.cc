@@ -321,6 +321,19 @@ static void memfile_undosys_step_free(UndoStep *us_p)
   BKE_memfile_undo_free(us->data);
 }
 
+static void memfile_undosys_step_compress(UndoStep *us_p, TaskPool *task_pool)
+{
+  MemFileUndoStep *us = (MemFileUndoStep *)us_p;
+  /* Decompressed on demand when the memfile is read or used as reference for the next step. */
+  BLO_memfile_compress(&us->data->memfile, task_pool);
+}
+
+static size_t memfile_undosys_step_memory_size(const UndoStep *us_p)
+{
+  const MemFileUndoStep *us = (const MemFileUndoStep *)us_p;
+  return BLO_memfile_memory_size(&us->data->memfile);
+}
+
 void ED_memfile_undosys_type(UndoType *ut)
 {
   ut->name = "Global Undo";
@@ -328,6 +341,8 @@ void ED_memfile_undosys_type(UndoType *ut)
   ut->step_encode = memfile_undosys_step_encode;
   ut->step_decode = memfile_undosys_step_decode;
   ut->step_free = memfile_undosys_step_free;
+  ut->step_compress = memfile_undosys_step_compress;
+  ut->step_memory_size = memfile_undosys_step_memory_size;
 
   ut->flags = 0;
 
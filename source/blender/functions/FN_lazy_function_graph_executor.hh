@@ -74,11 +74,79 @@ class GraphExecutorNodeExecuteWrapper {
                             const Context &context) const = 0;
 };
 
+/**
+ * Determines how the work of evaluating the graph is distributed over threads once the executor
+ * uses multi-threading. Before that, both work the same and nodes are evaluated one after another
+ * without any synchronization.
+ */
+enum class GraphExecutorScheduler {
+  /**
+   * Every node state is protected by a mutex, and batches of scheduled nodes are pushed to a task
+   * pool when there are many of them.
+   */
+  TaskPool,
+  /**
+   * Every thread has a deque of scheduled nodes that other threads can steal from. Nodes
+   * scheduled by a thread are run inline by that thread, unless other threads steal them first.
+   * Values are forwarded to inputs that are known to be required without locking the target node,
+   * and nodes are scheduled with atomic state transitions. This reduces the overhead for graphs
+   * with many small nodes.
+   */
+  WorkStealing,
+};
+
+/**
+ * Statistics about a single execution of a #GraphExecutor, used to find the overhead of scheduling
+ * nodes compared to the time spent in the nodes themselves.
+ */
+struct GraphExecutorSchedulingStats {
+  /** Number of times a scheduled node was run, including runs that did not execute the node. */
+  int64_t nodes_run = 0;
+  /** Number of times the function of a node was executed. */
+  int64_t nodes_executed = 0;
+  /** Number of nodes taken from the queue of another thread. */
+  int64_t nodes_stolen = 0;
+  /** Number of tasks pushed to the task pool. */
+  int64_t tasks_spawned = 0;
+  /** Number of times the state of a node was locked while using multiple threads. */
+  int64_t node_locks = 0;
+  /** Number of values forwarded to inputs without locking the target node. */
+  int64_t lock_free_forwards = 0;
+  /** Time spent by all threads in the executor, in nanoseconds. */
+  int64_t executor_time_ns = 0;
+  /** Part of #executor_time_ns spent in the functions of the nodes. */
+  int64_t node_time_ns = 0;
+
+  /** Time spent scheduling nodes and synchronizing threads, in nanoseconds. */
+  int64_t scheduling_overhead_ns() const
+  {
+    return executor_time_ns - node_time_ns;
+  }
+};
+
+/**
+ * Can be implemented to measure the overhead of the executor. Unlike #GraphExecutorLogger, this
+ * does not get any information about individual nodes and values, so that it can be used with
+ * graphs of any size without impacting the performance much.
+ */
+class GraphExecutorProfiler {
+ public:
+  virtual ~GraphExecutorProfiler() = default;
+
+  /**
+   * Called at the end of every execution of the graph. Executions of the same graph may happen
+   * concurrently (with different storage), so this has to be thread-safe.
+   */
+  virtual void report(const GraphExecutorSchedulingStats &stats, const Context &context) const = 0;
+};
+
 class GraphExecutor : public LazyFunction {
  public:
   using Logger = GraphExecutorLogger;
   using SideEffectProvider = GraphExecutorSideEffectProvider;
   using NodeExecuteWrapper = GraphExecutorNodeExecuteWrapper;
+  using Scheduler = GraphExecutorScheduler;
+  using Profiler = GraphExecutorProfiler;
 
  private:
   /**
@@ -105,6 +173,14 @@ class GraphExecutor : public LazyFunction {
    * Optional wrapper for node execution functions.
    */
   const NodeExecuteWrapper *node_execute_wrapper_;
+  /**
+   * How work is distributed over threads.
+   */
+  Scheduler scheduler_ = Scheduler::TaskPool;
+  /**
+   * Optional profiler that gets statistics about every execution.
+   */
+  const Profiler *profiler_ = nullptr;
 
   /**
    * When a graph is executed, various things have to be allocated (e.g. the state of all nodes).
@@ -133,6 +209,10 @@ class GraphExecutor : public LazyFunction {
                 const SideEffectProvider *side_effect_provider,
                 const NodeExecuteWrapper *node_execute_wrapper);
 
+  /** These have to be set before the graph is executed for the first time. */
+  void set_scheduler(Scheduler scheduler);
+  void set_profiler(const Profiler *profiler);
+
   void *init_storage(LinearAllocator<> &allocator) const override;
   void destruct_storage(void *storage) const override;
 
@@ -0,0 +1,107 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup fn
+ *
+ * Fused multi-functions compute a chain of two functions in a single call. When a #Procedure
+ * calls many cheap functions one after another (as is common for chains of math nodes), every
+ * intermediate value is written to and read back from a separate buffer, and every element goes
+ * through multiple virtual calls and loops. A fused function computes the whole chain for an
+ * element at once, so intermediate values stay in registers.
+ *
+ * Fused functions are registered for specific pairs of functions, typically by the code that
+ * creates the functions. #procedure_optimization::fuse_calls then replaces matching calls in a
+ * procedure.
+ *
+ * The parameters of a fused function are the inputs of the first function, followed by all
+ * parameters of the second function except for the input that receives the result of the first
+ * function.
+ */
+
+#include <tuple>
+
+#include "FN_multi_function_builder.hh"
+
+namespace blender::fn::multi_function {
+
+/**
+ * Register a function that computes the same as passing the result of the first function to the
+ * input at the given index of the second function. Both functions must only have single inputs
+ * and one single output, which is their last parameter.
+ *
+ * The functions are referenced by pointer, so they have to stay valid while the registry is used,
+ * which usually means that they are static.
+ */
+void register_fused_function(const MultiFunction &first,
+                             const MultiFunction &second,
+                             int second_input_index,
+                             const MultiFunction &fused);
+
+/**
+ * Find the function registered for the pair of functions, or null if there is none.
+ */
+const MultiFunction *lookup_fused_function(const MultiFunction &first,
+                                           const MultiFunction &second,
+                                           int second_input_index);
+
+namespace build {
+
+namespace detail {
+
+template<typename SecondFn, typename Value, typename Tuple, size_t... Front, size_t... Back>
+inline auto call_with_inserted_arg(const SecondFn &second_fn,
+                                   const Value &value,
+                                   const Tuple &args,
+                                   std::index_sequence<Front...> /*front*/,
+                                   std::index_sequence<Back...> /*back*/)
+{
+  return second_fn(std::get<Front>(args)..., value, std::get<sizeof...(Front) + Back>(args)...);
+}
+
+}  // namespace detail
+
+/**
+ * Build a fused function from the element functions of the two functions (see
+ * #register_fused_function for the order of the parameters). The result of `first_fn` is passed
+ * to `second_fn` at `SecondInputIndex`.
+ *
+ * \param first_in_types: The input types of the first function.
+ * \param second_in_types: The input types of the second function, without the one that receives
+ * the result of the first function.
+ */
+template<size_t SecondInputIndex,
+         typename Out,
+         typename... FirstIn,
+         typename... SecondIn,
+         typename FirstFn,
+         typename SecondFn,
+         typename ExecPreset = exec_presets::Materialized>
+inline auto fused_SO(const char *name,
+                     TypeSequence<FirstIn...> /*first_in_types*/,
+                     TypeSequence<SecondIn...> /*second_in_types*/,
+                     const FirstFn first_fn,
+                     const SecondFn second_fn,
+                     const ExecPreset exec_preset = exec_presets::Materialized())
+{
+  static_assert(SecondInputIndex <= sizeof...(SecondIn));
+  return detail::build_multi_function_with_n_inputs_one_output<Out>(
+      name,
+      [first_fn, second_fn](const FirstIn &...first_in, const SecondIn &...second_in) {
+        return detail::call_with_inserted_arg(
+            second_fn,
+            first_fn(first_in...),
+            std::forward_as_tuple(second_in...),
+            std::make_index_sequence<SecondInputIndex>(),
+            std::make_index_sequence<sizeof...(SecondIn) - SecondInputIndex>());
+      },
+      exec_preset,
+      TypeSequence<FirstIn..., SecondIn...>());
+}
+
+}  // namespace build
+
+}  // namespace blender::fn::multi_function
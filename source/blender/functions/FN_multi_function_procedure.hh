@@ -262,6 +262,14 @@ class Procedure : NonCopyable, NonMovable {
   DummyInstruction &new_dummy_instruction();
   ReturnInstruction &new_return_instruction();
 
+  /**
+   * Destruct instructions that are not used anymore, e.g. after they have been replaced by an
+   * optimization pass. The instructions must not be linked to other instructions anymore. The
+   * parameters are cleared, so that the variables don't reference the instructions anymore.
+   */
+  void remove_call_instruction(CallInstruction &instruction);
+  void remove_destruct_instruction(DestructInstruction &instruction);
+
   void add_parameter(ParamType::InterfaceType interface_type, Variable &variable);
   Span<ConstParameter> params() const;
 
@@ -17,9 +17,17 @@ class ProcedureExecutor : public MultiFunction {
  private:
   Signature signature_;
   const Procedure &procedure_;
+  /** Number of indices that go through the whole procedure at once, zero to disable chunking. */
+  int64_t chunk_size_;
 
  public:
-  ProcedureExecutor(const Procedure &procedure);
+  /**
+   * Large masks are processed in chunks, so that the intermediate values of every chunk fit into
+   * the CPU cache. The default size works well for chains of math operations on vectors.
+   */
+  static constexpr int64_t default_chunk_size = 2048;
+
+  ProcedureExecutor(const Procedure &procedure, int64_t chunk_size = default_chunk_size);
 
   void call(const IndexMask &mask, Params params, Context context) const override;
 
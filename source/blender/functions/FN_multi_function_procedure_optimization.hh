@@ -46,4 +46,19 @@ namespace blender::fn::multi_function::procedure_optimization {
  */
 void move_destructs_up(Procedure &procedure, Instruction &block_end_instr);
 
+/**
+ * Replace pairs of call instructions by a single call of a fused function, when one was
+ * registered for the two functions with #register_fused_function. A pair is fused when the
+ * output of the first call is only used by the second call. The fused call is placed where the
+ * second call was.
+ *
+ * This pass should run before #move_destructs_up, so that the inputs of the first call are still
+ * available at the second call. Like that pass, it only works on a single chain of instructions.
+ *
+ * \param procedure: The procedure that should be optimized.
+ * \param block_end_instr: The last instruction within a linear chain of instructions. It must not
+ * be a call instruction, because that may be replaced.
+ */
+void fuse_calls(Procedure &procedure, Instruction &block_end_instr);
+
 }  // namespace blender::fn::multi_function::procedure_optimization
@@ -39,16 +39,27 @@
  * When all tasks are completed, the executor gives back control to the caller which may later
  * provide new inputs to the graph which in turn leads to new nodes being scheduled and the process
  * starts again.
+ *
+ * With #GraphExecutorScheduler::WorkStealing, the multi-threaded mode works a bit differently.
+ * Every thread that works on the graph has a deque of scheduled nodes. It runs the nodes it
+ * scheduled itself, while idle threads steal nodes from the other end of the deques. Additional
+ * threads are only started when nodes are waiting in a deque, so that small nodes are run inline
+ * without any task overhead. Values that are forwarded to inputs which are known to be required
+ * already, are stored without locking the target node. The missing input counter and the schedule
+ * state of nodes are atomic for that purpose.
  */
 
 #include <atomic>
 #include <mutex>
+#include <thread>
 
+#include "BLI_array.hh"
 #include "BLI_enumerable_thread_specific.hh"
 #include "BLI_function_ref.hh"
 #include "BLI_stack.hh"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_timeit.hh"
 
 #include "FN_lazy_function_graph_executor.hh"
 
@@ -83,15 +94,18 @@ struct InputState {
    * computing their outputs, the computed values will be forwarded to linked input sockets. The
    * value will then live here until it is found that it is not needed anymore.
    *
-   * If #was_ready_for_execution is true, access does not require holding the node lock.
+   * If #was_ready_for_execution is true, access does not require holding the node lock. The
+   * work-stealing scheduler also sets the value without the lock when #usage is #Used already.
    */
-  void *value = nullptr;
+  std::atomic<void *> value = nullptr;
   /**
    * How the node intends to use this input. By default, all inputs may be used. Based on which
    * outputs are used, a node can decide that an input will definitely be used or is never used.
    * This allows freeing values early and avoids unnecessary computations.
+   *
+   * Once this is #Used, it does not change anymore and can be read without the node lock.
    */
-  ValueUsage usage = ValueUsage::Maybe;
+  std::atomic<ValueUsage> usage = ValueUsage::Maybe;
   /**
    * Set to true once #value is set and will stay true afterwards. Access during execution of a
    * node, does not require holding the node lock.
@@ -146,9 +160,10 @@ struct NodeState {
   /**
    * Counts the number of inputs that still have to be provided to this node, until it should run
    * again. This is used as an optimization so that nodes are not scheduled unnecessarily in many
-   * cases.
+   * cases. It is incremented before an input becomes #Used, and may be decremented without holding
+   * the node lock.
    */
-  int missing_required_inputs = 0;
+  std::atomic<int> missing_required_inputs = 0;
   /**
    * Is set to true once the node is done with its work, i.e. when all outputs that may be used
    * have been computed.
@@ -176,9 +191,10 @@ struct NodeState {
   bool enabled_multi_threading = false;
   /**
    * A node is always in one specific schedule state. This helps to ensure that the same node does
-   * not run twice at the same time accidentally.
+   * not run twice at the same time accidentally. Transitions are done with atomic operations, so
+   * that nodes can be scheduled without holding the node lock.
    */
-  NodeScheduleState schedule_state = NodeScheduleState::NotScheduled;
+  std::atomic<NodeScheduleState> schedule_state = NodeScheduleState::NotScheduled;
   /**
    * Custom storage of the node.
    */
@@ -255,6 +271,22 @@ struct ScheduledNodes {
     return priority_.size() + normal_.size();
   }
 
+  Span<const FunctionNode *> priority_nodes() const
+  {
+    return priority_;
+  }
+
+  Span<const FunctionNode *> normal_nodes() const
+  {
+    return normal_;
+  }
+
+  void clear()
+  {
+    priority_.clear();
+    normal_.clear();
+  }
+
   /**
    * Split up the scheduled nodes into two groups that can be worked on in parallel.
    */
@@ -270,6 +302,174 @@ struct ScheduledNodes {
   }
 };
 
+/**
+ * Nodes scheduled by a single thread when the work-stealing scheduler is used. The owning thread
+ * pushes and pops nodes at the bottom, other threads steal nodes from the top. This is the deque
+ * from "Dynamic Circular Work-Stealing Deque" by Chase and Lev, using the memory orderings from
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" by Le et al.
+ */
+class WorkStealingDeque {
+ private:
+  struct Buffer {
+    /** Always a power of two. */
+    int64_t capacity;
+    std::unique_ptr<std::atomic<const FunctionNode *>[]> nodes;
+
+    explicit Buffer(const int64_t capacity)
+        : capacity(capacity),
+          nodes(std::make_unique<std::atomic<const FunctionNode *>[]>(capacity))
+    {
+    }
+
+    std::atomic<const FunctionNode *> &operator[](const int64_t i) const
+    {
+      return nodes[i & (capacity - 1)];
+    }
+  };
+
+  std::atomic<int64_t> top_ = 0;
+  std::atomic<int64_t> bottom_ = 0;
+  std::atomic<Buffer *> buffer_;
+  /**
+   * Owns the current and all previous buffers. Old buffers are only freed together with the
+   * deque, because other threads may still be reading from them. Only accessed by the owner.
+   */
+  Vector<std::unique_ptr<Buffer>, 1> buffers_;
+
+ public:
+  WorkStealingDeque()
+  {
+    buffers_.append(std::make_unique<Buffer>(16));
+    buffer_.store(buffers_.last().get(), std::memory_order_relaxed);
+  }
+
+  /** Must only be called by the owning thread. */
+  void push(const FunctionNode &node)
+  {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    Buffer *buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top >= buffer->capacity) {
+      buffer = this->grow(*buffer, top, bottom);
+    }
+    (*buffer)[bottom].store(&node, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /** Must only be called by the owning thread. Returns the most recently pushed node. */
+  const FunctionNode *pop()
+  {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    const Buffer *buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    const FunctionNode *node = (*buffer)[bottom].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      /* This is the last node, other threads may try to steal it at the same time. */
+      if (!top_.compare_exchange_strong(
+              top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+        node = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return node;
+  }
+
+  /**
+   * Can be called from any thread. Returns the least recently pushed node. This may also return
+   * null when the deque is not empty but another thread took the node first.
+   */
+  const FunctionNode *steal()
+  {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    const Buffer *buffer = buffer_.load(std::memory_order_acquire);
+    const FunctionNode *node = (*buffer)[top].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(
+            top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+    return node;
+  }
+
+  /** The result is only an estimate when other threads access the deque at the same time. */
+  int64_t size() const
+  {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_relaxed);
+    return std::max<int64_t>(bottom - top, 0);
+  }
+
+ private:
+  Buffer *grow(const Buffer &old_buffer, const int64_t top, const int64_t bottom)
+  {
+    std::unique_ptr<Buffer> new_buffer = std::make_unique<Buffer>(old_buffer.capacity * 2);
+    for (int64_t i = top; i < bottom; i++) {
+      (*new_buffer)[i].store(old_buffer[i].load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+    }
+    Buffer *result = new_buffer.get();
+    buffers_.append(std::move(new_buffer));
+    buffer_.store(result, std::memory_order_release);
+    return result;
+  }
+};
+
+/**
+ * Scheduled nodes of a thread that works on the graph with the work-stealing scheduler. A worker
+ * is used by at most one #CurrentTask at a time.
+ */
+struct WorkStealingWorker {
+  WorkStealingDeque deque;
+  /**
+   * Priority nodes mostly free memory and are fast to run, so they are never stolen. Only
+   * accessed by the owning thread.
+   */
+  Vector<const FunctionNode *> priority_nodes;
+  /** True while a #CurrentTask uses this worker. */
+  std::atomic<bool> in_use = false;
+};
+
+struct WorkStealingState {
+  /**
+   * There is one more worker than there are threads, for the thread that started the execution.
+   * When a thread works on multiple tasks at the same time (because it started working on another
+   * task while waiting), there may not be enough workers. Such tasks use #injected_nodes instead.
+   */
+  Array<WorkStealingWorker> workers;
+  /**
+   * Nodes scheduled by threads that do not own a worker, e.g. when a node that uses
+   * multi-threading computes outputs on other threads.
+   */
+  std::mutex injected_mutex;
+  ScheduledNodes injected_nodes;
+  std::atomic<int64_t> injected_nodes_num = 0;
+  /**
+   * Number of tasks in the task pool that look for nodes to steal. This is limited to avoid
+   * spawning tasks that do not find any work.
+   */
+  std::atomic<int> active_helpers = 0;
+  int max_helpers;
+
+  WorkStealingState()
+      : workers(BLI_task_scheduler_num_threads() + 1),
+        max_helpers(BLI_task_scheduler_num_threads())
+  {
+  }
+};
+
 struct CurrentTask {
   /**
    * Mutex used to protect #scheduled_nodes when the executor uses multi-threading.
@@ -284,8 +484,39 @@ struct CurrentTask {
    * mutex.
    */
   std::atomic<bool> has_scheduled_nodes = false;
+  /**
+   * Thread that works on this task.
+   */
+  std::thread::id thread = std::this_thread::get_id();
+  /**
+   * Used instead of #scheduled_nodes when the work-stealing scheduler is used in multi-threaded
+   * mode. It is acquired when the first node is scheduled and released when the task ends.
+   */
+  WorkStealingWorker *worker = nullptr;
+  /**
+   * Statistics gathered by the thread working on this task. The counters that may also be changed
+   * by other threads are stored in the #Executor.
+   */
+  GraphExecutorSchedulingStats stats;
 };
 
+/**
+ * Only spawn helper tasks when this many nodes are waiting in the deque of a thread. Otherwise the
+ * nodes are run by the thread that scheduled them.
+ */
+static constexpr int64_t work_stealing_spawn_threshold = 2;
+/**
+ * Number of times a helper task looks for nodes to steal before it ends. This avoids spawning new
+ * tasks all the time when nodes are scheduled in short intervals.
+ */
+static constexpr int work_stealing_idle_rounds = 16;
+/**
+ * Multi-threading is enabled once this many nodes are scheduled on the thread. The work-stealing
+ * scheduler has lower overhead, so it is enabled earlier.
+ */
+static constexpr int64_t task_pool_split_threshold = 128;
+static constexpr int64_t work_stealing_threading_threshold = 16;
+
 class Executor {
  private:
   const GraphExecutor &self_;
@@ -308,6 +539,18 @@ class Executor {
    * If this is empty, the executor is in single threaded mode.
    */
   std::atomic<TaskPool *> task_pool_ = nullptr;
+  /**
+   * Only allocated when the work-stealing scheduler is used in multi-threaded mode.
+   */
+  std::unique_ptr<WorkStealingState> work_stealing_;
+  /**
+   * Statistics of the current execution, only gathered when there is a profiler.
+   */
+  std::mutex stats_mutex_;
+  GraphExecutorSchedulingStats stats_;
+  std::atomic<int64_t> node_locks_num_ = 0;
+  std::atomic<int64_t> lock_free_forwards_num_ = 0;
+  std::atomic<int64_t> tasks_spawned_num_ = 0;
 #ifdef FN_LAZY_FUNCTION_DEBUG_THREADS
   std::thread::id current_main_thread_;
 #endif
@@ -425,6 +668,10 @@ class Executor {
     if (TaskPool *task_pool = task_pool_.load()) {
       BLI_task_pool_work_and_wait(task_pool);
     }
+
+    if (self_.profiler_ != nullptr) {
+      this->report_scheduling_stats(context);
+    }
   }
 
  private:
@@ -737,33 +984,71 @@ class Executor {
   void schedule_node(LockedNode &locked_node, CurrentTask &current_task, const bool is_priority)
   {
     BLI_assert(locked_node.node.is_function());
-    switch (locked_node.node_state.schedule_state) {
-      case NodeScheduleState::NotScheduled: {
-        locked_node.node_state.schedule_state = NodeScheduleState::Scheduled;
-        const FunctionNode &node = static_cast<const FunctionNode &>(locked_node.node);
-        if (this->use_multi_threading()) {
-          std::lock_guard lock{current_task.mutex};
-          current_task.scheduled_nodes.schedule(node, is_priority);
+    this->schedule_node(static_cast<const FunctionNode &>(locked_node.node),
+                        locked_node.node_state,
+                        current_task,
+                        is_priority);
+  }
+
+  /**
+   * Does not require the node to be locked, because the schedule state is only changed with
+   * atomic operations.
+   */
+  void schedule_node(const FunctionNode &node,
+                     NodeState &node_state,
+                     CurrentTask &current_task,
+                     const bool is_priority)
+  {
+    NodeScheduleState state = node_state.schedule_state.load(std::memory_order_relaxed);
+    while (true) {
+      switch (state) {
+        case NodeScheduleState::NotScheduled: {
+          if (node_state.schedule_state.compare_exchange_weak(state,
+                                                              NodeScheduleState::Scheduled))
+          {
+            this->add_scheduled_node(node, current_task, is_priority);
+            return;
+          }
+          break;
         }
-        else {
-          current_task.scheduled_nodes.schedule(node, is_priority);
+        case NodeScheduleState::Scheduled: {
+          return;
+        }
+        case NodeScheduleState::Running: {
+          if (node_state.schedule_state.compare_exchange_weak(
+                  state, NodeScheduleState::RunningAndRescheduled))
+          {
+            return;
+          }
+          break;
+        }
+        case NodeScheduleState::RunningAndRescheduled: {
+          return;
         }
-        current_task.has_scheduled_nodes.store(true, std::memory_order_relaxed);
-        break;
-      }
-      case NodeScheduleState::Scheduled: {
-        break;
-      }
-      case NodeScheduleState::Running: {
-        locked_node.node_state.schedule_state = NodeScheduleState::RunningAndRescheduled;
-        break;
-      }
-      case NodeScheduleState::RunningAndRescheduled: {
-        break;
       }
     }
   }
 
+  void add_scheduled_node(const FunctionNode &node,
+                          CurrentTask &current_task,
+                          const bool is_priority)
+  {
+    if (!this->use_multi_threading()) {
+      current_task.scheduled_nodes.schedule(node, is_priority);
+      current_task.has_scheduled_nodes.store(true, std::memory_order_relaxed);
+      return;
+    }
+    if (self_.scheduler_ == GraphExecutorScheduler::WorkStealing) {
+      this->add_work_stealing_node(node, current_task, is_priority);
+      return;
+    }
+    {
+      std::lock_guard lock{current_task.mutex};
+      current_task.scheduled_nodes.schedule(node, is_priority);
+    }
+    current_task.has_scheduled_nodes.store(true, std::memory_order_relaxed);
+  }
+
   void with_locked_node(const Node &node,
                         NodeState &node_state,
                         CurrentTask &current_task,
@@ -774,6 +1059,9 @@ class Executor {
 
     LockedNode locked_node{node, node_state};
     if (this->use_multi_threading()) {
+      if (self_.profiler_ != nullptr) {
+        node_locks_num_.fetch_add(1, std::memory_order_relaxed);
+      }
       std::lock_guard lock{node_state.mutex};
       threading::isolate_task([&]() { f(locked_node); });
     }
@@ -805,17 +1093,29 @@ class Executor {
     }
   }
 
-  void run_task(CurrentTask &current_task, const LocalData &local_data)
+  /**
+   * Run scheduled nodes until there are none left. Returns the number of nodes that have been run.
+   */
+  int64_t run_task(CurrentTask &current_task, const LocalData &local_data)
   {
-    while (const FunctionNode *node = current_task.scheduled_nodes.pop_next_node()) {
-      if (current_task.scheduled_nodes.is_empty()) {
-        current_task.has_scheduled_nodes.store(false, std::memory_order_relaxed);
-      }
+    const timeit::TimePoint start_time = self_.profiler_ ? timeit::Clock::now() :
+                                                           timeit::TimePoint();
+    int64_t nodes_run = 0;
+    while (const FunctionNode *node = this->pop_next_node(current_task)) {
       this->run_node_task(*node, current_task, local_data);
+      current_task.stats.nodes_run++;
+      nodes_run++;
 
       /* If there are many nodes scheduled at the same time, it's beneficial to let multiple
        * threads work on those. */
-      if (current_task.scheduled_nodes.nodes_num() > 128) {
+      if (self_.scheduler_ == GraphExecutorScheduler::WorkStealing) {
+        /* Once multi-threading is enabled, the scheduled nodes are moved to the deque of the
+         * thread when the next node is popped. */
+        if (current_task.scheduled_nodes.nodes_num() > work_stealing_threading_threshold) {
+          this->try_enable_multi_threading();
+        }
+      }
+      else if (current_task.scheduled_nodes.nodes_num() > task_pool_split_threshold) {
         if (this->try_enable_multi_threading()) {
           std::unique_ptr<ScheduledNodes> split_nodes = std::make_unique<ScheduledNodes>();
           current_task.scheduled_nodes.split_into(*split_nodes);
@@ -823,6 +1123,33 @@ class Executor {
         }
       }
     }
+
+    if (WorkStealingWorker *worker = current_task.worker) {
+      BLI_assert(worker->deque.size() == 0);
+      BLI_assert(worker->priority_nodes.is_empty());
+      worker->in_use.store(false, std::memory_order_release);
+      current_task.worker = nullptr;
+    }
+    if (self_.profiler_ != nullptr) {
+      current_task.stats.executor_time_ns += timeit::Nanoseconds(timeit::Clock::now() -
+                                                                 start_time)
+                                                 .count();
+      this->add_scheduling_stats(current_task.stats);
+      current_task.stats = {};
+    }
+    return nodes_run;
+  }
+
+  const FunctionNode *pop_next_node(CurrentTask &current_task)
+  {
+    if (self_.scheduler_ == GraphExecutorScheduler::WorkStealing && this->use_multi_threading()) {
+      return this->pop_next_work_stealing_node(current_task);
+    }
+    const FunctionNode *node = current_task.scheduled_nodes.pop_next_node();
+    if (current_task.scheduled_nodes.is_empty()) {
+      current_task.has_scheduled_nodes.store(false, std::memory_order_relaxed);
+    }
+    return node;
   }
 
   void run_node_task(const FunctionNode &node,
@@ -838,7 +1165,8 @@ class Executor {
     this->with_locked_node(
         node, node_state, current_task, local_data, [&](LockedNode &locked_node) {
           BLI_assert(node_state.schedule_state == NodeScheduleState::Scheduled);
-          node_state.schedule_state = NodeScheduleState::Running;
+          /* No other thread changes the state while it is #Scheduled. */
+          node_state.schedule_state.store(NodeScheduleState::Running);
 
           if (node_state.node_has_finished) {
             return;
@@ -921,7 +1249,16 @@ class Executor {
       /* Importantly, the node must not be locked when it is executed. That would result in locks
        * being hold very long in some cases and results in multiple locks being hold by the same
        * thread in the same graph which can lead to deadlocks. */
-      this->execute_node(node, node_state, current_task, local_data);
+      if (self_.profiler_ != nullptr) {
+        const timeit::TimePoint start_time = timeit::Clock::now();
+        this->execute_node(node, node_state, current_task, local_data);
+        current_task.stats.node_time_ns +=
+            timeit::Nanoseconds(timeit::Clock::now() - start_time).count();
+      }
+      else {
+        this->execute_node(node, node_state, current_task, local_data);
+      }
+      current_task.stats.nodes_executed++;
     }
 
     this->with_locked_node(
@@ -932,9 +1269,11 @@ class Executor {
           }
 #endif
           this->finish_node_if_possible(locked_node);
-          const bool reschedule_requested = node_state.schedule_state ==
+          /* The node may be rescheduled concurrently without holding the lock, so the state has
+           * to be read and reset in a single step. */
+          const bool reschedule_requested = node_state.schedule_state.exchange(
+                                                NodeScheduleState::NotScheduled) ==
                                             NodeScheduleState::RunningAndRescheduled;
-          node_state.schedule_state = NodeScheduleState::NotScheduled;
           if (reschedule_requested && !node_state.node_has_finished) {
             this->schedule_node(locked_node, current_task, false);
           }
@@ -1096,8 +1435,10 @@ class Executor {
     if (input_state.usage == ValueUsage::Used) {
       return nullptr;
     }
-    input_state.usage = ValueUsage::Used;
-    node_state.missing_required_inputs += 1;
+    /* The counter is incremented first, because values may be forwarded to the input without the
+     * lock as soon as it is used. */
+    node_state.missing_required_inputs.fetch_add(1);
+    input_state.usage.store(ValueUsage::Used);
 
     const OutputSocket *origin_socket = input_socket.origin();
     /* Unlinked inputs are always loaded in advance. */
@@ -1160,6 +1501,26 @@ class Executor {
         }
         continue;
       }
+      if (self_.scheduler_ == GraphExecutorScheduler::WorkStealing &&
+          input_state.usage.load(std::memory_order_acquire) == ValueUsage::Used)
+      {
+        /* The input is required already, so the value can be forwarded without locking the target
+         * node. */
+        void *buffer = value_to_forward.get();
+        if (is_last_target) {
+          value_to_forward = {};
+        }
+        else {
+          buffer = local_data.allocator->allocate(type.size(), type.alignment());
+          type.copy_construct(value_to_forward.get(), buffer);
+        }
+        this->forward_value_to_required_input(static_cast<const FunctionNode &>(target_node),
+                                              node_state,
+                                              input_state,
+                                              buffer,
+                                              current_task);
+        continue;
+      }
       this->with_locked_node(
           target_node, node_state, current_task, local_data, [&](LockedNode &locked_node) {
             if (input_state.usage == ValueUsage::Unused) {
@@ -1195,8 +1556,8 @@ class Executor {
     input_state.value = value.get();
 
     if (input_state.usage == ValueUsage::Used) {
-      node_state.missing_required_inputs -= 1;
-      if (node_state.missing_required_inputs == 0 ||
+      const int missing_required_inputs = node_state.missing_required_inputs.fetch_sub(1) - 1;
+      if (missing_required_inputs == 0 ||
           (locked_node.node.is_function() && static_cast<const FunctionNode &>(locked_node.node)
                                                  .function()
                                                  .allow_missing_requested_inputs()))
@@ -1206,6 +1567,29 @@ class Executor {
     }
   }
 
+  /**
+   * Like #forward_value_to_input, but without holding the node lock. This only works for inputs
+   * that are used already, because their usage does not change anymore.
+   */
+  void forward_value_to_required_input(const FunctionNode &node,
+                                       NodeState &node_state,
+                                       InputState &input_state,
+                                       void *value,
+                                       CurrentTask &current_task)
+  {
+    BLI_assert(input_state.value == nullptr);
+    BLI_assert(input_state.usage == ValueUsage::Used);
+    /* The node reads the value after it has seen the decremented counter. */
+    input_state.value.store(value, std::memory_order_release);
+    const int missing_required_inputs = node_state.missing_required_inputs.fetch_sub(1) - 1;
+    if (missing_required_inputs == 0 || node.function().allow_missing_requested_inputs()) {
+      this->schedule_node(node, node_state, current_task, false);
+    }
+    if (self_.profiler_ != nullptr) {
+      lock_free_forwards_num_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
   bool use_multi_threading() const
   {
     return task_pool_.load() != nullptr;
@@ -1238,6 +1622,11 @@ class Executor {
       return false;
     }
     this->ensure_thread_locals();
+    if (self_.scheduler_ == GraphExecutorScheduler::WorkStealing && !work_stealing_) {
+      /* Has to be allocated before the task pool is set, because threads that see the task pool
+       * expect the work-stealing state to exist. */
+      work_stealing_ = std::make_unique<WorkStealingState>();
+    }
     task_pool_.store(BLI_task_pool_create(this, TASK_PRIORITY_HIGH));
     return true;
   }
@@ -1274,6 +1663,9 @@ class Executor {
 
   void push_to_task_pool(std::unique_ptr<ScheduledNodes> scheduled_nodes)
   {
+    if (self_.profiler_ != nullptr) {
+      tasks_spawned_num_.fetch_add(1, std::memory_order_relaxed);
+    }
     /* All nodes are pushed as a single task in the pool. This avoids unnecessary threading
      * overhead when the nodes are fast to compute. */
     BLI_task_pool_push(
@@ -1292,6 +1684,262 @@ class Executor {
         [](TaskPool * /*pool*/, void *data) { delete static_cast<ScheduledNodes *>(data); });
   }
 
+  /**
+   * Get the deque that the current thread can push nodes to, or null when the task is not owned by
+   * this thread or all workers are in use.
+   */
+  WorkStealingWorker *get_work_stealing_worker(CurrentTask &current_task)
+  {
+    if (current_task.worker != nullptr) {
+      return current_task.thread == std::this_thread::get_id() ? current_task.worker : nullptr;
+    }
+    if (current_task.thread != std::this_thread::get_id()) {
+      return nullptr;
+    }
+    for (WorkStealingWorker &worker : work_stealing_->workers) {
+      bool in_use = worker.in_use.load(std::memory_order_relaxed);
+      if (!in_use && worker.in_use.compare_exchange_strong(in_use, true)) {
+        current_task.worker = &worker;
+        return &worker;
+      }
+    }
+    return nullptr;
+  }
+
+  void add_work_stealing_node(const FunctionNode &node,
+                              CurrentTask &current_task,
+                              const bool is_priority)
+  {
+    if (WorkStealingWorker *worker = this->get_work_stealing_worker(current_task)) {
+      if (is_priority) {
+        worker->priority_nodes.append(&node);
+        return;
+      }
+      worker->deque.push(node);
+      /* The thread runs the node itself when it is done with the current one, unless another
+       * thread steals it first. Only start another thread when multiple nodes are waiting. */
+      if (worker->deque.size() >= work_stealing_spawn_threshold) {
+        this->spawn_work_stealing_helpers(1);
+      }
+      return;
+    }
+    this->inject_work_stealing_nodes([&](ScheduledNodes &injected_nodes) {
+      injected_nodes.schedule(node, is_priority);
+    });
+    /* The thread that owns the task may be busy, so make sure that another thread picks the node
+     * up. */
+    this->spawn_work_stealing_helpers(1);
+  }
+
+  void inject_work_stealing_nodes(const FunctionRef<void(ScheduledNodes &)> fn)
+  {
+    WorkStealingState &work_stealing = *work_stealing_;
+    std::lock_guard lock{work_stealing.injected_mutex};
+    fn(work_stealing.injected_nodes);
+    work_stealing.injected_nodes_num.store(work_stealing.injected_nodes.nodes_num());
+  }
+
+  /**
+   * Move nodes that were scheduled on the task before multi-threading was enabled to where other
+   * threads can steal them.
+   */
+  void move_scheduled_nodes_to_work_stealing_worker(CurrentTask &current_task)
+  {
+    ScheduledNodes scheduled_nodes;
+    {
+      std::lock_guard lock{current_task.mutex};
+      scheduled_nodes = std::move(current_task.scheduled_nodes);
+      current_task.scheduled_nodes.clear();
+      current_task.has_scheduled_nodes.store(false, std::memory_order_relaxed);
+    }
+    if (WorkStealingWorker *worker = this->get_work_stealing_worker(current_task)) {
+      worker->priority_nodes.extend(scheduled_nodes.priority_nodes());
+      for (const FunctionNode *node : scheduled_nodes.normal_nodes()) {
+        worker->deque.push(*node);
+      }
+    }
+    else {
+      this->inject_work_stealing_nodes([&](ScheduledNodes &injected_nodes) {
+        for (const FunctionNode *node : scheduled_nodes.priority_nodes()) {
+          injected_nodes.schedule(*node, true);
+        }
+        for (const FunctionNode *node : scheduled_nodes.normal_nodes()) {
+          injected_nodes.schedule(*node, false);
+        }
+      });
+    }
+    this->spawn_work_stealing_helpers(scheduled_nodes.normal_nodes().size());
+  }
+
+  const FunctionNode *pop_next_work_stealing_node(CurrentTask &current_task)
+  {
+    if (current_task.has_scheduled_nodes.load(std::memory_order_relaxed)) {
+      this->move_scheduled_nodes_to_work_stealing_worker(current_task);
+    }
+    WorkStealingState &work_stealing = *work_stealing_;
+    WorkStealingWorker *worker = current_task.worker;
+    if (worker != nullptr) {
+      if (!worker->priority_nodes.is_empty()) {
+        return worker->priority_nodes.pop_last();
+      }
+      if (const FunctionNode *node = worker->deque.pop()) {
+        return node;
+      }
+    }
+    if (work_stealing.injected_nodes_num.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard lock{work_stealing.injected_mutex};
+      if (const FunctionNode *node = work_stealing.injected_nodes.pop_next_node()) {
+        work_stealing.injected_nodes_num.store(work_stealing.injected_nodes.nodes_num());
+        return node;
+      }
+    }
+    /* Start at a different worker on every thread to reduce contention. */
+    const int64_t workers_num = work_stealing.workers.size();
+    const int64_t start = worker != nullptr ?
+                              worker - work_stealing.workers.data() + 1 :
+                              int64_t(std::hash<std::thread::id>()(current_task.thread) %
+                                      uint64_t(workers_num));
+    for (const int64_t i : IndexRange(workers_num)) {
+      WorkStealingWorker &other_worker = work_stealing.workers[(start + i) % workers_num];
+      if (&other_worker == worker) {
+        continue;
+      }
+      if (const FunctionNode *node = other_worker.deque.steal()) {
+        current_task.stats.nodes_stolen++;
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  bool has_work_stealing_nodes() const
+  {
+    const WorkStealingState &work_stealing = *work_stealing_;
+    if (work_stealing.injected_nodes_num.load(std::memory_order_relaxed) > 0) {
+      return true;
+    }
+    for (const WorkStealingWorker &worker : work_stealing.workers) {
+      if (worker.deque.size() > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Start up to the given number of tasks that steal nodes from other threads, as long as the
+   * maximum number of active helpers is not reached.
+   */
+  void spawn_work_stealing_helpers(const int64_t max_num)
+  {
+    WorkStealingState &work_stealing = *work_stealing_;
+    /* Pairs with the fence in #run_work_stealing_helper. Either this thread sees that a helper
+     * stopped, or the helper sees the newly scheduled nodes. */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for ([[maybe_unused]] const int64_t i : IndexRange(max_num)) {
+      int active_helpers = work_stealing.active_helpers.load(std::memory_order_relaxed);
+      do {
+        if (active_helpers >= work_stealing.max_helpers) {
+          return;
+        }
+      } while (!work_stealing.active_helpers.compare_exchange_weak(active_helpers,
+                                                                   active_helpers + 1));
+      BLI_task_pool_push(
+          task_pool_.load(),
+          [](TaskPool *pool, void * /*data*/) {
+            Executor &executor = *static_cast<Executor *>(BLI_task_pool_user_data(pool));
+            executor.run_work_stealing_helper();
+          },
+          nullptr,
+          false,
+          nullptr);
+      if (self_.profiler_ != nullptr) {
+        tasks_spawned_num_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void run_work_stealing_helper()
+  {
+    WorkStealingState &work_stealing = *work_stealing_;
+    const LocalData local_data = this->get_local_data();
+    while (true) {
+      /* Keep looking for nodes for a bit, because other threads are likely to schedule more. */
+      for (int idle_rounds = 0; idle_rounds < work_stealing_idle_rounds; idle_rounds++) {
+        CurrentTask current_task;
+        if (this->run_task(current_task, local_data) > 0) {
+          idle_rounds = 0;
+        }
+        else {
+          std::this_thread::yield();
+        }
+      }
+      work_stealing.active_helpers.fetch_sub(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      /* Nodes may have been scheduled after this thread stopped looking, while the thread that
+       * scheduled them did not spawn a new helper because this one was still active. */
+      if (!this->has_work_stealing_nodes()) {
+        return;
+      }
+      int active_helpers = work_stealing.active_helpers.load(std::memory_order_relaxed);
+      do {
+        if (active_helpers >= work_stealing.max_helpers) {
+          return;
+        }
+      } while (!work_stealing.active_helpers.compare_exchange_weak(active_helpers,
+                                                                   active_helpers + 1));
+    }
+  }
+
+  /**
+   * Called when the current thread is going to be busy for a while, so other threads should take
+   * over the nodes scheduled on it.
+   */
+  void share_work_stealing_nodes(CurrentTask &current_task)
+  {
+    if (current_task.has_scheduled_nodes.load(std::memory_order_relaxed)) {
+      this->move_scheduled_nodes_to_work_stealing_worker(current_task);
+    }
+    WorkStealingWorker *worker = current_task.worker;
+    if (worker == nullptr) {
+      return;
+    }
+    if (!worker->priority_nodes.is_empty()) {
+      this->inject_work_stealing_nodes([&](ScheduledNodes &injected_nodes) {
+        for (const FunctionNode *node : worker->priority_nodes) {
+          injected_nodes.schedule(*node, true);
+        }
+      });
+      worker->priority_nodes.clear();
+      this->spawn_work_stealing_helpers(1);
+    }
+    this->spawn_work_stealing_helpers(worker->deque.size());
+  }
+
+  void add_scheduling_stats(const GraphExecutorSchedulingStats &stats)
+  {
+    std::lock_guard lock{stats_mutex_};
+    stats_.nodes_run += stats.nodes_run;
+    stats_.nodes_executed += stats.nodes_executed;
+    stats_.nodes_stolen += stats.nodes_stolen;
+    stats_.executor_time_ns += stats.executor_time_ns;
+    stats_.node_time_ns += stats.node_time_ns;
+  }
+
+  void report_scheduling_stats(const Context &context)
+  {
+    GraphExecutorSchedulingStats stats;
+    {
+      std::lock_guard lock{stats_mutex_};
+      stats = stats_;
+      stats_ = {};
+    }
+    stats.node_locks = node_locks_num_.exchange(0, std::memory_order_relaxed);
+    stats.lock_free_forwards = lock_free_forwards_num_.exchange(0, std::memory_order_relaxed);
+    stats.tasks_spawned = tasks_spawned_num_.exchange(0, std::memory_order_relaxed);
+    self_.profiler_->report(stats, context);
+  }
+
   LocalData get_local_data()
   {
     if (!this->use_multi_threading()) {
@@ -1437,6 +2085,16 @@ inline void Executor::execute_node(const FunctionNode &node,
    * the execution will take a while. In this case, other tasks waiting on this thread should be
    * allowed to be picked up by another thread. */
   auto blocking_hint_fn = [&]() {
+    if (self_.scheduler_ == GraphExecutorScheduler::WorkStealing) {
+      if (!current_task.has_scheduled_nodes.load() && current_task.worker == nullptr) {
+        return;
+      }
+      if (!this->try_enable_multi_threading()) {
+        return;
+      }
+      this->share_work_stealing_nodes(current_task);
+      return;
+    }
     if (!current_task.has_scheduled_nodes.load()) {
       return;
     }
@@ -1531,6 +2189,16 @@ GraphExecutor::GraphExecutor(const Graph &graph,
   init_buffer_info_.total_size = offset;
 }
 
+void GraphExecutor::set_scheduler(const Scheduler scheduler)
+{
+  scheduler_ = scheduler;
+}
+
+void GraphExecutor::set_profiler(const Profiler *profiler)
+{
+  profiler_ = profiler;
+}
+
 void GraphExecutor::execute_impl(Params &params, const Context &context) const
 {
   Executor &executor = *static_cast<Executor *>(context.storage);
@@ -0,0 +1,87 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include <mutex>
+
+#include "BLI_hash.hh"
+#include "BLI_map.hh"
+
+#include "FN_multi_function_fusion.hh"
+
+namespace blender::fn::multi_function {
+
+namespace {
+
+struct FusionKey {
+  const MultiFunction *first;
+  const MultiFunction *second;
+  int second_input_index;
+
+  uint64_t hash() const
+  {
+    return get_default_hash(first, second, second_input_index);
+  }
+
+  BLI_STRUCT_EQUALITY_OPERATORS_3(FusionKey, first, second, second_input_index)
+};
+
+struct FusionRegistry {
+  std::mutex mutex;
+  Map<FusionKey, const MultiFunction *> fused_functions;
+};
+
+}  // namespace
+
+static FusionRegistry &get_registry()
+{
+  static FusionRegistry registry;
+  return registry;
+}
+
+#ifndef NDEBUG
+static bool has_single_inputs_and_output(const MultiFunction &fn)
+{
+  for (const int param_index : fn.param_indices()) {
+    const ParamType param_type = fn.param_type(param_index);
+    const ParamType::InterfaceType expected_type = param_index == fn.param_amount() - 1 ?
+                                                       ParamType::Output :
+                                                       ParamType::Input;
+    if (param_type.interface_type() != expected_type ||
+        param_type.data_type().category() != DataType::Single)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
+void register_fused_function(const MultiFunction &first,
+                             const MultiFunction &second,
+                             const int second_input_index,
+                             const MultiFunction &fused)
+{
+  BLI_assert(has_single_inputs_and_output(first));
+  BLI_assert(has_single_inputs_and_output(second));
+  BLI_assert(has_single_inputs_and_output(fused));
+  BLI_assert(second_input_index < second.param_amount() - 1);
+  BLI_assert(first.param_type(first.param_amount() - 1).data_type() ==
+             second.param_type(second_input_index).data_type());
+  BLI_assert(fused.param_amount() == first.param_amount() + second.param_amount() - 2);
+
+  FusionRegistry &registry = get_registry();
+  std::scoped_lock lock{registry.mutex};
+  registry.fused_functions.add_overwrite({&first, &second, second_input_index}, &fused);
+}
+
+const MultiFunction *lookup_fused_function(const MultiFunction &first,
+                                           const MultiFunction &second,
+                                           const int second_input_index)
+{
+  FusionRegistry &registry = get_registry();
+  std::scoped_lock lock{registry.mutex};
+  return registry.fused_functions.lookup_default({&first, &second, second_input_index}, nullptr);
+}
+
+}  // namespace blender::fn::multi_function
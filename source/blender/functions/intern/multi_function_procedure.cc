@@ -228,6 +228,26 @@ ReturnInstruction &Procedure::new_return_instruction()
   return instruction;
 }
 
+void Procedure::remove_call_instruction(CallInstruction &instruction)
+{
+  BLI_assert(instruction.prev_.is_empty());
+  BLI_assert(instruction.next_ == nullptr);
+  for (const int param_index : instruction.params_.index_range()) {
+    instruction.set_param_variable(param_index, nullptr);
+  }
+  call_instructions_.remove_first_occurrence_and_reorder(&instruction);
+  instruction.~CallInstruction();
+}
+
+void Procedure::remove_destruct_instruction(DestructInstruction &instruction)
+{
+  BLI_assert(instruction.prev_.is_empty());
+  BLI_assert(instruction.next_ == nullptr);
+  instruction.set_variable(nullptr);
+  destruct_instructions_.remove_first_occurrence_and_reorder(&instruction);
+  instruction.~DestructInstruction();
+}
+
 void Procedure::add_parameter(ParamType::InterfaceType interface_type, Variable &variable)
 {
   params_.append({interface_type, &variable});
@@ -8,12 +8,17 @@
 
 namespace blender::fn::multi_function {
 
-ProcedureExecutor::ProcedureExecutor(const Procedure &procedure) : procedure_(procedure)
+ProcedureExecutor::ProcedureExecutor(const Procedure &procedure, const int64_t chunk_size)
+    : procedure_(procedure), chunk_size_(chunk_size)
 {
   SignatureBuilder builder("Procedure Executor", signature_);
 
   for (const ConstParameter &param : procedure.params()) {
     builder.add("Parameter", ParamType(param.type, param.variable->data_type()));
+    if (param.variable->data_type().is_vector()) {
+      /* Vector arrays can't be sliced to process a chunk. */
+      chunk_size_ = 0;
+    }
   }
 
   this->set_signature(&signature_);
@@ -129,6 +134,13 @@ class ValueAllocator : NonCopyable, NonMovable {
   /** All buffers in the free-lists below have been allocated with this allocator. */
   LinearAllocator<> &linear_allocator_;
 
+  /**
+   * Span buffers are allocated for at least this many elements. All buffers in the free-lists
+   * have the same size, so this has to be set when the allocator is used for masks with different
+   * array sizes.
+   */
+  int64_t min_span_size_;
+
   /**
    * Use stacks so that the most recently used buffers are reused first. This improves cache
    * efficiency.
@@ -149,7 +161,10 @@ class ValueAllocator : NonCopyable, NonMovable {
   Map<const CPPType *, Stack<void *>> single_value_free_lists_;
 
  public:
-  ValueAllocator(LinearAllocator<> &linear_allocator) : linear_allocator_(linear_allocator) {}
+  ValueAllocator(LinearAllocator<> &linear_allocator, const int64_t min_span_size = 0)
+      : linear_allocator_(linear_allocator), min_span_size_(min_span_size)
+  {
+  }
 
   VariableValue_GVArray *obtain_GVArray(const GVArray &varray)
   {
@@ -169,6 +184,7 @@ class ValueAllocator : NonCopyable, NonMovable {
   VariableValue_Span *obtain_Span(const CPPType &type, int size)
   {
     void *buffer = nullptr;
+    size = int(std::max<int64_t>(size, min_span_size_));
 
     const int64_t element_size = type.size();
     const int64_t alignment = type.alignment();
@@ -813,17 +829,17 @@ class VariableState : NonCopyable, NonMovable {
 /** Keeps track of the states of all variables during evaluation. */
 class VariableStates {
  private:
-  ValueAllocator value_allocator_;
+  ValueAllocator &value_allocator_;
   const Procedure &procedure_;
   /** The state of every variable, indexed by #Variable::index_in_procedure(). */
   Array<VariableState> variable_states_;
   const IndexMask &full_mask_;
 
  public:
-  VariableStates(LinearAllocator<> &linear_allocator,
+  VariableStates(ValueAllocator &value_allocator,
                  const Procedure &procedure,
                  const IndexMask &full_mask)
-      : value_allocator_(linear_allocator),
+      : value_allocator_(value_allocator),
         procedure_(procedure),
         variable_states_(procedure.variables().size()),
         full_mask_(full_mask)
@@ -1157,19 +1173,18 @@ class InstructionScheduler {
   }
 };
 
-void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context context) const
+static void execute_procedure(const ProcedureExecutor &fn,
+                              const Procedure &procedure,
+                              const IndexMask &full_mask,
+                              Params params,
+                              Context context,
+                              ValueAllocator &value_allocator)
 {
-  BLI_assert(procedure_.validate());
-
-  AlignedBuffer<512, 64> local_buffer;
-  LinearAllocator<> linear_allocator;
-  linear_allocator.provide_buffer(local_buffer);
-
-  VariableStates variable_states{linear_allocator, procedure_, full_mask};
-  variable_states.add_initial_variable_states(*this, procedure_, params);
+  VariableStates variable_states{value_allocator, procedure, full_mask};
+  variable_states.add_initial_variable_states(fn, procedure, params);
 
   InstructionScheduler scheduler;
-  scheduler.add_referenced_indices(*procedure_.entry(), full_mask);
+  scheduler.add_referenced_indices(*procedure.entry(), full_mask);
 
   /* Loop until all indices got to a return instruction. */
   while (!scheduler.is_done()) {
@@ -1218,9 +1233,9 @@ void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context
     }
   }
 
-  for (const int param_index : this->param_indices()) {
-    const ParamType param_type = this->param_type(param_index);
-    const Variable *variable = procedure_.params()[param_index].variable;
+  for (const int param_index : fn.param_indices()) {
+    const ParamType param_type = fn.param_type(param_index);
+    const Variable *variable = procedure.params()[param_index].variable;
     VariableState &variable_state = variable_states.get_variable_state(*variable);
     switch (param_type.interface_type()) {
       case ParamType::Input: {
@@ -1241,6 +1256,82 @@ void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context
   }
 }
 
+/**
+ * Build the parameters for one chunk of the full mask. The chunk mask is shifted so that it starts
+ * at zero, which keeps the intermediate buffers at the size of a chunk.
+ */
+static void add_chunk_params(const Signature &signature,
+                             Params &full_params,
+                             const IndexRange chunk_range,
+                             ParamsBuilder &r_chunk_params)
+{
+  for (const int param_index : signature.params.index_range()) {
+    const ParamType &param_type = signature.params[param_index].type;
+    switch (param_type.category()) {
+      case ParamCategory::SingleInput: {
+        const GVArray &varray = full_params.readonly_single_input(param_index);
+        r_chunk_params.add_readonly_single_input(varray.slice(chunk_range));
+        break;
+      }
+      case ParamCategory::SingleMutable: {
+        const GMutableSpan span = full_params.single_mutable(param_index);
+        r_chunk_params.add_single_mutable(span.slice(chunk_range));
+        break;
+      }
+      case ParamCategory::SingleOutput: {
+        const GMutableSpan span = full_params.uninitialized_single_output(param_index);
+        r_chunk_params.add_uninitialized_single_output(span.slice(chunk_range));
+        break;
+      }
+      case ParamCategory::VectorInput:
+      case ParamCategory::VectorMutable:
+      case ParamCategory::VectorOutput: {
+        BLI_assert_unreachable();
+        break;
+      }
+    }
+  }
+}
+
+void ProcedureExecutor::call(const IndexMask &full_mask, Params params, Context context) const
+{
+  BLI_assert(procedure_.validate());
+
+  AlignedBuffer<512, 64> local_buffer;
+  LinearAllocator<> linear_allocator;
+  linear_allocator.provide_buffer(local_buffer);
+
+  if (chunk_size_ == 0 || full_mask.size() <= chunk_size_) {
+    ValueAllocator value_allocator{linear_allocator};
+    execute_procedure(*this, procedure_, full_mask, params, context, value_allocator);
+    return;
+  }
+
+  /* Run the entire procedure on one chunk of indices at a time, instead of running every
+   * instruction on all indices. Intermediate values then stay in the CPU cache between
+   * instructions. All chunks reuse the same buffers. */
+  ValueAllocator value_allocator{linear_allocator, chunk_size_};
+  const int64_t mask_end = full_mask.last() + 1;
+  int64_t chunk_start = full_mask.first();
+  while (true) {
+    const IndexRange chunk_range(chunk_start, std::min(chunk_size_, mask_end - chunk_start));
+    IndexMaskMemory memory;
+    const IndexMask chunk_mask = full_mask.slice_content(chunk_range).shift(-chunk_start, memory);
+
+    ParamsBuilder chunk_params{*this, &chunk_mask};
+    add_chunk_params(signature_, params, chunk_range, chunk_params);
+    execute_procedure(*this, procedure_, chunk_mask, chunk_params, context, value_allocator);
+
+    /* Skip gaps in the mask that are larger than a chunk. */
+    const std::optional<index_mask::RawMaskIterator> next_it = full_mask.find_larger_equal(
+        chunk_range.one_after_last());
+    if (!next_it) {
+      break;
+    }
+    chunk_start = full_mask[*next_it];
+  }
+}
+
 MultiFunction::ExecutionHints ProcedureExecutor::get_execution_hints() const
 {
   ExecutionHints hints;
@@ -2,6 +2,9 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 
+#include <algorithm>
+
+#include "FN_multi_function_fusion.hh"
 #include "FN_multi_function_procedure_optimization.hh"
 
 namespace blender::fn::multi_function::procedure_optimization {
@@ -74,4 +77,204 @@ void move_destructs_up(Procedure &procedure, Instruction &block_end_instr)
   }
 }
 
+/**
+ * Link all instructions that come before the given instruction to the new next instruction
+ * instead.
+ */
+static void relink_prev_instructions(Procedure &procedure,
+                                     Instruction &instr,
+                                     Instruction *new_next_instr)
+{
+  while (!instr.prev().is_empty()) {
+    /* Do a copy of the cursor here, because `instr.prev()` changes when #set_next is called. */
+    const InstructionCursor cursor = instr.prev()[0];
+    cursor.set_next(procedure, new_next_instr);
+  }
+}
+
+/** Whether the instruction initializes or destructs the variable. */
+static bool instruction_modifies_variable(Instruction &instr, const Variable &variable)
+{
+  switch (instr.type()) {
+    case InstructionType::Call: {
+      CallInstruction &call_instr = static_cast<CallInstruction &>(instr);
+      const MultiFunction &fn = call_instr.fn();
+      for (const int param_index : fn.param_indices()) {
+        if (call_instr.params()[param_index] == &variable &&
+            fn.param_type(param_index).interface_type() != ParamType::Input)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+    case InstructionType::Destruct: {
+      return static_cast<DestructInstruction &>(instr).variable() == &variable;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+struct LinearChain {
+  /* Instructions in the order they are executed. Removed instructions are set to null, so that
+   * the positions of other instructions stay the same. */
+  Vector<Instruction *> instructions;
+  Map<const Instruction *, int64_t> position_by_instruction;
+};
+
+/**
+ * Try to fuse the call at the given position with the call that computes one of its inputs.
+ * \return True if the call has been replaced.
+ */
+static bool try_fuse_with_input_call(Procedure &procedure,
+                                     LinearChain &chain,
+                                     const int64_t second_pos)
+{
+  CallInstruction &second_instr = static_cast<CallInstruction &>(*chain.instructions[second_pos]);
+  const MultiFunction &second_fn = second_instr.fn();
+
+  for (const int second_input_index : second_fn.param_indices()) {
+    Variable *variable = second_instr.params()[second_input_index];
+    if (variable == nullptr) {
+      continue;
+    }
+    if (second_fn.param_type(second_input_index).interface_type() != ParamType::Input) {
+      continue;
+    }
+    bool is_procedure_param = false;
+    for (const ConstParameter &param : procedure.params()) {
+      is_procedure_param |= param.variable == variable;
+    }
+    if (is_procedure_param) {
+      continue;
+    }
+
+    /* The variable must only be computed by the first call, passed to the second call and then
+     * destructed. */
+    CallInstruction *first_instr = nullptr;
+    DestructInstruction *destruct_instr = nullptr;
+    int other_users_num = 0;
+    for (Instruction *user : variable->users()) {
+      if (user == &second_instr) {
+        continue;
+      }
+      if (user->type() == InstructionType::Call && first_instr == nullptr) {
+        first_instr = static_cast<CallInstruction *>(user);
+      }
+      else if (user->type() == InstructionType::Destruct && destruct_instr == nullptr) {
+        destruct_instr = static_cast<DestructInstruction *>(user);
+      }
+      else {
+        other_users_num++;
+      }
+    }
+    if (first_instr == nullptr || destruct_instr == nullptr || other_users_num > 0) {
+      continue;
+    }
+    if (first_instr->params().last() != variable || second_instr.params().count(variable) > 1) {
+      continue;
+    }
+    const int64_t first_pos = chain.position_by_instruction.lookup_default(first_instr, -1);
+    if (first_pos == -1 || first_pos > second_pos) {
+      continue;
+    }
+    const MultiFunction *fused_fn = lookup_fused_function(
+        first_instr->fn(), second_fn, second_input_index);
+    if (fused_fn == nullptr) {
+      continue;
+    }
+
+    /* The inputs of the first call are read at the position of the second call now, so they must
+     * not change in between. */
+    const Span<Variable *> first_inputs = first_instr->params().drop_back(1);
+    bool inputs_are_available = true;
+    for (const int64_t pos : IndexRange::from_begin_end(first_pos + 1, second_pos)) {
+      Instruction *instr = chain.instructions[pos];
+      if (instr == nullptr) {
+        continue;
+      }
+      for (const Variable *input : first_inputs) {
+        if (input != nullptr && instruction_modifies_variable(*instr, *input)) {
+          inputs_are_available = false;
+        }
+      }
+    }
+    if (!inputs_are_available) {
+      continue;
+    }
+
+    Vector<Variable *> fused_params;
+    fused_params.extend(first_inputs);
+    for (const int param_index : second_fn.param_indices()) {
+      if (param_index != second_input_index) {
+        fused_params.append(second_instr.params()[param_index]);
+      }
+    }
+    CallInstruction &fused_instr = procedure.new_call_instruction(*fused_fn);
+    fused_instr.set_params(fused_params);
+
+    /* Put the fused call in place of the second call. */
+    relink_prev_instructions(procedure, second_instr, &fused_instr);
+    fused_instr.set_next(second_instr.next());
+    second_instr.set_next(nullptr);
+    /* Remove the first call and the destruction of its result. */
+    relink_prev_instructions(procedure, *first_instr, first_instr->next());
+    first_instr->set_next(nullptr);
+    relink_prev_instructions(procedure, *destruct_instr, destruct_instr->next());
+    destruct_instr->set_next(nullptr);
+
+    chain.instructions[second_pos] = &fused_instr;
+    chain.position_by_instruction.add_new(&fused_instr, second_pos);
+    chain.instructions[first_pos] = nullptr;
+    const int64_t destruct_pos = chain.position_by_instruction.lookup_default(destruct_instr, -1);
+    if (destruct_pos != -1) {
+      chain.instructions[destruct_pos] = nullptr;
+    }
+    chain.position_by_instruction.remove(&second_instr);
+    chain.position_by_instruction.remove(first_instr);
+    chain.position_by_instruction.remove(destruct_instr);
+
+    procedure.remove_call_instruction(second_instr);
+    procedure.remove_call_instruction(*first_instr);
+    procedure.remove_destruct_instruction(*destruct_instr);
+    return true;
+  }
+  return false;
+}
+
+void fuse_calls(Procedure &procedure, Instruction &block_end_instr)
+{
+  BLI_assert(block_end_instr.type() != InstructionType::Call);
+
+  LinearChain chain;
+  Instruction *current_instr = &block_end_instr;
+  while (current_instr != nullptr) {
+    chain.instructions.append(current_instr);
+    const Span<InstructionCursor> prev_cursors = current_instr->prev();
+    if (prev_cursors.size() != 1) {
+      /* Stop when there is some branching before this instruction. */
+      break;
+    }
+    current_instr = prev_cursors[0].instruction();
+  }
+  std::reverse(chain.instructions.begin(), chain.instructions.end());
+  for (const int64_t pos : chain.instructions.index_range()) {
+    chain.position_by_instruction.add_new(chain.instructions[pos], pos);
+  }
+
+  for (const int64_t pos : chain.instructions.index_range()) {
+    if (chain.instructions[pos] == nullptr) {
+      continue;
+    }
+    if (chain.instructions[pos]->type() != InstructionType::Call) {
+      continue;
+    }
+    /* The fused call may be fused again with the call computing another input. */
+    while (try_fuse_with_input_call(procedure, chain, pos)) {
+    }
+  }
+}
+
 }  // namespace blender::fn::multi_function::procedure_optimization
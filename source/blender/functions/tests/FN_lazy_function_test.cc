@@ -4,10 +4,14 @@
 
 #include "testing/testing.h"
 
+#include <chrono>
+#include <thread>
+
 #include "FN_lazy_function_execute.hh"
 #include "FN_lazy_function_graph.hh"
 #include "FN_lazy_function_graph_executor.hh"
 
+#include "BLI_array.hh"
 #include "BLI_task.h"
 
 namespace blender::fn::lazy_function::tests {
@@ -178,4 +182,146 @@ TEST(lazy_function, GraphWithCycle)
   EXPECT_EQ(result, 10 * 2 * 5);
 }
 
+class AddModuloFunction : public LazyFunction {
+ private:
+  bool is_slow_;
+
+ public:
+  static constexpr int modulo = 1000003;
+
+  AddModuloFunction(const bool is_slow = false) : is_slow_(is_slow)
+  {
+    debug_name_ = "Add Modulo";
+    inputs_.append({"A", CPPType::get<int>()});
+    inputs_.append({"B", CPPType::get<int>()});
+    outputs_.append({"Result", CPPType::get<int>()});
+  }
+
+  void execute_impl(Params &params, const Context & /*context*/) const override
+  {
+    const int a = params.get_input<int>(0);
+    const int b = params.get_input<int>(1);
+    if (is_slow_) {
+      /* Give other threads the chance to steal the nodes scheduled by this thread. */
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+    params.set_output(0, (a + b) % modulo);
+  }
+};
+
+class StatsProfiler : public GraphExecutor::Profiler {
+ public:
+  mutable GraphExecutorSchedulingStats stats;
+
+  void report(const GraphExecutorSchedulingStats &new_stats,
+              const Context & /*context*/) const override
+  {
+    stats = new_stats;
+  }
+};
+
+/**
+ * Evaluate a wide graph of many small nodes, where every node depends on two nodes of the previous
+ * layer. This is large enough for the executor to use multiple threads. Optionally, some nodes
+ * take longer so that threads have to share their work.
+ */
+static void test_many_small_nodes(const GraphExecutor::Scheduler scheduler,
+                                  const bool use_slow_nodes)
+{
+  BLI_task_scheduler_init();
+  constexpr int width = 64;
+  constexpr int depth = 64;
+  const AddModuloFunction add_fn;
+  const AddModuloFunction slow_add_fn{true};
+
+  Graph graph;
+  Vector<GraphInputSocket *> graph_inputs;
+  Vector<GraphOutputSocket *> graph_outputs;
+  Vector<OutputSocket *> prev_layer;
+  for ([[maybe_unused]] const int i : IndexRange(width)) {
+    GraphInputSocket &input = graph.add_input(CPPType::get<int>());
+    graph_inputs.append(&input);
+    prev_layer.append(&input);
+  }
+  for ([[maybe_unused]] const int layer : IndexRange(depth)) {
+    Vector<OutputSocket *> layer_outputs;
+    for (const int i : IndexRange(width)) {
+      FunctionNode &node = graph.add_function(use_slow_nodes && i % 8 == 0 ? slow_add_fn :
+                                                                            add_fn);
+      graph.add_link(*prev_layer[i], node.input(0));
+      graph.add_link(*prev_layer[(i + 1) % width], node.input(1));
+      layer_outputs.append(&node.output(0));
+    }
+    prev_layer = std::move(layer_outputs);
+  }
+  for (const int i : IndexRange(width)) {
+    GraphOutputSocket &output = graph.add_output(CPPType::get<int>());
+    graph.add_link(*prev_layer[i], output);
+    graph_outputs.append(&output);
+  }
+  graph.update_node_indices();
+
+  Array<int> expected(width);
+  for (const int i : IndexRange(width)) {
+    expected[i] = i * 7;
+  }
+  for ([[maybe_unused]] const int layer : IndexRange(depth)) {
+    Array<int> next(width);
+    for (const int i : IndexRange(width)) {
+      next[i] = (expected[i] + expected[(i + 1) % width]) % AddModuloFunction::modulo;
+    }
+    expected = std::move(next);
+  }
+
+  StatsProfiler profiler;
+  GraphExecutor executor_fn{graph,
+                            Vector<const GraphInputSocket *>(graph_inputs.as_span()),
+                            Vector<const GraphOutputSocket *>(graph_outputs.as_span()),
+                            nullptr,
+                            nullptr,
+                            nullptr};
+  executor_fn.set_scheduler(scheduler);
+  executor_fn.set_profiler(&profiler);
+
+  /* Repeat the evaluation to make it more likely to find race conditions. */
+  for ([[maybe_unused]] const int iteration : IndexRange(10)) {
+    Array<int> inputs(width);
+    Array<int> outputs(width, 0);
+    Vector<GMutablePointer> input_pointers;
+    Vector<GMutablePointer> output_pointers;
+    for (const int i : IndexRange(width)) {
+      inputs[i] = i * 7;
+      input_pointers.append(&inputs[i]);
+      output_pointers.append(&outputs[i]);
+    }
+    Array<std::optional<ValueUsage>> input_usages(width);
+    Array<ValueUsage> output_usages(width, ValueUsage::Used);
+    Array<bool> set_outputs(width, false);
+
+    UserData user_data;
+    LinearAllocator<> allocator;
+    Context context{executor_fn.init_storage(allocator), &user_data, nullptr};
+    BasicParams params{
+        executor_fn, input_pointers, output_pointers, input_usages, output_usages, set_outputs};
+    executor_fn.execute(params, context);
+    executor_fn.destruct_storage(context.storage);
+
+    EXPECT_EQ(outputs.as_span(), expected.as_span());
+    EXPECT_EQ(profiler.stats.nodes_executed, width * depth);
+    EXPECT_GE(profiler.stats.nodes_run, profiler.stats.nodes_executed);
+  }
+}
+
+TEST(lazy_function, ManySmallNodesTaskPool)
+{
+  test_many_small_nodes(GraphExecutor::Scheduler::TaskPool, false);
+  test_many_small_nodes(GraphExecutor::Scheduler::TaskPool, true);
+}
+
+TEST(lazy_function, ManySmallNodesWorkStealing)
+{
+  test_many_small_nodes(GraphExecutor::Scheduler::WorkStealing, false);
+  test_many_small_nodes(GraphExecutor::Scheduler::WorkStealing, true);
+}
+
 }  // namespace blender::fn::lazy_function::tests
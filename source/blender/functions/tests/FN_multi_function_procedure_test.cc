@@ -5,8 +5,10 @@
 #include "testing/testing.h"
 
 #include "FN_multi_function_builder.hh"
+#include "FN_multi_function_fusion.hh"
 #include "FN_multi_function_procedure_builder.hh"
 #include "FN_multi_function_procedure_executor.hh"
+#include "FN_multi_function_procedure_optimization.hh"
 #include "FN_multi_function_test_common.hh"
 
 namespace blender::fn::multi_function::tests {
@@ -423,4 +425,148 @@ TEST(multi_function_procedure, OutputBufferReplaced)
   EXPECT_EQ(output[2], output_value);
 }
 
+TEST(multi_function_procedure, Chunks)
+{
+  /**
+   * procedure(int a, bool cond, int *out) {
+   *   int b = a + 10;
+   *   if (cond) {
+   *     b += 100;
+   *   }
+   *   out = b + 10;
+   * }
+   */
+
+  auto add_10_fn = build::SI1_SO<int, int>("add 10", [](int a) { return a + 10; });
+  auto add_100_fn = build::SM<int>("add 100", [](int &a) { a += 100; });
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var_a = &builder.add_single_input_parameter<int>();
+  Variable *var_cond = &builder.add_single_input_parameter<bool>();
+  auto [var_b] = builder.add_call<1>(add_10_fn, {var_a});
+  builder.add_destruct(*var_a);
+  ProcedureBuilder::Branch branch = builder.add_branch(*var_cond);
+  branch.branch_true.add_call(add_100_fn, {var_b});
+  builder.set_cursor_after_branch(branch);
+  builder.add_destruct(*var_cond);
+  auto [var_out] = builder.add_call<1>(add_10_fn, {var_b});
+  builder.add_destruct(*var_b);
+  builder.add_return();
+  builder.add_output_parameter(*var_out);
+
+  EXPECT_TRUE(procedure.validate());
+
+  /* Small chunks, so that the mask is split into many of them, with a gap larger than a chunk. */
+  ProcedureExecutor procedure_fn{procedure, 4};
+
+  const int size = 120;
+  Array<int> inputs(size);
+  Array<bool> conditions(size);
+  for (const int i : IndexRange(size)) {
+    inputs[i] = i;
+    conditions[i] = i % 3 == 0;
+  }
+  Array<int> results(size, -1);
+
+  IndexMaskMemory memory;
+  const IndexMask mask = IndexMask::from_indices<int>({1, 2, 3, 5, 6, 7, 8, 9, 30, 31, 100, 119},
+                                                      memory);
+  ParamsBuilder params{procedure_fn, &mask};
+
+  params.add_readonly_single_input(inputs.as_span());
+  params.add_readonly_single_input(conditions.as_span());
+  params.add_uninitialized_single_output(results.as_mutable_span());
+
+  ContextBuilder context;
+  procedure_fn.call(mask, params, context);
+
+  for (const int i : IndexRange(size)) {
+    if (mask.contains(i)) {
+      EXPECT_EQ(results[i], i + 20 + (i % 3 == 0 ? 100 : 0));
+    }
+    else {
+      EXPECT_EQ(results[i], -1);
+    }
+  }
+}
+
+TEST(multi_function_procedure, FuseCalls)
+{
+  /**
+   * procedure(int a, int b, int c, int *out1, int *out2) {
+   *   int d = a * b;
+   *   int e = 3;
+   *   int f = c - d;
+   *   out1 = f + e;
+   *   int g = a * c;
+   *   out2 = g - g;
+   * }
+   */
+
+  static auto mul_fn = build::SI2_SO<int, int, int>("mul", [](int a, int b) { return a * b; });
+  static auto sub_fn = build::SI2_SO<int, int, int>("sub", [](int a, int b) { return a - b; });
+  static auto add_fn = build::SI2_SO<int, int, int>("add", [](int a, int b) { return a + b; });
+  static auto mul_sub_fn = build::fused_SO<1, int>(
+      "mul sub",
+      TypeSequence<int, int>(),
+      TypeSequence<int>(),
+      [](int a, int b) { return a * b; },
+      [](int a, int b) { return a - b; });
+  register_fused_function(mul_fn, sub_fn, 1, mul_sub_fn);
+  CustomMF_Constant<int> const_fn{3};
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var_a = &builder.add_single_input_parameter<int>();
+  Variable *var_b = &builder.add_single_input_parameter<int>();
+  Variable *var_c = &builder.add_single_input_parameter<int>();
+  auto [var_d] = builder.add_call<1>(mul_fn, {var_a, var_b});
+  auto [var_e] = builder.add_call<1>(const_fn);
+  auto [var_f] = builder.add_call<1>(sub_fn, {var_c, var_d});
+  auto [var_out1] = builder.add_call<1>(add_fn, {var_f, var_e});
+  /* Is not fused, because the result of the multiplication is used twice. */
+  auto [var_g] = builder.add_call<1>(mul_fn, {var_a, var_c});
+  auto [var_out2] = builder.add_call<1>(sub_fn, {var_g, var_g});
+  builder.add_destruct({var_a, var_b, var_c, var_d, var_e, var_f, var_g});
+  ReturnInstruction &return_instr = builder.add_return();
+  builder.add_output_parameter(*var_out1);
+  builder.add_output_parameter(*var_out2);
+
+  EXPECT_TRUE(procedure.validate());
+  procedure_optimization::fuse_calls(procedure, return_instr);
+  procedure_optimization::move_destructs_up(procedure, return_instr);
+  EXPECT_TRUE(procedure.validate());
+
+  EXPECT_EQ(var_d->users().size(), 0);
+  EXPECT_EQ(var_g->users().size(), 4);
+  EXPECT_EQ(var_a->users().size(), 3);
+
+  ProcedureExecutor procedure_fn{procedure};
+
+  Array<int> inputs_a = {1, 2, 3, 4};
+  Array<int> inputs_b = {5, 6, 7, 8};
+  Array<int> inputs_c = {10, 20, 30, 40};
+  Array<int> results1(4, -1);
+  Array<int> results2(4, -1);
+
+  const IndexMask mask(4);
+  ParamsBuilder params{procedure_fn, &mask};
+  params.add_readonly_single_input(inputs_a.as_span());
+  params.add_readonly_single_input(inputs_b.as_span());
+  params.add_readonly_single_input(inputs_c.as_span());
+  params.add_uninitialized_single_output(results1.as_mutable_span());
+  params.add_uninitialized_single_output(results2.as_mutable_span());
+
+  ContextBuilder context;
+  procedure_fn.call(mask, params, context);
+
+  for (const int i : mask.index_range()) {
+    EXPECT_EQ(results1[i], inputs_c[i] - inputs_a[i] * inputs_b[i] + 3);
+    EXPECT_EQ(results2[i], 0);
+  }
+}
+
 }  // namespace blender::fn::multi_function::tests
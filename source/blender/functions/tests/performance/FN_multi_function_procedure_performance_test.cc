@@ -0,0 +1,262 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_array.hh"
+#include "BLI_math_vector.hh"
+#include "BLI_timeit.hh"
+
+#include "FN_multi_function_builder.hh"
+#include "FN_multi_function_fusion.hh"
+#include "FN_multi_function_procedure_builder.hh"
+#include "FN_multi_function_procedure_executor.hh"
+#include "FN_multi_function_procedure_optimization.hh"
+
+namespace blender::fn::multi_function::tests {
+
+static constexpr int64_t ELEMENTS_NUM = 10'000'000;
+
+static void execute_procedure(const char *name,
+                              const ProcedureExecutor &procedure_fn,
+                              const Span<float3> a,
+                              const Span<float3> b,
+                              MutableSpan<float3> out,
+                              const bool use_threading)
+{
+  const IndexMask mask(out.size());
+  for ([[maybe_unused]] const int i : IndexRange(3)) {
+    ParamsBuilder params{procedure_fn, &mask};
+    params.add_readonly_single_input(a);
+    params.add_readonly_single_input(b);
+    params.add_uninitialized_single_output(out);
+    ContextBuilder context;
+
+    SCOPED_TIMER(name);
+    if (use_threading) {
+      procedure_fn.call_auto(mask, params, context);
+    }
+    else {
+      procedure_fn.call(mask, params, context);
+    }
+  }
+}
+
+TEST(multi_function_procedure_performance, VectorMathChain)
+{
+  /**
+   * A chain of vector math operations, similar to what a field of math nodes turns into.
+   *
+   * procedure(float3 a, float3 b, float3 *out) {
+   *   float3 c = a * 2 + b;
+   *   float3 d = cross(c, b);
+   *   float3 e = normalize(d + a);
+   *   float3 f = e * 0.5 + c;
+   *   out = cross(f, a) + e;
+   * }
+   */
+  auto multiply_add_fn = build::SI2_SO<float3, float3, float3>(
+      "Multiply Add", [](const float3 &a, const float3 &b) { return a * 2.0f + b; });
+  auto half_add_fn = build::SI2_SO<float3, float3, float3>(
+      "Half Add", [](const float3 &a, const float3 &b) { return a * 0.5f + b; });
+  auto cross_fn = build::SI2_SO<float3, float3, float3>(
+      "Cross", [](const float3 &a, const float3 &b) { return math::cross(a, b); });
+  auto add_normalize_fn = build::SI2_SO<float3, float3, float3>(
+      "Add Normalize", [](const float3 &a, const float3 &b) { return math::normalize(a + b); });
+  auto add_fn = build::SI2_SO<float3, float3, float3>(
+      "Add", [](const float3 &a, const float3 &b) { return a + b; });
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var_a = &builder.add_single_input_parameter<float3>();
+  Variable *var_b = &builder.add_single_input_parameter<float3>();
+  auto [var_c] = builder.add_call<1>(multiply_add_fn, {var_a, var_b});
+  auto [var_d] = builder.add_call<1>(cross_fn, {var_c, var_b});
+  builder.add_destruct(*var_b);
+  auto [var_e] = builder.add_call<1>(add_normalize_fn, {var_d, var_a});
+  builder.add_destruct(*var_d);
+  auto [var_f] = builder.add_call<1>(half_add_fn, {var_e, var_c});
+  builder.add_destruct(*var_c);
+  auto [var_g] = builder.add_call<1>(cross_fn, {var_f, var_a});
+  builder.add_destruct({var_a, var_f});
+  auto [var_out] = builder.add_call<1>(add_fn, {var_g, var_e});
+  builder.add_destruct({var_e, var_g});
+  builder.add_return();
+  builder.add_output_parameter(*var_out);
+
+  EXPECT_TRUE(procedure.validate());
+
+  Array<float3> a(ELEMENTS_NUM);
+  Array<float3> b(ELEMENTS_NUM);
+  for (const int64_t i : IndexRange(ELEMENTS_NUM)) {
+    a[i] = float3(i % 17, i % 5, 1.0f);
+    b[i] = float3(1.0f, i % 3, i % 11);
+  }
+  Array<float3> out_full(ELEMENTS_NUM);
+  Array<float3> out_chunked(ELEMENTS_NUM);
+
+  const ProcedureExecutor full_fn{procedure, 0};
+  const ProcedureExecutor chunked_fn{procedure};
+
+  execute_procedure("full single-threaded", full_fn, a, b, out_full, false);
+  execute_procedure("chunked single-threaded", chunked_fn, a, b, out_chunked, false);
+  execute_procedure("full multi-threaded", full_fn, a, b, out_full, true);
+  execute_procedure("chunked multi-threaded", chunked_fn, a, b, out_chunked, true);
+
+  EXPECT_EQ(out_full.as_span(), out_chunked.as_span());
+}
+
+/**
+ * Build the procedure of a field that offsets positions along the direction from a center, with a
+ * falloff based on the distance, like the math nodes of a typical "displace" node tree:
+ *
+ * procedure(float3 position, float3 *out) {
+ *   float3 offset = position * 2 + (0, 0, 1);
+ *   float3 direction = normalize(offset - (1, 1, 1));
+ *   float distance = length(position - (1, 1, 1));
+ *   float factor = clamp(map_range(distance, 0, 10, 1, 0), 0, 1);
+ *   out = direction * factor + position;
+ * }
+ *
+ * The calls are added in the same order as when building the procedure of a field, i.e. depth
+ * first with the constants right before the call that uses them.
+ */
+static void build_displace_procedure(Procedure &procedure, const bool use_fusion)
+{
+  static auto scale_fn = build::SI2_SO<float3, float, float3>(
+      "Scale", [](const float3 &a, const float b) { return a * b; });
+  static auto add_fn = build::SI2_SO<float3, float3, float3>(
+      "Add", [](const float3 &a, const float3 &b) { return a + b; });
+  static auto subtract_fn = build::SI2_SO<float3, float3, float3>(
+      "Subtract", [](const float3 &a, const float3 &b) { return a - b; });
+  static auto normalize_fn = build::SI1_SO<float3, float3>(
+      "Normalize", [](const float3 &a) { return math::normalize(a); });
+  static auto length_fn = build::SI1_SO<float3, float>(
+      "Length", [](const float3 &a) { return math::length(a); });
+  auto map_range = [](float value, float from_min, float from_max, float to_min, float to_max) {
+    const float factor = math::safe_divide(value - from_min, from_max - from_min);
+    return to_min + factor * (to_max - to_min);
+  };
+  auto clamp = [](float value, float min, float max) { return std::min(std::max(value, min), max); };
+  static auto map_range_fn = build::SI5_SO<float, float, float, float, float, float>(
+      "Map Range", map_range, build::exec_presets::SomeSpanOrSingle<0>());
+  static auto clamp_fn = build::SI3_SO<float, float, float, float>("Clamp", clamp);
+
+  if (use_fusion) {
+    static auto scale_add_fn = build::fused_SO<0, float3>(
+        "Scale Add",
+        TypeSequence<float3, float>(),
+        TypeSequence<float3>(),
+        [](const float3 &a, const float b) { return a * b; },
+        [](const float3 &a, const float3 &b) { return a + b; });
+    static auto subtract_normalize_fn = build::fused_SO<0, float3>(
+        "Subtract Normalize",
+        TypeSequence<float3, float3>(),
+        TypeSequence<>(),
+        [](const float3 &a, const float3 &b) { return a - b; },
+        [](const float3 &a) { return math::normalize(a); });
+    static auto subtract_length_fn = build::fused_SO<0, float>(
+        "Subtract Length",
+        TypeSequence<float3, float3>(),
+        TypeSequence<>(),
+        [](const float3 &a, const float3 &b) { return a - b; },
+        [](const float3 &a) { return math::length(a); });
+    static auto map_range_clamp_fn = build::fused_SO<0, float>(
+        "Map Range Clamp",
+        TypeSequence<float, float, float, float, float>(),
+        TypeSequence<float, float>(),
+        map_range,
+        clamp,
+        build::exec_presets::SomeSpanOrSingle<0>());
+    register_fused_function(scale_fn, add_fn, 0, scale_add_fn);
+    register_fused_function(subtract_fn, normalize_fn, 0, subtract_normalize_fn);
+    register_fused_function(subtract_fn, length_fn, 0, subtract_length_fn);
+    register_fused_function(map_range_fn, clamp_fn, 0, map_range_clamp_fn);
+  }
+
+  ProcedureBuilder builder{procedure};
+  Vector<Variable *> variables;
+  auto add_constant = [&](const auto value) {
+    using T = std::decay_t<decltype(value)>;
+    Variable *variable = builder.add_call<1>(procedure.construct_function<CustomMF_Constant<T>>(
+        value))[0];
+    variables.append(variable);
+    return variable;
+  };
+  auto add_call = [&](const MultiFunction &fn, const Span<Variable *> inputs) {
+    Variable *variable = builder.add_call<1>(fn, inputs)[0];
+    variables.append(variable);
+    return variable;
+  };
+
+  Variable *position = &builder.add_single_input_parameter<float3>();
+  Variable *scaled = add_call(scale_fn, {position, add_constant(2.0f)});
+  Variable *offset = add_call(add_fn, {scaled, add_constant(float3(0, 0, 1))});
+  Variable *offset_to_center = add_call(subtract_fn, {offset, add_constant(float3(1))});
+  Variable *direction = add_call(normalize_fn, {offset_to_center});
+  Variable *position_to_center = add_call(subtract_fn, {position, add_constant(float3(1))});
+  Variable *distance = add_call(length_fn, {position_to_center});
+  Variable *mapped = add_call(map_range_fn,
+                              {distance,
+                               add_constant(0.0f),
+                               add_constant(10.0f),
+                               add_constant(1.0f),
+                               add_constant(0.0f)});
+  Variable *factor = add_call(clamp_fn, {mapped, add_constant(0.0f), add_constant(1.0f)});
+  Variable *displacement = add_call(scale_fn, {direction, factor});
+  Variable *out = builder.add_call<1>(add_fn, {displacement, position})[0];
+  builder.add_destruct(*position);
+  builder.add_destruct(variables);
+  ReturnInstruction &return_instr = builder.add_return();
+  builder.add_output_parameter(*out);
+
+  if (use_fusion) {
+    procedure_optimization::fuse_calls(procedure, return_instr);
+  }
+  procedure_optimization::move_destructs_up(procedure, return_instr);
+}
+
+TEST(multi_function_procedure_performance, FusedMathChain)
+{
+  Procedure procedure;
+  build_displace_procedure(procedure, false);
+  EXPECT_TRUE(procedure.validate());
+  Procedure fused_procedure;
+  build_displace_procedure(fused_procedure, true);
+  EXPECT_TRUE(fused_procedure.validate());
+
+  Array<float3> positions(ELEMENTS_NUM);
+  for (const int64_t i : IndexRange(ELEMENTS_NUM)) {
+    positions[i] = float3(i % 17, i % 5, i % 11);
+  }
+  Array<float3> out(ELEMENTS_NUM);
+  Array<float3> out_fused(ELEMENTS_NUM);
+
+  const ProcedureExecutor procedure_fn{procedure};
+  const ProcedureExecutor fused_procedure_fn{fused_procedure};
+  const IndexMask mask(ELEMENTS_NUM);
+  for ([[maybe_unused]] const int i : IndexRange(3)) {
+    {
+      ParamsBuilder params{procedure_fn, &mask};
+      params.add_readonly_single_input(positions.as_span());
+      params.add_uninitialized_single_output(out.as_mutable_span());
+      ContextBuilder context;
+      SCOPED_TIMER("separate calls");
+      procedure_fn.call_auto(mask, params, context);
+    }
+    {
+      ParamsBuilder params{fused_procedure_fn, &mask};
+      params.add_readonly_single_input(positions.as_span());
+      params.add_uninitialized_single_output(out_fused.as_mutable_span());
+      ContextBuilder context;
+      SCOPED_TIMER("fused calls");
+      fused_procedure_fn.call_auto(mask, params, context);
+    }
+  }
+
+  EXPECT_EQ(out.as_span(), out_fused.as_span());
+}
+
+}  // namespace blender::fn::multi_function::tests
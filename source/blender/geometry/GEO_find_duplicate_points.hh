@@ -0,0 +1,35 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+#include "BLI_index_mask_fwd.hh"
+#include "BLI_math_vector_types.hh"
+#include "BLI_span.hh"
+
+/** \file
+ * \ingroup geo
+ */
+
+namespace blender::geometry {
+
+/**
+ * Find selected points that are within \a merge_distance of another selected point. The points
+ * are visited in index order, and every point that isn't a duplicate itself marks all points in
+ * range that aren't marked yet as its duplicates. This gives the same results as
+ * #BLI_kdtree_3d_calc_duplicates_fast with `use_index_order`, so they don't depend on the
+ * algorithm that is used internally: large point sets are sorted into a uniform grid, other cases
+ * use a KD-tree.
+ *
+ * \param r_duplicates: Aligned with \a positions, only selected indices are accessed. Points set
+ * to -1 are candidates for merging. Found duplicates are set to the index of the point they are
+ * merged into, and those points are set to their own index.
+ * \return The number of found duplicates.
+ */
+int find_duplicate_points(Span<float3> positions,
+                          const IndexMask &selection,
+                          float merge_distance,
+                          MutableSpan<int> r_duplicates);
+
+}  // namespace blender::geometry
@@ -0,0 +1,384 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup geo
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+
+#include "BLI_array.hh"
+#include "BLI_bounds.hh"
+#include "BLI_index_mask.hh"
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.hh"
+#include "BLI_task.hh"
+#include "BLI_utildefines.h"
+
+#include "GEO_find_duplicate_points.hh"
+
+namespace blender::geometry {
+
+/** For fewer points, the grid isn't faster than the KD-tree. */
+static constexpr int64_t grid_min_points = 8192;
+/** The grid resolution is limited, so that the cell coordinates fit into a 64 bit key. */
+static constexpr int grid_max_axis_bits = 21;
+
+static int find_duplicates_kdtree(const Span<float3> positions,
+                                  const IndexMask &selection,
+                                  const float merge_distance,
+                                  MutableSpan<int> r_duplicates)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(selection.size());
+  selection.foreach_index([&](const int i) { BLI_kdtree_3d_insert(tree, i, positions[i]); });
+  BLI_kdtree_3d_balance(tree);
+  const int duplicates_num = BLI_kdtree_3d_calc_duplicates_fast(
+      tree, merge_distance, true, r_duplicates.data());
+  BLI_kdtree_3d_free(tree);
+  return duplicates_num;
+}
+
+/**
+ * A uniform grid with cells that are at least as large as the merge distance, so that all points
+ * in range of a point are in the same or in directly neighboring cells. The cell coordinates are
+ * packed into a key, with the x coordinate in the lowest bits. Sorting by that key keeps the
+ * neighboring cells in x direction next to each other.
+ */
+struct DuplicateGrid {
+  double3 min;
+  double cell_size_inv;
+  int3 resolution;
+  int3 axis_shift;
+  int key_bits;
+
+  uint64_t cell_key(const int3 &cell) const
+  {
+    return uint64_t(cell.x) | (uint64_t(cell.y) << axis_shift.y) |
+           (uint64_t(cell.z) << axis_shift.z);
+  }
+
+  int3 cell_from_key(const uint64_t key) const
+  {
+    return int3(int(key & ((uint64_t(1) << axis_shift.y) - 1)),
+                int((key >> axis_shift.y) & ((uint64_t(1) << (axis_shift.z - axis_shift.y)) - 1)),
+                int(key >> axis_shift.z));
+  }
+
+  uint64_t point_key(const float3 &position) const
+  {
+    int3 cell;
+    for (const int axis : IndexRange(3)) {
+      const double co = (double(position[axis]) - min[axis]) * cell_size_inv;
+      /* Written so that NaN coordinates end up in the first cell, they are never merged anyway. */
+      cell[axis] = co >= 0.0 ? int(std::min(co, double(resolution[axis] - 1))) : 0;
+    }
+    return this->cell_key(cell);
+  }
+};
+
+static int bits_for_values(const int values_num)
+{
+  int bits = 0;
+  while ((int64_t(1) << bits) < values_num) {
+    bits++;
+  }
+  return bits;
+}
+
+/**
+ * The grid is only used when its resolution isn't limited by the key size. Otherwise the cells
+ * may contain many points that are far apart, e.g. when most points are dense but a few are far
+ * away, which is handled better by the KD-tree.
+ */
+static std::optional<DuplicateGrid> try_create_grid(const Span<float3> positions,
+                                                    const IndexMask &selection,
+                                                    const float merge_distance)
+{
+  if (selection.size() < grid_min_points || !(merge_distance > 0.0f)) {
+    return std::nullopt;
+  }
+  const std::optional<Bounds<float3>> bounds = bounds::min_max(selection, positions);
+  if (!bounds) {
+    return std::nullopt;
+  }
+  /* Make the cells slightly larger than the merge distance, so that points in range are never
+   * more than one cell apart because of precision issues. */
+  const double cell_size = double(merge_distance) * (1.0 + 1e-4);
+  DuplicateGrid grid;
+  grid.min = double3(bounds->min);
+  grid.cell_size_inv = 1.0 / cell_size;
+  std::array<int, 3> axis_bits;
+  for (const int axis : IndexRange(3)) {
+    if (!std::isfinite(bounds->min[axis]) || !std::isfinite(bounds->max[axis])) {
+      return std::nullopt;
+    }
+    const double cells_num = std::floor(
+        (double(bounds->max[axis]) - double(bounds->min[axis])) / cell_size + 1.0);
+    if (cells_num > double(int64_t(1) << grid_max_axis_bits)) {
+      return std::nullopt;
+    }
+    grid.resolution[axis] = int(cells_num);
+    axis_bits[axis] = bits_for_values(grid.resolution[axis]);
+  }
+  grid.axis_shift = int3(0, axis_bits[0], axis_bits[0] + axis_bits[1]);
+  grid.key_bits = axis_bits[0] + axis_bits[1] + axis_bits[2];
+  return grid;
+}
+
+/**
+ * Stable parallel LSD radix sort of the keys and their values, only sorting by the lowest
+ * `key_bits` bits. The keys are split into chunks of a fixed size, so that the result doesn't
+ * depend on the number of threads.
+ */
+static void radix_sort(MutableSpan<uint64_t> keys, MutableSpan<int> values, const int key_bits)
+{
+  constexpr int digit_bits = 11;
+  constexpr int buckets_num = 1 << digit_bits;
+  constexpr int64_t chunk_size = 1 << 16;
+  const int64_t size = keys.size();
+  const int64_t chunks_num = (size + chunk_size - 1) / chunk_size;
+  const auto chunk_range = [&](const int64_t chunk) {
+    return IndexRange(chunk * chunk_size, chunk_size).intersect(keys.index_range());
+  };
+
+  Array<uint64_t> keys_buffer(size, NoInitialization());
+  Array<int> values_buffer(size, NoInitialization());
+  MutableSpan<uint64_t> src_keys = keys;
+  MutableSpan<int> src_values = values;
+  MutableSpan<uint64_t> dst_keys = keys_buffer;
+  MutableSpan<int> dst_values = values_buffer;
+
+  /* The number of keys for every digit in every chunk, replaced by the offsets in the result. */
+  Array<int> offsets(chunks_num * buckets_num);
+  for (int shift = 0; shift < key_bits; shift += digit_bits) {
+    const auto digit = [&](const uint64_t key) { return int((key >> shift) & (buckets_num - 1)); };
+    threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange range) {
+      for (const int64_t chunk : range) {
+        MutableSpan<int> chunk_counts = offsets.as_mutable_span().slice(chunk * buckets_num,
+                                                                        buckets_num);
+        chunk_counts.fill(0);
+        for (const uint64_t key : src_keys.slice(chunk_range(chunk))) {
+          chunk_counts[digit(key)]++;
+        }
+      }
+    });
+
+    int offset = 0;
+    bool is_sorted = false;
+    for (const int bucket : IndexRange(buckets_num)) {
+      const int bucket_begin = offset;
+      for (const int64_t chunk : IndexRange(chunks_num)) {
+        const int count = offsets[chunk * buckets_num + bucket];
+        offsets[chunk * buckets_num + bucket] = offset;
+        offset += count;
+      }
+      if (offset - bucket_begin == size) {
+        /* All keys have the same digit, so the order doesn't change. */
+        is_sorted = true;
+        break;
+      }
+    }
+    if (is_sorted) {
+      continue;
+    }
+
+    threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange range) {
+      for (const int64_t chunk : range) {
+        MutableSpan<int> chunk_offsets = offsets.as_mutable_span().slice(chunk * buckets_num,
+                                                                         buckets_num);
+        for (const int64_t i : chunk_range(chunk)) {
+          const int dst_index = chunk_offsets[digit(src_keys[i])]++;
+          dst_keys[dst_index] = src_keys[i];
+          dst_values[dst_index] = src_values[i];
+        }
+      }
+    });
+    std::swap(src_keys, dst_keys);
+    std::swap(src_values, dst_values);
+  }
+
+  if (src_keys.data() != keys.data()) {
+    keys.copy_from(src_keys);
+    values.copy_from(src_values);
+  }
+}
+
+/** The points sorted by their grid cell. */
+struct SortedGridPoints {
+  Array<uint64_t> keys;
+  Array<float3> positions;
+  /** The index of every sorted point in the input positions. */
+  Array<int> indices;
+  /** The position in the sorted arrays for every selected point. */
+  Array<int> sorted_positions;
+};
+
+static SortedGridPoints sort_points(const DuplicateGrid &grid,
+                                    const Span<float3> positions,
+                                    const IndexMask &selection)
+{
+  const int64_t size = selection.size();
+  SortedGridPoints sorted;
+  sorted.keys.reinitialize(size);
+  Array<int> order(size, NoInitialization());
+  selection.foreach_index_optimized<int>(GrainSize(4096), [&](const int i, const int pos) {
+    sorted.keys[pos] = grid.point_key(positions[i]);
+    order[pos] = pos;
+  });
+  radix_sort(sorted.keys, order, grid.key_bits);
+
+  sorted.sorted_positions.reinitialize(size);
+  threading::parallel_for(IndexRange(size), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      sorted.sorted_positions[order[i]] = int(i);
+    }
+  });
+  sorted.indices.reinitialize(size);
+  sorted.positions.reinitialize(size);
+  selection.foreach_index_optimized<int>(GrainSize(4096), [&](const int i, const int pos) {
+    const int sorted_pos = sorted.sorted_positions[pos];
+    sorted.indices[sorted_pos] = i;
+    sorted.positions[sorted_pos] = positions[i];
+  });
+  return sorted;
+}
+
+/**
+ * Find the first index starting at `start` for which the predicate is false, assuming that it's
+ * close to `start`. The search distance is doubled until the index is passed, then a binary
+ * search is done in the last step.
+ */
+template<typename Pred>
+static int64_t gallop_partition_point(const Span<uint64_t> keys, int64_t start, const Pred &pred)
+{
+  if (start >= keys.size() || !pred(keys[start])) {
+    return start;
+  }
+  int64_t step = 1;
+  while (start + step < keys.size() && pred(keys[start + step])) {
+    start += step;
+    step *= 2;
+  }
+  const int64_t end = std::min(start + step, keys.size());
+  return std::partition_point(keys.begin() + start + 1, keys.begin() + end, pred) - keys.begin();
+}
+
+/** Ranges in the sorted points for the rows of three cells in x direction around a cell. */
+using NeighborRanges = std::array<IndexRange, 9>;
+
+/**
+ * Finds the #NeighborRanges for a cell. When it's used for cells with increasing keys, the ranges
+ * only move forward, so the search continues from the previous ranges. That is much faster than
+ * searching in all keys for every cell.
+ */
+class NeighborRangesFinder {
+  std::array<int64_t, 9> begins_ = {};
+  std::array<int64_t, 9> ends_ = {};
+
+ public:
+  NeighborRanges find(const DuplicateGrid &grid, const Span<uint64_t> keys, const uint64_t key)
+  {
+    const int3 cell = grid.cell_from_key(key);
+    const int x_min = std::max(cell.x - 1, 0);
+    const int x_max = std::min(cell.x + 1, grid.resolution.x - 1);
+    NeighborRanges ranges;
+    int row = 0;
+    for (int z = cell.z - 1; z <= cell.z + 1; z++) {
+      for (int y = cell.y - 1; y <= cell.y + 1; y++, row++) {
+        if (y < 0 || y >= grid.resolution.y || z < 0 || z >= grid.resolution.z) {
+          ranges[row] = {};
+          continue;
+        }
+        const uint64_t begin_key = grid.cell_key(int3(x_min, y, z));
+        const uint64_t end_key = grid.cell_key(int3(x_max, y, z));
+        begins_[row] = gallop_partition_point(
+            keys, begins_[row], [&](const uint64_t other) { return other < begin_key; });
+        ends_[row] = gallop_partition_point(keys,
+                                            std::max(ends_[row], begins_[row]),
+                                            [&](const uint64_t other) { return other <= end_key; });
+        ranges[row] = IndexRange::from_begin_end(begins_[row], ends_[row]);
+      }
+    }
+    return ranges;
+  }
+};
+
+static int find_duplicates_grid(const DuplicateGrid &grid,
+                                const Span<float3> positions,
+                                const IndexMask &selection,
+                                const float merge_distance,
+                                MutableSpan<int> r_duplicates)
+{
+  const SortedGridPoints sorted = sort_points(grid, positions, selection);
+  const float merge_distance_sq = merge_distance * merge_distance;
+
+  /* Most points usually don't have any points in range. Those are found in parallel first, so
+   * that only the remaining points have to be processed in index order. */
+  Array<bool> has_neighbors(sorted.keys.size());
+  threading::parallel_for(sorted.keys.index_range(), 2048, [&](const IndexRange range) {
+    NeighborRangesFinder finder;
+    std::optional<uint64_t> ranges_key;
+    NeighborRanges ranges;
+    for (const int64_t i : range) {
+      const uint64_t key = sorted.keys[i];
+      if (ranges_key != key) {
+        ranges = finder.find(grid, sorted.keys, key);
+        ranges_key = key;
+      }
+      const float3 &position = sorted.positions[i];
+      has_neighbors[i] = std::any_of(ranges.begin(), ranges.end(), [&](const IndexRange cells) {
+        return std::any_of(cells.begin(), cells.end(), [&](const int64_t other) {
+          return other != i &&
+                 math::distance_squared(position, sorted.positions[other]) <= merge_distance_sq;
+        });
+      });
+    }
+  });
+
+  int duplicates_num = 0;
+  selection.foreach_index([&](const int i, const int pos) {
+    const int sorted_i = sorted.sorted_positions[pos];
+    if (!has_neighbors[sorted_i] || !ELEM(r_duplicates[i], -1, i)) {
+      return;
+    }
+    const float3 &position = sorted.positions[sorted_i];
+    const int prev_duplicates_num = duplicates_num;
+    NeighborRangesFinder finder;
+    for (const IndexRange cells : finder.find(grid, sorted.keys, sorted.keys[sorted_i])) {
+      for (const int64_t other : cells) {
+        const int other_i = sorted.indices[other];
+        if (other_i != i && r_duplicates[other_i] == -1 &&
+            math::distance_squared(position, sorted.positions[other]) <= merge_distance_sq)
+        {
+          r_duplicates[other_i] = i;
+          duplicates_num++;
+        }
+      }
+    }
+    if (duplicates_num != prev_duplicates_num) {
+      /* Prevent chains of duplicates. */
+      r_duplicates[i] = i;
+    }
+  });
+  return duplicates_num;
+}
+
+int find_duplicate_points(const Span<float3> positions,
+                          const IndexMask &selection,
+                          const float merge_distance,
+                          MutableSpan<int> r_duplicates)
+{
+  BLI_assert(r_duplicates.size() == positions.size());
+  if (const std::optional<DuplicateGrid> grid = try_create_grid(
+          positions, selection, merge_distance))
+  {
+    return find_duplicates_grid(*grid, positions, selection, merge_distance, r_duplicates);
+  }
+  return find_duplicates_kdtree(positions, selection, merge_distance, r_duplicates);
+}
+
+}  // namespace blender::geometry
@@ -360,6 +360,26 @@ struct GatherOffsets {
   int grease_pencil_layer_offset = 0;
 };
 
+/** The number of tasks and output elements that are added for some instances. */
+struct LeafTasksSize {
+  int pointcloud_tasks = 0;
+  int mesh_tasks = 0;
+  int curve_tasks = 0;
+  GatherOffsets offsets;
+};
+
+/**
+ * Preprocessed data about an instance reference that doesn't contain nested instances or other
+ * geometry that needs special handling. All instances of such references can be realized without
+ * recursion, see #gather_realize_tasks_for_leaf_instances.
+ */
+struct LeafReferenceInfo {
+  const PointCloudRealizeInfo *pointcloud_info = nullptr;
+  const MeshRealizeInfo *mesh_info = nullptr;
+  const RealizeCurveInfo *curve_info = nullptr;
+  LeafTasksSize size;
+};
+
 struct GatherTasksInfo {
   /** Static information about all geometries that are joined. */
   const AllPointCloudsInfo &pointclouds;
@@ -529,6 +549,61 @@ static void copy_generic_attributes_to_result(
       });
 }
 
+/**
+ * Copying attributes of a task is only multi-threaded when it has more than 1024 elements. When
+ * the tasks are smaller than that on average, scheduling work for every task and attribute
+ * separately has a large overhead. Then the attributes are copied with
+ * #copy_generic_attributes_for_small_tasks instead.
+ */
+static bool use_small_tasks_attribute_copy(const int64_t tasks_num, const int64_t elements_num)
+{
+  return tasks_num > 1 && elements_num < tasks_num * 1024;
+}
+
+/**
+ * Same as calling #copy_generic_attributes_to_result for every task, but every attribute is
+ * copied for all tasks in a single parallel loop.
+ *
+ * \param get_src_attributes: Returns the attributes of the geometry of a task.
+ * \param get_range: Returns the range of a task in the result for a domain.
+ */
+template<typename TaskT, typename GetSrcAttributesFn, typename GetRangeFn>
+static void copy_generic_attributes_for_small_tasks(
+    const Span<TaskT> tasks,
+    const OrderedAttributes &ordered_attributes,
+    const GetSrcAttributesFn &get_src_attributes,
+    const GetRangeFn &get_range,
+    MutableSpan<GSpanAttributeWriter> dst_attribute_writers)
+{
+  threading::parallel_for(
+      dst_attribute_writers.index_range(), 1, [&](const IndexRange attribute_range) {
+        for (const int attribute_index : attribute_range) {
+          const bke::AttrDomain domain = ordered_attributes.kinds[attribute_index].domain;
+          const GMutableSpan dst_span = dst_attribute_writers[attribute_index].span;
+          const CPPType &cpp_type = dst_span.type();
+          threading::parallel_for(tasks.index_range(), 256, [&](const IndexRange task_range) {
+            for (const int task_index : task_range) {
+              const TaskT &task = tasks[task_index];
+              const IndexRange element_slice = get_range(task, domain);
+              void *dst = dst_span.slice(element_slice).data();
+              const Span<std::optional<GVArraySpan>> src_attributes = get_src_attributes(task);
+              if (src_attributes[attribute_index].has_value()) {
+                cpp_type.copy_construct_n(
+                    src_attributes[attribute_index]->data(), dst, element_slice.size());
+              }
+              else {
+                const void *fallback = task.attribute_fallbacks.array[attribute_index] ==
+                                               nullptr ?
+                                           cpp_type.default_value() :
+                                           task.attribute_fallbacks.array[attribute_index];
+                cpp_type.fill_construct_n(fallback, dst, element_slice.size());
+              }
+            }
+          });
+        }
+      });
+}
+
 static void create_result_ids(const RealizeInstancesOptions &options,
                               const Span<int> stored_ids,
                               const int task_id,
@@ -632,6 +707,222 @@ static void foreach_geometry_in_reference(
   fn(geometry_set, base_transform, id);
 }
 
+static void add_leaf_tasks_size(LeafTasksSize &r_size, const LeafTasksSize &size)
+{
+  r_size.pointcloud_tasks += size.pointcloud_tasks;
+  r_size.mesh_tasks += size.mesh_tasks;
+  r_size.curve_tasks += size.curve_tasks;
+  r_size.offsets.pointcloud_offset += size.offsets.pointcloud_offset;
+  r_size.offsets.mesh_offsets.vertex += size.offsets.mesh_offsets.vertex;
+  r_size.offsets.mesh_offsets.edge += size.offsets.mesh_offsets.edge;
+  r_size.offsets.mesh_offsets.face += size.offsets.mesh_offsets.face;
+  r_size.offsets.mesh_offsets.loop += size.offsets.mesh_offsets.loop;
+  r_size.offsets.curves_offsets.point += size.offsets.curves_offsets.point;
+  r_size.offsets.curves_offsets.curve += size.offsets.curves_offsets.curve;
+  r_size.offsets.curves_offsets.custom_knot += size.offsets.curves_offsets.custom_knot;
+}
+
+/**
+ * Returns information about every reference if none of them contains geometry that has to be
+ * handled by #gather_realize_tasks_recursive, like nested instances.
+ */
+static std::optional<Array<LeafReferenceInfo>> prepare_leaf_references(
+    const GatherTasksInfo &gather_info, const Span<InstanceReference> references)
+{
+  Array<LeafReferenceInfo> leaf_references(references.size());
+  for (const int reference_i : references.index_range()) {
+    bke::GeometrySet geometry_set;
+    references[reference_i].to_geometry_set(geometry_set);
+    LeafReferenceInfo &info = leaf_references[reference_i];
+    for (const bke::GeometryComponent *component : geometry_set.get_components()) {
+      switch (component->type()) {
+        case bke::GeometryComponent::Type::Mesh: {
+          const Mesh *mesh = (*static_cast<const bke::MeshComponent *>(component)).get();
+          if (mesh != nullptr && mesh->verts_num > 0) {
+            const int mesh_index = gather_info.meshes.order.index_of(mesh);
+            info.mesh_info = &gather_info.meshes.realize_info[mesh_index];
+            info.size.mesh_tasks = 1;
+            info.size.offsets.mesh_offsets.vertex = mesh->verts_num;
+            info.size.offsets.mesh_offsets.edge = mesh->edges_num;
+            info.size.offsets.mesh_offsets.loop = mesh->corners_num;
+            info.size.offsets.mesh_offsets.face = mesh->faces_num;
+          }
+          break;
+        }
+        case bke::GeometryComponent::Type::PointCloud: {
+          const PointCloud *pointcloud =
+              (*static_cast<const bke::PointCloudComponent *>(component)).get();
+          if (pointcloud != nullptr && pointcloud->totpoint > 0) {
+            const int pointcloud_index = gather_info.pointclouds.order.index_of(pointcloud);
+            info.pointcloud_info = &gather_info.pointclouds.realize_info[pointcloud_index];
+            info.size.pointcloud_tasks = 1;
+            info.size.offsets.pointcloud_offset = pointcloud->totpoint;
+          }
+          break;
+        }
+        case bke::GeometryComponent::Type::Curve: {
+          const Curves *curves = (*static_cast<const bke::CurveComponent *>(component)).get();
+          if (curves != nullptr && curves->geometry.curve_num > 0) {
+            const int curve_index = gather_info.curves.order.index_of(curves);
+            info.curve_info = &gather_info.curves.realize_info[curve_index];
+            info.size.curve_tasks = 1;
+            info.size.offsets.curves_offsets.point = curves->geometry.point_num;
+            info.size.offsets.curves_offsets.curve = curves->geometry.curve_num;
+            info.size.offsets.curves_offsets.custom_knot = curves->geometry.custom_knot_num;
+          }
+          break;
+        }
+        default: {
+          return std::nullopt;
+        }
+      }
+    }
+  }
+  return leaf_references;
+}
+
+template<typename T> static MutableSpan<T> append_uninitialized(Vector<T> &tasks, const int64_t n)
+{
+  const int64_t old_size = tasks.size();
+  tasks.reserve(old_size + n);
+  /* The tasks are constructed in parallel afterwards. */
+  tasks.increase_size_by_unchecked(n);
+  return tasks.as_mutable_span().drop_front(old_size);
+}
+
+static AttributeFallbacksArray instance_attribute_fallbacks(
+    const AttributeFallbacksArray &base_fallbacks,
+    const Span<std::pair<int, GSpan>> attributes_to_override,
+    const int instance_i)
+{
+  AttributeFallbacksArray fallbacks = base_fallbacks;
+  for (const std::pair<int, GSpan> &pair : attributes_to_override) {
+    fallbacks.array[pair.first] = pair.second[instance_i];
+  }
+  return fallbacks;
+}
+
+/**
+ * Same as calling #gather_realize_tasks_recursive for every instance, but only works when all
+ * references are leaves. Then every instance adds a fixed number of tasks and elements, so the
+ * start indices of all instances are found with a parallel prefix sum and the tasks are created
+ * in parallel. This is much faster when there are many instances of small geometries.
+ *
+ * The instances are processed in blocks of a fixed size, so that the result doesn't depend on
+ * the number of threads.
+ */
+static void gather_realize_tasks_for_leaf_instances(GatherTasksInfo &gather_info,
+                                                    const Instances &instances,
+                                                    const IndexMask &indices,
+                                                    const Span<LeafReferenceInfo> leaf_references,
+                                                    const Span<int> stored_instance_ids,
+                                                    const float4x4 &base_transform,
+                                                    const InstanceContext &base_instance_context)
+{
+  const Span<int> handles = instances.reference_handles();
+  const Span<float4x4> transforms = instances.transforms();
+
+  const Vector<std::pair<int, GSpan>> pointcloud_attributes_to_override =
+      prepare_attribute_fallbacks(gather_info, instances, gather_info.pointclouds.attributes);
+  const Vector<std::pair<int, GSpan>> mesh_attributes_to_override = prepare_attribute_fallbacks(
+      gather_info, instances, gather_info.meshes.attributes);
+  const Vector<std::pair<int, GSpan>> curve_attributes_to_override = prepare_attribute_fallbacks(
+      gather_info, instances, gather_info.curves.attributes);
+
+  constexpr int64_t block_size = 4096;
+  const int64_t blocks_num = divide_ceil_ul(indices.size(), block_size);
+  const auto block_indices = [&](const int64_t block) {
+    const IndexRange range(block * block_size, block_size);
+    return indices.slice(range.intersect(indices.index_range()));
+  };
+
+  /* First pass: count the tasks and elements of every block. */
+  Array<LeafTasksSize> block_offsets(blocks_num + 1);
+  threading::parallel_for(IndexRange(blocks_num), 1, [&](const IndexRange range) {
+    for (const int64_t block : range) {
+      LeafTasksSize size;
+      block_indices(block).foreach_index(
+          [&](const int i) { add_leaf_tasks_size(size, leaf_references[handles[i]].size); });
+      block_offsets[block] = size;
+    }
+  });
+
+  LeafTasksSize offset;
+  offset.pointcloud_tasks = gather_info.r_tasks.pointcloud_tasks.size();
+  offset.mesh_tasks = gather_info.r_tasks.mesh_tasks.size();
+  offset.curve_tasks = gather_info.r_tasks.curve_tasks.size();
+  offset.offsets = gather_info.r_offsets;
+  for (const int64_t block : IndexRange(blocks_num)) {
+    const LeafTasksSize size = block_offsets[block];
+    block_offsets[block] = offset;
+    add_leaf_tasks_size(offset, size);
+  }
+  block_offsets.last() = offset;
+
+  append_uninitialized(gather_info.r_tasks.pointcloud_tasks,
+                       offset.pointcloud_tasks - gather_info.r_tasks.pointcloud_tasks.size());
+  append_uninitialized(gather_info.r_tasks.mesh_tasks,
+                       offset.mesh_tasks - gather_info.r_tasks.mesh_tasks.size());
+  append_uninitialized(gather_info.r_tasks.curve_tasks,
+                       offset.curve_tasks - gather_info.r_tasks.curve_tasks.size());
+  MutableSpan<RealizePointCloudTask> pointcloud_tasks = gather_info.r_tasks.pointcloud_tasks;
+  MutableSpan<RealizeMeshTask> mesh_tasks = gather_info.r_tasks.mesh_tasks;
+  MutableSpan<RealizeCurveTask> curve_tasks = gather_info.r_tasks.curve_tasks;
+
+  /* Second pass: create the tasks at the offsets of every block. */
+  threading::parallel_for(IndexRange(blocks_num), 1, [&](const IndexRange range) {
+    for (const int64_t block : range) {
+      LeafTasksSize block_offset = block_offsets[block];
+      block_indices(block).foreach_index([&](const int i) {
+        const LeafReferenceInfo &reference = leaf_references[handles[i]];
+        const float4x4 transform = base_transform * transforms[i];
+
+        uint32_t local_instance_id = 0;
+        if (gather_info.create_id_attribute_on_any_component) {
+          if (stored_instance_ids.is_empty()) {
+            local_instance_id = uint32_t(i);
+          }
+          else {
+            local_instance_id = uint32_t(stored_instance_ids[i]);
+          }
+        }
+        const uint32_t instance_id = noise::hash(base_instance_context.id, local_instance_id);
+
+        if (reference.pointcloud_info) {
+          new (&pointcloud_tasks[block_offset.pointcloud_tasks]) RealizePointCloudTask{
+              block_offset.offsets.pointcloud_offset,
+              reference.pointcloud_info,
+              transform,
+              instance_attribute_fallbacks(
+                  base_instance_context.pointclouds, pointcloud_attributes_to_override, i),
+              instance_id};
+        }
+        if (reference.mesh_info) {
+          new (&mesh_tasks[block_offset.mesh_tasks])
+              RealizeMeshTask{block_offset.offsets.mesh_offsets,
+                              reference.mesh_info,
+                              transform,
+                              instance_attribute_fallbacks(
+                                  base_instance_context.meshes, mesh_attributes_to_override, i),
+                              instance_id};
+        }
+        if (reference.curve_info) {
+          new (&curve_tasks[block_offset.curve_tasks])
+              RealizeCurveTask{block_offset.offsets.curves_offsets,
+                               reference.curve_info,
+                               transform,
+                               instance_attribute_fallbacks(
+                                   base_instance_context.curves, curve_attributes_to_override, i),
+                               instance_id};
+        }
+        add_leaf_tasks_size(block_offset, reference.size);
+      });
+    }
+  });
+
+  gather_info.r_offsets = block_offsets.last().offsets;
+}
+
 static void gather_realize_tasks_for_instances(GatherTasksInfo &gather_info,
                                                const int current_depth,
                                                const int target_depth,
@@ -651,6 +942,24 @@ static void gather_realize_tasks_for_instances(GatherTasksInfo &gather_info,
     }
   }
 
+  const bool is_top_level = current_depth == 0;
+  /* If at top level, get instance indices from selection field, else use all instances. */
+  const IndexMask indices = is_top_level ? gather_info.selection :
+                                           IndexMask(IndexRange(instances.instances_num()));
+
+  if (const std::optional<Array<LeafReferenceInfo>> leaf_references = prepare_leaf_references(
+          gather_info, references))
+  {
+    gather_realize_tasks_for_leaf_instances(gather_info,
+                                            instances,
+                                            indices,
+                                            *leaf_references,
+                                            stored_instance_ids,
+                                            base_transform,
+                                            base_instance_context);
+    return;
+  }
+
   /* Prepare attribute fallbacks. */
   InstanceContext instance_context = base_instance_context;
   Vector<std::pair<int, GSpan>> pointcloud_attributes_to_override = prepare_attribute_fallbacks(
@@ -664,10 +973,6 @@ static void gather_realize_tasks_for_instances(GatherTasksInfo &gather_info,
   Vector<std::pair<int, GSpan>> instance_attributes_to_override = prepare_attribute_fallbacks(
       gather_info, instances, gather_info.instances_attriubutes);
 
-  const bool is_top_level = current_depth == 0;
-  /* If at top level, get instance indices from selection field, else use all instances. */
-  const IndexMask indices = is_top_level ? gather_info.selection :
-                                           IndexMask(IndexRange(instances.instances_num()));
   indices.foreach_index([&](const int i) {
     /* If at top level, retrieve depth from gather_info, else continue with target_depth. */
     const int child_target_depth = is_top_level ? gather_info.depths[i] : target_depth;
@@ -1220,6 +1525,14 @@ static AllPointCloudsInfo preprocess_pointclouds(const bke::GeometrySet &geometr
   return info;
 }
 
+static IndexRange pointcloud_task_domain_range(const RealizePointCloudTask &task,
+                                              const bke::AttrDomain domain)
+{
+  BLI_assert(domain == bke::AttrDomain::Point);
+  UNUSED_VARS_NDEBUG(domain);
+  return IndexRange(task.start_index, task.pointcloud_info->pointcloud->totpoint);
+}
+
 static void execute_realize_pointcloud_task(
     const RealizeInstancesOptions &options,
     const RealizePointCloudTask &task,
@@ -1249,11 +1562,7 @@ static void execute_realize_pointcloud_task(
       pointcloud_info.attributes,
       task.attribute_fallbacks,
       ordered_attributes,
-      [&](const bke::AttrDomain domain) {
-        BLI_assert(domain == bke::AttrDomain::Point);
-        UNUSED_VARS_NDEBUG(domain);
-        return point_slice;
-      },
+      [&](const bke::AttrDomain domain) { return pointcloud_task_domain_range(task, domain); },
       dst_attribute_writers);
 }
 
@@ -1338,6 +1647,13 @@ static void execute_realize_pointcloud_tasks(const RealizeInstancesOptions &opti
         attribute_id, bke::AttrDomain::Point, data_type));
   }
 
+  /* Generic attributes of small tasks are copied for all tasks at once afterwards. */
+  const bool copy_attributes_per_task = !use_small_tasks_attribute_copy(tasks.size(), tot_points);
+  MutableSpan<GSpanAttributeWriter> task_attribute_writers;
+  if (copy_attributes_per_task) {
+    task_attribute_writers = dst_attribute_writers;
+  }
+
   /* Actually execute all tasks. */
   threading::parallel_for(tasks.index_range(), 100, [&](const IndexRange task_range) {
     for (const int task_index : task_range) {
@@ -1345,12 +1661,22 @@ static void execute_realize_pointcloud_tasks(const RealizeInstancesOptions &opti
       execute_realize_pointcloud_task(options,
                                       task,
                                       ordered_attributes,
-                                      dst_attribute_writers,
+                                      task_attribute_writers,
                                       point_radii.span,
                                       point_ids.span,
                                       positions.span);
     }
   });
+  if (!copy_attributes_per_task) {
+    copy_generic_attributes_for_small_tasks(
+        tasks,
+        ordered_attributes,
+        [](const RealizePointCloudTask &task) {
+          return task.pointcloud_info->attributes.as_span();
+        },
+        pointcloud_task_domain_range,
+        dst_attribute_writers);
+  }
 
   /* Tag modified attributes. */
   for (GSpanAttributeWriter &dst_attribute : dst_attribute_writers) {
@@ -1528,6 +1854,25 @@ static AllMeshesInfo preprocess_meshes(const bke::GeometrySet &geometry_set,
   return info;
 }
 
+static IndexRange mesh_task_domain_range(const RealizeMeshTask &task,
+                                        const bke::AttrDomain domain)
+{
+  const Mesh &mesh = *task.mesh_info->mesh;
+  switch (domain) {
+    case bke::AttrDomain::Point:
+      return IndexRange(task.start_indices.vertex, mesh.verts_num);
+    case bke::AttrDomain::Edge:
+      return IndexRange(task.start_indices.edge, mesh.edges_num);
+    case bke::AttrDomain::Face:
+      return IndexRange(task.start_indices.face, mesh.faces_num);
+    case bke::AttrDomain::Corner:
+      return IndexRange(task.start_indices.loop, mesh.corners_num);
+    default:
+      BLI_assert_unreachable();
+      return IndexRange();
+  }
+}
+
 static void execute_realize_mesh_task(const RealizeInstancesOptions &options,
                                       const RealizeMeshTask &task,
                                       const OrderedAttributes &ordered_attributes,
@@ -1620,19 +1965,7 @@ static void execute_realize_mesh_task(const RealizeInstancesOptions &options,
   }
 
   const auto domain_to_range = [&](const bke::AttrDomain domain) {
-    switch (domain) {
-      case bke::AttrDomain::Point:
-        return dst_vert_range;
-      case bke::AttrDomain::Edge:
-        return dst_edge_range;
-      case bke::AttrDomain::Face:
-        return dst_face_range;
-      case bke::AttrDomain::Corner:
-        return dst_loop_range;
-      default:
-        BLI_assert_unreachable();
-        return IndexRange();
-    }
+    return mesh_task_domain_range(task, domain);
   };
 
   if (all_dst_custom_normals) {
@@ -1800,6 +2133,14 @@ static void execute_realize_mesh_tasks(const RealizeInstancesOptions &options,
       CustomData_set_layer_render(&dst_mesh->corner_data, CD_PROP_FLOAT2, id);
     }
   }
+  /* Generic attributes of small tasks are copied for all tasks at once afterwards. */
+  const bool copy_attributes_per_task = !use_small_tasks_attribute_copy(tasks.size(),
+                                                                        tot_vertices);
+  MutableSpan<GSpanAttributeWriter> task_attribute_writers;
+  if (copy_attributes_per_task) {
+    task_attribute_writers = dst_attribute_writers;
+  }
+
   /* Actually execute all tasks. */
   threading::parallel_for(tasks.index_range(), 100, [&](const IndexRange task_range) {
     for (const int task_index : task_range) {
@@ -1807,7 +2148,7 @@ static void execute_realize_mesh_tasks(const RealizeInstancesOptions &options,
       execute_realize_mesh_task(options,
                                 task,
                                 ordered_attributes,
-                                dst_attribute_writers,
+                                task_attribute_writers,
                                 dst_positions,
                                 dst_edges,
                                 dst_face_offsets,
@@ -1818,6 +2159,14 @@ static void execute_realize_mesh_tasks(const RealizeInstancesOptions &options,
                                 custom_normals);
     }
   });
+  if (!copy_attributes_per_task) {
+    copy_generic_attributes_for_small_tasks(
+        tasks,
+        ordered_attributes,
+        [](const RealizeMeshTask &task) { return task.mesh_info->attributes.as_span(); },
+        mesh_task_domain_range,
+        dst_attribute_writers);
+  }
 
   /* Tag modified attributes. */
   for (GSpanAttributeWriter &dst_attribute : dst_attribute_writers) {
@@ -1954,6 +2303,21 @@ static void initialize_curves_builtin_attribute_defaults(const AllCurvesInfo &al
   }
 }
 
+static IndexRange curve_task_domain_range(const RealizeCurveTask &task,
+                                         const bke::AttrDomain domain)
+{
+  const bke::CurvesGeometry &curves = task.curve_info->curves->geometry.wrap();
+  switch (domain) {
+    case bke::AttrDomain::Point:
+      return IndexRange(task.start_indices.point, curves.points_num());
+    case bke::AttrDomain::Curve:
+      return IndexRange(task.start_indices.curve, curves.curves_num());
+    default:
+      BLI_assert_unreachable();
+      return IndexRange();
+  }
+}
+
 static void execute_realize_curve_task(const RealizeInstancesOptions &options,
                                        const AllCurvesInfo &all_curves_info,
                                        const RealizeCurveTask &task,
@@ -2037,17 +2401,7 @@ static void execute_realize_curve_task(const RealizeInstancesOptions &options,
       curves_info.attributes,
       task.attribute_fallbacks,
       ordered_attributes,
-      [&](const bke::AttrDomain domain) {
-        switch (domain) {
-          case bke::AttrDomain::Point:
-            return IndexRange(task.start_indices.point, curves.points_num());
-          case bke::AttrDomain::Curve:
-            return IndexRange(task.start_indices.curve, curves.curves_num());
-          default:
-            BLI_assert_unreachable();
-            return IndexRange();
-        }
-      },
+      [&](const bke::AttrDomain domain) { return curve_task_domain_range(task, domain); },
       dst_attribute_writers);
 }
 
@@ -2134,6 +2488,13 @@ static void execute_realize_curve_tasks(const RealizeInstancesOptions &options,
         "custom_normal", bke::AttrDomain::Point);
   }
 
+  /* Generic attributes of small tasks are copied for all tasks at once afterwards. */
+  const bool copy_attributes_per_task = !use_small_tasks_attribute_copy(tasks.size(), points_num);
+  MutableSpan<GSpanAttributeWriter> task_attribute_writers;
+  if (copy_attributes_per_task) {
+    task_attribute_writers = dst_attribute_writers;
+  }
+
   /* Actually execute all tasks. */
   threading::parallel_for(tasks.index_range(), 100, [&](const IndexRange task_range) {
     for (const int task_index : task_range) {
@@ -2143,7 +2504,7 @@ static void execute_realize_curve_tasks(const RealizeInstancesOptions &options,
                                  task,
                                  ordered_attributes,
                                  dst_curves,
-                                 dst_attribute_writers,
+                                 task_attribute_writers,
                                  point_ids.span,
                                  handle_left.span,
                                  handle_right.span,
@@ -2151,6 +2512,14 @@ static void execute_realize_curve_tasks(const RealizeInstancesOptions &options,
                                  custom_normal.span);
     }
   });
+  if (!copy_attributes_per_task) {
+    copy_generic_attributes_for_small_tasks(
+        tasks,
+        ordered_attributes,
+        [](const RealizeCurveTask &task) { return task.curve_info->attributes.as_span(); },
+        curve_task_domain_range,
+        dst_attribute_writers);
+  }
 
   /* Type counts have to be updated eagerly. */
   dst_curves.runtime->type_counts.fill(0);
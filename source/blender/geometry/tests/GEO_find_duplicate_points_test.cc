@@ -0,0 +1,96 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "BLI_array.hh"
+#include "BLI_index_mask.hh"
+#include "BLI_kdtree.h"
+#include "BLI_rand.hh"
+
+#include "GEO_find_duplicate_points.hh"
+
+#include "testing/testing.h"
+
+namespace blender::geometry::tests {
+
+static Array<int> find_duplicates_kdtree(const Span<float3> positions,
+                                         const IndexMask &selection,
+                                         const float merge_distance)
+{
+  Array<int> duplicates(positions.size(), -1);
+  KDTree_3d *tree = BLI_kdtree_3d_new(selection.size());
+  selection.foreach_index([&](const int i) { BLI_kdtree_3d_insert(tree, i, positions[i]); });
+  BLI_kdtree_3d_balance(tree);
+  BLI_kdtree_3d_calc_duplicates_fast(tree, merge_distance, true, duplicates.data());
+  BLI_kdtree_3d_free(tree);
+  return duplicates;
+}
+
+/** Points in a unit cube, with clusters of points that are close to each other. */
+static Array<float3> random_clustered_points(const int clusters_num, const uint32_t seed)
+{
+  RandomNumberGenerator rng(seed);
+  Array<float3> positions(clusters_num * 4);
+  for (const int cluster : IndexRange(clusters_num)) {
+    const float3 center(rng.get_float(), rng.get_float(), rng.get_float());
+    for (const int i : IndexRange(4)) {
+      const float3 offset(rng.get_float(), rng.get_float(), rng.get_float());
+      positions[cluster * 4 + i] = center + (offset - 0.5f) * 0.002f;
+    }
+  }
+  return positions;
+}
+
+static void compare_with_kdtree(const Span<float3> positions,
+                                const IndexMask &selection,
+                                const float merge_distance)
+{
+  const Array<int> expected = find_duplicates_kdtree(positions, selection, merge_distance);
+  Array<int> duplicates(positions.size(), -1);
+  const int duplicates_num = find_duplicate_points(
+      positions, selection, merge_distance, duplicates);
+  EXPECT_EQ(expected.as_span(), duplicates.as_span());
+
+  int expected_num = 0;
+  for (const int i : expected.index_range()) {
+    expected_num += !ELEM(expected[i], -1, i);
+  }
+  EXPECT_EQ(duplicates_num, expected_num);
+}
+
+TEST(find_duplicate_points, Small)
+{
+  const Array<float3> positions = {
+      {0, 0, 0}, {1, 0, 0}, {0.05f, 0, 0}, {1, 0.05f, 0}, {0.1f, 0, 0}, {5, 5, 5}};
+  Array<int> duplicates(positions.size(), -1);
+  EXPECT_EQ(find_duplicate_points(positions, positions.index_range(), 0.075f, duplicates), 2);
+  EXPECT_EQ(duplicates.as_span(), Span<int>({0, 1, 0, 1, -1, -1}));
+}
+
+TEST(find_duplicate_points, CompareKDTree)
+{
+  const Array<float3> positions = random_clustered_points(20000, 0);
+  for (const float merge_distance : {0.0005f, 0.001f, 0.01f}) {
+    compare_with_kdtree(positions, positions.index_range(), merge_distance);
+  }
+}
+
+TEST(find_duplicate_points, CompareKDTreeSelection)
+{
+  const Array<float3> positions = random_clustered_points(20000, 1);
+  IndexMaskMemory memory;
+  const IndexMask selection = IndexMask::from_predicate(
+      positions.index_range(), GrainSize(4096), memory, [](const int i) { return i % 3 != 0; });
+  compare_with_kdtree(positions, selection, 0.001f);
+}
+
+TEST(find_duplicate_points, SamePosition)
+{
+  const Array<float3> positions(10000, float3(1.0f));
+  Array<int> duplicates(positions.size(), -1);
+  EXPECT_EQ(find_duplicate_points(positions, positions.index_range(), 0.1f, duplicates), 9999);
+  EXPECT_EQ(duplicates.first(), 0);
+  EXPECT_EQ(duplicates.last(), 0);
+}
+
+}  // namespace blender::geometry::tests
@@ -0,0 +1,165 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include <iostream>
+
+#include "BKE_attribute.hh"
+#include "BKE_idtype.hh"
+#include "BKE_instances.hh"
+#include "BKE_mesh.hh"
+
+#include "BLI_math_matrix.hh"
+#include "BLI_rand.hh"
+#include "BLI_timeit.hh"
+
+#include "GEO_mesh_primitive_cuboid.hh"
+#include "GEO_realize_instances.hh"
+
+#include "testing/testing.h"
+
+#define DO_PERF_TESTS 0
+
+namespace blender::geometry::tests {
+
+class RealizeInstancesTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/**
+ * Instances of a few small tree meshes, scattered on a plane with random rotation and scale.
+ * Every instance has an `id` and a `tree_age` attribute that are propagated to the vertices.
+ */
+static bke::GeometrySet create_forest(const int trees_num, const bool add_unused_instances)
+{
+  auto instances = std::make_unique<bke::Instances>();
+  const int trunk = instances->add_reference(bke::InstanceReference(
+      bke::GeometrySet::from_mesh(create_cuboid_mesh(float3(0.2f, 0.2f, 1.0f), 2, 2, 4))));
+  const int crown = instances->add_reference(bke::InstanceReference(
+      bke::GeometrySet::from_mesh(create_cuboid_mesh(float3(1.0f), 3, 3, 3))));
+  if (add_unused_instances) {
+    /* Nested instances aren't handled by the leaf instances code path. This reference isn't
+     * used, so the result doesn't change. */
+    instances->add_reference(bke::InstanceReference(
+        bke::GeometrySet::from_instances(std::make_unique<bke::Instances>().release())));
+  }
+
+  instances->resize(trees_num);
+  MutableSpan<int> handles = instances->reference_handles_for_write();
+  MutableSpan<float4x4> transforms = instances->transforms_for_write();
+  bke::MutableAttributeAccessor attributes = instances->attributes_for_write();
+  bke::SpanAttributeWriter<int> ids = attributes.lookup_or_add_for_write_only_span<int>(
+      "id", bke::AttrDomain::Instance);
+  bke::SpanAttributeWriter<float> ages = attributes.lookup_or_add_for_write_only_span<float>(
+      "tree_age", bke::AttrDomain::Instance);
+
+  RandomNumberGenerator rng(0);
+  const int row_size = int(std::sqrt(float(trees_num))) + 1;
+  for (const int i : IndexRange(trees_num)) {
+    handles[i] = i % 3 == 0 ? crown : trunk;
+    const float3 location(float(i % row_size), float(i / row_size), 0.0f);
+    const math::AxisAngle rotation(math::AxisSigned::Z_POS, rng.get_float() * 6.0f);
+    transforms[i] = math::from_loc_rot_scale<float4x4>(
+        location, rotation, float3(0.5f + rng.get_float()));
+    ids.span[i] = i * 7;
+    ages.span[i] = rng.get_float() * 100.0f;
+  }
+  ids.finish();
+  ages.finish();
+
+  return bke::GeometrySet::from_instances(instances.release());
+}
+
+TEST_F(RealizeInstancesTest, Forest)
+{
+  const bke::GeometrySet forest = create_forest(1000, false);
+  const bke::Instances &instances = *forest.get_instances();
+  const bke::GeometrySet realized = realize_instances(forest, RealizeInstancesOptions());
+  const Mesh &mesh = *realized.get_mesh();
+
+  const Span<bke::InstanceReference> references = instances.references();
+  const Span<int> handles = instances.reference_handles();
+  const Span<float4x4> transforms = instances.transforms();
+  const VArraySpan<float> ages = *instances.attributes().lookup<float>("tree_age");
+  const Span<float3> positions = mesh.vert_positions();
+  const OffsetIndices<int> faces = mesh.faces();
+  const Span<int> corner_verts = mesh.corner_verts();
+  const VArraySpan<float> vert_ages = *mesh.attributes().lookup<float>("tree_age",
+                                                                       bke::AttrDomain::Point);
+
+  int vert_offset = 0;
+  int face_offset = 0;
+  int corner_offset = 0;
+  for (const int i : handles.index_range()) {
+    const Mesh &src_mesh = *references[handles[i]].geometry_set().get_mesh();
+    const Span<float3> src_positions = src_mesh.vert_positions();
+    for (const int vert : src_positions.index_range()) {
+      EXPECT_V3_NEAR(positions[vert_offset + vert],
+                     math::transform_point(transforms[i], src_positions[vert]),
+                     1e-5f);
+      EXPECT_EQ(vert_ages[vert_offset + vert], ages[i]);
+    }
+    const OffsetIndices<int> src_faces = src_mesh.faces();
+    for (const int face : src_faces.index_range()) {
+      EXPECT_EQ(faces[face_offset + face].start(), corner_offset + src_faces[face].start());
+    }
+    const Span<int> src_corner_verts = src_mesh.corner_verts();
+    for (const int corner : src_corner_verts.index_range()) {
+      EXPECT_EQ(corner_verts[corner_offset + corner], vert_offset + src_corner_verts[corner]);
+    }
+    vert_offset += src_mesh.verts_num;
+    face_offset += src_mesh.faces_num;
+    corner_offset += src_mesh.corners_num;
+  }
+  EXPECT_EQ(mesh.verts_num, vert_offset);
+  EXPECT_EQ(mesh.faces_num, face_offset);
+  EXPECT_EQ(mesh.corners_num, corner_offset);
+}
+
+TEST_F(RealizeInstancesTest, LeafInstancesMatchRecursive)
+{
+  const bke::GeometrySet leaf = realize_instances(create_forest(1000, false),
+                                                  RealizeInstancesOptions());
+  const bke::GeometrySet recursive = realize_instances(create_forest(1000, true),
+                                                       RealizeInstancesOptions());
+  const Mesh &leaf_mesh = *leaf.get_mesh();
+  const Mesh &recursive_mesh = *recursive.get_mesh();
+
+  EXPECT_EQ(leaf_mesh.vert_positions(), recursive_mesh.vert_positions());
+  EXPECT_EQ(leaf_mesh.edges(), recursive_mesh.edges());
+  EXPECT_EQ(leaf_mesh.face_offsets(), recursive_mesh.face_offsets());
+  EXPECT_EQ(leaf_mesh.corner_verts(), recursive_mesh.corner_verts());
+  EXPECT_EQ(leaf_mesh.corner_edges(), recursive_mesh.corner_edges());
+  for (const StringRef name : {"id", "tree_age"}) {
+    const bke::GAttributeReader leaf_attribute = leaf_mesh.attributes().lookup(name);
+    const bke::GAttributeReader recursive_attribute = recursive_mesh.attributes().lookup(name);
+    ASSERT_TRUE(leaf_attribute);
+    ASSERT_TRUE(recursive_attribute);
+    const GVArraySpan leaf_span(*leaf_attribute);
+    const GVArraySpan recursive_span(*recursive_attribute);
+    EXPECT_EQ(leaf_span.size_in_bytes(), recursive_span.size_in_bytes());
+    EXPECT_EQ(memcmp(leaf_span.data(), recursive_span.data(), leaf_span.size_in_bytes()), 0);
+  }
+}
+
+#if DO_PERF_TESTS
+
+TEST_F(RealizeInstancesTest, ForestPerformance)
+{
+  for (const int trees_num : {100'000, 1'000'000, 10'000'000}) {
+    const bke::GeometrySet forest = create_forest(trees_num, false);
+    const timeit::TimePoint start = timeit::Clock::now();
+    const bke::GeometrySet realized = realize_instances(forest, RealizeInstancesOptions());
+    const timeit::Nanoseconds duration = timeit::Clock::now() - start;
+    std::cout << trees_num << " trees: " << double(duration.count()) / 1e6 << " ms, "
+              << realized.get_mesh()->verts_num << " vertices\n";
+  }
+}
+
+#endif
+
+}  // namespace blender::geometry::tests
@@ -258,6 +258,11 @@ class AbstractHierarchyIterator {
    * previous iteration. */
   void set_export_subset(ExportSubset export_subset);
 
+  /* Graph the objects are iterated from. Writers are to query it from the iterator, as it can be
+   * replaced between iterations when frames are evaluated by different graphs. */
+  Depsgraph *depsgraph() const;
+  void set_depsgraph(Depsgraph *depsgraph);
+
   /* Convert the given name to something that is valid for the exported file format.
    * This base implementation is a no-op; override in a concrete subclass. */
   virtual std::string make_valid_name(const std::string &name) const;
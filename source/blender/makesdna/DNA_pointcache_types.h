@@ -118,6 +118,8 @@ typedef struct PointCache {
   struct PTCacheEdit *edit;
   /** Free callback. */
   void (*free_edit)(struct PTCacheEdit *edit);
+  /** Runtime data of #PTCACHE_COMPRESS_ZSTD caches on disk: the parsed index and file mapping. */
+  struct PointCachePackedFile *packed_file;
 } PointCache;
 
 /** #PointCache.flag */
@@ -153,4 +155,6 @@ enum {
   PTCACHE_COMPRESS_NO = 0,
   PTCACHE_COMPRESS_LZO = 1,
   PTCACHE_COMPRESS_LZMA = 2,
+  /** All frames are stored in a single file, compressed with Zstd. */
+  PTCACHE_COMPRESS_ZSTD = 3,
 };
@@ -769,7 +769,14 @@ typedef struct UserDef_Experimental {
   char use_new_volume_nodes;
   char use_shader_node_previews;
   char use_bundle_and_closure_nodes;
-  char _pad[5];
+  char use_autosave_background;
+  char use_depsgraph_relations_cache;
+  char use_depsgraph_priority_scheduling;
+  char use_depsgraph_partial_copy;
+  char use_depsgraph_multi_frame;
+  char use_geometry_nodes_work_stealing;
+  char use_geometry_nodes_memoization;
+  char _pad[6];
 } UserDef_Experimental;
 
 #define USER_EXPERIMENTAL_TEST(userdef, member) \
@@ -976,8 +983,10 @@ typedef struct UserDef {
   /** Maximum number of simulations connection limit for online operations. */
   uint8_t network_connection_limit;
 
-  char _pad14[3];
+  char _pad14[2];
 
+  /** Undo steps further than this from the active one are compressed (0 disables). */
+  uint8_t undo_compress_steps;
   short undosteps;
   int undomemory;
   float gpu_viewport_quality DNA_DEPRECATED;
@@ -1144,6 +1153,19 @@ typedef struct UserDef {
   int sequencer_disk_cache_size_limit;
   short sequencer_disk_cache_flag;
   short sequencer_proxy_setup; /* eUserpref_SeqProxySetup */
+  /** Number of frames prefetched at the same time, zero to use a small default. */
+  short sequencer_prefetch_workers;
+  char _pad_seq[2];
+  /** Memory for frames that are being prefetched (in megabytes), zero to derive from the memory
+   * cache limit. */
+  int sequencer_prefetch_memory_limit;
+
+  /** Directory for evaluated geometry nodes modifiers, can be shared by many Blender instances. */
+  char geometry_nodes_disk_cache_dir[1024];
+  /** Size limit of the geometry nodes disk cache (in gigabytes), zero to use the default. */
+  int geometry_nodes_disk_cache_size_limit;
+  short geometry_nodes_disk_cache_flag; /* eUserpref_GeometryNodesDiskCacheFlag */
+  char _pad_gn_cache[2];
 
   float collection_instance_empty_size;
   char text_flag;
@@ -1626,6 +1648,11 @@ typedef enum eUserpref_DiskCacheCompression {
   USER_SEQ_DISK_CACHE_COMPRESSION_HIGH = 2,
 } eUserpref_DiskCacheCompression;
 
+/** #UserDef.geometry_nodes_disk_cache_flag */
+typedef enum eUserpref_GeometryNodesDiskCacheFlag {
+  USER_GEOMETRY_NODES_DISK_CACHE_ENABLE = (1 << 0),
+} eUserpref_GeometryNodesDiskCacheFlag;
+
 typedef enum eUserpref_SeqProxySetup {
   USER_SEQ_PROXY_SETUP_MANUAL = 0,
   USER_SEQ_PROXY_SETUP_AUTOMATIC = 1,
@@ -19,12 +19,14 @@
 #include "DNA_ID.h"
 #include "DNA_anim_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_windowmanager_types.h"
 
 #include "BLI_dynstr.h"
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_string.h"
+#include "BLI_string_ref.hh"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -2311,6 +2313,81 @@ bool RNA_property_path_from_ID_check(PointerRNA *ptr, PropertyRNA *prop)
   return ret;
 }
 
+/**
+ * Whether structs of this type are only part of the sequencer data when owned by a scene.
+ * Generic types like #CurveMapping and custom properties are used by strips and by the rest of
+ * the scene, for those the path has to be checked.
+ */
+static bool rna_struct_is_sequencer_data(StructRNA *type, bool *r_needs_path_check)
+{
+  *r_needs_path_check = false;
+  for (StructRNA *sequencer_type : {&RNA_SequenceEditor,
+                                    &RNA_StripsTopLevel,
+                                    &RNA_StripsMeta,
+                                    &RNA_SequenceTimelineChannel,
+                                    &RNA_Strip,
+                                    &RNA_StripElement,
+                                    &RNA_RetimingKey,
+                                    &RNA_StripCrop,
+                                    &RNA_StripTransform,
+                                    &RNA_StripProxy,
+                                    &RNA_StripColorBalanceData,
+                                    &RNA_StripModifiers,
+                                    &RNA_StripModifier,
+                                    &RNA_EQCurveMappingData})
+  {
+    if (RNA_struct_is_a(type, sequencer_type)) {
+      return true;
+    }
+  }
+  for (StructRNA *shared_type : {&RNA_CurveMapping,
+                                  &RNA_CurveMap,
+                                  &RNA_CurveMapPoint,
+                                  &RNA_ColorManagedInputColorspaceSettings,
+                                  &RNA_Stereo3dFormat,
+                                  &RNA_PropertyGroup})
+  {
+    if (RNA_struct_is_a(type, shared_type)) {
+      *r_needs_path_check = true;
+      return false;
+    }
+  }
+  return false;
+}
+
+/**
+ * Recalc flags to be tagged in addition to the generic ones when a property of the pointer is
+ * updated.
+ *
+ * With partial copy-on-evaluation the evaluated sequencer strips are only copied again when the
+ * scene is tagged with #ID_RECALC_SEQUENCER_STRIPS, which is not done by the update callbacks of
+ * all the sequencer properties.
+ */
+static IDRecalcFlag rna_property_update_extra_recalc(const PointerRNA *ptr)
+{
+  if (ptr->owner_id == nullptr || GS(ptr->owner_id->name) != ID_SCE ||
+      ptr->data == ptr->owner_id)
+  {
+    return IDRecalcFlag(0);
+  }
+  if (!USER_EXPERIMENTAL_TEST(&U, use_depsgraph_partial_copy)) {
+    return IDRecalcFlag(0);
+  }
+  /* Checking the type is enough for most properties, building the path is slow for strips. */
+  bool needs_path_check;
+  if (rna_struct_is_sequencer_data(ptr->type, &needs_path_check)) {
+    return ID_RECALC_SEQUENCER_STRIPS;
+  }
+  if (!needs_path_check) {
+    return IDRecalcFlag(0);
+  }
+  const std::optional<std::string> path = RNA_path_from_ID_to_struct(ptr);
+  if (path && !blender::StringRef(*path).startswith("sequence_editor")) {
+    return IDRecalcFlag(0);
+  }
+  return ID_RECALC_SEQUENCER_STRIPS;
+}
+
 static void rna_property_update(
     bContext *C, Main *bmain, Scene *scene, PointerRNA *ptr, PropertyRNA *prop)
 {
@@ -2355,11 +2432,13 @@ static void rna_property_update(
     if (ptr->owner_id != nullptr && ((prop->flag & PROP_NO_DEG_UPDATE) == 0)) {
       const short id_type = GS(ptr->owner_id->name);
       if (ID_TYPE_USE_COPY_ON_EVAL(id_type)) {
+        const IDRecalcFlag extra_recalc = rna_property_update_extra_recalc(ptr);
         if (prop->flag & PROP_DEG_SYNC_ONLY) {
-          DEG_id_tag_update(ptr->owner_id, ID_RECALC_SYNC_TO_EVAL);
+          DEG_id_tag_update(ptr->owner_id, ID_RECALC_SYNC_TO_EVAL | extra_recalc);
         }
         else {
-          DEG_id_tag_update(ptr->owner_id, ID_RECALC_SYNC_TO_EVAL | ID_RECALC_PARAMETERS);
+          DEG_id_tag_update(ptr->owner_id,
+                            ID_RECALC_SYNC_TO_EVAL | ID_RECALC_PARAMETERS | extra_recalc);
         }
       }
     }
@@ -2381,7 +2460,8 @@ static void rna_property_update(
      * keep this exception because it happens to be useful for driving settings.
      * Python developers on the other hand will need to manually 'update_tag', see: #74000. */
     DEG_id_tag_update(ptr->owner_id,
-                      ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY | ID_RECALC_PARAMETERS);
+                      ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY | ID_RECALC_PARAMETERS |
+                          rna_property_update_extra_recalc(ptr));
 
     /* When updating an ID pointer property, tag depsgraph for update. */
     if (prop->type == PROP_POINTER && RNA_struct_is_ID(RNA_property_pointer_type(ptr, prop))) {
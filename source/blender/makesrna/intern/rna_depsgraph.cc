@@ -297,6 +297,26 @@ static void rna_Depsgraph_debug_stats(Depsgraph *depsgraph, char *result)
                outer);
 }
 
+static float rna_Depsgraph_debug_thread_utilization(Depsgraph *depsgraph)
+{
+  return DEG_stats_thread_utilization(depsgraph);
+}
+
+static void rna_Depsgraph_debug_trace_enable(bool enable)
+{
+  DEG_trace_enable(enable);
+}
+
+static void rna_Depsgraph_debug_trace_clear()
+{
+  DEG_trace_clear();
+}
+
+static bool rna_Depsgraph_debug_trace_export(const char *filepath)
+{
+  return DEG_trace_export(filepath);
+}
+
 static void rna_Depsgraph_update(Depsgraph *depsgraph, Main *bmain, ReportList *reports)
 {
   if (DEG_is_evaluating(depsgraph)) {
@@ -740,6 +760,36 @@ static void rna_def_depsgraph(BlenderRNA *brna)
       parm, PROP_THICK_WRAP, ParameterFlag(0)); /* needed for string return value */
   RNA_def_function_output(func, parm);
 
+  func = RNA_def_function(
+      srna, "debug_thread_utilization", "rna_Depsgraph_debug_thread_utilization");
+  RNA_def_function_ui_description(func,
+                                  "Fraction of the time of all threads spent on evaluating "
+                                  "operations during the last evaluation (only measured with "
+                                  "--debug-depsgraph-time)");
+  parm = RNA_def_float_factor(func, "result", 0.0f, 0.0f, 1.0f, "", "", 0.0f, 1.0f);
+  RNA_def_function_return(func, parm);
+
+  func = RNA_def_function(srna, "debug_trace_enable", "rna_Depsgraph_debug_trace_enable");
+  RNA_def_function_ui_description(func,
+                                  "Record a timeline of the evaluation of all dependency graphs, "
+                                  "only the latest events of every thread are kept");
+  RNA_def_function_flag(func, FUNC_NO_SELF);
+  RNA_def_boolean(func, "enable", true, "Enable", "");
+
+  func = RNA_def_function(srna, "debug_trace_clear", "rna_Depsgraph_debug_trace_clear");
+  RNA_def_function_ui_description(func, "Remove all events recorded in the evaluation timeline");
+  RNA_def_function_flag(func, FUNC_NO_SELF);
+
+  func = RNA_def_function(srna, "debug_trace_export", "rna_Depsgraph_debug_trace_export");
+  RNA_def_function_ui_description(
+      func, "Write the evaluation timeline to a file in the Chrome trace event format");
+  RNA_def_function_flag(func, FUNC_NO_SELF);
+  parm = RNA_def_string_file_path(
+      func, "filepath", nullptr, FILE_MAX, "File Name", "Output path for the trace file");
+  RNA_def_parameter_flags(parm, PropertyFlag(0), PARM_REQUIRED);
+  parm = RNA_def_boolean(func, "result", false, "", "Whether the file was written");
+  RNA_def_function_return(func, parm);
+
   /* Updates. */
 
   func = RNA_def_function(srna, "update", "rna_Depsgraph_update");
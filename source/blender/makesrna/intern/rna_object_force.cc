@@ -961,6 +961,13 @@ static void rna_def_pointcache_common(StructRNA *srna)
       {PTCACHE_COMPRESS_NO, "NO", 0, "None", "No compression"},
       {PTCACHE_COMPRESS_LZO, "LIGHT", 0, "Lite", "Fast but not so effective compression"},
       {PTCACHE_COMPRESS_LZMA, "HEAVY", 0, "Heavy", "Effective but slow compression"},
+      {PTCACHE_COMPRESS_ZSTD,
+       "ZSTD",
+       0,
+       "Zstd (Single File)",
+       "Store all frames in a single file, compressed in parallel, with fast access to any "
+       "frame (only used by particles, soft bodies, cloth and rigid bodies, existing disk "
+       "caches have to be baked again)"},
       {0, nullptr, 0, nullptr, nullptr},
   };
 
@@ -914,6 +914,20 @@ static void rna_Userdef_disk_cache_dir_update(Main * /*bmain*/,
   USERDEF_TAG_DIRTY;
 }
 
+static void rna_Userdef_geometry_nodes_disk_cache_dir_update(Main * /*bmain*/,
+                                                             Scene * /*scene*/,
+                                                             PointerRNA * /*ptr*/)
+{
+  if (U.geometry_nodes_disk_cache_dir[0] != '\0') {
+    BLI_path_abs(U.geometry_nodes_disk_cache_dir, BKE_main_blendfile_path_from_global());
+    BLI_path_slash_ensure(U.geometry_nodes_disk_cache_dir,
+                          sizeof(U.geometry_nodes_disk_cache_dir));
+    BLI_path_make_safe(U.geometry_nodes_disk_cache_dir);
+  }
+
+  USERDEF_TAG_DIRTY;
+}
+
 static void rna_UserDef_weight_color_update(Main *bmain, Scene *scene, PointerRNA *ptr)
 {
   Object *ob;
@@ -5699,6 +5713,15 @@ static void rna_def_userdef_edit(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Undo Memory Size", "Maximum memory usage in megabytes (0 means unlimited)");
 
+  prop = RNA_def_property(srna, "undo_compress_steps", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, nullptr, "undo_compress_steps");
+  RNA_def_property_range(prop, 0, 255);
+  RNA_def_property_ui_text(prop,
+                           "Undo Compress Steps",
+                           "Compress undo steps further than this number of steps from the "
+                           "current one in the background, to reduce memory usage at the cost of "
+                           "slower undo to these steps (0 disables compression)");
+
   prop = RNA_def_property(srna, "use_global_undo", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, nullptr, "uiflag", USER_GLOBALUNDO);
   RNA_def_property_ui_text(
@@ -6208,6 +6231,33 @@ static void rna_def_userdef_system(BlenderRNA *brna)
   RNA_def_property_ui_text(prop, "Memory Cache Limit", "Memory cache limit (in megabytes)");
   RNA_def_property_update(prop, 0, "rna_Userdef_memcache_update");
 
+  /* Geometry nodes disk cache */
+
+  prop = RNA_def_property(srna, "use_geometry_nodes_disk_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(
+      prop, nullptr, "geometry_nodes_disk_cache_flag", USER_GEOMETRY_NODES_DISK_CACHE_ENABLE);
+  RNA_def_property_ui_text(prop,
+                           "Use Geometry Nodes Disk Cache",
+                           "Store evaluated geometry nodes modifiers on disk, so that identical "
+                           "evaluations in other sessions or on other computers are loaded "
+                           "instead of recomputed");
+
+  prop = RNA_def_property(srna, "geometry_nodes_disk_cache_dir", PROP_STRING, PROP_DIRPATH);
+  RNA_def_property_string_sdna(prop, nullptr, "geometry_nodes_disk_cache_dir");
+  RNA_def_property_update(prop, 0, "rna_Userdef_geometry_nodes_disk_cache_dir_update");
+  RNA_def_property_ui_text(prop,
+                           "Geometry Nodes Disk Cache Directory",
+                           "Directory to store the cache in, it can be a shared network "
+                           "directory");
+
+  prop = RNA_def_property(srna, "geometry_nodes_disk_cache_size_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, nullptr, "geometry_nodes_disk_cache_size_limit");
+  RNA_def_property_range(prop, 0, INT_MAX);
+  RNA_def_property_ui_text(prop,
+                           "Geometry Nodes Disk Cache Limit",
+                           "Disk cache limit (in gigabytes), least recently used entries are "
+                           "removed when it is exceeded");
+
   /* Sequencer disk cache */
 
   prop = RNA_def_property(srna, "use_sequencer_disk_cache", PROP_BOOLEAN, PROP_NONE);
@@ -6233,6 +6283,25 @@ static void rna_def_userdef_system(BlenderRNA *brna)
       "Disk Cache Compression Level",
       "Smaller compression will result in larger files, but less decoding overhead");
 
+  /* Sequencer prefetch */
+
+  prop = RNA_def_property(srna, "sequencer_prefetch_workers", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, nullptr, "sequencer_prefetch_workers");
+  RNA_def_property_range(prop, 0, 64);
+  RNA_def_property_ui_text(
+      prop,
+      "Prefetch Workers",
+      "Number of frames to prefetch at the same time, 0 to prefetch two frames at a time");
+
+  prop = RNA_def_property(srna, "sequencer_prefetch_memory_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, nullptr, "sequencer_prefetch_memory_limit");
+  RNA_def_property_range(prop, 0, max_memory_in_megabytes_int());
+  RNA_def_property_ui_text(prop,
+                           "Prefetch Memory Limit",
+                           "Memory for frames that are being prefetched, limits the number of "
+                           "prefetch workers (in megabytes), 0 to use half of the memory cache "
+                           "limit");
+
   /* Sequencer proxy setup */
 
   prop = RNA_def_property(srna, "sequencer_proxy_setup", PROP_ENUM, PROP_NONE);
@@ -7630,6 +7699,52 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Bundle and Closure Nodes", "Enables bundle and closure nodes in Geometry Nodes");
 
+  prop = RNA_def_property(srna, "use_autosave_background", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Background Auto Save",
+                           "Write auto-save files on a background thread, from a snapshot of the "
+                           "current data taken on the main thread");
+
+  prop = RNA_def_property(srna, "use_depsgraph_relations_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Dependency Graph Relations Cache",
+                           "Reuse dependency graph relations built for the same scene structure, "
+                           "in memory and on disk in the cache directory, instead of building "
+                           "them again after loading a file or updating relations");
+
+  prop = RNA_def_property(srna, "use_depsgraph_priority_scheduling", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Dependency Graph Priority Scheduling",
+                           "Evaluate the dependency graph operations on the longest chain first, "
+                           "using operation timings measured in previous evaluations");
+
+  prop = RNA_def_property(srna, "use_depsgraph_partial_copy", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Sequencer Partial Copy",
+                           "Keep the evaluated sequencer strips when the scene is updated for "
+                           "changes which do not affect the sequencer, instead of copying them "
+                           "again");
+
+  prop = RNA_def_property(srna, "use_depsgraph_multi_frame", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Dependency Graph Multi-Frame Evaluation",
+                           "Evaluate multiple frames concurrently when exporting animation, if "
+                           "no simulation or cache depends on previous frames");
+
+  prop = RNA_def_property(srna, "use_geometry_nodes_work_stealing", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Geometry Nodes Work-Stealing Scheduler",
+                           "Evaluate geometry nodes with a scheduler that has less overhead for "
+                           "node trees with many small nodes. Takes effect when node trees are "
+                           "changed");
+
+  prop = RNA_def_property(srna, "use_geometry_nodes_memoization", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Geometry Nodes Memoization",
+                           "Reuse the outputs of expensive geometry nodes from previous "
+                           "evaluations when their inputs did not change. Cached outputs count "
+                           "towards the memory cache limit");
+
   prop = RNA_def_property(srna, "use_extensions_debug", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_ui_text(
       prop,
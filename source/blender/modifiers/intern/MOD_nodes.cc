@@ -32,11 +32,14 @@
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
 #include "DNA_space_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_view3d_types.h"
 #include "DNA_windowmanager_types.h"
 
 #include "BKE_bake_data_block_map.hh"
+#include "BKE_bake_disk_cache.hh"
 #include "BKE_bake_geometry_nodes_modifier.hh"
+#include "BKE_blender_version.h"
 #include "BKE_compute_contexts.hh"
 #include "BKE_customdata.hh"
 #include "BKE_global.hh"
@@ -70,6 +73,7 @@
 #include "RNA_prototypes.hh"
 
 #include "DEG_depsgraph_build.hh"
+#include "DEG_depsgraph_debug.hh"
 #include "DEG_depsgraph_query.hh"
 #include "DEG_depsgraph_writeback_sync.hh"
 
@@ -84,6 +88,7 @@
 
 #include "NOD_geometry.hh"
 #include "NOD_geometry_nodes_dependencies.hh"
+#include "NOD_geometry_nodes_disk_cache.hh"
 #include "NOD_geometry_nodes_execute.hh"
 #include "NOD_geometry_nodes_gizmos.hh"
 #include "NOD_geometry_nodes_lazy_function.hh"
@@ -1752,6 +1757,155 @@ static void add_data_block_items_writeback(const ModifierEvalContext &ctx,
       });
 }
 
+/**
+ * The evaluated geometry can be stored in the disk cache from `BKE_bake_disk_cache.hh`, so that
+ * other Blender instances, e.g. other render farm jobs, load it instead of evaluating the node
+ * tree again. The cache is only used when the evaluation does not depend on anything that is not
+ * part of the cache key, and when nothing is logged, because loading from the cache skips logging
+ * and side effects.
+ */
+
+static bool disk_cache_is_enabled()
+{
+  return (U.geometry_nodes_disk_cache_flag & USER_GEOMETRY_NODES_DISK_CACHE_ENABLE) &&
+         U.geometry_nodes_disk_cache_dir[0] != '\0';
+}
+
+static int64_t disk_cache_size_limit()
+{
+  /* Zero is used when the preferences were saved before the limit existed. */
+  const int64_t limit_in_gigabytes = U.geometry_nodes_disk_cache_size_limit > 0 ?
+                                         U.geometry_nodes_disk_cache_size_limit :
+                                         100;
+  return limit_in_gigabytes * 1024 * 1024 * 1024;
+}
+
+static bool use_disk_cache(const NodesModifierData &nmd,
+                           const ModifierEvalContext &ctx,
+                           const nodes::GeoNodesSideEffectNodes &side_effect_nodes,
+                           const bke::GeometrySet &geometry)
+{
+  if (!disk_cache_is_enabled()) {
+    return false;
+  }
+  if (logging_enabled(&ctx) || !side_effect_nodes.nodes_by_context.is_empty()) {
+    return false;
+  }
+  const bNodeTree &tree = *nmd.node_group;
+  const nodes::GeometryNodesEvalDependencies *deps =
+      tree.runtime->geometry_nodes_eval_dependencies.get();
+  if (!deps || deps->needs_active_camera || deps->needs_scene_render_params) {
+    return false;
+  }
+  /* Only the names of referenced data-blocks are part of the cache key. That is enough to restore
+   * materials, but e.g. the geometry of other objects can't be taken into account. */
+  for (const ID *id : deps->ids.values()) {
+    if (GS(id->name) != ID_MA) {
+      return false;
+    }
+  }
+  bool only_materials_in_settings = true;
+  IDP_foreach_property(nmd.settings.properties, IDP_TYPE_FILTER_ID, [&](IDProperty *property) {
+    if (const ID *id = IDP_Id(property)) {
+      only_materials_in_settings &= GS(id->name) == ID_MA;
+    }
+  });
+  if (!only_materials_in_settings) {
+    return false;
+  }
+  if (!nodes::node_tree_supports_disk_cache(tree)) {
+    return false;
+  }
+  return bake::disk_cache::geometry_supports_disk_cache(geometry);
+}
+
+static bake::disk_cache::CacheKey compute_disk_cache_key(const NodesModifierData &nmd,
+                                                         const ModifierEvalContext &ctx,
+                                                         const bke::GeometrySet &geometry)
+{
+  /* Increment when the data that is added to the key changes. */
+  constexpr int key_version = 2;
+
+  bake::disk_cache::CacheKeyBuilder builder;
+  builder.add_value(key_version);
+  /* Node implementations may change between versions. */
+  builder.add_value(BLENDER_VERSION);
+  builder.add_value(BLENDER_FILE_SUBVERSION);
+
+  const bNodeTree &tree = *nmd.node_group;
+  nodes::add_node_tree_to_disk_cache_key(tree, builder);
+  nodes::add_properties_to_disk_cache_key(nmd.settings.properties, builder);
+
+  const Scene *scene = DEG_get_input_scene(ctx.depsgraph);
+  builder.add_value(DEG_get_ctime(ctx.depsgraph));
+  builder.add_value(FPS);
+  builder.add_value(DEG_get_mode(ctx.depsgraph));
+  if (tree.runtime->geometry_nodes_eval_dependencies->needs_own_transform) {
+    builder.add_value(ctx.object->object_to_world());
+  }
+
+  builder.add_geometry(geometry);
+  return builder.finish();
+}
+
+/**
+ * Maps data-block references in cached geometry to the evaluated data-blocks with the same name.
+ */
+class DiskCacheDataBlockMap : public bake::BakeDataBlockMap {
+ private:
+  const Depsgraph &depsgraph_;
+
+ public:
+  DiskCacheDataBlockMap(const Depsgraph &depsgraph) : depsgraph_(depsgraph) {}
+
+  ID *lookup_or_remember_missing(const bake::BakeDataBlockID &key) override
+  {
+    ID *id_orig = BKE_libblock_find_name_and_library(
+        DEG_get_bmain(&depsgraph_), key.type, key.id_name.c_str(), key.lib_name.c_str());
+    if (!id_orig) {
+      return nullptr;
+    }
+    return DEG_get_evaluated_id(&depsgraph_, id_orig);
+  }
+
+  void try_add(ID & /*id*/) override {}
+};
+
+static std::optional<bke::GeometrySet> read_from_disk_cache(
+    const ModifierEvalContext &ctx, const bake::disk_cache::CacheKey &key)
+{
+  std::optional<bake::BakeState> state = bake::disk_cache::read(U.geometry_nodes_disk_cache_dir,
+                                                                key);
+  if (!state) {
+    return std::nullopt;
+  }
+  const std::unique_ptr<bake::BakeItem> *item = state->items_by_id.lookup_ptr(0);
+  if (!item) {
+    return std::nullopt;
+  }
+  auto *geometry_item = dynamic_cast<bake::GeometryBakeItem *>(item->get());
+  if (!geometry_item) {
+    return std::nullopt;
+  }
+  DiskCacheDataBlockMap data_block_map{*ctx.depsgraph};
+  bake::GeometryBakeItem::try_restore_data_blocks(geometry_item->geometry, &data_block_map);
+  return std::move(geometry_item->geometry);
+}
+
+static void write_to_disk_cache(const bake::disk_cache::CacheKey &key,
+                                const bke::GeometrySet &geometry)
+{
+  if (!bake::disk_cache::geometry_supports_disk_cache(geometry)) {
+    return;
+  }
+  bke::GeometrySet geometry_to_write = geometry;
+  bake::GeometryBakeItem::prepare_geometry_for_bake(geometry_to_write, nullptr);
+  bake::BakeState state;
+  state.items_by_id.add_new(
+      0, std::make_unique<bake::GeometryBakeItem>(std::move(geometry_to_write)));
+  bake::disk_cache::write(U.geometry_nodes_disk_cache_dir, key, state, disk_cache_size_limit());
+}
+
 static void modifyGeometry(ModifierData *md,
                            const ModifierEvalContext *ctx,
                            bke::GeometrySet &geometry_set)
@@ -1761,6 +1915,7 @@ static void modifyGeometry(ModifierData *md,
   if (nmd->node_group == nullptr) {
     return;
   }
+  deg::TraceScope trace_scope("geometry_nodes", "", md->name);
   NodesModifierData *nmd_orig = reinterpret_cast<NodesModifierData *>(
       BKE_modifier_get_original(ctx->object, &nmd->modifier));
 
@@ -1836,8 +1991,24 @@ static void modifyGeometry(ModifierData *md,
 
   bke::ModifierComputeContext modifier_compute_context{nullptr, nmd->modifier.name};
 
-  geometry_set = nodes::execute_geometry_nodes_on_geometry(
-      tree, properties, modifier_compute_context, call_data, std::move(geometry_set));
+  std::optional<bake::disk_cache::CacheKey> disk_cache_key;
+  if (use_disk_cache(*nmd, *ctx, side_effect_nodes, geometry_set)) {
+    disk_cache_key = compute_disk_cache_key(*nmd, *ctx, geometry_set);
+  }
+  std::optional<bke::GeometrySet> cached_geometry;
+  if (disk_cache_key) {
+    cached_geometry = read_from_disk_cache(*ctx, *disk_cache_key);
+  }
+  if (cached_geometry) {
+    geometry_set = std::move(*cached_geometry);
+  }
+  else {
+    geometry_set = nodes::execute_geometry_nodes_on_geometry(
+        tree, properties, modifier_compute_context, call_data, std::move(geometry_set));
+    if (disk_cache_key) {
+      write_to_disk_cache(*disk_cache_key, geometry_set);
+    }
+  }
 
   if (logging_enabled(ctx)) {
     nmd_orig->runtime->eval_log = std::move(eval_log);
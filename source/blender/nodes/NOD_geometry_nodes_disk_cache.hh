@@ -0,0 +1,40 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup nodes
+ *
+ * Evaluated geometry nodes modifiers can be stored in the disk cache from
+ * `BKE_bake_disk_cache.hh`. The functions here add everything that the evaluation of a node tree
+ * depends on to the cache key. Data-blocks are only identified by their name, so node trees that
+ * depend on the content of data-blocks other than node groups don't support the cache.
+ */
+
+#pragma once
+
+#include "BKE_bake_disk_cache.hh"
+
+struct bNodeTree;
+struct IDProperty;
+
+namespace blender::nodes {
+
+/**
+ * Returns false if the evaluation of the tree may have side effects or depend on data that is not
+ * part of the cache key, e.g. because it contains simulation zones or imports files.
+ */
+bool node_tree_supports_disk_cache(const bNodeTree &tree);
+
+/**
+ * Adds everything in the tree that can change the evaluation result, including the node groups
+ * used by it. Purely visual data like node locations is ignored.
+ */
+void add_node_tree_to_disk_cache_key(const bNodeTree &tree,
+                                     bke::bake::disk_cache::CacheKeyBuilder &builder);
+
+/** Adds the values of the modifier inputs. */
+void add_properties_to_disk_cache_key(const IDProperty *properties,
+                                      bke::bake::disk_cache::CacheKeyBuilder &builder);
+
+}  // namespace blender::nodes
@@ -0,0 +1,75 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup nodes
+ *
+ * Geometry nodes are often re-evaluated when only a small part of their inputs changed, e.g. when
+ * a modifier input is tweaked after an expensive Subdivision Surface node. Memoization allows
+ * reusing the outputs of such nodes from a previous evaluation if their inputs did not change.
+ *
+ * Geometry inputs are not identified by hashing their data, which would often be as expensive as
+ * executing the node. Instead, the implicit sharing info and version of every array is used, the
+ * same way baking detects unchanged data. Data that was not modified keeps its sharing info, so
+ * nodes downstream of memoized nodes can be memoized as well.
+ *
+ * The outputs are stored in the global #memory_cache, so they are freed automatically when the
+ * memory cache limit is reached.
+ */
+
+#pragma once
+
+#include "BLI_function_ref.hh"
+#include "BLI_hash.hh"
+#include "BLI_struct_equality_utils.hh"
+
+#include "FN_lazy_function.hh"
+
+struct bNode;
+struct bNodeTree;
+
+namespace blender::nodes {
+
+/**
+ * Identifies a node independent of the lazy-function graph, which is rebuilt after every change
+ * of the node tree. Cached outputs of a node stay valid when other nodes are edited, as long as
+ * the settings of the node itself did not change.
+ */
+struct MemoizedNodeIdentity {
+  /** Session UID of the node tree, which is the same for the original and evaluated tree. */
+  uint32_t tree_session_uid = 0;
+  int32_t node_id = 0;
+  /** Hash of all node settings that are not passed to the node as inputs. */
+  uint64_t settings_hash = 0;
+
+  uint64_t hash() const
+  {
+    return get_default_hash(tree_session_uid, node_id, settings_hash);
+  }
+
+  BLI_STRUCT_EQUALITY_OPERATORS_3(MemoizedNodeIdentity, tree_session_uid, node_id, settings_hash)
+};
+
+/**
+ * The settings hash contains the node type, the generic `custom1` to `custom4` values, the bytes
+ * of the node storage and the values of the ID properties in `bNode::prop`. Storage that contains
+ * pointers changes with every copy of the tree, which only prevents reusing the outputs. Nodes
+ * with ID properties that reference data-blocks are not memoized at all.
+ */
+MemoizedNodeIdentity memoized_node_identity(const bNodeTree &tree, const bNode &node);
+
+/**
+ * Executes the node with #execute_fn, unless outputs computed from the same inputs are still
+ * cached. In that case, the cached outputs and the warnings of the previous execution are reused.
+ *
+ * \return False if the inputs can't be used to identify the outputs, e.g. because a field is
+ * passed into the node. The caller is expected to execute the node as usual then.
+ */
+bool execute_geometry_node_memoized(const bNode &node,
+                                    const lf::LazyFunction &fn,
+                                    lf::Params &params,
+                                    const lf::Context &context,
+                                    FunctionRef<void(lf::Params &params)> execute_fn);
+
+}  // namespace blender::nodes
@@ -19,6 +19,9 @@ namespace blender::nodes {
 
 void node_math_build_multi_function(NodeMultiFunctionBuilder &builder);
 
+/** The function of the Clamp node in Min Max mode, e.g. to register fused functions with it. */
+const mf::MultiFunction &get_clamp_min_max_multi_function();
+
 struct FloatMathOperationInfo {
   StringRefNull title_case_name;
   StringRefNull shader_name;
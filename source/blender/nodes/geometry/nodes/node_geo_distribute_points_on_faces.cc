@@ -2,7 +2,7 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 
-#include "BLI_kdtree.h"
+#include "BLI_kdtree.hh"
 #include "BLI_math_geom.h"
 #include "BLI_math_quaternion.hh"
 #include "BLI_math_rotation.h"
@@ -150,20 +150,6 @@ static void sample_mesh_surface(const Mesh &mesh,
   }
 }
 
-BLI_NOINLINE static KDTree_3d *build_kdtree(Span<float3> positions)
-{
-  KDTree_3d *kdtree = BLI_kdtree_3d_new(positions.size());
-
-  int i_point = 0;
-  for (const float3 position : positions) {
-    BLI_kdtree_3d_insert(kdtree, i_point, position);
-    i_point++;
-  }
-
-  BLI_kdtree_3d_balance(kdtree);
-  return kdtree;
-}
-
 BLI_NOINLINE static void update_elimination_mask_for_close_points(
     Span<float3> positions, const float minimum_distance, MutableSpan<bool> elimination_mask)
 {
@@ -171,31 +157,20 @@ BLI_NOINLINE static void update_elimination_mask_for_close_points(
     return;
   }
 
-  KDTree_3d *kdtree = build_kdtree(positions);
-  BLI_SCOPED_DEFER([&]() { BLI_kdtree_3d_free(kdtree); });
+  const kdtree::KDTree tree(positions);
 
   for (const int i : positions.index_range()) {
     if (elimination_mask[i]) {
       continue;
     }
-
-    struct CallbackData {
-      int index;
-      MutableSpan<bool> elimination_mask;
-    } callback_data = {i, elimination_mask};
-
-    BLI_kdtree_3d_range_search_cb(
-        kdtree,
+    tree.foreach_in_radius(
         positions[i],
         minimum_distance,
-        [](void *user_data, int index, const float * /*co*/, float /*dist_sq*/) {
-          CallbackData &callback_data = *static_cast<CallbackData *>(user_data);
-          if (index != callback_data.index) {
-            callback_data.elimination_mask[index] = true;
+        [&](const int index, const float3 & /*co*/, const float /*distance_sq*/) {
+          if (index != i) {
+            elimination_mask[index] = true;
           }
-          return true;
-        },
-        &callback_data);
+        });
   }
 }
 
@@ -616,6 +591,7 @@ static void node_register()
   blender::bke::node_type_size(ntype, 170, 100, 320);
   ntype.declare = node_declare;
   ntype.geometry_node_execute = node_geo_exec;
+  ntype.geometry_node_supports_memoization = true;
   ntype.draw_buttons = node_layout;
   ntype.draw_buttons_ex = node_layout_ex;
   blender::bke::node_register_type(ntype);
@@ -3,7 +3,7 @@
  * SPDX-License-Identifier: GPL-2.0-or-later */
 
 #include "BLI_array.hh"
-#include "BLI_kdtree.h"
+#include "BLI_kdtree.hh"
 #include "BLI_map.hh"
 #include "BLI_task.hh"
 
@@ -21,33 +21,14 @@ static void node_declare(NodeDeclarationBuilder &b)
   b.add_output<decl::Bool>("Has Neighbor").field_source_reference_all();
 }
 
-static KDTree_3d *build_kdtree(const Span<float3> positions, const IndexMask &mask)
-{
-  KDTree_3d *tree = BLI_kdtree_3d_new(mask.size());
-  mask.foreach_index(
-      [&](const int index) { BLI_kdtree_3d_insert(tree, index, positions[index]); });
-  BLI_kdtree_3d_balance(tree);
-  return tree;
-}
-
-static int find_nearest_non_self(const KDTree_3d &tree, const float3 &position, const int index)
-{
-  return BLI_kdtree_3d_find_nearest_cb_cpp(
-      &tree,
-      position,
-      nullptr,
-      [index](const int other, const float * /*co*/, const float /*dist_sq*/) {
-        return index == other ? 0 : 1;
-      });
-}
-
-static void find_neighbors(const KDTree_3d &tree,
+static void find_neighbors(const kdtree::KDTree &tree,
                            const Span<float3> positions,
                            const IndexMask &mask,
                            MutableSpan<int> r_indices)
 {
   mask.foreach_index(GrainSize(1024), [&](const int index) {
-    r_indices[index] = find_nearest_non_self(tree, positions[index], index);
+    r_indices[index] = tree.find_nearest(
+        positions[index], nullptr, [index](const int other) { return other != index; });
   });
 }
 
@@ -82,9 +63,8 @@ class IndexOfNearestFieldInput final : public bke::GeometryFieldInput {
 
     if (group_ids.is_single()) {
       result.reinitialize(mask.min_array_size());
-      KDTree_3d *tree = build_kdtree(positions, IndexRange(domain_size));
-      find_neighbors(*tree, positions, mask, result);
-      BLI_kdtree_3d_free(tree);
+      const kdtree::KDTree tree(positions);
+      find_neighbors(tree, positions, mask, result);
       return VArray<int>::ForContainer(std::move(result));
     }
     const VArraySpan<int> group_ids_span(group_ids);
@@ -120,9 +100,8 @@ class IndexOfNearestFieldInput final : public bke::GeometryFieldInput {
       for (const int group_index : range) {
         const IndexMask &tree_mask = all_indices_by_group_id[group_index];
         const IndexMask &lookup_mask = lookup_indices_by_group_id[group_index];
-        KDTree_3d *tree = build_kdtree(positions, tree_mask);
-        find_neighbors(*tree, positions, lookup_mask, result);
-        BLI_kdtree_3d_free(tree);
+        const kdtree::KDTree tree(positions, tree_mask);
+        find_neighbors(tree, positions, lookup_mask, result);
       }
     });
 
@@ -174,6 +174,7 @@ static void node_register()
                                   node_copy_standard_storage);
   ntype.declare = node_declare;
   ntype.geometry_node_execute = node_geo_exec;
+  ntype.geometry_node_supports_memoization = true;
   ntype.draw_buttons = node_layout;
   blender::bke::node_register_type(ntype);
 
@@ -164,6 +164,11 @@ class ProximityFunction : public mf::MultiFunction {
                 break;
               case GEO_NODE_PROX_TARGET_FACES:
                 bvh_trees_[group_i].mesh_bvh = bke::bvhtree_from_mesh_tris_init(mesh, group_mask);
+                /* The distance to triangles is expensive to compute, the faster tree reduces the
+                 * number of triangles that are tested. */
+                if (bvh_trees_[group_i].mesh_bvh.tree) {
+                  BLI_bvhtree_ensure_bvh4(bvh_trees_[group_i].mesh_bvh.tree);
+                }
                 break;
             }
           }
@@ -104,23 +104,29 @@ static void raycast_to_mesh(const IndexMask &mask,
   if (tree_data.tree == nullptr) {
     return;
   }
-
-  mask.foreach_index([&](const int i) {
-    const float ray_length = ray_lengths[i];
-    const float3 ray_origin = ray_origins[i];
-    const float3 ray_direction = ray_directions[i];
-
-    BVHTreeRayHit hit;
-    hit.index = -1;
-    hit.dist = ray_length;
-    if (BLI_bvhtree_ray_cast(tree_data.tree,
-                             ray_origin,
-                             ray_direction,
+  /* Usually many rays are cast, so the faster tree is worth building. */
+  BLI_bvhtree_ensure_bvh4(tree_data.tree);
+
+  /* Cast all rays at once, so that the work is distributed over multiple threads. */
+  const VArraySpan<float3> origins = ray_origins;
+  const VArraySpan<float3> directions = ray_directions;
+  Array<BVHTreeRayHit> hits(mask.min_array_size());
+  mask.foreach_index_optimized<int>([&](const int i) {
+    hits[i].index = -1;
+    hits[i].dist = ray_lengths[i];
+  });
+  BLI_bvhtree_ray_cast_batch(*tree_data.tree,
+                             origins,
+                             directions,
                              0.0f,
-                             &hit,
+                             mask,
+                             hits,
                              tree_data.raycast_callback,
-                             &tree_data) != -1)
-    {
+                             &tree_data);
+
+  mask.foreach_index([&](const int i) {
+    const BVHTreeRayHit &hit = hits[i];
+    if (hit.index != -1) {
       if (!r_hit.is_empty()) {
         r_hit[i] = hit.index >= 0;
       }
@@ -152,7 +158,7 @@ static void raycast_to_mesh(const IndexMask &mask,
         r_hit_normals[i] = float3(0.0f, 0.0f, 0.0f);
       }
       if (!r_hit_distances.is_empty()) {
-        r_hit_distances[i] = ray_length;
+        r_hit_distances[i] = ray_lengths[i];
       }
     }
   });
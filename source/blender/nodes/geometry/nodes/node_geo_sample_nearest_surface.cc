@@ -123,6 +123,11 @@ class SampleNearestSurfaceFunction : public mf::MultiFunction {
           for (const int group_i : range) {
             const IndexMask &group_mask = group_masks[group_i];
             bvh_trees_[group_i] = bke::bvhtree_from_mesh_tris_init(mesh, group_mask);
+            /* The distance to triangles is expensive to compute, the faster tree reduces the
+             * number of triangles that are tested. */
+            if (bvh_trees_[group_i].tree) {
+              BLI_bvhtree_ensure_bvh4(bvh_trees_[group_i].tree);
+            }
           }
         },
         threading::individual_task_sizes(
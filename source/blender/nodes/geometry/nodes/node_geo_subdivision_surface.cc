@@ -242,6 +242,7 @@ static void node_register()
   ntype.nclass = NODE_CLASS_GEOMETRY;
   ntype.declare = node_declare;
   ntype.geometry_node_execute = node_geo_exec;
+  ntype.geometry_node_supports_memoization = true;
   ntype.draw_buttons = node_layout;
   ntype.initfunc = node_init;
   bke::node_type_size_preset(ntype, bke::eNodeSizePreset::Middle);
@@ -165,6 +165,7 @@ static void node_register()
   ntype.declare = node_declare;
   ntype.initfunc = geo_triangulate_init;
   ntype.geometry_node_execute = node_geo_exec;
+  ntype.geometry_node_supports_memoization = true;
   ntype.draw_buttons = node_layout;
   blender::bke::node_register_type(ntype);
 
@@ -0,0 +1,375 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup nodes
+ */
+
+#include "NOD_geometry_nodes_disk_cache.hh"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_listbase.h"
+#include "BLI_set.hh"
+
+#include "DNA_ID.h"
+#include "DNA_genfile.h"
+#include "DNA_node_types.h"
+#include "DNA_sdna_types.h"
+
+#include "BKE_idprop.hh"
+#include "BKE_node.hh"
+#include "BKE_node_runtime.hh"
+
+namespace blender::nodes {
+
+using bke::bake::disk_cache::CacheKeyBuilder;
+
+/**
+ * Nodes that have side effects, read files or depend on data that is not passed in explicitly.
+ */
+static bool node_supports_disk_cache(const bNode &node)
+{
+  const StringRef idname = node.idname;
+  return !(idname.startswith("GeometryNodeImport") ||
+           ELEM(idname,
+                "GeometryNodeSimulationInput",
+                "GeometryNodeSimulationOutput",
+                "GeometryNodeBake",
+                "GeometryNodeDeformCurvesOnSurface"));
+}
+
+static bool node_tree_supports_disk_cache_recursive(const bNodeTree &tree,
+                                                    Set<const bNodeTree *> &checked_trees)
+{
+  if (!checked_trees.add(&tree)) {
+    return true;
+  }
+  tree.ensure_topology_cache();
+  if (tree.has_available_link_cycle()) {
+    return false;
+  }
+  for (const bNode *node : tree.all_nodes()) {
+    if (node->is_muted()) {
+      continue;
+    }
+    if (!node_supports_disk_cache(*node)) {
+      return false;
+    }
+  }
+  for (const bNode *node : tree.group_nodes()) {
+    if (!node->id) {
+      continue;
+    }
+    const bNodeTree &group = *reinterpret_cast<const bNodeTree *>(node->id);
+    if (!node_tree_supports_disk_cache_recursive(group, checked_trees)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool node_tree_supports_disk_cache(const bNodeTree &tree)
+{
+  Set<const bNodeTree *> checked_trees;
+  return node_tree_supports_disk_cache_recursive(tree, checked_trees);
+}
+
+/** Node trees and their content are added at most once per key. */
+struct TreeKeyBuilder {
+  CacheKeyBuilder &builder;
+  Set<const bNodeTree *> added_trees;
+};
+
+static void add_node_tree(const bNodeTree &tree, TreeKeyBuilder &tree_builder);
+
+static void add_id(const ID *id, TreeKeyBuilder &tree_builder)
+{
+  CacheKeyBuilder &builder = tree_builder.builder;
+  builder.add_value(id != nullptr);
+  if (!id) {
+    return;
+  }
+  if (GS(id->name) == ID_NT) {
+    add_node_tree(*reinterpret_cast<const bNodeTree *>(id), tree_builder);
+    return;
+  }
+  builder.add_string(id->name);
+  builder.add_string(id->lib ? id->lib->id.name : "");
+}
+
+static void add_string(const char *str, CacheKeyBuilder &builder)
+{
+  builder.add_string(str ? str : "");
+}
+
+/**
+ * Adds all members of a DNA struct except for pointers, which are different in every session.
+ * Data behind pointers, like the items of zones, is exposed through the sockets of the node.
+ */
+static void add_dna_struct(const SDNA &sdna,
+                           const int struct_index,
+                           const void *data,
+                           CacheKeyBuilder &builder)
+{
+  const SDNA_Struct &struct_info = *sdna.structs[struct_index];
+  const char *member_data = static_cast<const char *>(data);
+  for (const SDNA_StructMember &member : Span(struct_info.members, struct_info.members_num)) {
+    const char *member_name = sdna.members[member.member_index];
+    const int member_size = DNA_struct_member_size(&sdna, member.type_index, member.member_index);
+    const bool is_pointer = member_name[0] == '*' || member_name[0] == '(';
+    if (!is_pointer) {
+      const int member_struct_index = DNA_struct_find_index_without_alias(
+          &sdna, sdna.types[member.type_index]);
+      if (member_struct_index == -1) {
+        builder.add_bytes(member_data, member_size);
+      }
+      else {
+        const int type_size = sdna.types_size[member.type_index];
+        for (const int i : IndexRange(sdna.members_array_num[member.member_index])) {
+          add_dna_struct(sdna, member_struct_index, member_data + i * type_size, builder);
+        }
+      }
+    }
+    member_data += member_size;
+  }
+}
+
+static void add_node_storage(const bNode &node, CacheKeyBuilder &builder)
+{
+  builder.add_value(node.storage != nullptr);
+  if (!node.storage) {
+    return;
+  }
+  const SDNA &sdna = *DNA_sdna_current_get();
+  const int struct_index = DNA_struct_find_index_without_alias(
+      &sdna, node.typeinfo->storagename.c_str());
+  if (struct_index == -1) {
+    /* Geometry nodes always use DNA structs as storage, but fall back to the raw bytes. */
+    builder.add_bytes(node.storage, int64_t(MEM_allocN_len(node.storage)));
+    return;
+  }
+  add_dna_struct(sdna, struct_index, node.storage, builder);
+}
+
+static void add_socket_default_value(const bNodeSocket &socket, TreeKeyBuilder &tree_builder)
+{
+  CacheKeyBuilder &builder = tree_builder.builder;
+  if (socket.default_value == nullptr) {
+    return;
+  }
+  switch (eNodeSocketDatatype(socket.type)) {
+    case SOCK_FLOAT:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueFloat>()->value);
+      break;
+    case SOCK_VECTOR:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueVector>()->value);
+      break;
+    case SOCK_RGBA:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueRGBA>()->value);
+      break;
+    case SOCK_BOOLEAN:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueBoolean>()->value);
+      break;
+    case SOCK_INT:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueInt>()->value);
+      break;
+    case SOCK_STRING:
+      builder.add_string(socket.default_value_typed<bNodeSocketValueString>()->value);
+      break;
+    case SOCK_ROTATION:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueRotation>()->value_euler);
+      break;
+    case SOCK_MENU:
+      builder.add_value(socket.default_value_typed<bNodeSocketValueMenu>()->value);
+      break;
+    case SOCK_OBJECT:
+      add_id(reinterpret_cast<const ID *>(
+                 socket.default_value_typed<bNodeSocketValueObject>()->value),
+             tree_builder);
+      break;
+    case SOCK_IMAGE:
+      add_id(reinterpret_cast<const ID *>(
+                 socket.default_value_typed<bNodeSocketValueImage>()->value),
+             tree_builder);
+      break;
+    case SOCK_COLLECTION:
+      add_id(reinterpret_cast<const ID *>(
+                 socket.default_value_typed<bNodeSocketValueCollection>()->value),
+             tree_builder);
+      break;
+    case SOCK_TEXTURE:
+      add_id(reinterpret_cast<const ID *>(
+                 socket.default_value_typed<bNodeSocketValueTexture>()->value),
+             tree_builder);
+      break;
+    case SOCK_MATERIAL:
+      add_id(reinterpret_cast<const ID *>(
+                 socket.default_value_typed<bNodeSocketValueMaterial>()->value),
+             tree_builder);
+      break;
+    case SOCK_MATRIX:
+    case SOCK_CUSTOM:
+    case SOCK_SHADER:
+    case SOCK_GEOMETRY:
+    case SOCK_BUNDLE:
+    case SOCK_CLOSURE:
+      break;
+  }
+}
+
+static void add_socket(const bNodeSocket &socket, TreeKeyBuilder &tree_builder)
+{
+  CacheKeyBuilder &builder = tree_builder.builder;
+  builder.add_string(socket.identifier);
+  /* Names are used by some nodes, e.g. as placeholders in the Format String node. */
+  builder.add_string(socket.name);
+  builder.add_string(socket.idname);
+  builder.add_value(socket.type);
+  builder.add_value(socket.is_available());
+  add_socket_default_value(socket, tree_builder);
+}
+
+static void add_interface_socket(const bNodeTreeInterfaceSocket &socket, CacheKeyBuilder &builder)
+{
+  add_string(socket.identifier, builder);
+  add_string(socket.socket_type, builder);
+  builder.add_value(socket.flag);
+  builder.add_value(socket.attribute_domain);
+  builder.add_value(socket.default_input);
+  add_string(socket.default_attribute_name, builder);
+}
+
+static void add_node_tree(const bNodeTree &tree, TreeKeyBuilder &tree_builder)
+{
+  CacheKeyBuilder &builder = tree_builder.builder;
+  builder.add_string(tree.id.name);
+  builder.add_string(tree.id.lib ? tree.id.lib->id.name : "");
+  if (!tree_builder.added_trees.add(&tree)) {
+    return;
+  }
+  builder.add_string(tree.idname);
+
+  tree.ensure_topology_cache();
+  tree.ensure_interface_cache();
+
+  /* Panels only change the layout of the inputs. */
+  builder.add_value(tree.interface_inputs().size());
+  for (const bNodeTreeInterfaceSocket *socket : tree.interface_inputs()) {
+    add_interface_socket(*socket, builder);
+  }
+  builder.add_value(tree.interface_outputs().size());
+  for (const bNodeTreeInterfaceSocket *socket : tree.interface_outputs()) {
+    add_interface_socket(*socket, builder);
+  }
+
+  /* Purely visual data like the location, size, label and color of nodes is not added. */
+  builder.add_value(tree.all_nodes().size());
+  for (const bNode *node : tree.all_nodes()) {
+    builder.add_value(node->identifier);
+    builder.add_string(node->idname);
+    builder.add_value(node->is_muted());
+    builder.add_value(node->custom1);
+    builder.add_value(node->custom2);
+    builder.add_value(node->custom3);
+    builder.add_value(node->custom4);
+    add_node_storage(*node, builder);
+    add_id(node->id, tree_builder);
+    builder.add_value(node->input_sockets().size());
+    for (const bNodeSocket *socket : node->input_sockets()) {
+      add_socket(*socket, tree_builder);
+    }
+    builder.add_value(node->output_sockets().size());
+    for (const bNodeSocket *socket : node->output_sockets()) {
+      builder.add_string(socket->identifier);
+      builder.add_value(socket->type);
+      builder.add_value(socket->is_available());
+    }
+  }
+
+  builder.add_value(tree.all_links().size());
+  for (const bNodeLink *link : tree.all_links()) {
+    builder.add_value(link->fromnode->identifier);
+    builder.add_string(link->fromsock->identifier);
+    builder.add_value(link->tonode->identifier);
+    builder.add_string(link->tosock->identifier);
+    builder.add_value(link->is_muted());
+    builder.add_value(link->is_available());
+    builder.add_value(link->multi_input_sort_id);
+  }
+}
+
+void add_node_tree_to_disk_cache_key(const bNodeTree &tree, CacheKeyBuilder &builder)
+{
+  TreeKeyBuilder tree_builder{builder};
+  add_node_tree(tree, tree_builder);
+}
+
+static void add_id_property(const IDProperty &prop, CacheKeyBuilder &builder)
+{
+  builder.add_string(prop.name);
+  builder.add_value(prop.type);
+  switch (eIDPropertyType(prop.type)) {
+    case IDP_STRING:
+      builder.add_string(IDP_String(&prop));
+      break;
+    case IDP_INT:
+    case IDP_BOOLEAN:
+      builder.add_value(IDP_Int(&prop));
+      break;
+    case IDP_FLOAT:
+      builder.add_value(IDP_Float(&prop));
+      break;
+    case IDP_DOUBLE:
+      builder.add_value(IDP_Double(&prop));
+      break;
+    case IDP_ARRAY: {
+      builder.add_value(prop.subtype);
+      builder.add_value(prop.len);
+      switch (eIDPropertyType(prop.subtype)) {
+        case IDP_INT:
+          builder.add_bytes(IDP_Array(&prop), sizeof(int) * prop.len);
+          break;
+        case IDP_FLOAT:
+          builder.add_bytes(IDP_Array(&prop), sizeof(float) * prop.len);
+          break;
+        case IDP_DOUBLE:
+          builder.add_bytes(IDP_Array(&prop), sizeof(double) * prop.len);
+          break;
+        case IDP_BOOLEAN:
+          builder.add_bytes(IDP_Array(&prop), sizeof(int8_t) * prop.len);
+          break;
+        default:
+          break;
+      }
+      break;
+    }
+    case IDP_GROUP:
+      LISTBASE_FOREACH (const IDProperty *, child, &prop.data.group) {
+        add_id_property(*child, builder);
+      }
+      break;
+    case IDP_ID:
+      if (const ID *id = IDP_Id(&prop)) {
+        builder.add_string(id->name);
+        builder.add_string(id->lib ? id->lib->id.name : "");
+      }
+      break;
+    case IDP_IDPARRAY:
+      for (const int i : IndexRange(prop.len)) {
+        add_id_property(IDP_IDPArray(&prop)[i], builder);
+      }
+      break;
+  }
+}
+
+void add_properties_to_disk_cache_key(const IDProperty *properties, CacheKeyBuilder &builder)
+{
+  builder.add_value(properties != nullptr);
+  if (properties) {
+    add_id_property(*properties, builder);
+  }
+}
+
+}  // namespace blender::nodes
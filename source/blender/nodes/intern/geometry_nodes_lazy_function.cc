@@ -22,6 +22,7 @@
 
 #include "NOD_geometry_exec.hh"
 #include "NOD_geometry_nodes_lazy_function.hh"
+#include "NOD_geometry_nodes_memoization.hh"
 #include "NOD_multi_function.hh"
 #include "NOD_node_declaration.hh"
 
@@ -33,6 +34,7 @@
 #include "BLI_map.hh"
 
 #include "DNA_ID.h"
+#include "DNA_userdef_types.h"
 
 #include "BKE_anonymous_attribute_make.hh"
 #include "BKE_compute_contexts.hh"
@@ -246,15 +248,25 @@ class LazyFunctionForGeometryNode : public LazyFunction {
       return this->anonymous_attribute_name_for_output(*user_data, i);
     };
 
-    GeoNodeExecParams geo_params{
-        node_,
-        params,
-        context,
-        own_lf_graph_info_.mapping.lf_input_index_for_output_bsocket_usage,
-        own_lf_graph_info_.mapping.lf_input_index_for_reference_set_for_output,
-        get_anonymous_attribute_name};
+    auto execute_node = [&](lf::Params &node_params) {
+      GeoNodeExecParams geo_params{
+          node_,
+          node_params,
+          context,
+          own_lf_graph_info_.mapping.lf_input_index_for_output_bsocket_usage,
+          own_lf_graph_info_.mapping.lf_input_index_for_reference_set_for_output,
+          get_anonymous_attribute_name};
+      node_.typeinfo->geometry_node_execute(geo_params);
+    };
 
-    node_.typeinfo->geometry_node_execute(geo_params);
+    if (node_.typeinfo->geometry_node_supports_memoization &&
+        USER_EXPERIMENTAL_TEST(&U, use_geometry_nodes_memoization))
+    {
+      if (execute_geometry_node_memoized(node_, *this, params, context, execute_node)) {
+        return;
+      }
+    }
+    execute_node(params);
   }
 
   std::string input_name(const int index) const override
@@ -1847,6 +1859,17 @@ class GeometryNodesLazyFunctionSideEffectProvider : public lf::GraphExecutor::Si
   }
 };
 
+/**
+ * The work-stealing scheduler has lower overhead for node trees with many small nodes. The
+ * preference is only checked when the lazy-function graph is built for a node tree.
+ */
+static void init_graph_executor_scheduler(lf::GraphExecutor &graph_executor)
+{
+  if (USER_EXPERIMENTAL_TEST(&U, use_geometry_nodes_work_stealing)) {
+    graph_executor.set_scheduler(lf::GraphExecutor::Scheduler::WorkStealing);
+  }
+}
+
 /**
  * Utility class to build a lazy-function based on a geometry nodes tree.
  * This is mainly a separate class because it makes it easier to have variables that can be
@@ -2103,12 +2126,13 @@ struct GeometryNodesLazyFunctionBuilder {
     auto &logger = scope_.construct<GeometryNodesLazyFunctionLogger>(*lf_graph_info_);
     auto &side_effect_provider = scope_.construct<GeometryNodesLazyFunctionSideEffectProvider>();
 
-    const auto &lf_graph_fn = scope_.construct<lf::GraphExecutor>(lf_graph,
-                                                                  lf_zone_inputs.as_span(),
-                                                                  lf_zone_outputs.as_span(),
-                                                                  &logger,
-                                                                  &side_effect_provider,
-                                                                  nullptr);
+    auto &lf_graph_fn = scope_.construct<lf::GraphExecutor>(lf_graph,
+                                                            lf_zone_inputs.as_span(),
+                                                            lf_zone_outputs.as_span(),
+                                                            &logger,
+                                                            &side_effect_provider,
+                                                            nullptr);
+    init_graph_executor_scheduler(lf_graph_fn);
     const auto &zone_function = scope_.construct<LazyFunctionForSimulationZone>(*zone.output_node,
                                                                                 lf_graph_fn);
     zone_info.lazy_function = &zone_function;
@@ -2256,12 +2280,14 @@ struct GeometryNodesLazyFunctionBuilder {
 
     auto &logger = scope_.construct<GeometryNodesLazyFunctionLogger>(*lf_graph_info_);
 
-    body_fn.function = &scope_.construct<lf::GraphExecutor>(lf_body_graph,
-                                                            lf_body_inputs.as_span(),
-                                                            lf_body_outputs.as_span(),
-                                                            &logger,
-                                                            side_effect_provider,
-                                                            nullptr);
+    auto &lf_body_graph_fn = scope_.construct<lf::GraphExecutor>(lf_body_graph,
+                                                                 lf_body_inputs.as_span(),
+                                                                 lf_body_outputs.as_span(),
+                                                                 &logger,
+                                                                 side_effect_provider,
+                                                                 nullptr);
+    init_graph_executor_scheduler(lf_body_graph_fn);
+    body_fn.function = &lf_body_graph_fn;
 
     lf_graph_info_->debug_zone_body_graphs.add(zone.output_node->identifier, &lf_body_graph);
 
@@ -2451,13 +2477,15 @@ struct GeometryNodesLazyFunctionBuilder {
       local_side_effect_nodes.append(&lf_node);
     }
 
-    function.function = &scope_.construct<lf::GraphExecutor>(
+    auto &lf_graph_fn = scope_.construct<lf::GraphExecutor>(
         lf_graph_info_->graph,
         std::move(lf_graph_inputs),
         std::move(lf_graph_outputs),
         &scope_.construct<GeometryNodesLazyFunctionLogger>(*lf_graph_info_),
         &scope_.construct<GeometryNodesLazyFunctionSideEffectProvider>(local_side_effect_nodes),
         nullptr);
+    init_graph_executor_scheduler(lf_graph_fn);
+    function.function = &lf_graph_fn;
   }
 
   void build_reference_sets_outside_of_zones(
@@ -0,0 +1,725 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup nodes
+ */
+
+#include "MEM_guardedalloc.h"
+
+#include "NOD_geometry_nodes_lazy_function.hh"
+#include "NOD_geometry_nodes_log.hh"
+#include "NOD_geometry_nodes_memoization.hh"
+
+#include "BLI_generic_key.hh"
+#include "BLI_implicit_sharing_ptr.hh"
+#include "BLI_linear_allocator.hh"
+#include "BLI_listbase.h"
+#include "BLI_memory_cache.hh"
+#include "BLI_memory_counter.hh"
+
+#include "DNA_curves_types.h"
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_node_types.h"
+#include "DNA_object_types.h"
+#include "DNA_pointcloud_types.h"
+
+#include "BKE_curves.hh"
+#include "BKE_geometry_nodes_reference_set.hh"
+#include "BKE_geometry_set.hh"
+#include "BKE_idprop.hh"
+#include "BKE_mesh_types.hh"
+#include "BKE_node_socket_value.hh"
+
+#include <cstring>
+#include <xxhash.h>
+
+namespace blender::nodes {
+
+using bke::GeometryComponent;
+using bke::GeometryNodesReferenceSet;
+using bke::GeometrySet;
+using bke::SocketValueVariant;
+using geo_eval_log::GeoTreeLogger;
+using geo_eval_log::NamedAttributeUsage;
+using geo_eval_log::NodeWarning;
+
+/* -------------------------------------------------------------------- */
+/** \name Memoization Key
+ * \{ */
+
+/**
+ * Identifies a node evaluation by the node, its compute context and all its inputs. The inputs are
+ * stored as a flat list of plain values, strings, shared arrays and single socket values. The
+ * structure of the inputs is the same for every evaluation of a node, so there is no need to store
+ * it separately.
+ */
+class GeometryNodeMemoizationKey : public GenericKey {
+ public:
+  MemoizedNodeIdentity node;
+  ComputeContextHash context_hash;
+
+  /** Sizes, data types, flags and array versions. */
+  Vector<uint64_t> numbers;
+  Vector<std::string> strings;
+  /** Arrays are identified by their sharing info, the version is stored in #numbers. */
+  Vector<const ImplicitSharingInfo *> shared_data;
+  /** Copies of single values passed into the node. */
+  Vector<SocketValueVariant> values;
+
+ private:
+  /**
+   * Only filled in the stored key. Keeps the sharing info of the arrays alive so that they can't
+   * be reused for different data while the key exists.
+   */
+  Vector<WeakImplicitSharingPtr> weak_users_;
+
+ public:
+  template<typename T> void add_number(const T &value)
+  {
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(uint64_t));
+    uint64_t number = 0;
+    memcpy(&number, &value, sizeof(T));
+    numbers.append(number);
+  }
+
+  void add_string(const char *str)
+  {
+    this->add_number(str != nullptr);
+    strings.append(str ? str : "");
+  }
+
+  /**
+   * \return False if the array can't be identified without looking at its data.
+   */
+  bool add_shared_array(const void *data, const ImplicitSharingInfo *sharing_info)
+  {
+    if (data == nullptr) {
+      this->add_number(false);
+      return true;
+    }
+    if (sharing_info == nullptr) {
+      return false;
+    }
+    this->add_number(true);
+    this->add_number(sharing_info->version());
+    shared_data.append(sharing_info);
+    return true;
+  }
+
+  uint64_t hash() const override
+  {
+    uint64_t hash = get_default_hash(node, context_hash);
+    for (const uint64_t number : numbers) {
+      hash = get_default_hash(hash, number);
+    }
+    for (const std::string &str : strings) {
+      hash = get_default_hash(hash, str);
+    }
+    for (const ImplicitSharingInfo *sharing_info : shared_data) {
+      hash = get_default_hash(hash, sharing_info);
+    }
+    for (const SocketValueVariant &value : values) {
+      const GPointer value_ptr = value.get_single_ptr();
+      hash = get_default_hash(hash, value_ptr.type()->hash(value_ptr.get()));
+    }
+    return hash;
+  }
+
+  bool equal_to(const GenericKey &other) const override
+  {
+    const auto *other_key = dynamic_cast<const GeometryNodeMemoizationKey *>(&other);
+    if (other_key == nullptr) {
+      return false;
+    }
+    if (node != other_key->node || context_hash != other_key->context_hash) {
+      return false;
+    }
+    if (numbers.as_span() != other_key->numbers.as_span() ||
+        strings.as_span() != other_key->strings.as_span() ||
+        shared_data.as_span() != other_key->shared_data.as_span())
+    {
+      return false;
+    }
+    if (values.size() != other_key->values.size()) {
+      return false;
+    }
+    for (const int i : values.index_range()) {
+      const GPointer a = values[i].get_single_ptr();
+      const GPointer b = other_key->values[i].get_single_ptr();
+      if (a.type() != b.type() || !a.type()->is_equal(a.get(), b.get())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::unique_ptr<GenericKey> to_storable() const override
+  {
+    auto storable_key = std::make_unique<GeometryNodeMemoizationKey>(*this);
+    for (const ImplicitSharingInfo *sharing_info : shared_data) {
+      sharing_info->add_weak_user();
+      storable_key->weak_users_.append(WeakImplicitSharingPtr(sharing_info));
+    }
+    return storable_key;
+  }
+};
+
+static bool add_custom_data_to_key(GeometryNodeMemoizationKey &key,
+                                   const CustomData &custom_data,
+                                   const int size)
+{
+  key.add_number(size);
+  key.add_number(custom_data.totlayer);
+  for (const CustomDataLayer &layer : Span(custom_data.layers, custom_data.totlayer)) {
+    key.add_number(layer.type);
+    key.add_number(layer.flag);
+    key.add_number(layer.active);
+    key.add_number(layer.active_rnd);
+    key.strings.append(layer.name);
+    if (!key.add_shared_array(layer.data, layer.sharing_info)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void add_vertex_group_names_to_key(GeometryNodeMemoizationKey &key,
+                                          const ListBase &vertex_group_names)
+{
+  key.add_number(BLI_listbase_count(&vertex_group_names));
+  LISTBASE_FOREACH (const bDeformGroup *, group, &vertex_group_names) {
+    key.strings.append(group->name);
+  }
+}
+
+static void add_materials_to_key(GeometryNodeMemoizationKey &key,
+                                 const Material *const *materials,
+                                 const int materials_num)
+{
+  key.add_number(materials_num);
+  for (const int i : IndexRange(materials_num)) {
+    /* Pointers of freed materials can be reused, the session UID is unique. */
+    key.add_number(materials[i] ? materials[i]->id.session_uid : 0);
+  }
+}
+
+static bool add_mesh_to_key(GeometryNodeMemoizationKey &key, const Mesh &mesh)
+{
+  if (mesh.runtime->wrapper_type != ME_WRAPPER_TYPE_MDATA) {
+    return false;
+  }
+  if (!add_custom_data_to_key(key, mesh.vert_data, mesh.verts_num) ||
+      !add_custom_data_to_key(key, mesh.edge_data, mesh.edges_num) ||
+      !add_custom_data_to_key(key, mesh.face_data, mesh.faces_num) ||
+      !add_custom_data_to_key(key, mesh.corner_data, mesh.corners_num))
+  {
+    return false;
+  }
+  if (!key.add_shared_array(mesh.face_offset_indices, mesh.runtime->face_offsets_sharing_info)) {
+    return false;
+  }
+  /* Settings that are propagated to meshes created by nodes. */
+  key.add_number(mesh.flag);
+  key.add_number(mesh.editflag);
+  key.add_number(mesh.symmetry);
+  key.add_number(mesh.texspace_flag);
+  for (const int i : IndexRange(3)) {
+    key.add_number(mesh.texspace_location[i]);
+    key.add_number(mesh.texspace_size[i]);
+  }
+  key.add_number(mesh.vertex_group_active_index);
+  key.add_number(mesh.attributes_active_index);
+  key.add_string(mesh.active_color_attribute);
+  key.add_string(mesh.default_color_attribute);
+  add_vertex_group_names_to_key(key, mesh.vertex_group_names);
+  add_materials_to_key(key, mesh.mat, mesh.totcol);
+  return true;
+}
+
+static bool add_pointcloud_to_key(GeometryNodeMemoizationKey &key, const PointCloud &pointcloud)
+{
+  if (!add_custom_data_to_key(key, pointcloud.pdata, pointcloud.totpoint)) {
+    return false;
+  }
+  add_materials_to_key(key, pointcloud.mat, pointcloud.totcol);
+  return true;
+}
+
+static bool add_curves_to_key(GeometryNodeMemoizationKey &key, const Curves &curves_id)
+{
+  const bke::CurvesGeometry &curves = curves_id.geometry.wrap();
+  if (!add_custom_data_to_key(key, curves.point_data, curves.point_num) ||
+      !add_custom_data_to_key(key, curves.curve_data, curves.curve_num))
+  {
+    return false;
+  }
+  if (!key.add_shared_array(curves.curve_offsets, curves.runtime->curve_offsets_sharing_info)) {
+    return false;
+  }
+  key.add_number(curves.custom_knot_num);
+  if (!key.add_shared_array(curves.custom_knots, curves.runtime->custom_knots_sharing_info)) {
+    return false;
+  }
+  key.add_number(curves.vertex_group_active_index);
+  key.add_number(curves.attributes_active_index);
+  add_vertex_group_names_to_key(key, curves.vertex_group_names);
+  /* Settings that are propagated to curves created by nodes. */
+  key.add_number(curves_id.flag);
+  key.add_number(curves_id.symmetry);
+  key.add_number(curves_id.surface);
+  key.add_string(curves_id.surface_uv_map);
+  add_materials_to_key(key, curves_id.mat, curves_id.totcol);
+  return true;
+}
+
+static bool add_geometry_to_key(GeometryNodeMemoizationKey &key, const GeometrySet &geometry)
+{
+  key.strings.append(geometry.name);
+  const Vector<const GeometryComponent *> components = geometry.get_components();
+  key.add_number(components.size());
+  for (const GeometryComponent *component : components) {
+    const GeometryComponent::Type type = component->type();
+    key.add_number(type);
+    switch (type) {
+      case GeometryComponent::Type::Mesh:
+        if (!add_mesh_to_key(key, *geometry.get_mesh())) {
+          return false;
+        }
+        break;
+      case GeometryComponent::Type::PointCloud:
+        if (!add_pointcloud_to_key(key, *geometry.get_pointcloud())) {
+          return false;
+        }
+        break;
+      case GeometryComponent::Type::Curve:
+        if (!add_curves_to_key(key, *geometry.get_curves())) {
+          return false;
+        }
+        break;
+      default:
+        /* Instances may reference data-blocks that can change without changing the instances
+         * themselves. Other component types are not supported yet. */
+        return false;
+    }
+  }
+  return true;
+}
+
+static bool add_socket_value_to_key(GeometryNodeMemoizationKey &key,
+                                    const SocketValueVariant &value)
+{
+  if (!value.is_single()) {
+    /* Fields are built again for every evaluation, so they can't be compared. */
+    return false;
+  }
+  const CPPType &type = *value.get_single_ptr().type();
+  if (!type.is_hashable() || !type.is_equality_comparable()) {
+    return false;
+  }
+  key.values.append(value);
+  return true;
+}
+
+static bool add_input_to_key(GeometryNodeMemoizationKey &key, const GPointer value)
+{
+  const CPPType &type = *value.type();
+  if (type.is<GeometrySet>()) {
+    return add_geometry_to_key(key, *value.get<GeometrySet>());
+  }
+  if (type.is<SocketValueVariant>()) {
+    return add_socket_value_to_key(key, *value.get<SocketValueVariant>());
+  }
+  if (type.is<Vector<GeometrySet>>()) {
+    const Vector<GeometrySet> &geometries = *value.get<Vector<GeometrySet>>();
+    key.add_number(geometries.size());
+    for (const GeometrySet &geometry : geometries) {
+      if (!add_geometry_to_key(key, geometry)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (type.is<Vector<SocketValueVariant>>()) {
+    const Vector<SocketValueVariant> &values = *value.get<Vector<SocketValueVariant>>();
+    key.add_number(values.size());
+    for (const SocketValueVariant &socket_value : values) {
+      if (!add_socket_value_to_key(key, socket_value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (type.is<GeometryNodesReferenceSet>()) {
+    const GeometryNodesReferenceSet &reference_set = *value.get<GeometryNodesReferenceSet>();
+    if (!reference_set.names) {
+      key.add_number(0);
+      return true;
+    }
+    /* Sort the names because the order in the set is not deterministic. */
+    Vector<std::string> names(reference_set.names->begin(), reference_set.names->end());
+    std::sort(names.begin(), names.end());
+    key.add_number(names.size());
+    key.strings.extend(names);
+    return true;
+  }
+  if (type.is<bool>()) {
+    key.add_number(*value.get<bool>());
+    return true;
+  }
+  if (type.is<Material *>()) {
+    const Material *material = *value.get<Material *>();
+    key.add_number(material ? material->id.session_uid : 0);
+    return true;
+  }
+  /* Other data-blocks can change without changing the pointer. */
+  return false;
+}
+
+static int id_property_array_element_size(const IDProperty &prop)
+{
+  switch (prop.subtype) {
+    case IDP_INT:
+      return sizeof(int);
+    case IDP_FLOAT:
+      return sizeof(float);
+    case IDP_DOUBLE:
+      return sizeof(double);
+    case IDP_BOOLEAN:
+      return sizeof(int8_t);
+  }
+  BLI_assert_unreachable();
+  return 0;
+}
+
+/**
+ * Hashes the exact values of the property and its children. Arrays are hashed up to their used
+ * length, the over-allocated part is not initialized.
+ */
+static uint64_t hash_id_property(const IDProperty &prop, uint64_t hash)
+{
+  hash = get_default_hash(hash, StringRef(prop.name), int(prop.type), int(prop.subtype));
+  hash = get_default_hash(hash, prop.len);
+  switch (prop.type) {
+    case IDP_STRING:
+      return XXH3_64bits_withSeed(prop.data.pointer, size_t(prop.len), hash);
+    case IDP_INT:
+    case IDP_FLOAT:
+    case IDP_BOOLEAN:
+      return get_default_hash(hash, prop.data.val);
+    case IDP_DOUBLE:
+      return get_default_hash(hash, prop.data.val, prop.data.val2);
+    case IDP_ARRAY:
+      return XXH3_64bits_withSeed(
+          prop.data.pointer, size_t(prop.len) * id_property_array_element_size(prop), hash);
+    case IDP_IDPARRAY:
+      for (const IDProperty &item :
+           Span(static_cast<const IDProperty *>(prop.data.pointer), prop.len))
+      {
+        hash = hash_id_property(item, hash);
+      }
+      return hash;
+    case IDP_GROUP:
+      LISTBASE_FOREACH (const IDProperty *, child, &prop.data.group) {
+        hash = hash_id_property(*child, hash);
+      }
+      return hash;
+    case IDP_ID:
+      /* Nodes referencing data-blocks are not memoized, see #node_has_id_properties. */
+      return get_default_hash(hash, prop.data.pointer);
+  }
+  BLI_assert_unreachable();
+  return hash;
+}
+
+/** Data-blocks can change without changing the pointer, so their users are never memoized. */
+static bool node_has_id_properties(const bNode &node)
+{
+  if (node.prop == nullptr) {
+    return false;
+  }
+  bool found = false;
+  IDP_foreach_property(node.prop, IDP_TYPE_FILTER_ID, [&](IDProperty * /*id_property*/) {
+    found = true;
+  });
+  return found;
+}
+
+MemoizedNodeIdentity memoized_node_identity(const bNodeTree &tree, const bNode &node)
+{
+  MemoizedNodeIdentity identity;
+  identity.tree_session_uid = tree.id.session_uid;
+  identity.node_id = node.identifier;
+  uint64_t settings_hash = get_default_hash(StringRef(node.idname), node.custom1, node.custom2);
+  settings_hash = get_default_hash(settings_hash, node.custom3, node.custom4);
+  if (node.storage != nullptr) {
+    /* Storage is allocated with zeroed padding and duplicated with #MEM_dupallocN, so the bytes
+     * of copies are equal. */
+    settings_hash = XXH3_64bits_withSeed(
+        node.storage, MEM_allocN_len(node.storage), settings_hash);
+  }
+  if (node.prop != nullptr) {
+    settings_hash = hash_id_property(*node.prop, settings_hash);
+  }
+  identity.settings_hash = settings_hash;
+  return identity;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Memoized Outputs
+ * \{ */
+
+class MemoizedNodeOutputs : public memory_cache::CachedValue {
+ public:
+  LinearAllocator<> allocator;
+  /** Output values by lazy-function output index. Null for outputs that the node did not set. */
+  Vector<GMutablePointer> outputs;
+  /** Logged information that is replayed when the outputs are reused. */
+  Vector<NodeWarning> warnings;
+  Vector<std::pair<std::string, NamedAttributeUsage>> used_named_attributes;
+
+  ~MemoizedNodeOutputs() override
+  {
+    for (GMutablePointer value : outputs) {
+      if (value.get() != nullptr) {
+        value.destruct();
+      }
+    }
+  }
+
+  void count_memory(MemoryCounter &memory) const override
+  {
+    for (const GMutablePointer value : outputs) {
+      if (value.get() == nullptr) {
+        continue;
+      }
+      if (value.type()->is<GeometrySet>()) {
+        value.get<GeometrySet>()->count_memory(memory);
+      }
+      else {
+        memory.add(value.type()->size());
+      }
+    }
+  }
+};
+
+/**
+ * Redirects the outputs of the node into separate buffers, so that they can be copied into the
+ * cache before they are passed on to the base params.
+ */
+class MemoizingParams final : public lf::Params {
+ private:
+  lf::Params &base_params_;
+  Span<void *> output_buffers_;
+  MutableSpan<bool> set_outputs_;
+
+ public:
+  MemoizingParams(const lf::LazyFunction &fn,
+                  lf::Params &base_params,
+                  const Span<void *> output_buffers,
+                  const MutableSpan<bool> set_outputs)
+      : lf::Params(fn, false),
+        base_params_(base_params),
+        output_buffers_(output_buffers),
+        set_outputs_(set_outputs)
+  {
+  }
+
+  void *try_get_input_data_ptr_impl(const int index) const override
+  {
+    return base_params_.try_get_input_data_ptr(index);
+  }
+
+  void *try_get_input_data_ptr_or_request_impl(const int index) override
+  {
+    return base_params_.try_get_input_data_ptr_or_request(index);
+  }
+
+  void *get_output_data_ptr_impl(const int index) override
+  {
+    return output_buffers_[index];
+  }
+
+  void output_set_impl(const int index) override
+  {
+    set_outputs_[index] = true;
+  }
+
+  bool output_was_set_impl(const int index) const override
+  {
+    return set_outputs_[index] || base_params_.output_was_set(index);
+  }
+
+  lf::ValueUsage get_output_usage_impl(const int index) const override
+  {
+    return base_params_.get_output_usage(index);
+  }
+
+  void set_input_unused_impl(const int index) override
+  {
+    base_params_.set_input_unused(index);
+  }
+
+  bool try_enable_multi_threading_impl() override
+  {
+    return base_params_.try_enable_multi_threading();
+  }
+};
+
+static bool output_is_requested(const lf::Params &params, const int index)
+{
+  return params.get_output_usage(index) != lf::ValueUsage::Unused && !params.output_was_set(index);
+}
+
+static std::unique_ptr<MemoizedNodeOutputs> execute_and_memoize(
+    const bNode &node,
+    const lf::LazyFunction &fn,
+    lf::Params &params,
+    const lf::Context &context,
+    const FunctionRef<void(lf::Params &params)> execute_fn)
+{
+  const int outputs_num = fn.outputs().size();
+  auto result = std::make_unique<MemoizedNodeOutputs>();
+
+  Array<void *> output_buffers(outputs_num);
+  Array<bool> set_outputs(outputs_num, false);
+  for (const int i : IndexRange(outputs_num)) {
+    const CPPType &type = *fn.outputs()[i].type;
+    output_buffers[i] = result->allocator.allocate(type.size(), type.alignment());
+  }
+
+  MemoizingParams memoizing_params{fn, params, output_buffers, set_outputs};
+  execute_fn(memoizing_params);
+
+  result->outputs.resize(outputs_num);
+  for (const int i : IndexRange(outputs_num)) {
+    if (!set_outputs[i]) {
+      continue;
+    }
+    const CPPType &type = *fn.outputs()[i].type;
+    void *value = output_buffers[i];
+    if (type.is<GeometrySet>()) {
+      /* The cached geometry may outlive data that the node output references. */
+      static_cast<GeometrySet *>(value)->ensure_owns_direct_data();
+    }
+    void *cached_value = result->allocator.allocate(type.size(), type.alignment());
+    type.copy_construct(value, cached_value);
+    result->outputs[i] = {type, cached_value};
+    if (params.output_was_set(i)) {
+      type.destruct(value);
+      continue;
+    }
+    type.move_construct(value, params.get_output_data_ptr(i));
+    type.destruct(value);
+    params.output_set(i);
+  }
+
+  const auto &user_data = *static_cast<GeoNodesLFUserData *>(context.user_data);
+  const auto &local_user_data = *static_cast<GeoNodesLFLocalUserData *>(context.local_user_data);
+  if (const GeoTreeLogger *tree_logger = local_user_data.try_get_tree_logger(user_data)) {
+    for (const GeoTreeLogger::WarningWithNode &warning : tree_logger->node_warnings) {
+      if (warning.node_id == node.identifier) {
+        result->warnings.append(warning.warning);
+      }
+    }
+    for (const GeoTreeLogger::AttributeUsageWithNode &usage : tree_logger->used_named_attributes) {
+      if (usage.node_id == node.identifier) {
+        result->used_named_attributes.append({usage.attribute_name, usage.usage});
+      }
+    }
+  }
+  return result;
+}
+
+static void replay_memoized_logs(const bNode &node,
+                                 const MemoizedNodeOutputs &memoized,
+                                 const lf::Context &context)
+{
+  const auto &user_data = *static_cast<GeoNodesLFUserData *>(context.user_data);
+  const auto &local_user_data = *static_cast<GeoNodesLFLocalUserData *>(context.local_user_data);
+  GeoTreeLogger *tree_logger = local_user_data.try_get_tree_logger(user_data);
+  if (tree_logger == nullptr) {
+    return;
+  }
+  for (const NodeWarning &warning : memoized.warnings) {
+    tree_logger->node_warnings.append(*tree_logger->allocator, {node.identifier, warning});
+  }
+  for (const auto &[name, usage] : memoized.used_named_attributes) {
+    tree_logger->used_named_attributes.append(
+        *tree_logger->allocator,
+        {node.identifier, tree_logger->allocator->copy_string(name), usage});
+  }
+}
+
+/** \} */
+
+bool execute_geometry_node_memoized(const bNode &node,
+                                    const lf::LazyFunction &fn,
+                                    lf::Params &params,
+                                    const lf::Context &context,
+                                    const FunctionRef<void(lf::Params &params)> execute_fn)
+{
+  const auto &user_data = *static_cast<GeoNodesLFUserData *>(context.user_data);
+  if (user_data.compute_context == nullptr) {
+    return false;
+  }
+  if (node_has_id_properties(node)) {
+    return false;
+  }
+
+  GeometryNodeMemoizationKey key;
+  key.node = memoized_node_identity(node.owner_tree(), node);
+  key.context_hash = user_data.compute_context->hash();
+
+  /* The node only computes the outputs that are used, so that is part of the key too. */
+  for (const int i : fn.outputs().index_range()) {
+    const bool is_requested = output_is_requested(params, i);
+    key.add_number(is_requested);
+    if (is_requested) {
+      const CPPType &type = *fn.outputs()[i].type;
+      if (!type.is<GeometrySet>() && !type.is<SocketValueVariant>()) {
+        return false;
+      }
+    }
+  }
+  for (const int i : fn.inputs().index_range()) {
+    const void *value = params.try_get_input_data_ptr(i);
+    BLI_assert(value != nullptr);
+    if (!add_input_to_key(key, {*fn.inputs()[i].type, value})) {
+      return false;
+    }
+  }
+
+  bool executed = false;
+  const std::shared_ptr<const MemoizedNodeOutputs> memoized =
+      memory_cache::get<MemoizedNodeOutputs>(key, [&]() {
+        executed = true;
+        return execute_and_memoize(node, fn, params, context, execute_fn);
+      });
+  if (executed) {
+    return true;
+  }
+
+  for (const int i : fn.outputs().index_range()) {
+    if (output_is_requested(params, i) && memoized->outputs[i].get() == nullptr) {
+      /* The node did not compute this output when it was memoized. */
+      return false;
+    }
+  }
+  for (const int i : fn.outputs().index_range()) {
+    if (!output_is_requested(params, i)) {
+      continue;
+    }
+    const GPointer value = memoized->outputs[i];
+    value.type()->copy_construct(value.get(), params.get_output_data_ptr(i));
+    params.output_set(i);
+  }
+  replay_memoized_logs(node, *memoized, context);
+  return true;
+}
+
+}  // namespace blender::nodes
@@ -2,13 +2,14 @@
  *
  * SPDX-License-Identifier: GPL-2.0-or-later */
 
+#include "FN_multi_function_fusion.hh"
+
 #include "NOD_math_functions.hh"
 
 namespace blender::nodes {
 
-static const mf::MultiFunction *get_base_multi_function(const bNode &node)
+static const mf::MultiFunction *get_base_multi_function(const int mode)
 {
-  const int mode = node.custom1;
   const mf::MultiFunction *base_fn = nullptr;
 
   try_dispatch_float_math_fl_to_fl(
@@ -70,9 +71,46 @@ class ClampWrapperFunction : public mf::MultiFunction {
   }
 };
 
+/**
+ * Register fused functions for chains of math nodes that are common in node trees, so that they
+ * are computed with a single call when they are part of a field.
+ */
+static void register_fused_functions()
+{
+  const mf::MultiFunction &multiply_fn = *get_base_multi_function(NODE_MATH_MULTIPLY);
+  const mf::MultiFunction &add_fn = *get_base_multi_function(NODE_MATH_ADD);
+
+  static auto multiply_add_fn = mf::build::fused_SO<0, float>(
+      "Multiply Add",
+      TypeSequence<float, float>(),
+      TypeSequence<float>(),
+      [](float a, float b) { return a * b; },
+      [](float a, float b) { return a + b; },
+      mf::build::exec_presets::AllSpanOrSingle());
+  static auto add_multiply_fn = mf::build::fused_SO<0, float>(
+      "Add Multiply",
+      TypeSequence<float, float>(),
+      TypeSequence<float>(),
+      [](float a, float b) { return a + b; },
+      [](float a, float b) { return a * b; },
+      mf::build::exec_presets::AllSpanOrSingle());
+
+  /* Both operations are commutative, so the same function is used for either input. */
+  for (const int input_index : {0, 1}) {
+    mf::register_fused_function(multiply_fn, add_fn, input_index, multiply_add_fn);
+    mf::register_fused_function(add_fn, multiply_fn, input_index, add_multiply_fn);
+  }
+}
+
 void node_math_build_multi_function(NodeMultiFunctionBuilder &builder)
 {
-  const mf::MultiFunction *base_function = get_base_multi_function(builder.node());
+  static const bool fused_functions_registered = []() {
+    register_fused_functions();
+    return true;
+  }();
+  UNUSED_VARS(fused_functions_registered);
+
+  const mf::MultiFunction *base_function = get_base_multi_function(builder.node().custom1);
 
   const bool clamp_output = builder.node().custom2 != 0;
   if (clamp_output) {
@@ -10,11 +10,24 @@
 
 #include "FN_multi_function_builder.hh"
 
+#include "NOD_math_functions.hh"
 #include "NOD_multi_function.hh"
 
 #include "UI_interface.hh"
 #include "UI_resources.hh"
 
+namespace blender::nodes {
+
+const mf::MultiFunction &get_clamp_min_max_multi_function()
+{
+  static auto fn = mf::build::SI3_SO<float, float, float, float>(
+      "Clamp (Min Max)",
+      [](float value, float min, float max) { return std::min(std::max(value, min), max); });
+  return fn;
+}
+
+}  // namespace blender::nodes
+
 namespace blender::nodes::node_shader_clamp_cc {
 
 static void sh_node_clamp_declare(NodeDeclarationBuilder &b)
@@ -49,9 +62,6 @@ static int gpu_shader_clamp(GPUMaterial *mat,
 
 static void sh_node_clamp_build_multi_function(NodeMultiFunctionBuilder &builder)
 {
-  static auto minmax_fn = mf::build::SI3_SO<float, float, float, float>(
-      "Clamp (Min Max)",
-      [](float value, float min, float max) { return std::min(std::max(value, min), max); });
   static auto range_fn = mf::build::SI3_SO<float, float, float, float>(
       "Clamp (Range)", [](float value, float a, float b) {
         if (a < b) {
@@ -63,7 +73,7 @@ static void sh_node_clamp_build_multi_function(NodeMultiFunctionBuilder &builder
 
   int clamp_type = builder.node().custom1;
   if (clamp_type == NODE_CLAMP_MINMAX) {
-    builder.set_matching_fn(minmax_fn);
+    builder.set_matching_fn(get_clamp_min_max_multi_function());
   }
   else {
     builder.set_matching_fn(range_fn);
@@ -16,7 +16,9 @@
 #include "BLI_math_vector.hh"
 
 #include "FN_multi_function_builder.hh"
+#include "FN_multi_function_fusion.hh"
 
+#include "NOD_math_functions.hh"
 #include "NOD_multi_function.hh"
 #include "NOD_socket_search_link.hh"
 
@@ -242,19 +244,46 @@ static float3 clamp_range(const float3 value, const float3 min, const float3 max
                 clamp_range(value.z, min.z, max.z));
 }
 
+template<bool Clamp>
+static float map_range_float_linear(
+    float value, float from_min, float from_max, float to_min, float to_max)
+{
+  const float factor = safe_divide(value - from_min, from_max - from_min);
+  float result = to_min + factor * (to_max - to_min);
+  if constexpr (Clamp) {
+    result = clamp_range(result, to_min, to_max);
+  }
+  return result;
+}
+
 template<bool Clamp> static auto build_float_linear()
 {
   return mf::build::SI5_SO<float, float, float, float, float, float>(
       Clamp ? "Map Range (clamped)" : "Map Range (unclamped)",
       [](float value, float from_min, float from_max, float to_min, float to_max) -> float {
-        const float factor = safe_divide(value - from_min, from_max - from_min);
-        float result = to_min + factor * (to_max - to_min);
-        if constexpr (Clamp) {
-          result = clamp_range(result, to_min, to_max);
-        }
-        return result;
+        return map_range_float_linear<Clamp>(value, from_min, from_max, to_min, to_max);
+      },
+      mf::build::exec_presets::SomeSpanOrSingle<0>());
+}
+
+/**
+ * Mapping a value and clamping it with a separate Clamp node afterwards is common in node trees.
+ * Register a fused function for it, so that the chain is computed with a single call when it is
+ * part of a field.
+ */
+static void register_fused_functions(const mf::MultiFunction &float_linear_fn)
+{
+  static auto map_range_clamp_fn = mf::build::fused_SO<0, float>(
+      "Map Range Clamp",
+      TypeSequence<float, float, float, float, float>(),
+      TypeSequence<float, float>(),
+      [](float value, float from_min, float from_max, float to_min, float to_max) {
+        return map_range_float_linear<false>(value, from_min, from_max, to_min, to_max);
       },
+      [](float value, float min, float max) { return std::min(std::max(value, min), max); },
       mf::build::exec_presets::SomeSpanOrSingle<0>());
+  mf::register_fused_function(
+      float_linear_fn, get_clamp_min_max_multi_function(), 0, map_range_clamp_fn);
 }
 
 template<bool Clamp> static auto build_float_stepped()
@@ -392,6 +421,11 @@ static void sh_node_map_range_build_multi_function(NodeMultiFunctionBuilder &bui
           }
           else {
             static auto fn = build_float_linear<false>();
+            static const bool fused_functions_registered = []() {
+              register_fused_functions(fn);
+              return true;
+            }();
+            UNUSED_VARS(fused_functions_registered);
             builder.set_matching_fn(fn);
           }
           break;
@@ -9,6 +9,8 @@
 #include "node_shader_util.hh"
 #include "node_util.hh"
 
+#include "FN_multi_function_fusion.hh"
+
 #include "NOD_inverse_eval_params.hh"
 #include "NOD_math_functions.hh"
 #include "NOD_multi_function.hh"
@@ -233,10 +235,8 @@ static void node_shader_update_vector_math(bNodeTree *ntree, bNode *node)
   }
 }
 
-static const mf::MultiFunction *get_multi_function(const bNode &node)
+static const mf::MultiFunction *get_multi_function(const NodeVectorMathOperation operation)
 {
-  NodeVectorMathOperation operation = NodeVectorMathOperation(node.custom1);
-
   const mf::MultiFunction *multi_fn = nullptr;
 
   try_dispatch_float_math_fl3_fl3_to_fl3(
@@ -312,9 +312,78 @@ static const mf::MultiFunction *get_multi_function(const bNode &node)
   return nullptr;
 }
 
+/**
+ * Register fused functions for chains of vector math nodes that are common in node trees, so that
+ * they are computed with a single call when they are part of a field.
+ */
+static void register_fused_functions()
+{
+  using namespace mf::build;
+  const mf::MultiFunction &add_fn = *get_multi_function(NODE_VECTOR_MATH_ADD);
+  const mf::MultiFunction &subtract_fn = *get_multi_function(NODE_VECTOR_MATH_SUBTRACT);
+  const mf::MultiFunction &multiply_fn = *get_multi_function(NODE_VECTOR_MATH_MULTIPLY);
+  const mf::MultiFunction &scale_fn = *get_multi_function(NODE_VECTOR_MATH_SCALE);
+  const mf::MultiFunction &length_fn = *get_multi_function(NODE_VECTOR_MATH_LENGTH);
+  const mf::MultiFunction &normalize_fn = *get_multi_function(NODE_VECTOR_MATH_NORMALIZE);
+
+  auto add = [](float3 a, float3 b) { return a + b; };
+  auto subtract = [](float3 a, float3 b) { return a - b; };
+  auto multiply = [](float3 a, float3 b) { return a * b; };
+  auto scale = [](float3 a, float b) { return a * b; };
+  auto length = [](float3 a) { return math::length(a); };
+  auto normalize = [](float3 a) { return math::normalize(a); };
+
+  static auto scale_add_fn = fused_SO<0, float3>("Scale Add",
+                                                 TypeSequence<float3, float>(),
+                                                 TypeSequence<float3>(),
+                                                 scale,
+                                                 add,
+                                                 exec_presets::AllSpanOrSingle());
+  static auto multiply_add_fn = fused_SO<0, float3>("Multiply Add",
+                                                    TypeSequence<float3, float3>(),
+                                                    TypeSequence<float3>(),
+                                                    multiply,
+                                                    add,
+                                                    exec_presets::AllSpanOrSingle());
+  static auto subtract_length_fn = fused_SO<0, float>("Subtract Length",
+                                                      TypeSequence<float3, float3>(),
+                                                      TypeSequence<>(),
+                                                      subtract,
+                                                      length,
+                                                      exec_presets::AllSpanOrSingle());
+  static auto subtract_normalize_fn = fused_SO<0, float3>("Subtract Normalize",
+                                                          TypeSequence<float3, float3>(),
+                                                          TypeSequence<>(),
+                                                          subtract,
+                                                          normalize,
+                                                          exec_presets::AllSpanOrSingle());
+  static auto normalize_scale_fn = fused_SO<0, float3>("Normalize Scale",
+                                                       TypeSequence<float3>(),
+                                                       TypeSequence<float>(),
+                                                       normalize,
+                                                       scale,
+                                                       exec_presets::AllSpanOrSingle());
+
+  /* Addition is commutative, so the same function is used for either input. */
+  for (const int input_index : {0, 1}) {
+    mf::register_fused_function(scale_fn, add_fn, input_index, scale_add_fn);
+    mf::register_fused_function(multiply_fn, add_fn, input_index, multiply_add_fn);
+  }
+  mf::register_fused_function(subtract_fn, length_fn, 0, subtract_length_fn);
+  mf::register_fused_function(subtract_fn, normalize_fn, 0, subtract_normalize_fn);
+  mf::register_fused_function(normalize_fn, scale_fn, 0, normalize_scale_fn);
+}
+
 static void sh_node_vector_math_build_multi_function(NodeMultiFunctionBuilder &builder)
 {
-  const mf::MultiFunction *fn = get_multi_function(builder.node());
+  static const bool fused_functions_registered = []() {
+    register_fused_functions();
+    return true;
+  }();
+  UNUSED_VARS(fused_functions_registered);
+
+  const mf::MultiFunction *fn = get_multi_function(
+      NodeVectorMathOperation(builder.node().custom1));
   builder.set_matching_fn(fn);
 }
 
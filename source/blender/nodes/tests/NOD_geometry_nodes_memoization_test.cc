@@ -0,0 +1,126 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_string.h"
+
+#include "DNA_modifier_types.h"
+#include "DNA_node_types.h"
+
+#include "BKE_idprop.hh"
+
+#include "NOD_geometry_nodes_memoization.hh"
+
+namespace blender::nodes::tests {
+
+/**
+ * A Subdivision Surface node with settings in its storage and a Mesh Boolean node with settings
+ * in the custom properties, the way they are initialized when added to a tree.
+ */
+class GeometryNodesMemoizationTest : public testing::Test {
+ protected:
+  bNodeTree tree_{};
+  bNode subdivision_{};
+  bNode boolean_{};
+
+  void SetUp() override
+  {
+    tree_.id.session_uid = 10;
+
+    STRNCPY(subdivision_.idname, "GeometryNodeSubdivisionSurface");
+    subdivision_.identifier = 1;
+    auto *storage = MEM_callocN<NodeGeometrySubdivisionSurface>(__func__);
+    storage->uv_smooth = SUBSURF_UV_SMOOTH_PRESERVE_BOUNDARIES;
+    storage->boundary_smooth = SUBSURF_BOUNDARY_SMOOTH_ALL;
+    subdivision_.storage = storage;
+
+    STRNCPY(boolean_.idname, "GeometryNodeMeshBoolean");
+    boolean_.identifier = 2;
+    boolean_.custom1 = 2;
+    boolean_.custom2 = 1;
+  }
+
+  void TearDown() override
+  {
+    MEM_freeN(subdivision_.storage);
+  }
+
+  NodeGeometrySubdivisionSurface &subdivision_storage()
+  {
+    return *static_cast<NodeGeometrySubdivisionSurface *>(subdivision_.storage);
+  }
+};
+
+TEST_F(GeometryNodesMemoizationTest, HitAfterUnrelatedEdit)
+{
+  const MemoizedNodeIdentity subdivision = memoized_node_identity(tree_, subdivision_);
+  const MemoizedNodeIdentity boolean = memoized_node_identity(tree_, boolean_);
+
+  /* Changing another node rebuilds the lazy-function graph, but must not affect the identity. */
+  boolean_.custom1 = 0;
+  subdivision_.location[0] = 100.0f;
+  STRNCPY(subdivision_.label, "Renamed");
+  EXPECT_EQ(memoized_node_identity(tree_, subdivision_), subdivision);
+  EXPECT_EQ(memoized_node_identity(tree_, subdivision_).hash(), subdivision.hash());
+  EXPECT_NE(memoized_node_identity(tree_, boolean_), boolean);
+
+  /* The evaluated copy of the tree duplicates the storage. */
+  bNodeTree tree_copy{};
+  tree_copy.id.session_uid = tree_.id.session_uid;
+  bNode subdivision_copy = subdivision_;
+  subdivision_copy.storage = MEM_dupallocN(subdivision_.storage);
+  EXPECT_EQ(memoized_node_identity(tree_copy, subdivision_copy), subdivision);
+  MEM_freeN(subdivision_copy.storage);
+}
+
+TEST_F(GeometryNodesMemoizationTest, MissAfterRelevantEdit)
+{
+  const MemoizedNodeIdentity subdivision = memoized_node_identity(tree_, subdivision_);
+  const MemoizedNodeIdentity boolean = memoized_node_identity(tree_, boolean_);
+  EXPECT_NE(subdivision, boolean);
+
+  subdivision_storage().uv_smooth = SUBSURF_UV_SMOOTH_NONE;
+  EXPECT_NE(memoized_node_identity(tree_, subdivision_), subdivision);
+  subdivision_storage().uv_smooth = SUBSURF_UV_SMOOTH_PRESERVE_BOUNDARIES;
+  EXPECT_EQ(memoized_node_identity(tree_, subdivision_), subdivision);
+
+  boolean_.custom2 = 0;
+  EXPECT_NE(memoized_node_identity(tree_, boolean_), boolean);
+
+  /* The same node in another tree, e.g. a duplicated node group, has its own outputs. */
+  bNodeTree other_tree{};
+  other_tree.id.session_uid = 11;
+  EXPECT_NE(memoized_node_identity(other_tree, subdivision_), subdivision);
+}
+
+TEST_F(GeometryNodesMemoizationTest, IDPropertiesAreHashed)
+{
+  auto group = bke::idprop::create_group("Node Properties");
+  IDP_AddToGroup(group.get(), bke::idprop::create("Scale", 1.0f).release());
+  IDP_AddToGroup(group.get(), bke::idprop::create("Mode", StringRefNull("Fast")).release());
+  boolean_.prop = group.get();
+  const MemoizedNodeIdentity boolean = memoized_node_identity(tree_, boolean_);
+
+  /* The evaluated copy of the tree duplicates the properties. */
+  bNode boolean_copy = boolean_;
+  boolean_copy.prop = IDP_CopyProperty(boolean_.prop);
+  EXPECT_EQ(memoized_node_identity(tree_, boolean_copy), boolean);
+  IDP_FreeProperty(boolean_copy.prop);
+
+  /* Values that print the same are still different settings. */
+  IDProperty *scale = IDP_GetPropertyFromGroup(group.get(), "Scale");
+  IDP_Float(scale) = 1.0000001f;
+  EXPECT_NE(memoized_node_identity(tree_, boolean_), boolean);
+  IDP_Float(scale) = 1.0f;
+  EXPECT_EQ(memoized_node_identity(tree_, boolean_), boolean);
+
+  IDP_AddToGroup(group.get(), bke::idprop::create("Count", 3).release());
+  EXPECT_NE(memoized_node_identity(tree_, boolean_), boolean);
+  boolean_.prop = nullptr;
+}
+
+}  // namespace blender::nodes::tests
@@ -20,9 +20,19 @@ struct StripElem;
 
 namespace blender::seq {
 
+/** Maximum number of frames that prefetching renders at the same time. */
+#define SEQ_PREFETCH_WORKERS_MAX 64
+/**
+ * Number of frames prefetched at the same time when not set in the preferences. Every worker
+ * keeps its own evaluated copy of the scene, so few are used by default.
+ */
+#define SEQ_PREFETCH_WORKERS_DEFAULT 2
+
 enum eTaskId {
   SEQ_TASK_MAIN_RENDER,
+  /** Each prefetch worker uses its own ID, starting at this one. */
   SEQ_TASK_PREFETCH_RENDER,
+  SEQ_TASK_NUM = SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_WORKERS_MAX,
 };
 
 struct RenderData {
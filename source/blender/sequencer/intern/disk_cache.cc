@@ -9,6 +9,14 @@
 #include <cstddef>
 #include <ctime>
 #include <memory.h>
+#include <mutex>
+#include <optional>
+#include <string>
+
+/* For S_ISDIR() on Windows. */
+#ifdef WIN32
+#  include "BLI_winstuff.h"
+#endif
 
 #include "MEM_guardedalloc.h"
 
@@ -20,14 +28,15 @@
 #include "IMB_imbuf.hh"
 #include "IMB_imbuf_types.hh"
 
-#include "BLI_endian_defines.h"
-#include "BLI_endian_switch.h"
 #include "BLI_fileops.h"
 #include "BLI_fileops_types.h"
-#include "BLI_listbase.h"
+#include "BLI_map.hh"
 #include "BLI_path_utils.hh"
+#include "BLI_set.hh"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
+#include "BLI_time.h"
 
 #include "BKE_main.hh"
 
@@ -35,70 +44,97 @@
 #include "SEQ_time.hh"
 
 #include "disk_cache.hh"
+#include "disk_cache_index.hh"
 #include "image_cache.hh"
 
+#include "xxhash.h"
+
 /**
  * Disk Cache Design Notes
  * =======================
  *
  * Disk cache uses directory specified in user preferences
- * For each cached non-temp image, image data and supplementary info are written to HDD.
- * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
- * Each of these files contains header DiskCacheHeader followed by image data.
+ * For each cached non-temp image, image data is appended to a pack file in the project directory
+ * (`<cache dir>/<project name>_seq_cache/pack_<id>.dcp`). A new pack file is started when the
+ * active one reaches a fraction of the cache size limit.
  * ZLIB compression with user definable level can be used to compress image data(per image)
- * Images are written in order in which they are rendered.
- * Overwriting of individual entry is not possible.
- * Stored images are deleted by invalidation, or when size of all files exceeds maximum
- * size specified in user preferences.
+ * The location of every image is stored in a #DiskCacheIndex (`index.dci`), keyed by strip,
+ * frame, cache type and render size, so no directory has to be scanned on startup.
+ * The index also keeps the least recently used order of the images. When the size of all pack
+ * files exceeds the maximum size specified in user preferences, the pack file containing the
+ * least recently used image is deleted.
+ * Images are written asynchronously on a background task pool, images waiting to be written are
+ * still found by reading. Reading only locks the index to find an image, not while decompressing.
+ * Stored images are removed from the index by invalidation, pack files are deleted once none of
+ * their images are used anymore.
  * To distinguish 2 blend files with same name, scene->ed->disk_cache_timestamp
  * is used as UID. Blend file can still be copied manually which may cause conflict.
+ * All scenes of a blend file share the same index and pack files.
  */
 
 namespace blender::seq {
 
-/* Format string:
- * `<cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf`. */
-#define DCACHE_FNAME_FORMAT "%d-%dx%d-%d%%(%d)-%d.dcf"
-#define DCACHE_IMAGES_PER_FILE 100
-#define DCACHE_CURRENT_VERSION 2
-#define COLORSPACE_NAME_MAX 64 /* XXX: defined in IMB intern. */
-
-struct DiskCacheHeaderEntry {
-  uchar encoding;
-  uint64_t frameno;
-  uint64_t size_compressed;
-  uint64_t size_raw;
-  uint64_t offset;
-  char colorspace_name[COLORSPACE_NAME_MAX];
-};
-
-struct DiskCacheHeader {
-  DiskCacheHeaderEntry entry[DCACHE_IMAGES_PER_FILE];
+#define DCACHE_CURRENT_VERSION 3
+#define DCACHE_INDEX_FILENAME "index.dci"
+/** Format string: `pack_<pack id>.dcp`. */
+#define DCACHE_PACK_FNAME_FORMAT "pack_%06u.dcp"
+/** Size of a pack file after which a new one is started, as a fraction of the size limit. */
+#define DCACHE_PACKS_PER_SIZE_LIMIT 64
+#define DCACHE_PACK_SIZE_MIN (size_t(16) << 20)
+#define DCACHE_PACK_SIZE_MAX (size_t(1) << 30)
+/** Images are written on the calling thread when more are waiting, to limit memory usage. */
+#define DCACHE_PENDING_WRITES_MAX 16
+/** Seconds after which the size of the disk caches of other projects is computed again. */
+#define DCACHE_SIZE_OTHER_UPDATE_INTERVAL 60.0
+
+/** State shared by the disk caches of all scenes using the same project directory. */
+struct DiskCacheStore {
+  char dir[FILE_MAX];
+  int users = 0;
+
+  /** Protects all members below, except those owned by the writer. */
+  std::mutex mutex;
+  DiskCacheIndex index;
+  /** Size of every pack file on disk. */
+  Map<uint32_t, uint64_t> pack_sizes;
+  uint32_t pack_id_last = 0;
+  /** Size of all pack files of this project. */
+  size_t size_total = 0;
+  /** Size of the disk caches of other projects, counted towards the size limit too. */
+  size_t size_other = 0;
+  /** Images waiting to be written by the background tasks. */
+  Map<DiskCacheKey, ImBuf *> pending_writes;
+
+  /** Serializes writing, locked before #mutex. */
+  std::mutex write_mutex;
+  /** Time #size_other was computed, it changes when other Blender instances write images. */
+  double size_other_time = 0.0;
+  /** Pack file new images are appended to, 0 when none is open. */
+  uint32_t pack_active = 0;
+  FILE *pack_active_file = nullptr;
+
+  TaskPool *write_pool = nullptr;
 };
 
 struct SeqDiskCache {
   Main *bmain;
   int64_t timestamp;
-  ListBase files;
-  ThreadMutex read_write_mutex;
-  size_t size_total;
+  DiskCacheStore *store;
 };
 
-struct DiskCacheFile {
-  DiskCacheFile *next, *prev;
-  char filepath[FILE_MAX];
-  char dir[FILE_MAXDIR];
-  char file[FILE_MAX];
-  BLI_stat_t fstat;
-  int cache_type;
-  int rectx;
-  int recty;
-  int render_size;
-  int view_id;
-  int start_frame;
+struct DiskCacheWriteTask {
+  DiskCacheStore *store;
+  DiskCacheKey key;
+  ImBuf *ibuf;
 };
 
+/** Stores by project directory. */
 static ThreadMutex cache_create_lock = BLI_MUTEX_INITIALIZER;
+static Map<std::string, DiskCacheStore *> &seq_disk_cache_stores()
+{
+  static Map<std::string, DiskCacheStore *> stores;
+  return stores;
+}
 
 static const char *seq_disk_cache_base_dir()
 {
@@ -124,6 +160,13 @@ static size_t seq_disk_cache_size_limit()
   return size_t(U.sequencer_disk_cache_size_limit) * (1024 * 1024 * 1024);
 }
 
+static size_t seq_disk_cache_pack_size_limit()
+{
+  return std::clamp(seq_disk_cache_size_limit() / DCACHE_PACKS_PER_SIZE_LIMIT,
+                    DCACHE_PACK_SIZE_MIN,
+                    DCACHE_PACK_SIZE_MAX);
+}
+
 bool seq_disk_cache_is_enabled(Main *bmain)
 {
   return (U.sequencer_disk_cache_dir[0] != '\0' && U.sequencer_disk_cache_size_limit != 0 &&
@@ -131,154 +174,8 @@ bool seq_disk_cache_is_enabled(Main *bmain)
           bmain->filepath[0] != '\0');
 }
 
-static DiskCacheFile *seq_disk_cache_add_file_to_list(SeqDiskCache *disk_cache,
-                                                      const char *filepath)
-{
-
-  DiskCacheFile *cache_file = MEM_callocN<DiskCacheFile>("SeqDiskCacheFile");
-  char dir[FILE_MAXDIR], file[FILE_MAX];
-  BLI_path_split_dir_file(filepath, dir, sizeof(dir), file, sizeof(file));
-  STRNCPY(cache_file->filepath, filepath);
-  STRNCPY(cache_file->dir, dir);
-  STRNCPY(cache_file->file, file);
-  sscanf(file,
-         DCACHE_FNAME_FORMAT,
-         &cache_file->cache_type,
-         &cache_file->rectx,
-         &cache_file->recty,
-         &cache_file->render_size,
-         &cache_file->view_id,
-         &cache_file->start_frame);
-  cache_file->start_frame *= DCACHE_IMAGES_PER_FILE;
-  BLI_addtail(&disk_cache->files, cache_file);
-  return cache_file;
-}
-
-static void seq_disk_cache_get_files(SeqDiskCache *disk_cache, const char *dirpath)
-{
-  direntry *filelist, *fl;
-  uint i;
-  disk_cache->size_total = 0;
-
-  const int filelist_num = BLI_filelist_dir_contents(dirpath, &filelist);
-  i = filelist_num;
-  fl = filelist;
-  while (i--) {
-    /* Don't follow links. */
-    const eFileAttributes file_attrs = BLI_file_attributes(fl->path);
-    if (file_attrs & FILE_ATTR_ANY_LINK) {
-      fl++;
-      continue;
-    }
-
-    char file[FILE_MAX];
-    BLI_path_split_file_part(fl->path, file, sizeof(file));
-
-    bool is_dir = BLI_is_dir(fl->path);
-    if (is_dir && !FILENAME_IS_CURRPAR(file)) {
-      char subpath[FILE_MAX];
-      STRNCPY(subpath, fl->path);
-      BLI_path_slash_ensure(subpath, sizeof(subpath));
-      seq_disk_cache_get_files(disk_cache, subpath);
-    }
-
-    if (!is_dir) {
-      const char *ext = BLI_path_extension(fl->path);
-      if (ext && ext[1] == 'd' && ext[2] == 'c' && ext[3] == 'f') {
-        DiskCacheFile *cache_file = seq_disk_cache_add_file_to_list(disk_cache, fl->path);
-        cache_file->fstat = fl->s;
-        disk_cache->size_total += cache_file->fstat.st_size;
-      }
-    }
-    fl++;
-  }
-  BLI_filelist_free(filelist, filelist_num);
-}
-
-static DiskCacheFile *seq_disk_cache_get_oldest_file(SeqDiskCache *disk_cache)
-{
-  DiskCacheFile *oldest_file = static_cast<DiskCacheFile *>(disk_cache->files.first);
-  if (oldest_file == nullptr) {
-    return nullptr;
-  }
-  for (DiskCacheFile *cache_file = oldest_file->next; cache_file; cache_file = cache_file->next) {
-    if (cache_file->fstat.st_mtime < oldest_file->fstat.st_mtime) {
-      oldest_file = cache_file;
-    }
-  }
-
-  return oldest_file;
-}
-
-static void seq_disk_cache_delete_file(SeqDiskCache *disk_cache, DiskCacheFile *file)
-{
-  disk_cache->size_total -= file->fstat.st_size;
-  BLI_delete(file->filepath, false, false);
-  BLI_remlink(&disk_cache->files, file);
-  MEM_freeN(file);
-}
-
-bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
-{
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
-  while (disk_cache->size_total > seq_disk_cache_size_limit()) {
-    DiskCacheFile *oldest_file = seq_disk_cache_get_oldest_file(disk_cache);
-
-    if (!oldest_file) {
-      /* We shouldn't enforce limits with no files, do re-scan. */
-      seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
-      continue;
-    }
-
-    if (BLI_exists(oldest_file->filepath) == 0) {
-      /* File may have been manually deleted during runtime, do re-scan. */
-      BLI_freelistN(&disk_cache->files);
-      seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
-      continue;
-    }
-
-    seq_disk_cache_delete_file(disk_cache, oldest_file);
-  }
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
-
-  return true;
-}
-
-static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_cache,
-                                                            const char *filepath)
-{
-  DiskCacheFile *cache_file = static_cast<DiskCacheFile *>(disk_cache->files.first);
-
-  for (; cache_file; cache_file = cache_file->next) {
-    if (BLI_strcasecmp(cache_file->filepath, filepath) == 0) {
-      return cache_file;
-    }
-  }
-
-  return nullptr;
-}
-
-/* Update file size and timestamp. */
-static void seq_disk_cache_update_file(SeqDiskCache *disk_cache, const char *filepath)
-{
-  DiskCacheFile *cache_file;
-  int64_t size_before;
-  int64_t size_after;
-
-  cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, filepath);
-  size_before = cache_file->fstat.st_size;
-
-  if (BLI_stat(filepath, &cache_file->fstat) == -1) {
-    BLI_assert(false);
-    memset(&cache_file->fstat, 0, sizeof(BLI_stat_t));
-  }
-
-  size_after = cache_file->fstat.st_size;
-  disk_cache->size_total += size_after - size_before;
-}
-
 /* Path format:
- * <cache dir>/<project name>_seq_cache/<scene name>-<timestamp>/<strip name>/DCACHE_FNAME_FORMAT
+ * <cache dir>/<project name>_seq_cache/DCACHE_PACK_FNAME_FORMAT
  */
 
 static void seq_disk_cache_get_project_dir(SeqDiskCache *disk_cache,
@@ -292,40 +189,45 @@ static void seq_disk_cache_get_project_dir(SeqDiskCache *disk_cache,
   BLI_path_join(dirpath, dirpath_maxncpy, seq_disk_cache_base_dir(), cache_dir);
 }
 
-static void seq_disk_cache_get_dir(
-    SeqDiskCache *disk_cache, Scene *scene, Strip *strip, char *dirpath, size_t dirpath_maxncpy)
+static void seq_disk_cache_get_pack_path(const DiskCacheStore *store,
+                                         const uint32_t pack_id,
+                                         char *filepath,
+                                         size_t filepath_maxncpy)
 {
-  char scene_name[MAX_ID_NAME + 22]; /* + -%PRId64 */
-  char strip_name[STRIP_NAME_MAXSTR];
-  char project_dir[FILE_MAX];
-
-  seq_disk_cache_get_project_dir(disk_cache, project_dir, sizeof(project_dir));
-  SNPRINTF(scene_name, "%s-%" PRId64, scene->id.name, disk_cache->timestamp);
-  STRNCPY(strip_name, strip->name);
-  BLI_path_make_safe_filename(scene_name);
-  BLI_path_make_safe_filename(strip_name);
+  char pack_filename[FILE_MAXFILE];
+  SNPRINTF(pack_filename, DCACHE_PACK_FNAME_FORMAT, pack_id);
+  BLI_path_join(filepath, filepath_maxncpy, store->dir, pack_filename);
+}
 
-  BLI_path_join(dirpath, dirpath_maxncpy, project_dir, scene_name, strip_name);
+static DiskCacheKey seq_disk_cache_key(const SeqDiskCache *disk_cache, const SeqCacheKey *key)
+{
+  /* Identify the strip by names rather than pointers, which change between sessions. */
+  char strip_id[MAX_ID_NAME + STRIP_NAME_MAXSTR + 24];
+  const size_t strip_id_len = SNPRINTF_RLEN(strip_id,
+                                            "%s-%" PRId64 "/%s",
+                                            key->context.scene->id.name,
+                                            disk_cache->timestamp,
+                                            key->strip->name);
+
+  DiskCacheKey disk_key = {};
+  disk_key.strip_hash = XXH3_64bits(strip_id, strip_id_len);
+  disk_key.frame_index = key->frame_index;
+  disk_key.type = key->type;
+  disk_key.rectx = key->context.rectx;
+  disk_key.recty = key->context.recty;
+  disk_key.render_size = key->context.preview_render_size;
+  disk_key.view_id = key->context.view_id;
+  return disk_key;
 }
 
-static void seq_disk_cache_get_file_path(SeqDiskCache *disk_cache,
-                                         SeqCacheKey *key,
-                                         char *filepath,
-                                         size_t filepath_maxncpy)
+static uint64_t seq_disk_cache_strip_hash(const SeqDiskCache *disk_cache,
+                                          Scene *scene,
+                                          Strip *strip)
 {
-  seq_disk_cache_get_dir(disk_cache, key->context.scene, key->strip, filepath, filepath_maxncpy);
-  int frameno = int(key->frame_index) / DCACHE_IMAGES_PER_FILE;
-  char cache_filename[FILE_MAXFILE];
-  SNPRINTF(cache_filename,
-           DCACHE_FNAME_FORMAT,
-           key->type,
-           key->context.rectx,
-           key->context.recty,
-           key->context.preview_render_size,
-           key->context.view_id,
-           frameno);
-
-  BLI_path_append(filepath, filepath_maxncpy, cache_filename);
+  SeqCacheKey key = {};
+  key.context.scene = scene;
+  key.strip = strip;
+  return seq_disk_cache_key(disk_cache, &key).strip_hash;
 }
 
 static void seq_disk_cache_create_version_file(const char *filepath)
@@ -339,13 +241,11 @@ static void seq_disk_cache_create_version_file(const char *filepath)
   }
 }
 
-static void seq_disk_cache_handle_versioning(SeqDiskCache *disk_cache)
+static void seq_disk_cache_handle_versioning(const char *dirpath)
 {
-  char dirpath[FILE_MAX];
   char path_version_file[FILE_MAX];
   int version = 0;
 
-  seq_disk_cache_get_project_dir(disk_cache, dirpath, sizeof(dirpath));
   BLI_path_join(path_version_file, sizeof(path_version_file), dirpath, "cache_version");
 
   if (BLI_exists(dirpath) && BLI_is_dir(dirpath)) {
@@ -369,319 +269,431 @@ static void seq_disk_cache_handle_versioning(SeqDiskCache *disk_cache)
   }
 }
 
-static void seq_disk_cache_delete_invalid_files(SeqDiskCache *disk_cache,
-                                                Scene *scene,
-                                                Strip *strip,
-                                                int invalidate_types,
-                                                int range_start,
-                                                int range_end)
+/** Size of the files in the cache directories of other projects. */
+static size_t seq_disk_cache_other_projects_size(const char *project_dir)
 {
-  DiskCacheFile *next_file, *cache_file = static_cast<DiskCacheFile *>(disk_cache->files.first);
-  char cache_dir[FILE_MAX];
-  seq_disk_cache_get_dir(disk_cache, scene, strip, cache_dir, sizeof(cache_dir));
-  BLI_path_slash_ensure(cache_dir, sizeof(cache_dir));
-
-  while (cache_file) {
-    next_file = cache_file->next;
-    if (cache_file->cache_type & invalidate_types) {
-      if (STREQ(cache_dir, cache_file->dir)) {
-        int timeline_frame_start = seq_cache_frame_index_to_timeline_frame(
-            strip, cache_file->start_frame);
-        if (timeline_frame_start > range_start && timeline_frame_start <= range_end) {
-          seq_disk_cache_delete_file(disk_cache, cache_file);
-        }
+  size_t size = 0;
+  direntry *filelist;
+  const uint filelist_num = BLI_filelist_dir_contents(seq_disk_cache_base_dir(), &filelist);
+  for (const direntry &entry : Span(filelist, filelist_num)) {
+    if (!S_ISDIR(entry.s.st_mode) || FILENAME_IS_CURRPAR(entry.relname) ||
+        !BLI_str_endswith(entry.relname, "_seq_cache") ||
+        BLI_path_cmp(entry.path, project_dir) == 0)
+    {
+      continue;
+    }
+    direntry *project_filelist;
+    const uint project_filelist_num = BLI_filelist_dir_contents(entry.path, &project_filelist);
+    for (const direntry &project_entry : Span(project_filelist, project_filelist_num)) {
+      if (!S_ISDIR(project_entry.s.st_mode)) {
+        size += size_t(project_entry.s.st_size);
       }
     }
-    cache_file = next_file;
+    BLI_filelist_free(project_filelist, project_filelist_num);
   }
+  BLI_filelist_free(filelist, filelist_num);
+  return size;
 }
 
-void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
-                               Scene *scene,
-                               Strip *strip,
-                               Strip *strip_changed,
-                               int invalidate_types)
+/** Load the index and find the pack files, only the project directory is listed. */
+static void seq_disk_cache_store_open(DiskCacheStore *store)
 {
-  int start;
-  int end;
+  seq_disk_cache_handle_versioning(store->dir);
 
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  char index_path[FILE_MAX];
+  BLI_path_join(index_path, sizeof(index_path), store->dir, DCACHE_INDEX_FILENAME);
+  const bool index_is_valid = store->index.open(index_path);
 
-  start = time_left_handle_frame_get(scene, strip_changed) - DCACHE_IMAGES_PER_FILE;
-  end = time_right_handle_frame_get(scene, strip_changed);
+  Set<uint32_t> pack_ids;
+  for (const uint32_t pack_id : store->index.pack_ids()) {
+    pack_ids.add(pack_id);
+  }
 
-  seq_disk_cache_delete_invalid_files(disk_cache, scene, strip, invalidate_types, start, end);
+  direntry *filelist;
+  const uint filelist_num = BLI_filelist_dir_contents(store->dir, &filelist);
+  for (const direntry &entry : Span(filelist, filelist_num)) {
+    uint pack_id;
+    if (S_ISDIR(entry.s.st_mode) ||
+        sscanf(entry.relname, DCACHE_PACK_FNAME_FORMAT, &pack_id) != 1)
+    {
+      continue;
+    }
+    store->pack_id_last = std::max(store->pack_id_last, uint32_t(pack_id));
+    if (!index_is_valid || !pack_ids.contains(pack_id)) {
+      /* Not referenced by the index, e.g. all its images were invalidated. */
+      BLI_delete(entry.path, false, false);
+      continue;
+    }
+    store->pack_sizes.add(pack_id, uint64_t(entry.s.st_size));
+    store->size_total += size_t(entry.s.st_size);
+  }
+  BLI_filelist_free(filelist, filelist_num);
+
+  /* Pack files may have been deleted manually. */
+  for (const uint32_t pack_id : pack_ids) {
+    if (!store->pack_sizes.contains(pack_id)) {
+      store->index.remove_pack(pack_id);
+    }
+  }
 
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  store->size_other = seq_disk_cache_other_projects_size(store->dir);
+  store->size_other_time = BLI_time_now_seconds();
+  store->write_pool = BLI_task_pool_create_background(nullptr, TASK_PRIORITY_LOW);
 }
 
-static size_t deflate_imbuf_to_file(ImBuf *ibuf,
-                                    FILE *file,
-                                    int level,
-                                    DiskCacheHeaderEntry *header_entry)
+static DiskCacheStore *seq_disk_cache_store_acquire(const char *dir)
 {
-  void *data = (ibuf->byte_buffer.data != nullptr) ? (void *)ibuf->byte_buffer.data :
-                                                     (void *)ibuf->float_buffer.data;
-
-  /* Apply compression if wanted, otherwise just write directly to the file. */
-  if (level > 0) {
-    return BLI_file_zstd_from_mem_at_pos(
-        data, header_entry->size_raw, file, header_entry->offset, level);
-  }
-
-  fseek(file, header_entry->offset, SEEK_SET);
-  return fwrite(data, 1, header_entry->size_raw, file);
+  BLI_mutex_lock(&cache_create_lock);
+  DiskCacheStore *store = seq_disk_cache_stores().lookup_or_add_cb(dir, [&]() {
+    DiskCacheStore *store = MEM_new<DiskCacheStore>(__func__);
+    STRNCPY(store->dir, dir);
+    seq_disk_cache_store_open(store);
+    return store;
+  });
+  store->users++;
+  BLI_mutex_unlock(&cache_create_lock);
+  return store;
 }
 
-static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
+static void seq_disk_cache_store_release(DiskCacheStore *store)
 {
-  void *data = (ibuf->byte_buffer.data != nullptr) ? (void *)ibuf->byte_buffer.data :
-                                                     (void *)ibuf->float_buffer.data;
-  char header[4];
-  fseek(file, header_entry->offset, SEEK_SET);
-  if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
-    return 0;
+  BLI_mutex_lock(&cache_create_lock);
+  if (--store->users == 0) {
+    seq_disk_cache_stores().remove(store->dir);
+    /* Finish writing the pending images. */
+    BLI_task_pool_work_and_wait(store->write_pool);
+    BLI_task_pool_free(store->write_pool);
+    if (store->pack_active_file) {
+      fclose(store->pack_active_file);
+    }
+    store->index.close();
+    MEM_delete(store);
   }
+  BLI_mutex_unlock(&cache_create_lock);
+}
 
-  /* Check if the data is compressed or raw. */
-  if (BLI_file_magic_is_zstd(header)) {
-    return BLI_file_unzstd_to_mem_at_pos(data, header_entry->size_raw, file, header_entry->offset);
+static void seq_disk_cache_delete_pack(DiskCacheStore *store, const uint32_t pack_id)
+{
+  if (pack_id == store->pack_active) {
+    fclose(store->pack_active_file);
+    store->pack_active_file = nullptr;
+    store->pack_active = 0;
   }
-
-  fseek(file, header_entry->offset, SEEK_SET);
-  return fread(data, 1, header_entry->size_raw, file);
+  char filepath[FILE_MAX];
+  seq_disk_cache_get_pack_path(store, pack_id, filepath, sizeof(filepath));
+  BLI_delete(filepath, false, false);
+  store->index.remove_pack(pack_id);
+  store->size_total -= size_t(store->pack_sizes.pop_default(pack_id, 0));
 }
 
-static bool seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
+/** Delete pack files which only contain invalidated images. Requires #DiskCacheStore::mutex. */
+static void seq_disk_cache_delete_unused_packs(DiskCacheStore *store)
 {
-  BLI_fseek(file, 0LL, SEEK_SET);
-  const size_t num_items_read = fread(header, sizeof(*header), 1, file);
-  if (num_items_read < 1) {
-    BLI_assert_msg(0, "unable to read disk cache header");
-    perror("unable to read disk cache header");
-    return false;
+  const Vector<uint32_t> pack_ids_on_disk(store->pack_sizes.keys().begin(),
+                                          store->pack_sizes.keys().end());
+  const Vector<uint32_t> pack_ids_used = store->index.pack_ids();
+  for (const uint32_t pack_id : pack_ids_on_disk) {
+    if (pack_id != store->pack_active && !pack_ids_used.contains(pack_id)) {
+      seq_disk_cache_delete_pack(store, pack_id);
+    }
   }
+}
 
-  for (int i = 0; i < DCACHE_IMAGES_PER_FILE; i++) {
-    if ((ENDIAN_ORDER == B_ENDIAN) && header->entry[i].encoding == 0) {
-      BLI_endian_switch_uint64(&header->entry[i].frameno);
-      BLI_endian_switch_uint64(&header->entry[i].offset);
-      BLI_endian_switch_uint64(&header->entry[i].size_compressed);
-      BLI_endian_switch_uint64(&header->entry[i].size_raw);
+/**
+ * Delete the pack files containing the least recently used images until the size limit is met.
+ * Requires both #DiskCacheStore::write_mutex and #DiskCacheStore::mutex.
+ */
+static void seq_disk_cache_store_enforce_limits(DiskCacheStore *store)
+{
+  seq_disk_cache_delete_unused_packs(store);
+  while (store->size_total + store->size_other > seq_disk_cache_size_limit()) {
+    const DiskCacheEntry *oldest_entry = store->index.least_recently_used();
+    if (oldest_entry == nullptr) {
+      break;
     }
+    seq_disk_cache_delete_pack(store, oldest_entry->pack_id);
   }
-
-  return true;
 }
 
-static size_t seq_disk_cache_write_header(FILE *file, const DiskCacheHeader *header)
+static size_t seq_disk_cache_imbuf_size(ImBuf *ibuf)
 {
-  BLI_fseek(file, 0LL, SEEK_SET);
-  return fwrite(header, sizeof(*header), 1, file);
+  if (ibuf->byte_buffer.data) {
+    return size_t(ibuf->x) * ibuf->y * ibuf->channels;
+  }
+  return size_t(ibuf->x) * ibuf->y * ibuf->channels * 4;
 }
 
-static int seq_disk_cache_add_header_entry(const SeqCacheKey *key,
-                                           ImBuf *ibuf,
-                                           DiskCacheHeader *header)
+static size_t deflate_imbuf_to_file(ImBuf *ibuf, FILE *file, int level, DiskCacheEntry *entry)
 {
-  int i;
-  uint64_t offset = sizeof(*header);
+  void *data = (ibuf->byte_buffer.data != nullptr) ? (void *)ibuf->byte_buffer.data :
+                                                     (void *)ibuf->float_buffer.data;
 
-  /* Lookup free entry, get offset for new data. */
-  for (i = 0; i < DCACHE_IMAGES_PER_FILE; i++) {
-    if (header->entry[i].size_compressed == 0) {
-      break;
-    }
+  /* Apply compression if wanted, otherwise just write directly to the file. */
+  if (level > 0) {
+    return BLI_file_zstd_from_mem_at_pos(data, entry->size_raw, file, entry->offset, level);
   }
 
-  /* Attempt to write beyond set entry limit.
-   * Reset file header and start writing from beginning.
-   */
-  if (i == DCACHE_IMAGES_PER_FILE) {
-    i = 0;
-    memset(header, 0, sizeof(*header));
-  }
+  BLI_fseek(file, int64_t(entry->offset), SEEK_SET);
+  return fwrite(data, 1, entry->size_raw, file);
+}
 
-  /* Calculate offset for image data. */
-  if (i > 0) {
-    offset = header->entry[i - 1].offset + header->entry[i - 1].size_compressed;
+static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, const DiskCacheEntry *entry)
+{
+  void *data = (ibuf->byte_buffer.data != nullptr) ? (void *)ibuf->byte_buffer.data :
+                                                     (void *)ibuf->float_buffer.data;
+  char header[4];
+  BLI_fseek(file, int64_t(entry->offset), SEEK_SET);
+  if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+    return 0;
   }
 
-  if (ENDIAN_ORDER == B_ENDIAN) {
-    header->entry[i].encoding = 255;
-  }
-  else {
-    header->entry[i].encoding = 0;
+  /* Check if the data is compressed or raw. */
+  if (BLI_file_magic_is_zstd(header)) {
+    return BLI_file_unzstd_to_mem_at_pos(data, entry->size_raw, file, entry->offset);
   }
 
-  header->entry[i].offset = offset;
-  header->entry[i].frameno = key->frame_index;
+  BLI_fseek(file, int64_t(entry->offset), SEEK_SET);
+  return fread(data, 1, entry->size_raw, file);
+}
 
-  /* Store colorspace name of ibuf. */
-  const char *colorspace_name;
-  if (ibuf->byte_buffer.data) {
-    header->entry[i].size_raw = int64_t(ibuf->x) * ibuf->y * ibuf->channels;
-    colorspace_name = IMB_colormanagement_get_rect_colorspace(ibuf);
-  }
-  else {
-    header->entry[i].size_raw = int64_t(ibuf->x) * ibuf->y * ibuf->channels * 4;
-    colorspace_name = IMB_colormanagement_get_float_colorspace(ibuf);
+/** Append the image to the active pack file and add it to the index. */
+static bool seq_disk_cache_store_write(DiskCacheStore *store,
+                                       const DiskCacheKey &key,
+                                       ImBuf *ibuf)
+{
+  std::scoped_lock write_lock(store->write_mutex);
+
+  /* List the other projects without blocking reading. */
+  std::optional<size_t> size_other;
+  const double time = BLI_time_now_seconds();
+  if (time - store->size_other_time > DCACHE_SIZE_OTHER_UPDATE_INTERVAL) {
+    size_other = seq_disk_cache_other_projects_size(store->dir);
+    store->size_other_time = time;
   }
-  STRNCPY(header->entry[i].colorspace_name, colorspace_name);
 
-  return i;
-}
+  DiskCacheEntry entry = {};
+  {
+    std::scoped_lock lock(store->mutex);
+    if (size_other) {
+      store->size_other = *size_other;
+    }
+    if (store->pending_writes.lookup_default(key, nullptr) != ibuf) {
+      /* Invalidated, or replaced by a newer image while waiting. */
+      return false;
+    }
 
-static int seq_disk_cache_get_header_entry(const SeqCacheKey *key, const DiskCacheHeader *header)
-{
-  for (int i = 0; i < DCACHE_IMAGES_PER_FILE; i++) {
-    if (header->entry[i].frameno == key->frame_index) {
-      return i;
+    /* Start a new pack file when needed. */
+    if (store->pack_active != 0 &&
+        store->pack_sizes.lookup_default(store->pack_active, 0) >=
+            seq_disk_cache_pack_size_limit())
+    {
+      fclose(store->pack_active_file);
+      store->pack_active_file = nullptr;
+      store->pack_active = 0;
+    }
+    if (store->pack_active == 0) {
+      const uint32_t pack_id = store->pack_id_last + 1;
+      char filepath[FILE_MAX];
+      seq_disk_cache_get_pack_path(store, pack_id, filepath, sizeof(filepath));
+      BLI_file_ensure_parent_dir_exists(filepath);
+      store->pack_active_file = BLI_fopen(filepath, "wb");
+      if (store->pack_active_file == nullptr) {
+        store->pending_writes.remove(key);
+        return false;
+      }
+      store->pack_id_last = pack_id;
+      store->pack_active = pack_id;
+      store->pack_sizes.add(pack_id, 0);
+    }
+    entry.offset = store->pack_sizes.lookup(store->pack_active);
+  }
+
+  entry.key = key;
+  entry.pack_id = store->pack_active;
+  entry.size_raw = seq_disk_cache_imbuf_size(ibuf);
+  const char *colorspace_name = ibuf->byte_buffer.data ?
+                                    IMB_colormanagement_get_rect_colorspace(ibuf) :
+                                    IMB_colormanagement_get_float_colorspace(ibuf);
+  STRNCPY(entry.colorspace_name, colorspace_name);
+
+  /* Compress and write without blocking reading. */
+  entry.size_stored = deflate_imbuf_to_file(
+      ibuf, store->pack_active_file, seq_disk_cache_compression_level(), &entry);
+  const bool written = entry.size_stored != 0 && fflush(store->pack_active_file) == 0;
+
+  std::scoped_lock lock(store->mutex);
+  const bool is_pending = store->pending_writes.lookup_default(key, nullptr) == ibuf;
+  if (is_pending) {
+    store->pending_writes.remove(key);
+  }
+  if (written) {
+    store->pack_sizes.lookup(store->pack_active) += entry.size_stored;
+    store->size_total += entry.size_stored;
+    if (is_pending) {
+      store->index.add(entry);
     }
   }
-
-  return -1;
+  seq_disk_cache_store_enforce_limits(store);
+  return written && is_pending;
 }
 
-bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
+static void seq_disk_cache_write_task(TaskPool *__restrict /*pool*/, void *taskdata)
 {
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
-
-  char filepath[FILE_MAX];
+  DiskCacheWriteTask *task = static_cast<DiskCacheWriteTask *>(taskdata);
+  seq_disk_cache_store_write(task->store, task->key, task->ibuf);
+}
 
-  seq_disk_cache_get_file_path(disk_cache, key, filepath, sizeof(filepath));
-  BLI_file_ensure_parent_dir_exists(filepath);
+static void seq_disk_cache_write_task_free(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  DiskCacheWriteTask *task = static_cast<DiskCacheWriteTask *>(taskdata);
+  IMB_freeImBuf(task->ibuf);
+  MEM_delete(task);
+}
 
-  /* Touch the file. */
-  FILE *file = BLI_fopen(filepath, "rb+");
-  if (!file) {
-    file = BLI_fopen(filepath, "wb+");
-    if (!file) {
-      BLI_mutex_unlock(&disk_cache->read_write_mutex);
-      return false;
-    }
-    seq_disk_cache_add_file_to_list(disk_cache, filepath);
-  }
+bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
+{
+  DiskCacheStore *store = disk_cache->store;
+  const DiskCacheKey disk_key = seq_disk_cache_key(disk_cache, key);
 
-  DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, filepath);
-  DiskCacheHeader header;
-  memset(&header, 0, sizeof(header));
-  /* The file may be empty when touched (above).
-   * This is fine, don't attempt reading the header in that case. */
-  if (cache_file->fstat.st_size != 0 && !seq_disk_cache_read_header(file, &header)) {
-    fclose(file);
-    seq_disk_cache_delete_file(disk_cache, cache_file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return false;
+  bool write_async;
+  {
+    std::scoped_lock lock(store->mutex);
+    write_async = store->pending_writes.size() < DCACHE_PENDING_WRITES_MAX;
+    store->pending_writes.add_overwrite(disk_key, ibuf);
   }
-  int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
-
-  size_t bytes_written = deflate_imbuf_to_file(
-      ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
-
-  if (bytes_written != 0) {
-    /* Last step is writing header, as image data can be overwritten,
-     * but missing data would cause problems.
-     */
-    header.entry[entry_index].size_compressed = bytes_written;
-    seq_disk_cache_write_header(file, &header);
-    seq_disk_cache_update_file(disk_cache, filepath);
-    fclose(file);
 
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return true;
+  IMB_refImBuf(ibuf);
+  if (!write_async) {
+    /* Keep the number of images waiting to be written (and their memory) bounded. */
+    const bool written = seq_disk_cache_store_write(store, disk_key, ibuf);
+    IMB_freeImBuf(ibuf);
+    return written;
   }
 
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
-  return false;
+  DiskCacheWriteTask *task = MEM_new<DiskCacheWriteTask>(__func__);
+  task->store = store;
+  task->key = disk_key;
+  task->ibuf = ibuf;
+  BLI_task_pool_push(
+      store->write_pool, seq_disk_cache_write_task, task, false, seq_disk_cache_write_task_free);
+  return true;
 }
 
 ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key)
 {
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  DiskCacheStore *store = disk_cache->store;
+  const DiskCacheKey disk_key = seq_disk_cache_key(disk_cache, key);
 
-  char filepath[FILE_MAX];
-  DiskCacheHeader header;
+  /* Only find the image while locked, reading and decompressing doesn't block other threads. */
+  DiskCacheEntry entry;
+  {
+    std::scoped_lock lock(store->mutex);
 
-  seq_disk_cache_get_file_path(disk_cache, key, filepath, sizeof(filepath));
-  BLI_file_ensure_parent_dir_exists(filepath);
+    if (ImBuf *ibuf = store->pending_writes.lookup_default(disk_key, nullptr)) {
+      IMB_refImBuf(ibuf);
+      return ibuf;
+    }
 
-  FILE *file = BLI_fopen(filepath, "rb");
-  if (!file) {
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return nullptr;
-  }
+    const DiskCacheEntry *entry_ptr = store->index.lookup(disk_key);
 
-  if (!seq_disk_cache_read_header(file, &header)) {
-    fclose(file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return nullptr;
-  }
-  int entry_index = seq_disk_cache_get_header_entry(key, &header);
-
-  /* Item not found. */
-  if (entry_index < 0) {
-    fclose(file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return nullptr;
+    /* Item not found. */
+    if (entry_ptr == nullptr) {
+      return nullptr;
+    }
+    entry = *entry_ptr;
   }
 
-  ImBuf *ibuf;
+  ImBuf *ibuf = nullptr;
   uint64_t size_char = uint64_t(key->context.rectx) * key->context.recty * 4;
   uint64_t size_float = uint64_t(key->context.rectx) * key->context.recty * 16;
-  size_t expected_size;
+  size_t expected_size = 0;
+  size_t bytes_read = 0;
 
-  if (header.entry[entry_index].size_raw == size_char) {
+  if (entry.size_raw == size_char) {
     expected_size = size_char;
     ibuf = IMB_allocImBuf(
         key->context.rectx, key->context.recty, 32, IB_byte_data | IB_uninitialized_pixels);
-    IMB_colormanagement_assign_byte_colorspace(ibuf, header.entry[entry_index].colorspace_name);
+    IMB_colormanagement_assign_byte_colorspace(ibuf, entry.colorspace_name);
   }
-  else if (header.entry[entry_index].size_raw == size_float) {
+  else if (entry.size_raw == size_float) {
     expected_size = size_float;
     ibuf = IMB_allocImBuf(
         key->context.rectx, key->context.recty, 32, IB_float_data | IB_uninitialized_pixels);
-    IMB_colormanagement_assign_float_colorspace(ibuf, header.entry[entry_index].colorspace_name);
-  }
-  else {
-    fclose(file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return nullptr;
+    IMB_colormanagement_assign_float_colorspace(ibuf, entry.colorspace_name);
   }
 
-  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header.entry[entry_index]);
+  if (ibuf) {
+    char filepath[FILE_MAX];
+    seq_disk_cache_get_pack_path(store, entry.pack_id, filepath, sizeof(filepath));
+    /* The pack file may be deleted meanwhile, then opening or reading fails. */
+    FILE *file = BLI_fopen(filepath, "rb");
+    if (file) {
+      bytes_read = inflate_file_to_imbuf(ibuf, file, &entry);
+      fclose(file);
+    }
+  }
 
   /* Sanity check. */
-  if (bytes_read != expected_size) {
-    fclose(file);
-    IMB_freeImBuf(ibuf);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  if (ibuf == nullptr || bytes_read != expected_size) {
+    if (ibuf) {
+      IMB_freeImBuf(ibuf);
+    }
+    std::scoped_lock lock(store->mutex);
+    /* Only remove the entry when it wasn't replaced by a newer image while reading. */
+    const DiskCacheEntry *entry_ptr = store->index.lookup(disk_key);
+    if (entry_ptr && entry_ptr->pack_id == entry.pack_id && entry_ptr->offset == entry.offset) {
+      store->index.remove(disk_key);
+    }
     return nullptr;
   }
-  BLI_file_touch(filepath);
-  seq_disk_cache_update_file(disk_cache, filepath);
-  fclose(file);
 
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
   return ibuf;
 }
 
+void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
+                               Scene *scene,
+                               Strip *strip,
+                               Strip *strip_changed,
+                               int invalidate_types)
+{
+  DiskCacheStore *store = disk_cache->store;
+  const uint64_t strip_hash = seq_disk_cache_strip_hash(disk_cache, scene, strip);
+  const int start = time_left_handle_frame_get(scene, strip_changed);
+  const int end = time_right_handle_frame_get(scene, strip_changed);
+
+  auto is_invalid = [&](const DiskCacheKey &key) {
+    if (key.strip_hash != strip_hash || (key.type & invalidate_types) == 0) {
+      return false;
+    }
+    const float timeline_frame = seq_cache_frame_index_to_timeline_frame(strip, key.frame_index);
+    return timeline_frame >= start && timeline_frame <= end;
+  };
+
+  std::scoped_lock lock(store->mutex);
+
+  store->index.remove_strip_entries(
+      strip_hash, [&](const DiskCacheEntry &entry) { return is_invalid(entry.key); });
+  store->pending_writes.remove_if(
+      [&](const auto &item) { return is_invalid(item.key); });
+
+  seq_disk_cache_delete_unused_packs(store);
+}
+
 SeqDiskCache *seq_disk_cache_create(Main *bmain, Scene *scene)
 {
   SeqDiskCache *disk_cache = MEM_callocN<SeqDiskCache>("SeqDiskCache");
   disk_cache->bmain = bmain;
-  BLI_mutex_init(&disk_cache->read_write_mutex);
-  seq_disk_cache_handle_versioning(disk_cache);
-  seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
   disk_cache->timestamp = scene->ed->disk_cache_timestamp;
-  BLI_mutex_unlock(&cache_create_lock);
+  /* The project directory doesn't follow renaming the blend file while the cache exists. */
+  char dir[FILE_MAX];
+  seq_disk_cache_get_project_dir(disk_cache, dir, sizeof(dir));
+  disk_cache->store = seq_disk_cache_store_acquire(dir);
   return disk_cache;
 }
 
 void seq_disk_cache_free(SeqDiskCache *disk_cache)
 {
-  BLI_freelistN(&disk_cache->files);
-  BLI_mutex_end(&disk_cache->read_write_mutex);
+  seq_disk_cache_store_release(disk_cache->store);
   MEM_freeN(disk_cache);
 }
 
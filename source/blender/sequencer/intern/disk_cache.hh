@@ -25,8 +25,11 @@ SeqDiskCache *seq_disk_cache_create(Main *bmain, Scene *scene);
 void seq_disk_cache_free(SeqDiskCache *disk_cache);
 bool seq_disk_cache_is_enabled(Main *bmain);
 ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key);
+/**
+ * Queue the image to be written in the background, the size limit of the cache is enforced after
+ * writing.
+ */
 bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf);
-bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache);
 void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
                                Scene *scene,
                                Strip *strip,
@@ -0,0 +1,408 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup sequencer
+ */
+
+#include <cstring>
+
+#include "BLI_fileops.h"
+
+#include "disk_cache_index.hh"
+
+/**
+ * Journal Format
+ * ==============
+ *
+ * The journal starts with #DiskCacheJournalHeader, followed by fixed size #DiskCacheRecord.
+ * Replaying the records in order restores the entries and their least recently used order, so a
+ * lookup appends a record too. A record which was only partially written (e.g. on a crash) is
+ * ignored. The journal is rewritten with one record per entry once most records are outdated,
+ * when opening and while the index is used, so lookups don't grow it without bound.
+ *
+ * The journal is flushed at the end of every change of the entries, but not after a lookup: a
+ * lost lookup record only changes which image is removed first, and lookups happen for every
+ * displayed frame. Their records are written with the next change or when closing the index.
+ */
+
+namespace blender::seq {
+
+#define DCACHE_JOURNAL_VERSION 1
+
+/** Records are only compacted when there are at least this many outdated ones. */
+#define DCACHE_JOURNAL_COMPACT_MIN 1024
+
+static const char dcache_journal_magic[8] = {'B', 'S', 'E', 'Q', 'D', 'C', 'I', 'X'};
+
+enum DiskCacheRecordOp : uint32_t {
+  DCACHE_RECORD_ADD = 1,
+  DCACHE_RECORD_REMOVE = 2,
+  DCACHE_RECORD_TOUCH = 3,
+  DCACHE_RECORD_REMOVE_PACK = 4,
+};
+
+struct DiskCacheJournalHeader {
+  char magic[8];
+  uint32_t version;
+  /** Size of #DiskCacheRecord, to detect journals written by an incompatible build. */
+  uint32_t record_size;
+};
+
+struct DiskCacheRecord {
+  /** #DiskCacheRecordOp. */
+  uint32_t op;
+  uint32_t _pad;
+  /** Only the key is used when removing or touching an entry, only the pack when removing a
+   * pack. */
+  DiskCacheEntry entry;
+};
+
+DiskCacheIndex::~DiskCacheIndex()
+{
+  this->close();
+}
+
+bool DiskCacheIndex::open(StringRefNull journal_path)
+{
+  this->close();
+  journal_path_ = journal_path;
+  journal_records_num_ = 0;
+
+  bool is_valid = true;
+  /* Write a new journal when it doesn't exist yet, or can't be appended to. */
+  bool needs_rewrite = true;
+  if (FILE *file = BLI_fopen(journal_path.c_str(), "rb")) {
+    DiskCacheJournalHeader header;
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, dcache_journal_magic, sizeof(header.magic)) == 0 &&
+        header.version == DCACHE_JOURNAL_VERSION && header.record_size == sizeof(DiskCacheRecord))
+    {
+      /* Records appended after a partially written one would be misaligned. */
+      const size_t records_size = BLI_file_descriptor_size(fileno(file)) - sizeof(header);
+      needs_rewrite = records_size % sizeof(DiskCacheRecord) != 0;
+
+      /* Read in batches, there can be millions of records. */
+      Vector<DiskCacheRecord> records(4096);
+      size_t records_num;
+      while ((records_num = fread(records.data(), sizeof(DiskCacheRecord), 4096, file)) > 0) {
+        for (const DiskCacheRecord &record : records.as_span().take_front(records_num)) {
+          switch (record.op) {
+            case DCACHE_RECORD_ADD:
+              this->slot_add(record.entry);
+              break;
+            case DCACHE_RECORD_REMOVE:
+              if (const int64_t *slot_index = slot_by_key_.lookup_ptr(record.entry.key)) {
+                this->slot_remove(*slot_index);
+              }
+              break;
+            case DCACHE_RECORD_TOUCH:
+              if (const int64_t *slot_index = slot_by_key_.lookup_ptr(record.entry.key)) {
+                this->lru_unlink(*slot_index);
+                this->lru_append(*slot_index);
+              }
+              break;
+            case DCACHE_RECORD_REMOVE_PACK:
+              if (const Set<int64_t> *pack_slots = slots_by_pack_.lookup_ptr(
+                      record.entry.pack_id))
+              {
+                for (const int64_t slot_index : Vector<int64_t>(pack_slots->begin(),
+                                                                pack_slots->end()))
+                {
+                  this->slot_remove(slot_index);
+                }
+              }
+              break;
+            default:
+              is_valid = false;
+              break;
+          }
+        }
+        journal_records_num_ += int64_t(records_num);
+      }
+    }
+    else {
+      is_valid = false;
+    }
+    fclose(file);
+  }
+
+  if (!is_valid) {
+    slots_.clear();
+    free_slots_.clear();
+    slot_by_key_.clear();
+    slots_by_strip_.clear();
+    slots_by_pack_.clear();
+    lru_first_ = lru_last_ = -1;
+  }
+
+  if (!is_valid || needs_rewrite || this->journal_needs_compact()) {
+    if (!this->journal_write_snapshot()) {
+      return false;
+    }
+  }
+
+  journal_ = BLI_fopen(journal_path_.c_str(), "ab");
+  return is_valid && journal_ != nullptr;
+}
+
+void DiskCacheIndex::close()
+{
+  if (journal_) {
+    fclose(journal_);
+    journal_ = nullptr;
+  }
+}
+
+const DiskCacheEntry *DiskCacheIndex::lookup(const DiskCacheKey &key)
+{
+  const int64_t *slot_index = slot_by_key_.lookup_ptr(key);
+  if (slot_index == nullptr) {
+    return nullptr;
+  }
+  Slot &slot = slots_[*slot_index];
+  if (lru_last_ != *slot_index) {
+    this->lru_unlink(*slot_index);
+    this->lru_append(*slot_index);
+    this->journal_append(DCACHE_RECORD_TOUCH, slot.entry);
+    this->journal_compact_if_needed();
+  }
+  return &slot.entry;
+}
+
+void DiskCacheIndex::add(const DiskCacheEntry &entry)
+{
+  this->slot_add(entry);
+  this->journal_append(DCACHE_RECORD_ADD, entry);
+  this->journal_flush();
+  this->journal_compact_if_needed();
+}
+
+bool DiskCacheIndex::remove(const DiskCacheKey &key)
+{
+  const int64_t *slot_index = slot_by_key_.lookup_ptr(key);
+  if (slot_index == nullptr) {
+    return false;
+  }
+  this->journal_append(DCACHE_RECORD_REMOVE, slots_[*slot_index].entry);
+  this->slot_remove(*slot_index);
+  this->journal_flush();
+  this->journal_compact_if_needed();
+  return true;
+}
+
+int64_t DiskCacheIndex::remove_strip_entries(
+    const uint64_t strip_hash, const FunctionRef<bool(const DiskCacheEntry &entry)> predicate)
+{
+  const Set<int64_t> *strip_slots = slots_by_strip_.lookup_ptr(strip_hash);
+  if (strip_slots == nullptr) {
+    return 0;
+  }
+  Vector<int64_t> slots_to_remove;
+  for (const int64_t slot_index : *strip_slots) {
+    if (predicate(slots_[slot_index].entry)) {
+      slots_to_remove.append(slot_index);
+    }
+  }
+  for (const int64_t slot_index : slots_to_remove) {
+    this->journal_append(DCACHE_RECORD_REMOVE, slots_[slot_index].entry);
+    this->slot_remove(slot_index);
+  }
+  if (!slots_to_remove.is_empty()) {
+    this->journal_flush();
+    this->journal_compact_if_needed();
+  }
+  return slots_to_remove.size();
+}
+
+int64_t DiskCacheIndex::remove_pack(const uint32_t pack_id)
+{
+  const Set<int64_t> *pack_slots = slots_by_pack_.lookup_ptr(pack_id);
+  if (pack_slots == nullptr) {
+    return 0;
+  }
+  const Vector<int64_t> slots_to_remove(pack_slots->begin(), pack_slots->end());
+  DiskCacheEntry record_entry = {};
+  record_entry.pack_id = pack_id;
+  this->journal_append(DCACHE_RECORD_REMOVE_PACK, record_entry);
+  for (const int64_t slot_index : slots_to_remove) {
+    this->slot_remove(slot_index);
+  }
+  this->journal_flush();
+  this->journal_compact_if_needed();
+  return slots_to_remove.size();
+}
+
+const DiskCacheEntry *DiskCacheIndex::least_recently_used() const
+{
+  return lru_first_ == -1 ? nullptr : &slots_[lru_first_].entry;
+}
+
+Vector<uint32_t> DiskCacheIndex::pack_ids() const
+{
+  Vector<uint32_t> pack_ids;
+  for (const uint32_t pack_id : slots_by_pack_.keys()) {
+    pack_ids.append(pack_id);
+  }
+  return pack_ids;
+}
+
+void DiskCacheIndex::slot_add(const DiskCacheEntry &entry)
+{
+  if (const int64_t *slot_index = slot_by_key_.lookup_ptr(entry.key)) {
+    this->slot_remove(*slot_index);
+  }
+
+  int64_t slot_index;
+  if (free_slots_.is_empty()) {
+    slot_index = slots_.append_and_get_index({});
+  }
+  else {
+    slot_index = free_slots_.pop_last();
+  }
+  slots_[slot_index].entry = entry;
+  this->lru_append(slot_index);
+
+  slot_by_key_.add_new(entry.key, slot_index);
+  slots_by_strip_.lookup_or_add_default(entry.key.strip_hash).add_new(slot_index);
+  slots_by_pack_.lookup_or_add_default(entry.pack_id).add_new(slot_index);
+}
+
+void DiskCacheIndex::slot_remove(const int64_t slot_index)
+{
+  const DiskCacheEntry &entry = slots_[slot_index].entry;
+  slot_by_key_.remove(entry.key);
+
+  Set<int64_t> &strip_slots = slots_by_strip_.lookup(entry.key.strip_hash);
+  strip_slots.remove(slot_index);
+  if (strip_slots.is_empty()) {
+    slots_by_strip_.remove(entry.key.strip_hash);
+  }
+  Set<int64_t> &pack_slots = slots_by_pack_.lookup(entry.pack_id);
+  pack_slots.remove(slot_index);
+  if (pack_slots.is_empty()) {
+    slots_by_pack_.remove(entry.pack_id);
+  }
+
+  this->lru_unlink(slot_index);
+  free_slots_.append(slot_index);
+}
+
+void DiskCacheIndex::lru_unlink(const int64_t slot_index)
+{
+  Slot &slot = slots_[slot_index];
+  if (slot.lru_prev == -1) {
+    lru_first_ = slot.lru_next;
+  }
+  else {
+    slots_[slot.lru_prev].lru_next = slot.lru_next;
+  }
+  if (slot.lru_next == -1) {
+    lru_last_ = slot.lru_prev;
+  }
+  else {
+    slots_[slot.lru_next].lru_prev = slot.lru_prev;
+  }
+  slot.lru_prev = slot.lru_next = -1;
+}
+
+void DiskCacheIndex::lru_append(const int64_t slot_index)
+{
+  Slot &slot = slots_[slot_index];
+  slot.lru_prev = lru_last_;
+  slot.lru_next = -1;
+  if (lru_last_ == -1) {
+    lru_first_ = slot_index;
+  }
+  else {
+    slots_[lru_last_].lru_next = slot_index;
+  }
+  lru_last_ = slot_index;
+}
+
+void DiskCacheIndex::journal_append(const uint32_t op, const DiskCacheEntry &entry)
+{
+  if (journal_ == nullptr) {
+    return;
+  }
+  DiskCacheRecord record = {};
+  record.op = op;
+  record.entry = entry;
+  fwrite(&record, sizeof(record), 1, journal_);
+  journal_records_num_++;
+}
+
+void DiskCacheIndex::journal_flush()
+{
+  /* Keep the journal complete when Blender exits without freeing the cache. */
+  if (journal_) {
+    fflush(journal_);
+  }
+}
+
+bool DiskCacheIndex::journal_needs_compact() const
+{
+  return journal_records_num_ > std::max<int64_t>(this->size() * 2, DCACHE_JOURNAL_COMPACT_MIN);
+}
+
+void DiskCacheIndex::journal_compact_if_needed()
+{
+  if (journal_ == nullptr || !this->journal_needs_compact()) {
+    return;
+  }
+  /* Pending records are part of the snapshot, the old journal is replaced as a whole. */
+  fclose(journal_);
+  journal_ = nullptr;
+  if (!this->journal_write_snapshot()) {
+    /* Keep appending to the old journal, try again after as many records. */
+    journal_records_num_ = 0;
+  }
+  journal_ = BLI_fopen(journal_path_.c_str(), "ab");
+}
+
+bool DiskCacheIndex::journal_write_snapshot()
+{
+  BLI_file_ensure_parent_dir_exists(journal_path_.c_str());
+  const std::string tmp_path = journal_path_ + "@";
+  FILE *file = BLI_fopen(tmp_path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  DiskCacheJournalHeader header = {};
+  memcpy(header.magic, dcache_journal_magic, sizeof(header.magic));
+  header.version = DCACHE_JOURNAL_VERSION;
+  header.record_size = sizeof(DiskCacheRecord);
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  /* Write from least to most recently used, so replaying restores the order. */
+  Vector<DiskCacheRecord> records;
+  records.reserve(std::min<int64_t>(this->size(), 4096));
+  auto flush = [&]() {
+    ok = ok && fwrite(records.data(), sizeof(DiskCacheRecord), records.size(), file) ==
+                   size_t(records.size());
+    records.clear();
+  };
+  for (int64_t slot_index = lru_first_; slot_index != -1; slot_index = slots_[slot_index].lru_next)
+  {
+    DiskCacheRecord record = {};
+    record.op = DCACHE_RECORD_ADD;
+    record.entry = slots_[slot_index].entry;
+    records.append(record);
+    if (records.size() == 4096) {
+      flush();
+    }
+  }
+  flush();
+  ok = (fclose(file) == 0) && ok;
+
+  if (!ok || BLI_rename_overwrite(tmp_path.c_str(), journal_path_.c_str()) != 0) {
+    BLI_delete(tmp_path.c_str(), false, false);
+    return false;
+  }
+  journal_records_num_ = this->size();
+  return true;
+}
+
+}  // namespace blender::seq
@@ -0,0 +1,142 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup sequencer
+ *
+ * Persistent index of the images stored in the sequencer disk cache, with the least recently
+ * used order of the entries. Changes are appended to a journal file, which is replayed when the
+ * index is opened again.
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "BLI_function_ref.hh"
+#include "BLI_hash.hh"
+#include "BLI_map.hh"
+#include "BLI_set.hh"
+#include "BLI_string_ref.hh"
+#include "BLI_vector.hh"
+
+namespace blender::seq {
+
+#define DCACHE_COLORSPACE_NAME_MAX 64 /* XXX: defined in IMB intern. */
+
+/** Identifies an image in the disk cache, stable between sessions. */
+struct DiskCacheKey {
+  /** Hash of the scene name, the disk cache timestamp of the scene and the strip name. */
+  uint64_t strip_hash;
+  float frame_index;
+  int32_t type;
+  int32_t rectx;
+  int32_t recty;
+  int32_t render_size;
+  int32_t view_id;
+
+  uint64_t hash() const
+  {
+    return get_default_hash(get_default_hash(strip_hash, frame_index, type),
+                            get_default_hash(rectx, recty),
+                            get_default_hash(render_size, view_id));
+  }
+
+  friend bool operator==(const DiskCacheKey &a, const DiskCacheKey &b)
+  {
+    return a.strip_hash == b.strip_hash && a.frame_index == b.frame_index && a.type == b.type &&
+           a.rectx == b.rectx && a.recty == b.recty && a.render_size == b.render_size &&
+           a.view_id == b.view_id;
+  }
+};
+
+struct DiskCacheEntry {
+  DiskCacheKey key;
+  /** Pack file containing the image data. */
+  uint32_t pack_id;
+  uint32_t _pad;
+  /** Position of the image data in the pack file. */
+  uint64_t offset;
+  uint64_t size_stored;
+  uint64_t size_raw;
+  char colorspace_name[DCACHE_COLORSPACE_NAME_MAX];
+};
+
+class DiskCacheIndex {
+ private:
+  struct Slot {
+    DiskCacheEntry entry;
+    /** Neighbors in the least recently used order, -1 at the ends. */
+    int64_t lru_prev;
+    int64_t lru_next;
+  };
+
+  /** Entries are stored in slots which are reused after removal, to keep links stable. */
+  Vector<Slot> slots_;
+  Vector<int64_t> free_slots_;
+  Map<DiskCacheKey, int64_t> slot_by_key_;
+  Map<uint64_t, Set<int64_t>> slots_by_strip_;
+  Map<uint32_t, Set<int64_t>> slots_by_pack_;
+  int64_t lru_first_ = -1;
+  int64_t lru_last_ = -1;
+
+  std::string journal_path_;
+  FILE *journal_ = nullptr;
+  int64_t journal_records_num_ = 0;
+
+ public:
+  DiskCacheIndex() = default;
+  DiskCacheIndex(const DiskCacheIndex &other) = delete;
+  DiskCacheIndex &operator=(const DiskCacheIndex &other) = delete;
+  ~DiskCacheIndex();
+
+  /**
+   * Load the index from the journal file, which is created when it doesn't exist yet. The journal
+   * is compacted whenever it contains many records of removed or updated entries.
+   *
+   * \return False when an existing journal couldn't be read, the index is empty then and the
+   * journal is started over.
+   */
+  bool open(StringRefNull journal_path);
+  /** Stop recording changes, the index stays usable in memory. */
+  void close();
+
+  int64_t size() const
+  {
+    return slot_by_key_.size();
+  }
+
+  /** Find an entry and mark it as the most recently used one. */
+  const DiskCacheEntry *lookup(const DiskCacheKey &key);
+  /** Add an entry as the most recently used one, replacing an entry with the same key. */
+  void add(const DiskCacheEntry &entry);
+  bool remove(const DiskCacheKey &key);
+  /** Remove the entries of a strip for which the predicate is true. */
+  int64_t remove_strip_entries(uint64_t strip_hash,
+                               FunctionRef<bool(const DiskCacheEntry &entry)> predicate);
+  /** Remove all entries stored in a pack file. */
+  int64_t remove_pack(uint32_t pack_id);
+
+  const DiskCacheEntry *least_recently_used() const;
+  /** Pack files referenced by at least one entry. */
+  Vector<uint32_t> pack_ids() const;
+
+ private:
+  void slot_add(const DiskCacheEntry &entry);
+  void slot_remove(int64_t slot_index);
+  void lru_unlink(int64_t slot_index);
+  void lru_append(int64_t slot_index);
+
+  /** Records are buffered until #journal_flush or #close. */
+  void journal_append(uint32_t op, const DiskCacheEntry &entry);
+  void journal_flush();
+  /** Most records are about removed or updated entries. */
+  bool journal_needs_compact() const;
+  /** Rewrite the journal with one record per entry when it needs to be compacted. */
+  void journal_compact_if_needed();
+  bool journal_write_snapshot();
+};
+
+}  // namespace blender::seq
@@ -0,0 +1,294 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <string>
+
+#include "BLI_fileops.h"
+#include "BLI_index_range.hh"
+#include "BLI_path_utils.hh"
+#include "BLI_system.h"
+#include "BLI_tempfile.h"
+#include "BLI_timeit.hh"
+
+#include BLI_SYSTEM_PID_H
+
+#include "disk_cache_index.hh"
+
+#define DO_PERF_TESTS 0
+
+namespace blender::seq::tests {
+
+class DiskCacheIndexTest : public testing::Test {
+ public:
+  std::string temp_dir;
+  std::string journal_path;
+
+  void SetUp() override
+  {
+    char temp_dir_c[FILE_MAX];
+    BLI_temp_directory_path_get(temp_dir_c, sizeof(temp_dir_c));
+    temp_dir = std::string(temp_dir_c) + SEP_STR + "blender_seq_disk_cache_index_test_" +
+               std::to_string(getpid());
+    journal_path = temp_dir + SEP_STR + "index.dci";
+  }
+
+  void TearDown() override
+  {
+    if (BLI_exists(temp_dir.c_str())) {
+      BLI_delete(temp_dir.c_str(), true, true);
+    }
+  }
+};
+
+static DiskCacheEntry test_entry(const uint64_t strip_hash,
+                                 const float frame_index,
+                                 const uint32_t pack_id = 1)
+{
+  DiskCacheEntry entry = {};
+  entry.key.strip_hash = strip_hash;
+  entry.key.frame_index = frame_index;
+  entry.key.type = 1;
+  entry.key.rectx = 1920;
+  entry.key.recty = 1080;
+  entry.key.render_size = 100;
+  entry.pack_id = pack_id;
+  entry.offset = uint64_t(frame_index) * 1000;
+  entry.size_stored = 1000;
+  entry.size_raw = 1920 * 1080 * 4;
+  return entry;
+}
+
+TEST_F(DiskCacheIndexTest, AddLookupRemove)
+{
+  DiskCacheIndex index;
+  EXPECT_TRUE(index.open(journal_path));
+
+  index.add(test_entry(1, 10.0f));
+  index.add(test_entry(1, 11.0f));
+  index.add(test_entry(2, 10.0f));
+  EXPECT_EQ(index.size(), 3);
+
+  const DiskCacheEntry *entry = index.lookup(test_entry(1, 11.0f).key);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->offset, 11000);
+  EXPECT_EQ(index.lookup(test_entry(3, 10.0f).key), nullptr);
+
+  /* Adding the same key replaces the entry. */
+  DiskCacheEntry replaced = test_entry(1, 11.0f, 2);
+  index.add(replaced);
+  EXPECT_EQ(index.size(), 3);
+  EXPECT_EQ(index.lookup(replaced.key)->pack_id, 2);
+
+  EXPECT_TRUE(index.remove(replaced.key));
+  EXPECT_FALSE(index.remove(replaced.key));
+  EXPECT_EQ(index.size(), 2);
+}
+
+TEST_F(DiskCacheIndexTest, LeastRecentlyUsed)
+{
+  DiskCacheIndex index;
+  index.open(journal_path);
+
+  for (int i = 0; i < 4; i++) {
+    index.add(test_entry(1, float(i)));
+  }
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 0.0f);
+
+  /* Looking up an entry makes it the most recently used one. */
+  index.lookup(test_entry(1, 0.0f).key);
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 1.0f);
+
+  index.remove(test_entry(1, 1.0f).key);
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 2.0f);
+  index.remove(test_entry(1, 2.0f).key);
+  index.remove(test_entry(1, 3.0f).key);
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 0.0f);
+  index.remove(test_entry(1, 0.0f).key);
+  EXPECT_EQ(index.least_recently_used(), nullptr);
+}
+
+TEST_F(DiskCacheIndexTest, RemoveStripEntriesAndPacks)
+{
+  DiskCacheIndex index;
+  index.open(journal_path);
+
+  for (int i = 0; i < 10; i++) {
+    index.add(test_entry(1, float(i), i < 5 ? 1 : 2));
+    index.add(test_entry(2, float(i), 3));
+  }
+
+  EXPECT_EQ(index.remove_strip_entries(
+                1, [](const DiskCacheEntry &entry) { return entry.key.frame_index >= 8.0f; }),
+            2);
+  EXPECT_EQ(index.size(), 18);
+  EXPECT_EQ(index.remove_pack(1), 5);
+  EXPECT_EQ(index.remove_pack(1), 0);
+  EXPECT_EQ(index.size(), 13);
+
+  Vector<uint32_t> pack_ids = index.pack_ids();
+  std::sort(pack_ids.begin(), pack_ids.end());
+  EXPECT_EQ(pack_ids.as_span(), Span<uint32_t>({2, 3}));
+}
+
+TEST_F(DiskCacheIndexTest, Persistence)
+{
+  {
+    DiskCacheIndex index;
+    EXPECT_TRUE(index.open(journal_path));
+    for (int i = 0; i < 6; i++) {
+      index.add(test_entry(1, float(i), i < 3 ? 1 : 2));
+    }
+    index.lookup(test_entry(1, 0.0f).key);
+    index.remove(test_entry(1, 1.0f).key);
+    index.remove_pack(2);
+  }
+
+  DiskCacheIndex index;
+  EXPECT_TRUE(index.open(journal_path));
+  EXPECT_EQ(index.size(), 2);
+  /* Frame 0 was looked up after adding frame 2. */
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 2.0f);
+  EXPECT_NE(index.lookup(test_entry(1, 0.0f).key), nullptr);
+  EXPECT_EQ(index.lookup(test_entry(1, 1.0f).key), nullptr);
+  EXPECT_EQ(index.lookup(test_entry(1, 4.0f).key), nullptr);
+}
+
+TEST_F(DiskCacheIndexTest, ChangesWrittenBeforeClose)
+{
+  DiskCacheIndex index;
+  EXPECT_TRUE(index.open(journal_path));
+  index.add(test_entry(1, 0.0f));
+  index.add(test_entry(1, 1.0f));
+  index.add(test_entry(1, 2.0f));
+  index.remove(test_entry(1, 1.0f).key);
+
+  /* Changes are in the journal while the index is still open, e.g. when Blender crashes. */
+  {
+    DiskCacheIndex other_index;
+    EXPECT_TRUE(other_index.open(journal_path));
+    EXPECT_EQ(other_index.size(), 2);
+    EXPECT_EQ(other_index.least_recently_used()->key.frame_index, 0.0f);
+  }
+
+  /* Lookups are written when closing. */
+  index.lookup(test_entry(1, 0.0f).key);
+  index.close();
+  EXPECT_TRUE(index.open(journal_path));
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 2.0f);
+}
+
+TEST_F(DiskCacheIndexTest, PartialRecordIgnored)
+{
+  {
+    DiskCacheIndex index;
+    index.open(journal_path);
+    index.add(test_entry(1, 0.0f));
+    index.add(test_entry(1, 1.0f));
+  }
+  /* Simulate a crash while appending a record. */
+  FILE *file = BLI_fopen(journal_path.c_str(), "ab");
+  ASSERT_NE(file, nullptr);
+  const char partial[7] = {};
+  fwrite(partial, sizeof(partial), 1, file);
+  fclose(file);
+
+  {
+    DiskCacheIndex index;
+    EXPECT_TRUE(index.open(journal_path));
+    EXPECT_EQ(index.size(), 2);
+    index.add(test_entry(1, 2.0f));
+  }
+
+  /* Records appended after the partial one are read back. */
+  DiskCacheIndex index;
+  EXPECT_TRUE(index.open(journal_path));
+  EXPECT_EQ(index.size(), 3);
+}
+
+TEST_F(DiskCacheIndexTest, InvalidJournal)
+{
+  BLI_file_ensure_parent_dir_exists(journal_path.c_str());
+  FILE *file = BLI_fopen(journal_path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  fputs("not a journal", file);
+  fclose(file);
+
+  DiskCacheIndex index;
+  EXPECT_FALSE(index.open(journal_path));
+  EXPECT_EQ(index.size(), 0);
+
+  /* The journal was started over. */
+  index.add(test_entry(1, 0.0f));
+  index.close();
+  EXPECT_TRUE(index.open(journal_path));
+  EXPECT_EQ(index.size(), 1);
+}
+
+TEST_F(DiskCacheIndexTest, JournalCompactedWhileOpen)
+{
+  DiskCacheIndex index;
+  EXPECT_TRUE(index.open(journal_path));
+  index.add(test_entry(1, 0.0f));
+  index.add(test_entry(1, 1.0f));
+
+  /* Every lookup of the least recently used entry appends a record. */
+  for ([[maybe_unused]] const int i : IndexRange(100000)) {
+    index.lookup(index.least_recently_used()->key);
+  }
+  index.close();
+  EXPECT_LT(BLI_file_size(journal_path.c_str()), 1024 * 1024);
+
+  EXPECT_TRUE(index.open(journal_path));
+  EXPECT_EQ(index.size(), 2);
+  EXPECT_EQ(index.least_recently_used()->key.frame_index, 0.0f);
+}
+
+#if DO_PERF_TESTS
+
+static void test_disk_cache_index_startup_and_eviction(const std::string &journal_path,
+                                                       const int entries_num)
+{
+  /* Entries of 1000 strips, 100 images per pack file. */
+  {
+    DiskCacheIndex index;
+    index.open(journal_path);
+    SCOPED_TIMER("add");
+    for (int i = 0; i < entries_num; i++) {
+      index.add(test_entry(uint64_t(i % 1000), float(i / 1000), uint32_t(i / 100)));
+    }
+  }
+
+  DiskCacheIndex index;
+  {
+    SCOPED_TIMER("startup");
+    index.open(journal_path);
+  }
+  EXPECT_EQ(index.size(), entries_num);
+
+  {
+    SCOPED_TIMER("lookup");
+    for (int i = 0; i < entries_num; i += 7) {
+      index.lookup(test_entry(uint64_t(i % 1000), float(i / 1000)).key);
+    }
+  }
+
+  {
+    SCOPED_TIMER("eviction");
+    while (const DiskCacheEntry *entry = index.least_recently_used()) {
+      index.remove_pack(entry->pack_id);
+    }
+  }
+  EXPECT_EQ(index.size(), 0);
+}
+
+TEST_F(DiskCacheIndexTest, performance_1000000)
+{
+  test_disk_cache_index_startup_and_eviction(journal_path, 1000000);
+}
+
+#endif
+
+}  // namespace blender::seq::tests
@@ -6,6 +6,7 @@
  * \ingroup bke
  */
 
+#include <algorithm>
 #include <cstddef>
 #include <ctime>
 #include <memory.h>
@@ -69,7 +70,8 @@ struct SeqCache {
   ThreadMutex iterator_mutex;
   BLI_mempool *keys_pool;
   BLI_mempool *items_pool;
-  SeqCacheKey *last_key;
+  /** Last cached key of each render task, to link the images of one frame. */
+  SeqCacheKey *last_key[SEQ_TASK_NUM];
   SeqDiskCache *disk_cache;
 };
 
@@ -172,6 +174,11 @@ static void seq_cache_unlock(Scene *scene)
   }
 }
 
+static void seq_cache_last_keys_clear(SeqCache *cache)
+{
+  std::fill_n(cache->last_key, SEQ_TASK_NUM, nullptr);
+}
+
 static size_t seq_cache_get_mem_total()
 {
   return size_t(U.memcachelimit) * 1024 * 1024;
@@ -223,7 +230,7 @@ static void seq_cache_put_ex(Scene *scene, SeqCacheKey *key, ImBuf *ibuf)
   /* Item stored for later use. */
   if (stored_types_flag & key->type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = cache->last_key[key->task_id];
   }
 
   BLI_assert(!BLI_ghash_haskey(cache->hash, key));
@@ -231,19 +238,19 @@ static void seq_cache_put_ex(Scene *scene, SeqCacheKey *key, ImBuf *ibuf)
   IMB_refImBuf(ibuf);
 
   /* Store pointer to last cached key. */
-  SeqCacheKey *temp_last_key = cache->last_key;
-  cache->last_key = key;
+  SeqCacheKey *temp_last_key = cache->last_key[key->task_id];
+  cache->last_key[key->task_id] = key;
 
   /* Set last_key's reference to this key so we can look up chain backwards.
    * Item is already put in cache, so cache->last_key points to current key.
    */
   if (!key->is_temp_cache && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = key;
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = nullptr;
+    cache->last_key[key->task_id] = nullptr;
   }
 }
 
@@ -358,7 +365,7 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
 
     seq_cache_key_unlink(base);
     BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
-    BLI_assert(base != cache->last_key);
+    BLI_assert(base != cache->last_key[base->task_id]);
     base = prev;
   }
 
@@ -377,7 +384,7 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
 
     seq_cache_key_unlink(base);
     BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
-    BLI_assert(base != cache->last_key);
+    BLI_assert(base != cache->last_key[base->task_id]);
     base = next;
   }
 }
@@ -414,6 +421,11 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
       continue;
     }
 
+    /* The chain of images of a frame which is still being rendered is incomplete. */
+    if (key == cache->last_key[key->task_id]) {
+      continue;
+    }
+
     total_count++;
 
     if (lkey) {
@@ -496,7 +508,6 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = nullptr;
     cache->bmain = bmain;
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
@@ -566,8 +577,8 @@ void seq_cache_free_temp_cache(Scene *scene, short id, int timeline_frame)
       {
         seq_cache_key_unlink(key);
         BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
-        if (key == cache->last_key) {
-          cache->last_key = nullptr;
+        if (key == cache->last_key[key->task_id]) {
+          cache->last_key[key->task_id] = nullptr;
         }
       }
     }
@@ -617,7 +628,7 @@ void cache_cleanup(Scene *scene)
     /* NOTE: no need to call #seq_cache_key_unlink as all keys are removed. */
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = nullptr;
+  seq_cache_last_keys_clear(cache);
   seq_cache_unlock(scene);
 }
 
@@ -682,7 +693,7 @@ void seq_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = nullptr;
+  seq_cache_last_keys_clear(cache);
   seq_cache_unlock(scene);
 }
 
@@ -772,8 +783,9 @@ bool seq_cache_put_if_possible(
   }
 
   if (scene->ed->cache) {
-    seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-    scene->ed->cache->last_key = nullptr;
+    SeqCache *cache = scene->ed->cache;
+    seq_cache_set_temp_cache_linked(scene, cache->last_key[context->task_id]);
+    cache->last_key[context->task_id] = nullptr;
   }
 
   return false;
@@ -819,11 +831,10 @@ void seq_cache_put(
   if (!key->is_temp_cache) {
     if (seq_disk_cache_is_enabled(context->bmain)) {
       if (cache->disk_cache == nullptr) {
-        seq_disk_cache_create(context->bmain, context->scene);
+        cache->disk_cache = seq_disk_cache_create(context->bmain, context->scene);
       }
 
       seq_disk_cache_write_file(cache->disk_cache, key, i);
-      seq_disk_cache_enforce_limits(cache->disk_cache);
     }
   }
 }
@@ -869,7 +880,7 @@ void cache_iterate(
     interrupt = callback_iter(userdata, key->strip, timeline_frame, key->type);
   }
 
-  cache->last_key = nullptr;
+  seq_cache_last_keys_clear(cache);
   seq_cache_unlock(scene);
 }
 
@@ -7,6 +7,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
@@ -17,9 +18,11 @@
 #include "DNA_screen_types.h"
 #include "DNA_sequence_types.h"
 #include "DNA_space_types.h"
+#include "DNA_userdef_types.h"
 
 #include "BLI_listbase.h"
 #include "BLI_threads.h"
+#include "BLI_vector.hh"
 #include "BLI_vector_set.hh"
 
 #include "IMB_imbuf.hh"
@@ -45,39 +48,51 @@
 
 #include "image_cache.hh"
 #include "prefetch.hh"
+#include "prefetch_frames.hh"
 #include "render.hh"
 
 namespace blender::seq {
 
+struct PrefetchJob;
+
+/** Renders upcoming frames on its own evaluated copy of the scene. */
+struct PrefetchWorker {
+  PrefetchJob *pfjob = nullptr;
+  /** Index in #PrefetchJob::workers, also used for the ID of the render task. */
+  int index = 0;
+
+  Main *bmain_eval = nullptr;
+  Scene *scene_eval = nullptr;
+  Depsgraph *depsgraph = nullptr;
+
+  /* context */
+  RenderData context = {};
+  RenderData context_cpy = {};
+
+  /** Frame that is being rendered. */
+  float cfra = 0.0f;
+};
+
 struct PrefetchJob {
   PrefetchJob *next = nullptr;
   PrefetchJob *prev = nullptr;
 
   Main *bmain = nullptr;
-  Main *bmain_eval = nullptr;
   Scene *scene = nullptr;
-  Scene *scene_eval = nullptr;
-  Depsgraph *depsgraph = nullptr;
 
   ThreadMutex prefetch_suspend_mutex = {};
   ThreadCondition prefetch_suspend_cond = {};
 
   ListBase threads = {};
+  Vector<PrefetchWorker *> workers;
 
-  /* context */
-  RenderData context = {};
-  RenderData context_cpy = {};
-  ListBase *seqbasep = nullptr;
-  ListBase *seqbasep_cpy = nullptr;
-
-  /* prefetch area */
-  float cfra = 0.0f;
-  int num_frames_prefetched = 0;
+  /** Prefetch area, protected by #prefetch_suspend_mutex. */
+  PrefetchFrames frames;
 
   /* Control: */
   /* Set by prefetch. */
-  bool running = false;
-  bool waiting = false;
+  std::atomic<int> running_num = 0;
+  int waiting_num = 0;
   bool stop = false;
   /* Set from outside. */
   bool is_scrubbing = false;
@@ -99,7 +114,7 @@ bool seq_prefetch_job_is_running(Scene *scene)
     return false;
   }
 
-  return pfjob->running;
+  return pfjob->running_num > 0;
 }
 
 static void seq_prefetch_job_scrubbing_set(Scene *scene, bool is_scrubbing)
@@ -121,7 +136,7 @@ static bool seq_prefetch_job_is_waiting(Scene *scene)
     return false;
   }
 
-  return pfjob->waiting;
+  return pfjob->waiting_num > 0 && pfjob->waiting_num == pfjob->running_num;
 }
 
 static Strip *sequencer_prefetch_get_original_sequence(Strip *strip, ListBase *seqbase)
@@ -151,8 +166,9 @@ Strip *seq_prefetch_get_original_sequence(Strip *strip, Scene *scene)
 RenderData *seq_prefetch_get_original_context(const RenderData *context)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(context->scene);
+  const int worker_index = context->task_id - SEQ_TASK_PREFETCH_RENDER;
 
-  return &pfjob->context;
+  return &pfjob->workers[worker_index]->context;
 }
 
 static bool seq_prefetch_is_cache_full(Scene *scene)
@@ -166,74 +182,53 @@ static bool seq_prefetch_is_cache_full(Scene *scene)
   return seq_cache_recycle_item(pfjob->scene) == false;
 }
 
-static float seq_prefetch_cfra(PrefetchJob *pfjob)
+static AnimationEvalContext seq_prefetch_anim_eval_context(PrefetchWorker *worker)
 {
-  return pfjob->cfra + pfjob->num_frames_prefetched;
-}
-static AnimationEvalContext seq_prefetch_anim_eval_context(PrefetchJob *pfjob)
-{
-  return BKE_animsys_eval_context_construct(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
+  return BKE_animsys_eval_context_construct(worker->depsgraph, worker->cfra);
 }
 
 void seq_prefetch_get_time_range(Scene *scene, int *r_start, int *r_end)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(scene);
 
-  *r_start = pfjob->cfra;
-  *r_end = seq_prefetch_cfra(pfjob);
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  *r_start = pfjob->frames.start();
+  *r_end = pfjob->frames.end();
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 }
 
-static void seq_prefetch_free_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_free_depsgraph(PrefetchWorker *worker)
 {
-  if (pfjob->depsgraph != nullptr) {
-    DEG_graph_free(pfjob->depsgraph);
+  if (worker->depsgraph != nullptr) {
+    DEG_graph_free(worker->depsgraph);
   }
-  pfjob->depsgraph = nullptr;
-  pfjob->scene_eval = nullptr;
+  worker->depsgraph = nullptr;
+  worker->scene_eval = nullptr;
 }
 
-static void seq_prefetch_update_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_update_depsgraph(PrefetchWorker *worker)
 {
-  DEG_evaluate_on_framechange(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
+  DEG_evaluate_on_framechange(worker->depsgraph, worker->cfra);
 }
 
-static void seq_prefetch_init_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_init_depsgraph(PrefetchWorker *worker)
 {
-  Main *bmain = pfjob->bmain_eval;
-  Scene *scene = pfjob->scene;
+  Main *bmain = worker->bmain_eval;
+  Scene *scene = worker->pfjob->scene;
   ViewLayer *view_layer = BKE_view_layer_default_render(scene);
 
-  pfjob->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
-  DEG_debug_name_set(pfjob->depsgraph, "SEQUENCER PREFETCH");
+  worker->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
+  DEG_debug_name_set(worker->depsgraph, "SEQUENCER PREFETCH");
 
   /* Make sure there is a correct evaluated scene pointer. */
-  DEG_graph_build_for_render_pipeline(pfjob->depsgraph);
+  DEG_graph_build_for_render_pipeline(worker->depsgraph);
 
   /* Update immediately so we have proper evaluated scene. */
-  seq_prefetch_update_depsgraph(pfjob);
-
-  pfjob->scene_eval = DEG_get_evaluated_scene(pfjob->depsgraph);
-  pfjob->scene_eval->ed->cache_flag = 0;
-}
-
-static void seq_prefetch_update_area(PrefetchJob *pfjob)
-{
-  int cfra = pfjob->scene->r.cfra;
-
-  /* rebase */
-  if (cfra > pfjob->cfra) {
-    int delta = cfra - pfjob->cfra;
-    pfjob->cfra = cfra;
-    pfjob->num_frames_prefetched -= delta;
+  worker->cfra = worker->pfjob->frames.end();
+  seq_prefetch_update_depsgraph(worker);
 
-    pfjob->num_frames_prefetched = std::max(pfjob->num_frames_prefetched, 1);
-  }
-
-  /* reset */
-  if (cfra < pfjob->cfra) {
-    pfjob->cfra = cfra;
-    pfjob->num_frames_prefetched = 1;
-  }
+  worker->scene_eval = DEG_get_evaluated_scene(worker->depsgraph);
+  worker->scene_eval->ed->cache_flag = 0;
 }
 
 void prefetch_stop_all()
@@ -257,42 +252,42 @@ void prefetch_stop(Scene *scene)
 
   pfjob->stop = true;
 
-  while (pfjob->running) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+  while (pfjob->running_num > 0) {
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
 }
 
-static void seq_prefetch_update_context(const RenderData *context)
+static void seq_prefetch_update_context(PrefetchWorker *worker, const RenderData *context)
 {
-  PrefetchJob *pfjob;
-  pfjob = seq_prefetch_job_get(context->scene);
+  PrefetchJob *pfjob = worker->pfjob;
+  const eTaskId task_id = eTaskId(SEQ_TASK_PREFETCH_RENDER + worker->index);
 
-  render_new_render_data(pfjob->bmain_eval,
-                         pfjob->depsgraph,
-                         pfjob->scene_eval,
+  render_new_render_data(worker->bmain_eval,
+                         worker->depsgraph,
+                         worker->scene_eval,
                          context->rectx,
                          context->recty,
                          context->preview_render_size,
                          false,
-                         &pfjob->context_cpy);
-  pfjob->context_cpy.is_prefetch_render = true;
-  pfjob->context_cpy.task_id = SEQ_TASK_PREFETCH_RENDER;
+                         &worker->context_cpy);
+  worker->context_cpy.is_prefetch_render = true;
+  worker->context_cpy.task_id = task_id;
 
   render_new_render_data(pfjob->bmain,
-                         pfjob->depsgraph,
+                         worker->depsgraph,
                          pfjob->scene,
                          context->rectx,
                          context->recty,
                          context->preview_render_size,
                          false,
-                         &pfjob->context);
-  pfjob->context.is_prefetch_render = false;
+                         &worker->context);
+  worker->context.is_prefetch_render = false;
 
   /* Same ID as prefetch context, because context will be swapped, but we still
    * want to assign this ID to cache entries created in this thread.
-   * This is to allow "temp cache" work correctly for both threads.
+   * This is to allow "temp cache" work correctly for all threads.
    */
-  pfjob->context.task_id = SEQ_TASK_PREFETCH_RENDER;
+  worker->context.task_id = task_id;
 }
 
 static void seq_prefetch_update_scene(Scene *scene)
@@ -304,17 +299,19 @@ static void seq_prefetch_update_scene(Scene *scene)
   }
 
   pfjob->scene = scene;
-  seq_prefetch_free_depsgraph(pfjob);
-  seq_prefetch_init_depsgraph(pfjob);
+  for (PrefetchWorker *worker : pfjob->workers) {
+    seq_prefetch_free_depsgraph(worker);
+    seq_prefetch_init_depsgraph(worker);
+  }
 }
 
-static void seq_prefetch_update_active_seqbase(PrefetchJob *pfjob)
+static void seq_prefetch_update_active_seqbase(PrefetchWorker *worker)
 {
-  MetaStack *ms_orig = meta_stack_active_get(editing_get(pfjob->scene));
-  Editing *ed_eval = editing_get(pfjob->scene_eval);
+  MetaStack *ms_orig = meta_stack_active_get(editing_get(worker->pfjob->scene));
+  Editing *ed_eval = editing_get(worker->scene_eval);
 
   if (ms_orig != nullptr) {
-    Strip *meta_eval = seq_prefetch_get_original_sequence(ms_orig->parseq, pfjob->scene_eval);
+    Strip *meta_eval = seq_prefetch_get_original_sequence(ms_orig->parseq, worker->scene_eval);
     seqbase_active_set(ed_eval, &meta_eval->seqbase);
   }
   else {
@@ -326,8 +323,32 @@ static void seq_prefetch_resume(Scene *scene)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(scene);
 
-  if (pfjob && pfjob->waiting) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+  if (pfjob && pfjob->waiting_num > 0) {
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
+  }
+}
+
+static void seq_prefetch_worker_free(PrefetchWorker *worker)
+{
+  seq_prefetch_free_depsgraph(worker);
+  BKE_main_free(worker->bmain_eval);
+  MEM_delete(worker);
+}
+
+/**
+ * Add or remove workers, their threads must not be running.
+ */
+static void seq_prefetch_workers_resize(PrefetchJob *pfjob, const int workers_num)
+{
+  while (pfjob->workers.size() > workers_num) {
+    seq_prefetch_worker_free(pfjob->workers.pop_last());
+  }
+  while (pfjob->workers.size() < workers_num) {
+    PrefetchWorker *worker = MEM_new<PrefetchWorker>("PrefetchWorker");
+    worker->pfjob = pfjob;
+    worker->index = pfjob->workers.size();
+    worker->bmain_eval = BKE_main_new();
+    pfjob->workers.append(worker);
   }
 }
 
@@ -340,22 +361,23 @@ void seq_prefetch_free(Scene *scene)
 
   prefetch_stop(scene);
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
+  for (PrefetchWorker *worker : pfjob->workers) {
+    BLI_threadpool_remove(&pfjob->threads, worker);
+  }
   BLI_threadpool_end(&pfjob->threads);
   BLI_mutex_end(&pfjob->prefetch_suspend_mutex);
   BLI_condition_end(&pfjob->prefetch_suspend_cond);
-  seq_prefetch_free_depsgraph(pfjob);
-  BKE_main_free(pfjob->bmain_eval);
+  seq_prefetch_workers_resize(pfjob, 0);
   scene->ed->prefetch_job = nullptr;
   MEM_delete(pfjob);
 }
 
-static bool seq_prefetch_seq_has_disk_cache(PrefetchJob *pfjob,
+static bool seq_prefetch_seq_has_disk_cache(PrefetchWorker *worker,
                                             Strip *strip,
                                             bool can_have_final_image)
 {
-  RenderData *ctx = &pfjob->context_cpy;
-  float cfra = seq_prefetch_cfra(pfjob);
+  RenderData *ctx = &worker->context_cpy;
+  float cfra = worker->cfra;
 
   ImBuf *ibuf = seq_cache_get(ctx, strip, cfra, SEQ_CACHE_STORE_PREPROCESSED);
   if (ibuf != nullptr) {
@@ -382,28 +404,28 @@ static bool seq_prefetch_seq_has_disk_cache(PrefetchJob *pfjob,
   return false;
 }
 
-static bool seq_prefetch_scene_strip_is_rendered(PrefetchJob *pfjob,
+static bool seq_prefetch_scene_strip_is_rendered(PrefetchWorker *worker,
                                                  ListBase *channels,
                                                  ListBase *seqbase,
                                                  blender::Span<Strip *> scene_strips,
                                                  bool is_recursive_check)
 {
-  float cfra = seq_prefetch_cfra(pfjob);
+  float cfra = worker->cfra;
   blender::Vector<Strip *> strips = seq_get_shown_sequences(
-      pfjob->scene_eval, channels, seqbase, cfra, 0);
+      worker->scene_eval, channels, seqbase, cfra, 0);
 
   /* Iterate over rendered strips. */
   for (Strip *strip : strips) {
     if (strip->type == STRIP_TYPE_META &&
         seq_prefetch_scene_strip_is_rendered(
-            pfjob, &strip->channels, &strip->seqbase, scene_strips, true))
+            worker, &strip->channels, &strip->seqbase, scene_strips, true))
     {
       return true;
     }
 
     /* Disable prefetching 3D scene strips, but check for disk cache. */
     if (strip->type == STRIP_TYPE_SCENE && (strip->flag & SEQ_SCENE_STRIPS) == 0 &&
-        !seq_prefetch_seq_has_disk_cache(pfjob, strip, !is_recursive_check))
+        !seq_prefetch_seq_has_disk_cache(worker, strip, !is_recursive_check))
     {
       return true;
     }
@@ -431,47 +453,101 @@ static blender::VectorSet<Strip *> query_scene_strips(ListBase *seqbase)
 
 /* Prefetch must avoid rendering scene strips, because rendering in background locks UI and can
  * make it unresponsive for long time periods. */
-static bool seq_prefetch_must_skip_frame(PrefetchJob *pfjob, ListBase *channels, ListBase *seqbase)
+static bool seq_prefetch_must_skip_frame(PrefetchWorker *worker,
+                                         ListBase *channels,
+                                         ListBase *seqbase)
 {
   blender::VectorSet<Strip *> scene_strips = query_scene_strips(seqbase);
-  if (seq_prefetch_scene_strip_is_rendered(pfjob, channels, seqbase, scene_strips, false)) {
+  if (seq_prefetch_scene_strip_is_rendered(worker, channels, seqbase, scene_strips, false)) {
     return true;
   }
   return false;
 }
 
+static bool seq_prefetch_is_enabled(PrefetchJob *pfjob)
+{
+  return (pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) && !pfjob->stop;
+}
+
 static bool seq_prefetch_need_suspend(PrefetchJob *pfjob)
 {
   return seq_prefetch_is_cache_full(pfjob->scene) || pfjob->is_scrubbing ||
-         (seq_prefetch_cfra(pfjob) >= pfjob->scene->r.efra);
+         (!pfjob->frames.has_released() && pfjob->frames.end() >= pfjob->scene->r.efra);
 }
 
-static void seq_prefetch_do_suspend(PrefetchJob *pfjob)
+/**
+ * Suspend the worker until there is a frame to be prefetched, and assign that frame to it.
+ *
+ * \return False when prefetching has to stop.
+ */
+static bool seq_prefetch_worker_claim_frame(PrefetchWorker *worker)
 {
+  PrefetchJob *pfjob = worker->pfjob;
+  bool has_frame = false;
+
   BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
-  while (seq_prefetch_need_suspend(pfjob) &&
-         (pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) && !pfjob->stop)
-  {
-    pfjob->waiting = true;
+  while (seq_prefetch_is_enabled(pfjob)) {
+    pfjob->frames.update_area(pfjob->scene->r.cfra);
+    if (!seq_prefetch_need_suspend(pfjob)) {
+      worker->cfra = pfjob->frames.claim();
+      has_frame = true;
+      break;
+    }
+    pfjob->waiting_num++;
     BLI_condition_wait(&pfjob->prefetch_suspend_cond, &pfjob->prefetch_suspend_mutex);
-    seq_prefetch_update_area(pfjob);
+    pfjob->waiting_num--;
   }
-  pfjob->waiting = false;
   BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
+
+  return has_frame;
+}
+
+/**
+ * Scrubbing, or playback reaching the frame, makes rendering it in the background useless.
+ */
+static bool seq_prefetch_worker_is_cancelled(PrefetchWorker *worker)
+{
+  PrefetchJob *pfjob = worker->pfjob;
+  return !seq_prefetch_is_enabled(pfjob) || pfjob->is_scrubbing ||
+         worker->cfra <= pfjob->scene->r.cfra;
+}
+
+/**
+ * Mark the frame of the worker as done. The frame of a cancelled render is given back, so it is
+ * assigned again when prefetching continues. Other frames are never affected, so no frame is
+ * rendered by two workers.
+ *
+ * \return False when the worker should stop, because playback is about to reach the prefetched
+ * frames.
+ */
+static bool seq_prefetch_worker_finish_frame(PrefetchWorker *worker, const bool is_cancelled)
+{
+  PrefetchJob *pfjob = worker->pfjob;
+  const int current_frame = pfjob->scene->r.cfra;
+
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  pfjob->frames.finish(int(worker->cfra), is_cancelled, current_frame);
+  /* Avoid "collision" with main thread, but make sure to fetch at least few frames */
+  const bool keep_going = pfjob->frames.assigned_num() <= 5 ||
+                          pfjob->frames.end() - current_frame >= 2;
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
+
+  return keep_going;
 }
 
-static void *seq_prefetch_frames(void *job)
+static void *seq_prefetch_frames(void *worker_v)
 {
-  PrefetchJob *pfjob = (PrefetchJob *)job;
+  PrefetchWorker *worker = static_cast<PrefetchWorker *>(worker_v);
+  PrefetchJob *pfjob = worker->pfjob;
 
-  while (seq_prefetch_cfra(pfjob) <= pfjob->scene->r.efra) {
-    pfjob->scene_eval->ed->prefetch_job = nullptr;
+  while (seq_prefetch_worker_claim_frame(worker)) {
+    worker->scene_eval->ed->prefetch_job = nullptr;
 
-    seq_prefetch_update_depsgraph(pfjob);
-    AnimData *adt = BKE_animdata_from_id(&pfjob->context_cpy.scene->id);
-    AnimationEvalContext anim_eval_context = seq_prefetch_anim_eval_context(pfjob);
+    seq_prefetch_update_depsgraph(worker);
+    AnimData *adt = BKE_animdata_from_id(&worker->context_cpy.scene->id);
+    AnimationEvalContext anim_eval_context = seq_prefetch_anim_eval_context(worker);
     BKE_animsys_evaluate_animdata(
-        &pfjob->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
+        &worker->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
 
     /* This is quite hacky solution:
      * We need cross-reference original scene with copy for cache.
@@ -479,47 +555,73 @@ static void *seq_prefetch_frames(void *job)
      * Scene copy don't reference original scene. Perhaps, this could be done by depsgraph.
      * Set to nullptr before return!
      */
-    pfjob->scene_eval->ed->prefetch_job = pfjob;
-
-    ListBase *seqbase = active_seqbase_get(editing_get(pfjob->scene_eval));
-    ListBase *channels = channels_displayed_get(editing_get(pfjob->scene_eval));
-    if (seq_prefetch_must_skip_frame(pfjob, channels, seqbase)) {
-      pfjob->num_frames_prefetched++;
-      /* Break instead of keep looping if the job should be terminated. */
-      if (!(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop) {
-        break;
-      }
+    worker->scene_eval->ed->prefetch_job = pfjob;
+
+    /* Updating the depsgraph can take a while, check that the frame is still needed. */
+    if (seq_prefetch_worker_is_cancelled(worker)) {
+      seq_prefetch_worker_finish_frame(worker, true);
       continue;
     }
 
-    ImBuf *ibuf = render_give_ibuf(&pfjob->context_cpy, seq_prefetch_cfra(pfjob), 0);
-    seq_cache_free_temp_cache(pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-    IMB_freeImBuf(ibuf);
-
-    /* Suspend thread if there is nothing to be prefetched. */
-    seq_prefetch_do_suspend(pfjob);
-
-    /* Avoid "collision" with main thread, but make sure to fetch at least few frames */
-    if (pfjob->num_frames_prefetched > 5 && (seq_prefetch_cfra(pfjob) - pfjob->scene->r.cfra) < 2)
-    {
-      break;
+    ListBase *seqbase = active_seqbase_get(editing_get(worker->scene_eval));
+    ListBase *channels = channels_displayed_get(editing_get(worker->scene_eval));
+    if (seq_prefetch_must_skip_frame(worker, channels, seqbase)) {
+      seq_prefetch_worker_finish_frame(worker, false);
+      continue;
     }
 
-    if (!(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop) {
+    ImBuf *ibuf = render_give_ibuf(&worker->context_cpy, worker->cfra, 0);
+    seq_cache_free_temp_cache(pfjob->scene, worker->context.task_id, worker->cfra);
+    IMB_freeImBuf(ibuf);
+    if (!seq_prefetch_worker_finish_frame(worker, false)) {
       break;
     }
-
-    seq_prefetch_update_area(pfjob);
-    pfjob->num_frames_prefetched++;
   }
 
-  seq_cache_free_temp_cache(pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-  pfjob->running = false;
-  pfjob->scene_eval->ed->prefetch_job = nullptr;
+  seq_cache_free_temp_cache(pfjob->scene, worker->context.task_id, worker->cfra);
+  worker->scene_eval->ed->prefetch_job = nullptr;
+  pfjob->running_num--;
 
   return nullptr;
 }
 
+static int64_t seq_prefetch_memory_limit()
+{
+  if (U.sequencer_prefetch_memory_limit > 0) {
+    return int64_t(U.sequencer_prefetch_memory_limit) * 1024 * 1024;
+  }
+  return int64_t(U.memcachelimit) * 1024 * 1024 / 2;
+}
+
+/**
+ * Number of frames to render at the same time. Every worker keeps the images of its frame in
+ * memory, so the number is limited by the memory budget for prefetching.
+ */
+static int seq_prefetch_workers_num(const RenderData *context, float cfra)
+{
+  int workers_num = U.sequencer_prefetch_workers;
+  if (workers_num <= 0) {
+    workers_num = std::min(SEQ_PREFETCH_WORKERS_DEFAULT, BLI_system_thread_count());
+  }
+
+  /* Estimate the images of a frame as one float image for each shown strip, plus the result of
+   * compositing them. */
+  Editing *ed = editing_get(context->scene);
+  const int64_t strips_num = seq_get_shown_sequences(context->scene,
+                                                     channels_displayed_get(ed),
+                                                     active_seqbase_get(ed),
+                                                     cfra,
+                                                     0)
+                                 .size();
+  const int64_t frame_size = int64_t(context->rectx) * int64_t(context->recty) * 4 *
+                             int64_t(sizeof(float)) * (strips_num + 1);
+  if (frame_size > 0) {
+    workers_num = int(std::min<int64_t>(workers_num, seq_prefetch_memory_limit() / frame_size));
+  }
+
+  return std::clamp(workers_num, 1, SEQ_PREFETCH_WORKERS_MAX);
+}
+
 static PrefetchJob *seq_prefetch_start_ex(const RenderData *context, float cfra)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(context->scene);
@@ -531,29 +633,35 @@ static PrefetchJob *seq_prefetch_start_ex(const RenderData *context, float cfra)
     pfjob = MEM_new<PrefetchJob>("PrefetchJob");
     context->scene->ed->prefetch_job = pfjob;
 
-    BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, 1);
+    BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, SEQ_PREFETCH_WORKERS_MAX);
     BLI_mutex_init(&pfjob->prefetch_suspend_mutex);
     BLI_condition_init(&pfjob->prefetch_suspend_cond);
 
-    pfjob->bmain_eval = BKE_main_new();
     pfjob->scene = context->scene;
-    seq_prefetch_init_depsgraph(pfjob);
   }
   pfjob->bmain = context->bmain;
 
-  pfjob->cfra = cfra;
-  pfjob->num_frames_prefetched = 1;
+  pfjob->frames.reset(int(cfra));
 
-  pfjob->waiting = false;
+  pfjob->waiting_num = 0;
   pfjob->stop = false;
-  pfjob->running = true;
+
+  /* Threads of the previous run have finished, but have to be joined before reusing workers. */
+  for (PrefetchWorker *worker : pfjob->workers) {
+    BLI_threadpool_remove(&pfjob->threads, worker);
+  }
+  seq_prefetch_workers_resize(pfjob, seq_prefetch_workers_num(context, cfra));
+  pfjob->running_num = pfjob->workers.size();
 
   seq_prefetch_update_scene(context->scene);
-  seq_prefetch_update_context(context);
-  seq_prefetch_update_active_seqbase(pfjob);
+  for (PrefetchWorker *worker : pfjob->workers) {
+    seq_prefetch_update_context(worker, context);
+    seq_prefetch_update_active_seqbase(worker);
+  }
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
-  BLI_threadpool_insert(&pfjob->threads, pfjob);
+  for (PrefetchWorker *worker : pfjob->workers) {
+    BLI_threadpool_insert(&pfjob->threads, worker);
+  }
 
   return pfjob;
 }
@@ -0,0 +1,69 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup sequencer
+ */
+
+#include <algorithm>
+
+#include "prefetch_frames.hh"
+
+namespace blender::seq {
+
+void PrefetchFrames::reset(const int frame)
+{
+  start_ = frame;
+  assigned_num_ = 1;
+  in_progress_.clear();
+  released_.clear();
+}
+
+void PrefetchFrames::update_area(const int current_frame)
+{
+  /* rebase */
+  if (current_frame > start_) {
+    const int delta = current_frame - start_;
+    start_ = current_frame;
+    assigned_num_ = std::max(assigned_num_ - delta, 1);
+  }
+
+  /* reset */
+  if (current_frame < start_) {
+    start_ = current_frame;
+    assigned_num_ = 1;
+  }
+
+  released_.remove_if([&](const int frame) { return frame <= current_frame; });
+}
+
+int PrefetchFrames::claim()
+{
+  int frame;
+  if (!released_.is_empty()) {
+    frame = *std::min_element(released_.begin(), released_.end());
+    released_.remove_contained(frame);
+  }
+  else {
+    /* The area is reset when playback goes back, but frames claimed before may still be
+     * rendering. */
+    while (in_progress_.contains(this->end())) {
+      assigned_num_++;
+    }
+    frame = this->end();
+    assigned_num_++;
+  }
+  in_progress_.add_new(frame);
+  return frame;
+}
+
+void PrefetchFrames::finish(const int frame, const bool is_cancelled, const int current_frame)
+{
+  in_progress_.remove(frame);
+  if (is_cancelled && frame > current_frame) {
+    released_.add(frame);
+  }
+}
+
+}  // namespace blender::seq
@@ -0,0 +1,75 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup sequencer
+ *
+ * Assignment of the frames after the current frame to the prefetch workers.
+ */
+
+#include "BLI_set.hh"
+
+namespace blender::seq {
+
+/**
+ * Frames of the prefetch area, which starts at the current frame of playback. A frame is never
+ * given to two workers at the same time, and frames of cancelled renders are assigned again
+ * before new frames. Not thread-safe, the prefetch job protects it with its mutex.
+ */
+class PrefetchFrames {
+ private:
+  /** Start of the prefetch area. */
+  int start_ = 0;
+  /** Frames from the start of the area that have been assigned to a worker. */
+  int assigned_num_ = 0;
+  /** Frames that are being rendered, never assigned to another worker. */
+  Set<int> in_progress_;
+  /** Frames given back by cancelled workers, assigned again before new frames. */
+  Set<int> released_;
+
+ public:
+  /** Start a new prefetch area at the frame. */
+  void reset(int frame);
+
+  /** Move the area along with playback, frames which were reached are not needed anymore. */
+  void update_area(int current_frame);
+
+  int start() const
+  {
+    return start_;
+  }
+  int assigned_num() const
+  {
+    return assigned_num_;
+  }
+  /** First frame of the area which was not assigned yet. */
+  int end() const
+  {
+    return start_ + assigned_num_;
+  }
+  bool has_released() const
+  {
+    return !released_.is_empty();
+  }
+  bool is_in_progress(const int frame) const
+  {
+    return in_progress_.contains(frame);
+  }
+
+  /**
+   * Assign the next frame: the first frame given back by a cancelled worker, or the next frame of
+   * the area which no other worker is rendering.
+   */
+  int claim();
+
+  /**
+   * Mark a claimed frame as done. The frame of a cancelled render is given back, unless playback
+   * already reached it.
+   */
+  void finish(int frame, bool is_cancelled, int current_frame);
+};
+
+}  // namespace blender::seq
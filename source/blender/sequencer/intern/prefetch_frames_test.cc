@@ -0,0 +1,161 @@
+/* SPDX-FileCopyrightText: 2025 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "BLI_array.hh"
+#include "BLI_rand.hh"
+#include "BLI_vector.hh"
+
+#include "prefetch_frames.hh"
+
+namespace blender::seq::tests {
+
+TEST(prefetch_frames, ClaimAndRelease)
+{
+  PrefetchFrames frames;
+  frames.reset(10);
+  EXPECT_EQ(frames.claim(), 11);
+  EXPECT_EQ(frames.claim(), 12);
+  EXPECT_EQ(frames.claim(), 13);
+  EXPECT_EQ(frames.end(), 14);
+
+  /* A cancelled frame is assigned again before new frames. */
+  frames.finish(12, true, 10);
+  EXPECT_TRUE(frames.has_released());
+  EXPECT_EQ(frames.claim(), 12);
+  EXPECT_EQ(frames.claim(), 14);
+
+  /* Frames reached by playback are not given back. */
+  frames.finish(11, true, 11);
+  frames.update_area(11);
+  EXPECT_FALSE(frames.has_released());
+  EXPECT_EQ(frames.start(), 11);
+  EXPECT_EQ(frames.end(), 15);
+}
+
+TEST(prefetch_frames, ResetKeepsFramesInProgress)
+{
+  PrefetchFrames frames;
+  frames.reset(10);
+  for (const int frame : {11, 12, 13}) {
+    EXPECT_EQ(frames.claim(), frame);
+  }
+  frames.finish(12, false, 10);
+
+  /* Playback went back, the frames which are still rendering are skipped. */
+  frames.update_area(9);
+  EXPECT_EQ(frames.start(), 9);
+  EXPECT_EQ(frames.claim(), 10);
+  EXPECT_EQ(frames.claim(), 12);
+  EXPECT_EQ(frames.claim(), 14);
+  EXPECT_TRUE(frames.is_in_progress(11));
+  EXPECT_TRUE(frames.is_in_progress(13));
+}
+
+/**
+ * Workers claiming frames concurrently, like the prefetch threads. Every frame is only rendered
+ * by one worker at a time.
+ */
+static void run_workers(PrefetchFrames &frames,
+                        std::mutex &mutex,
+                        std::atomic<int> &current_frame,
+                        const int end_frame,
+                        const bool cancel_randomly,
+                        Array<std::atomic<int>> &renders_num,
+                        std::atomic<bool> &overlap)
+{
+  Array<std::atomic<int>> rendering(renders_num.size());
+  for (std::atomic<int> &value : rendering) {
+    value = 0;
+  }
+  Vector<std::thread> threads;
+  for (const int thread_i : IndexRange(8)) {
+    threads.append(std::thread([&, thread_i]() {
+      RandomNumberGenerator rng{uint32_t(thread_i)};
+      while (true) {
+        int frame;
+        {
+          std::scoped_lock lock(mutex);
+          frames.update_area(current_frame);
+          if (!frames.has_released() && frames.end() >= end_frame) {
+            break;
+          }
+          frame = frames.claim();
+        }
+        if (rendering[frame].fetch_add(1) != 0) {
+          overlap = true;
+        }
+        std::this_thread::yield();
+        const bool is_cancelled = cancel_randomly && rng.get_float() < 0.2f;
+        if (!is_cancelled) {
+          renders_num[frame]++;
+        }
+        rendering[frame]--;
+        std::scoped_lock lock(mutex);
+        frames.finish(frame, is_cancelled, current_frame);
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(prefetch_frames, MultipleWorkers)
+{
+  constexpr int end_frame = 2000;
+  PrefetchFrames frames;
+  std::mutex mutex;
+  std::atomic<int> current_frame = 1;
+  Array<std::atomic<int>> renders_num(end_frame * 2);
+  for (std::atomic<int> &value : renders_num) {
+    value = 0;
+  }
+  std::atomic<bool> overlap = false;
+  frames.reset(current_frame);
+  run_workers(frames, mutex, current_frame, end_frame, false, renders_num, overlap);
+
+  EXPECT_FALSE(overlap);
+  for (const int frame : IndexRange(2, end_frame - 2)) {
+    EXPECT_EQ(renders_num[frame], 1) << "frame " << frame;
+  }
+}
+
+TEST(prefetch_frames, MultipleWorkersWithPlayback)
+{
+  constexpr int end_frame = 2000;
+  PrefetchFrames frames;
+  std::mutex mutex;
+  std::atomic<int> current_frame = 1;
+  Array<std::atomic<int>> renders_num(end_frame * 2);
+  for (std::atomic<int> &value : renders_num) {
+    value = 0;
+  }
+  std::atomic<bool> overlap = false;
+  frames.reset(current_frame);
+
+  /* Playback moves forward and jumps back while the workers cancel some of their frames. It stops
+   * after a while so the workers can reach the end. */
+  std::thread playback([&]() {
+    RandomNumberGenerator rng(0);
+    for ([[maybe_unused]] const int step : IndexRange(2000)) {
+      const int frame = current_frame;
+      current_frame = rng.get_float() < 0.05f ? std::max(1, frame - 20) :
+                                                std::min(frame + 1, end_frame / 2);
+      std::this_thread::yield();
+    }
+  });
+  run_workers(frames, mutex, current_frame, end_frame, true, renders_num, overlap);
+  playback.join();
+
+  EXPECT_FALSE(overlap);
+  EXPECT_FALSE(frames.has_released());
+}
+
+}  // namespace blender::seq::tests
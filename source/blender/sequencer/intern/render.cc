@@ -2004,17 +2004,19 @@ ImBuf *render_give_ibuf(const RenderData *context, float timeline_frame, int cha
   relations_free_all_anim_ibufs(context->scene, timeline_frame);
 
   if (!strips.is_empty() && !out) {
-    BLI_mutex_lock(&seq_render_mutex);
-    out = seq_render_strip_stack(context, &state, channels, seqbasep, timeline_frame, chanshown);
-
     if (context->is_prefetch_render) {
+      /* Prefetch workers render their own copy of the scene and link cached images per task, so
+       * they don't have to wait for each other. */
+      out = seq_render_strip_stack(context, &state, channels, seqbasep, timeline_frame, chanshown);
       seq_cache_put(context, strips.last(), timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
     }
     else {
+      BLI_mutex_lock(&seq_render_mutex);
+      out = seq_render_strip_stack(context, &state, channels, seqbasep, timeline_frame, chanshown);
       seq_cache_put_if_possible(
           context, strips.last(), timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
+      BLI_mutex_unlock(&seq_render_mutex);
     }
-    BLI_mutex_unlock(&seq_render_mutex);
   }
 
   seq_prefetch_start(context, timeline_frame);
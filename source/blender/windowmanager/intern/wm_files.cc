@@ -2325,6 +2325,78 @@ bool WM_autosave_is_scheduled(wmWindowManager *wm)
   return wm->autosave_scheduled;
 }
 
+/** Auto-save written on a worker thread, see #wm_autosave_write_background. */
+struct AutosaveJob {
+  BlendFileWriteSnapshot *snapshot;
+  char filepath[FILE_MAX];
+  int fileflags;
+  /** Time the main thread was blocked to take the snapshot. */
+  double snapshot_duration;
+};
+
+static void wm_autosave_job_startjob(void *customdata, wmJobWorkerStatus * /*worker_status*/)
+{
+  const AutosaveJob *job = static_cast<const AutosaveJob *>(customdata);
+
+  const double time_start = BLI_time_now_seconds();
+  /* Error reporting into console. */
+  BLO_write_snapshot_file(job->snapshot, job->filepath, job->fileflags, nullptr);
+
+  CLOG_INFO(&LOG,
+            1,
+            "Auto-save main thread stall: %.3fs (snapshot), background write: %.3fs",
+            job->snapshot_duration,
+            BLI_time_now_seconds() - time_start);
+}
+
+static void wm_autosave_job_free(void *customdata)
+{
+  AutosaveJob *job = static_cast<AutosaveJob *>(customdata);
+  BLO_write_snapshot_free(job->snapshot);
+  MEM_delete(job);
+}
+
+/**
+ * Only serialize \a bmain in memory on the main thread, and compress and write the file in a job.
+ *
+ * \return False when the auto-save has to be written directly instead.
+ */
+static bool wm_autosave_write_background(wmWindowManager *wm,
+                                         Main *bmain,
+                                         const char *filepath,
+                                         const int fileflags)
+{
+  if (G.background) {
+    /* Jobs are not handled without an event loop. */
+    return false;
+  }
+  if (WM_jobs_test(wm, wm, WM_JOB_TYPE_AUTOSAVE)) {
+    /* Still writing the previous auto-save, skip this one rather than stalling. */
+    CLOG_INFO(&LOG, 1, "Auto-save skipped, the previous one is still being written");
+    return true;
+  }
+
+  const double time_start = BLI_time_now_seconds();
+  BlendFileWriteSnapshot *snapshot = BLO_write_snapshot_create(bmain, fileflags);
+  if (snapshot == nullptr) {
+    return false;
+  }
+
+  AutosaveJob *job = MEM_new<AutosaveJob>(__func__);
+  job->snapshot = snapshot;
+  STRNCPY(job->filepath, filepath);
+  job->fileflags = fileflags;
+  job->snapshot_duration = BLI_time_now_seconds() - time_start;
+
+  wmJob *wm_job = WM_jobs_get(
+      wm, nullptr, wm, "Auto-saving...", eWM_JobFlag(0), WM_JOB_TYPE_AUTOSAVE);
+  WM_jobs_customdata_set(wm_job, job, wm_autosave_job_free);
+  WM_jobs_timer(wm_job, 0.5, 0, 0);
+  WM_jobs_callbacks(wm_job, wm_autosave_job_startjob, nullptr, nullptr, nullptr);
+  WM_jobs_start(wm, wm_job);
+  return true;
+}
+
 void WM_autosave_write(wmWindowManager *wm, Main *bmain)
 {
   ED_editors_flush_edits(bmain);
@@ -2335,9 +2407,20 @@ void WM_autosave_write(wmWindowManager *wm, Main *bmain)
    */
   const int fileflags = G.fileflags | G_FILE_RECOVER_WRITE | G_FILE_COMPRESS;
 
-  /* Error reporting into console. */
-  BlendFileWriteParams params{};
-  BLO_write_file(bmain, filepath, fileflags, &params, nullptr);
+  if (!USER_EXPERIMENTAL_TEST(&U, use_autosave_background) ||
+      !wm_autosave_write_background(wm, bmain, filepath, fileflags))
+  {
+    const double time_start = BLI_time_now_seconds();
+
+    /* Error reporting into console. */
+    BlendFileWriteParams params{};
+    BLO_write_file(bmain, filepath, fileflags, &params, nullptr);
+
+    CLOG_INFO(&LOG,
+              1,
+              "Auto-save main thread stall: %.3fs (write)",
+              BLI_time_now_seconds() - time_start);
+  }
 
   /* Restart auto-save timer. */
   wm_autosave_timer_end(wm);
@@ -73,6 +73,7 @@
 #  endif
 
 #  include "DEG_depsgraph.hh"
+#  include "DEG_depsgraph_debug.hh"
 
 #  include "WM_types.hh"
 
@@ -750,6 +751,7 @@ static void print_help(bArgs *ba, bool all)
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-time");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-pretty");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-uid");
+  BLI_args_print_arg_doc(ba, "--debug-depsgraph-trace");
   BLI_args_print_arg_doc(ba, "--debug-ghost");
   BLI_args_print_arg_doc(ba, "--debug-wintab");
   BLI_args_print_arg_doc(ba, "--debug-gpu");
@@ -793,6 +795,8 @@ static void print_help(bArgs *ba, bool all)
   BLI_args_print_arg_doc(ba, "--app-template");
   BLI_args_print_arg_doc(ba, "--factory-startup");
   BLI_args_print_arg_doc(ba, "--enable-event-simulate");
+  BLI_args_print_arg_doc(ba, "--enable-blend-file-mmap-sharing");
+  BLI_args_print_arg_doc(ba, "--enable-blend-file-incremental-save");
   PRINT("\n");
   BLI_args_print_arg_doc(ba, "--env-system-datafiles");
   BLI_args_print_arg_doc(ba, "--env-system-scripts");
@@ -1144,6 +1148,36 @@ static int arg_handle_disable_liboverride_auto_resync(int /*argc*/,
   return 0;
 }
 
+static const char arg_handle_enable_blend_file_mmap_sharing_doc[] =
+    "\n"
+    "\tRead uncompressed blend-files through a memory mapping and use large data arrays\n"
+    "\tdirectly from it instead of copying them, so that only the accessed parts of the file\n"
+    "\tare loaded into memory.\n"
+    "\n"
+    "\tNOTE: the blend-file should not be modified by other processes while it is open.";
+static int arg_handle_enable_blend_file_mmap_sharing(int /*argc*/,
+                                                     const char ** /*argv*/,
+                                                     void * /*data*/)
+{
+  G.fileflags |= G_FILE_MMAP_DATA_SHARING;
+  return 0;
+}
+
+static const char arg_handle_enable_blend_file_incremental_save_doc[] =
+    "\n"
+    "\tWhen saving uncompressed blend-files again, only append the data-blocks that changed\n"
+    "\tsince the previous save, the whole file is rewritten once too much of it is unused.\n"
+    "\n"
+    "\tNOTE: only used on file systems which can clone files (Btrfs, XFS or APFS for example).\n"
+    "\tVersion backups ('.blend1' files) are only made by full saves.";
+static int arg_handle_enable_blend_file_incremental_save(int /*argc*/,
+                                                         const char ** /*argv*/,
+                                                         void * /*data*/)
+{
+  G.fileflags |= G_FILE_INCREMENTAL_SAVE;
+  return 0;
+}
+
 static const char arg_handle_log_level_set_doc[] =
     "<level>\n"
     "\tSet the logging verbosity level (higher for more details) defaults to 1,\n"
@@ -1365,6 +1399,21 @@ static int arg_handle_debug_mode_generic_set(int /*argc*/, const char ** /*argv*
   return 0;
 }
 
+static const char arg_handle_debug_depsgraph_trace_set_doc[] =
+    "<filepath>\n"
+    "\tRecord a timeline of the dependency graph evaluation, and write it to the given file\n"
+    "\tin the Chrome trace event format when Blender exits.";
+static int arg_handle_debug_depsgraph_trace_set(int argc, const char **argv, void * /*data*/)
+{
+  const char *arg_id = "--debug-depsgraph-trace";
+  if (argc > 1) {
+    DEG_trace_export_on_exit(argv[1]);
+    return 1;
+  }
+  fprintf(stderr, "\nError: '%s' no args given.\n", arg_id);
+  return 0;
+}
+
 static const char arg_handle_debug_mode_io_doc[] =
     "\n\t"
     "Enable debug messages for I/O (Collada, ...).";
@@ -2731,6 +2780,16 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
                "--disable-liboverride-auto-resync",
                CB(arg_handle_disable_liboverride_auto_resync),
                nullptr);
+  BLI_args_add(ba,
+               nullptr,
+               "--enable-blend-file-mmap-sharing",
+               CB(arg_handle_enable_blend_file_mmap_sharing),
+               nullptr);
+  BLI_args_add(ba,
+               nullptr,
+               "--enable-blend-file-incremental-save",
+               CB(arg_handle_enable_blend_file_incremental_save),
+               nullptr);
 
   BLI_args_add(ba, "-a", nullptr, CB(arg_handle_playback_mode), nullptr);
 
@@ -2867,6 +2926,8 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
                "--debug-depsgraph-uid",
                CB_EX(arg_handle_debug_mode_generic_set, depsgraph_uid),
                (void *)G_DEBUG_DEPSGRAPH_UID);
+  BLI_args_add(
+      ba, nullptr, "--debug-depsgraph-trace", CB(arg_handle_debug_depsgraph_trace_set), nullptr);
   BLI_args_add(ba,
                nullptr,
                "--debug-gpu-force-workarounds",
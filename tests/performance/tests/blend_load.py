@@ -5,12 +5,25 @@
 import api
 
 
-def _run(filepath):
+def _run(args):
     import bpy
+    import os
+    import tempfile
     import time
 
+    filepath = args['filepath']
+
     # Load once to ensure it's cached by OS
     bpy.ops.wm.open_mainfile(filepath=filepath)
+
+    if args['compress']:
+        # Save a Zstd compressed copy, which is written with a seek table so that
+        # the frames can be decompressed in parallel while loading.
+        tmpdir = tempfile.mkdtemp()
+        filepath = os.path.join(tmpdir, os.path.basename(filepath))
+        bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=True, copy=True)
+        bpy.ops.wm.open_mainfile(filepath=filepath)
+
     bpy.ops.wm.read_homefile(use_empty=True, use_factory_startup=True)
 
     # Measure loading the second time
@@ -18,25 +31,38 @@ def _run(filepath):
     bpy.ops.wm.open_mainfile(filepath=filepath)
     elapsed_time = time.time() - start_time
 
+    if args['compress']:
+        bpy.ops.wm.read_homefile(use_empty=True, use_factory_startup=True)
+        os.remove(filepath)
+        os.rmdir(tmpdir)
+
     result = {'time': elapsed_time}
     return result
 
 
 class BlendLoadTest(api.Test):
-    def __init__(self, filepath):
+    def __init__(self, filepath, compress=False):
         self.filepath = filepath
+        self.compress = compress
 
     def name(self):
+        if self.compress:
+            return self.filepath.stem + "_compressed"
         return self.filepath.stem
 
     def category(self):
         return "blend_load"
 
     def run(self, env, device_id):
-        result, _ = env.run_in_blender(_run, str(self.filepath))
+        args = {'filepath': str(self.filepath), 'compress': self.compress}
+        result, _ = env.run_in_blender(_run, args)
         return result
 
 
 def generate(env):
     filepaths = env.find_blend_files('*/*')
-    return [BlendLoadTest(filepath) for filepath in filepaths]
+    tests = []
+    for filepath in filepaths:
+        tests.append(BlendLoadTest(filepath))
+        tests.append(BlendLoadTest(filepath, compress=True))
+    return tests
@@ -0,0 +1,64 @@
+# SPDX-FileCopyrightText: 2025 Blender Authors
+#
+# SPDX-License-Identifier: Apache-2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import os
+    import shutil
+    import tempfile
+    import time
+
+    bpy.ops.wm.open_mainfile(filepath=args['filepath'])
+
+    # First save to a new location, which always writes the whole file.
+    tmpdir = tempfile.mkdtemp()
+    filepath = os.path.join(tmpdir, os.path.basename(args['filepath']))
+    bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=False)
+
+    # Change a single data-block, like a typical edit between two saves.
+    if bpy.data.objects:
+        bpy.data.objects[0].location.x += 1.0
+
+    # Measure saving again, only the changed data-block is appended when saving incrementally.
+    start_time = time.time()
+    bpy.ops.wm.save_mainfile(compress=False)
+    elapsed_time = time.time() - start_time
+
+    bpy.ops.wm.read_homefile(use_empty=True, use_factory_startup=True)
+    shutil.rmtree(tmpdir)
+
+    result = {'time': elapsed_time}
+    return result
+
+
+class BlendSaveTest(api.Test):
+    def __init__(self, filepath, incremental=False):
+        self.filepath = filepath
+        self.incremental = incremental
+
+    def name(self):
+        if self.incremental:
+            return self.filepath.stem + "_incremental"
+        return self.filepath.stem
+
+    def category(self):
+        return "blend_save"
+
+    def run(self, env, device_id):
+        args = {'filepath': str(self.filepath)}
+        blender_args = ['--enable-blend-file-incremental-save'] if self.incremental else []
+        result, _ = env.run_in_blender(_run, args, blender_args)
+        return result
+
+
+def generate(env):
+    filepaths = env.find_blend_files('*/*')
+    tests = []
+    for filepath in filepaths:
+        tests.append(BlendSaveTest(filepath))
+        tests.append(BlendSaveTest(filepath, incremental=True))
+    return tests
@@ -0,0 +1,67 @@
+# SPDX-FileCopyrightText: 2025 Blender Authors
+#
+# SPDX-License-Identifier: Apache-2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import time
+
+    preferences = bpy.context.preferences
+    preferences.view.show_developer_ui = True
+    preferences.experimental.use_depsgraph_priority_scheduling = args['use_priority_scheduling']
+
+    scene = bpy.context.scene
+    depsgraph = bpy.context.evaluated_depsgraph_get()
+
+    # Warm up, so that operation timings are known to the priority scheduling.
+    for i in range(scene.frame_start, min(scene.frame_start + 5, scene.frame_end) + 1):
+        scene.frame_set(i)
+
+    start_time = time.time()
+    elapsed_time = 0.0
+    num_frames = 0
+    thread_utilization = 0.0
+
+    while elapsed_time < 10.0:
+        for i in range(scene.frame_start, scene.frame_end + 1):
+            scene.frame_set(i)
+            thread_utilization += depsgraph.debug_thread_utilization()
+
+        num_frames += scene.frame_end + 1 - scene.frame_start
+        elapsed_time = time.time() - start_time
+
+    time_per_frame = elapsed_time / num_frames
+
+    result = {'time': time_per_frame, 'thread_utilization': thread_utilization / num_frames}
+    return result
+
+
+class DepsgraphTest(api.Test):
+    def __init__(self, filepath, use_priority_scheduling):
+        self.filepath = filepath
+        self.use_priority_scheduling = use_priority_scheduling
+
+    def name(self):
+        if self.use_priority_scheduling:
+            return self.filepath.stem + "_priority"
+        return self.filepath.stem
+
+    def category(self):
+        return "depsgraph"
+
+    def run(self, env, device_id):
+        args = {'use_priority_scheduling': self.use_priority_scheduling}
+        # Operation timings are needed for the thread utilization.
+        blender_args = ['--debug-depsgraph-time', self.filepath]
+        result, _ = env.run_in_blender(_run, args, blender_args)
+        return result
+
+
+def generate(env):
+    filepaths = env.find_blend_files('depsgraph/*')
+    return [DepsgraphTest(filepath, use_priority_scheduling)
+            for filepath in filepaths
+            for use_priority_scheduling in (False, True)]